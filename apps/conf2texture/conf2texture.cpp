@@ -0,0 +1,226 @@
+// Source file for the rgbd texture baking program
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files 
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Graphics/R3Graphics.h"
+#include "RGBD/RGBD.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Program arguments
+////////////////////////////////////////////////////////////////////////
+
+static const char *input_configuration_filename = NULL;
+static const char *output_configuration_filename = NULL;
+static const char *output_texture_directory = NULL;
+static int load_every_kth_image = 1;
+static int max_views_per_texel = 3;
+static double max_viewing_angle = 75; // in degrees
+static double max_depth_inconsistency = 0.1; // as fraction of depth
+static double max_depth = 7.0;
+static int image_border_width = 16; // in pixels
+static int texel_padding = 2; // in texels
+static int max_resident_images = 16;
+static int nthreads = 0;
+static int print_verbose = 0;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Input/output functions
+////////////////////////////////////////////////////////////////////////
+
+static RGBDConfiguration *
+ReadConfigurationFile(const char *filename) 
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Reading configuration from %s ...\n", filename);
+    fflush(stdout);
+  }
+
+  // Allocate configuration
+  RGBDConfiguration *configuration = new RGBDConfiguration();
+  if (!configuration) {
+    fprintf(stderr, "Unable to allocate configuration for %s\n", filename);
+    return NULL;
+  }
+
+  // Read file
+  if (!configuration->ReadFile(filename, load_every_kth_image)) {
+    fprintf(stderr, "Unable to read configuration from %s\n", filename);
+    return NULL;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", configuration->NImages());
+    printf("  # Surfaces = %d\n", configuration->NSurfaces());
+    fflush(stdout);
+  }
+
+  // Return configuration
+  return configuration;
+}
+
+
+
+static int
+WriteConfigurationFile(RGBDConfiguration *configuration, const char *filename) 
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Writing configuration to %s ...\n", filename);
+    fflush(stdout);
+  }
+
+  // Write file (and surface textures)
+  if (!configuration->WriteFile(filename)) return 0;
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Images = %d\n", configuration->NImages());
+    printf("  # Surfaces = %d\n", configuration->NSurfaces());
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Texture functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+BakeTextures(RGBDConfiguration *configuration)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Baking textures ...\n");
+    fflush(stdout);
+  }
+
+  // Set up baker
+  RGBDTextureBaker baker(configuration);
+  baker.SetMaxViewsPerTexel(max_views_per_texel);
+  baker.SetMaxViewingAngle(RN_PI * max_viewing_angle / 180.0);
+  baker.SetDepthTolerance(max_depth_inconsistency);
+  baker.SetMaxDepth(max_depth);
+  baker.SetImageBorderWidth(image_border_width);
+  baker.SetTexelPadding(texel_padding);
+  baker.SetMaxResidentImages(max_resident_images);
+  baker.SetNThreads(nthreads);
+
+  // Bake textures
+  int ntexels = baker.BakeTextures();
+
+  // Print statistics
+  if (print_verbose) {
+    int total_texels = 0;
+    for (int i = 0; i < configuration->NSurfaces(); i++) {
+      RGBDSurface *surface = configuration->Surface(i);
+      total_texels += surface->NTexels(RN_X) * surface->NTexels(RN_Y);
+    }
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Surfaces = %d\n", configuration->NSurfaces());
+    printf("  # Texels = %d\n", total_texels);
+    printf("  # Colored Texels = %d\n", ntexels);
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// PROGRAM ARGUMENT PARSING
+////////////////////////////////////////////////////////////////////////
+
+static int 
+ParseArgs(int argc, char **argv)
+{
+  // Parse arguments
+  argc--; argv++;
+  while (argc > 0) {
+    if ((*argv)[0] == '-') {
+      if (!strcmp(*argv, "-v")) print_verbose = 1;
+      else if (!strcmp(*argv, "-texture_directory")) { argc--; argv++; output_texture_directory = *argv; }
+      else if (!strcmp(*argv, "-load_every_kth_image")) { argc--; argv++; load_every_kth_image = atoi(*argv); }
+      else if (!strcmp(*argv, "-max_views_per_texel")) { argc--; argv++; max_views_per_texel = atoi(*argv); }
+      else if (!strcmp(*argv, "-max_viewing_angle")) { argc--; argv++; max_viewing_angle = atof(*argv); }
+      else if (!strcmp(*argv, "-max_depth_inconsistency")) { argc--; argv++; max_depth_inconsistency = atof(*argv); }
+      else if (!strcmp(*argv, "-max_depth")) { argc--; argv++; max_depth = atof(*argv); }
+      else if (!strcmp(*argv, "-image_border_width")) { argc--; argv++; image_border_width = atoi(*argv); }
+      else if (!strcmp(*argv, "-texel_padding")) { argc--; argv++; texel_padding = atoi(*argv); }
+      else if (!strcmp(*argv, "-max_resident_images")) { argc--; argv++; max_resident_images = atoi(*argv); }
+      else if (!strcmp(*argv, "-threads")) { argc--; argv++; nthreads = atoi(*argv); }
+      else { fprintf(stderr, "Invalid program argument: %s", *argv); exit(1); }
+      argv++; argc--;
+    }
+    else {
+      if (!input_configuration_filename) input_configuration_filename = *argv;
+      else if (!output_configuration_filename) output_configuration_filename = *argv;
+      else { fprintf(stderr, "Invalid program argument: %s", *argv); exit(1); }
+      argv++; argc--;
+    }
+  }
+
+  // Check filenames
+  if (!input_configuration_filename || !output_configuration_filename) {
+    fprintf(stderr, "Usage: conf2texture inputconfigurationfile outputconfigurationfile [-texture_directory dir] [options]\n");
+    return 0;
+  }
+
+  // Return OK status 
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// MAIN
+////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char **argv)
+{
+  // Check number of arguments
+  if (!ParseArgs(argc, argv)) exit(1);
+
+  // Read configuration
+  RGBDConfiguration *configuration = ReadConfigurationFile(input_configuration_filename);
+  if (!configuration) exit(-1);
+
+  // Set texture directory
+  if (output_texture_directory) configuration->SetTextureDirectory(output_texture_directory);
+
+  // Bake textures
+  if (!BakeTextures(configuration)) exit(-1);
+
+  // Write configuration
+  if (!WriteConfigurationFile(configuration, output_configuration_filename)) exit(-1);
+
+  // Return success 
+  return 0;
+}
+
+
+
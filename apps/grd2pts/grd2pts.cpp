@@ -15,6 +15,8 @@ static char *points_name = NULL;
 static RNLength min_spacing = 0;
 static RNScalar sigma = 0;
 static RNBoolean local_maxima_only = FALSE;
+static RNBoolean subvoxel = FALSE;
+static RNBoolean compute_normals = FALSE;
 static int npoints = 1024;
 static RNBoolean ascii = FALSE;
 static RNBoolean print_verbose = FALSE;
@@ -141,73 +143,8 @@ CreateGrid(const RNArray<R3Grid *>& grids, RNLength sigma)
 
 
 
-static R3Grid *
-CreateMask(R3Grid *grid, RNBoolean local_maxima_only)
-{
-  // Start statistics
-  RNTime start_time;
-  start_time.Read();
-
-  // Create mask
-  R3Grid *mask = new R3Grid(*grid);
-  if (!mask) {
-    fprintf(stderr, "Unable to allocate mask\n");
-    return NULL;
-  }
-
-  // Keep only local maxima, make others zero
-  if (local_maxima_only) {
-    for (int k = 0; k < grid->ZResolution(); k++) {
-      for (int j = 0; j < grid->YResolution(); j++) {
-        for (int i = 0; i < grid->XResolution(); i++) {
-          RNScalar grid_value = grid->GridValue(i, j, k);
-          for (int t = k-1; t <= k+1; t++) {
-            if ((t < 0) || (t >= grid->ZResolution())) continue;
-            for (int s = j-1; s <= j+1; s++) {
-              if ((s < 0) || (s >= grid->YResolution())) continue;
-              for (int r = i-1; r <= i+1; r++) {
-                if ((r < 0) || (r >= grid->XResolution())) continue;
-                if ((r == i) && (s == j) && (t == k)) continue;
-                RNScalar neighbor_value = grid->GridValue(r, s, t);
-                if (neighbor_value > grid_value) {
-                  mask->SetGridValue(i, j, k, 0);
-                  goto exitinteriorloops;
-                }
-              }
-            }
-          }
-        exitinteriorloops:;
-        }
-      }
-    }
-  }
-
-  // Print statistics
-  if (print_verbose) {
-    printf("Created mask ...\n");
-    printf("  Time = %.2f seconds\n", start_time.Elapsed());
-    printf("  Resolution = %d %d %d\n", mask->XResolution(), mask->YResolution(), mask->ZResolution());
-    const R3Box bbox = mask->WorldBox();
-    printf("  World Box = ( %g %g %g ) ( %g %g %g )\n", bbox[0][0], bbox[0][1], bbox[0][2], bbox[1][0], bbox[1][1], bbox[1][2]);
-    printf("  Spacing = %g\n", mask->GridToWorldScaleFactor());
-    printf("  Cardinality = %d\n", mask->Cardinality());
-    printf("  Volume = %g\n", mask->Volume());
-    RNInterval grid_range = mask->Range();
-    printf("  Minimum = %g\n", grid_range.Min());
-    printf("  Maximum = %g\n", grid_range.Max());
-    printf("  L1Norm = %g\n", mask->L1Norm());
-    printf("  Local Maxima Only = %d\n", local_maxima_only);
-    fflush(stdout);
-  }
-
-  // Return mask
-  return mask;
-}
-
-
-
 static RNArray<Point *> *
-CreatePoints(R3Grid *grid, R3Grid *mask, int npoints, RNLength min_spacing)
+CreatePoints(R3Grid *grid, int npoints, RNLength min_spacing, RNBoolean local_maxima_only)
 {
   // Start statistics
   RNTime start_time;
@@ -220,39 +157,25 @@ CreatePoints(R3Grid *grid, R3Grid *mask, int npoints, RNLength min_spacing)
     return NULL;
   }
 
-  // Compute points
-  for (int i = 0; i < npoints; i++) {
-    // Find maximum value
-    int maximum_index = -1;
-    RNScalar maximum_value = 0;
-    const RNScalar *mask_valuesp = mask->GridValues();
-    for (int j = 0; j < mask->NEntries(); j++) {
-      if (*mask_valuesp > maximum_value) { maximum_value = *mask_valuesp; maximum_index = j; }
-      mask_valuesp++;
-    }
-
-    // Check if found value greater than zero
-    if (maximum_index < 0) break;
-
-    // Determine world position and normal
-    int x, y, z;
-    mask->IndexToIndices(maximum_index, x, y, z);
-    R3Point position = grid->WorldPosition(x, y, z);
-    R3Vector gradient = R3zero_vector; // grid->WorldGradientVector(x, y, z);
-    gradient.Normalize();
+  // Find peaks (in order of decreasing value, each at least min_spacing from earlier ones)
+  R3Point *positions = new R3Point [ (npoints > 0) ? npoints : 1 ];
+  R3Vector *normals = (compute_normals) ? new R3Vector [ (npoints > 0) ? npoints : 1 ] : NULL;
+  RNScalar *values = new RNScalar [ (npoints > 0) ? npoints : 1 ];
+  int npeaks = grid->FindWorldPeaks(npoints, min_spacing, positions, values, normals, 0, local_maxima_only, subvoxel);
 
-    // Create point
-    Point *point = new Point(position, gradient, maximum_value);
+  // Create points
+  for (int i = 0; i < npeaks; i++) {
+    R3Vector normal = (normals) ? normals[i] : R3zero_vector;
+    Point *point = new Point(positions[i], normal, values[i]);
     assert(point);
-
-    // Add point to list
     points->Insert(point);
-
-    // Mask area around point 
-    if (min_spacing > 0) mask->RasterizeWorldSphere(position, min_spacing, -maximum_value);
-    else mask->SetGridValue(x, y, z, 0);
   }
 
+  // Delete peak info
+  delete [] positions;
+  if (normals) delete [] normals;
+  delete [] values;
+
   // Print message
   if (print_verbose) {
     printf("Created points ...\n");
@@ -260,6 +183,9 @@ CreatePoints(R3Grid *grid, R3Grid *mask, int npoints, RNLength min_spacing)
     printf("  # Points = %d\n", points->NEntries());
     printf("  Requested Points = %d\n", npoints);
     printf("  Min Spacing = %g\n", min_spacing);
+    printf("  Local Maxima Only = %d\n", local_maxima_only);
+    printf("  Subvoxel = %d\n", subvoxel);
+    printf("  Normals = %d\n", compute_normals);
     fflush(stdout);
   }
 
@@ -369,6 +295,8 @@ ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-min_spacing")) { argv++; argc--; min_spacing = atof(*argv); }
       else if (!strcmp(*argv, "-sigma")) { argv++; argc--; sigma = atof(*argv); }
       else if (!strcmp(*argv, "-local_maxima_only")) local_maxima_only = TRUE; 
+      else if (!strcmp(*argv, "-subvoxel")) subvoxel = TRUE; 
+      else if (!strcmp(*argv, "-normals")) compute_normals = TRUE; 
       else { 
         fprintf(stderr, "Invalid program argument: %s\n", *argv); 
         exit(1); 
@@ -417,12 +345,8 @@ main(int argc, char **argv)
   R3Grid *grid = CreateGrid(grids, sigma);
   if (!grid) exit(-1);
 
-  // Create mask
-  R3Grid *mask = CreateMask(grid, local_maxima_only);
-  if (!mask) exit(-1);
-
   // Create points
-  RNArray<Point *> *points = CreatePoints(grid, mask, npoints, min_spacing);
+  RNArray<Point *> *points = CreatePoints(grid, npoints, min_spacing, local_maxima_only);
   if (!points) exit(-1);
 
   // Write points
@@ -13,10 +13,35 @@
 const char *input_name = NULL;
 const char *output_name = NULL;
 const char *color_name = NULL;
+int color_interpolate = 0;
+const char *transfer_name = NULL;
+RNLength transfer_max_distance = 0;
+RNAngle transfer_max_normal_angle = 0;
+int transfer_nearest_vertex = 0;
+const char *slice_name = NULL;
+RNLength slice_spacing = 0;
+R3Vector slice_normal(0, 0, 1);
 int flip_faces = 0;
 int clean = 0;
+int merge_coincident_vertices = 0;
+RNLength merge_epsilon = -1;
 int smooth = 0;
 int swap_edges = 0;
+int audit_intersections = 0;
+int remove_intersections = 0;
+const char *boolean_name = NULL;
+int boolean_operation = -1;
+int remesh = 0;
+RNLength remesh_edge_length = 0;
+RNLength remesh_min_edge_length = 0;
+RNLength remesh_error = 0;
+RNAngle remesh_feature_angle = RN_PI / 4.0;
+int remesh_iterations = 10;
+int progressive_mesh_base_faces = 0;
+int normal_max_neighbors = 0;
+int normal_robust_iterations = 0;
+R3Point normal_viewpoint(0, 0, 0);
+int normal_orientation_method = R3_NORMAL_MST_ORIENTATION;
 R3Affine xform(R4Matrix(1,0,0,0, 0,1,0,0, 0,0,1,0, 0,0,0,1));
 RNLength min_edge_length = 0;
 RNLength max_edge_length = 0;
@@ -69,9 +94,44 @@ ReadMesh(const char *mesh_name)
 
 
 
+static int
+WriteProgressiveMesh(R3Mesh *mesh, const char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Build progressive mesh (base mesh and vertex splits)
+  R3ProgressiveMesh progressive_mesh;
+  if (!progressive_mesh.Build(mesh, progressive_mesh_base_faces)) return 0;
+
+  // Write progressive mesh to file
+  if (!progressive_mesh.WriteFile(filename)) return 0;
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Wrote progressive mesh to %s ...\n", filename);
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Faces = %d\n", mesh->NFaces());
+    printf("  # Base Faces = %d\n", progressive_mesh.NBaseFaces());
+    printf("  # Base Vertices = %d\n", progressive_mesh.NBaseVertices());
+    printf("  # Vertex Splits = %d\n", progressive_mesh.NSplits());
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
 static int
 WriteMesh(R3Mesh *mesh, const char *filename)
 {
+  // Write progressive mesh
+  const char *extension = strrchr(filename, '.');
+  if (extension && !strcmp(extension, ".pm")) return WriteProgressiveMesh(mesh, filename);
+
   // Start statistics
   RNTime start_time;
   start_time.Read();
@@ -128,42 +188,271 @@ ReadMatrix(R4Matrix& m, const char *filename)
 ////////////////////////////////////////////////////////////////////////
 
 static int
-CopyColors(R3Mesh *mesh, const char *source_mesh_name)
+TransferAttributes(R3Mesh *mesh, const char *source_mesh_name, int attributes, int interpolation)
 {
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
   // Read source mesh
   R3Mesh source_mesh;
   if (!source_mesh.ReadFile(source_mesh_name)) return 0;
 
-  // Create kdtree
-  R3MeshSearchTree kdtree(&source_mesh);
-  
-  // Copy colors
-  for (int i = 0; i < mesh->NVertices(); i++) {
-    R3MeshVertex *vertex = mesh->Vertex(i);
-    mesh->SetVertexColor(vertex, RNblack_rgb);
-    const R3Point& position = mesh->VertexPosition(vertex);
-
-    // Search kdtree
-    R3MeshIntersection closest;
-    kdtree.FindClosest(position, closest);
-    if (closest.type == R3_MESH_VERTEX_TYPE) {
-      mesh->SetVertexColor(vertex, source_mesh.VertexColor(closest.vertex));
+  // Create transfer
+  R3MeshAttributeTransfer transfer(&source_mesh);
+  transfer.SetMaxDistance(transfer_max_distance);
+  transfer.SetMaxNormalAngle(transfer_max_normal_angle);
+  transfer.SetInterpolation(interpolation);
+
+  // Make colors black where there is no correspondence
+  if (attributes & R3_MESH_TRANSFER_COLORS) {
+    for (int i = 0; i < mesh->NVertices(); i++) {
+      mesh->SetVertexColor(mesh->Vertex(i), RNblack_rgb);
     }
-    else if (closest.type == R3_MESH_EDGE_TYPE) {
-      R3Span span = mesh->EdgeSpan(closest.edge);
-      RNScalar t = span.T(position);
-      int k = (t < 0.5 * span.Length()) ?  0 : 1;
-      R3MeshVertex *source_vertex = source_mesh.VertexOnEdge(closest.edge, k);
-      mesh->SetVertexColor(vertex, source_mesh.VertexColor(source_vertex));
+  }
+
+  // Transfer attributes
+  int count = transfer.Transfer(mesh, attributes);
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Transferred attributes from %s ...\n", source_mesh_name);
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Source Faces = %d\n", source_mesh.NFaces());
+    printf("  # Targets = %d\n", count);
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+AuditIntersections(R3Mesh *mesh, int repair)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Find intersecting faces
+  R3MeshIntersectionAudit audit(mesh);
+  int nfound = audit.FindIntersections();
+  if (nfound < 0) return 0;
+  int nfaces = audit.NIntersectingFaces();
+
+  // Remove intersecting faces and fill holes
+  int nremaining = nfound;
+  if (repair && (nfound > 0)) {
+    nremaining = audit.RemoveIntersections();
+    if (nremaining < 0) return 0;
+  }
+
+  // Print statistics
+  printf("Audited self-intersections ...\n");
+  printf("  # Intersecting Face Pairs = %d\n", nfound);
+  printf("  # Intersecting Faces = %d\n", nfaces);
+  if (repair) printf("  # Remaining Face Pairs = %d\n", nremaining);
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Faces = %d\n", mesh->NFaces());
+  }
+  fflush(stdout);
+
+  // Return success
+  return 1;
+}
+
+
+
+static R3Mesh *
+ComputeBoolean(R3Mesh *mesh, const char *operand_mesh_name, int operation)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Read operand mesh
+  R3Mesh operand_mesh;
+  if (!operand_mesh.ReadFile(operand_mesh_name)) return NULL;
+
+  // Compute boolean operation
+  R3Mesh *result = new R3Mesh();
+  R3MeshBoolean boolean(mesh, &operand_mesh);
+  if (!boolean.Compute(operation, result)) {
+    delete result;
+    return NULL;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Computed boolean operation with %s ...\n", operand_mesh_name);
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Operand Faces = %d\n", operand_mesh.NFaces());
+    printf("  # Intersection Segments = %d\n", boolean.NIntersectionSegments());
+    printf("  # Perturbations = %d\n", boolean.NPerturbations());
+    printf("  # Faces = %d\n", result->NFaces());
+    fflush(stdout);
+  }
+
+  // Return result
+  return result;
+}
+
+
+
+static int
+RemeshMesh(R3Mesh *mesh)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  int nfaces = mesh->NFaces();
+
+  // Remesh
+  R3MeshRemesher remesher(mesh);
+  remesher.SetTargetEdgeLength(remesh_edge_length);
+  remesher.SetMinEdgeLength(remesh_min_edge_length);
+  remesher.SetApproximationError(remesh_error);
+  remesher.SetFeatureAngle(remesh_feature_angle);
+  remesher.SetNIterations(remesh_iterations);
+  if (!remesher.Remesh()) return 0;
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Remeshed ...\n");
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Input Faces = %d\n", nfaces);
+    printf("  # Splits = %d\n", remesher.NSplits());
+    printf("  # Collapses = %d\n", remesher.NCollapses());
+    printf("  # Swaps = %d\n", remesher.NSwaps());
+    printf("  # Faces = %d\n", mesh->NFaces());
+    printf("  Average Edge Length = %g\n", mesh->AverageEdgeLength());
+    fflush(stdout);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+EstimateNormals(R3Mesh *mesh, int max_neighbors)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Fill array of vertex positions
+  if (mesh->NVertices() == 0) return 1;
+  R3Point *positions = new R3Point [ mesh->NVertices() ];
+  for (int i = 0; i < mesh->NVertices(); i++) {
+    positions[i] = mesh->VertexPosition(mesh->Vertex(i));
+  }
+
+  // Estimate normals
+  R3Vector *normals = new R3Vector [ mesh->NVertices() ];
+  R3NormalEstimator estimator(mesh->NVertices(), positions);
+  estimator.SetMaxNeighbors(max_neighbors);
+  estimator.SetNRobustIterations(normal_robust_iterations);
+  estimator.SetOrientationMethod(normal_orientation_method);
+  if (normal_orientation_method == R3_NORMAL_VIEWPOINT_ORIENTATION) estimator.SetViewpoint(normal_viewpoint);
+  int count = estimator.Compute(normals);
+  if (count < 0) {
+    delete [] positions;
+    delete [] normals;
+    return 0;
+  }
+
+  // Assign vertex normals
+  for (int i = 0; i < mesh->NVertices(); i++) {
+    if (normals[i].IsZero()) continue;
+    mesh->SetVertexNormal(mesh->Vertex(i), normals[i]);
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Estimated normals ...\n");
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Normals = %d\n", count);
+    printf("  # Components = %d\n", estimator.NComponents());
+    fflush(stdout);
+  }
+
+  // Delete data
+  delete [] positions;
+  delete [] normals;
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+WriteSlices(R3Mesh *mesh, const char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Slice mesh with planes perpendicular to normal (default spacing gives 16 planes across the mesh)
+  R3MeshSlicer slicer;
+  if (!slicer.InsertMesh(mesh)) return 0;
+  R3Vector normal = slice_normal;
+  normal.Normalize();
+  RNLength spacing = slice_spacing;
+  if (spacing <= 0) {
+    RNScalar min_offset = FLT_MAX, max_offset = -FLT_MAX;
+    for (int i = 0; i < mesh->NVertices(); i++) {
+      RNScalar offset = normal.Dot(mesh->VertexPosition(mesh->Vertex(i)).Vector());
+      if (offset < min_offset) min_offset = offset;
+      if (offset > max_offset) max_offset = offset;
     }
-    else if (closest.type == R3_MESH_FACE_TYPE) {
-      R3Point b = source_mesh.FaceBarycentric(closest.face, position);
-      int k = b.Vector().MaxDimension();
-      R3MeshVertex *source_vertex = source_mesh.VertexOnFace(closest.face, k);
-      mesh->SetVertexColor(vertex, source_mesh.VertexColor(source_vertex));
+    spacing = (max_offset > min_offset) ? (max_offset - min_offset) / 16 : 1;
+  }
+  int ncontours = slicer.Slice(normal, spacing);
+  if (ncontours < 0) return 0;
+
+  // Open file
+  FILE *fp = fopen(filename, "w");
+  if (!fp) {
+    fprintf(stderr, "Unable to open slice file %s\n", filename);
+    return 0;
+  }
+
+  // Write contours of every plane
+  int nclosed = 0;
+  for (int i = 0; i < slicer.NPlanes(); i++) {
+    R3Plane plane = slicer.Plane(i);
+    fprintf(fp, "plane %d %g %g %g %g %d\n", i, plane.A(), plane.B(), plane.C(), plane.D(), slicer.NContours(i));
+    for (int j = 0; j < slicer.NContours(i); j++) {
+      R3MeshSliceContour *contour = slicer.Contour(i, j);
+      if (contour->IsClosed()) nclosed++;
+      fprintf(fp, "contour %d %d %d %g %d\n", j, contour->IsClosed(), contour->Parent(), contour->Area(), contour->NPoints());
+      for (int k = 0; k < contour->NPoints(); k++) {
+        const R3Point& position = contour->Position(k);
+        fprintf(fp, "%g %g %g\n", position.X(), position.Y(), position.Z());
+      }
     }
   }
 
+  // Close file
+  fclose(fp);
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Wrote slices to %s ...\n", filename);
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  Spacing = %g\n", spacing);
+    printf("  # Planes = %d\n", slicer.NPlanes());
+    printf("  # Contours = %d\n", ncontours);
+    printf("  # Closed Contours = %d\n", nclosed);
+    fflush(stdout);
+  }
+
   // Return success
   return 1;
 }
@@ -192,6 +481,26 @@ int ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-clean")) clean = 1;
       else if (!strcmp(*argv, "-smooth")) smooth = 1;
       else if (!strcmp(*argv, "-swap_edges")) swap_edges = 1;
+      else if (!strcmp(*argv, "-audit_intersections")) audit_intersections = 1;
+      else if (!strcmp(*argv, "-remove_intersections")) remove_intersections = 1;
+      else if (!strcmp(*argv, "-union")) { argv++; argc--; boolean_name = *argv; boolean_operation = R3_MESH_UNION_OPERATION; }
+      else if (!strcmp(*argv, "-intersect")) { argv++; argc--; boolean_name = *argv; boolean_operation = R3_MESH_INTERSECTION_OPERATION; }
+      else if (!strcmp(*argv, "-subtract")) { argv++; argc--; boolean_name = *argv; boolean_operation = R3_MESH_DIFFERENCE_OPERATION; }
+      else if (!strcmp(*argv, "-remesh")) { argv++; argc--; remesh = 1; remesh_edge_length = atof(*argv); }
+      else if (!strcmp(*argv, "-remesh_min_edge_length")) { argv++; argc--; remesh_min_edge_length = atof(*argv); }
+      else if (!strcmp(*argv, "-remesh_error")) { argv++; argc--; remesh_error = atof(*argv); }
+      else if (!strcmp(*argv, "-remesh_feature_angle")) { argv++; argc--; remesh_feature_angle = RN_PI*atof(*argv)/180.0; }
+      else if (!strcmp(*argv, "-remesh_iterations")) { argv++; argc--; remesh_iterations = atoi(*argv); }
+      else if (!strcmp(*argv, "-pm_base_faces")) { argv++; argc--; progressive_mesh_base_faces = atoi(*argv); }
+      else if (!strcmp(*argv, "-estimate_normals")) { argv++; argc--; normal_max_neighbors = atoi(*argv); }
+      else if (!strcmp(*argv, "-normal_robust_iterations")) { argv++; argc--; normal_robust_iterations = atoi(*argv); }
+      else if (!strcmp(*argv, "-normal_viewpoint")) {
+        argv++; argc--; normal_viewpoint[0] = atof(*argv);
+        argv++; argc--; normal_viewpoint[1] = atof(*argv);
+        argv++; argc--; normal_viewpoint[2] = atof(*argv);
+        normal_orientation_method = R3_NORMAL_VIEWPOINT_ORIENTATION;
+      }
+      else if (!strcmp(*argv, "-unoriented_normals")) normal_orientation_method = R3_NORMAL_NO_ORIENTATION;
       else if (!strcmp(*argv, "-scale_by_area")) scale_by_area = 1;
       else if (!strcmp(*argv, "-center_at_origin")) center_at_origin = 1;
       else if (!strcmp(*argv, "-align_by_pca")) align_by_pca = 1;
@@ -207,9 +516,23 @@ int ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-ry")) { argv++; argc--; xform = R3identity_affine; xform.YRotate(RN_PI*atof(*argv)/180.0); xform.Transform(prev_xform);}
       else if (!strcmp(*argv, "-rz")) { argv++; argc--; xform = R3identity_affine; xform.ZRotate(RN_PI*atof(*argv)/180.0); xform.Transform(prev_xform);}
       else if (!strcmp(*argv, "-xform")) { argv++; argc--; R4Matrix m;  if (ReadMatrix(m, *argv)) { xform = R3identity_affine; xform.Transform(R3Affine(m)); xform.Transform(prev_xform);} } 
+      else if (!strcmp(*argv, "-merge_coincident_vertices")) merge_coincident_vertices = 1;
+      else if (!strcmp(*argv, "-merge_epsilon")) { argv++; argc--; merge_epsilon = atof(*argv); }
       else if (!strcmp(*argv, "-min_edge_length")) { argv++; argc--; min_edge_length = atof(*argv); }
       else if (!strcmp(*argv, "-max_edge_length")) { argv++; argc--; max_edge_length = atof(*argv); }
       else if (!strcmp(*argv, "-color")) { argv++; argc--; color_name = *argv; }
+      else if (!strcmp(*argv, "-color_interpolate")) color_interpolate = 1;
+      else if (!strcmp(*argv, "-transfer")) { argv++; argc--; transfer_name = *argv; }
+      else if (!strcmp(*argv, "-transfer_max_distance")) { argv++; argc--; transfer_max_distance = atof(*argv); }
+      else if (!strcmp(*argv, "-transfer_max_normal_angle")) { argv++; argc--; transfer_max_normal_angle = RN_PI*atof(*argv)/180.0; }
+      else if (!strcmp(*argv, "-transfer_nearest_vertex")) transfer_nearest_vertex = 1;
+      else if (!strcmp(*argv, "-slice")) { argv++; argc--; slice_name = *argv; }
+      else if (!strcmp(*argv, "-slice_spacing")) { argv++; argc--; slice_spacing = atof(*argv); }
+      else if (!strcmp(*argv, "-slice_normal")) {
+        argv++; argc--; slice_normal[0] = atof(*argv);
+        argv++; argc--; slice_normal[1] = atof(*argv);
+        argv++; argc--; slice_normal[2] = atof(*argv);
+      }
       else { fprintf(stderr, "Invalid program argument: %s", *argv); exit(1); }
       argv++; argc--;
     }
@@ -280,6 +603,11 @@ int main(int argc, char **argv)
     mesh->Transform(xform);
   }
 
+  // Merge coincident vertices
+  if (merge_coincident_vertices) {
+    mesh->MergeCoincidentVertices(merge_epsilon);
+  }
+
   // Clean 
   if (clean) {
     mesh->DeleteUnusedEdges();
@@ -313,15 +641,51 @@ int main(int argc, char **argv)
     mesh->SwapEdges();
   }
 
+  // Remesh with target edge lengths (isotropic, or adaptive to curvature)
+  if (remesh) {
+    if (!RemeshMesh(mesh)) exit(-1);
+  }
+
+  // Find and remove self-intersections
+  if (audit_intersections || remove_intersections) {
+    if (!AuditIntersections(mesh, remove_intersections)) exit(-1);
+  }
+
+  // Combine with another closed mesh
+  if (boolean_name) {
+    R3Mesh *result = ComputeBoolean(mesh, boolean_name, boolean_operation);
+    if (!result) exit(-1);
+    delete mesh;
+    mesh = result;
+  }
+
   // Normalize translation, rotation, and scale
   if (align_by_pca) {
     R3Affine xf = mesh->PCANormalizationTransformation();
     mesh->Transform(xf);
   }
 
-  // Transfer colors
+  // Estimate vertex normals from neighborhoods of vertices (e.g., for point clouds)
+  if (normal_max_neighbors > 0) {
+    if (!EstimateNormals(mesh, normal_max_neighbors)) exit(-1);
+  }
+
+  // Transfer colors (from nearest vertex unless asked to interpolate)
   if (color_name) {
-    CopyColors(mesh, color_name);
+    int interpolation = (color_interpolate) ? R3_MESH_TRANSFER_BARYCENTRIC_INTERPOLATION : R3_MESH_TRANSFER_NEAREST_VERTEX_INTERPOLATION;
+    if (!TransferAttributes(mesh, color_name, R3_MESH_TRANSFER_COLORS, interpolation)) exit(-1);
+  }
+
+  // Transfer all vertex and face attributes
+  if (transfer_name) {
+    int attributes = R3_MESH_TRANSFER_VERTEX_ATTRIBUTES | R3_MESH_TRANSFER_FACE_ATTRIBUTES;
+    int interpolation = (transfer_nearest_vertex) ? R3_MESH_TRANSFER_NEAREST_VERTEX_INTERPOLATION : R3_MESH_TRANSFER_BARYCENTRIC_INTERPOLATION;
+    if (!TransferAttributes(mesh, transfer_name, attributes, interpolation)) exit(-1);
+  }
+
+  // Write contours of planar slices
+  if (slice_name) {
+    if (!WriteSlices(mesh, slice_name)) exit(-1);
   }
   
   // Write mesh
@@ -30,6 +30,9 @@ static char *input_mturk_segmentation_name = NULL;
 static char *input_mturk_annotation_name = NULL;
 static char *input_mturk_label_mapping_name = NULL;
 static char *input_map_name = NULL;
+static char *input_comparison_mesh_name = NULL;
+static int comparison_nsamples = 100000;
+static RNLength comparison_hausdorff_tolerance = 0;
 static int print_verbose = 0;
 static int print_debug = 0;
 
@@ -1713,6 +1716,81 @@ ComputeSolidTextureProperties(R3Mesh *mesh)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Mesh comparison properties
+////////////////////////////////////////////////////////////////////////
+
+static R3MeshPropertySet *
+ComputeComparisonProperties(R3Mesh *mesh, const char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+  if (print_verbose) {
+    printf("Computing comparison properties ...\n");
+    fflush(stdout);
+  }
+
+  // Read other mesh
+  R3Mesh *other_mesh = new R3Mesh();
+  if (!other_mesh->ReadFile(filename)) {
+    fprintf(stderr, "Unable to read mesh from %s\n", filename);
+    delete other_mesh;
+    return NULL;
+  }
+
+  // Compare meshes
+  R3MeshComparison comparison(mesh, other_mesh);
+  comparison.SetNSamples(comparison_nsamples);
+  comparison.SetHausdorffTolerance(comparison_hausdorff_tolerance);
+  if (!comparison.Compare()) {
+    delete other_mesh;
+    return NULL;
+  }
+
+  // Allocate property set
+  R3MeshPropertySet *properties = new R3MeshPropertySet(mesh);
+  if (!properties) {
+    fprintf(stderr, "Unable to allocate property set.\n");
+    delete other_mesh;
+    return NULL;
+  }
+
+  // Insert signed distances of vertices to other mesh
+  R3MeshProperty *distance = comparison.VertexDistanceProperty(0, "DistanceToMesh");
+  if (distance) InsertProperty(properties, distance);
+
+  // Print report
+  printf("Comparison with %s:\n", filename);
+  for (int k = 0; k < 2; k++) {
+    printf("  %s:\n", (k == 0) ? "Mesh to other mesh" : "Other mesh to mesh");
+    printf("    Hausdorff = %g (upper bound %g)\n", comparison.Hausdorff(k), comparison.HausdorffBound(k));
+    printf("    Mean = %g\n", comparison.Mean(k));
+    printf("    RMS = %g\n", comparison.RMS(k));
+    printf("    Percentiles (50/90/95/99) = %g %g %g %g\n", comparison.Percentile(k, 50),
+      comparison.Percentile(k, 90), comparison.Percentile(k, 95), comparison.Percentile(k, 99));
+  }
+  printf("  Symmetric Hausdorff = %g\n", comparison.SymmetricHausdorff());
+  fflush(stdout);
+
+  // Print statistics
+  if (print_verbose) {
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Samples = %d\n", comparison.NSamples());
+    printf("  # Refinement queries = %d %d\n", comparison.NRefinementQueries(0), comparison.NRefinementQueries(1));
+    printf("  # Properties = %d\n", properties->NProperties());
+    fflush(stdout);
+  }
+
+  // Delete other mesh
+  delete other_mesh;
+
+  // Return property set
+  return properties;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Property set composition 
 ////////////////////////////////////////////////////////////////////////
@@ -1835,6 +1913,14 @@ ComputeProperties(R3Mesh *mesh)
     delete solidtexture_properties;
   }
 
+  // Compute comparison properties
+  if (input_comparison_mesh_name) {
+    R3MeshPropertySet *comparison_properties = ComputeComparisonProperties(mesh, input_comparison_mesh_name);
+    if (!comparison_properties) return NULL;
+    properties->Insert(comparison_properties);
+    delete comparison_properties;
+  }
+
   // Return property set
   return properties;
 }
@@ -1866,6 +1952,9 @@ ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-raytrace")) { compute_raytrace_properties = 1; }
       else if (!strcmp(*argv, "-solidtexture")) { compute_solidtexture_properties = 1; }
       else if (!strcmp(*argv, "-map")) { argv++; argc--; input_map_name = *argv; }
+      else if (!strcmp(*argv, "-compare")) { argv++; argc--; input_comparison_mesh_name = *argv; }
+      else if (!strcmp(*argv, "-compare_samples")) { argv++; argc--; comparison_nsamples = atoi(*argv); }
+      else if (!strcmp(*argv, "-hausdorff_tolerance")) { argv++; argc--; comparison_hausdorff_tolerance = atof(*argv); }
       else if (!strcmp(*argv, "-mturk_semantic_segmentation")) {
         argv++; argc--; input_mturk_segmentation_name = *argv; 
         argv++; argc--; input_mturk_annotation_name = *argv;         
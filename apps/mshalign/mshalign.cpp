@@ -28,6 +28,14 @@ static int icp_rotation = 0;
 static int max_points = 256;
 static int sample_method = 0; // 0=surface, 1=edges, 2=vertices
 static int correspondence_method = 0; // 0=points, 1=surface
+static int icp_objective = R3_ICP_POINT_TO_POINT_OBJECTIVE;
+static int icp_kernel = R3_ICP_NO_KERNEL;
+static RNScalar icp_kernel_parameter = 0;
+static int icp_levels = 1;
+static int icp_max_iterations = 128;
+static RNScalar icp_tolerance = 1.0E-6;
+static char *batch_name = NULL;
+static int nthreads = 0;
 static int print_verbose = 0;
 static int print_debug = 0;
 
@@ -90,8 +98,19 @@ ReadWeights(const char *filename, RNScalar *& weights, int& nweights)
 
 
 
+static RNScalar
+SampleRandomScalar(unsigned long long& state)
+{
+  // Return random number in [0,1) from a local generator (so that sampling neither
+  // depends on nor reseeds the global one used by ransac)
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (RNScalar) (state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+
 static int
-CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, int max_points, int sample_method)
+CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, R3Vector *normals, int max_points, int sample_method)
 {
   // Start statistics
   RNTime start_time;
@@ -103,6 +122,9 @@ CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, int
   // Check maximum number of points
   if (max_points <= 0) return 0;
 
+  // Initialize random number generator (the same points are sampled every time)
+  unsigned long long random_state = 0x853C49E6748FEA9BULL;
+
   // Check sample method
   if (sample_method == 0) { 
     // Sample faces
@@ -127,7 +149,6 @@ CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, int
     }
 
     // Generate points with a uniform distribution over surface area
-    RNSeedRandomScalar();
     for (int i = 0; i < mesh->NFaces(); i++) {
       R3MeshFace *face = mesh->Face(i);
 
@@ -143,15 +164,16 @@ CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, int
       RNScalar ideal_face_npoints = max_points * mesh->FaceValue(face) / total_area;
       int face_npoints = (int) ideal_face_npoints;
       RNScalar remainder = ideal_face_npoints - face_npoints;
-      if (remainder > RNRandomScalar()) face_npoints++;
+      if (remainder > SampleRandomScalar(random_state)) face_npoints++;
 
       // Generate random points in face
       for (int j = 0; j < face_npoints; j++) {
-        RNScalar r1 = sqrt(RNRandomScalar());
-        RNScalar r2 = RNRandomScalar();
+        RNScalar r1 = sqrt(SampleRandomScalar(random_state));
+        RNScalar r2 = SampleRandomScalar(random_state);
         RNScalar t0 = (1.0 - r1);
         RNScalar t1 = r1 * (1.0 - r2);
         RNScalar t2 = r1 * r2;
+        normals[npoints] = mesh->FaceNormal(face);
         points[npoints++] = t0*p0 + t1*p1 + t2*p2;
         if (npoints >= max_points) break;
       }
@@ -184,7 +206,6 @@ CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, int
     }
     
     // Generate points with a uniform distribution over edge length
-    RNSeedRandomScalar();
     for (int i = 0; i < mesh->NEdges(); i++) {
       R3MeshEdge *edge = mesh->Edge(i);
       if ((nweights > i) && (weights[i] < min_weight)) continue;
@@ -194,16 +215,16 @@ CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, int
       R3MeshVertex *v1 = mesh->VertexOnEdge(edge, 1);
       const R3Point& p0 = mesh->VertexPosition(v0);
       const R3Point& p1 = mesh->VertexPosition(v1);
-
-      // Determine number of points for edge 
+      R3Vector normal = mesh->EdgeNormal(edge);
       RNScalar ideal_edge_npoints = max_points * mesh->EdgeValue(edge) / total_length;
       int edge_npoints = (int) ideal_edge_npoints;
       RNScalar remainder = ideal_edge_npoints - edge_npoints;
-      if (remainder > RNRandomScalar()) edge_npoints++;
+      if (remainder > SampleRandomScalar(random_state)) edge_npoints++;
 
       // Generate random points in edge
       for (int j = 0; j < edge_npoints; j++) {
-        RNScalar t = RNRandomScalar();
+        RNScalar t = SampleRandomScalar(random_state);
+        normals[npoints] = normal;
         points[npoints++] = t*p0 + (1-t)*p1;
         if (npoints >= max_points) break;
       }
@@ -219,6 +240,7 @@ CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, int
     if (max_points > mesh->NVertices()) {
       for (int i = 0; i < mesh->NVertices(); i++) {
         R3MeshVertex *vertex = mesh->Vertex(i);
+        normals[npoints] = mesh->VertexNormal(vertex);
         points[npoints++] = mesh->VertexPosition(vertex);
       }
     }
@@ -251,19 +273,20 @@ CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, int
       }
 
       // Generate points with probability related to vertex weights/areas
-      RNSeedRandomScalar();
       for (int i = 0; i < mesh->NVertices(); i++) {
         R3MeshVertex *vertex = mesh->Vertex(i);
         const R3Point& position = mesh->VertexPosition(vertex);
+        const R3Vector& normal = mesh->VertexNormal(vertex);
 
         // Determine number of points for vertex
         RNScalar ideal_vertex_npoints = max_points * mesh->VertexValue(vertex) / total_weight;
         int vertex_npoints = (int) ideal_vertex_npoints;
         RNScalar remainder = ideal_vertex_npoints - vertex_npoints;
-        if (remainder > RNRandomScalar()) vertex_npoints++;
+        if (remainder > SampleRandomScalar(random_state)) vertex_npoints++;
 
         // Generate points at vertex
         for (int j = 0; j < vertex_npoints; j++) {
+          normals[npoints] = normal;
           points[npoints++] = position;
           if (npoints >= max_points) break;
         }
@@ -274,6 +297,14 @@ CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, int
     }
   }
 
+  // Shuffle points, so that any prefix is a uniform subsample (for coarse-to-fine ICP)
+  for (int i = npoints-1; i > 0; i--) {
+    int j = (int) (SampleRandomScalar(random_state) * (i+1));
+    if (j > i) j = i;
+    R3Point p = points[i]; points[i] = points[j]; points[j] = p;
+    R3Vector n = normals[i]; normals[i] = normals[j]; normals[j] = n;
+  }
+
 #if 0
   if (1) {
     static int file_count = 1;
@@ -305,261 +336,79 @@ CreatePoints(R3Mesh *mesh, RNScalar *weights, int nweights, R3Point *points, int
 
 
 
-static int
-CreatePointPointCorrespondences(
-  R3Mesh *mesh1, const R3Point *points1, int npoints1,
-  R3Mesh *mesh2, const R3Point *points2, int npoints2, 
-  const R3Affine& affine12, const R3Affine& affine21,
-  R3Point *correspondences1, R3Point *correspondences2, 
-  int max_correspondences)
-{
-  // Build kdtree for points1
-  static R3Kdtree<const R3Point *> *tree1 = NULL;
-  if (!tree1) {
-    RNArray<const R3Point *> array1;
-    for (int i = 0; i < npoints1; i++) array1.Insert(&points1[i]);
-    tree1 = new R3Kdtree<const R3Point *>(array1);
-  }
-
-  // Build kdtree for points2
-  static R3Kdtree<const R3Point *> *tree2 = NULL;
-  if (!tree2) {
-    RNArray<const R3Point *> array2;
-    for (int i = 0; i < npoints2; i++) array2.Insert(&points2[i]);
-    tree2 = new R3Kdtree<const R3Point *>(array2);
-  }
-
-  // Initialize number of correspondences
-  assert(max_correspondences == npoints1 + npoints2);
-  int ncorrespondences = 0;
-
-  // Compute correspondences for points1 -> mesh2
-  for (int i = 0; i < npoints1; i++) {
-    R3Point position1 = points1[i];
-    position1.Transform(affine12);
-    const R3Point *closest = tree2->FindClosest(position1);
-    assert(ncorrespondences < max_correspondences);
-    correspondences1[ncorrespondences] = points1[i];
-    correspondences2[ncorrespondences] = *closest;
-    ncorrespondences++;
-  }
-
-  // Compute correspondences for points2 -> mesh1
-  for (int i = 0; i < npoints2; i++) {
-    R3Point position2 = points2[i];
-    position2.Transform(affine21);
-    const R3Point *closest = tree1->FindClosest(position2);
-    assert(ncorrespondences < max_correspondences);
-    correspondences1[ncorrespondences] = *closest;
-    correspondences2[ncorrespondences] = points2[i];
-    ncorrespondences++;
-  }
-
-  // Return number of correspondences
-  assert(ncorrespondences == npoints1 + npoints2);
-  assert(ncorrespondences == max_correspondences);
-  return ncorrespondences;
-}
+struct MeshSamples {
+  R3Mesh *mesh;
+  R3Point centroid;
+  RNScalar radius;
+  R3Triad axes;
+  R3Point *points;
+  R3Vector *normals;
+  int npoints;
+};
 
 
 
 static int
-CreatePointSurfaceCorrespondences(
-  R3Mesh *mesh1, const R3Point *points1, int npoints1,
-  R3Mesh *mesh2, const R3Point *points2, int npoints2, 
-  const R3Affine& affine12, const R3Affine& affine21,
-  R3Point *correspondences1, R3Point *correspondences2, 
-  int max_correspondences)
+CreateSamples(R3Mesh *mesh, RNScalar *weights, int nweights, MeshSamples& samples)
 {
-  // Initialize number of correspondences
-  assert(max_correspondences == npoints1 + npoints2);
-  int ncorrespondences = 0;
-
-  // Compute correspondences for points1 -> mesh2
-  static R3MeshSearchTree *tree2 = NULL;
-  if (!tree2) tree2 = new R3MeshSearchTree(mesh2);
-  else assert(mesh2 == tree2->mesh);
-  for (int i = 0; i < npoints1; i++) {
-    R3Point position1 = points1[i];
-    position1.Transform(affine12);
-    R3MeshIntersection closest;
-    tree2->FindClosest(position1, closest);
-    assert(ncorrespondences < max_correspondences);
-    correspondences1[ncorrespondences] = points1[i];
-    correspondences2[ncorrespondences] = closest.point;
-    ncorrespondences++;
-  }
-
-  // Compute correspondences for points2 -> mesh1
-  static R3MeshSearchTree *tree1 = NULL;
-  if (!tree1) tree1 = new R3MeshSearchTree(mesh1);
-  else assert(mesh1 == tree1->mesh);
-  for (int i = 0; i < npoints2; i++) {
-    R3Point position2 = points2[i];
-    position2.Transform(affine21);
-    R3MeshIntersection closest;
-    tree1->FindClosest(position2, closest);
-    assert(ncorrespondences < max_correspondences);
-    correspondences1[ncorrespondences] = closest.point;
-    correspondences2[ncorrespondences] = points2[i];
-    ncorrespondences++;
-  }
-
-  // Return number of correspondences
-  assert(ncorrespondences == npoints1 + npoints2);
-  assert(ncorrespondences == max_correspondences);
-  return ncorrespondences;
-}
-
-
-
-static int
-CreatePointCorrespondences(
-  R3Mesh *mesh1, const R3Point *points1, int npoints1,
-  R3Mesh *mesh2, const R3Point *points2, int npoints2, 
-  const R3Affine& affine12, const R3Affine& affine21,
-  R3Point *correspondences1, R3Point *correspondences2, 
-  int max_correspondences)
-{
-  // Check method
-  if (correspondence_method == 0) {
-    return CreatePointPointCorrespondences(
-      mesh1, points1, npoints1, 
-      mesh2, points2, npoints2, 
-      affine12, affine21, 
-      correspondences1, correspondences2, max_correspondences);
-  }
-  else {
-    return CreatePointSurfaceCorrespondences(
-      mesh1, points1, npoints1, 
-      mesh2, points2, npoints2, 
-      affine12, affine21, 
-      correspondences1, correspondences2, max_correspondences);
-  }
-}
-
-
-static RNScalar 
-RMSD(R3Mesh *mesh1, const R3Point *points1, int npoints1,
-     R3Mesh *mesh2, const R3Point *points2, int npoints2, 
-     const R3Affine& affine12, const R3Affine& affine21)
-{
-  // Check number of points
-  if (npoints1 == 0) return RN_INFINITY;
-  if (npoints2 == 0) return RN_INFINITY;
-
-  // Create array of correspondences
-  int max_correspondences = npoints1 + npoints2;
-  R3Point *correspondences1 = new R3Point [ max_correspondences ];
-  R3Point *correspondences2 = new R3Point [ max_correspondences ];
-  int ncorrespondences = CreatePointCorrespondences(
-    mesh1, points1, npoints1, 
-    mesh2, points2, npoints2, 
-    affine12, affine21,
-    correspondences1, correspondences2, 
-    max_correspondences);
-
-  // Add SSD of correspondences
-  RNScalar ssd = 0;
-  for (int i = 0; i < ncorrespondences; i++) {
-    R3Point position1 = correspondences1[i];
-    position1.Transform(affine12);
-    R3Point& position2 = correspondences2[i];
-    RNScalar d = R3Distance(position1, position2);
-    ssd += d * d;
+  // Compute shape info
+  samples.mesh = mesh;
+  samples.centroid = mesh->Centroid();
+  samples.radius = mesh->AverageRadius(&samples.centroid);
+  samples.axes = (pca_rotation == 1) ? mesh->PrincipleAxes(&samples.centroid) : R3xyz_triad;
+
+  // Create points
+  samples.points = new R3Point [ max_points ];
+  samples.normals = new R3Vector [ max_points ];
+  samples.npoints = CreatePoints(mesh, weights, nweights, samples.points, samples.normals, max_points, sample_method);
+
+  // Check samples
+  if ((samples.npoints == 0) || (pca_scale && (samples.radius == 0))) {
+    delete [] samples.points;
+    delete [] samples.normals;
+    samples.points = NULL;
+    samples.normals = NULL;
+    samples.npoints = 0;
+    return 0;
   }
 
-  // Compute the RMSD
-  RNScalar rmsd = sqrt(ssd / ncorrespondences);
-
-  // Delete arrays of correspondences
-  delete [] correspondences1;
-  delete [] correspondences2;
-
-  // Return RMSD
-  return rmsd;
+  // Return success
+  return 1;
 }
 
 
 
-static int
-ICPAlignmentTransformation(
-  R3Mesh *mesh1, const R3Point *points1, int npoints1,
-  R3Mesh *mesh2, const R3Point *points2, int npoints2, 
-  R3Affine& affine12, R3Affine& affine21,
-  int translation, int rotation, int scale)
+static void
+DeleteSamples(MeshSamples& samples)
 {
-  // Start statistics
-  RNTime start_time;
-  start_time.Read();
-
-  // Allocate arrays of correspondences
-  int ncorrespondences = npoints1 + npoints2;
-  R3Point *correspondences_buffer1 = new R3Point [2 * ncorrespondences];
-  R3Point *correspondences_buffer2 = new R3Point [2 * ncorrespondences];
-  assert(correspondences_buffer1 && correspondences_buffer2);
-
-  // Iterate until max_iterations or converged
-  RNBoolean converged = FALSE;
-  const int max_iterations = 128;
-  for (int iteration = 0; iteration < max_iterations; iteration++) {
-    // Get arrays of correspondences
-    R3Point *correspondences1 = &correspondences_buffer1[iteration%2 * ncorrespondences];
-    R3Point *correspondences2 = &correspondences_buffer2[iteration%2 * ncorrespondences];
-
-    // Update correspondences for aligning transformation
-    CreatePointCorrespondences(
-      mesh1, points1, npoints1, 
-      mesh2, points2, npoints2, 
-      affine12, affine21, 
-      correspondences1, correspondences2, 
-      ncorrespondences);
-
-    // Update aligning transformation for correspondences
-    R4Matrix matrix = R3AlignPoints(ncorrespondences, correspondences2, correspondences1, 
-      NULL, translation, rotation, scale);
-    affine12.Reset(matrix);
-    affine21 = affine12.Inverse();
-
-    // Check for convergence
-    converged = FALSE;
-    if (iteration > 0) {
-      converged = TRUE;
-      R3Point *prev_correspondences1 = &correspondences_buffer1[(1-(iteration%2)) * ncorrespondences];
-      R3Point *prev_correspondences2 = &correspondences_buffer2[(1-(iteration%2)) * ncorrespondences];
-      for (int i = 0; i < ncorrespondences; i++) {
-        if (!R3Contains(correspondences1[i], prev_correspondences1[i])) { converged = FALSE; break; }
-        if (!R3Contains(correspondences2[i], prev_correspondences2[i])) { converged = FALSE; break; }
-      }
-    }
-    if (converged) break;
-  }
-
-  // Return whether converged
-  return converged;
+  // Delete points
+  if (samples.points) delete [] samples.points;
+  if (samples.normals) delete [] samples.normals;
+  samples.points = NULL;
+  samples.normals = NULL;
+  samples.npoints = 0;
 }
 
 
 
 static int
 RansacAlignmentTransformation(
-  R3Mesh *mesh1, const R3Point *points1, int npoints1,
-  R3Mesh *mesh2, const R3Point *points2, int npoints2, 
-  R3Affine& affine12, R3Affine& affine21,
-  int translation, int rotation, int scale,
+  R3ICPAligner& aligner, const MeshSamples& samples1, const MeshSamples& samples2,
+  R3Affine& affine12, int translation, int rotation, int scale,
   RNLength support_sigma = 0, int max_iterations = 0)
 {
+  // Get convenient variables
+  const R3Point *points1 = samples1.points;
+  const R3Point *points2 = samples2.points;
+  int npoints1 = samples1.npoints;
+  int npoints2 = samples2.npoints;
+
   // Check number of points
   if (npoints1 < 3) return 0;
   if (npoints2 < 3) return 0;
 
-  // Start statistics
-  RNTime start_time;
-  start_time.Read();
-
   // Initialize result
   affine12 = R3identity_affine;
-  affine21 = R3identity_affine;
 
   // Create temporary memory
   int max_correspondences = npoints1 + npoints2;
@@ -568,12 +417,14 @@ RansacAlignmentTransformation(
 
   // Compute useful variables
   if (max_iterations == 0) max_iterations = 0.1 * npoints1 * npoints2; // should be n^3
-  if (support_sigma <= 0) support_sigma = 0.5 * mesh1->AverageRadius();
+  if (support_sigma <= 0) support_sigma = 0.5 * samples1.radius;
   RNScalar support_factor = -1.0 / (2 * support_sigma * support_sigma);
 
   // Generate random alignments and keep the one with best support
   RNScalar best_support = 0;
   R3Affine best_affine21 = R3identity_affine;
+  RNArray<R3Point *> triplet1; 
+  RNArray<R3Point *> triplet2;
   for (int iteration = 0; iteration < max_iterations; iteration++) {
     int a1, b1, c1, a2, b2, c2;
     a1 = (int) (RNRandomScalar() * npoints1); 
@@ -584,12 +435,10 @@ RansacAlignmentTransformation(
     do { c2 = (int) (RNRandomScalar() * npoints2); } while ((c2 == a2) || (c2 == b2));
 
     // Create triplets of points
-    static RNArray<R3Point *> triplet1; 
     triplet1.Empty();
     triplet1.Insert((R3Point *) &points1[a1]);
     triplet1.Insert((R3Point *) &points1[b1]);
     triplet1.Insert((R3Point *) &points1[c1]);
-    static RNArray<R3Point *> triplet2;
     triplet2.Empty();
     triplet2.Insert((R3Point *) &points2[a2]);
     triplet2.Insert((R3Point *) &points2[b2]);
@@ -601,8 +450,7 @@ RansacAlignmentTransformation(
     R3Affine aff12 = aff21.Inverse();
 
     // Compute correspondences
-    int ncorrespondences = CreatePointCorrespondences(mesh1, points1, npoints1, mesh2, points2, npoints2, 
-      aff12, aff21, correspondences1, correspondences2, max_correspondences);
+    int ncorrespondences = aligner.CreateCorrespondences(aff12, correspondences1, correspondences2);
 
     // Compute support
     RNScalar support = 0;
@@ -622,8 +470,7 @@ RansacAlignmentTransformation(
     }
   }
 
-  // Assign results
-  affine21 = best_affine21;
+  // Assign result
   affine12 = best_affine21.Inverse();
   
   // Delete temporary data
@@ -637,49 +484,50 @@ RansacAlignmentTransformation(
 
 
 static int
-Align(R3Mesh *mesh1, R3Mesh *mesh2, 
-  RNScalar *weights1, int nweights1, RNScalar *weights2, int nweights2,
-  int pca_translation, int pca_rotation, int pca_scale, 
-  int ransac_translation, int ransac_rotation, int ransac_scale, 
-  int icp_translation, int icp_rotation, int icp_scale,
-  int sample_method)
+Align(const MeshSamples& samples1, const MeshSamples& samples2, 
+  R3Affine& affine12, RNScalar& rmsd, RNBoolean& converged, int nthreads)
 {
   // Start statistics
   RNTime start_time;
   start_time.Read();
 
   // Initialize transformation
-  R3Affine affine12(R3identity_affine);
-  R3Affine affine21(R3identity_affine);
-  RNBoolean converged = TRUE;
-  RNScalar rmsd = FLT_MAX;
+  affine12 = R3identity_affine;
+  converged = TRUE;
+  rmsd = FLT_MAX;
+
+  // Create aligner (owns search structures for this pair only)
+  R3ICPAligner aligner(samples1.npoints, samples1.points, samples1.normals,
+    samples2.npoints, samples2.points, samples2.normals);
+  aligner.SetObjective(icp_objective);
+  aligner.SetKernel(icp_kernel, icp_kernel_parameter);
+  aligner.SetNLevels(icp_levels);
+  aligner.SetMaxIterations(icp_max_iterations);
+  aligner.SetConvergenceTolerance(icp_tolerance);
+  aligner.SetNThreads(nthreads);
+
+  // Create mesh search trees for surface correspondences
+  R3MeshSearchTree *tree1 = NULL;
+  R3MeshSearchTree *tree2 = NULL;
+  if (correspondence_method == 1) {
+    tree1 = new R3MeshSearchTree(samples1.mesh);
+    tree2 = new R3MeshSearchTree(samples2.mesh);
+    aligner.SetSearchTrees(tree1, tree2);
+  }
 
   // Compute info for mesh1
-  R3Point centroid1 = mesh1->Centroid();
-  RNScalar radius1 = (pca_scale) ? mesh1->AverageRadius(&centroid1) : 1;
-  RNScalar scale1 = (pca_scale && (radius1 > 0)) ? 1.0 / radius1 : 1;
-  R3Triad axes1 = (pca_rotation==1) ? mesh1->PrincipleAxes(&centroid1) : R3xyz_triad;
-  R3Point *points1 = new R3Point [ max_points ];
-  int npoints1 = CreatePoints(mesh1, weights1, nweights1, points1, max_points, sample_method);
-  if ((scale1 == 0) || (npoints1 == 0)) {
-    fprintf(stderr, "Unable to process first mesh\n");
-    return 0;
-  }
+  const R3Point& centroid1 = samples1.centroid;
+  RNScalar scale1 = (pca_scale) ? 1.0 / samples1.radius : 1;
+  const R3Triad& axes1 = samples1.axes;
 
   // Compute info for mesh2
-  R3Point centroid2 = mesh2->Centroid();
-  RNScalar scale2 = (pca_scale) ? mesh2->AverageRadius(&centroid2) : 1;
-  R3Triad axes2 = (pca_rotation == 1) ? mesh2->PrincipleAxes(&centroid2) : R3xyz_triad;
+  const R3Point& centroid2 = samples2.centroid;
+  RNScalar scale2 = (pca_scale) ? samples2.radius : 1;
+  const R3Triad& axes2 = samples2.axes;
   R3Affine affine02 = R3identity_affine;
   if (pca_translation) affine02.Translate(centroid2.Vector());
   if (pca_rotation==1) affine02.Transform(axes2.Matrix());
   if (pca_scale) affine02.Scale(scale2);
-  R3Point *points2 = new R3Point [ max_points ];
-  int npoints2 = CreatePoints(mesh2, weights2, nweights2, points2, max_points, sample_method);
-  if ((scale2 == 0) || (npoints2 == 0)) {
-    fprintf(stderr, "Unable to process second mesh\n");
-    return 0;
-  }
 
   // Compute RMSD for alignment with all flips of principle axes
   if (pca_rotation) {
@@ -700,31 +548,23 @@ Align(R3Mesh *mesh1, R3Mesh *mesh2,
             affine10.Transform(triad1.InverseMatrix());
             if (pca_translation) affine10.Translate(-centroid1.Vector());
 
-            // Compute composite transformation and its inverse
+            // Compute composite transformation
             R3Affine flipped_affine12 = affine02;
             flipped_affine12.Transform(affine10);
-            R3Affine flipped_affine21 = flipped_affine12.Inverse();
 
             // Refine alignment with ICP
             RNBoolean flipped_converged = FALSE;
             if (icp_translation || icp_rotation || icp_scale) {
-              flipped_converged = ICPAlignmentTransformation(
-                mesh1, points1, npoints1, 
-                mesh2, points2, npoints2, 
-                flipped_affine12, flipped_affine21, 
+              flipped_converged = aligner.Align(flipped_affine12,
                 icp_translation, icp_rotation, icp_scale);
             }
 
             // Compute RMSD for transformation
-            RNScalar flipped_rmsd = RMSD(
-              mesh1, points1, npoints1, 
-              mesh2, points2, npoints2, 
-              flipped_affine12, flipped_affine21);
+            RNScalar flipped_rmsd = aligner.RMSD(flipped_affine12);
 
             // Check if best so far -- if so, save
             if (flipped_rmsd < rmsd) {
               affine12 = flipped_affine12;
-              affine21 = flipped_affine21;
               converged = flipped_converged;
               rmsd = flipped_rmsd;
             }
@@ -740,6 +580,7 @@ Align(R3Mesh *mesh1, R3Mesh *mesh2,
               printf("  Matrix[2][0-3] = %g %g %g %g\n", m[2][0], m[2][1], m[2][2], m[2][3]);
               printf("  Matrix[3][0-3] = %g %g %g %g\n", m[3][0], m[3][1], m[3][2], m[3][3]);
               printf("  Scale = %g\n", flipped_affine12.ScaleFactor());
+              printf("  Iterations = %d\n", aligner.NIterations());
               printf("  Converged = %d\n", flipped_converged);
               printf("  RMSD = %g\n", flipped_rmsd);
               fflush(stdout);
@@ -758,60 +599,89 @@ Align(R3Mesh *mesh1, R3Mesh *mesh2,
     // Compute composite transformation
     affine12 = affine02;
     affine12.Transform(affine10);
-    affine21 = affine12.Inverse();
 
     // Refine alignment with ICP
     if (icp_translation || icp_rotation || icp_scale) {
-      converged = ICPAlignmentTransformation(
-        mesh1, points1, npoints1, 
-        mesh2, points2, npoints2, 
-        affine12, affine21,
+      converged = aligner.Align(affine12,
         icp_translation, icp_rotation, icp_scale);
     }
 
     // Compute RMSD
-    rmsd = RMSD(
-      mesh1, points1, npoints1, 
-      mesh2, points2, npoints2, 
-      affine12, affine21);
+    rmsd = aligner.RMSD(affine12);
   }
 
   // Consider ransac alignment
   if (ransac_translation || ransac_rotation || ransac_scale) {
     // Compute alignment with ransac 
     R3Affine ransac_affine12(R3identity_affine);
-    R3Affine ransac_affine21(R3identity_affine);
-    if (!RansacAlignmentTransformation(
-      mesh1, points1, npoints1, 
-      mesh2, points2, npoints2, 
-      ransac_affine12, ransac_affine21,
+    if (!RansacAlignmentTransformation(aligner, samples1, samples2, ransac_affine12,
       ransac_translation, ransac_rotation, ransac_scale)) {
+      if (tree1) delete tree1;
+      if (tree2) delete tree2;
       return 0;
     }
 
     // Refine alignment with ICP
+    RNBoolean ransac_converged = TRUE;
     if (icp_translation || icp_rotation || icp_scale) {
-      converged = ICPAlignmentTransformation(
-        mesh1, points1, npoints1, 
-        mesh2, points2, npoints2, 
-        ransac_affine12, ransac_affine21,
+      ransac_converged = aligner.Align(ransac_affine12,
         icp_translation, icp_rotation, icp_scale);
     }
 
     // Compute RMSD
-    RNScalar ransac_rmsd = RMSD(
-      mesh1, points1, npoints1, 
-      mesh2, points2, npoints2, 
-      ransac_affine12, ransac_affine21);
+    RNScalar ransac_rmsd = aligner.RMSD(ransac_affine12);
 
     // Check if best so far
     if (ransac_rmsd < rmsd) {
       affine12 = ransac_affine12;
-      affine21 = ransac_affine21;
+      converged = ransac_converged;
       rmsd = ransac_rmsd;
     }
   }
 
+  // Delete mesh search trees
+  if (tree1) delete tree1;
+  if (tree2) delete tree2;
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+Align(R3Mesh *mesh1, R3Mesh *mesh2, 
+  RNScalar *weights1, int nweights1, RNScalar *weights2, int nweights2)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Create samples for mesh1
+  MeshSamples samples1;
+  if (!CreateSamples(mesh1, weights1, nweights1, samples1)) {
+    fprintf(stderr, "Unable to process first mesh\n");
+    return 0;
+  }
+
+  // Create samples for mesh2
+  MeshSamples samples2;
+  if (!CreateSamples(mesh2, weights2, nweights2, samples2)) {
+    fprintf(stderr, "Unable to process second mesh\n");
+    DeleteSamples(samples1);
+    return 0;
+  }
+
+  // Compute alignment transformation
+  R3Affine affine12 = R3identity_affine;
+  RNScalar rmsd = FLT_MAX;
+  RNBoolean converged = FALSE;
+  if (!Align(samples1, samples2, affine12, rmsd, converged, nthreads)) {
+    DeleteSamples(samples1);
+    DeleteSamples(samples2);
+    return 0;
+  }
+
   // Apply transformation
   mesh1->Transform(affine12);
 
@@ -830,6 +700,10 @@ Align(R3Mesh *mesh1, R3Mesh *mesh2,
     fflush(stdout);
   }
 
+  // Delete samples
+  DeleteSamples(samples1);
+  DeleteSamples(samples2);
+
   // Return success
   return 1;
 }
@@ -930,12 +804,232 @@ WriteMesh(R3Mesh *mesh, const char *filename)
 }
 
 
+struct BatchEntry {
+  char input_name[1024];
+  char output_name[1024];
+  MeshSamples samples;
+};
+
+struct BatchPair {
+  int index1;
+  int index2;
+  R3Affine affine12;
+  RNScalar rmsd;
+  RNBoolean converged;
+  int status;
+};
+
+struct BatchData {
+  BatchEntry *entries;
+  MeshSamples *reference;
+  BatchPair *pairs;
+  int nthreads;
+};
+
+
+
+static int
+ReadBatchList(const char *filename, RNArray<BatchEntry *>& entries)
+{
+  // Open file
+  FILE *fp = fopen(filename, "r");
+  if (!fp) {
+    fprintf(stderr, "Unable to open batch list file %s\n", filename);
+    return 0;
+  }
+
+  // Read entries (each line has input filename and optional output filename)
+  char buffer[4096];
+  while (fgets(buffer, 4096, fp)) {
+    char input_name[1024], output_name[1024];
+    int nnames = sscanf(buffer, "%1023s%1023s", input_name, output_name);
+    if ((nnames < 1) || (input_name[0] == '#')) continue;
+    BatchEntry *entry = new BatchEntry();
+    strcpy(entry->input_name, input_name);
+    if (nnames > 1) strcpy(entry->output_name, output_name);
+    else entry->output_name[0] = '\0';
+    entries.Insert(entry);
+  }
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
+static void
+DeleteBatchEntries(BatchEntry *entries, int nentries)
+{
+  // Delete samples and meshes of entries
+  for (int i = 0; i < nentries; i++) {
+    if (entries[i].samples.mesh) delete entries[i].samples.mesh;
+    DeleteSamples(entries[i].samples);
+  }
+}
+
+
+
+static void
+AlignBatchPair(int index, int, void *data)
+{
+  // Get pair
+  BatchData *batch = (BatchData *) data;
+  BatchPair *pair = &batch->pairs[index];
+  const MeshSamples& samples1 = batch->entries[pair->index1].samples;
+  const MeshSamples& samples2 = (pair->index2 < 0) ? *(batch->reference) : batch->entries[pair->index2].samples;
+
+  // Compute alignment transformation
+  pair->status = Align(samples1, samples2, pair->affine12, pair->rmsd, pair->converged, batch->nthreads);
+}
+
+
+
+static int
+AlignBatch(const char *list_name, const char *reference_name)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Read list of inputs
+  RNArray<BatchEntry *> list;
+  if (!ReadBatchList(list_name, list)) return 0;
+  int nentries = list.NEntries();
+  if (nentries == 0) {
+    fprintf(stderr, "No inputs in batch list file %s\n", list_name);
+    return 0;
+  }
+
+  // Meshes are needed during alignment only for surface correspondences
+  RNBoolean keep_meshes = (correspondence_method == 1);
+
+  // Read reference and create its samples
+  R3Mesh *reference_mesh = NULL;
+  MeshSamples reference;
+  if (reference_name) {
+    reference_mesh = ReadMesh(reference_name);
+    if (!reference_mesh || !CreateSamples(reference_mesh, NULL, 0, reference)) {
+      if (reference_mesh) fprintf(stderr, "Unable to process reference mesh %s\n", reference_name);
+      for (int i = 0; i < nentries; i++) delete list[i];
+      if (reference_mesh) delete reference_mesh;
+      return 0;
+    }
+  }
+
+  // Read inputs and create their samples (serially, since mesh reading and sampling are not thread-safe)
+  BatchEntry *entries = new BatchEntry [ nentries ];
+  int nsampled = 0;
+  for (int i = 0; i < nentries; i++) {
+    entries[i] = *(list[i]);
+    R3Mesh *mesh = ReadMesh(entries[i].input_name);
+    if (!mesh) break;
+    if (!CreateSamples(mesh, NULL, 0, entries[i].samples)) {
+      fprintf(stderr, "Unable to process mesh %s\n", entries[i].input_name);
+      delete mesh;
+      break;
+    }
+    if (!keep_meshes) { delete mesh; entries[i].samples.mesh = NULL; }
+    nsampled++;
+  }
+
+  // Delete list
+  for (int i = 0; i < nentries; i++) delete list[i];
+
+  // Check whether all inputs were sampled
+  if (nsampled < nentries) {
+    DeleteBatchEntries(entries, nsampled);
+    if (reference_mesh) {
+      DeleteSamples(reference);
+      delete reference_mesh;
+    }
+    delete [] entries;
+    return 0;
+  }
+
+  // Create pairs (each input against reference, or all pairs of inputs)
+  int npairs = (reference_name) ? nentries : nentries * (nentries - 1) / 2;
+  BatchPair *pairs = new BatchPair [ npairs ];
+  int k = 0;
+  for (int i = 0; i < nentries; i++) {
+    if (reference_name) { pairs[k].index1 = i; pairs[k].index2 = -1; k++; }
+    else { for (int j = i+1; j < nentries; j++) { pairs[k].index1 = i; pairs[k].index2 = j; k++; } }
+  }
+
+  // Align pairs in parallel (ransac and mesh search trees are not thread-safe, so run those serially)
+  BatchData data;
+  data.entries = entries;
+  data.reference = &reference;
+  data.pairs = pairs;
+  RNBoolean serial = keep_meshes || ransac_translation || ransac_rotation || ransac_scale;
+  int pair_nthreads = (serial) ? 1 : nthreads;
+  data.nthreads = (serial) ? nthreads : 1;
+  RNParallelFor(npairs, AlignBatchPair, &data, pair_nthreads);
+
+  // Write results
+  int status = 1;
+  for (int i = 0; i < npairs; i++) {
+    BatchPair *pair = &pairs[i];
+    BatchEntry *entry1 = &entries[pair->index1];
+    const char *name2 = (pair->index2 < 0) ? reference_name : entries[pair->index2].input_name;
+
+    // Check status
+    if (!pair->status) {
+      fprintf(stderr, "Unable to align %s to %s\n", entry1->input_name, name2);
+      status = 0;
+      continue;
+    }
+
+    // Print transformation
+    const R4Matrix& m = pair->affine12.Matrix();
+    printf("%s %s %g %d", entry1->input_name, name2, pair->rmsd, pair->converged);
+    for (int r = 0; r < 3; r++) for (int c = 0; c < 4; c++) printf(" %g", m[r][c]);
+    printf("\n");
+
+    // Write transformed mesh (each input appears in only one pair when aligning to reference)
+    if (reference_name && entry1->output_name[0]) {
+      R3Mesh *mesh = entry1->samples.mesh;
+      if (!mesh) mesh = ReadMesh(entry1->input_name);
+      if (!mesh) { status = 0; continue; }
+      mesh->Transform(pair->affine12);
+      if (!WriteMesh(mesh, entry1->output_name)) status = 0;
+      if (mesh != entry1->samples.mesh) delete mesh;
+    }
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Aligned batch ...\n");
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Inputs = %d\n", nentries);
+    printf("  # Pairs = %d\n", npairs);
+    fflush(stdout);
+  }
+
+  // Delete data
+  DeleteBatchEntries(entries, nentries);
+  if (reference_mesh) {
+    DeleteSamples(reference);
+    delete reference_mesh;
+  }
+  delete [] entries;
+  delete [] pairs;
+
+  // Return status
+  return status;
+}
+
+
+
 static int 
 ParseArgs(int argc, char **argv)
 {
   // Check number of arguments
   if (argc == 1) {
     printf("Usage: mshalign input1 [input2] output1 [options]\n");
+    printf("       mshalign -batch listfile [reference] [options]\n");
     exit(0);
   }
 
@@ -973,6 +1067,16 @@ ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-sample_faces")) sample_method = 0; 
       else if (!strcmp(*argv, "-sample_edges")) sample_method = 1; 
       else if (!strcmp(*argv, "-sample_vertices")) sample_method = 2; 
+      else if (!strcmp(*argv, "-point_to_point")) icp_objective = R3_ICP_POINT_TO_POINT_OBJECTIVE; 
+      else if (!strcmp(*argv, "-point_to_plane")) icp_objective = R3_ICP_POINT_TO_PLANE_OBJECTIVE; 
+      else if (!strcmp(*argv, "-trim")) { argc--; argv++; icp_kernel = R3_ICP_TRIMMED_KERNEL; icp_kernel_parameter = atof(*argv); }
+      else if (!strcmp(*argv, "-huber")) { argc--; argv++; icp_kernel = R3_ICP_HUBER_KERNEL; icp_kernel_parameter = atof(*argv); }
+      else if (!strcmp(*argv, "-tukey")) { argc--; argv++; icp_kernel = R3_ICP_TUKEY_KERNEL; icp_kernel_parameter = atof(*argv); }
+      else if (!strcmp(*argv, "-levels")) { argc--; argv++; icp_levels = atoi(*argv); }
+      else if (!strcmp(*argv, "-max_iterations")) { argc--; argv++; icp_max_iterations = atoi(*argv); }
+      else if (!strcmp(*argv, "-tolerance")) { argc--; argv++; icp_tolerance = atof(*argv); }
+      else if (!strcmp(*argv, "-batch")) { argc--; argv++; batch_name = *argv; }
+      else if (!strcmp(*argv, "-threads")) { argc--; argv++; nthreads = atoi(*argv); }
       else { fprintf(stderr, "Invalid program argument: %s", *argv); exit(1); }
       argv++; argc--;
     }
@@ -993,6 +1097,15 @@ ParseArgs(int argc, char **argv)
     icp_translation = icp_rotation = icp_scale = 1;
   }
 
+  // Check batch mode (optional positional argument is reference)
+  if (batch_name) {
+    if (input2_name) {
+      printf("Usage: mshalign -batch listfile [reference] [options]\n");
+      return 0;
+    }
+    return 1;
+  }
+
   // Fix output filename
   if (input2_name && !output1_name) {
     output1_name = input2_name;
@@ -1016,6 +1129,12 @@ int main(int argc, char **argv)
   // Check number of arguments
   if (!ParseArgs(argc, argv)) exit(1);
 
+  // Check batch mode
+  if (batch_name) {
+    if (!AlignBatch(batch_name, input1_name)) exit(-1);
+    return 0;
+  }
+
   // Read mesh1
   R3Mesh *mesh1 = ReadMesh(input1_name);
   if (!mesh1) exit(-1);
@@ -1041,13 +1160,7 @@ int main(int argc, char **argv)
     }
 
     // Align mesh1 to mesh2
-    if (!Align(mesh1, mesh2, 
-      weights1, nweights1, weights2, nweights2,
-      pca_translation, pca_rotation, pca_scale, 
-      ransac_translation, ransac_rotation, ransac_scale, 
-      icp_translation, icp_rotation, icp_scale,
-      sample_method)) 
-      exit(-1);
+    if (!Align(mesh1, mesh2, weights1, nweights1, weights2, nweights2)) exit(-1);
   }
   else {
     // Align mesh1 to canonical coordinate system
@@ -0,0 +1,540 @@
+// Program to benchmark batched distance and intersection queries against per-primitive ones
+
+
+
+// Include files
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+// Constant definitions
+
+enum {
+  POINT_BOX_TEST,
+  POINT_TRIANGLE_TEST,
+  RAY_BOX_TEST,
+  RAY_TRIANGLE_TEST,
+  SPHERE_BOX_TEST,
+  NUM_TESTS
+};
+
+static const char *test_names[NUM_TESTS] = {
+  "point-box", "point-tri", "ray-box", "ray-tri", "sphere-box"
+};
+
+static const char *kernel_names[3] = {
+  "scalar", "sse", "avx"
+};
+
+
+
+// Program arguments
+
+static char *mesh_name = NULL;
+static int nprimitives = 1000000;
+static int nqueries = 5;
+static RNScalar degenerate_fraction = 0;
+static RNBoolean print_verbose = FALSE;
+
+
+
+// Primitive data
+
+static int nboxes = 0;
+static int ntriangles = 0;
+static R3Box *boxes = NULL;
+static R3Triangle **triangles = NULL;
+static R3Box primitives_bbox = R3null_box;
+static double *double_coordinates[15] = { NULL };
+static float *float_coordinates[15] = { NULL };
+static R3BoxBatch<double> double_boxes;
+static R3BoxBatch<float> float_boxes;
+static R3TriangleBatch<double> double_triangles;
+static R3TriangleBatch<float> float_triangles;
+
+
+
+// Query data
+
+static R3Point *query_points = NULL;
+static R3Ray *query_rays = NULL;
+static R3Sphere *query_spheres = NULL;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Input functions
+////////////////////////////////////////////////////////////////////////
+
+static R3Mesh *
+ReadMesh(const char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Allocate mesh
+  R3Mesh *mesh = new R3Mesh();
+  assert(mesh);
+
+  // Read mesh from file
+  if (!mesh->ReadFile(filename)) {
+    delete mesh;
+    return NULL;
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    printf("Read mesh from %s ...\n", filename);
+    printf("  Time = %.2f seconds\n", start_time.Elapsed());
+    printf("  # Faces = %d\n", mesh->NFaces());
+    printf("  # Edges = %d\n", mesh->NEdges());
+    printf("  # Vertices = %d\n", mesh->NVertices());
+    fflush(stdout);
+  }
+
+  // Return success
+  return mesh;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Primitive creation functions
+////////////////////////////////////////////////////////////////////////
+
+static R3Point
+RandomPoint(const R3Box& box)
+{
+  // Return random point in box
+  RNScalar x = box.XMin() + RNRandomScalar() * box.XLength();
+  RNScalar y = box.YMin() + RNRandomScalar() * box.YLength();
+  RNScalar z = box.ZMin() + RNRandomScalar() * box.ZLength();
+  return R3Point(x, y, z);
+}
+
+
+
+static R3Vector
+RandomDirection(void)
+{
+  // Return random unit vector
+  R3Vector vector(0, 0, 0);
+  while (vector.IsZero()) {
+    vector.Reset(RNRandomScalar() - 0.5, RNRandomScalar() - 0.5, RNRandomScalar() - 0.5);
+  }
+  vector.Normalize();
+  return vector;
+}
+
+
+
+static void
+InsertTriangle(int index, const R3Point& p0, const R3Point& p1, const R3Point& p2)
+{
+  // Create triangle and its bounding box
+  R3TriangleVertex *v0 = new R3TriangleVertex(p0);
+  R3TriangleVertex *v1 = new R3TriangleVertex(p1);
+  R3TriangleVertex *v2 = new R3TriangleVertex(p2);
+  triangles[index] = new R3Triangle(v0, v1, v2);
+  boxes[index] = triangles[index]->BBox();
+  primitives_bbox.Union(boxes[index]);
+}
+
+
+
+static int
+CreateMeshPrimitives(R3Mesh *mesh)
+{
+  // Allocate primitives (a triangle and a box per face)
+  nboxes = ntriangles = mesh->NFaces();
+  if (ntriangles == 0) return 0;
+  boxes = new R3Box [ nboxes ];
+  triangles = new R3Triangle * [ ntriangles ];
+
+  // Create primitives
+  for (int i = 0; i < mesh->NFaces(); i++) {
+    R3MeshFace *face = mesh->Face(i);
+    const R3Point& p0 = mesh->VertexPosition(mesh->VertexOnFace(face, 0));
+    const R3Point& p1 = mesh->VertexPosition(mesh->VertexOnFace(face, 1));
+    const R3Point& p2 = mesh->VertexPosition(mesh->VertexOnFace(face, 2));
+    InsertTriangle(i, p0, p1, p2);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+CreateRandomPrimitives(int n)
+{
+  // Allocate primitives
+  nboxes = ntriangles = n;
+  if (n <= 0) return 0;
+  boxes = new R3Box [ nboxes ];
+  triangles = new R3Triangle * [ ntriangles ];
+
+  // Create small random triangles in unit cube (some collinear or collapsed, if requested)
+  const RNLength size = 0.05;
+  for (int i = 0; i < n; i++) {
+    R3Point p0 = RandomPoint(R3unit_box);
+    R3Point p1 = p0 + size * RandomDirection();
+    R3Point p2 = p0 + size * RandomDirection();
+    if (RNRandomScalar() < degenerate_fraction) {
+      RNScalar t = RNRandomScalar();
+      if (t < 0.25) p2 = p1 = p0;
+      else if (t < 0.5) p2 = p1;
+      else p2 = p0 + 2 * t * (p1 - p0);
+    }
+    InsertTriangle(i, p0, p1, p2);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static void
+CreateBatches(void)
+{
+  // Allocate structure-of-arrays coordinates (six for boxes, nine for triangles)
+  for (int k = 0; k < 15; k++) {
+    int n = (k < 6) ? nboxes : ntriangles;
+    double_coordinates[k] = new double [ n ];
+    float_coordinates[k] = new float [ n ];
+  }
+
+  // Fill box coordinates
+  for (int i = 0; i < nboxes; i++) {
+    for (int k = 0; k < 3; k++) {
+      double_coordinates[k][i] = boxes[i].Min()[k];
+      double_coordinates[k+3][i] = boxes[i].Max()[k];
+    }
+  }
+
+  // Fill triangle coordinates
+  for (int i = 0; i < ntriangles; i++) {
+    for (int j = 0; j < 3; j++) {
+      const R3Point& position = triangles[i]->Vertex(j)->Position();
+      for (int k = 0; k < 3; k++) double_coordinates[6+3*j+k][i] = position[k];
+    }
+  }
+
+  // Convert coordinates to floats
+  for (int k = 0; k < 15; k++) {
+    int n = (k < 6) ? nboxes : ntriangles;
+    for (int i = 0; i < n; i++) float_coordinates[k][i] = (float) double_coordinates[k][i];
+  }
+
+  // Set up batches
+  double **d = double_coordinates;
+  float **f = float_coordinates;
+  double_boxes.xmin = d[0]; double_boxes.ymin = d[1]; double_boxes.zmin = d[2];
+  double_boxes.xmax = d[3]; double_boxes.ymax = d[4]; double_boxes.zmax = d[5];
+  float_boxes.xmin = f[0]; float_boxes.ymin = f[1]; float_boxes.zmin = f[2];
+  float_boxes.xmax = f[3]; float_boxes.ymax = f[4]; float_boxes.zmax = f[5];
+  double_triangles.x0 = d[6]; double_triangles.y0 = d[7]; double_triangles.z0 = d[8];
+  double_triangles.x1 = d[9]; double_triangles.y1 = d[10]; double_triangles.z1 = d[11];
+  double_triangles.x2 = d[12]; double_triangles.y2 = d[13]; double_triangles.z2 = d[14];
+  float_triangles.x0 = f[6]; float_triangles.y0 = f[7]; float_triangles.z0 = f[8];
+  float_triangles.x1 = f[9]; float_triangles.y1 = f[10]; float_triangles.z1 = f[11];
+  float_triangles.x2 = f[12]; float_triangles.y2 = f[13]; float_triangles.z2 = f[14];
+}
+
+
+
+static void
+CreateQueries(void)
+{
+  // Create random queries in (slightly enlarged) bounding box of primitives
+  R3Box query_bbox = primitives_bbox;
+  query_bbox.Inflate(1.1);
+  RNLength radius = 0.05 * query_bbox.DiagonalLength();
+  query_points = new R3Point [ nqueries ];
+  query_rays = new R3Ray [ nqueries ];
+  query_spheres = new R3Sphere [ nqueries ];
+  for (int q = 0; q < nqueries; q++) {
+    query_points[q] = RandomPoint(query_bbox);
+    query_rays[q] = R3Ray(RandomPoint(query_bbox), RandomDirection(), TRUE);
+    query_spheres[q] = R3Sphere(RandomPoint(query_bbox), radius);
+  }
+}
+
+
+
+static void
+DeleteData(void)
+{
+  // Delete primitives (triangles delete their vertices)
+  for (int i = 0; i < ntriangles; i++) delete triangles[i];
+  delete [] triangles;
+  delete [] boxes;
+
+  // Delete batches
+  for (int k = 0; k < 15; k++) {
+    delete [] double_coordinates[k];
+    delete [] float_coordinates[k];
+  }
+
+  // Delete queries
+  delete [] query_points;
+  delete [] query_rays;
+  delete [] query_spheres;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Benchmark functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+RunPerPrimitive(int test, int q, double *results)
+{
+  // Compute results with existing per-primitive functions
+  switch (test) {
+  case POINT_BOX_TEST:
+    for (int i = 0; i < nboxes; i++) {
+      results[i] = R3Distance(query_points[q], boxes[i]);
+    }
+    break;
+
+  case POINT_TRIANGLE_TEST:
+    for (int i = 0; i < ntriangles; i++) {
+      results[i] = R3Distance(query_points[q], triangles[i]->ClosestPoint(query_points[q]));
+    }
+    break;
+
+  case RAY_BOX_TEST:
+    for (int i = 0; i < nboxes; i++) {
+      RNScalar t = -1;
+      results[i] = (R3Intersects(query_rays[q], boxes[i], NULL, NULL, &t)) ? t : -1;
+    }
+    break;
+
+  case RAY_TRIANGLE_TEST:
+    for (int i = 0; i < ntriangles; i++) {
+      RNScalar t = -1;
+      results[i] = (R3Intersects(query_rays[q], *(triangles[i]), NULL, NULL, &t)) ? t : -1;
+    }
+    break;
+
+  case SPHERE_BOX_TEST:
+    for (int i = 0; i < nboxes; i++) {
+      results[i] = (R3Intersects(query_spheres[q], boxes[i])) ? 1 : 0;
+    }
+    break;
+  }
+}
+
+
+
+static void
+RunBatched(int test, int q, double *double_results, float *float_results, RNBoolean *hits)
+{
+  // Compute results with batched functions (in floats if float_results is not NULL)
+  switch (test) {
+  case POINT_BOX_TEST:
+    if (float_results) R3Distances(query_points[q], float_boxes, nboxes, float_results);
+    else R3Distances(query_points[q], double_boxes, nboxes, double_results);
+    break;
+
+  case POINT_TRIANGLE_TEST:
+    if (float_results) R3Distances(query_points[q], float_triangles, ntriangles, float_results);
+    else R3Distances(query_points[q], double_triangles, ntriangles, double_results);
+    break;
+
+  case RAY_BOX_TEST:
+    if (float_results) R3Intersections(query_rays[q], float_boxes, nboxes, float_results);
+    else R3Intersections(query_rays[q], double_boxes, nboxes, double_results);
+    break;
+
+  case RAY_TRIANGLE_TEST:
+    if (float_results) R3Intersections(query_rays[q], float_triangles, ntriangles, float_results);
+    else R3Intersections(query_rays[q], double_triangles, ntriangles, double_results);
+    break;
+
+  case SPHERE_BOX_TEST:
+    if (float_results) R3Intersections(query_spheres[q], float_boxes, nboxes, hits);
+    else R3Intersections(query_spheres[q], double_boxes, nboxes, hits);
+    break;
+  }
+}
+
+
+
+static void
+PrintComparison(int test, const char *method, RNScalar seconds,
+  int n, const double *results, const double *reference_results)
+{
+  // Compare results to reference (distances by value, intersections by hit or miss)
+  RNBoolean distances = (test == POINT_BOX_TEST) || (test == POINT_TRIANGLE_TEST);
+  RNScalar max_difference = 0;
+  int nmismatches = 0;
+  int nnonfinite = 0;
+  for (int i = 0; i < n; i++) {
+    if (!RNIsFinite(results[i])) { nnonfinite++; continue; }
+    if (distances) {
+      RNScalar difference = fabs(results[i] - reference_results[i]);
+      if (difference > max_difference) max_difference = difference;
+    }
+    else {
+      RNBoolean hit = (test == SPHERE_BOX_TEST) ? (results[i] > 0) : (results[i] >= 0);
+      RNBoolean reference_hit = (test == SPHERE_BOX_TEST) ? (reference_results[i] > 0) : (reference_results[i] >= 0);
+      if (hit != reference_hit) nmismatches++;
+    }
+  }
+
+  // Print line
+  printf("  %-10s %-13s %8.4f seconds", test_names[test], method, seconds);
+  if (distances) printf("  max_difference = %-10.3g", max_difference);
+  else printf("  mismatches = %-8d", nmismatches);
+  printf("  nonfinite = %d\n", nnonfinite);
+  fflush(stdout);
+}
+
+
+
+static void
+RunTest(int test)
+{
+  // Allocate results
+  int n = ((test == POINT_BOX_TEST) || (test == RAY_BOX_TEST) || (test == SPHERE_BOX_TEST)) ? nboxes : ntriangles;
+  double *existing_results = new double [ n ];
+  double *reference_results = new double [ n ];
+  double *double_results = new double [ n ];
+  float *float_results = new float [ n ];
+  RNBoolean *hits = new RNBoolean [ n ];
+
+  // Compute reference results for last query (scalar batched kernels in doubles)
+  int max_kernels = R3BatchKernels();
+  R3SetBatchKernels(R3_BATCH_SCALAR_KERNELS);
+  RunBatched(test, nqueries-1, reference_results, NULL, hits);
+  if (test == SPHERE_BOX_TEST) {
+    for (int i = 0; i < n; i++) reference_results[i] = (hits[i]) ? 1 : 0;
+  }
+
+  // Time existing per-primitive functions
+  RNTime start_time;
+  start_time.Read();
+  for (int q = 0; q < nqueries; q++) RunPerPrimitive(test, q, existing_results);
+  PrintComparison(test, "existing", start_time.Elapsed(), n, existing_results, reference_results);
+
+  // Time batched functions with every set of kernels compiled in
+  for (int kernels = R3_BATCH_SCALAR_KERNELS; kernels <= max_kernels; kernels++) {
+    R3SetBatchKernels(kernels);
+    for (int precision = 0; precision < 2; precision++) {
+      float *batch_float_results = (precision == 1) ? float_results : NULL;
+      start_time.Read();
+      for (int q = 0; q < nqueries; q++) RunBatched(test, q, double_results, batch_float_results, hits);
+      RNScalar seconds = start_time.Elapsed();
+
+      // Convert results to doubles
+      for (int i = 0; i < n; i++) {
+        if (test == SPHERE_BOX_TEST) double_results[i] = (hits[i]) ? 1 : 0;
+        else if (batch_float_results) double_results[i] = float_results[i];
+      }
+
+      // Print comparison
+      char method[64];
+      sprintf(method, "%s/%s", kernel_names[kernels], (precision == 1) ? "float" : "double");
+      PrintComparison(test, method, seconds, n, double_results, reference_results);
+    }
+  }
+
+  // Restore kernels
+  R3SetBatchKernels(max_kernels);
+
+  // Delete results
+  delete [] existing_results;
+  delete [] reference_results;
+  delete [] double_results;
+  delete [] float_results;
+  delete [] hits;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Argument parsing functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+ParseArgs(int argc, char **argv)
+{
+  // Parse arguments
+  argc--; argv++;
+  while (argc > 0) {
+    if ((*argv)[0] == '-') {
+      if (!strcmp(*argv, "-v")) print_verbose = TRUE;
+      else if (!strcmp(*argv, "-primitives")) { argc--; argv++; nprimitives = atoi(*argv); }
+      else if (!strcmp(*argv, "-queries")) { argc--; argv++; nqueries = atoi(*argv); }
+      else if (!strcmp(*argv, "-degenerate_fraction")) { argc--; argv++; degenerate_fraction = atof(*argv); }
+      else { fprintf(stderr, "Invalid program argument: %s\n", *argv); return 0; }
+      argv++; argc--;
+    }
+    else {
+      if (!mesh_name) mesh_name = *argv;
+      else { fprintf(stderr, "Invalid program argument: %s\n", *argv); return 0; }
+      argv++; argc--;
+    }
+  }
+
+  // Check number of queries
+  if (nqueries <= 0) {
+    fprintf(stderr, "Usage: mshbench [input_mesh] [-primitives #] [-queries #] [-degenerate_fraction #] [-v]\n");
+    return 0;
+  }
+
+  // Return OK status
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Main
+////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char **argv)
+{
+  // Parse program arguments
+  if (!ParseArgs(argc, argv)) exit(-1);
+
+  // Create primitives (faces of mesh, or random triangles in unit cube)
+  RNSeedRandomScalar();
+  if (mesh_name) {
+    R3Mesh *mesh = ReadMesh(mesh_name);
+    if (!mesh) exit(-1);
+    if (!CreateMeshPrimitives(mesh)) exit(-1);
+    delete mesh;
+  }
+  else {
+    if (!CreateRandomPrimitives(nprimitives)) exit(-1);
+  }
+
+  // Create batches and queries
+  CreateBatches();
+  CreateQueries();
+
+  // Print header
+  printf("Benchmarking %d boxes and %d triangles with %d queries ...\n", nboxes, ntriangles, nqueries);
+  printf("  (differences are relative to scalar batched kernels in doubles)\n");
+  fflush(stdout);
+
+  // Run tests
+  for (int test = 0; test < NUM_TESTS; test++) {
+    RunTest(test);
+  }
+
+  // Delete data
+  DeleteData();
+
+  // Return success
+  return 0;
+}
@@ -0,0 +1,242 @@
+// Program to check boolean operations of meshes on boxes that share faces
+
+
+
+// Include files
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+// Program arguments
+
+static RNBoolean print_verbose = FALSE;
+
+
+
+// Check cases (box of first mesh, box of second mesh, operation, expected area and volume of result)
+
+struct BooleanCheckCase {
+  const char *name;
+  RNCoord boxes[2][6];
+  int diagonals[2];
+  int operation;
+  RNArea area;
+  RNVolume volume;
+};
+
+static const BooleanCheckCase check_cases[] = {
+  { "overlap difference", { { 0, 0, 0, 2, 2, 2 }, { 1, 0, 0, 3, 2, 2 } }, { 0, 0 }, R3_MESH_DIFFERENCE_OPERATION, 16, 4 },
+  { "overlap union", { { 0, 0, 0, 2, 2, 2 }, { 1, 0, 0, 3, 2, 2 } }, { 0, 0 }, R3_MESH_UNION_OPERATION, 32, 12 },
+  { "overlap intersection", { { 0, 0, 0, 2, 2, 2 }, { 1, 0, 0, 3, 2, 2 } }, { 0, 0 }, R3_MESH_INTERSECTION_OPERATION, 16, 4 },
+  { "overlap reverse difference", { { 1, 0, 0, 3, 2, 2 }, { 0, 0, 0, 2, 2, 2 } }, { 0, 0 }, R3_MESH_DIFFERENCE_OPERATION, 16, 4 },
+  { "crossed diagonals difference", { { 0, 0, 0, 2, 2, 2 }, { 1, 0, 0, 3, 2, 2 } }, { 0, 63 }, R3_MESH_DIFFERENCE_OPERATION, 16, 4 },
+  { "crossed diagonals union", { { 0, 0, 0, 2, 2, 2 }, { 1, 0, 0, 3, 2, 2 } }, { 0, 63 }, R3_MESH_UNION_OPERATION, 32, 12 },
+  { "touching union", { { 0, 0, 0, 2, 2, 2 }, { 2, 0, 0, 4, 2, 2 } }, { 0, 0 }, R3_MESH_UNION_OPERATION, 40, 16 },
+  { "touching difference", { { 0, 0, 0, 2, 2, 2 }, { 2, 0, 0, 4, 2, 2 } }, { 0, 0 }, R3_MESH_DIFFERENCE_OPERATION, 24, 8 },
+  { "touching intersection", { { 0, 0, 0, 2, 2, 2 }, { 2, 0, 0, 4, 2, 2 } }, { 0, 0 }, R3_MESH_INTERSECTION_OPERATION, 0, 0 },
+  { "offset touching union", { { 0, 0, 0, 2, 2, 2 }, { 2, 1, 1, 4, 3, 3 } }, { 0, 0 }, R3_MESH_UNION_OPERATION, 46, 16 },
+  { "inside difference", { { 0, 0, 0, 3, 3, 3 }, { 0, 1, 1, 1, 2, 2 } }, { 0, 0 }, R3_MESH_DIFFERENCE_OPERATION, 58, 26 },
+  { "identical union", { { 0, 0, 0, 2, 2, 2 }, { 0, 0, 0, 2, 2, 2 } }, { 0, 63 }, R3_MESH_UNION_OPERATION, 24, 8 },
+  { "identical intersection", { { 0, 0, 0, 2, 2, 2 }, { 0, 0, 0, 2, 2, 2 } }, { 0, 63 }, R3_MESH_INTERSECTION_OPERATION, 24, 8 },
+  { "identical difference", { { 0, 0, 0, 2, 2, 2 }, { 0, 0, 0, 2, 2, 2 } }, { 0, 63 }, R3_MESH_DIFFERENCE_OPERATION, 0, 0 },
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Mesh functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+CreateBox(R3Mesh *mesh, const RNCoord *coordinates, int diagonals)
+{
+  // Create corners
+  R3MeshVertex *vertices[8];
+  for (int i = 0; i < 8; i++) {
+    RNCoord x = coordinates[(i & 1) ? 3 : 0];
+    RNCoord y = coordinates[(i & 2) ? 4 : 1];
+    RNCoord z = coordinates[(i & 4) ? 5 : 2];
+    vertices[i] = mesh->CreateVertex(R3Point(x, y, z));
+  }
+
+  // Create two triangles on every side (split along the other diagonal where the bit of the side is set)
+  static const int sides[6][4] = {
+    { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 }
+  };
+  for (int i = 0; i < 6; i++) {
+    const int *c = sides[i];
+    if (diagonals & (1 << i)) {
+      mesh->CreateFace(vertices[c[0]], vertices[c[1]], vertices[c[2]]);
+      mesh->CreateFace(vertices[c[0]], vertices[c[2]], vertices[c[3]]);
+    }
+    else {
+      mesh->CreateFace(vertices[c[0]], vertices[c[1]], vertices[c[3]]);
+      mesh->CreateFace(vertices[c[1]], vertices[c[2]], vertices[c[3]]);
+    }
+  }
+}
+
+
+
+static RNVolume
+MeshVolume(R3Mesh *mesh)
+{
+  // Sum signed volumes of tetrahedra spanned by origin and faces
+  RNVolume volume = 0;
+  for (int i = 0; i < mesh->NFaces(); i++) {
+    R3MeshFace *face = mesh->Face(i);
+    R3Vector p0 = mesh->VertexPosition(mesh->VertexOnFace(face, 0)).Vector();
+    R3Vector p1 = mesh->VertexPosition(mesh->VertexOnFace(face, 1)).Vector();
+    R3Vector p2 = mesh->VertexPosition(mesh->VertexOnFace(face, 2)).Vector();
+    volume += p0.Dot(p1 % p2) / 6.0;
+  }
+
+  // Return volume
+  return volume;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Check functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+CheckCase(const BooleanCheckCase& check_case)
+{
+  // Create operands
+  R3Mesh meshes[2];
+  for (int i = 0; i < 2; i++) {
+    CreateBox(&meshes[i], check_case.boxes[i], check_case.diagonals[i]);
+  }
+
+  // Compute boolean operation
+  R3Mesh result;
+  R3MeshBoolean boolean(&meshes[0], &meshes[1]);
+  if (!boolean.Compute(check_case.operation, &result)) {
+    printf("  %s: unable to compute boolean operation\n", check_case.name);
+    return 0;
+  }
+
+  // Count boundary edges
+  int nopen = 0;
+  for (int i = 0; i < result.NEdges(); i++) {
+    if (result.IsEdgeOnBoundary(result.Edge(i))) nopen++;
+  }
+
+  // Count faces with collinear vertices
+  int ndegenerate = 0;
+  for (int i = 0; i < result.NFaces(); i++) {
+    R3MeshFace *face = result.Face(i);
+    const R3Point& p0 = result.VertexPosition(result.VertexOnFace(face, 0));
+    const R3Point& p1 = result.VertexPosition(result.VertexOnFace(face, 1));
+    const R3Point& p2 = result.VertexPosition(result.VertexOnFace(face, 2));
+    if ((R3Orientation(p0, p1, p2, RN_X) == 0) && (R3Orientation(p0, p1, p2, RN_Y) == 0) &&
+      (R3Orientation(p0, p1, p2, RN_Z) == 0)) ndegenerate++;
+  }
+
+  // Count vertices at the same position as another vertex
+  int nduplicate = 0;
+  for (int i = 0; i < result.NVertices(); i++) {
+    const R3Point& position = result.VertexPosition(result.Vertex(i));
+    for (int j = i + 1; j < result.NVertices(); j++) {
+      if (result.VertexPosition(result.Vertex(j)) == position) { nduplicate++; break; }
+    }
+  }
+
+  // Compare area and volume with expected values
+  RNArea area = result.Area();
+  RNVolume volume = MeshVolume(&result);
+  RNBoolean status = (nopen == 0) && (ndegenerate == 0) && (nduplicate == 0) &&
+    (fabs(area - check_case.area) < 1E-9) && (fabs(volume - check_case.volume) < 1E-9);
+
+  // Print statistics
+  if (print_verbose || !status) {
+    printf("  %s: %s\n", check_case.name, (status) ? "ok" : "wrong");
+    printf("    # Faces = %d\n", result.NFaces());
+    printf("    # Open edges = %d\n", nopen);
+    printf("    # Degenerate faces = %d\n", ndegenerate);
+    printf("    # Duplicate vertices = %d\n", nduplicate);
+    printf("    # Perturbations = %d\n", boolean.NPerturbations());
+    printf("    Area = %g (%g)\n", area, check_case.area);
+    printf("    Volume = %g (%g)\n", volume, check_case.volume);
+    fflush(stdout);
+  }
+
+  // Return whether result is correct
+  return (status) ? 1 : 0;
+}
+
+
+
+static int
+CheckBooleans(void)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Check every case
+  int ncases = sizeof(check_cases) / sizeof(check_cases[0]);
+  int nwrong = 0;
+  for (int i = 0; i < ncases; i++) {
+    if (!CheckCase(check_cases[i])) nwrong++;
+  }
+
+  // Print statistics
+  printf("Checked boolean operations of %d box pairs that share faces ...\n", ncases);
+  printf("  Time = %.2f seconds\n", start_time.Elapsed());
+  printf("  # Wrong = %d\n", nwrong);
+  fflush(stdout);
+
+  // Return whether all cases were correct
+  return (nwrong == 0) ? 1 : 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Argument parsing functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+ParseArgs(int argc, char **argv)
+{
+  // Parse arguments
+  argc--; argv++;
+  while (argc > 0) {
+    if ((*argv)[0] == '-') {
+      if (!strcmp(*argv, "-v")) print_verbose = TRUE;
+      else { fprintf(stderr, "Invalid program argument: %s\n", *argv); return 0; }
+      argv++; argc--;
+    }
+    else {
+      fprintf(stderr, "Usage: mshboolcheck [-v]\n");
+      return 0;
+    }
+  }
+
+  // Return OK status
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Main
+////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char **argv)
+{
+  // Parse program arguments
+  if (!ParseArgs(argc, argv)) exit(-1);
+
+  // Check boolean operations
+  int status = CheckBooleans();
+  printf("%s\n", (status) ? "PASSED" : "FAILED");
+
+  // Return whether check passed
+  return (status) ? 0 : 1;
+}
@@ -22,6 +22,9 @@ static R3Vector initial_camera_up(0, 1, 0);
 // static R3Vector initial_camera_up(0.00610775, 0.892357, 0.451289);
 // static R3Vector initial_camera_towards(-0.57735, -0.57735, -0.57735);
 // static R3Vector initial_camera_up(-0.57735, 0.57735, 0.5773);
+static RNScalar max_pixel_error = 1;
+static int max_faces = 0;
+static int max_refinement_operations = 1000;
 static int print_verbose = 0;
 
 
@@ -41,6 +44,7 @@ static int GLUTmodifiers = 0;
 
 static R3Viewer *viewer = NULL;
 static RNArray<R3Mesh *> meshes;
+static RNArray<R3ProgressiveMesh *> progressive_meshes;
 
 
 
@@ -102,6 +106,46 @@ const RNRgb colors[ncolors] = {
 
 
 
+static R3Box
+WorldBBox(void)
+{
+  // Return bounding box of all meshes
+  R3Box bbox = R3null_box;
+  for (int i = 0; i < meshes.NEntries(); i++) bbox.Union(meshes[i]->BBox());
+  for (int i = 0; i < progressive_meshes.NEntries(); i++) bbox.Union(progressive_meshes[i]->BBox());
+  return bbox;
+}
+
+
+
+static int
+RefineProgressiveMeshes(int max_operations)
+{
+  // Get view frustum and pixels per unit of distance from the viewpoint
+  const R3Camera& camera = viewer->Camera();
+  R3Halfspace frustum_halfspaces[6];
+  for (int dir = 0; dir < 2; dir++) {
+    for (int dim = 0; dim < 3; dim++) {
+      frustum_halfspaces[3*dir+dim] = camera.Halfspace(dir, dim);
+    }
+  }
+  RNScalar pixels_per_unit = 0.5 * viewer->Viewport().Height() / tan(camera.YFOV());
+
+  // Load next chunk of splits and refine every progressive mesh for the current view
+  int noperations = 0;
+  for (int i = 0; i < progressive_meshes.NEntries(); i++) {
+    R3ProgressiveMesh *progressive_mesh = progressive_meshes[i];
+    if (!progressive_mesh->IsLoaded() && (progressive_mesh->ReadSplits(1) > 0)) noperations++;
+    noperations += progressive_mesh->Refine(camera.Origin(), frustum_halfspaces, 6,
+      pixels_per_unit, camera.Near(), max_operations);
+  }
+
+  // Return number of splits loaded or applied
+  return noperations;
+}
+
+
+
 void GLUTDrawText(const R3Point& p, const char *s)
 {
   // Draw text string s and position p
@@ -312,9 +356,31 @@ void GLUTRedraw(void)
     }
   }
 
+  // Draw every progressive mesh
+  for (int m = 0; m < progressive_meshes.NEntries(); m++) {
+    R3ProgressiveMesh *progressive_mesh = progressive_meshes[m];
+    if ((current_mesh != -1) && (meshes.NEntries() + m != current_mesh)) continue;
+
+    // Draw faces
+    if (show_faces) {
+      glEnable(GL_LIGHTING);
+      glColor3d(0.8, 0.8, 0.8);
+      progressive_mesh->Draw();
+    }
+
+    // Draw edges
+    if (show_edges) {
+      glDisable(GL_LIGHTING);
+      glColor3f(1.0, 0.0, 0.0);
+      glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+      progressive_mesh->Draw();
+      glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    }
+  }
+
   // Draw axes
   if (show_axes) {
-    RNScalar d = meshes[0]->BBox().DiagonalRadius();
+    RNScalar d = WorldBBox().DiagonalRadius();
     glDisable(GL_LIGHTING);
     glLineWidth(3);
     R3BeginLine();
@@ -478,7 +544,7 @@ void GLUTKeyboard(unsigned char key, int x, int y)
   case '8':
   case '9':
     if (key == '0') current_mesh = -1;
-    else if (key - '1' < meshes.NEntries()) current_mesh = key - '1';
+    else if (key - '1' < meshes.NEntries() + progressive_meshes.NEntries()) current_mesh = key - '1';
     else printf("Unable to select mesh %d\n", key - '1');
     break;
 
@@ -487,6 +553,16 @@ void GLUTKeyboard(unsigned char key, int x, int y)
     show_axes = !show_axes;
     break;
 
+  case '+':
+  case '-':
+    // Change maximum pixel error of progressive meshes
+    max_pixel_error *= (key == '+') ? 0.5 : 2.0;
+    for (int i = 0; i < progressive_meshes.NEntries(); i++) {
+      progressive_meshes[i]->SetMaxPixelError(max_pixel_error);
+    }
+    if (print_verbose) printf("Max pixel error = %g\n", max_pixel_error);
+    break;
+
   case 'B':
   case 'b':
     show_backfacing = !show_backfacing;
@@ -601,20 +677,19 @@ void GLUTKeyboard(unsigned char key, int x, int y)
 
 
 
-#if 0
-
 void GLUTIdle(void)
 {
   // Set current window
   if ( glutGetWindow() != GLUTwindow ) 
     glutSetWindow(GLUTwindow);  
 
+  // Stream and refine progressive meshes a bounded amount per frame to stay interactive
+  if (!RefineProgressiveMeshes(max_refinement_operations)) return;
+
   // Redraw
   glutPostRedisplay();
 }
 
-#endif
-
 
 
 void GLUTInit(int *argc, char **argv)
@@ -663,8 +738,11 @@ void GLUTInit(int *argc, char **argv)
 void GLUTMainLoop(void)
 {
   // Set world origin
-  if (meshes.NEntries() > 0) {
-    world_origin = meshes[0]->BBox().Centroid();
+  world_origin = WorldBBox().Centroid();
+
+  // Refine progressive meshes while idle
+  if (progressive_meshes.NEntries() > 0) {
+    glutIdleFunc(GLUTIdle);
   }
 
   // Run main loop -- never returns 
@@ -680,6 +758,27 @@ ReadMeshes(const RNArray<char *>& mesh_names)
   for (int i = 0; i < mesh_names.NEntries(); i++) {
     char *mesh_name = mesh_names[i];
 
+    // Open progressive mesh (splits are read while idle)
+    const char *extension = strrchr(mesh_name, '.');
+    if (extension && !strcmp(extension, ".pm")) {
+      R3ProgressiveMesh *progressive_mesh = new R3ProgressiveMesh();
+      if (!progressive_mesh->OpenFile(mesh_name)) {
+        delete progressive_mesh;
+        return 0;
+      }
+      progressive_mesh->SetMaxPixelError(max_pixel_error);
+      progressive_mesh->SetMaxFaces(max_faces);
+      progressive_meshes.Insert(progressive_mesh);
+      if (print_verbose) {
+        printf("Opened progressive mesh %s ...\n", mesh_name);
+        printf("  # Base Faces = %d\n", progressive_mesh->NBaseFaces());
+        printf("  # Base Vertices = %d\n", progressive_mesh->NBaseVertices());
+        printf("  # Vertex Splits = %d\n", progressive_mesh->NSplits());
+        fflush(stdout);
+      }
+      continue;
+    }
+
     // Allocate mesh
     R3Mesh *mesh = new R3Mesh();
     assert(mesh);
@@ -704,16 +803,15 @@ ReadMeshes(const RNArray<char *>& mesh_names)
   }
 
   // Return number of meshes
-  return meshes.NEntries();
+  return meshes.NEntries() + progressive_meshes.NEntries();
 }
 
 
 
 static R3Viewer *
-CreateBirdsEyeViewer(R3Mesh *mesh)
+CreateBirdsEyeViewer(const R3Box& bbox)
 {
     // Setup camera view looking down the Z axis
-    R3Box bbox = mesh->BBox();
     assert(!bbox.IsEmpty());
     RNLength r = bbox.DiagonalRadius();
     assert((r > 0.0) && RNIsFinite(r));
@@ -748,6 +846,8 @@ int ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-segments")) { show_segments = TRUE; }
       else if (!strcmp(*argv, "-categories")) { show_categories = TRUE; }
       else if (!strcmp(*argv, "-vertex_colors")) { show_vertex_colors = TRUE; }
+      else if (!strcmp(*argv, "-max_pixel_error")) { argc--; argv++; max_pixel_error = atof(*argv); }
+      else if (!strcmp(*argv, "-max_faces")) { argc--; argv++; max_faces = atoi(*argv); }
       else if (!strcmp(*argv, "-window")) { 
         argv++; argc--; GLUTwindow_width = atoi(*argv); 
         argv++; argc--; GLUTwindow_height = atoi(*argv); 
@@ -806,9 +906,15 @@ int main(int argc, char **argv)
   if (!ReadMeshes(mesh_names)) exit(-1);
 
   // Create viewer
-  viewer = CreateBirdsEyeViewer(meshes[0]);
+  viewer = CreateBirdsEyeViewer(WorldBBox());
   if (!viewer) exit(-1);
 
+  // Refine progressive meshes completely for the initial view before capturing an image
+  if (image_name) {
+    for (int i = 0; i < progressive_meshes.NEntries(); i++) progressive_meshes[i]->ReadSplits(0);
+    for (int i = 0; i < 100; i++) if (!RefineProgressiveMeshes(0)) break;
+  }
+
   // Run GLUT interface
   GLUTMainLoop();
 
@@ -0,0 +1,168 @@
+// Program to check orientation of estimated normals on a sphere sampled along scan lines
+
+
+
+// Include files
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+// Program arguments
+
+static int nrows = 40;
+static int nsamples_per_row = 1000;
+static RNScalar radius_factor = 2.5;
+static RNAngle tilt = RN_PI / 6.0;
+static RNBoolean print_verbose = FALSE;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Sampling functions
+////////////////////////////////////////////////////////////////////////
+
+static R3Point *
+CreateScanlineSamples(int *npoints)
+{
+  // Allocate points
+  int n = nrows * nsamples_per_row;
+  R3Point *points = new R3Point [ n ];
+  if (!points) {
+    fprintf(stderr, "Unable to allocate %d points\n", n);
+    return NULL;
+  }
+
+  // Sample unit sphere along circles of latitude (densely along every circle, sparsely across them),
+  // about an axis tilted from the vertical so that no circle is horizontal
+  R3Vector axis(0, -sin(tilt), cos(tilt));
+  R3Vector u(1, 0, 0);
+  R3Vector v = axis % u;
+  for (int row = 0; row < nrows; row++) {
+    RNAngle theta = RN_PI * (row + 0.5) / nrows;
+    for (int k = 0; k < nsamples_per_row; k++) {
+      RNAngle phi = RN_TWO_PI * (k + 0.5 * (row % 2)) / nsamples_per_row;
+      R3Vector direction = cos(theta) * axis + sin(theta) * (cos(phi) * u + sin(phi) * v);
+      points[row * nsamples_per_row + k] = R3zero_point + direction;
+    }
+  }
+
+  // Return points
+  *npoints = n;
+  return points;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Check functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+CheckNormals(const R3Point *points, int npoints)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Estimate normals within a radius spanning a few scan lines
+  R3Vector *normals = new R3Vector [ npoints ];
+  R3NormalEstimator estimator(npoints, points);
+  estimator.SetMaxNeighbors(0);
+  estimator.SetMaxDistance(radius_factor * RN_PI / nrows);
+  estimator.SetOrientationMethod(R3_NORMAL_MST_ORIENTATION);
+  int count = estimator.Compute(normals);
+  if (count < 0) { delete [] normals; return 0; }
+
+  // Count normals pointing into sphere
+  int ninward = 0;
+  RNAngle max_angle = 0;
+  for (int i = 0; i < npoints; i++) {
+    if (normals[i].IsZero()) continue;
+    R3Vector outward = points[i] - R3zero_point;
+    RNScalar dot = normals[i].Dot(outward);
+    if (dot <= 0) ninward++;
+    RNAngle angle = R3InteriorAngle(normals[i], outward);
+    if (angle > max_angle) max_angle = angle;
+  }
+
+  // Print statistics
+  printf("Checked normals of %d points on %d scan lines ...\n", npoints, nrows);
+  printf("  Time = %.2f seconds\n", start_time.Elapsed());
+  printf("  # Normals = %d\n", count);
+  printf("  # Inward = %d\n", ninward);
+  printf("  # Components = %d\n", estimator.NComponents());
+  if (print_verbose) printf("  Max angle = %g degrees\n", 180.0 * max_angle / RN_PI);
+  fflush(stdout);
+
+  // Delete normals
+  delete [] normals;
+
+  // Return whether all points got outward normals
+  return ((count == npoints) && (ninward == 0)) ? 1 : 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Argument parsing functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+ParseArgs(int argc, char **argv)
+{
+  // Parse arguments
+  argc--; argv++;
+  while (argc > 0) {
+    if ((*argv)[0] == '-') {
+      if (!strcmp(*argv, "-v")) print_verbose = TRUE;
+      else if (!strcmp(*argv, "-rows")) { argc--; argv++; nrows = atoi(*argv); }
+      else if (!strcmp(*argv, "-samples_per_row")) { argc--; argv++; nsamples_per_row = atoi(*argv); }
+      else if (!strcmp(*argv, "-radius_factor")) { argc--; argv++; radius_factor = atof(*argv); }
+      else if (!strcmp(*argv, "-tilt")) { argc--; argv++; tilt = RN_PI * atof(*argv) / 180.0; }
+      else { fprintf(stderr, "Invalid program argument: %s\n", *argv); return 0; }
+      argv++; argc--;
+    }
+    else {
+      fprintf(stderr, "Invalid program argument: %s\n", *argv);
+      return 0;
+    }
+  }
+
+  // Check sampling
+  if ((nrows < 2) || (nsamples_per_row < 3) || (radius_factor <= 0)) {
+    fprintf(stderr, "Usage: nrmcheck [-rows #] [-samples_per_row #] [-radius_factor #] [-tilt degrees] [-v]\n");
+    return 0;
+  }
+
+  // Return OK status
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Main
+////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char **argv)
+{
+  // Parse program arguments
+  if (!ParseArgs(argc, argv)) exit(-1);
+
+  // Sample sphere
+  int npoints = 0;
+  R3Point *points = CreateScanlineSamples(&npoints);
+  if (!points) exit(-1);
+
+  // Check normals
+  int status = CheckNormals(points, npoints);
+  printf("%s\n", (status) ? "PASSED" : "FAILED");
+
+  // Delete points
+  delete [] points;
+
+  // Return whether check passed
+  return (status) ? 0 : 1;
+}
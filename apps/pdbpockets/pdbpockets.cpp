@@ -0,0 +1,241 @@
+// Source file for the pdb pocket detection program
+
+
+
+// Include files
+
+#include "PDB/PDB.h"
+
+
+
+// Program variables
+
+static RNArray<char *> input_names;
+static char *output_name = NULL;
+static char *grid_name = NULL;
+static RNLength grid_spacing = 1.0;
+static int ndirections = 30;
+static RNLength max_ray_length = 10.0;
+static RNScalar min_buriedness = 0.7;
+static RNVolume min_volume = 20.0;
+static RNLength lining_distance = 4.0;
+static RNBoolean hetatoms_occupy = FALSE;
+static int max_pockets = 0;
+static int nthreads = 0;
+static int print_verbose = 0;
+
+
+
+static PDBFile *
+ReadPDB(char *filename)
+{
+  // Allocate PDBFile
+  PDBFile *file = new PDBFile(filename);
+  if (!file) {
+    RNFail("Unable to allocate PDB file for %s", filename);
+    return NULL;
+  }
+
+  // Read PDB file
+  if (!file->ReadFile(filename)) {
+    RNFail("Unable to read PDB file %s", filename);
+    delete file;
+    return NULL;
+  }
+
+  // Return success
+  return file;
+}
+
+
+
+static int
+PrintPockets(FILE *fp, PDBFile *file, PDBModel *model, PDBPocketFinder *finder)
+{
+  // Print one line for every pocket
+  for (int k = 0; k < finder->NPockets(); k++) {
+    if ((max_pockets > 0) && (k >= max_pockets)) break;
+    PDBPocket *pocket = finder->Pocket(k);
+    const R3Point& centroid = pocket->Centroid();
+    fprintf(fp, "%s %s %d %g %g %g %g %g %g %d", file->Name(), model->Name(),
+      pocket->Rank() + 1, pocket->Volume(), pocket->Buriedness(), pocket->Score(),
+      centroid.X(), centroid.Y(), centroid.Z(), pocket->NResidues());
+
+    // Print lining residues
+    for (int i = 0; i < pocket->NResidues(); i++) {
+      PDBResidue *residue = pocket->Residue(i);
+      PDBChain *chain = residue->Chain();
+      const char *chain_name = (chain && strcmp(chain->Name(), " ")) ? chain->Name() : "_";
+      fprintf(fp, " %s-%s-%d", chain_name, residue->Name(), residue->Sequence());
+    }
+
+    // End line
+    fprintf(fp, "\n");
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+FindPockets(FILE *fp, char *filename)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Read PDB file
+  PDBFile *file = ReadPDB(filename);
+  if (!file) return 0;
+
+  // Check number of models
+  if (file->NModels() < 1) {
+    fprintf(stderr, "PDB file has no models: %s\n", filename);
+    delete file;
+    return 0;
+  }
+
+  // Find pockets in first model
+  PDBModel *model = file->Model(0);
+  PDBPocketFinder finder(model);
+  finder.SetGridSpacing(grid_spacing);
+  finder.SetNDirections(ndirections);
+  finder.SetMaxRayLength(max_ray_length);
+  finder.SetMinBuriedness(min_buriedness);
+  finder.SetMinVolume(min_volume);
+  finder.SetLiningDistance(lining_distance);
+  finder.SetHetAtomsOccupy(hetatoms_occupy);
+  finder.SetNThreads(nthreads);
+  if (finder.FindPockets() < 0) {
+    fprintf(stderr, "Unable to find pockets in %s\n", filename);
+    delete file;
+    return 0;
+  }
+
+  // Print pockets
+  if (!PrintPockets(fp, file, model, &finder)) {
+    delete file;
+    return 0;
+  }
+
+  // Write pocket grid
+  if (grid_name && finder.PocketGrid()) {
+    if (!finder.PocketGrid()->WriteFile(grid_name)) {
+      delete file;
+      return 0;
+    }
+  }
+
+  // Print statistics
+  if (print_verbose) {
+    const R3Grid *grid = finder.PocketGrid();
+    fprintf(stderr, "Found pockets in %s ...\n", filename);
+    fprintf(stderr, "  Time = %.2f seconds\n", start_time.Elapsed());
+    fprintf(stderr, "  # Atoms = %d\n", model->NAtoms());
+    fprintf(stderr, "  # Pockets = %d\n", finder.NPockets());
+    fprintf(stderr, "  Grid resolution = %d %d %d\n", grid->XResolution(), grid->YResolution(), grid->ZResolution());
+    fflush(stderr);
+  }
+
+  // Delete PDB file
+  delete file;
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+ParseArgs(int argc, char **argv)
+{
+  // Check number of arguments
+  if (argc < 2) {
+    fprintf(stderr, "Usage: pdbpockets pdbfile [pdbfile ...] [-output txtfile] [-grid grdfile] [options]\n");
+    return 0;
+  }
+
+  // Parse arguments
+  argc--; argv++;
+  while (argc > 0) {
+    if ((*argv)[0] == '-') {
+      if (!strcmp(*argv, "-v")) print_verbose = 1;
+      else if (!strcmp(*argv, "-hetatoms_occupy")) hetatoms_occupy = 1;
+      else if (!strcmp(*argv, "-output")) { argc--; argv++; output_name = *argv; }
+      else if (!strcmp(*argv, "-grid")) { argc--; argv++; grid_name = *argv; }
+      else if (!strcmp(*argv, "-spacing")) { argc--; argv++; grid_spacing = atof(*argv); }
+      else if (!strcmp(*argv, "-directions")) { argc--; argv++; ndirections = atoi(*argv); }
+      else if (!strcmp(*argv, "-max_ray_length")) { argc--; argv++; max_ray_length = atof(*argv); }
+      else if (!strcmp(*argv, "-min_buriedness")) { argc--; argv++; min_buriedness = atof(*argv); }
+      else if (!strcmp(*argv, "-min_volume")) { argc--; argv++; min_volume = atof(*argv); }
+      else if (!strcmp(*argv, "-lining_distance")) { argc--; argv++; lining_distance = atof(*argv); }
+      else if (!strcmp(*argv, "-max_pockets")) { argc--; argv++; max_pockets = atoi(*argv); }
+      else if (!strcmp(*argv, "-threads")) { argc--; argv++; nthreads = atoi(*argv); }
+      else { fprintf(stderr, "Invalid program argument: %s", *argv); exit(1); }
+    }
+    else {
+      input_names.Insert(*argv);
+    }
+    argv++; argc--;
+  }
+
+  // Check input filenames
+  if (input_names.IsEmpty()) {
+    fprintf(stderr, "You did not specify an input pdb file.\n");
+    return 0;
+  }
+
+  // Check grid filename
+  if (grid_name && (input_names.NEntries() > 1)) {
+    fprintf(stderr, "Pocket grid can only be written for one input pdb file.\n");
+    return 0;
+  }
+
+  // Return OK status
+  return 1;
+}
+
+
+
+int
+main(int argc, char **argv)
+{
+  // Parse program arguments
+  if (!ParseArgs(argc, argv)) exit(-1);
+
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Open output file
+  FILE *fp = stdout;
+  if (output_name) {
+    fp = fopen(output_name, "w");
+    if (!fp) {
+      fprintf(stderr, "Unable to open output file %s\n", output_name);
+      exit(-1);
+    }
+  }
+
+  // Print header
+  fprintf(fp, "# file model rank volume buriedness score cx cy cz nresidues residues\n");
+
+  // Find pockets in every input file
+  int nfiles = 0;
+  for (int i = 0; i < input_names.NEntries(); i++) {
+    if (FindPockets(fp, input_names[i])) nfiles++;
+  }
+
+  // Close output file
+  if (output_name) fclose(fp);
+
+  // Print statistics
+  if (print_verbose) {
+    fprintf(stderr, "Processed %d of %d files in %.2f seconds\n", nfiles, input_names.NEntries(), start_time.Elapsed());
+  }
+
+  // Return success
+  return (nfiles == input_names.NEntries()) ? 0 : -1;
+}
@@ -18,6 +18,7 @@ static const char *input_mesh_name = NULL;
 static const char *input_properties_name = NULL;
 static const char *output_properties_name = NULL;
 static int parameters_in_relative_units = 1;
+static int multiscale_method = R3_MESH_PROPERTY_DIJKSTRA_SMOOTHING;
 static int print_verbose = 0;
 static int print_debug = 0;
 
@@ -548,43 +549,27 @@ Multiscale(R3MeshPropertySet *properties, const char *property_name, int& argc,
     }
   }
 
+  // Compute scales
+  RNScalar *sigmas = new RNScalar [ nscales ];
+  sigmas[0] = sigma0;
+  for (int j = 1; j < nscales; j++) sigmas[j] = sigmas[j-1] * scale_factor;
+
   // Compute multiscale properties
-  for (int k = 0; k < mesh->NVertices(); k++) {
-    R3MeshVertex *vertex = mesh->Vertex(k);
-
-    // Compute distances
-    RNLength *distances = mesh->DijkstraDistances(vertex);
-
-    // Consider all properties
-    for (int i = 0; i < subset.NEntries(); i++) {
-      RNScalar sigma = sigma0;
-      for (int j = 0; j < nscales; j++) {
-        // Compute blurred values
-        RNScalar total_value = 0;
-        RNScalar total_weight = 0;
-        RNScalar denom = -2 * sigma * sigma;
-        for (int m = 0; m < mesh->NVertices(); m++) {
-          RNLength distance = distances[m];
-          if (distance > 3 * sigma) continue;
-          RNScalar value = subset[i]->VertexValue(m);;
-          RNScalar weight = exp(distance * distance / denom); 
-          total_value += weight * value;
-          total_weight += weight;
-        }
-
-        // Assign blurred value (normalized by total weight)
-        if (total_weight > 0) {
-          blurs[i][j]->SetVertexValue(k, total_value / total_weight);
-        }
-
-        // Update sigma
-        sigma *= scale_factor;
-      }
+  R3MeshPropertySmoother smoother(mesh, multiscale_method);
+  R3MeshProperty **results = new R3MeshProperty * [ subset.NEntries() * nscales ];
+  for (int i = 0; i < subset.NEntries(); i++) {
+    for (int j = 0; j < nscales; j++) {
+      results[i*nscales + j] = blurs[i][j];
     }
-
-    // Delete distances
-    delete [] distances;
   }
+  if (!smoother.Smooth(subset, sigmas, nscales, results)) {
+    fprintf(stderr, "Unable to compute multiscale properties\n");
+    exit(-1);
+  }
+
+  // Delete scales
+  delete [] results;
+  delete [] sigmas;
 
   // Insert multiscale properties
   for (int i = 0; i < subset.NEntries(); i++) {
@@ -658,6 +643,15 @@ ApplyOperations(R3Mesh *mesh, R3MeshPropertySet *properties, int argc, char **ar
       properties->SortByName();
       count++;
     }
+    else if (!strcmp(*argv, "-multiscale_method")) {
+      argv++; argc--; const char *method_name = *argv;
+      if (!strcmp(method_name, "dijkstra")) multiscale_method = R3_MESH_PROPERTY_DIJKSTRA_SMOOTHING;
+      else if (!strcmp(method_name, "heat")) multiscale_method = R3_MESH_PROPERTY_HEAT_SMOOTHING;
+      else { fprintf(stderr, "Invalid multiscale method: %s\n", method_name); return 0; }
+    }
+    else if (!strcmp(*argv, "-threads")) {
+      argv++; argc--; RNSetNumberOfThreads(atoi(*argv));
+    }
     else if (!strcmp(*argv, "-parameters_in_absolute_units")) {
       parameters_in_relative_units = 0;
     }
@@ -700,6 +694,11 @@ int ParseArgs(int argc, char **argv)
     else if (!strcmp(argv[i], "-debug")) print_debug = 1; 
     else if (!strcmp(argv[i], "-parameters_in_absolute_units")) parameters_in_relative_units = 0; 
     else if (!strcmp(argv[i], "-parameters_in_relative_units")) parameters_in_relative_units = 1; 
+    else if (!strcmp(argv[i], "-multiscale_method") && (i+1 < argc)) {
+      if (!strcmp(argv[i+1], "heat")) multiscale_method = R3_MESH_PROPERTY_HEAT_SMOOTHING;
+      else multiscale_method = R3_MESH_PROPERTY_DIJKSTRA_SMOOTHING;
+    }
+    else if (!strcmp(argv[i], "-threads") && (i+1 < argc)) RNSetNumberOfThreads(atoi(argv[i+1]));
   }
 
   // Return OK status 
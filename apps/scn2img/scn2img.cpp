@@ -48,6 +48,7 @@ static int capture_boundary_images = 0;
 static int capture_room_surface_images = 0;
 static int capture_room_boundary_images = 0;
 static int capture_vrgb_images = 0;
+static int capture_variance_images = 0;
 
 
 // Other parameter program variables
@@ -71,6 +72,15 @@ static RNScalar kinect_noise_fraction = 0.05;
 static RNScalar kinect_stereo_baseline = 0.075;
 
 
+// Path tracing program variables (color, albedo, and variance images with -raycast)
+
+static int path_samples = 16;
+static RNScalar path_max_time = 0;
+static int path_max_depth = 3;
+static unsigned int path_seed = 0;
+static int nthreads = 0;
+
+
 // Informational program variables
 
 static int print_verbose = 0;
@@ -1309,6 +1319,36 @@ RenderImagesWithRaycasting(const R3Camera& camera, R3Scene *scene, const char *o
   R2Grid material_image(width, height);
   R2Grid node_image(width, height);
   R2Grid category_image(width, height);
+  R2Image color_image(width, height, 3);
+  R2Grid variance_image(width, height);
+
+  // Path trace color, albedo, and variance images
+  if (capture_color_images || capture_albedo_images || capture_variance_images) {
+    static R3PathTracer *tracer = NULL;
+    if (!tracer) {
+      tracer = new R3PathTracer(scene);
+      tracer->SetMaxSamplesPerPixel(path_samples);
+      tracer->SetMaxTime(path_max_time);
+      tracer->SetMaxDepth(path_max_depth);
+      tracer->SetSeed(path_seed);
+      tracer->SetNThreads(nthreads);
+      scene->SetBackground(background);
+    }
+    tracer->Reset(viewer);
+    int nsamples = tracer->Render();
+    if (nsamples == 0) return 0;
+    for (int iy = 0; iy < height; iy++) {
+      for (int ix = 0; ix < width; ix++) {
+        color_image.SetPixelRGB(ix, iy, tracer->PixelColor(ix, iy));
+        albedo_image.SetPixelRGB(ix, iy, tracer->PixelAlbedo(ix, iy));
+        variance_image.SetGridValue(ix, iy, tracer->PixelVariance(ix, iy));
+      }
+    }
+    if (print_debug) {
+      printf("    Path traced %d samples per pixel\n", nsamples);
+      fflush(stdout);
+    }
+  }
   
   // Cast ray for every pixel
   for (int iy = 0; iy < height; iy++) {
@@ -1368,6 +1408,18 @@ RenderImagesWithRaycasting(const R3Camera& camera, R3Scene *scene, const char *o
   }
   
   // Write images
+  if (capture_color_images) {
+    sprintf(output_image_filename, "%s/%06d_color.jpg", output_image_directory, image_index);
+    color_image.Write(output_image_filename);
+  }
+  if (capture_albedo_images) {
+    sprintf(output_image_filename, "%s/%06d_albedo.jpg", output_image_directory, image_index);
+    albedo_image.Write(output_image_filename);
+  }
+  if (capture_variance_images) {
+    sprintf(output_image_filename, "%s/%06d_variance.pfm", output_image_directory, image_index);
+    variance_image.WriteFile(output_image_filename);
+  }
   if (capture_depth_images) {
     sprintf(output_image_filename, "%s/%06d_depth.png", output_image_directory, image_index);
     depth_image.WriteFile(output_image_filename);
@@ -1505,12 +1557,18 @@ ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-capture_room_surface_images")) { capture_images = capture_room_surface_images = 1; }
       else if (!strcmp(*argv, "-capture_room_boundary_images")) { capture_images = capture_room_boundary_images = 1; }
       else if (!strcmp(*argv, "-capture_vrgb_images")) { capture_images = capture_vrgb_images = 1; }
+      else if (!strcmp(*argv, "-capture_variance_images")) { capture_images = capture_variance_images = 1; }
       else if (!strcmp(*argv, "-categories")) { argc--; argv++; input_categories_name = *argv; capture_category_images = 1; }
       else if (!strcmp(*argv, "-kinect_min_depth")) { argc--; argv++; kinect_min_depth = atof(*argv); }
       else if (!strcmp(*argv, "-kinect_max_depth")) { argc--; argv++; kinect_max_depth = atof(*argv); }
       else if (!strcmp(*argv, "-kinect_min_reflection")) { argc--; argv++; kinect_min_reflection = atof(*argv); }
       else if (!strcmp(*argv, "-kinect_noise_fraction")) { argc--; argv++; kinect_noise_fraction = atof(*argv); }
       else if (!strcmp(*argv, "-kinect_stereo_baseline")) { argc--; argv++; kinect_stereo_baseline = atof(*argv); }
+      else if (!strcmp(*argv, "-path_samples")) { argc--; argv++; path_samples = atoi(*argv); }
+      else if (!strcmp(*argv, "-path_max_time")) { argc--; argv++; path_max_time = atof(*argv); }
+      else if (!strcmp(*argv, "-path_max_depth")) { argc--; argv++; path_max_depth = atoi(*argv); }
+      else if (!strcmp(*argv, "-path_seed")) { argc--; argv++; path_seed = atoi(*argv); }
+      else if (!strcmp(*argv, "-threads")) { argc--; argv++; nthreads = atoi(*argv); }
       else if (!strcmp(*argv, "-max_vertex_spacing")) { argc--; argv++; max_vertex_spacing = atof(*argv); }
       else if (!strcmp(*argv, "-width")) { argc--; argv++; width = atoi(*argv); }
       else if (!strcmp(*argv, "-height")) { argc--; argv++; height = atoi(*argv); }
@@ -220,95 +220,42 @@ ReadMatrix(R4Matrix& m, const char *filename)
 // PROCESSING
 ////////////////////////////////////////////////////////////////////////
 
-static void
-CountOverlapAreas(R3SceneNode *node, R3Grid *grid, const R3Affine& parent_transformation, RNArea& overlap_area, RNArea& total_area)
+static RNBoolean
+SelectRemovedNodes(R3Scene *scene, R3SceneNode *node,
+  R3SceneNode *select_subtree_node, R3Grid *select_grid, const R3Box& select_bbox,
+  const RNArea *overlap_areas, const RNArea *total_areas, RNArray<R3SceneNode *>& removed_nodes)
 {
-  // Update transformation
-  R3Affine transformation = R3identity_affine;
-  transformation.Transform(parent_transformation);
-  transformation.Transform(node->Transformation());
-
-  // Count overlapping triangle areas in references
-  for (int i = 0; i < node->NReferences(); i++) {
-    R3SceneReference *reference = node->Reference(i);
-    R3Scene *referenced_scene = reference->ReferencedScene();
-    CountOverlapAreas(referenced_scene->Root(), grid, transformation, overlap_area, total_area);
-  }
-
-  // Count overlapping triangle areas in elements
-  for (int i = 0; i < node->NElements(); i++) {
-    R3SceneElement *element = node->Element(i);
-    for (int j = 0; j < element->NShapes(); j++) {
-      R3Shape *shape = element->Shape(j);
-      if (shape->ClassID() == R3TriangleArray::CLASS_ID()) {
-        R3TriangleArray *triangles = (R3TriangleArray *) shape;
-        for (int k = 0; k < triangles->NTriangles(); k++) {
-          R3Triangle *triangle = triangles->Triangle(k);
-          R3Point centroid = triangle->Centroid();
-          centroid.Transform(transformation);
-          RNScalar grid_value = grid->WorldValue(centroid);
-          RNArea area = triangle->Area();
-          if (grid_value > RN_EPSILON) overlap_area += area;
-          total_area += area;
-        }
-      }
-    }
-  }
-  
-  // Count overlapping triangle areas in children
+  // Visit children recursively (nodes are deleted later, so scene indices stay valid)
+  int nremaining_children = node->NChildren();
   for (int i = 0; i < node->NChildren(); i++) {
     R3SceneNode *child = node->Child(i);
-    CountOverlapAreas(child, grid, transformation, overlap_area, total_area);
-  }
-}
-
-
-
-static RNScalar
-Overlap(R3SceneNode *node, R3Grid *grid)
-{
-  RNScalar overlap_area = 0;
-  RNScalar total_area = 0;
-  R3Affine parent_transformation = node->CumulativeParentTransformation();
-  CountOverlapAreas(node, grid, parent_transformation, overlap_area, total_area);
-  if (total_area < RN_EPSILON) return 0;
-  return overlap_area / total_area;
-}
-
-
-
-static void
-RemoveNodes(R3Scene *scene, R3SceneNode *node,
-  R3SceneNode *select_subtree_node, R3Grid *select_grid, const R3Box& select_bbox)
-{
-  // Copy array of children -- because will be edited as iterate
-  RNArray<R3SceneNode *> children;
-  for (int i = 0; i < node->NChildren(); i++) {
-    R3SceneNode *child = node->Child(i);
-    children.Insert(child);
-  }
-
-  // Visit children recursively 
-  for (int i = 0; i < children.NEntries(); i++) {
-    R3SceneNode *child = children.Kth(i);
-    RemoveNodes(scene, child, select_subtree_node, select_grid, select_bbox);
+    if (SelectRemovedNodes(scene, child, select_subtree_node, select_grid, select_bbox,
+      overlap_areas, total_areas, removed_nodes)) nremaining_children--;
   }
 
   // Check if node must remain
-  if (node == scene->Root()) return;
-  if (node->NChildren() > 0) return;
+  if (node == scene->Root()) return FALSE;
+  if (nremaining_children > 0) return FALSE;
 
   // Innocent until proven guilty
   RNBoolean remove = FALSE;
 
   // Check if should remove based on emptiness
-  if ((node->NChildren() == 0) && (node->NReferences() == 0) && (node->NElements() == 0)) {
+  if ((node->NReferences() == 0) && (node->NElements() == 0)) {
     remove = TRUE;
   }
 
   // Check if should remove based on bbox selection
   if (!select_bbox.IsEmpty()) {
-    if (!R3Intersects(node->WorldBBox(), select_bbox)) {
+    R3Box world_bbox = node->WorldBBox();
+    if (nremaining_children < node->NChildren()) {
+      // Exclude children that will be removed
+      world_bbox = R3null_box;
+      for (int i = 0; i < node->NElements(); i++) world_bbox.Union(node->Element(i)->BBox());
+      for (int i = 0; i < node->NReferences(); i++) world_bbox.Union(node->Reference(i)->BBox());
+      world_bbox.Transform(node->CumulativeTransformation());
+    }
+    if (!R3Intersects(world_bbox, select_bbox)) {
       remove = TRUE;
     }
   }
@@ -327,15 +274,17 @@ RemoveNodes(R3Scene *scene, R3SceneNode *node,
   // Check if should remove based on grid selection
   if (select_grid) {
     RNArea min_overlap = 0.5;
-    RNScalar overlap = Overlap(node, select_grid);
+    RNArea total_area = total_areas[node->SceneIndex()];
+    RNScalar overlap = (total_area > RN_EPSILON) ? overlap_areas[node->SceneIndex()] / total_area : 0.0;
     if (overlap < min_overlap) remove = TRUE;
     // R3Point centroid = node->WorldBBox().Centroid();
     // RNScalar grid_value = select_grid->WorldValue(centroid);
     // if (RNIsNegativeOrZero(grid_value)) remove = TRUE;
   }
   
-  // Delete node 
-  if (remove) delete node;
+  // Remember node to delete
+  if (remove) removed_nodes.Insert(node);
+  return remove;
 }
 
 
@@ -360,8 +309,45 @@ RemoveNodes(R3Scene *scene)
     if (!select_grid) return 0;
   }
 
-  // Remove nodes recursively in post order
-  RemoveNodes(scene, scene->Root(), select_subtree_node, select_grid, select_nodes_in_bbox);
+  // Compute overlaps of elements and references of every node with grid in one pass
+  // (nodes are only tested after all their children have been removed)
+  RNArea *overlap_areas = NULL;
+  RNArea *total_areas = NULL;
+  if (select_grid) {
+    int nnodes = scene->NNodes();
+    RNArea *subtree_overlap_areas = new RNArea [ nnodes ];
+    RNArea *subtree_total_areas = new RNArea [ nnodes ];
+    scene->ComputeNodeOverlaps(*select_grid, subtree_overlap_areas, subtree_total_areas);
+    overlap_areas = new RNArea [ nnodes ];
+    total_areas = new RNArea [ nnodes ];
+    for (int i = 0; i < nnodes; i++) {
+      R3SceneNode *node = scene->Node(i);
+      overlap_areas[i] = subtree_overlap_areas[i];
+      total_areas[i] = subtree_total_areas[i];
+      for (int j = 0; j < node->NChildren(); j++) {
+        R3SceneNode *child = node->Child(j);
+        overlap_areas[i] -= subtree_overlap_areas[child->SceneIndex()];
+        total_areas[i] -= subtree_total_areas[child->SceneIndex()];
+      }
+    }
+    delete [] subtree_overlap_areas;
+    delete [] subtree_total_areas;
+  }
+
+  // Select nodes to remove in post order
+  RNArray<R3SceneNode *> removed_nodes;
+  SelectRemovedNodes(scene, scene->Root(), select_subtree_node, select_grid, select_nodes_in_bbox,
+    overlap_areas, total_areas, removed_nodes);
+
+  // Delete removed nodes (children before parents)
+  for (int i = 0; i < removed_nodes.NEntries(); i++) {
+    R3SceneNode *node = removed_nodes.Kth(i);
+    delete node;
+  }
+
+  // Delete overlaps
+  if (overlap_areas) delete [] overlap_areas;
+  if (total_areas) delete [] total_areas;
 
   // Return success
   return 1;
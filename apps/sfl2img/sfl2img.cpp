@@ -27,6 +27,9 @@ static int write_graph_grids = 0;
 static int write_planar_grids = 0;
 static int write_pixel_grids = 0;
 static int write_horizontal_grids = 0;
+static int write_label_grids = 0;
+static int tile_size = 0;
+static int nthreads = 0;
 static double chunk_size = 20;
 static int print_verbose = 0;
 static int print_debug = 0;
@@ -117,15 +120,16 @@ CloseScene(R3SurfelScene *scene)
 ////////////////////////////////////////////////////////////////////////
 
 static void
-InitializeOverheadGrid(R2Grid& grid, R3SurfelScene *scene, RNScalar pixel_spacing, int max_resolution, RNScalar initial_value)
+ComputeOverheadGridTransformation(R3SurfelScene *scene, RNScalar pixel_spacing, int max_resolution, 
+  int& nxpixels, int& nypixels, R2Affine& world_to_grid)
 {
   // Compute bounding box
   const R3Box& scene_bbox = scene->BBox();
   R2Box bbox(scene_bbox[0][0], scene_bbox[0][1], scene_bbox[1][0], scene_bbox[1][1]);
 
   // Compute pixel resolution
-  int nxpixels = (int) (bbox.XLength() / pixel_spacing);
-  int nypixels = (int) (bbox.YLength() / pixel_spacing);
+  nxpixels = (int) (bbox.XLength() / pixel_spacing);
+  nypixels = (int) (bbox.YLength() / pixel_spacing);
   if (nxpixels == 0) nxpixels = 1;
   if (nypixels == 0) nypixels = 1;
   if (nxpixels > max_resolution) {
@@ -139,14 +143,19 @@ InitializeOverheadGrid(R2Grid& grid, R3SurfelScene *scene, RNScalar pixel_spacin
     nypixels = (int) (bbox.YLength() / pixel_spacing);
   }
 
-  // Set grid resolution
-  grid.Resample(nxpixels, nypixels);
-
-  // Set grid transformation
-  grid.SetWorldToGridTransformation(bbox);
-
-  // Set initial values
-  grid.Clear(initial_value);
+  // Compute transformation mapping bbox onto grid (same as R2Grid::SetWorldToGridTransformation)
+  R2Vector grid_diagonal(nxpixels-1, nypixels-1);
+  R2Vector world_diagonal(bbox.XLength(), bbox.YLength());
+  RNScalar scale = FLT_MAX;
+  RNScalar xscale = (world_diagonal[0] > 0) ? grid_diagonal[0] / world_diagonal[0] : FLT_MAX;
+  if (xscale < scale) scale = xscale;
+  RNScalar yscale = (world_diagonal[1] > 0) ? grid_diagonal[1] / world_diagonal[1] : FLT_MAX;
+  if (yscale < scale) scale = yscale;
+  if (scale == FLT_MAX) scale = 1;
+  world_to_grid = R2identity_affine;
+  world_to_grid.Translate(0.5 * grid_diagonal);
+  if (scale != 1) world_to_grid.Scale(scale);
+  world_to_grid.Translate(-(bbox.Centroid().Vector()));
 }
 
 
@@ -231,905 +240,911 @@ WriteImage(const R2Grid& red, const R2Grid& green, const R2Grid& blue,
 
 
 ////////////////////////////////////////////////////////////////////////
-// Base image functions
+// Overhead rasterization functions
 ////////////////////////////////////////////////////////////////////////
 
-static int
-WriteBaseGrids(R3SurfelScene *scene, const char *directory_name)
+// Maximum number of neighbors in graph neighborhoods
+static const int max_overhead_neighbors = 16;
+
+// Minimum number of points in pixel neighborhoods
+static const int min_overhead_points_per_pixel = 4;
+
+// Indices of height grids (pixel grids start with the same statistics)
+enum {
+  HEIGHT_COUNT_GRID,
+  HEIGHT_NEIGHBORHOOD_COUNT_GRID,
+  HEIGHT_ZMIN_GRID,
+  HEIGHT_ZMAX_GRID,
+  HEIGHT_ZMEAN_GRID,
+  HEIGHT_ZMEDIAN_GRID,
+  HEIGHT_ZSTDDEV_GRID,
+  HEIGHT_ZSUPPORT_GRID,
+  NUM_HEIGHT_GRIDS
+};
+
+// Indices of pixel grids
+enum {
+  PIXEL_GRAPH_COUNT_GRID = NUM_HEIGHT_GRIDS,
+  PIXEL_GRAPH_RADIUS_GRID,
+  PIXEL_PCA0_GRID,
+  PIXEL_PCA1_GRID,
+  PIXEL_PCA2_GRID,
+  PIXEL_NORMAL_X_GRID,
+  PIXEL_NORMAL_Y_GRID,
+  PIXEL_NORMAL_Z_GRID,
+  NUM_PIXEL_GRIDS
+};
+
+// Indices of graph grids (all grids after GRAPH_ZSUM_GRID are averaged)
+enum {
+  GRAPH_COUNT_GRID,
+  GRAPH_ZMIN_GRID,
+  GRAPH_ZMAX_GRID,
+  GRAPH_ZSUM_GRID,
+  GRAPH_PCA0_GRID,
+  GRAPH_PCA1_GRID,
+  GRAPH_PCA2_GRID,
+  GRAPH_NORMAL_X_GRID,
+  GRAPH_NORMAL_Y_GRID,
+  GRAPH_NORMAL_Z_GRID,
+  GRAPH_HORIZONTAL_GRID,
+  GRAPH_VERTICAL_GRID,
+  GRAPH_OBLIQUE_GRID,
+  GRAPH_PLANAR_GRID,
+  GRAPH_NEIGHBOR_RADIUS_GRID,
+  NUM_GRAPH_GRIDS
+};
+
+struct OverheadBlock {
+  R3SurfelBlock *block;
+  RNScalar label_identifier;
+  int ixmin, iymin, ixmax, iymax;
+  int first_tile, last_tile;
+};
+
+struct OverheadSample {
+  OverheadBlock *block;
+  const R3Surfel *surfel;
+  R3Point position;
+};
+
+struct OverheadTile {
+  int ix, iy;
+  int xmin, ymin, xresolution, yresolution;
+  int wxmin, wymin, wxresolution, wyresolution;
+  RNArray<OverheadBlock *> blocks;
+  OverheadSample *samples;
+  int *pixel_offsets;
+  int *block_offsets;
+  int *sample_pixels;
+  R2Grid *count_grid;
+  R2Grid *zmin_grid;
+  R2Grid *zmax_grid;
+  R2Grid *zmean_grid;
+  R2Grid *radius_grid;
+  R2Grid *nx_grid;
+  R2Grid *ny_grid;
+  R2Grid *nz_grid;
+  R2Grid *horizontal_grid;
+  R2Grid *red_grid;
+  R2Grid *green_grid;
+  R2Grid *blue_grid;
+  R2Grid *label_grid;
+  R2Grid *slice_grids;
+  R2Grid *height_grids;
+  R2Grid *pixel_grids;
+  R2Grid *graph_grids;
+};
+
+struct OverheadRasterizer {
+  R2Affine world_to_grid;
+  int xresolution, yresolution;
+  RNLength pixel_size;
+  int nslices;
+  RNScalar slice_zmin, slice_zscale;
+  RNLength region_radius, graph_radius;
+  int halo;
+  int band_size;
+  OverheadTile *tiles;
+  int *work_tiles;
+  int *work_indices;
+};
+
+
+
+static void
+CreateOverheadTileGrids(OverheadRasterizer *rasterizer, OverheadTile *tile)
 {
-  // Start statistics
-  RNTime start_time;
-  start_time.Read();
-  if (print_verbose) {
-    printf("Creating base images ...\n");
-    fflush(stdout);
+  // Compute tile transformation (shifts global grid coordinates to tile)
+  R2Affine tile_world_to_grid(R2identity_affine);
+  tile_world_to_grid.Translate(R2Vector(-tile->xmin, -tile->ymin));
+  tile_world_to_grid.Transform(rasterizer->world_to_grid);
+
+  // Create prototype grid
+  R2Grid grid(tile->xresolution, tile->yresolution, tile_world_to_grid);
+  grid.Clear(R2_GRID_UNKNOWN_VALUE);
+
+  // Create base grids
+  tile->count_grid = tile->zmin_grid = tile->zmean_grid = tile->radius_grid = NULL;
+  tile->nx_grid = tile->ny_grid = tile->nz_grid = tile->horizontal_grid = NULL;
+  if (write_base_grids) {
+    tile->count_grid = new R2Grid(grid);
+    tile->zmin_grid = new R2Grid(grid);
+    tile->zmean_grid = new R2Grid(grid);
+    tile->radius_grid = new R2Grid(grid);
+    tile->nx_grid = new R2Grid(grid);
+    tile->ny_grid = new R2Grid(grid);
+    tile->nz_grid = new R2Grid(grid);
+    tile->horizontal_grid = new R2Grid(grid);
   }
-    
-  // Create grids
-  R2Grid count_grid; 
-  InitializeOverheadGrid(count_grid, scene, pixel_spacing, max_resolution, R2_GRID_UNKNOWN_VALUE);
-  R2Grid zmin_grid(count_grid);
-  R2Grid zmax_grid(count_grid);
-  R2Grid zmean_grid(count_grid);
-  R2Grid radius_grid(count_grid);
-  R2Grid nx_grid(count_grid);
-  R2Grid ny_grid(count_grid);
-  R2Grid nz_grid(count_grid);
-  R2Grid horizontal_grid(count_grid);
-
-  // Fill grids
-  int node_count = 0;
-  R3SurfelTree *tree = scene->Tree();
-  if (!tree) return 0;
-  R3SurfelDatabase *database = tree->Database();
-  if (!database) return 0;
-  RNArray<R3SurfelNode *> stack;
-  stack.Insert(tree->RootNode());
-  while (!stack.IsEmpty()) {
-    R3SurfelNode *node = stack.Tail();
-    stack.RemoveTail();
 
-    // Print debug statement
-    node_count++;
-    if (print_debug) {
-      static int next_node_count = 1;
-      if (node_count == next_node_count) {
-        int node_step = tree->NNodes() / 10;
-        if (node_step < 100) node_step = 100;
-        next_node_count += node_step;
-        printf("%.0f%%\n", 100.0 * node_count / (double) tree->NNodes());
-        fflush(stdout);
-      }
-    }
-      
-    // Check if node is not a leaf
-    if (node->NParts() > 0) { // (node->NBlocks() == 0) || (node->Resolution() < 10 / pixel_spacing)) {
-      // Decend into children
-      for (int i = 0; i < node->NParts(); i++) {
-        R3SurfelNode *part = node->Part(i);
-        stack.Insert(part);
-      }
-    }
-    else {
-      // Prcoess blocks
-      for (int i = 0; i < node->NBlocks(); i++) {
-        R3SurfelBlock *block = node->Block(i);
-        const R3Point& origin = block->Origin();
-
-        // Read block
-        database->ReadBlock(block);
-
-        // Process surfels
-        for (int j = 0; j < block->NSurfels(); j++) {
-          const R3Surfel *surfel = block->Surfel(j);
-
-          // Get world coordinates
-          double px = origin.X() + surfel->X();
-          double py = origin.Y() + surfel->Y();
-          double pz = origin.Z() + surfel->Z();
-
-          // Get normal
-          float nx = surfel->NX();
-          float ny = surfel->NY();
-          float nz = surfel->NZ();
-
-          // Get radius
-          float radius = surfel->Radius();
-
-          // Get grid coordinates
-          R2Point grid_position = count_grid.GridPosition(R2Point(px, py));
-          int ix = (int) (grid_position.X() + 0.5);
-          int iy = (int) (grid_position.Y() + 0.5);
-          if ((ix < 0) || (ix >= count_grid.XResolution())) continue;
-          if ((iy < 0) || (iy >= count_grid.YResolution())) continue;
-
-          // Update count grid
-          count_grid.AddGridValue(ix, iy, 1);
-
-          // Update zmin grid
-          RNScalar zmin = zmin_grid.GridValue(ix, iy);
-          if ((zmin == R2_GRID_UNKNOWN_VALUE) || (pz < zmin)) {
-            zmin_grid.SetGridValue(ix, iy, pz);
-          }
- 
-          // Update zmax grid (and rgb)
-          RNScalar zmax = zmax_grid.GridValue(ix, iy);
-          if ((zmax == R2_GRID_UNKNOWN_VALUE) || (pz > zmax)) {
-            zmax_grid.SetGridValue(ix, iy, pz);
-          }
+  // Create zmax grid (needed to find top surfel for color and label grids)
+  tile->zmax_grid = NULL;
+  if (write_base_grids || write_color_grids || write_label_grids) {
+    tile->zmax_grid = new R2Grid(grid);
+  }
 
-          // Update other grids
-          zmean_grid.AddGridValue(ix, iy, pz);
-          nx_grid.AddGridValue(ix, iy, nx);
-          ny_grid.AddGridValue(ix, iy, ny);
-          nz_grid.AddGridValue(ix, iy, nz);
-          radius_grid.AddGridValue(ix, iy, radius);
-          horizontal_grid.AddGridValue(ix, iy, fabs(nz));
-        }
+  // Create color grids
+  tile->red_grid = tile->green_grid = tile->blue_grid = NULL;
+  if (write_color_grids) {
+    tile->red_grid = new R2Grid(grid);
+    tile->green_grid = new R2Grid(grid);
+    tile->blue_grid = new R2Grid(grid);
+  }
 
-        // Release block
-        database->ReleaseBlock(block);
-      }
-    }
+  // Create label grid
+  tile->label_grid = NULL;
+  if (write_label_grids) {
+    tile->label_grid = new R2Grid(grid);
   }
 
-  // Divide by counts to get averages
-  zmean_grid.Divide(count_grid);
-  nx_grid.Divide(count_grid);
-  ny_grid.Divide(count_grid);
-  nz_grid.Divide(count_grid);
-  radius_grid.Divide(count_grid);
-  horizontal_grid.Divide(count_grid);
+  // Create slice grids
+  tile->slice_grids = NULL;
+  if (rasterizer->nslices > 0) {
+    tile->slice_grids = new R2Grid [ rasterizer->nslices ];
+    for (int i = 0; i < rasterizer->nslices; i++) tile->slice_grids[i] = grid;
+  }
 
-  // Write grids
-  if (!WriteGrid(count_grid, directory_name, "Base", "Count")) return 0;
-  if (!WriteGrid(zmin_grid, directory_name, "Base", "ZMin")) return 0;
-  if (!WriteGrid(zmax_grid, directory_name, "Base", "ZMax")) return 0;
-  if (!WriteGrid(zmean_grid, directory_name, "Base", "ZMean")) return 0;
-  if (!WriteGrid(nx_grid, directory_name, "Base", "NX")) return 0;
-  if (!WriteGrid(ny_grid, directory_name, "Base", "NY")) return 0;
-  if (!WriteGrid(nz_grid, directory_name, "Base", "NZ")) return 0;
-  if (!WriteGrid(radius_grid, directory_name, "Base", "Radius")) return 0;
-  if (!WriteGrid(horizontal_grid, directory_name, "Base", "Horizontal")) return 0;
+  // Create height grids
+  tile->height_grids = NULL;
+  if (write_height_grids) {
+    tile->height_grids = new R2Grid [ NUM_HEIGHT_GRIDS ];
+    for (int i = 0; i < NUM_HEIGHT_GRIDS; i++) tile->height_grids[i] = grid;
+  }
 
-  // Print statistics
-  if (print_verbose) {
-    printf("  Time = %.2f seconds\n", start_time.Elapsed());
-    printf("  Resolution = %d %d\n", count_grid.XResolution(), count_grid.YResolution());
-    printf("  Spacing = %g\n", count_grid.WorldToGridScaleFactor());
-    fflush(stdout);
+  // Create pixel grids
+  tile->pixel_grids = NULL;
+  if (write_pixel_grids) {
+    tile->pixel_grids = new R2Grid [ NUM_PIXEL_GRIDS ];
+    for (int i = 0; i < NUM_PIXEL_GRIDS; i++) tile->pixel_grids[i] = grid;
   }
 
-  // Return success
-  return 1;
+  // Create graph grids (sums start at zero)
+  tile->graph_grids = NULL;
+  if (write_graph_grids) {
+    R2Grid zero_grid(tile->xresolution, tile->yresolution, tile_world_to_grid);
+    tile->graph_grids = new R2Grid [ NUM_GRAPH_GRIDS ];
+    for (int i = 0; i < NUM_GRAPH_GRIDS; i++) {
+      if ((i == GRAPH_ZMIN_GRID) || (i == GRAPH_ZMAX_GRID)) tile->graph_grids[i] = grid;
+      else tile->graph_grids[i] = zero_grid;
+    }
+  }
 }
 
 
 
-////////////////////////////////////////////////////////////////////////
-// Color image functions
-////////////////////////////////////////////////////////////////////////
+static void
+DeleteOverheadTileGrids(OverheadTile *tile)
+{
+  // Delete grids
+  if (tile->count_grid) delete tile->count_grid;
+  if (tile->zmin_grid) delete tile->zmin_grid;
+  if (tile->zmax_grid) delete tile->zmax_grid;
+  if (tile->zmean_grid) delete tile->zmean_grid;
+  if (tile->radius_grid) delete tile->radius_grid;
+  if (tile->nx_grid) delete tile->nx_grid;
+  if (tile->ny_grid) delete tile->ny_grid;
+  if (tile->nz_grid) delete tile->nz_grid;
+  if (tile->horizontal_grid) delete tile->horizontal_grid;
+  if (tile->red_grid) delete tile->red_grid;
+  if (tile->green_grid) delete tile->green_grid;
+  if (tile->blue_grid) delete tile->blue_grid;
+  if (tile->label_grid) delete tile->label_grid;
+  if (tile->slice_grids) delete [] tile->slice_grids;
+  if (tile->height_grids) delete [] tile->height_grids;
+  if (tile->pixel_grids) delete [] tile->pixel_grids;
+  if (tile->graph_grids) delete [] tile->graph_grids;
+}
 
-static int
-WriteColorGrids(R3SurfelScene *scene, const char *directory_name)
+
+
+static void
+ComputeOverheadBlockSamplePixels(int work_index, int, void *data)
 {
-  // Start statistics
-  RNTime start_time;
-  start_time.Read();
-  if (print_verbose) {
-    printf("Creating color images ...\n");
-    fflush(stdout);
+  // Get convenient variables
+  OverheadRasterizer *rasterizer = (OverheadRasterizer *) data;
+  OverheadTile *tile = &rasterizer->tiles[rasterizer->work_tiles[work_index]];
+  int block_index = rasterizer->work_indices[work_index];
+  R3SurfelBlock *block = tile->blocks.Kth(block_index)->block;
+  const R3Point& origin = block->Origin();
+  int *sample_pixels = &tile->sample_pixels[tile->block_offsets[block_index]];
+  int window_xmax = tile->wxmin + tile->wxresolution - 1;
+  int window_ymax = tile->wymin + tile->wyresolution - 1;
+
+  // Compute window pixel of every surfel (or -1 if it is not in tile or its halo)
+  for (int j = 0; j < block->NSurfels(); j++) {
+    const R3Surfel *surfel = block->Surfel(j);
+    sample_pixels[j] = -1;
+
+    // Get global grid coordinates
+    R2Point grid_position(origin.X() + surfel->X(), origin.Y() + surfel->Y());
+    rasterizer->world_to_grid.Apply(grid_position);
+    int ix = (int) (grid_position.X() + 0.5);
+    int iy = (int) (grid_position.Y() + 0.5);
+
+    // Check if pixel belongs to window (which lies inside grid)
+    if ((ix < tile->wxmin) || (ix > window_xmax)) continue;
+    if ((iy < tile->wymin) || (iy > window_ymax)) continue;
+
+    // Remember window pixel
+    sample_pixels[j] = (iy - tile->wymin) * tile->wxresolution + (ix - tile->wxmin);
   }
-    
-  // Create grids
-  R2Grid zmax_grid; 
-  InitializeOverheadGrid(zmax_grid, scene, pixel_spacing, max_resolution, R2_GRID_UNKNOWN_VALUE);
-  R2Grid red_grid(zmax_grid);
-  R2Grid green_grid(zmax_grid);
-  R2Grid blue_grid(zmax_grid);
-
-  // Fill grids
-  int node_count = 0;
-  R3SurfelTree *tree = scene->Tree();
-  if (!tree) return 0;
-  R3SurfelDatabase *database = tree->Database();
-  if (!database) return 0;
-  RNArray<R3SurfelNode *> stack;
-  stack.Insert(tree->RootNode());
-  while (!stack.IsEmpty()) {
-    R3SurfelNode *node = stack.Tail();
-    stack.RemoveTail();
+}
 
-    // Print debug statement
-    node_count++;
-    if (print_debug) {
-      static int next_node_count = 1;
-      if (node_count == next_node_count) {
-        int node_step = tree->NNodes() / 10;
-        if (node_step < 100) node_step = 100;
-        next_node_count += node_step;
-        printf("%.0f%%\n", 100.0 * node_count / (double) tree->NNodes());
-        fflush(stdout);
-      }
-    }
-      
-    // Check if node is not a leaf
-    if (node->NParts() > 0) { // (node->NBlocks() == 0) || (node->Resolution() < 10 / pixel_spacing)) {
-      // Decend into children
-      for (int i = 0; i < node->NParts(); i++) {
-        R3SurfelNode *part = node->Part(i);
-        stack.Insert(part);
-      }
-    }
-    else {
-      // Prcoess blocks
-      for (int i = 0; i < node->NBlocks(); i++) {
-        R3SurfelBlock *block = node->Block(i);
-        const R3Point& origin = block->Origin();
-
-        // Read block
-        database->ReadBlock(block);
-
-        // Process surfels
-        for (int j = 0; j < block->NSurfels(); j++) {
-          const R3Surfel *surfel = block->Surfel(j);
-
-          // Get surfel color
-          RNRgb rgb = surfel->Rgb();
-
-          // Get world coordinates
-          double px = origin.X() + surfel->X();
-          double py = origin.Y() + surfel->Y();
-          double pz = origin.Z() + surfel->Z();
-
-          // Get grid coordinates
-          R2Point grid_position = zmax_grid.GridPosition(R2Point(px, py));
-          int ix = (int) (grid_position.X() + 0.5);
-          int iy = (int) (grid_position.Y() + 0.5);
-          if ((ix < 0) || (ix >= zmax_grid.XResolution())) continue;
-          if ((iy < 0) || (iy >= zmax_grid.YResolution())) continue;
-
-          // Update zmax grid (and rgb)
-          RNScalar zmax = zmax_grid.GridValue(ix, iy);
-          if ((zmax == R2_GRID_UNKNOWN_VALUE) || (pz > zmax)) {
-            zmax_grid.SetGridValue(ix, iy, pz);
-            red_grid.SetGridValue(ix, iy, rgb.R());
-            green_grid.SetGridValue(ix, iy, rgb.G());
-            blue_grid.SetGridValue(ix, iy, rgb.B());
-          }
-        }
 
-        // Release block
-        database->ReleaseBlock(block);
-      }
+
+static void
+SortOverheadTileSamples(int tile_index, int, void *data)
+{
+  // Get convenient variables
+  OverheadRasterizer *rasterizer = (OverheadRasterizer *) data;
+  OverheadTile *tile = &rasterizer->tiles[tile_index];
+  int nblocks = tile->blocks.NEntries();
+  int npixels = tile->wxresolution * tile->wyresolution;
+
+  // Count samples in each window pixel and compute offsets (prefix sum)
+  tile->pixel_offsets = new int [ npixels + 1 ];
+  for (int i = 0; i <= npixels; i++) tile->pixel_offsets[i] = 0;
+  for (int k = 0; k < tile->block_offsets[nblocks]; k++) {
+    int pixel = tile->sample_pixels[k];
+    if (pixel >= 0) tile->pixel_offsets[pixel + 1]++;
+  }
+  for (int i = 0; i < npixels; i++) {
+    tile->pixel_offsets[i+1] += tile->pixel_offsets[i];
+  }
+
+  // Fill samples of each pixel (in block and surfel order, so results do not depend on tiling or banding)
+  tile->samples = new OverheadSample [ tile->pixel_offsets[npixels] + 1 ];
+  int *pixel_counts = new int [ npixels + 1 ];
+  for (int i = 0; i < npixels; i++) pixel_counts[i] = tile->pixel_offsets[i];
+  for (int i = 0; i < nblocks; i++) {
+    OverheadBlock *overhead_block = tile->blocks.Kth(i);
+    R3SurfelBlock *block = overhead_block->block;
+    const R3Point& origin = block->Origin();
+    const int *sample_pixels = &tile->sample_pixels[tile->block_offsets[i]];
+    for (int j = 0; j < block->NSurfels(); j++) {
+      int pixel = sample_pixels[j];
+      if (pixel < 0) continue;
+      const R3Surfel *surfel = block->Surfel(j);
+      OverheadSample *sample = &tile->samples[pixel_counts[pixel]++];
+      sample->block = overhead_block;
+      sample->surfel = surfel;
+      sample->position.Reset(origin.X() + surfel->X(), origin.Y() + surfel->Y(), origin.Z() + surfel->Z());
     }
   }
 
-  // Write grids
-  if (!WriteGrid(red_grid, directory_name, "Color", "Red")) return 0;
-  if (!WriteGrid(green_grid, directory_name, "Color", "Green")) return 0;
-  if (!WriteGrid(blue_grid, directory_name, "Color", "Blue")) return 0;
-  if (!WriteImage(red_grid, green_grid, blue_grid, directory_name, "Color", "Rgb")) return 0;
+  // Delete temporary data
+  delete [] pixel_counts;
+  delete [] tile->sample_pixels;
+  delete [] tile->block_offsets;
+  tile->sample_pixels = NULL;
+  tile->block_offsets = NULL;
+}
 
-  // Print statistics
-  if (print_verbose) {
-    printf("  Time = %.2f seconds\n", start_time.Elapsed());
-    printf("  Resolution = %d %d\n", zmax_grid.XResolution(), zmax_grid.YResolution());
-    printf("  Spacing = %g\n", zmax_grid.WorldToGridScaleFactor());
-    fflush(stdout);
+
+
+static void
+CreateOverheadTileSamples(OverheadRasterizer *rasterizer, int ntiles)
+{
+  // Compute offsets of blocks' surfels in every tile
+  int nwork = 0;
+  for (int t = 0; t < ntiles; t++) {
+    OverheadTile *tile = &rasterizer->tiles[t];
+    int nblocks = tile->blocks.NEntries();
+    tile->block_offsets = new int [ nblocks + 1 ];
+    tile->block_offsets[0] = 0;
+    for (int i = 0; i < nblocks; i++) {
+      tile->block_offsets[i+1] = tile->block_offsets[i] + tile->blocks.Kth(i)->block->NSurfels();
+    }
+    tile->sample_pixels = new int [ tile->block_offsets[nblocks] + 1 ];
+    nwork += nblocks;
   }
 
-  // Return success
-  return 1;
+  // Compute window pixel of every surfel in parallel over blocks of all tiles
+  rasterizer->work_tiles = new int [ nwork + 1 ];
+  rasterizer->work_indices = new int [ nwork + 1 ];
+  nwork = 0;
+  for (int t = 0; t < ntiles; t++) {
+    for (int i = 0; i < rasterizer->tiles[t].blocks.NEntries(); i++) {
+      rasterizer->work_tiles[nwork] = t;
+      rasterizer->work_indices[nwork] = i;
+      nwork++;
+    }
+  }
+  RNParallelFor(nwork, ComputeOverheadBlockSamplePixels, rasterizer, nthreads);
+  delete [] rasterizer->work_tiles;
+  delete [] rasterizer->work_indices;
+  rasterizer->work_tiles = NULL;
+  rasterizer->work_indices = NULL;
+
+  // Sort samples of every tile by pixel in parallel over tiles
+  RNParallelFor(ntiles, SortOverheadTileSamples, rasterizer, nthreads);
 }
 
 
 
-////////////////////////////////////////////////////////////////////////
-// Color image functions
-////////////////////////////////////////////////////////////////////////
+static void
+DeleteOverheadTileSamples(OverheadTile *tile)
+{
+  // Delete samples
+  if (tile->samples) delete [] tile->samples;
+  if (tile->pixel_offsets) delete [] tile->pixel_offsets;
+  tile->samples = NULL;
+  tile->pixel_offsets = NULL;
+}
+
+
 
 static int
-WriteSliceGrids(R3SurfelScene *scene, const char *directory_name)
+GatherOverheadPositions(const OverheadRasterizer *rasterizer, const OverheadTile *tile,
+  int wx, int wy, const R2Point& center, RNLength radius, R3Point *positions)
 {
-  // Parameters
-  const RNScalar slice_spacing = 1.0;
+  // Visit window pixels within radius of center
+  int npositions = 0;
+  int r = (int) (radius / rasterizer->pixel_size) + 1;
+  RNLength radius_squared = radius * radius;
+  for (int j = wy - r; j <= wy + r; j++) {
+    if ((j < 0) || (j >= tile->wyresolution)) continue;
+    for (int i = wx - r; i <= wx + r; i++) {
+      if ((i < 0) || (i >= tile->wxresolution)) continue;
+      int pixel = j * tile->wxresolution + i;
+
+      // Gather positions of samples within radius (in xy)
+      for (int k = tile->pixel_offsets[pixel]; k < tile->pixel_offsets[pixel+1]; k++) {
+        const R3Point& position = tile->samples[k].position;
+        RNScalar dx = position.X() - center.X();
+        RNScalar dy = position.Y() - center.Y();
+        if (dx*dx + dy*dy > radius_squared) continue;
+        positions[npositions++] = position;
+      }
+    }
+  }
 
-  // Start statistics
-  RNTime start_time;
-  start_time.Read();
-  if (print_verbose) {
-    printf("Creating slice images ...\n");
-    fflush(stdout);
+  // Return number of positions
+  return npositions;
+}
+
+
+
+static int
+SelectOverheadPositions(const R3Point *positions, int npositions,
+  const R2Point& center, RNLength radius, R3Point *selected_positions)
+{
+  // Select positions within radius (in xy)
+  int nselected_positions = 0;
+  RNLength radius_squared = radius * radius;
+  for (int i = 0; i < npositions; i++) {
+    RNScalar dx = positions[i].X() - center.X();
+    RNScalar dy = positions[i].Y() - center.Y();
+    if (dx*dx + dy*dy > radius_squared) continue;
+    selected_positions[nselected_positions++] = positions[i];
   }
 
-  // Get slice parameters
-  const R3Box& bbox = scene->BBox();
-  if (bbox.ZLength() == 0) return 0;
-  int nslices = (int) (bbox.ZLength() / slice_spacing) + 1;
-  if (nslices <= 1) return 0;
-  RNScalar zmin = bbox.ZMin();
-  RNScalar zscale = 1.0 / slice_spacing;
+  // Return number of selected positions
+  return nselected_positions;
+}
+
+
 
-  // Create grids
-  R2Grid *slice_grids = new R2Grid [nslices]; 
-  for (int i = 0; i < nslices; i++) {
-    InitializeOverheadGrid(slice_grids[i], scene, pixel_spacing, max_resolution, R2_GRID_UNKNOWN_VALUE);
+static int
+InsertOverheadNeighbor(const R3Point& position, RNScalar distance_squared,
+  R3Point *neighbors, RNScalar *distances_squared, int nneighbors)
+{
+  // Find slot for neighbor (neighbors are sorted by distance)
+  int slot = nneighbors;
+  while ((slot > 0) && (distance_squared < distances_squared[slot-1])) slot--;
+  if (slot >= max_overhead_neighbors) return nneighbors;
+
+  // Insert neighbor (dropping farthest one if full)
+  if (nneighbors < max_overhead_neighbors) nneighbors++;
+  for (int j = nneighbors-1; j > slot; j--) {
+    neighbors[j] = neighbors[j-1];
+    distances_squared[j] = distances_squared[j-1];
   }
+  neighbors[slot] = position;
+  distances_squared[slot] = distance_squared;
 
-  // Fill grids
-  int node_count = 0;
-  R3SurfelTree *tree = scene->Tree();
-  if (!tree) return 0;
-  R3SurfelDatabase *database = tree->Database();
-  if (!database) return 0;
-  RNArray<R3SurfelNode *> stack;
-  stack.Insert(tree->RootNode());
-  while (!stack.IsEmpty()) {
-    R3SurfelNode *node = stack.Tail();
-    stack.RemoveTail();
+  // Return number of neighbors
+  return nneighbors;
+}
 
-    // Print debug statement
-    node_count++;
-    if (print_debug) {
-      static int next_node_count = 1;
-      if (node_count == next_node_count) {
-        int node_step = tree->NNodes() / 10;
-        if (node_step < 100) node_step = 100;
-        next_node_count += node_step;
-        printf("%.0f%%\n", 100.0 * node_count / (double) tree->NNodes());
-        fflush(stdout);
+
+
+static void
+UpdateOverheadSampleGrids(const OverheadRasterizer *rasterizer, OverheadTile *tile,
+  const OverheadSample *sample, int tx, int ty)
+{
+  // Get convenient variables
+  const OverheadBlock *overhead_block = sample->block;
+  const R3Surfel *surfel = sample->surfel;
+  double pz = sample->position.Z();
+
+  // Update zmax grid (and color/label of top surfel)
+  if (tile->zmax_grid) {
+    RNScalar zmax = tile->zmax_grid->GridValue(tx, ty);
+    if ((zmax == R2_GRID_UNKNOWN_VALUE) || (pz > zmax)) {
+      tile->zmax_grid->SetGridValue(tx, ty, pz);
+      if (tile->red_grid) {
+        RNRgb rgb = surfel->Rgb();
+        tile->red_grid->SetGridValue(tx, ty, rgb.R());
+        tile->green_grid->SetGridValue(tx, ty, rgb.G());
+        tile->blue_grid->SetGridValue(tx, ty, rgb.B());
       }
-    }
-      
-    // Check if node is not a leaf
-    if (node->NParts() > 0) { // (node->NBlocks() == 0) || (node->Resolution() < 10 / pixel_spacing)) {
-      // Decend into children
-      for (int i = 0; i < node->NParts(); i++) {
-        R3SurfelNode *part = node->Part(i);
-        stack.Insert(part);
+      if (tile->label_grid) {
+        tile->label_grid->SetGridValue(tx, ty, overhead_block->label_identifier);
       }
     }
-    else {
-      // Prcoess blocks
-      for (int i = 0; i < node->NBlocks(); i++) {
-        R3SurfelBlock *block = node->Block(i);
-        const R3Point& origin = block->Origin();
-
-        // Read block
-        database->ReadBlock(block);
-
-        // Process surfels
-        for (int j = 0; j < block->NSurfels(); j++) {
-          const R3Surfel *surfel = block->Surfel(j);
-
-          // Get world coordinates
-          double px = origin.X() + surfel->X();
-          double py = origin.Y() + surfel->Y();
-          double pz = origin.Z() + surfel->Z();
-
-          // Get grid coordinates
-          R2Point grid_position = slice_grids[0].GridPosition(R2Point(px, py));
-          int ix = (int) (grid_position.X() + 0.5);
-          int iy = (int) (grid_position.Y() + 0.5);
-          if ((ix < 0) || (ix >= slice_grids[0].XResolution())) continue;
-          if ((iy < 0) || (iy >= slice_grids[0].YResolution())) continue;
-
-          // Get slice
-          int slice = (int) (zscale * (pz - zmin));
-          if (slice < 0) slice = 0;
-          if (slice >= nslices) slice = nslices-1;
-
-          // Update slice grid 
-          slice_grids[slice].AddGridValue(ix, iy, 1.0);
-        }
+  }
 
-        // Release block
-        database->ReleaseBlock(block);
-      }
+  // Update base grids
+  if (tile->count_grid) {
+    RNScalar zmin = tile->zmin_grid->GridValue(tx, ty);
+    if ((zmin == R2_GRID_UNKNOWN_VALUE) || (pz < zmin)) {
+      tile->zmin_grid->SetGridValue(tx, ty, pz);
     }
+    tile->count_grid->AddGridValue(tx, ty, 1);
+    tile->zmean_grid->AddGridValue(tx, ty, pz);
+    tile->nx_grid->AddGridValue(tx, ty, surfel->NX());
+    tile->ny_grid->AddGridValue(tx, ty, surfel->NY());
+    tile->nz_grid->AddGridValue(tx, ty, surfel->NZ());
+    tile->radius_grid->AddGridValue(tx, ty, surfel->Radius());
+    tile->horizontal_grid->AddGridValue(tx, ty, fabs(surfel->NZ()));
   }
 
-  // Write grids
-  for (int i = 0; i < nslices; i++) {
-    char buffer[4096];
-    sprintf(buffer, "%d", i);
-    if (!WriteGrid(slice_grids[i], directory_name, "Slice", buffer)) return 0;
+  // Update slice grid
+  if (tile->slice_grids) {
+    int slice = (int) (rasterizer->slice_zscale * (pz - rasterizer->slice_zmin));
+    if (slice < 0) slice = 0;
+    if (slice >= rasterizer->nslices) slice = rasterizer->nslices-1;
+    tile->slice_grids[slice].AddGridValue(tx, ty, 1.0);
   }
+}
 
-  // Print statistics
-  if (print_verbose) {
-    printf("  Time = %.2f seconds\n", start_time.Elapsed());
-    printf("  Resolution = %d %d\n", slice_grids[0].XResolution(), slice_grids[0].YResolution());
-    printf("  Spacing = %g %g\n", slice_grids[0].WorldToGridScaleFactor(), slice_spacing);
-    printf("  # Slices = %d\n", nslices);
-    fflush(stdout);
-  }
 
-  // Delete grids
-  delete [] slice_grids;
 
-  // Return success
-  return 1;
-}
+static void
+UpdateOverheadGraphGrids(const OverheadRasterizer *rasterizer, OverheadTile *tile,
+  const R3Point& position, int wx, int wy, int tx, int ty)
+{
+  // Parameters
+  RNScalar horizontal_tolerance = cos(10.0*RN_PI/180.0);
+  RNScalar vertical_tolerance = sin(10.0*RN_PI/180.0);
 
+  // Find closest samples within graph radius (including sample itself)
+  R3Point cloud [ max_overhead_neighbors + 1 ];
+  RNScalar distances_squared [ max_overhead_neighbors ];
+  RNLength radius_squared = rasterizer->graph_radius * rasterizer->graph_radius;
+  int r = (int) (rasterizer->graph_radius / rasterizer->pixel_size) + 1;
+  int nneighbors = 0;
+  for (int j = wy - r; j <= wy + r; j++) {
+    if ((j < 0) || (j >= tile->wyresolution)) continue;
+    for (int i = wx - r; i <= wx + r; i++) {
+      if ((i < 0) || (i >= tile->wxresolution)) continue;
+      int pixel = j * tile->wxresolution + i;
+      for (int k = tile->pixel_offsets[pixel]; k < tile->pixel_offsets[pixel+1]; k++) {
+        const R3Point& neighbor_position = tile->samples[k].position;
+        RNScalar distance_squared = R3SquaredDistance(position, neighbor_position);
+        if (distance_squared > radius_squared) continue;
+        nneighbors = InsertOverheadNeighbor(neighbor_position, distance_squared, &cloud[1], distances_squared, nneighbors);
+      }
+    }
+  }
+
+  // Check number of neighbors
+  if (nneighbors < 3) return;
+
+  // Compute normal with PCA of neighborhood
+  cloud[0] = position;
+  RNScalar variances[3] = { 0, 0, 0 };
+  R3Point centroid = R3Centroid(nneighbors+1, cloud);
+  R3Triad triad = R3PrincipleAxes(centroid, nneighbors+1, cloud, NULL, variances);
+  R3Vector normal = triad[2];
+
+  // Compute neighborhood radius
+  RNScalar neighborhood_radius = R3Distance(cloud[0], cloud[nneighbors]);
+
+  // Update grids
+  R2Grid *grids = tile->graph_grids;
+  grids[GRAPH_COUNT_GRID].AddGridValue(tx, ty, 1);
+  grids[GRAPH_ZSUM_GRID].AddGridValue(tx, ty, position.Z());
+  RNScalar zmax = grids[GRAPH_ZMAX_GRID].GridValue(tx, ty);
+  if ((zmax == R2_GRID_UNKNOWN_VALUE) || (position.Z() > zmax)) grids[GRAPH_ZMAX_GRID].SetGridValue(tx, ty, position.Z());
+  RNScalar zmin = grids[GRAPH_ZMIN_GRID].GridValue(tx, ty);
+  if ((zmin == R2_GRID_UNKNOWN_VALUE) || (position.Z() < zmin)) grids[GRAPH_ZMIN_GRID].SetGridValue(tx, ty, position.Z());
+  grids[GRAPH_PCA0_GRID].AddGridValue(tx, ty, variances[0]);
+  grids[GRAPH_PCA1_GRID].AddGridValue(tx, ty, variances[1]);
+  grids[GRAPH_PCA2_GRID].AddGridValue(tx, ty, variances[2]);
+  grids[GRAPH_NORMAL_X_GRID].AddGridValue(tx, ty, fabs(normal.X()));
+  grids[GRAPH_NORMAL_Y_GRID].AddGridValue(tx, ty, fabs(normal.Y()));
+  grids[GRAPH_NORMAL_Z_GRID].AddGridValue(tx, ty, fabs(normal.Z()));
+  grids[GRAPH_NEIGHBOR_RADIUS_GRID].AddGridValue(tx, ty, neighborhood_radius);
+  if ((variances[1] > 0.04) && (variances[2] < 0.01)) {
+    if (normal.Z() > horizontal_tolerance) grids[GRAPH_HORIZONTAL_GRID].AddGridValue(tx, ty, 1);
+    else if (fabs(normal.Z()) < vertical_tolerance) grids[GRAPH_VERTICAL_GRID].AddGridValue(tx, ty, 1);
+    else grids[GRAPH_OBLIQUE_GRID].AddGridValue(tx, ty, 1);
+    grids[GRAPH_PLANAR_GRID].AddGridValue(tx, ty, 1);
+  }
+}
 
 
-////////////////////////////////////////////////////////////////////////
-// Chunk grid functions
-////////////////////////////////////////////////////////////////////////
 
-static int 
-WritePixelGrids(R3SurfelScene *scene, const char *directory_name)
+static void
+UpdateOverheadHeightGrids(R2Grid *grids, int tx, int ty, const R2Point& center,
+  const R3Point *pixel_positions, int npixel_positions,
+  const R3Point *region_positions, int nregion_positions, RNScalar *zcoords)
 {
-  // Parameters
-  if (pixel_spacing == 0) pixel_spacing = 1;
-  RNLength pixel_spacing_squared = pixel_spacing * pixel_spacing;
-  RNLength region_radius = 2;
-  RNLength chunk_diameter = 4 * region_radius;
-  const int max_neighbors = 16;
-  RNLength max_neighbor_distance = 1;
-  if (max_neighbor_distance < pixel_spacing) max_neighbor_distance = pixel_spacing;
-  R3Point cloud [ max_neighbors + 1];
-  int min_points_per_pixel = 4;
+  // Gather height statistics
+  RNCoord zsum = 0;
+  RNCoord zmax = -FLT_MAX;
+  RNCoord zmin = FLT_MAX;
+  for (int i = 0; i < npixel_positions; i++) {
+    const R3Point& position = pixel_positions[i];
+    if (position.Z() > zmax) zmax = position.Z();
+    if (position.Z() < zmin) zmin = position.Z();
+    zsum += position.Z();
+  }
 
-  // Start statistics
-  RNTime start_time;
-  start_time.Read();
-  if (print_verbose) {
-    printf("Creating pixel images ...\n");
-    printf("NOTE THAT THIS IS REALLY SLOW ...\n");
-    fflush(stdout);
+  // Gather ssd statistics
+  RNScalar zssd = 0;
+  RNScalar zmean = zsum / npixel_positions;
+  for (int i = 0; i < npixel_positions; i++) {
+    RNScalar delta = pixel_positions[i].Z() - zmean;
+    zssd += delta * delta;
   }
-    
-  // Create grids
-  R2Grid pixel_count_grid; 
-  InitializeOverheadGrid(pixel_count_grid, scene, pixel_spacing, max_resolution, R2_GRID_UNKNOWN_VALUE);
-  R2Grid graph_count_grid(pixel_count_grid); 
-  R2Grid region_count_grid(pixel_count_grid); 
-  R2Grid graph_radius_grid(pixel_count_grid);
-  R2Grid zmin_grid(pixel_count_grid); 
-  R2Grid zmax_grid(pixel_count_grid);
-  R2Grid zmean_grid(pixel_count_grid);
-  R2Grid zmedian_grid(pixel_count_grid);
-  R2Grid zstddev_grid(pixel_count_grid);
-  R2Grid zsupport_grid(pixel_count_grid);
-  R2Grid pca0_grid(pixel_count_grid);
-  R2Grid pca1_grid(pixel_count_grid);
-  R2Grid pca2_grid(pixel_count_grid);
-  R2Grid normal_x_grid(pixel_count_grid);
-  R2Grid normal_y_grid(pixel_count_grid);
-  R2Grid normal_z_grid(pixel_count_grid);
-
-  // Compute chunking variables
-  int nxchunks = (int) (scene->BBox().XLength() / chunk_diameter);
-  int nychunks = (int) (scene->BBox().YLength() / chunk_diameter);
-  if (nxchunks == 0) nxchunks = 1;
-  if (nychunks == 0) nychunks = 1;
-  int nxpixels = pixel_count_grid.XResolution() / nxchunks;
-  int nypixels = pixel_count_grid.YResolution() / nychunks;
-  if (nxpixels == 0) nxpixels = 1;
-  if (nypixels == 0) nypixels = 1;
 
-  // Compute grids chunk-by-chunk
-  R3SurfelPointSet *last_chunk_pointset = NULL;
-  for (int jc = 0; jc < nychunks; jc++) {
-    for (int ic = 0; ic < nxchunks; ic++) {
-      // Compute chunk bounding box
-      R2Point p1 = pixel_count_grid.WorldPosition(    ic * nxpixels,     jc * nxpixels);
-      R2Point p2 = pixel_count_grid.WorldPosition((ic+1) * nxpixels, (jc+1) * nxpixels);
-      R3Box chunk_bbox(p1.X() - region_radius, p1.Y() - region_radius, -FLT_MAX, 
-                       p2.X() + region_radius, p2.Y() + region_radius,  FLT_MAX);
-      
-      // Create chunk pointset
-      R3SurfelBoxConstraint chunk_constraint(chunk_bbox);
-      R3SurfelPointSet *chunk_pointset = CreatePointSet(scene, NULL, &chunk_constraint);
-      if (!chunk_pointset) continue;
-      if (chunk_pointset->NPoints() < min_points_per_pixel) { delete chunk_pointset; continue; }
-      if (last_chunk_pointset) { delete last_chunk_pointset; last_chunk_pointset = NULL; }
-      last_chunk_pointset = chunk_pointset;
-
-      // Print debug statement
-      if (print_debug) {
-        printf("%4d/%4d %4d/%4d : %9.3f %9.3f : %12d\n", jc, nychunks, ic, nxchunks, 
-          p1.X(), p1.Y(), chunk_pointset->NPoints());
-        fflush(stdout);
-      }
+  // Compute variance statistics
+  RNScalar zvariance = zssd / npixel_positions;
+  RNScalar zstddev = sqrt(zvariance);
+
+  // Compute median statistics
+  for (int i = 0; i < npixel_positions; i++) zcoords[i] = pixel_positions[i].Z();
+  qsort(zcoords, npixel_positions, sizeof(RNScalar), RNCompareScalars);
+  RNScalar zmedian = zcoords[npixel_positions / 2];
+
+  // Compute support elevation
+  RNCoord zsupport = 0;
+  R3Plane plane = EstimateSupportPlane(region_positions, nregion_positions);
+  if (plane[2] == 1) zsupport = -plane[3];
+  else if (plane[2] != 0) zsupport = (plane[0]*center[0] + plane[1]*center[1] + plane[3]) / plane[2];
+
+  // Assign grid values
+  grids[HEIGHT_COUNT_GRID].SetGridValue(tx, ty, npixel_positions);
+  grids[HEIGHT_NEIGHBORHOOD_COUNT_GRID].SetGridValue(tx, ty, nregion_positions);
+  grids[HEIGHT_ZMIN_GRID].SetGridValue(tx, ty, zmin);
+  grids[HEIGHT_ZMAX_GRID].SetGridValue(tx, ty, zmax);
+  grids[HEIGHT_ZMEAN_GRID].SetGridValue(tx, ty, zmean);
+  grids[HEIGHT_ZMEDIAN_GRID].SetGridValue(tx, ty, zmedian);
+  grids[HEIGHT_ZSTDDEV_GRID].SetGridValue(tx, ty, zstddev);
+  grids[HEIGHT_ZSUPPORT_GRID].SetGridValue(tx, ty, zsupport);
+}
 
-      // Compute grids within chunk pixel-by-pixel
-      for (int iy = 0; iy < nypixels; iy++) {
-        int grid_y = jc * nypixels + iy;
-        for (int ix = 0; ix < nxpixels; ix++) {
-          int grid_x = ic * nxpixels + ix;
-          R2Point grid_position(grid_x, grid_y);
-          R2Point twod_position = pixel_count_grid.WorldPosition(grid_position);
-          R3Point world_position(twod_position[0], twod_position[1], chunk_bbox.Centroid().Z());
-
-          // Create region pointset
-          R3SurfelCylinderConstraint region_constraint(world_position, region_radius);
-          R3SurfelPointSet *region_pointset = CreatePointSet(chunk_pointset, &region_constraint);
-          if (!region_pointset) continue;
-          if (region_pointset->NPoints() < min_points_per_pixel) { 
-            delete region_pointset; 
-            continue; 
-          }
 
-          // Create graph pointset
-          R3SurfelCylinderConstraint graph_constraint(world_position, max_neighbor_distance);
-          R3SurfelPointSet *graph_pointset = CreatePointSet(region_pointset, &graph_constraint);
-          if (!graph_pointset) { 
-            delete region_pointset; 
-            continue; 
-          }
-          if (graph_pointset->NPoints() < min_points_per_pixel) { 
-            delete region_pointset; 
-            delete graph_pointset; 
-            continue; 
-          }
 
-          // Create pixel pointset
-          R3SurfelCylinderConstraint pixel_constraint(world_position, pixel_spacing);
-          R3SurfelPointSet *pixel_pointset = CreatePointSet(graph_pointset, &pixel_constraint);
-          if (!pixel_pointset) { 
-            delete region_pointset; 
-            delete graph_pointset;
-            continue; 
-          }
-          if (pixel_pointset->NPoints() < min_points_per_pixel) { 
-            delete region_pointset; 
-            delete graph_pointset;
-            delete pixel_pointset; 
-            continue; 
-          }
+static void
+UpdateOverheadPixelGraphGrids(const OverheadRasterizer *rasterizer, R2Grid *grids, int tx, int ty,
+  const R2Point& center, const R3Point *graph_positions, int ngraph_positions)
+{
+  // Get convenient variables
+  RNLength pixel_radius_squared = rasterizer->pixel_size * rasterizer->pixel_size;
+  RNLength graph_radius_squared = rasterizer->graph_radius * rasterizer->graph_radius;
+  R3Point cloud [ max_overhead_neighbors + 1 ];
+  RNScalar distances_squared [ max_overhead_neighbors ];
+
+  // Sum graph stuff over all points in pixel
+  int graph_count = 0;
+  RNScalar graph_radius = 0;
+  RNScalar graph_variances[3] = { 0, 0, 0 };
+  R3Vector graph_normal(0, 0, 0);
+  for (int i = 0; i < ngraph_positions; i++) {
+    const R3Point& position = graph_positions[i];
+    RNScalar dx = center[0] - position[0];
+    RNScalar dy = center[1] - position[1];
+    if (dx*dx + dy*dy > pixel_radius_squared) continue;
+
+    // Find closest graph points (including point itself)
+    int nneighbors = 0;
+    for (int j = 0; j < ngraph_positions; j++) {
+      RNScalar distance_squared = R3SquaredDistance(position, graph_positions[j]);
+      if (distance_squared > graph_radius_squared) continue;
+      nneighbors = InsertOverheadNeighbor(graph_positions[j], distance_squared, &cloud[1], distances_squared, nneighbors);
+    }
+    if (nneighbors < 2) continue;
+    graph_count++;
+
+    // Increment stuff
+    cloud[0] = position;
+    RNScalar variances[3];
+    R3Point centroid = R3Centroid(nneighbors+1, cloud);
+    R3Triad triad = R3PrincipleAxes(centroid, nneighbors+1, cloud, NULL, variances);
+    graph_variances[0] += variances[0];
+    graph_variances[1] += variances[1];
+    graph_variances[2] += variances[2];
+    graph_normal[0] += fabs(triad[2][0]);
+    graph_normal[1] += fabs(triad[2][1]);
+    graph_normal[2] += fabs(triad[2][2]);
+    graph_radius += R3Distance(cloud[0], cloud[nneighbors]);
+  }
 
-          // Create pixel graph
-          R3SurfelPointGraph *pixel_graph = new R3SurfelPointGraph(*graph_pointset, max_neighbors, max_neighbor_distance);
-          if (!pixel_graph) { 
-            delete region_pointset; 
-            delete graph_pointset; 
-            delete pixel_pointset; 
-            continue; 
-          }
-          if (pixel_graph->NPoints() < min_points_per_pixel) { 
-            delete region_pointset; 
-            delete graph_pointset; 
-            delete pixel_pointset; 
-            delete pixel_graph;
-            continue; 
-          }
+  // Divide graph stuff by count to get means
+  graph_radius = (graph_count > 0) ? graph_radius / graph_count : R2_GRID_UNKNOWN_VALUE;
+  graph_variances[0] = (graph_count > 0) ? graph_variances[0] / graph_count : R2_GRID_UNKNOWN_VALUE;
+  graph_variances[1] = (graph_count > 0) ? graph_variances[1] / graph_count : R2_GRID_UNKNOWN_VALUE;
+  graph_variances[2] = (graph_count > 0) ? graph_variances[2] / graph_count : R2_GRID_UNKNOWN_VALUE;
+  graph_normal[0] = (graph_count > 0) ? graph_normal[0] / graph_count : R2_GRID_UNKNOWN_VALUE;
+  graph_normal[1] = (graph_count > 0) ? graph_normal[1] / graph_count : R2_GRID_UNKNOWN_VALUE;
+  graph_normal[2] = (graph_count > 0) ? graph_normal[2] / graph_count : R2_GRID_UNKNOWN_VALUE;
+
+  // Assign grid values
+  grids[PIXEL_GRAPH_COUNT_GRID].SetGridValue(tx, ty, graph_count);
+  grids[PIXEL_GRAPH_RADIUS_GRID].SetGridValue(tx, ty, graph_radius);
+  grids[PIXEL_PCA0_GRID].SetGridValue(tx, ty, graph_variances[0]);
+  grids[PIXEL_PCA1_GRID].SetGridValue(tx, ty, graph_variances[1]);
+  grids[PIXEL_PCA2_GRID].SetGridValue(tx, ty, graph_variances[2]);
+  grids[PIXEL_NORMAL_X_GRID].SetGridValue(tx, ty, graph_normal[0]);
+  grids[PIXEL_NORMAL_Y_GRID].SetGridValue(tx, ty, graph_normal[1]);
+  grids[PIXEL_NORMAL_Z_GRID].SetGridValue(tx, ty, graph_normal[2]);
+}
 
-          // Print debug statement
-          // if (print_debug) {
-          //   printf("    %4d/%-4d %4d/%-4d : %d %d : %12d %12d %12d\n", iy, nypixels, ix, nxpixels, grid_x, grid_y,
-          //     region_pointset->NPoints(), graph_pointset->NPoints(), pixel_pointset->NPoints());
-          //    fflush(stdout);
-          // }
-
-          // Gather height statistics
-          RNCoord zsum = 0;
-          RNCoord zmax = -FLT_MAX;
-          RNCoord zmin = FLT_MAX;
-          for (int i = 0; i < pixel_pointset->NPoints(); i++) {
-            R3SurfelPoint *point = pixel_pointset->Point(i);
-            R3Point position = point->Position();
-            if (position.Z() > zmax) zmax = position.Z();
-            if (position.Z() < zmin) zmin = position.Z();
-            zsum += position.Z();
-          }
 
-          // Gather ssd statistics
-          RNScalar zssd = 0;
-          RNScalar zmean = zsum / pixel_pointset->NPoints();
-          for (int i = 0; i < pixel_pointset->NPoints(); i++) {
-            R3SurfelPoint *point = pixel_pointset->Point(i);
-            R3Point position = point->Position();
-            RNScalar delta = position.Z() - zmean;
-            zssd += delta * delta;
-          }
 
-          // Compute variance statistics
-          RNScalar zvariance = zssd / pixel_pointset->NPoints();
-          RNScalar zstddev = sqrt(zvariance);
-
-          // Compute median statistics
-          RNScalar *zcoords = new RNScalar [ pixel_pointset->NPoints() ];
-          for (int i = 0; i < pixel_pointset->NPoints(); i++) zcoords[i] = pixel_pointset->Point(i)->Z();
-          qsort(zcoords, pixel_pointset->NPoints(), sizeof(RNScalar), RNCompareScalars);
-          RNScalar zmedian = zcoords[pixel_pointset->NPoints() / 2];
-          delete [] zcoords;
-
-          // Compute support elevation
-          RNCoord zsupport = 0;
-          R3Plane plane = EstimateSupportPlane(region_pointset);
-          if (plane[2] == 1) zsupport = -plane[3];
-          else if (plane[2] != 0) zsupport = (plane[0]*world_position[0] + plane[1]*world_position[1] + plane[3]) / plane[2];
-
-          // Sum graph stuff over all points in pixel
-          int graph_count = 0;
-          RNScalar graph_radius = 0;
-          RNScalar graph_variances[3] = { 0, 0, 0 };
-          R3Vector graph_normal(0, 0, 0);
-          for (int i = 0; i < pixel_graph->NPoints(); i++) {
-            if (pixel_graph->NNeighbors(i) < 2) continue;
-            R3SurfelPoint *point = pixel_graph->Point(i);
-            R3Point position = point->Position();
-            RNScalar dx = twod_position[0] - position[0];
-            RNScalar dy = twod_position[1] - position[1];
-            if (dx*dx + dy*dy > pixel_spacing_squared) continue;
-            graph_count++;
-
-            // Create cloud of points in neighborhood
-            cloud[0] = position;
-            for (int j = 0; j < pixel_graph->NNeighbors(i); j++) {
-              const R3SurfelPoint *neighbor = pixel_graph->Neighbor(i, j);
-              cloud[j+1] = neighbor->Position();
-            }
-
-            // Increment stuff
-            RNScalar variances[3];
-            R3Point centroid = R3Centroid(pixel_graph->NNeighbors(i)+1, cloud);
-            R3Triad triad = R3PrincipleAxes(centroid, pixel_graph->NNeighbors(i)+1, cloud, NULL, variances);
-            graph_variances[0] += variances[0];
-            graph_variances[1] += variances[1];
-            graph_variances[2] += variances[2];
-            graph_normal[0] += fabs(triad[2][0]);
-            graph_normal[1] += fabs(triad[2][1]);
-            graph_normal[2] += fabs(triad[2][2]);
-            graph_radius += R3Distance(world_position, cloud[pixel_graph->NNeighbors(i)]);
-          }
+static void
+RasterizeOverheadBand(int work_index, int, void *data)
+{
+  // Get convenient variables
+  OverheadRasterizer *rasterizer = (OverheadRasterizer *) data;
+  OverheadTile *tile = &rasterizer->tiles[rasterizer->work_tiles[work_index]];
+  int band_index = rasterizer->work_indices[work_index];
+  int ty0 = band_index * rasterizer->band_size;
+  int ty1 = ty0 + rasterizer->band_size;
+  if (ty1 > tile->yresolution) ty1 = tile->yresolution;
+  int wxoffset = tile->xmin - tile->wxmin;
+  int wyoffset = tile->ymin - tile->wymin;
+
+  // Allocate neighborhood positions (enough for all samples in window rows within halo of band)
+  R3Point *region_positions = NULL;
+  R3Point *graph_positions = NULL;
+  R3Point *pixel_positions = NULL;
+  RNScalar *zcoords = NULL;
+  if (tile->height_grids || tile->pixel_grids) {
+    int wy0 = ty0 + wyoffset - rasterizer->halo;
+    int wy1 = ty1 + wyoffset + rasterizer->halo;
+    if (wy0 < 0) wy0 = 0;
+    if (wy1 > tile->wyresolution) wy1 = tile->wyresolution;
+    int max_positions = tile->pixel_offsets[wy1 * tile->wxresolution] - tile->pixel_offsets[wy0 * tile->wxresolution] + 1;
+    region_positions = new R3Point [ max_positions ];
+    graph_positions = new R3Point [ max_positions ];
+    pixel_positions = new R3Point [ max_positions ];
+    zcoords = new RNScalar [ max_positions ];
+  }
 
-          // Divide graph stuff by count to get means
-          graph_radius = (graph_count > 0) ? graph_radius / graph_count : R2_GRID_UNKNOWN_VALUE;
-          graph_variances[0] = (graph_count > 0) ? graph_variances[0] / graph_count : R2_GRID_UNKNOWN_VALUE;
-          graph_variances[1] = (graph_count > 0) ? graph_variances[1] / graph_count : R2_GRID_UNKNOWN_VALUE;
-          graph_variances[2] = (graph_count > 0) ? graph_variances[2] / graph_count : R2_GRID_UNKNOWN_VALUE;
-          graph_normal[0] = (graph_count > 0) ? graph_normal[0] / graph_count : R2_GRID_UNKNOWN_VALUE;
-          graph_normal[1] = (graph_count > 0) ? graph_normal[1] / graph_count : R2_GRID_UNKNOWN_VALUE;
-          graph_normal[2] = (graph_count > 0) ? graph_normal[2] / graph_count : R2_GRID_UNKNOWN_VALUE;
-
-          // Update grid values
-          pixel_count_grid.SetGridValue(grid_x, grid_y, pixel_pointset->NPoints());
-          region_count_grid.SetGridValue(grid_x, grid_y, region_pointset->NPoints());
-          zmin_grid.SetGridValue(grid_x, grid_y, zmin);
-          zmax_grid.SetGridValue(grid_x, grid_y, zmax);
-          zmean_grid.SetGridValue(grid_x, grid_y, zmean);
-          zmedian_grid.SetGridValue(grid_x, grid_y, zmedian);
-          zstddev_grid.SetGridValue(grid_x, grid_y, zstddev);
-          zsupport_grid.SetGridValue(grid_x, grid_y, zsupport);
-          pca0_grid.SetGridValue(grid_x, grid_y, graph_variances[0]);
-          pca1_grid.SetGridValue(grid_x, grid_y, graph_variances[1]);
-          pca2_grid.SetGridValue(grid_x, grid_y, graph_variances[2]);
-          normal_x_grid.SetGridValue(grid_x, grid_y, graph_normal[0]);
-          normal_y_grid.SetGridValue(grid_x, grid_y, graph_normal[1]);
-          normal_z_grid.SetGridValue(grid_x, grid_y, graph_normal[2]);
-          graph_count_grid.SetGridValue(grid_x, grid_y, graph_count);
-          graph_radius_grid.SetGridValue(grid_x, grid_y, graph_radius);
-          
-          // Delete pixel graph
-          delete pixel_graph;
-
-          // Delete pixel point set
-          delete pixel_pointset;
-
-          // Delete graph point set
-          delete graph_pointset;
-
-          // Delete neighborhood pointset
-          delete region_pointset;
-        }
+  // Rasterize pixels of band
+  // (each pixel belongs to exactly one band of one tile, so no locking is needed and seams are exact)
+  for (int ty = ty0; ty < ty1; ty++) {
+    for (int tx = 0; tx < tile->xresolution; tx++) {
+      int wx = tx + wxoffset;
+      int wy = ty + wyoffset;
+      int pixel = wy * tile->wxresolution + wx;
+
+      // Update grids with samples in pixel
+      for (int k = tile->pixel_offsets[pixel]; k < tile->pixel_offsets[pixel+1]; k++) {
+        const OverheadSample *sample = &tile->samples[k];
+        UpdateOverheadSampleGrids(rasterizer, tile, sample, tx, ty);
+        if (tile->graph_grids) UpdateOverheadGraphGrids(rasterizer, tile, sample->position, wx, wy, tx, ty);
+      }
+
+      // Check if grids need neighborhood of pixel
+      if (!region_positions) continue;
+
+      // Gather region and pixel neighborhoods
+      R2Point center(tile->xmin + tx, tile->ymin + ty);
+      rasterizer->world_to_grid.ApplyInverse(center);
+      int nregion_positions = GatherOverheadPositions(rasterizer, tile, wx, wy, center, rasterizer->region_radius, region_positions);
+      if (nregion_positions < min_overhead_points_per_pixel) continue;
+      int npixel_positions = SelectOverheadPositions(region_positions, nregion_positions, center, rasterizer->pixel_size, pixel_positions);
+      if (npixel_positions < min_overhead_points_per_pixel) continue;
+
+      // Update height grids
+      if (tile->height_grids) {
+        UpdateOverheadHeightGrids(tile->height_grids, tx, ty, center,
+          pixel_positions, npixel_positions, region_positions, nregion_positions, zcoords);
+      }
+
+      // Update pixel grids
+      if (tile->pixel_grids) {
+        int ngraph_positions = SelectOverheadPositions(region_positions, nregion_positions, center, rasterizer->graph_radius, graph_positions);
+        if (ngraph_positions < min_overhead_points_per_pixel) continue;
+        UpdateOverheadHeightGrids(tile->pixel_grids, tx, ty, center,
+          pixel_positions, npixel_positions, region_positions, nregion_positions, zcoords);
+        UpdateOverheadPixelGraphGrids(rasterizer, tile->pixel_grids, tx, ty, center, graph_positions, ngraph_positions);
       }
     }
   }
 
-  // Delete last chunk pointset
-  if (last_chunk_pointset) { 
-    delete last_chunk_pointset; 
-    last_chunk_pointset = NULL; 
-  }
+  // Delete neighborhood positions
+  if (region_positions) delete [] region_positions;
+  if (graph_positions) delete [] graph_positions;
+  if (pixel_positions) delete [] pixel_positions;
+  if (zcoords) delete [] zcoords;
+}
 
-  // Write grids
-  if (!WriteGrid(pixel_count_grid, directory_name, "Pixel", "PixelCount")) return 0;
-  if (!WriteGrid(graph_count_grid, directory_name, "Pixel", "GraphCount")) return 0;
-  if (!WriteGrid(region_count_grid, directory_name, "Pixel", "RegionCount")) return 0;
-  if (!WriteGrid(graph_radius_grid, directory_name, "Graph", "GraphRadius")) return 0;
-  if (!WriteGrid(zmin_grid, directory_name, "Pixel", "ZMin")) return 0;
-  if (!WriteGrid(zmax_grid, directory_name, "Pixel", "ZMax")) return 0;
-  if (!WriteGrid(zmean_grid, directory_name, "Pixel", "ZMean")) return 0;
-  if (!WriteGrid(zmedian_grid, directory_name, "Pixel", "ZMedian")) return 0;
-  if (!WriteGrid(zstddev_grid, directory_name, "Pixel", "ZStddev")) return 0;
-  if (!WriteGrid(zsupport_grid, directory_name, "Pixel", "ZSupport")) return 0;
-  if (!WriteGrid(pca0_grid, directory_name, "Pixel", "PCA0")) return 0;
-  if (!WriteGrid(pca1_grid, directory_name, "Pixel", "PCA1")) return 0;
-  if (!WriteGrid(pca2_grid, directory_name, "Pixel", "PCA2")) return 0;
-  if (!WriteGrid(normal_x_grid, directory_name, "Pixel", "NormalX")) return 0;
-  if (!WriteGrid(normal_y_grid, directory_name, "Pixel", "NormalY")) return 0;
-  if (!WriteGrid(normal_z_grid, directory_name, "Pixel", "NormalZ")) return 0;
 
-  // Print statistics
-  if (print_verbose) {
-    printf("  Time = %.2f seconds\n", start_time.Elapsed());
-    printf("  Resolution = %d %d\n", pixel_count_grid.XResolution(), pixel_count_grid.YResolution());
-    printf("  Spacing = %g\n", pixel_count_grid.WorldToGridScaleFactor());
-    fflush(stdout);
+
+static void
+RasterizeOverheadTiles(OverheadRasterizer *rasterizer, int ntiles)
+{
+  // Count bands of all tiles
+  int nwork = 0;
+  for (int t = 0; t < ntiles; t++) {
+    OverheadTile *tile = &rasterizer->tiles[t];
+    nwork += (tile->yresolution + rasterizer->band_size - 1) / rasterizer->band_size;
   }
 
-  // Return success
-  return 1;
+  // Rasterize bands of all tiles in parallel
+  rasterizer->work_tiles = new int [ nwork + 1 ];
+  rasterizer->work_indices = new int [ nwork + 1 ];
+  nwork = 0;
+  for (int t = 0; t < ntiles; t++) {
+    OverheadTile *tile = &rasterizer->tiles[t];
+    int nbands = (tile->yresolution + rasterizer->band_size - 1) / rasterizer->band_size;
+    for (int i = 0; i < nbands; i++) {
+      rasterizer->work_tiles[nwork] = t;
+      rasterizer->work_indices[nwork] = i;
+      nwork++;
+    }
+  }
+  RNParallelFor(nwork, RasterizeOverheadBand, rasterizer, nthreads);
+  delete [] rasterizer->work_tiles;
+  delete [] rasterizer->work_indices;
+  rasterizer->work_tiles = NULL;
+  rasterizer->work_indices = NULL;
 }
 
 
 
-////////////////////////////////////////////////////////////////////////
-// Heights grid functions
-////////////////////////////////////////////////////////////////////////
-
-static int 
-WriteHeightGrids(R3SurfelScene *scene, const char *directory_name)
+static int
+WriteOverheadTileGrid(const R2Grid& grid, const OverheadTile *tile, RNBoolean tiled,
+  const char *directory_name, const char *category_name, const char *field_name)
 {
-  // Parameters
-  if (pixel_spacing == 0) pixel_spacing = 1;
-  RNLength neighborhood_radius = 2;
-  RNLength chunk_diameter = 4 * neighborhood_radius;
-  int min_points_per_pixel = 4;
+  // Append tile indices to field name
+  char name[256];
+  if (tiled) sprintf(name, "%s_%d_%d", field_name, tile->ix, tile->iy);
+  else sprintf(name, "%s", field_name);
 
-  // Start statistics
-  RNTime start_time;
-  start_time.Read();
-  if (print_verbose) {
-    printf("Creating height images ...\n");
-    printf("NOTE THAT THIS IS REALLY SLOW ...\n");
-    fflush(stdout);
-  }
-    
-  // Create grids
-  R2Grid pixel_count_grid; 
-  InitializeOverheadGrid(pixel_count_grid, scene, pixel_spacing, max_resolution, R2_GRID_UNKNOWN_VALUE);
-  R2Grid neighborhood_count_grid(pixel_count_grid); 
-  R2Grid zmin_grid(pixel_count_grid); 
-  R2Grid zmax_grid(pixel_count_grid);
-  R2Grid zmean_grid(pixel_count_grid);
-  R2Grid zmedian_grid(pixel_count_grid);
-  R2Grid zstddev_grid(pixel_count_grid);
-  R2Grid zsupport_grid(pixel_count_grid);
-
-  // Compute chunking variables
-  int nxchunks = (int) (scene->BBox().XLength() / chunk_diameter);
-  int nychunks = (int) (scene->BBox().YLength() / chunk_diameter);
-  if (nxchunks == 0) nxchunks = 1;
-  if (nychunks == 0) nychunks = 1;
-  int nxpixels = pixel_count_grid.XResolution() / nxchunks;
-  int nypixels = pixel_count_grid.YResolution() / nychunks;
-  if (nxpixels == 0) nxpixels = 1;
-  if (nypixels == 0) nypixels = 1;
+  // Write grid
+  return WriteGrid(grid, directory_name, category_name, name);
+}
 
-  // Compute grids chunk-by-chunk
-  R3SurfelPointSet *last_chunk_pointset = NULL;
-  for (int jc = 0; jc < nychunks; jc++) {
-    for (int ic = 0; ic < nxchunks; ic++) {
-      // Compute chunk bounding box
-      R2Point p1 = pixel_count_grid.WorldPosition(    ic * nxpixels,     jc * nxpixels);
-      R2Point p2 = pixel_count_grid.WorldPosition((ic+1) * nxpixels, (jc+1) * nxpixels);
-      R3Box chunk_bbox(p1.X(), p1.Y(), -FLT_MAX, p2.X(), p2.Y(), FLT_MAX);
-
-      // Create chunk pointset
-      R3SurfelBoxConstraint chunk_constraint(chunk_bbox);
-      R3SurfelPointSet *chunk_pointset = CreatePointSet(scene, NULL, &chunk_constraint);
-      if (!chunk_pointset) continue;
-      if (chunk_pointset->NPoints() < min_points_per_pixel) { delete chunk_pointset; continue; }
-      if (last_chunk_pointset) { delete last_chunk_pointset; last_chunk_pointset = NULL; }
-      last_chunk_pointset = chunk_pointset;
-
-      // Print debug statement
-      if (print_debug) {
-        printf("%4d/%4d %4d/%4d : %9.3f %9.3f : %12d\n", jc, nychunks, ic, nxchunks, 
-          p1.X(), p1.Y(), chunk_pointset->NPoints());
-        fflush(stdout);
-      }
 
-      // Compute grids within chunk pixel-by-pixel
-      for (int iy = 0; iy < nypixels; iy++) {
-        int grid_y = jc * nypixels + iy;
-        for (int ix = 0; ix < nxpixels; ix++) {
-          int grid_x = ic * nxpixels + ix;
-          R2Point grid_position(grid_x, grid_y);
-          R2Point twod_position = pixel_count_grid.WorldPosition(grid_position);
-          R3Point world_position(twod_position[0], twod_position[1], chunk_bbox.Centroid().Z());
-
-          // Create neighborhood pointset
-          R3SurfelCylinderConstraint neighborhood_constraint(world_position, neighborhood_radius);
-          R3SurfelPointSet *neighborhood_pointset = CreatePointSet(chunk_pointset, &neighborhood_constraint);
-          if (!neighborhood_pointset) continue;
-          if (neighborhood_pointset->NPoints() < min_points_per_pixel) { 
-            delete neighborhood_pointset; 
-            continue; 
-          }
 
-          // Create pixel pointset
-          RNLength pixel_radius = pixel_count_grid.GridToWorldScaleFactor();
-          R3SurfelCylinderConstraint pixel_constraint(world_position, pixel_radius);
-          R3SurfelPointSet *pixel_pointset = CreatePointSet(neighborhood_pointset, &pixel_constraint);
-          if (!pixel_pointset) { 
-            delete neighborhood_pointset; 
-            continue; 
-          }
-          if (pixel_pointset->NPoints() < min_points_per_pixel) { 
-            delete neighborhood_pointset; 
-            delete pixel_pointset; 
-            continue; 
-          }
+static int
+WriteOverheadTileGrids(OverheadRasterizer *rasterizer, OverheadTile *tile, RNBoolean tiled, const char *directory_name)
+{
+  // Write base grids
+  if (tile->count_grid) {
+    // Divide by counts to get averages
+    tile->zmean_grid->Divide(*(tile->count_grid));
+    tile->nx_grid->Divide(*(tile->count_grid));
+    tile->ny_grid->Divide(*(tile->count_grid));
+    tile->nz_grid->Divide(*(tile->count_grid));
+    tile->radius_grid->Divide(*(tile->count_grid));
+    tile->horizontal_grid->Divide(*(tile->count_grid));
+
+    // Write grids
+    if (!WriteOverheadTileGrid(*(tile->count_grid), tile, tiled, directory_name, "Base", "Count")) return 0;
+    if (!WriteOverheadTileGrid(*(tile->zmin_grid), tile, tiled, directory_name, "Base", "ZMin")) return 0;
+    if (!WriteOverheadTileGrid(*(tile->zmax_grid), tile, tiled, directory_name, "Base", "ZMax")) return 0;
+    if (!WriteOverheadTileGrid(*(tile->zmean_grid), tile, tiled, directory_name, "Base", "ZMean")) return 0;
+    if (!WriteOverheadTileGrid(*(tile->nx_grid), tile, tiled, directory_name, "Base", "NX")) return 0;
+    if (!WriteOverheadTileGrid(*(tile->ny_grid), tile, tiled, directory_name, "Base", "NY")) return 0;
+    if (!WriteOverheadTileGrid(*(tile->nz_grid), tile, tiled, directory_name, "Base", "NZ")) return 0;
+    if (!WriteOverheadTileGrid(*(tile->radius_grid), tile, tiled, directory_name, "Base", "Radius")) return 0;
+    if (!WriteOverheadTileGrid(*(tile->horizontal_grid), tile, tiled, directory_name, "Base", "Horizontal")) return 0;
+  }
 
-          // Print debug statement
-          // if (print_debug) {
-          //   printf("  %4d/%-4d %4d/%-4d : %d %d : %12d %12d\n", iy, nypixels, ix, nxpixels, grid_x, grid_y,
-          //     neighborhood_pointset->NPoints(), pixel_pointset->NPoints());
-          //   fflush(stdout);
-          // }
-
-          // Gather count statistics
-          RNScalar pixel_count = pixel_pointset->NPoints();
-          RNScalar neighborhood_count = neighborhood_pointset->NPoints();
-
-          // Gather height statistics
-          RNCoord zsum = 0;
-          RNCoord zmax = -FLT_MAX;
-          RNCoord zmin = FLT_MAX;
-          for (int i = 0; i < pixel_pointset->NPoints(); i++) {
-            R3SurfelPoint *point = pixel_pointset->Point(i);
-            R3Point position = point->Position();
-            if (position.Z() > zmax) zmax = position.Z();
-            if (position.Z() < zmin) zmin = position.Z();
-            zsum += position.Z();
-          }
+  // Write color grids
+  if (tile->red_grid) {
+    char name[256];
+    if (tiled) sprintf(name, "Rgb_%d_%d", tile->ix, tile->iy);
+    else sprintf(name, "Rgb");
+    if (!WriteOverheadTileGrid(*(tile->red_grid), tile, tiled, directory_name, "Color", "Red")) return 0;
+    if (!WriteOverheadTileGrid(*(tile->green_grid), tile, tiled, directory_name, "Color", "Green")) return 0;
+    if (!WriteOverheadTileGrid(*(tile->blue_grid), tile, tiled, directory_name, "Color", "Blue")) return 0;
+    if (!WriteImage(*(tile->red_grid), *(tile->green_grid), *(tile->blue_grid), directory_name, "Color", name)) return 0;
+  }
 
-          // Gather ssd statistics
-          RNScalar zssd = 0;
-          RNScalar zmean = zsum / pixel_pointset->NPoints();
-          for (int i = 0; i < pixel_pointset->NPoints(); i++) {
-            R3SurfelPoint *point = pixel_pointset->Point(i);
-            R3Point position = point->Position();
-            RNScalar delta = position.Z() - zmean;
-            zssd += delta * delta;
-          }
+  // Write label grid
+  if (tile->label_grid) {
+    if (!WriteOverheadTileGrid(*(tile->label_grid), tile, tiled, directory_name, "Label", "Identifier")) return 0;
+  }
 
-          // Compute variance statistics
-          RNScalar zvariance = zssd / pixel_pointset->NPoints();
-          RNScalar zstddev = sqrt(zvariance);
-
-          // Compute median statistics
-          RNScalar *zcoords = new RNScalar [ pixel_pointset->NPoints() ];
-          for (int i = 0; i < pixel_pointset->NPoints(); i++) zcoords[i] = pixel_pointset->Point(i)->Z();
-          qsort(zcoords, pixel_pointset->NPoints(), sizeof(RNScalar), RNCompareScalars);
-          RNScalar zmedian = zcoords[pixel_pointset->NPoints() / 2];
-          delete [] zcoords;
-
-          // Compute support elevation
-          RNCoord zsupport = 0;
-          R3Plane plane = EstimateSupportPlane(neighborhood_pointset);
-          if (plane[2] == 1) zsupport = -plane[3];
-          else if (plane[2] != 0) zsupport = (plane[0]*world_position[0] + plane[1]*world_position[1] + plane[3]) / plane[2];
-
-          // Assign grid values
-          pixel_count_grid.SetGridValue(grid_x, grid_y, pixel_count);
-          neighborhood_count_grid.SetGridValue(grid_x, grid_y, neighborhood_count);
-          zmin_grid.SetGridValue(grid_x, grid_y, zmin);
-          zmax_grid.SetGridValue(grid_x, grid_y, zmax);
-          zmean_grid.SetGridValue(grid_x, grid_y, zmean);
-          zmedian_grid.SetGridValue(grid_x, grid_y, zmedian);
-          zstddev_grid.SetGridValue(grid_x, grid_y, zstddev);
-          zsupport_grid.SetGridValue(grid_x, grid_y, zsupport);
-
-          // Delete pixel point set
-          delete pixel_pointset;
-
-          // Delete neighborhood pointset
-          delete neighborhood_pointset;
-        }
-      }
+  // Write slice grids
+  if (tile->slice_grids) {
+    for (int i = 0; i < rasterizer->nslices; i++) {
+      char name[256];
+      sprintf(name, "%d", i);
+      if (!WriteOverheadTileGrid(tile->slice_grids[i], tile, tiled, directory_name, "Slice", name)) return 0;
     }
   }
 
-  // Delete last chunk pointset
-  if (last_chunk_pointset) { 
-    delete last_chunk_pointset; 
-    last_chunk_pointset = NULL; 
+  // Write height grids
+  if (tile->height_grids) {
+    R2Grid *grids = tile->height_grids;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_COUNT_GRID], tile, tiled, directory_name, "Height", "Count")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_NEIGHBORHOOD_COUNT_GRID], tile, tiled, directory_name, "Height", "NeighborhoodCount")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZMIN_GRID], tile, tiled, directory_name, "Height", "ZMin")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZMAX_GRID], tile, tiled, directory_name, "Height", "ZMax")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZMEAN_GRID], tile, tiled, directory_name, "Height", "ZMean")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZMEDIAN_GRID], tile, tiled, directory_name, "Height", "ZMedian")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZSTDDEV_GRID], tile, tiled, directory_name, "Height", "ZStddev")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZSUPPORT_GRID], tile, tiled, directory_name, "Height", "ZSupport")) return 0;
   }
 
-  // Write grids
-  if (!WriteGrid(pixel_count_grid, directory_name, "Height", "Count")) return 0;
-  if (!WriteGrid(neighborhood_count_grid, directory_name, "Height", "NeighborhoodCount")) return 0;
-  if (!WriteGrid(zmin_grid, directory_name, "Height", "ZMin")) return 0;
-  if (!WriteGrid(zmax_grid, directory_name, "Height", "ZMax")) return 0;
-  if (!WriteGrid(zmean_grid, directory_name, "Height", "ZMean")) return 0;
-  if (!WriteGrid(zmedian_grid, directory_name, "Height", "ZMedian")) return 0;
-  if (!WriteGrid(zstddev_grid, directory_name, "Height", "ZStddev")) return 0;
-  if (!WriteGrid(zsupport_grid, directory_name, "Height", "ZSupport")) return 0;
+  // Write pixel grids
+  if (tile->pixel_grids) {
+    R2Grid *grids = tile->pixel_grids;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_COUNT_GRID], tile, tiled, directory_name, "Pixel", "PixelCount")) return 0;
+    if (!WriteOverheadTileGrid(grids[PIXEL_GRAPH_COUNT_GRID], tile, tiled, directory_name, "Pixel", "GraphCount")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_NEIGHBORHOOD_COUNT_GRID], tile, tiled, directory_name, "Pixel", "RegionCount")) return 0;
+    if (!WriteOverheadTileGrid(grids[PIXEL_GRAPH_RADIUS_GRID], tile, tiled, directory_name, "Graph", "GraphRadius")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZMIN_GRID], tile, tiled, directory_name, "Pixel", "ZMin")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZMAX_GRID], tile, tiled, directory_name, "Pixel", "ZMax")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZMEAN_GRID], tile, tiled, directory_name, "Pixel", "ZMean")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZMEDIAN_GRID], tile, tiled, directory_name, "Pixel", "ZMedian")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZSTDDEV_GRID], tile, tiled, directory_name, "Pixel", "ZStddev")) return 0;
+    if (!WriteOverheadTileGrid(grids[HEIGHT_ZSUPPORT_GRID], tile, tiled, directory_name, "Pixel", "ZSupport")) return 0;
+    if (!WriteOverheadTileGrid(grids[PIXEL_PCA0_GRID], tile, tiled, directory_name, "Pixel", "PCA0")) return 0;
+    if (!WriteOverheadTileGrid(grids[PIXEL_PCA1_GRID], tile, tiled, directory_name, "Pixel", "PCA1")) return 0;
+    if (!WriteOverheadTileGrid(grids[PIXEL_PCA2_GRID], tile, tiled, directory_name, "Pixel", "PCA2")) return 0;
+    if (!WriteOverheadTileGrid(grids[PIXEL_NORMAL_X_GRID], tile, tiled, directory_name, "Pixel", "NormalX")) return 0;
+    if (!WriteOverheadTileGrid(grids[PIXEL_NORMAL_Y_GRID], tile, tiled, directory_name, "Pixel", "NormalY")) return 0;
+    if (!WriteOverheadTileGrid(grids[PIXEL_NORMAL_Z_GRID], tile, tiled, directory_name, "Pixel", "NormalZ")) return 0;
+  }
 
-  // Print statistics
-  if (print_verbose) {
-    printf("  Time = %.2f seconds\n", start_time.Elapsed());
-    printf("  Resolution = %d %d\n", pixel_count_grid.XResolution(), pixel_count_grid.YResolution());
-    printf("  Spacing = %g\n", pixel_count_grid.WorldToGridScaleFactor());
-    fflush(stdout);
+  // Write graph grids
+  if (tile->graph_grids) {
+    // Divide by counts to produce averages
+    R2Grid *grids = tile->graph_grids;
+    R2Grid denominator_grid(grids[GRAPH_COUNT_GRID]);
+    denominator_grid.Threshold(RN_EPSILON, R2_GRID_UNKNOWN_VALUE, R2_GRID_KEEP_VALUE);
+    for (int i = GRAPH_ZSUM_GRID; i < NUM_GRAPH_GRIDS; i++) grids[i].Divide(denominator_grid);
+
+    // Write grids
+    if (!WriteOverheadTileGrid(grids[GRAPH_COUNT_GRID], tile, tiled, directory_name, "Graph", "Count")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_ZMIN_GRID], tile, tiled, directory_name, "Graph", "ZMin")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_ZMAX_GRID], tile, tiled, directory_name, "Graph", "ZMax")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_ZSUM_GRID], tile, tiled, directory_name, "Graph", "ZSum")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_PCA0_GRID], tile, tiled, directory_name, "Graph", "PCA0")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_PCA1_GRID], tile, tiled, directory_name, "Graph", "PCA1")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_PCA2_GRID], tile, tiled, directory_name, "Graph", "PCA2")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_NORMAL_X_GRID], tile, tiled, directory_name, "Graph", "NormalX")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_NORMAL_Y_GRID], tile, tiled, directory_name, "Graph", "NormalY")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_NORMAL_Z_GRID], tile, tiled, directory_name, "Graph", "NormalZ")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_HORIZONTAL_GRID], tile, tiled, directory_name, "Graph", "Horizontal")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_VERTICAL_GRID], tile, tiled, directory_name, "Graph", "Vertical")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_OBLIQUE_GRID], tile, tiled, directory_name, "Graph", "Oblique")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_PLANAR_GRID], tile, tiled, directory_name, "Graph", "Planar")) return 0;
+    if (!WriteOverheadTileGrid(grids[GRAPH_NEIGHBOR_RADIUS_GRID], tile, tiled, directory_name, "Graph", "NeighborRadius")) return 0;
+    if (!WriteOverheadTileGrid(denominator_grid, tile, tiled, directory_name, "Graph", "Denominator")) return 0;
   }
 
   // Return success
@@ -1138,176 +1153,243 @@ WriteHeightGrids(R3SurfelScene *scene, const char *directory_name)
 
 
 
-static int 
-WriteGraphGrids(R3SurfelScene *scene, const char *directory_name)
+static int
+WriteOverheadGrids(R3SurfelScene *scene, const char *directory_name)
 {
+  // Parameters
+  const RNScalar slice_spacing = 1.0;
+  const RNLength region_radius = 2;
+  const RNLength graph_radius = 1;
+
   // Start statistics
   RNTime start_time;
   start_time.Read();
   if (print_verbose) {
-    printf("Creating graph images ...\n");
-    printf("NOTE THAT THIS IS REALLY SLOW ...\n");
+    printf("Creating overhead images ...\n");
     fflush(stdout);
   }
-    
-  // Parameters
-  int tile_xpixels = 20;
-  int tile_ypixels = 20;
-  RNScalar horizontal_tolerance = cos(10.0*RN_PI/180.0);
-  RNScalar vertical_tolerance = sin(10.0*RN_PI/180.0);
-  const int max_neighbor_count = 16;
-  RNLength max_neighbor_distance = 1;
-  R3Point cloud [ max_neighbor_count + 1];
-
-  // Allocate grids
-  R2Grid count_grid; InitializeOverheadGrid(count_grid, scene, pixel_spacing, max_resolution, 0);
-  R2Grid zmax_grid(count_grid);  zmax_grid.Clear(R2_GRID_UNKNOWN_VALUE);
-  R2Grid zmin_grid(count_grid);  zmin_grid.Clear(R2_GRID_UNKNOWN_VALUE);
-  R2Grid zsum_grid(count_grid);
-  R2Grid pca0_grid(count_grid);
-  R2Grid pca1_grid(count_grid);
-  R2Grid pca2_grid(count_grid);
-  R2Grid normal_x_grid(count_grid);
-  R2Grid normal_y_grid(count_grid);
-  R2Grid normal_z_grid(count_grid);
-  R2Grid horizontal_grid(count_grid);
-  R2Grid vertical_grid(count_grid);
-  R2Grid oblique_grid(count_grid);
-  R2Grid planar_grid(count_grid);
-  R2Grid neighbor_radius_grid(count_grid);
-
-  // Compute grid by tiles
-  R3SurfelPointSet *last_pointset = NULL;
-  int tile_xcount = count_grid.XResolution() / tile_xpixels;
-  int tile_ycount = count_grid.YResolution() / tile_ypixels;
-  if (tile_xcount * tile_xpixels < count_grid.XResolution()) tile_xcount++;
-  if (tile_ycount * tile_ypixels < count_grid.YResolution()) tile_ycount++;
-  for (int tile_i = 0; tile_i < tile_xcount; tile_i++) {
-    for (int tile_j = 0; tile_j < tile_ycount; tile_j++) {
-      int tile_ix1 = tile_i*tile_xpixels;
-      int tile_iy1 = tile_j*tile_ypixels;
-      int tile_ix2 = (tile_i+1)*tile_xpixels;
-      int tile_iy2 = (tile_j+1)*tile_ypixels;
-      if (tile_ix2 > count_grid.XResolution()) tile_ix2 = count_grid.XResolution();
-      if (tile_iy2 > count_grid.YResolution()) tile_iy2 = count_grid.YResolution();
-      R2Point tile_ip1(tile_ix1, tile_iy1);
-      R2Point tile_ip2(tile_ix2, tile_iy2);
-      R2Point tile_p1 = count_grid.WorldPosition(tile_ip1);
-      R2Point tile_p2 = count_grid.WorldPosition(tile_ip2);
-      R3Box tile_box(tile_p1[0], tile_p1[1], -FLT_MAX, tile_p2[0], tile_p2[1], FLT_MAX);
-      R3Vector tile_overlap(max_neighbor_distance, max_neighbor_distance, 0);
-      R3Box expanded_box(tile_box.Min() - tile_overlap, tile_box.Max() + tile_overlap);
-      R3SurfelBoxConstraint box_constraint(expanded_box);
-      R3SurfelPointSet *tile_pointset = CreatePointSet(scene, NULL, &box_constraint);
-      if (!tile_pointset || (tile_pointset->NPoints() == 0)) continue;
-      R3SurfelPointGraph *tile_graph = new R3SurfelPointGraph(*tile_pointset, max_neighbor_count, max_neighbor_distance);
-      if (!tile_graph || (tile_graph->NPoints() == 0)) { delete tile_pointset; continue; }
-      if (print_debug) printf("%3d/%3d %3d/%3d %9d\n", tile_i, tile_xcount, tile_j, tile_ycount, tile_graph->NPoints());
-      for (int i = 0; i < tile_graph->NPoints(); i++) {
-        R3SurfelPoint *point = tile_graph->Point(i);
-        R3Point position(point->Position());
-        if (!R3Contains(tile_box, position)) continue;
-        if (tile_graph->NNeighbors(i) < 3) continue;
-        R2Point grid_position = count_grid.GridPosition(R2Point(position[0], position[1]));
-        int ix = (int) (grid_position.X() + 0.5);
-        int iy = (int) (grid_position.Y() + 0.5);
-
-        // Create cloud of points in neighborhood
-        cloud[0] = position;
-        for (int j = 0; j < tile_graph->NNeighbors(i); j++) {
-          const R3SurfelPoint *neighbor = tile_graph->Neighbor(i, j);
-          cloud[j+1] = neighbor->Position();
-        }
 
-        // Compute normal with PCA of neighborhood
-        RNScalar variances[3] = { 0, 0, 0 };
-        R3Point centroid = R3Centroid(tile_graph->NNeighbors(i)+1, cloud);
-        R3Triad triad = R3PrincipleAxes(centroid, tile_graph->NNeighbors(i)+1, cloud, NULL, variances);
-        R3Vector normal = triad[2];
-        
-        // Compute neighborhood radius
-        RNScalar neighborhood_radius = R3Distance(cloud[0], cloud[tile_graph->NNeighbors(i)]);
-
-        // Update grids
-        count_grid.AddGridValue(ix, iy, 1);
-        zsum_grid.AddGridValue(ix, iy, point->Z());
-        if ((zmax_grid.GridValue(ix, iy) == R2_GRID_UNKNOWN_VALUE) || (point->Z() > zmax_grid.GridValue(ix, iy)))
-          zmax_grid.SetGridValue(ix, iy, point->Z());
-        if ((zmin_grid.GridValue(ix, iy) == R2_GRID_UNKNOWN_VALUE) || (point->Z() < zmin_grid.GridValue(ix, iy)))
-          zmin_grid.SetGridValue(ix, iy, point->Z());
-        pca0_grid.AddGridValue(ix, iy, variances[0]);
-        pca1_grid.AddGridValue(ix, iy, variances[1]);
-        pca2_grid.AddGridValue(ix, iy, variances[2]);
-        normal_x_grid.AddGridValue(ix, iy, fabs(normal.X()));
-        normal_y_grid.AddGridValue(ix, iy, fabs(normal.Y()));
-        normal_z_grid.AddGridValue(ix, iy, fabs(normal.Z()));
-        neighbor_radius_grid.AddGridValue(ix, iy, neighborhood_radius);
-        if ((variances[1] > 0.04) && (variances[2] < 0.01)) {
-          if (normal.Z() > horizontal_tolerance) horizontal_grid.AddGridValue(ix, iy, 1);
-          else if (fabs(normal.Z()) < vertical_tolerance) vertical_grid.AddGridValue(ix, iy, 1);
-          else oblique_grid.AddGridValue(ix, iy, 1);
-          planar_grid.AddGridValue(ix, iy, 1);
+  // Get convenient variables
+  R3SurfelTree *tree = scene->Tree();
+  if (!tree) return 0;
+  R3SurfelDatabase *database = tree->Database();
+  if (!database) return 0;
+
+  // Compute grid transformation
+  OverheadRasterizer rasterizer;
+  ComputeOverheadGridTransformation(scene, pixel_spacing, max_resolution,
+    rasterizer.xresolution, rasterizer.yresolution, rasterizer.world_to_grid);
+  rasterizer.pixel_size = 1.0 / rasterizer.world_to_grid.ScaleFactor();
+  rasterizer.band_size = 16;
+  rasterizer.tiles = NULL;
+  rasterizer.work_tiles = NULL;
+  rasterizer.work_indices = NULL;
+
+  // Compute slice parameters
+  rasterizer.nslices = 0;
+  rasterizer.slice_zmin = scene->BBox().ZMin();
+  rasterizer.slice_zscale = 1.0 / slice_spacing;
+  if (write_slice_grids) {
+    int nslices = (int) (scene->BBox().ZLength() / slice_spacing) + 1;
+    if ((scene->BBox().ZLength() == 0) || (nslices <= 1)) return 0;
+    rasterizer.nslices = nslices;
+  }
+
+  // Compute neighborhood parameters (and halo of pixels around every tile that they cover)
+  rasterizer.region_radius = region_radius;
+  rasterizer.graph_radius = (graph_radius > rasterizer.pixel_size) ? graph_radius : rasterizer.pixel_size;
+  RNLength halo_radius = 0;
+  if (write_graph_grids || write_pixel_grids) halo_radius = rasterizer.graph_radius;
+  if ((write_height_grids || write_pixel_grids) && (rasterizer.region_radius > halo_radius)) halo_radius = rasterizer.region_radius;
+  rasterizer.halo = (halo_radius > 0) ? (int) (halo_radius / rasterizer.pixel_size) + 1 : 0;
+
+  // Create tiles
+  int tile_xresolution = ((tile_size > 0) && (tile_size < rasterizer.xresolution)) ? tile_size : rasterizer.xresolution;
+  int tile_yresolution = ((tile_size > 0) && (tile_size < rasterizer.yresolution)) ? tile_size : rasterizer.yresolution;
+  int nxtiles = (rasterizer.xresolution + tile_xresolution - 1) / tile_xresolution;
+  int nytiles = (rasterizer.yresolution + tile_yresolution - 1) / tile_yresolution;
+  RNBoolean tiled = (nxtiles > 1) || (nytiles > 1);
+  int ntiles = nxtiles * nytiles;
+  OverheadTile *tiles = new OverheadTile [ ntiles ];
+  for (int iy = 0; iy < nytiles; iy++) {
+    for (int ix = 0; ix < nxtiles; ix++) {
+      OverheadTile *tile = &tiles[iy*nxtiles + ix];
+      tile->ix = ix;
+      tile->iy = iy;
+      tile->xmin = ix * tile_xresolution;
+      tile->ymin = iy * tile_yresolution;
+      tile->xresolution = tile_xresolution;
+      tile->yresolution = tile_yresolution;
+      if (tile->xmin + tile->xresolution > rasterizer.xresolution) tile->xresolution = rasterizer.xresolution - tile->xmin;
+      if (tile->ymin + tile->yresolution > rasterizer.yresolution) tile->yresolution = rasterizer.yresolution - tile->ymin;
+      tile->wxmin = (tile->xmin > rasterizer.halo) ? tile->xmin - rasterizer.halo : 0;
+      tile->wymin = (tile->ymin > rasterizer.halo) ? tile->ymin - rasterizer.halo : 0;
+      int wxmax = tile->xmin + tile->xresolution - 1 + rasterizer.halo;
+      int wymax = tile->ymin + tile->yresolution - 1 + rasterizer.halo;
+      if (wxmax >= rasterizer.xresolution) wxmax = rasterizer.xresolution - 1;
+      if (wymax >= rasterizer.yresolution) wymax = rasterizer.yresolution - 1;
+      tile->wxresolution = wxmax - tile->wxmin + 1;
+      tile->wyresolution = wymax - tile->wymin + 1;
+      tile->samples = NULL;
+      tile->pixel_offsets = NULL;
+      tile->block_offsets = NULL;
+      tile->sample_pixels = NULL;
+    }
+  }
+
+  // Gather blocks of leaf nodes (without reading them)
+  RNArray<OverheadBlock *> blocks;
+  RNArray<R3SurfelNode *> stack;
+  stack.Insert(tree->RootNode());
+  while (!stack.IsEmpty()) {
+    R3SurfelNode *node = stack.Tail();
+    stack.RemoveTail();
+
+    // Check if node is not a leaf
+    if (node->NParts() > 0) {
+      // Decend into children
+      for (int i = 0; i < node->NParts(); i++) {
+        R3SurfelNode *part = node->Part(i);
+        stack.Insert(part);
+      }
+      continue;
+    }
+
+    // Find label of node
+    RNScalar label_identifier = R2_GRID_UNKNOWN_VALUE;
+    if (write_label_grids) {
+      R3SurfelObject *object = node->Object(TRUE);
+      while (object && !object->CurrentLabel()) object = object->Parent();
+      if (object) label_identifier = object->CurrentLabel()->Identifier();
+    }
+
+    // Create overhead blocks
+    for (int i = 0; i < node->NBlocks(); i++) {
+      R3SurfelBlock *block = node->Block(i);
+      if (block->NSurfels() == 0) continue;
+
+      // Compute range of pixels covered by block
+      const R3Box& block_bbox = block->BBox();
+      R2Point p0(block_bbox.XMin(), block_bbox.YMin());
+      R2Point p1(block_bbox.XMax(), block_bbox.YMax());
+      rasterizer.world_to_grid.Apply(p0);
+      rasterizer.world_to_grid.Apply(p1);
+      int ixmin = (int) (p0.X() + 0.5) - 1;
+      int iymin = (int) (p0.Y() + 0.5) - 1;
+      int ixmax = (int) (p1.X() + 0.5) + 1;
+      int iymax = (int) (p1.Y() + 0.5) + 1;
+      if (ixmin < 0) ixmin = 0;
+      if (iymin < 0) iymin = 0;
+      if (ixmax >= rasterizer.xresolution) ixmax = rasterizer.xresolution - 1;
+      if (iymax >= rasterizer.yresolution) iymax = rasterizer.yresolution - 1;
+      if ((ixmin > ixmax) || (iymin > iymax)) continue;
+
+      // Create overhead block
+      OverheadBlock *overhead_block = new OverheadBlock();
+      overhead_block->block = block;
+      overhead_block->label_identifier = label_identifier;
+      overhead_block->ixmin = ixmin;
+      overhead_block->iymin = iymin;
+      overhead_block->ixmax = ixmax;
+      overhead_block->iymax = iymax;
+
+      // Add block to tiles whose windows (tile plus halo) it overlaps
+      int tx0 = (ixmin > rasterizer.halo) ? (ixmin - rasterizer.halo) / tile_xresolution : 0;
+      int ty0 = (iymin > rasterizer.halo) ? (iymin - rasterizer.halo) / tile_yresolution : 0;
+      int tx1 = (ixmax + rasterizer.halo) / tile_xresolution;
+      int ty1 = (iymax + rasterizer.halo) / tile_yresolution;
+      if (tx1 >= nxtiles) tx1 = nxtiles - 1;
+      if (ty1 >= nytiles) ty1 = nytiles - 1;
+      for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+          tiles[ty*nxtiles + tx].blocks.Insert(overhead_block);
         }
       }
 
-      // Delete temporary memory
-      delete tile_graph;
-      if (last_pointset) delete last_pointset;
-      last_pointset = tile_pointset;
+      // Remember first and last tiles (in processing order), so that block is read only once
+      overhead_block->first_tile = ty0*nxtiles + tx0;
+      overhead_block->last_tile = ty1*nxtiles + tx1;
+      blocks.Insert(overhead_block);
     }
   }
 
-  // Delete last pointset
-  if (last_pointset) delete last_pointset;
-
-  // Divide by counts to produce averages
-  R2Grid denominator_grid(count_grid);
-  denominator_grid.Threshold(RN_EPSILON, R2_GRID_UNKNOWN_VALUE, R2_GRID_KEEP_VALUE);
-  zsum_grid.Divide(denominator_grid); 
-  pca0_grid.Divide(denominator_grid);
-  pca1_grid.Divide(denominator_grid);
-  pca2_grid.Divide(denominator_grid);
-  normal_x_grid.Divide(denominator_grid);
-  normal_y_grid.Divide(denominator_grid);
-  normal_z_grid.Divide(denominator_grid);
-  horizontal_grid.Divide(denominator_grid);
-  vertical_grid.Divide(denominator_grid);
-  oblique_grid.Divide(denominator_grid);
-  oblique_grid.Divide(denominator_grid);
-  neighbor_radius_grid.Divide(denominator_grid);
+  // Rasterize batches of tiles (one tile per thread, so that tiles and their bands are rasterized in parallel)
+  int status = 1;
+  int batch_size = (nthreads > 0) ? nthreads : RNNumberOfThreads();
+  if (batch_size < 1) batch_size = 1;
+  for (int t0 = 0; t0 < ntiles; t0 += batch_size) {
+    int t1 = (t0 + batch_size < ntiles) ? t0 + batch_size : ntiles;
+    rasterizer.tiles = &tiles[t0];
+
+    // Read blocks that become resident with tiles of batch
+    for (int t = t0; t < t1; t++) {
+      OverheadTile *tile = &tiles[t];
+      for (int i = 0; i < tile->blocks.NEntries(); i++) {
+        OverheadBlock *overhead_block = tile->blocks.Kth(i);
+        if (overhead_block->first_tile != t) continue;
+        database->ReadBlock(overhead_block->block);
+      }
+    }
 
-  // Write grids
-  if (!WriteGrid(count_grid, directory_name, "Graph", "Count")) return 0;
-  if (!WriteGrid(zmin_grid, directory_name, "Graph", "ZMin")) return 0;
-  if (!WriteGrid(zmax_grid, directory_name, "Graph", "ZMax")) return 0;
-  if (!WriteGrid(zsum_grid, directory_name, "Graph", "ZSum")) return 0;
-  if (!WriteGrid(pca0_grid, directory_name, "Graph", "PCA0")) return 0;
-  if (!WriteGrid(pca1_grid, directory_name, "Graph", "PCA1")) return 0;
-  if (!WriteGrid(pca2_grid, directory_name, "Graph", "PCA2")) return 0;
-  if (!WriteGrid(normal_x_grid, directory_name, "Graph", "NormalX")) return 0;
-  if (!WriteGrid(normal_y_grid, directory_name, "Graph", "NormalY")) return 0;
-  if (!WriteGrid(normal_z_grid, directory_name, "Graph", "NormalZ")) return 0;
-  if (!WriteGrid(horizontal_grid, directory_name, "Graph", "Horizontal")) return 0;
-  if (!WriteGrid(vertical_grid, directory_name, "Graph", "Vertical")) return 0;
-  if (!WriteGrid(oblique_grid, directory_name, "Graph", "Oblique")) return 0;
-  if (!WriteGrid(planar_grid, directory_name, "Graph", "Planar")) return 0;
-  if (!WriteGrid(neighbor_radius_grid, directory_name, "Graph", "NeighborRadius")) return 0;
-  if (!WriteGrid(denominator_grid, directory_name, "Graph", "Denominator")) return 0;
+    // Bin surfels of tiles by pixel (so that each band visits only its own surfels and their neighbors)
+    for (int t = t0; t < t1; t++) CreateOverheadTileGrids(&rasterizer, &tiles[t]);
+    CreateOverheadTileSamples(&rasterizer, t1 - t0);
+
+    // Rasterize bands of all tiles in batch in parallel
+    RasterizeOverheadTiles(&rasterizer, t1 - t0);
+    for (int t = t0; t < t1; t++) DeleteOverheadTileSamples(&tiles[t]);
+
+    // Write grids
+    for (int t = t0; t < t1; t++) {
+      if (!WriteOverheadTileGrids(&rasterizer, &tiles[t], tiled, directory_name)) status = 0;
+      DeleteOverheadTileGrids(&tiles[t]);
+    }
+
+    // Release blocks that are not needed by later tiles
+    for (int t = t0; t < t1; t++) {
+      OverheadTile *tile = &tiles[t];
+      for (int i = 0; i < tile->blocks.NEntries(); i++) {
+        OverheadBlock *overhead_block = tile->blocks.Kth(i);
+        if (overhead_block->last_tile != t) continue;
+        database->ReleaseBlock(overhead_block->block);
+      }
+    }
+
+    // Print debug statement
+    if (print_debug) {
+      for (int t = t0; t < t1; t++) {
+        OverheadTile *tile = &tiles[t];
+        printf("  %4d/%4d %4d/%4d : %9d\n", tile->iy, nytiles, tile->ix, nxtiles, tile->blocks.NEntries());
+      }
+      fflush(stdout);
+    }
+  }
 
   // Print statistics
   if (print_verbose) {
     printf("  Time = %.2f seconds\n", start_time.Elapsed());
-    printf("  Resolution = %d %d\n", zmin_grid.XResolution(), zmin_grid.YResolution());
-    printf("  Spacing = %g\n", zmin_grid.WorldToGridScaleFactor());
+    printf("  Resolution = %d %d\n", rasterizer.xresolution, rasterizer.yresolution);
+    printf("  Spacing = %g\n", rasterizer.world_to_grid.ScaleFactor());
+    printf("  # Tiles = %d %d\n", nxtiles, nytiles);
+    printf("  # Blocks = %d\n", blocks.NEntries());
+    if (rasterizer.nslices > 0) printf("  # Slices = %d\n", rasterizer.nslices);
     fflush(stdout);
   }
 
-  // Return success
-  return 1;
+  // Delete blocks and tiles
+  for (int i = 0; i < blocks.NEntries(); i++) delete blocks[i];
+  delete [] tiles;
+
+  // Return status
+  return status;
 }
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Planar grid functions
+////////////////////////////////////////////////////////////////////////
+
 static int 
 WritePlanarGrids(R3SurfelScene *scene, const char *directory_name)
 {
@@ -1869,13 +1951,10 @@ WriteGrids(R3SurfelScene *scene, const char *directory_name)
   system(buffer);
 
   // Write grids
-  if (write_base_grids && !WriteBaseGrids(scene, directory_name)) return 0;
-  if (write_color_grids && !WriteColorGrids(scene, directory_name)) return 0;
-  if (write_slice_grids && !WriteSliceGrids(scene, directory_name)) return 0;
-  if (write_height_grids && !WriteHeightGrids(scene, directory_name)) return 0;
-  if (write_graph_grids && !WriteGraphGrids(scene, directory_name)) return 0;
+  if ((write_base_grids || write_color_grids || write_slice_grids || write_label_grids ||
+       write_height_grids || write_graph_grids || write_pixel_grids) && 
+      !WriteOverheadGrids(scene, directory_name)) return 0;
   if (write_planar_grids && !WritePlanarGrids(scene, directory_name)) return 0;
-  if (write_pixel_grids && !WritePixelGrids(scene, directory_name)) return 0;
   if (write_horizontal_grids && !WriteHorizontalGrids(scene, directory_name)) return 0;
 
   // Return success
@@ -1908,9 +1987,12 @@ ParseArgs(int argc, char **argv)
       else if (!strcmp(*argv, "-graph"))  { write_graph_grids = 1; default_grids = 0; }
       else if (!strcmp(*argv, "-planar"))  { write_planar_grids = 1; default_grids = 0; }
       else if (!strcmp(*argv, "-horizontal"))  { write_horizontal_grids = 1; default_grids = 0; }
+      else if (!strcmp(*argv, "-label"))  { write_label_grids = 1; default_grids = 0; }
       else if (!strcmp(*argv, "-pixel_spacing")) { argc--; argv++; pixel_spacing = atof(*argv); }
       else if (!strcmp(*argv, "-max_resolution")) { argc--; argv++; max_resolution = atoi(*argv); }
       else if (!strcmp(*argv, "-chunk_size")) { argc--; argv++; chunk_size = atof(*argv); }
+      else if (!strcmp(*argv, "-tile_size")) { argc--; argv++; tile_size = atoi(*argv); }
+      else if (!strcmp(*argv, "-threads")) { argc--; argv++; nthreads = atoi(*argv); }
       else { fprintf(stderr, "Invalid program argument: %s", *argv); exit(1); }
       argv++; argc--;
     }
@@ -1929,6 +2011,12 @@ ParseArgs(int argc, char **argv)
     return FALSE;
   }
 
+  // Check tiling (horizontal grids are computed from a single Base_ZMax grid)
+  if ((tile_size > 0) && write_horizontal_grids) {
+    fprintf(stderr, "Horizontal grids cannot be computed with -tile_size\n");
+    return FALSE;
+  }
+
   // Set grid selection if nothing else specified
   if (default_grids) {
     write_base_grids = 1;
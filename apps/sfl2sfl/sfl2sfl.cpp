@@ -18,6 +18,7 @@ static char *input_scene_name = NULL;
 static char *input_database_name = NULL;
 static char *output_scene_name = NULL;
 static char *output_database_name = NULL;
+static int compact_block_order = -1;
 static int print_verbose = 0;
 
 
@@ -112,6 +113,10 @@ WriteScene(R3SurfelScene *scene, const char *output_scene_name, const char *outp
     if (!output_scene->OpenFile(output_scene_name, output_database_name, "w", "w")) return 0;
     if (!CreateFeatures(output_scene)) return 0;
     output_scene->InsertScene(*scene);
+    if (compact_block_order >= 0) {
+      R3SurfelDatabase *output_database = output_scene->Tree()->Database();
+      if (!output_database->CompactFile(compact_block_order)) return 0;
+    }
     if (!output_scene->CloseFile()) return 0;
   }
   else {
@@ -151,6 +156,8 @@ ParseArgs(int argc, char **argv)
   while (argc > 0) {
     if ((*argv)[0] == '-') {
       if (!strcmp(*argv, "-v")) print_verbose = 1;
+      else if (!strcmp(*argv, "-compact")) compact_block_order = R3_SURFEL_DATABASE_TREE_BLOCK_ORDER;
+      else if (!strcmp(*argv, "-compact_morton")) compact_block_order = R3_SURFEL_DATABASE_MORTON_BLOCK_ORDER;
       else { fprintf(stderr, "Invalid program argument: %s", *argv); exit(1); }
       argv++; argc--;
     }
@@ -0,0 +1,355 @@
+// Program to check picking surfels with a bounding hierarchy against picking them by rendering node ids
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Graphics/R3Graphics.h"
+#include "R3Surfels/R3Surfels.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Program arguments
+////////////////////////////////////////////////////////////////////////
+
+static char *input_scene_name = NULL;
+static char *input_database_name = NULL;
+static int width = 640;
+static int height = 480;
+static int pixel_spacing = 32;
+static RNScalar target_resolution = 30;
+static RNBoolean backfacing_visibility = TRUE;
+static RNBoolean print_verbose = FALSE;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Pick parameters (as in R3SurfelViewer::PickNode)
+////////////////////////////////////////////////////////////////////////
+
+// Size of points drawn with node ids by the rendering pick pass (in pixels)
+static const int pick_point_size = 10;
+
+// Radius of search for surfel near unprojected position by the rendering pick pass
+static const RNLength pick_search_radius = 0.1;
+
+// How close the cursor has to be to a surfel for the picker (in pixels)
+static const RNLength pick_tolerance = 5;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Surfel scene I/O Functions
+////////////////////////////////////////////////////////////////////////
+
+static R3SurfelScene *
+OpenScene(const char *input_scene_name, const char *input_database_name)
+{
+  // Allocate surfel scene
+  R3SurfelScene *scene = new R3SurfelScene();
+  if (!scene) {
+    fprintf(stderr, "Unable to allocate scene\n");
+    return NULL;
+  }
+
+  // Open surfel scene files
+  if (!scene->OpenFile(input_scene_name, input_database_name, "r", "r")) {
+    delete scene;
+    return NULL;
+  }
+
+  // Return scene
+  return scene;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Picking functions
+////////////////////////////////////////////////////////////////////////
+
+static R3SurfelNode *
+PickWithNodeIds(R3SurfelScene *scene, const R3SurfelNodeSet& nodes, const R3Viewer& viewer,
+  int x, int y, R3Point *picked_position, R3SurfelBlock **picked_block, const R3Surfel **picked_surfel,
+  R3SurfelBlock **drawn_block, const R3Surfel **drawn_surfel)
+{
+  // Get convenient variables
+  const R3Camera& camera = viewer.Camera();
+  RNCoord cx = x + 0.5;
+  RNCoord cy = y + 0.5;
+  RNLength half_size = 0.5 * pick_point_size;
+
+  // Find node drawn at pixel, as by the depth test when rendering points with node ids
+  // (points cover pixels whose centers are inside their square, and ties keep the first point drawn)
+  R3SurfelNode *hit_node = NULL;
+  R3SurfelBlock *hit_block = NULL;
+  const R3Surfel *hit_surfel = NULL;
+  RNLength hit_depth = FLT_MAX;
+  for (int i = 0; i < nodes.NNodes(); i++) {
+    R3SurfelNode *node = nodes.Node(i);
+    for (int j = 0; j < node->NBlocks(); j++) {
+      R3SurfelBlock *block = node->Block(j);
+      const R3Point& origin = block->Origin();
+      for (int k = 0; k < block->NSurfels(); k++) {
+        const R3Surfel *surfel = block->Surfel(k);
+        if (!backfacing_visibility) {
+          R3Vector normal(surfel->NX(), surfel->NY(), surfel->NZ());
+          if (normal.Dot(camera.Towards()) >= 0) continue;
+        }
+        R3Point position(origin.X() + surfel->X(), origin.Y() + surfel->Y(), origin.Z() + surfel->Z());
+        RNLength depth = (position - camera.Origin()).Dot(camera.Towards());
+        if ((depth < camera.Near()) || (depth > camera.Far())) continue;
+        if (depth >= hit_depth) continue;
+        R2Point p = viewer.ViewportPoint(position);
+        if ((cx < p.X() - half_size) || (cx >= p.X() + half_size)) continue;
+        if ((cy < p.Y() - half_size) || (cy >= p.Y() + half_size)) continue;
+        hit_depth = depth;
+        hit_node = node;
+        hit_block = block;
+        hit_surfel = surfel;
+      }
+    }
+  }
+
+  // Check if hit anything
+  if (!hit_node) return NULL;
+
+  // Return surfel drawn at pixel
+  if (drawn_block) *drawn_block = hit_block;
+  if (drawn_surfel) *drawn_surfel = hit_surfel;
+
+  // Unproject window coordinates of pixel at depth of hit
+  R3Ray ray = viewer.WorldRay(x, y);
+  R3Point position = ray.Start() + ray.Vector() * (hit_depth / ray.Vector().Dot(camera.Towards()));
+  if (picked_position) *picked_position = position;
+  if (picked_block) *picked_block = NULL;
+  if (picked_surfel) *picked_surfel = NULL;
+
+  // Find surfel in scene closest to unprojected position
+  R3SurfelSphereConstraint sphere_constraint(R3Sphere(position, pick_search_radius));
+  R3SurfelPointSet *pointset = CreatePointSet(scene, NULL, &sphere_constraint);
+  if (pointset) {
+    R3SurfelPoint *closest_point = NULL;
+    RNLength closest_distance = FLT_MAX;
+    for (int i = 0; i < pointset->NPoints(); i++) {
+      R3SurfelPoint *point = pointset->Point(i);
+      RNLength distance = R3SquaredDistance(point->Position(), position);
+      if (distance < closest_distance) {
+        closest_distance = distance;
+        closest_point = point;
+      }
+    }
+    if (closest_point) {
+      if (picked_position) *picked_position = closest_point->Position();
+      if (picked_block) *picked_block = closest_point->Block();
+      if (picked_surfel) *picked_surfel = closest_point->Surfel();
+    }
+    delete pointset;
+  }
+
+  // Return hit node
+  return hit_node;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Check functions
+////////////////////////////////////////////////////////////////////////
+
+static R3Viewer
+CreateViewer(R3SurfelScene *scene)
+{
+  // Look at center of scene obliquely from above
+  R3Box bbox = scene->BBox();
+  R3Point center = bbox.Centroid();
+  RNLength radius = bbox.DiagonalRadius();
+  R3Vector towards(1, 1, -1);
+  towards.Normalize();
+  R3Point eye = center - 1.5 * radius * towards;
+  R3Vector right = towards % R3posz_vector;
+  right.Normalize();
+  R3Vector up = right % towards;
+
+  // Create viewer
+  RNAngle xfov = 0.5;
+  RNAngle yfov = atan(tan(xfov) * height / width);
+  R3Camera camera(eye, towards, up, xfov, yfov, 0.01 * radius, 10 * radius);
+  R2Viewport viewport(0, 0, width, height);
+  return R3Viewer(camera, viewport);
+}
+
+
+
+static int
+CheckPicking(R3SurfelScene *scene)
+{
+  // Start statistics
+  RNTime start_time;
+  start_time.Read();
+
+  // Read working set (as in R3SurfelViewer::UpdateWorkingSet)
+  R3SurfelTree *tree = scene->Tree();
+  R3SurfelNodeSet nodes;
+  nodes.InsertNodes(tree, scene->BBox().Centroid(), scene->BBox().DiagonalRadius(),
+    -FLT_MAX, FLT_MAX, target_resolution, RN_EPSILON);
+  nodes.ReadBlocks();
+
+  // Create viewer
+  R3Viewer viewer = CreateViewer(scene);
+  const R3Camera& camera = viewer.Camera();
+
+  // Build picker (as in R3SurfelViewer::UpdatePicker)
+  R3SurfelPicker picker;
+  picker.Build(nodes);
+  picker.SetCamera(camera.Origin(), camera.Towards(), camera.Up(),
+    camera.XFOV(), camera.YFOV(), camera.Near(), camera.Far());
+  picker.SetViewport(viewer.Viewport().BBox());
+  picker.SetBackfacingVisibility(backfacing_visibility);
+  picker.SetPickTolerance(pick_tolerance);
+  RNScalar build_time = start_time.Elapsed();
+
+  // Pick fixed pixels both ways
+  int npixels = 0, nhits = 0, nnode_matches = 0, ndrawn_matches = 0, nreturned_matches = 0;
+  int nrendering_only = 0, npicker_only = 0;
+  RNLength max_distance = 0;
+  RNScalar rendering_time = 0, picker_time = 0;
+  for (int y = pixel_spacing / 2; y < height; y += pixel_spacing) {
+    for (int x = pixel_spacing / 2; x < width; x += pixel_spacing) {
+      npixels++;
+
+      // Pick with node ids
+      RNTime rendering_start;
+      rendering_start.Read();
+      R3Point position1(0, 0, 0);
+      R3SurfelBlock *block1 = NULL;
+      const R3Surfel *surfel1 = NULL;
+      R3SurfelBlock *drawn_block = NULL;
+      const R3Surfel *drawn_surfel = NULL;
+      R3SurfelNode *node1 = PickWithNodeIds(scene, nodes, viewer, x, y,
+        &position1, &block1, &surfel1, &drawn_block, &drawn_surfel);
+      rendering_time += rendering_start.Elapsed();
+
+      // Pick with picker at center of pixel
+      RNTime picker_start;
+      picker_start.Read();
+      R3Point position2(0, 0, 0);
+      R3SurfelBlock *block2 = NULL;
+      const R3Surfel *surfel2 = NULL;
+      R3SurfelNode *node2 = picker.PickNode(R2Point(x + 0.5, y + 0.5), &position2, &block2, &surfel2);
+      picker_time += picker_start.Elapsed();
+
+      // Compare results
+      if (!node1 && !node2) continue;
+      if (!node2) { nrendering_only++; continue; }
+      if (!node1) { npicker_only++; continue; }
+      nhits++;
+      if (node1 == node2) nnode_matches++;
+      if ((drawn_block == block2) && (drawn_surfel == surfel2)) ndrawn_matches++;
+      if ((block1 == block2) && (surfel1 == surfel2)) nreturned_matches++;
+      RNLength distance = R3Distance(position1, position2);
+      if (distance > max_distance) max_distance = distance;
+      if (print_verbose && ((node1 != node2) || (drawn_surfel != surfel2))) {
+        printf("  Pixel %d %d : nodes %d %d : distance %g\n", x, y,
+          nodes.NodeIndex(node1), nodes.NodeIndex(node2), distance);
+      }
+    }
+  }
+
+  // Print statistics
+  printf("Checked picking of %d pixels on %d nodes ...\n", npixels, nodes.NNodes());
+  printf("  Time = %.2f seconds\n", start_time.Elapsed());
+  printf("  Build time = %.3f seconds\n", build_time);
+  printf("  Rendering pick time = %.3f seconds\n", rendering_time);
+  printf("  Picker pick time = %.3f seconds\n", picker_time);
+  printf("  # Hits = %d\n", nhits);
+  printf("  # Rendering only = %d\n", nrendering_only);
+  printf("  # Picker only = %d\n", npicker_only);
+  printf("  # Node matches = %d\n", nnode_matches);
+  printf("  # Drawn surfel matches = %d\n", ndrawn_matches);
+  printf("  # Returned surfel matches = %d\n", nreturned_matches);
+  printf("  Max distance to returned position = %g\n", max_distance);
+  fflush(stdout);
+
+  // Release blocks
+  nodes.ReleaseBlocks();
+
+  // Return whether both ways hit the same nodes, and the picker returned the surfels drawn at the pixels
+  // (rendering returned the surfel closest to the unprojected pixel corner instead, which can be any
+  // surfel within the pick tolerance, so it is only reported)
+  if ((nrendering_only > 0) || (npicker_only > 0)) return 0;
+  if (nnode_matches < nhits) return 0;
+  if (ndrawn_matches < nhits) return 0;
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Argument parsing functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+ParseArgs(int argc, char **argv)
+{
+  // Parse arguments
+  argc--; argv++;
+  while (argc > 0) {
+    if ((*argv)[0] == '-') {
+      if (!strcmp(*argv, "-v")) print_verbose = TRUE;
+      else if (!strcmp(*argv, "-width")) { argc--; argv++; width = atoi(*argv); }
+      else if (!strcmp(*argv, "-height")) { argc--; argv++; height = atoi(*argv); }
+      else if (!strcmp(*argv, "-pixel_spacing")) { argc--; argv++; pixel_spacing = atoi(*argv); }
+      else if (!strcmp(*argv, "-resolution")) { argc--; argv++; target_resolution = atof(*argv); }
+      else if (!strcmp(*argv, "-no_backfacing")) backfacing_visibility = FALSE;
+      else { fprintf(stderr, "Invalid program argument: %s\n", *argv); return 0; }
+      argv++; argc--;
+    }
+    else {
+      if (!input_scene_name) input_scene_name = *argv;
+      else if (!input_database_name) input_database_name = *argv;
+      else { fprintf(stderr, "Invalid program argument: %s\n", *argv); return 0; }
+      argv++; argc--;
+    }
+  }
+
+  // Check filenames and sampling
+  if (!input_scene_name || !input_database_name || (width < 1) || (height < 1) || (pixel_spacing < 1)) {
+    fprintf(stderr, "Usage: sflpickcheck inputscenefile inputdatabasefile [-width #] [-height #] [-pixel_spacing #] [-resolution #] [-no_backfacing] [-v]\n");
+    return 0;
+  }
+
+  // Return OK status
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Main
+////////////////////////////////////////////////////////////////////////
+
+int
+main(int argc, char **argv)
+{
+  // Parse program arguments
+  if (!ParseArgs(argc, argv)) exit(-1);
+
+  // Open scene
+  R3SurfelScene *scene = OpenScene(input_scene_name, input_database_name);
+  if (!scene) exit(-1);
+
+  // Check picking
+  int status = CheckPicking(scene);
+  printf("%s\n", (status) ? "PASSED" : "FAILED");
+
+  // Close scene
+  if (!scene->CloseFile()) exit(-1);
+  delete scene;
+
+  // Return whether check passed
+  return (status) ? 0 : 1;
+}
@@ -21,6 +21,7 @@ R3SurfelViewer::
 R3SurfelViewer(R3SurfelScene *scene)
   : scene(NULL),
     resident_nodes(),
+    picker(),
     viewer(),
     viewing_extent(FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX),
     center_point(0,0,0),
@@ -1389,6 +1390,7 @@ EmptyWorkingSet(void)
 
   // Empty resident nodes
   resident_nodes.Empty();
+  picker.Empty();
 }
 
 
@@ -1415,6 +1417,7 @@ UpdateWorkingSet(const R3Point& center, RNScalar resolution, RNScalar radius)
 
   // Now use newnodes 
   resident_nodes = new_resident_nodes;
+  picker.Empty();
 }
 
 
@@ -1570,6 +1573,7 @@ InsertIntoWorkingSet(R3SurfelNode *node, RNBoolean full_resolution)
 
     // Insert into resident nodes
     resident_nodes.InsertNode(node);
+    picker.Empty();
   }
 }
 
@@ -1599,6 +1603,7 @@ RemoveFromWorkingSet(R3SurfelNode *node, RNBoolean full_resolution)
 
     // Remove from resident nodes
     resident_nodes.RemoveNode(node);
+    picker.Empty();
   }
 }
 
@@ -1623,88 +1628,65 @@ RotateWorld(RNScalar factor, const R3Point& origin, int, int, int dx, int dy)
 
 
 
-#if 1
-
-R3SurfelNode *R3SurfelViewer::
-PickNode(int x, int y, R3Point *picked_position, 
-  R3SurfelBlock **picked_block, const R3Surfel **picked_surfel,
-  RNBoolean exclude_nonobjects) 
+void R3SurfelViewer::
+UpdatePicker(void)
 {
-  // How close the cursor has to be to a point (in pixels)
-  int pick_tolerance = 10;
+  // Build picking index over resident nodes
+  if (picker.IsEmpty()) picker.Build(resident_nodes);
 
-  // Clear window 
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  // Update picking camera
+  const R3Camera& camera = viewer.Camera();
+  picker.SetCamera(camera.Origin(), camera.Towards(), camera.Up(),
+    camera.XFOV(), camera.YFOV(), camera.Near(), camera.Far());
+  picker.SetViewport(viewer.Viewport().BBox());
+
+  // Update picking filters
+  picker.SetAerialVisibility(aerial_visibility);
+  picker.SetTerrestrialVisibility(terrestrial_visibility);
+  picker.SetBackfacingVisibility(backfacing_visibility);
+  picker.SetViewingExtent(viewing_extent);
+}
 
-  // Set viewing transformation
-  viewer.Load();
 
-  // Set viewing extent
-  LoadViewingExtent(this);
 
-  // Set OpenGL stuff
-  glPointSize(pick_tolerance);    
+int R3SurfelViewer::
+PickNodes(const R2Box& rectangle, RNArray<R3SurfelNode *> *nodes, R3SurfelPointSet *points)
+{
+  // Select resident nodes with surfels inside rectangle
+  UpdatePicker();
+  return picker.SelectNodes(rectangle, nodes, points);
+}
 
-  // Draw everything
-  for (int i = 0; i < resident_nodes.NNodes(); i++) {
-    R3SurfelNode *node = resident_nodes.Node(i);
 
-    // Set color
-    unsigned char rgba[4];
-    int node_index = i + 1;
-    rgba[0] = (node_index >> 16) & 0xFF;
-    rgba[1] = (node_index >> 8) & 0xFF;
-    rgba[2] = node_index & 0xFF;
-    rgba[3] = 0xFE;
-    glColor4ubv(rgba);
 
-    // Draw blocks
-    for (int j = 0; j < node->NBlocks(); j++) {
-      R3SurfelBlock *block = node->Block(j);
-      glPushMatrix();
-      const R3Point& origin = block->Origin();
-      glTranslated(origin[0], origin[1], origin[2]);
-      glBegin(GL_POINTS);
-      for (int k = 0; k < block->NSurfels(); k++) {
-        const R3Surfel *surfel = block->Surfel(k);
-        if (!aerial_visibility && surfel->IsAerial()) continue;
-        if (!terrestrial_visibility && surfel->IsTerrestrial()) continue;
-        if (!backfacing_visibility) {
-          R3Vector normal(surfel->NX(), surfel->NY(), surfel->NZ());
-          if (normal.Dot(viewer.Camera().Towards()) >= 0) continue;
-        }
-        glVertex3fv(surfel->Coords());
-      }
-      glEnd();
-      glPopMatrix();
-    }
-  }
+int R3SurfelViewer::
+PickNodes(const R2Polygon& lasso, RNArray<R3SurfelNode *> *nodes, R3SurfelPointSet *points)
+{
+  // Select resident nodes with surfels inside lasso
+  UpdatePicker();
+  return picker.SelectNodes(lasso, nodes, points);
+}
 
-  // Reset OpenGL stuff
-  glPointSize(1);
-  glFinish();
 
-  // Reset viewing modes
-  LoadViewingExtent(NULL);
 
-  // Read color buffer at cursor position
-  unsigned char rgba[4];
-  glReadPixels(x, y, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
-  if (rgba[3] == 0) return NULL;
-
-  // Determine node index
-  int r = rgba[0] & 0xFF;
-  int g = rgba[1] & 0xFF;
-  int b = rgba[2] & 0xFF;
-  int a = rgba[3] & 0xFF;
-  if (a != 0xFE) return NULL;
-  int node_index = (r << 16) | (g << 8) | b;
-  node_index--;
-
-  // Determine node
-  if (node_index < 0) return NULL;
-  if (node_index >= resident_nodes.NNodes()) return NULL;
-  R3SurfelNode *hit_node = resident_nodes.Node(node_index);
+#if 1
+
+R3SurfelNode *R3SurfelViewer::
+PickNode(int x, int y, R3Point *picked_position, 
+  R3SurfelBlock **picked_block, const R3Surfel **picked_surfel,
+  RNBoolean exclude_nonobjects) 
+{
+  // How close the cursor has to be to a point (in pixels)
+  RNLength pick_tolerance = 5;
+
+  // Find closest surfel near center of cursor pixel with CPU picking index
+  UpdatePicker();
+  picker.SetPickTolerance(pick_tolerance);
+  R3Point hit_position(0,0,0);
+  R3SurfelBlock *hit_block = NULL;
+  const R3Surfel *hit_surfel = NULL;
+  R3SurfelNode *hit_node = picker.PickNode(R2Point(x + 0.5, y + 0.5), &hit_position, &hit_block, &hit_surfel);
+  if (!hit_node) return NULL;
 
   // Find node part of an object
   R3SurfelNode *picked_node = hit_node;
@@ -1750,50 +1732,10 @@ PickNode(int x, int y, R3Point *picked_position,
     }
   }
     
-  // Find hit position
-  GLfloat depth;
-  GLdouble p[3];
-  GLint viewport[4];
-  GLdouble modelview_matrix[16];
-  GLdouble projection_matrix[16];
-  glGetIntegerv(GL_VIEWPORT, viewport);
-  glGetDoublev(GL_MODELVIEW_MATRIX, modelview_matrix);
-  glGetDoublev(GL_PROJECTION_MATRIX, projection_matrix);
-  glReadPixels(x, y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
-  gluUnProject(x, y, depth, modelview_matrix, projection_matrix, viewport, &(p[0]), &(p[1]), &(p[2]));
-  R3Point position(p[0], p[1], p[2]);
-  if (picked_position) *picked_position = position;
-
-  // Find hit surfel
-  if (picked_block || picked_surfel) {
-    // Create pointset in vicinity of picked position
-    R3Point position(p[0], p[1], p[2]);
-    R3SurfelSphereConstraint sphere_constraint(R3Sphere(position, 0.1));
-    R3SurfelPointSet *pointset = CreatePointSet(scene, NULL, &sphere_constraint);
-    if (pointset) {
-      // Find surfel point closest to picked position
-      R3SurfelPoint *closest_point = NULL;
-      RNLength closest_distance = FLT_MAX;
-      for (int i = 0; i < pointset->NPoints(); i++) {
-        R3SurfelPoint *point = pointset->Point(i);
-        RNLength distance = R3SquaredDistance(point->Position(), position);
-        if (distance < closest_distance) {
-          closest_distance = distance;
-          closest_point = point;
-        }
-      }
-
-      // Return closest point
-      if (closest_point) {
-        if (picked_position) *picked_position = closest_point->Position();
-        if (picked_block) *picked_block = closest_point->Block();
-        if (picked_surfel) *picked_surfel = closest_point->Surfel();
-      }
-
-      // Delete point set
-      delete pointset;
-    }
-  }
+  // Return hit position, block, and surfel
+  if (picked_position) *picked_position = hit_position;
+  if (picked_block) *picked_block = hit_block;
+  if (picked_surfel) *picked_surfel = hit_surfel;
 
   // Return picked node
   return picked_node;
@@ -2044,6 +1986,7 @@ SplitLeafNodes(R3SurfelNode *source_node, const R3SurfelConstraint& constraint,
             R3SurfelNode *partB = partsB.Kth(j);
             resident_nodes.InsertNode(partB);
           }
+          picker.Empty();
         }
       }
 
@@ -148,6 +148,10 @@ public:
   R3SurfelNode *PickNode(int xcursor, int ycursor, 
     R3Point *hit_position = NULL, R3SurfelBlock **block = NULL, const R3Surfel **surfel = NULL,
     RNBoolean exclude_nonobjects = FALSE);
+  int PickNodes(const R2Box& rectangle, 
+    RNArray<R3SurfelNode *> *nodes, R3SurfelPointSet *points = NULL);
+  int PickNodes(const R2Polygon& lasso, 
+    RNArray<R3SurfelNode *> *nodes, R3SurfelPointSet *points = NULL);
 
   // Object editing 
   int SplitLeafNodes(R3SurfelNode *source_node, const R3SurfelConstraint& constraint, 
@@ -168,6 +172,7 @@ protected:
   void SetScene(R3SurfelScene *scene);
 
   // Viewing utility functions
+  void UpdatePicker(void);
   void RotateWorld(RNScalar factor, const R3Point& origin, int, int, int dx, int dy);
 
   // Draw functions
@@ -184,6 +189,7 @@ protected:
 
   // Node working set
   R3SurfelNodeSet resident_nodes;
+  R3SurfelPicker picker;
 
   // Viewing properties
   R3Viewer viewer;
@@ -26,6 +26,7 @@ static char *database_name = NULL;
 static char *model_name = NULL;
 static char *output_image_name = NULL;
 static int print_verbose = 0;
+static int journal = 0;
 
 
 // Application variables
@@ -75,6 +76,9 @@ OpenScene(const char *scene_name, const char *database_name)
     return NULL;
   }
 
+  // Append edits to journal rather than rewriting scene file when saving
+  if (journal) scene->SetJournaling(TRUE);
+
   // Open scene files
   if (!scene->OpenFile(scene_name, database_name, "r+", "r+")) {
     delete scene;
@@ -481,6 +485,7 @@ ParseArgs(int argc, char **argv)
   while (argc > 0) {
     if ((*argv)[0] == '-') {
       if (!strcmp(*argv, "-v")) print_verbose = 1;
+      else if (!strcmp(*argv, "-journal")) journal = 1;
       else if (!strcmp(*argv, "-image")) { 
         argc--; argv++; output_image_name = *argv; 
       }
@@ -21,6 +21,7 @@ class PDBChain;
 class PDBModel;
 class PDBFile;
 class PDBBond;
+class PDBPocket;
 
 
 
@@ -61,6 +62,7 @@ extern RNMark PDBmark;
 #include "PDBFile.h"
 #include "PDBBond.h"
 #include "PDBDistance.h"
+#include "PDBPocket.h"
 
 
 
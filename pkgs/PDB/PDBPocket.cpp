@@ -0,0 +1,459 @@
+// Source file for PDBPocket and PDBPocketFinder classes
+
+
+
+// Include files
+
+#include "PDB.h"
+
+
+
+// Pocket functions
+
+PDBPocket::
+PDBPocket(void)
+  : id(-1),
+    rank(-1),
+    nvoxels(0),
+    volume(0),
+    buriedness(0),
+    score(0),
+    centroid(0, 0, 0),
+    bbox(R3null_box),
+    residues()
+{
+}
+
+
+
+PDBPocket::
+~PDBPocket(void)
+{
+}
+
+
+
+// Pocket finder functions
+
+PDBPocketFinder::
+PDBPocketFinder(PDBModel *model)
+  : model(model),
+    grid_spacing(1.0),
+    ndirections(30),
+    max_ray_length(10.0),
+    min_buriedness(0.7),
+    min_volume(20.0),
+    lining_distance(4.0),
+    hetatoms_occupy(FALSE),
+    nthreads(0),
+    occupancy_grid(NULL),
+    buriedness_grid(NULL),
+    pocket_grid(NULL),
+    pockets()
+{
+}
+
+
+
+PDBPocketFinder::
+~PDBPocketFinder(void)
+{
+  // Delete pockets
+  EmptyPockets();
+
+  // Delete grids
+  if (occupancy_grid) delete occupancy_grid;
+  if (buriedness_grid) delete buriedness_grid;
+  if (pocket_grid) delete pocket_grid;
+}
+
+
+
+int PDBPocketFinder::
+FindPockets(void)
+{
+  // Delete previous results
+  EmptyPockets();
+  if (occupancy_grid) { delete occupancy_grid; occupancy_grid = NULL; }
+  if (buriedness_grid) { delete buriedness_grid; buriedness_grid = NULL; }
+  if (pocket_grid) { delete pocket_grid; pocket_grid = NULL; }
+
+  // Check model
+  if (!model) return -1;
+
+  // Compute grids and pockets
+  if (!ComputeOccupancyGrid()) return -1;
+  if (!ComputeBuriednessGrid()) return -1;
+  if (!ExtractPockets()) return -1;
+  if (!FindLiningResidues()) return -1;
+
+  // Return number of pockets
+  return pockets.NEntries();
+}
+
+
+
+int PDBPocketFinder::
+ComputeOccupancyGrid(void)
+{
+  // Check parameters
+  if (grid_spacing <= 0) {
+    fprintf(stderr, "Invalid grid spacing for pocket detection: %g\n", grid_spacing);
+    return 0;
+  }
+
+  // Compute bounding box of atoms that fill the grid
+  R3Box atom_bbox = R3null_box;
+  for (int i = 0; i < model->NAtoms(); i++) {
+    PDBAtom *atom = model->Atom(i);
+    if (!hetatoms_occupy && atom->IsHetAtom()) continue;
+    atom_bbox.Union(atom->BBox());
+  }
+
+  // Check bounding box
+  if (atom_bbox.IsEmpty()) {
+    fprintf(stderr, "Model has no atoms for pocket detection\n");
+    return 0;
+  }
+
+  // Compute grid resolution (padded so that rays leave the grid outside the atoms)
+  int resolution[3];
+  R3Point grid_min = atom_bbox.Min() - 2 * grid_spacing * R3ones_vector;
+  for (int dim = 0; dim < 3; dim++) {
+    RNLength length = atom_bbox.AxisLength(dim) + 4 * grid_spacing;
+    resolution[dim] = (int) ceil(length / grid_spacing) + 1;
+  }
+
+  // Check grid size
+  if ((RNScalar) resolution[0] * resolution[1] * resolution[2] > 512.0 * 512.0 * 512.0) {
+    fprintf(stderr, "Grid for pocket detection is too large: %d %d %d\n", resolution[0], resolution[1], resolution[2]);
+    return 0;
+  }
+
+  // Allocate grid with spacing exactly the same along every axis
+  R3Point grid_max = grid_min + grid_spacing * R3Vector(resolution[0]-1, resolution[1]-1, resolution[2]-1);
+  occupancy_grid = new R3Grid(resolution[0], resolution[1], resolution[2], R3Box(grid_min, grid_max));
+  if (!occupancy_grid) {
+    fprintf(stderr, "Unable to allocate occupancy grid\n");
+    return 0;
+  }
+
+  // Rasterize atoms
+  for (int i = 0; i < model->NAtoms(); i++) {
+    PDBAtom *atom = model->Atom(i);
+    if (!hetatoms_occupy && atom->IsHetAtom()) continue;
+    occupancy_grid->RasterizeWorldSphere(atom->Position(), atom->Radius(), 1.0, TRUE, R3_GRID_REPLACE_OPERATION);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+struct PDBPocketBuriednessData {
+  PDBPocketFinder *finder;
+  const int *ray_steps;
+  const int *ray_nsteps;
+  int max_nsteps;
+};
+
+
+
+static void
+PDBComputeBuriednessCallback(int iz, int thread_index, void *data)
+{
+  // Compute buriedness of one slice of the grid
+  PDBPocketBuriednessData *buriedness_data = (PDBPocketBuriednessData *) data;
+  buriedness_data->finder->ComputeBuriedness(iz, buriedness_data->ray_steps,
+    buriedness_data->ray_nsteps, buriedness_data->max_nsteps);
+}
+
+
+
+int PDBPocketFinder::
+ComputeBuriednessGrid(void)
+{
+  // Check occupancy grid
+  if (!occupancy_grid) return 0;
+
+  // Allocate buriedness grid
+  buriedness_grid = new R3Grid(*occupancy_grid);
+  if (!buriedness_grid) {
+    fprintf(stderr, "Unable to allocate buriedness grid\n");
+    return 0;
+  }
+
+  // Clear buriedness grid
+  buriedness_grid->Clear(0);
+
+  // Compute number of one-voxel steps along every ray
+  int max_nsteps = (int) (max_ray_length * occupancy_grid->WorldToGridScaleFactor() + 0.5);
+  if (max_nsteps < 1) max_nsteps = 1;
+
+  // Compute voxel offsets of steps along rays in evenly spread directions (Fibonacci sphere),
+  // skipping steps that land in the same voxel as the previous one
+  int *ray_steps = new int [ 3 * ndirections * max_nsteps ];
+  int *ray_nsteps = new int [ ndirections ];
+  for (int k = 0; k < ndirections; k++) {
+    RNScalar z = 1.0 - (2.0 * k + 1.0) / ndirections;
+    RNScalar r = sqrt(1.0 - z * z);
+    RNScalar phi = k * RN_PI * (3.0 - sqrt(5.0));
+    R3Vector direction(r * cos(phi), r * sin(phi), z);
+    int *steps = &ray_steps[3 * k * max_nsteps];
+    int nsteps = 0;
+    for (int s = 1; s <= max_nsteps; s++) {
+      int dx = (int) floor(s * direction.X() + 0.5);
+      int dy = (int) floor(s * direction.Y() + 0.5);
+      int dz = (int) floor(s * direction.Z() + 0.5);
+      if ((nsteps > 0) && (dx == steps[3*(nsteps-1)+0]) && (dy == steps[3*(nsteps-1)+1]) && (dz == steps[3*(nsteps-1)+2])) continue;
+      steps[3*nsteps+0] = dx;
+      steps[3*nsteps+1] = dy;
+      steps[3*nsteps+2] = dz;
+      nsteps++;
+    }
+    ray_nsteps[k] = nsteps;
+  }
+
+  // Compute buriedness of every empty voxel in parallel over slices
+  PDBPocketBuriednessData data;
+  data.finder = this;
+  data.ray_steps = ray_steps;
+  data.ray_nsteps = ray_nsteps;
+  data.max_nsteps = max_nsteps;
+  RNParallelFor(occupancy_grid->ZResolution(), PDBComputeBuriednessCallback, &data, nthreads);
+
+  // Delete ray steps
+  delete [] ray_steps;
+  delete [] ray_nsteps;
+
+  // Return success
+  return 1;
+}
+
+
+
+void PDBPocketFinder::
+ComputeBuriedness(int iz, const int *ray_steps, const int *ray_nsteps, int max_nsteps)
+{
+  // Get grid info
+  int xres = occupancy_grid->XResolution();
+  int yres = occupancy_grid->YResolution();
+  int zres = occupancy_grid->ZResolution();
+  int row_size = xres;
+  int sheet_size = xres * yres;
+  const RNScalar *occupancy = occupancy_grid->GridValues();
+  RNScalar *buriedness = (RNScalar *) buriedness_grid->GridValues();
+
+  // Compute number of misses after which a voxel cannot reach the minimum buriedness
+  int min_hits = (int) ceil(min_buriedness * ndirections - RN_EPSILON);
+  if (min_hits < 0) min_hits = 0;
+  int max_misses = ndirections - min_hits;
+
+  // Visit every voxel in slice
+  for (int iy = 0; iy < yres; iy++) {
+    for (int ix = 0; ix < xres; ix++) {
+      int index = iz * sheet_size + iy * row_size + ix;
+      if (occupancy[index] > 0.5) continue;
+
+      // Cast rays until they hit an atom or leave the grid
+      int nhits = 0, nmisses = 0;
+      for (int k = 0; k < ndirections; k++) {
+        const int *steps = &ray_steps[3 * k * max_nsteps];
+        RNBoolean hit = FALSE;
+        for (int s = 0; s < ray_nsteps[k]; s++) {
+          int x = ix + steps[3*s+0];
+          int y = iy + steps[3*s+1];
+          int z = iz + steps[3*s+2];
+          if ((x < 0) || (x >= xres) || (y < 0) || (y >= yres) || (z < 0) || (z >= zres)) break;
+          if (occupancy[z * sheet_size + y * row_size + x] > 0.5) { hit = TRUE; break; }
+        }
+
+        // Update counts, stopping early once the voxel cannot be a pocket voxel
+        if (hit) nhits++;
+        else if (++nmisses > max_misses) break;
+      }
+
+      // Set buriedness
+      buriedness[index] = (RNScalar) nhits / ndirections;
+    }
+  }
+}
+
+
+
+static int
+PDBComparePockets(const void *data1, const void *data2)
+{
+  PDBPocket *pocket1 = *((PDBPocket **) data1);
+  PDBPocket *pocket2 = *((PDBPocket **) data2);
+  if (pocket1->score > pocket2->score) return -1;
+  else if (pocket1->score < pocket2->score) return 1;
+  else if (pocket1->id < pocket2->id) return -1;
+  else if (pocket1->id > pocket2->id) return 1;
+  else return 0;
+}
+
+
+
+int PDBPocketFinder::
+ExtractPockets(void)
+{
+  // Check grids
+  if (!occupancy_grid || !buriedness_grid) return 0;
+
+  // Allocate pocket grid
+  pocket_grid = new R3Grid(*occupancy_grid);
+  if (!pocket_grid) {
+    fprintf(stderr, "Unable to allocate pocket grid\n");
+    return 0;
+  }
+
+  // Mark empty voxels that are buried enough
+  int grid_size = pocket_grid->NEntries();
+  const RNScalar *occupancy = occupancy_grid->GridValues();
+  const RNScalar *buriedness = buriedness_grid->GridValues();
+  RNScalar *values = (RNScalar *) pocket_grid->GridValues();
+  for (int i = 0; i < grid_size; i++) {
+    if (occupancy[i] > 0.5) values[i] = 0;
+    else if (buriedness[i] < min_buriedness) values[i] = 0;
+    else values[i] = 1;
+  }
+
+  // Find connected components of marked voxels
+  int *components = new int [ grid_size ];
+  int ncomponents = pocket_grid->ConnectedComponents(0.5, 0, NULL, NULL, components);
+
+  // Create a pocket for every component
+  RNArray<PDBPocket *> candidates;
+  for (int c = 0; c < ncomponents; c++) {
+    PDBPocket *pocket = new PDBPocket();
+    pocket->id = c;
+    candidates.Insert(pocket);
+  }
+
+  // Accumulate voxel statistics of pockets
+  for (int i = 0; i < grid_size; i++) {
+    if (components[i] < 0) continue;
+    PDBPocket *pocket = candidates.Kth(components[i]);
+    int ix, iy, iz;
+    pocket_grid->IndexToIndices(i, ix, iy, iz);
+    R3Point position = pocket_grid->WorldPosition(ix, iy, iz);
+    pocket->nvoxels++;
+    pocket->buriedness += buriedness[i];
+    pocket->centroid += position.Vector();
+    pocket->bbox.Union(position);
+  }
+
+  // Keep pockets that are large enough
+  RNScalar voxel_size = 1.0 / pocket_grid->WorldToGridScaleFactor();
+  RNVolume voxel_volume = voxel_size * voxel_size * voxel_size;
+  for (int c = 0; c < ncomponents; c++) {
+    PDBPocket *pocket = candidates.Kth(c);
+    pocket->volume = pocket->nvoxels * voxel_volume;
+    if ((pocket->nvoxels == 0) || (pocket->volume < min_volume)) { delete pocket; continue; }
+    pocket->buriedness /= pocket->nvoxels;
+    pocket->centroid /= pocket->nvoxels;
+    pocket->score = pocket->volume * pocket->buriedness;
+    pockets.Insert(pocket);
+  }
+
+  // Rank pockets
+  pockets.Sort(PDBComparePockets);
+  for (int k = 0; k < pockets.NEntries(); k++) {
+    PDBPocket *pocket = pockets.Kth(k);
+    pocket->rank = k;
+  }
+
+  // Fill pocket grid with ranks
+  int *component_ranks = new int [ ncomponents + 1 ];
+  for (int c = 0; c < ncomponents; c++) component_ranks[c] = -1;
+  for (int k = 0; k < pockets.NEntries(); k++) component_ranks[pockets[k]->id] = k;
+  for (int i = 0; i < grid_size; i++) {
+    int rank = (components[i] >= 0) ? component_ranks[components[i]] : -1;
+    values[i] = rank + 1;
+  }
+
+  // Delete temporary memory
+  delete [] component_ranks;
+  delete [] components;
+
+  // Return success
+  return 1;
+}
+
+
+
+int PDBPocketFinder::
+FindLiningResidues(void)
+{
+  // Check pocket grid
+  if (!pocket_grid) return 0;
+  if (pockets.NEntries() == 0) return 1;
+
+  // Get grid info
+  int xres = pocket_grid->XResolution();
+  int yres = pocket_grid->YResolution();
+  int zres = pocket_grid->ZResolution();
+  RNScalar scale = pocket_grid->WorldToGridScaleFactor();
+
+  // Remember last residue inserted into every pocket
+  PDBResidue **last_residues = new PDBResidue * [ pockets.NEntries() ];
+  for (int k = 0; k < pockets.NEntries(); k++) last_residues[k] = NULL;
+
+  // Visit every atom of every residue
+  for (int i = 0; i < model->NResidues(); i++) {
+    PDBResidue *residue = model->Residue(i);
+    for (int j = 0; j < residue->NAtoms(); j++) {
+      PDBAtom *atom = residue->Atom(j);
+      if (!hetatoms_occupy && atom->IsHetAtom()) continue;
+
+      // Compute range of voxels within lining distance of atom surface
+      R3Point center = pocket_grid->GridPosition(atom->Position());
+      RNScalar radius = (atom->Radius() + lining_distance) * scale;
+      RNScalar radius_squared = radius * radius;
+      int x1 = (int) ceil(center.X() - radius); if (x1 < 0) x1 = 0;
+      int y1 = (int) ceil(center.Y() - radius); if (y1 < 0) y1 = 0;
+      int z1 = (int) ceil(center.Z() - radius); if (z1 < 0) z1 = 0;
+      int x2 = (int) floor(center.X() + radius); if (x2 >= xres) x2 = xres-1;
+      int y2 = (int) floor(center.Y() + radius); if (y2 >= yres) y2 = yres-1;
+      int z2 = (int) floor(center.Z() + radius); if (z2 >= zres) z2 = zres-1;
+
+      // Insert residue into pockets with voxels in range
+      for (int iz = z1; iz <= z2; iz++) {
+        RNScalar dz = iz - center.Z();
+        for (int iy = y1; iy <= y2; iy++) {
+          RNScalar dy = iy - center.Y();
+          for (int ix = x1; ix <= x2; ix++) {
+            RNScalar dx = ix - center.X();
+            if (dx*dx + dy*dy + dz*dz > radius_squared) continue;
+            int rank = (int) (pocket_grid->GridValue(ix, iy, iz) + 0.5) - 1;
+            if (rank < 0) continue;
+            if (last_residues[rank] == residue) continue;
+            pockets[rank]->residues.Insert(residue);
+            last_residues[rank] = residue;
+          }
+        }
+      }
+    }
+  }
+
+  // Delete temporary memory
+  delete [] last_residues;
+
+  // Return success
+  return 1;
+}
+
+
+
+void PDBPocketFinder::
+EmptyPockets(void)
+{
+  // Delete pockets
+  for (int k = 0; k < pockets.NEntries(); k++) delete pockets[k];
+  pockets.Empty();
+}
+
+
+
@@ -0,0 +1,424 @@
+// Include file for PDBPocket and PDBPocketFinder classes
+
+
+
+// Pocket class declaration
+
+class PDBPocket {
+public:
+  // Constructor
+  PDBPocket(void);
+  ~PDBPocket(void);
+
+  // Properties
+  int ID(void) const;
+  int Rank(void) const;
+  int NVoxels(void) const;
+  RNVolume Volume(void) const;
+  RNScalar Buriedness(void) const;
+  RNScalar Score(void) const;
+  const R3Point& Centroid(void) const;
+  const R3Box& BBox(void) const;
+
+  // Residue access functions
+  int NResidues(void) const;
+  PDBResidue *Residue(int k) const;
+  const RNArray<PDBResidue *>& Residues(void) const;
+
+public:
+  // Data fields
+  int id;
+  int rank;
+  int nvoxels;
+  RNVolume volume;
+  RNScalar buriedness;
+  RNScalar score;
+  R3Point centroid;
+  R3Box bbox;
+  RNArray<PDBResidue *> residues;
+};
+
+
+
+// Pocket finder class declaration
+
+class PDBPocketFinder {
+public:
+  // Constructor
+  PDBPocketFinder(PDBModel *model);
+  ~PDBPocketFinder(void);
+
+  // Properties
+  PDBModel *Model(void) const;
+
+  // Parameter access functions
+  RNLength GridSpacing(void) const;
+  int NDirections(void) const;
+  RNLength MaxRayLength(void) const;
+  RNScalar MinBuriedness(void) const;
+  RNVolume MinVolume(void) const;
+  RNLength LiningDistance(void) const;
+  RNBoolean HetAtomsOccupy(void) const;
+  int NThreads(void) const;
+
+  // Parameter manipulation functions
+  void SetGridSpacing(RNLength spacing);
+  void SetNDirections(int ndirections);
+    // Rays are cast in this many fixed, evenly spread directions from every empty voxel
+  void SetMaxRayLength(RNLength length);
+    // Rays that travel this far without hitting an atom escape
+  void SetMinBuriedness(RNScalar fraction);
+    // Empty voxels whose rays hit atoms in at least this fraction of directions are pocket voxels
+  void SetMinVolume(RNVolume volume);
+  void SetLiningDistance(RNLength distance);
+    // Residues with an atom surface within this distance of a pocket voxel line the pocket
+  void SetHetAtomsOccupy(RNBoolean occupy);
+    // Whether ligands, waters, and other hetero atoms fill the grid (FALSE finds pockets where ligands sit)
+  void SetNThreads(int nthreads);
+
+  // Pocket detection functions
+  int FindPockets(void);
+    // Computes the grids and pockets ranked by decreasing score (volume times mean buriedness),
+    // returns number of pockets or -1 on failure
+
+  // Result access functions
+  int NPockets(void) const;
+  PDBPocket *Pocket(int k) const;
+  const R3Grid *OccupancyGrid(void) const;
+  const R3Grid *BuriednessGrid(void) const;
+    // Buriedness of voxels that cannot reach the minimum is a lower bound (their rays stop early)
+  const R3Grid *PocketGrid(void) const;
+    // Entries are pocket ranks plus one (0 outside pockets)
+
+public:
+  // Internal functions
+  int ComputeOccupancyGrid(void);
+  int ComputeBuriednessGrid(void);
+  int ExtractPockets(void);
+  int FindLiningResidues(void);
+  void ComputeBuriedness(int iz, const int *ray_steps, const int *ray_nsteps, int max_nsteps);
+  void EmptyPockets(void);
+
+private:
+  // Model
+  PDBModel *model;
+
+  // Parameters
+  RNLength grid_spacing;
+  int ndirections;
+  RNLength max_ray_length;
+  RNScalar min_buriedness;
+  RNVolume min_volume;
+  RNLength lining_distance;
+  RNBoolean hetatoms_occupy;
+  int nthreads;
+
+  // Results
+  R3Grid *occupancy_grid;
+  R3Grid *buriedness_grid;
+  R3Grid *pocket_grid;
+  RNArray<PDBPocket *> pockets;
+};
+
+
+
+// Inline functions
+
+inline int PDBPocket::
+ID(void) const
+{
+  // Return connected component index of pocket
+  return id;
+}
+
+
+
+inline int PDBPocket::
+Rank(void) const
+{
+  // Return rank of pocket (0 is best)
+  return rank;
+}
+
+
+
+inline int PDBPocket::
+NVoxels(void) const
+{
+  // Return number of grid voxels in pocket
+  return nvoxels;
+}
+
+
+
+inline RNVolume PDBPocket::
+Volume(void) const
+{
+  // Return volume of pocket
+  return volume;
+}
+
+
+
+inline RNScalar PDBPocket::
+Buriedness(void) const
+{
+  // Return mean buriedness of pocket voxels
+  return buriedness;
+}
+
+
+
+inline RNScalar PDBPocket::
+Score(void) const
+{
+  // Return ranking score
+  return score;
+}
+
+
+
+inline const R3Point& PDBPocket::
+Centroid(void) const
+{
+  // Return centroid of pocket voxels
+  return centroid;
+}
+
+
+
+inline const R3Box& PDBPocket::
+BBox(void) const
+{
+  // Return bounding box of pocket voxels
+  return bbox;
+}
+
+
+
+inline int PDBPocket::
+NResidues(void) const
+{
+  // Return number of lining residues
+  return residues.NEntries();
+}
+
+
+
+inline PDBResidue *PDBPocket::
+Residue(int k) const
+{
+  // Return kth lining residue
+  return residues.Kth(k);
+}
+
+
+
+inline const RNArray<PDBResidue *>& PDBPocket::
+Residues(void) const
+{
+  // Return lining residues
+  return residues;
+}
+
+
+
+inline PDBModel *PDBPocketFinder::
+Model(void) const
+{
+  // Return model
+  return model;
+}
+
+
+
+inline RNLength PDBPocketFinder::
+GridSpacing(void) const
+{
+  // Return spacing of grid voxels
+  return grid_spacing;
+}
+
+
+
+inline int PDBPocketFinder::
+NDirections(void) const
+{
+  // Return number of ray directions
+  return ndirections;
+}
+
+
+
+inline RNLength PDBPocketFinder::
+MaxRayLength(void) const
+{
+  // Return maximum length of rays
+  return max_ray_length;
+}
+
+
+
+inline RNScalar PDBPocketFinder::
+MinBuriedness(void) const
+{
+  // Return minimum buriedness of pocket voxels
+  return min_buriedness;
+}
+
+
+
+inline RNVolume PDBPocketFinder::
+MinVolume(void) const
+{
+  // Return minimum volume of pockets
+  return min_volume;
+}
+
+
+
+inline RNLength PDBPocketFinder::
+LiningDistance(void) const
+{
+  // Return distance of lining residues
+  return lining_distance;
+}
+
+
+
+inline RNBoolean PDBPocketFinder::
+HetAtomsOccupy(void) const
+{
+  // Return whether hetero atoms fill the grid
+  return hetatoms_occupy;
+}
+
+
+
+inline int PDBPocketFinder::
+NThreads(void) const
+{
+  // Return number of threads (0 means one per processor)
+  return nthreads;
+}
+
+
+
+inline void PDBPocketFinder::
+SetGridSpacing(RNLength spacing)
+{
+  // Set spacing of grid voxels
+  this->grid_spacing = spacing;
+}
+
+
+
+inline void PDBPocketFinder::
+SetNDirections(int ndirections)
+{
+  // Set number of ray directions
+  if (ndirections < 1) ndirections = 1;
+  this->ndirections = ndirections;
+}
+
+
+
+inline void PDBPocketFinder::
+SetMaxRayLength(RNLength length)
+{
+  // Set maximum length of rays
+  this->max_ray_length = length;
+}
+
+
+
+inline void PDBPocketFinder::
+SetMinBuriedness(RNScalar fraction)
+{
+  // Set minimum buriedness of pocket voxels
+  this->min_buriedness = fraction;
+}
+
+
+
+inline void PDBPocketFinder::
+SetMinVolume(RNVolume volume)
+{
+  // Set minimum volume of pockets
+  this->min_volume = volume;
+}
+
+
+
+inline void PDBPocketFinder::
+SetLiningDistance(RNLength distance)
+{
+  // Set distance of lining residues
+  this->lining_distance = distance;
+}
+
+
+
+inline void PDBPocketFinder::
+SetHetAtomsOccupy(RNBoolean occupy)
+{
+  // Set whether hetero atoms fill the grid
+  this->hetatoms_occupy = occupy;
+}
+
+
+
+inline void PDBPocketFinder::
+SetNThreads(int nthreads)
+{
+  // Set number of threads (0 means one per processor)
+  this->nthreads = nthreads;
+}
+
+
+
+inline int PDBPocketFinder::
+NPockets(void) const
+{
+  // Return number of pockets
+  return pockets.NEntries();
+}
+
+
+
+inline PDBPocket *PDBPocketFinder::
+Pocket(int k) const
+{
+  // Return kth pocket (in order of rank)
+  return pockets.Kth(k);
+}
+
+
+
+inline const R3Grid *PDBPocketFinder::
+OccupancyGrid(void) const
+{
+  // Return grid with positive values inside atoms
+  return occupancy_grid;
+}
+
+
+
+inline const R3Grid *PDBPocketFinder::
+BuriednessGrid(void) const
+{
+  // Return grid with fraction of rays that hit atoms from every empty voxel
+  return buriedness_grid;
+}
+
+
+
+inline const R3Grid *PDBPocketFinder::
+PocketGrid(void) const
+{
+  // Return grid with pocket ranks
+  return pocket_grid;
+}
+
+
+
@@ -2518,6 +2518,277 @@ RasterizeWorldPolygon(const R2Polygon& polygon, RNScalar value, int operation)
 
 
 
+// Used by RasterizeGridPolygons
+struct ScanLineEdge { RNCoord x1, y1, x2, y2; int direction; int polygon; };
+
+
+
+// Used by RasterizeGridPolygons
+static int CompareScanLineEdgeYMins(const void *data1, const void *data2)
+{
+  ScanLineEdge *edge1 = (ScanLineEdge *) data1;
+  ScanLineEdge *edge2 = (ScanLineEdge *) data2;
+  if (edge1->y1 < edge2->y1) return -1;
+  else if (edge1->y1 > edge2->y1) return 1;
+  else return 0;
+}
+
+
+
+// Used by RasterizeGridPolygons
+static int CompareScanLineEdgePolygons(const void *data1, const void *data2)
+{
+  ScanLineEdge *edge1 = *((ScanLineEdge **) data1);
+  ScanLineEdge *edge2 = *((ScanLineEdge **) data2);
+  if (edge1->polygon < edge2->polygon) return -1;
+  else if (edge1->polygon > edge2->polygon) return 1;
+  else return 0;
+}
+
+
+
+// Used by RasterizeGridPolygons
+static int CompareScanLineWindingCrossings(const void *data1, const void *data2)
+{
+  ScanLineCrossing *crossing1 = (ScanLineCrossing *) data1;
+  ScanLineCrossing *crossing2 = (ScanLineCrossing *) data2;
+  if (crossing1->x < crossing2->x) return -1;
+  else if (crossing1->x > crossing2->x) return 1;
+  else return 0;
+}
+
+
+
+// Used by RasterizeGridPolygons
+static void AccumulateScanLineCoverage(RNScalar *area, int width,
+  RNCoord x1, RNCoord y1, RNCoord x2, RNCoord y2, int direction)
+{
+  // Split segment where it crosses left or right side of grid
+  RNCoord xs[4] = { x1, 0, 0, x2 };
+  RNCoord ys[4] = { y1, 0, 0, y2 };
+  int n = 1;
+  RNCoord bounds[2] = { 0, (RNCoord) width };
+  if (x2 < x1) { bounds[0] = width; bounds[1] = 0; }
+  for (int k = 0; k < 2; k++) {
+    if (((x1 - bounds[k]) * (x2 - bounds[k])) >= 0) continue;
+    RNScalar t = (bounds[k] - x1) / (x2 - x1);
+    xs[n] = bounds[k];
+    ys[n] = y1 + t * (y2 - y1);
+    n++;
+  }
+  xs[n] = x2;
+  ys[n] = y2;
+
+  // Accumulate signed area of every piece (clamped into grid) into cells it crosses
+  for (int k = 0; k < n; k++) {
+    RNScalar d = direction * (ys[k+1] - ys[k]);
+    if (d == 0) continue;
+    RNCoord xa = xs[k], xb = xs[k+1];
+    if (xa < 0) xa = 0; else if (xa > width) xa = width;
+    if (xb < 0) xb = 0; else if (xb > width) xb = width;
+    if (xb < xa) { RNCoord swap = xa; xa = xb; xb = swap; }
+    int ia = (int) floor(xa);
+    int ib = (int) ceil(xb);
+    if (ib <= ia + 1) {
+      // Piece within one cell
+      RNScalar fraction = 0.5 * (xa + xb) - ia;
+      area[ia] += d * (1 - fraction);
+      area[ia+1] += d * fraction;
+    }
+    else {
+      // Piece across several cells
+      RNScalar s = 1.0 / (xb - xa);
+      RNScalar fa = xa - ia;
+      RNScalar a0 = 0.5 * s * (1 - fa) * (1 - fa);
+      RNScalar fb = xb - ib + 1;
+      RNScalar am = 0.5 * s * fb * fb;
+      area[ia] += d * a0;
+      if (ib == ia + 2) {
+        area[ia+1] += d * (1 - a0 - am);
+      }
+      else {
+        RNScalar a1 = s * (1.5 - fa);
+        area[ia+1] += d * (a1 - a0);
+        for (int i = ia + 2; i < ib - 1; i++) area[i] += d * s;
+        RNScalar a2 = a1 + (ib - ia - 3) * s;
+        area[ib-1] += d * (1 - a2 - am);
+      }
+      area[ib] += d * am;
+    }
+  }
+}
+
+
+
+void R2Grid::
+RasterizeGridPolygons(const RNArray<R2PolygonSet *>& polygons, const RNScalar *values, int operation, RNBoolean antialias)
+{
+  // Count edges
+  int max_edges = 0;
+  for (int k = 0; k < polygons.NEntries(); k++) {
+    max_edges += polygons[k]->NPoints();
+  }
+
+  // Create non-horizontal edges in coordinates with cell corners at integers (cell centers are at grid points)
+  ScanLineEdge *edges = new ScanLineEdge [ max_edges + 1 ];
+  int nedges = 0;
+  R2Box grid_box(-0.5, -0.5, grid_resolution[0] - 0.5, grid_resolution[1] - 0.5);
+  for (int k = 0; k < polygons.NEntries(); k++) {
+    R2PolygonSet *polygon = polygons[k];
+    if (!R2Intersects(grid_box, polygon->BBox())) continue;
+    for (int c = 0; c < polygon->NContours(); c++) {
+      const R2Polygon *contour = polygon->Contour(c);
+      int npoints = contour->NPoints();
+      for (int i = 0; i < npoints; i++) {
+        const R2Point& p1 = contour->Point(i);
+        const R2Point& p2 = contour->Point((i+1) % npoints);
+        if (p1.Y() == p2.Y()) continue;
+        ScanLineEdge *edge = &edges[nedges++];
+        edge->direction = (p2.Y() > p1.Y()) ? 1 : -1;
+        edge->x1 = (edge->direction > 0) ? p1.X() + 0.5 : p2.X() + 0.5;
+        edge->y1 = (edge->direction > 0) ? p1.Y() + 0.5 : p2.Y() + 0.5;
+        edge->x2 = (edge->direction > 0) ? p2.X() + 0.5 : p1.X() + 0.5;
+        edge->y2 = (edge->direction > 0) ? p2.Y() + 0.5 : p1.Y() + 0.5;
+        edge->polygon = k;
+      }
+    }
+  }
+
+  // Sort edges by minimum y
+  qsort(edges, nedges, sizeof(ScanLineEdge), CompareScanLineEdgeYMins);
+
+  // Allocate active edges, crossings, and coverage accumulation buffer
+  ScanLineEdge **active = new ScanLineEdge * [ nedges + 1 ];
+  ScanLineCrossing *crossings = new ScanLineCrossing [ nedges + 1 ];
+  RNScalar *area = new RNScalar [ grid_resolution[0] + 2 ];
+  for (int ix = 0; ix < grid_resolution[0] + 2; ix++) area[ix] = 0;
+  int nactive = 0, next_edge = 0;
+
+  // Rasterize scan lines
+  for (int iy = 0; iy < grid_resolution[1]; iy++) {
+    // Update active edges (overlapping row from iy to iy+1)
+    int nkept = 0;
+    for (int i = 0; i < nactive; i++) {
+      if (active[i]->y2 > iy) active[nkept++] = active[i];
+    }
+    nactive = nkept;
+    while ((next_edge < nedges) && (edges[next_edge].y1 < iy + 1)) {
+      if (edges[next_edge].y2 > iy) active[nactive++] = &edges[next_edge];
+      next_edge++;
+    }
+    if (nactive == 0) {
+      if (next_edge == nedges) break;
+      continue;
+    }
+
+    // Group active edges by polygon
+    qsort(active, nactive, sizeof(ScanLineEdge *), CompareScanLineEdgePolygons);
+
+    // Rasterize every polygon
+    int group_start = 0;
+    while (group_start < nactive) {
+      int k = active[group_start]->polygon;
+      int group_end = group_start + 1;
+      while ((group_end < nactive) && (active[group_end]->polygon == k)) group_end++;
+      RNScalar value = (values) ? values[k] : k + 1;
+
+      if (antialias) {
+        // Accumulate signed area of edges within row
+        int ixmin = grid_resolution[0], ixmax = 0;
+        for (int i = group_start; i < group_end; i++) {
+          ScanLineEdge *edge = active[i];
+          RNCoord ya = (edge->y1 > iy) ? edge->y1 : iy;
+          RNCoord yb = (edge->y2 < iy + 1) ? edge->y2 : iy + 1;
+          if (yb <= ya) continue;
+          RNScalar slope = (edge->x2 - edge->x1) / (edge->y2 - edge->y1);
+          RNCoord xa = edge->x1 + (ya - edge->y1) * slope;
+          RNCoord xb = edge->x1 + (yb - edge->y1) * slope;
+          AccumulateScanLineCoverage(area, grid_resolution[0], xa, ya, xb, yb, edge->direction);
+          RNCoord xmin = (xa < xb) ? xa : xb;
+          RNCoord xmax = (xa > xb) ? xa : xb;
+          int ix1 = (xmin <= 0) ? 0 : ((xmin >= grid_resolution[0]) ? grid_resolution[0] : (int) xmin);
+          int ix2 = (xmax <= 0) ? 0 : ((xmax >= grid_resolution[0]) ? grid_resolution[0] : (int) xmax);
+          if (ix1 < ixmin) ixmin = ix1;
+          if (ix2 > ixmax) ixmax = ix2;
+        }
+
+        // Fill cells with coverage from running sum of areas (it returns to zero after the last edge)
+        RNScalar sum = 0;
+        for (int ix = ixmin; ix < grid_resolution[0] + 2; ix++) {
+          sum += area[ix];
+          area[ix] = 0;
+          if (ix < grid_resolution[0]) {
+            RNScalar coverage = fabs(sum);
+            if (coverage > 1) coverage = 1;
+            if (coverage > 1E-9) RasterizeGridValue(ix, iy, coverage * value, operation);
+          }
+          if ((ix > ixmax + 1) && (fabs(sum) < 1E-9)) break;
+        }
+      }
+      else {
+        // Find crossings of edges with scan line through cell centers
+        RNCoord y = iy + 0.5;
+        int ncrossings = 0;
+        for (int i = group_start; i < group_end; i++) {
+          ScanLineEdge *edge = active[i];
+          if ((y < edge->y1) || (y >= edge->y2)) continue;
+          crossings[ncrossings].x = edge->x1 + (y - edge->y1) * (edge->x2 - edge->x1) / (edge->y2 - edge->y1);
+          crossings[ncrossings].side = edge->direction;
+          ncrossings++;
+        }
+
+        // Fill cells with centers where winding number is not zero
+        qsort(crossings, ncrossings, sizeof(ScanLineCrossing), CompareScanLineWindingCrossings);
+        int winding = 0;
+        for (int i = 0; i < ncrossings - 1; i++) {
+          winding += crossings[i].side;
+          if (winding == 0) continue;
+          int ix1 = (int) ceil(crossings[i].x - 0.5);
+          int ix2 = (int) ceil(crossings[i+1].x - 0.5) - 1;
+          if (ix1 < 0) ix1 = 0;
+          if (ix2 > grid_resolution[0] - 1) ix2 = grid_resolution[0] - 1;
+          for (int ix = ix1; ix <= ix2; ix++) {
+            RasterizeGridValue(ix, iy, value, operation);
+          }
+        }
+      }
+
+      // Advance to next polygon
+      group_start = group_end;
+    }
+  }
+
+  // Delete temporary memory
+  delete [] area;
+  delete [] crossings;
+  delete [] active;
+  delete [] edges;
+}
+
+
+
+void R2Grid::
+RasterizeWorldPolygons(const RNArray<R2PolygonSet *>& polygons, const RNScalar *values, int operation, RNBoolean antialias)
+{
+  // Transform polygons into grid coordinates
+  RNArray<R2PolygonSet *> transformed_polygons;
+  for (int k = 0; k < polygons.NEntries(); k++) {
+    R2PolygonSet *transformed_polygon = new R2PolygonSet(*(polygons[k]));
+    transformed_polygon->Transform(WorldToGridTransformation());
+    transformed_polygons.Insert(transformed_polygon);
+  }
+
+  // Rasterize polygons in grid coordinates
+  RasterizeGridPolygons(transformed_polygons, values, operation, antialias);
+
+  // Delete transformed polygons
+  for (int k = 0; k < transformed_polygons.NEntries(); k++) {
+    delete transformed_polygons[k];
+  }
+}
+
+
+
 RNScalar R2Grid::
 Dot(const R2Grid& grid) const
 {
@@ -3097,6 +3368,310 @@ ConnectedComponents(RNScalar isolevel, int max_components, int *seeds, int *size
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Peak extraction functions
+////////////////////////////////////////////////////////////////////////
+
+static RNBoolean
+IsHigherPeak(const RNScalar *values, int index1, int index2)
+{
+  // Order by decreasing value, breaking ties by increasing index
+  if (values[index1] > values[index2]) return TRUE;
+  if (values[index1] < values[index2]) return FALSE;
+  return (index1 < index2);
+}
+
+
+
+static void
+SiftPeakDown(const RNScalar *values, int *heap, int nentries, int i)
+{
+  // Restore heap order below entry i
+  while (TRUE) {
+    int best = i;
+    int left = 2*i + 1;
+    int right = left + 1;
+    if ((left < nentries) && IsHigherPeak(values, heap[left], heap[best])) best = left;
+    if ((right < nentries) && IsHigherPeak(values, heap[right], heap[best])) best = right;
+    if (best == i) return;
+    int swap = heap[i]; heap[i] = heap[best]; heap[best] = swap;
+    i = best;
+  }
+}
+
+
+
+static RNBoolean
+IsInsideRasterizedCircle(const R2Grid *grid, const R2Point& center, RNLength radius, int i, int j)
+{
+  // Return whether RasterizeGridCircle(center, radius, ...) would touch entry (i, j)
+  int ij[2] = { i, j };
+  int mn[2], mx[2];
+  for (int dim = 0; dim < 2; dim++) {
+    mx[dim]= (int) (center[dim]+radius);
+    if (mx[dim] > grid->Resolution(dim)-1) mx[dim] = grid->Resolution(dim)-1;
+    mn[dim]= (int) (center[dim]-radius);
+    if (mn[dim] < 0) mn[dim] = 0;
+    if ((ij[dim] < mn[dim]) || (ij[dim] > mx[dim])) return FALSE;
+  }
+
+  // Check span in y (same arithmetic as the rasterizer)
+  int y1 = (int) (center[1] - radius + 0.5);
+  int y2 = (int) (center[1] + radius + 0.5);
+  if (y1 < mn[1]) y1 = mn[1];
+  if (y2 > mx[1]) y2 = mx[1];
+  if ((j < y1) || (j > y2)) return FALSE;
+
+  // Check span in x
+  RNCoord y = j - center[1];
+  RNLength x_squared = radius * radius - y*y;
+  if (x_squared < 0) return FALSE;
+  RNLength x = sqrt(x_squared);
+  int x1 = (int) (center[0] - x + 0.5);
+  int x2 = (int) (center[0] + x + 0.5);
+  if (x1 < mn[0]) x1 = mn[0];
+  if (x2 > mx[0]) x2 = mx[0];
+  if ((i < x1) || (i > x2)) return FALSE;
+
+  // Entry is inside
+  return TRUE;
+}
+
+
+
+static int
+FindPeakIndices(const R2Grid *grid, int max_peaks, RNLength grid_radius, RNBoolean world_centers,
+  RNScalar min_value, RNBoolean local_maxima_only, int *peak_indices)
+{
+  // Check number of peaks
+  if (max_peaks <= 0) return 0;
+
+  // Gather candidates (entries greater than min_value, optionally without any greater 8-neighbor)
+  const RNScalar *values = grid->GridValues();
+  int xres = grid->XResolution();
+  int yres = grid->YResolution();
+  int *heap = new int [ grid->NEntries() ];
+  int nentries = 0;
+  for (int index = 0; index < grid->NEntries(); index++) {
+    RNScalar value = values[index];
+    if (value <= min_value) continue;
+    if (local_maxima_only) {
+      int i, j;
+      grid->IndexToIndices(index, i, j);
+      for (int s = j-1; s <= j+1; s++) {
+        if ((s < 0) || (s >= yres)) continue;
+        for (int r = i-1; r <= i+1; r++) {
+          if ((r < 0) || (r >= xres)) continue;
+          if (grid->GridValue(r, s) > value) goto notmaximum;
+        }
+      }
+    }
+    heap[nentries++] = index;
+  notmaximum:;
+  }
+
+  // Build max heap over candidates
+  for (int i = nentries/2 - 1; i >= 0; i--) {
+    SiftPeakDown(values, heap, nentries, i);
+  }
+
+  // Allocate spatial hash of accepted peaks (cells are wider than any suppression footprint)
+  int cell_size = (int) grid_radius + 2;
+  int ncells[2] = { xres / cell_size + 1, yres / cell_size + 1 };
+  int table_size = 1;
+  while (table_size < 2 * max_peaks) table_size *= 2;
+  long long *table_cells = NULL;
+  int *table_heads = NULL;
+  int *peak_nexts = NULL;
+  R2Point *peak_centers = NULL;
+  if (grid_radius > 0) {
+    table_cells = new long long [ table_size ];
+    table_heads = new int [ table_size ];
+    peak_nexts = new int [ max_peaks ];
+    peak_centers = new R2Point [ max_peaks ];
+    for (int i = 0; i < table_size; i++) table_cells[i] = -1;
+  }
+
+  // Pop candidates in order, skipping ones inside the footprint of an earlier peak
+  int npeaks = 0;
+  while ((nentries > 0) && (npeaks < max_peaks)) {
+    // Pop highest candidate
+    int index = heap[0];
+    heap[0] = heap[--nentries];
+    SiftPeakDown(values, heap, nentries, 0);
+
+    // Check if no suppression
+    if (grid_radius <= 0) {
+      peak_indices[npeaks++] = index;
+      continue;
+    }
+
+    // Check peaks in neighboring cells
+    int ij[2], cell[2];
+    grid->IndexToIndices(index, ij[0], ij[1]);
+    for (int dim = 0; dim < 2; dim++) cell[dim] = ij[dim] / cell_size;
+    RNBoolean suppressed = FALSE;
+    for (int cy = cell[1]-1; !suppressed && (cy <= cell[1]+1); cy++) {
+      if ((cy < 0) || (cy >= ncells[1])) continue;
+      for (int cx = cell[0]-1; !suppressed && (cx <= cell[0]+1); cx++) {
+        if ((cx < 0) || (cx >= ncells[0])) continue;
+        long long key = (long long) cy * ncells[0] + cx;
+        int slot = (int) (key % table_size);
+        while ((table_cells[slot] >= 0) && (table_cells[slot] != key)) slot = (slot + 1) & (table_size - 1);
+        if (table_cells[slot] < 0) continue;
+        for (int p = table_heads[slot]; p >= 0; p = peak_nexts[p]) {
+          if (IsInsideRasterizedCircle(grid, peak_centers[p], grid_radius, ij[0], ij[1])) {
+            suppressed = TRUE;
+            break;
+          }
+        }
+      }
+    }
+
+    // Check if suppressed
+    if (suppressed) continue;
+
+    // Insert peak into spatial hash
+    long long key = (long long) cell[1] * ncells[0] + cell[0];
+    int slot = (int) (key % table_size);
+    while ((table_cells[slot] >= 0) && (table_cells[slot] != key)) slot = (slot + 1) & (table_size - 1);
+    if (table_cells[slot] < 0) { table_cells[slot] = key; table_heads[slot] = -1; }
+    peak_centers[npeaks] = R2Point(ij[0], ij[1]);
+    if (world_centers) peak_centers[npeaks] = grid->GridPosition(grid->WorldPosition(ij[0], ij[1]));
+    peak_nexts[npeaks] = table_heads[slot];
+    table_heads[slot] = npeaks;
+    peak_indices[npeaks++] = index;
+  }
+
+  // Delete temporary memory
+  if (table_cells) delete [] table_cells;
+  if (table_heads) delete [] table_heads;
+  if (peak_nexts) delete [] peak_nexts;
+  if (peak_centers) delete [] peak_centers;
+  delete [] heap;
+
+  // Return number of peaks
+  return npeaks;
+}
+
+
+
+static R2Point
+RefinedPeakPosition(const R2Grid *grid, int i, int j, RNBoolean subpixel)
+{
+  // Start at grid entry
+  int ij[2] = { i, j };
+  R2Point position(i, j);
+  if (!subpixel) return position;
+
+  // Fit a parabola through the entry and its two neighbors along each axis
+  RNScalar value = grid->GridValue(i, j);
+  for (int dim = 0; dim < 2; dim++) {
+    if ((ij[dim] <= 0) || (ij[dim] >= grid->Resolution(dim)-1)) continue;
+    int lo[2] = { i, j }; lo[dim]--;
+    int hi[2] = { i, j }; hi[dim]++;
+    RNScalar value0 = grid->GridValue(lo[0], lo[1]);
+    RNScalar value1 = grid->GridValue(hi[0], hi[1]);
+    RNScalar curvature = value0 - 2*value + value1;
+    if (curvature >= 0) continue;
+    RNScalar offset = 0.5 * (value0 - value1) / curvature;
+    if (offset < -0.5) offset = -0.5;
+    if (offset > 0.5) offset = 0.5;
+    position[dim] += offset;
+  }
+
+  // Return position
+  return position;
+}
+
+
+
+static R2Vector
+PeakGradientVector(const R2Grid *grid, int i, int j)
+{
+  // Compute gradient with central differences (one-sided at the boundary)
+  int ij[2] = { i, j };
+  R2Vector gradient(0, 0);
+  for (int dim = 0; dim < 2; dim++) {
+    int lo[2] = { i, j };
+    int hi[2] = { i, j };
+    if (ij[dim] > 0) lo[dim]--;
+    if (ij[dim] < grid->Resolution(dim)-1) hi[dim]++;
+    if (hi[dim] == lo[dim]) continue;
+    RNScalar value0 = grid->GridValue(lo[0], lo[1]);
+    RNScalar value1 = grid->GridValue(hi[0], hi[1]);
+    gradient[dim] = (value1 - value0) / (hi[dim] - lo[dim]);
+  }
+
+  // Return gradient
+  return gradient;
+}
+
+
+
+int R2Grid::
+FindGridPeaks(int max_peaks, RNLength grid_min_spacing, R2Point *grid_positions, RNScalar *values, R2Vector *grid_normals,
+  RNScalar min_value, RNBoolean local_maxima_only, RNBoolean subpixel) const
+{
+  // Find peak entries
+  int *peak_indices = new int [ (max_peaks > 0) ? max_peaks : 1 ];
+  int npeaks = FindPeakIndices(this, max_peaks, grid_min_spacing, FALSE, min_value, local_maxima_only, peak_indices);
+
+  // Fill peak info
+  for (int p = 0; p < npeaks; p++) {
+    int i, j;
+    IndexToIndices(peak_indices[p], i, j);
+    if (grid_positions) grid_positions[p] = RefinedPeakPosition(this, i, j, subpixel);
+    if (values) values[p] = grid_values[peak_indices[p]];
+    if (grid_normals) {
+      grid_normals[p] = PeakGradientVector(this, i, j);
+      grid_normals[p].Normalize();
+    }
+  }
+
+  // Delete peak indices
+  delete [] peak_indices;
+
+  // Return number of peaks
+  return npeaks;
+}
+
+
+
+int R2Grid::
+FindWorldPeaks(int max_peaks, RNLength world_min_spacing, R2Point *world_positions, RNScalar *values, R2Vector *world_normals,
+  RNScalar min_value, RNBoolean local_maxima_only, RNBoolean subpixel) const
+{
+  // Find peak entries (suppressing the same entries as RasterizeWorldCircle)
+  int *peak_indices = new int [ (max_peaks > 0) ? max_peaks : 1 ];
+  RNLength grid_radius = world_min_spacing * WorldToGridScaleFactor();
+  int npeaks = FindPeakIndices(this, max_peaks, grid_radius, TRUE, min_value, local_maxima_only, peak_indices);
+
+  // Fill peak info
+  for (int p = 0; p < npeaks; p++) {
+    int i, j;
+    IndexToIndices(peak_indices[p], i, j);
+    if (world_positions) {
+      if (subpixel) world_positions[p] = WorldPosition(RefinedPeakPosition(this, i, j, TRUE));
+      else world_positions[p] = WorldPosition(i, j);
+    }
+    if (values) values[p] = grid_values[peak_indices[p]];
+    if (world_normals) {
+      world_normals[p] = PeakGradientVector(this, i, j);
+      world_normals[p].Transform(GridToWorldTransformation());
+      world_normals[p].Normalize();
+    }
+  }
+
+  // Delete peak indices
+  delete [] peak_indices;
+
+  // Return number of peaks
+  return npeaks;
+}
+
+
+
 #if 0
 
 static int
@@ -149,6 +149,10 @@ public:
   void RasterizeWorldCircle(const R2Point& center, RNLength radius, RNScalar value, int operation = 0);
   void RasterizeGridPolygon(const R2Polygon& polygon, RNScalar value, int operation = 0);
   void RasterizeWorldPolygon(const R2Polygon& polygon, RNScalar value, int operation = 0);
+  void RasterizeGridPolygons(const RNArray<R2PolygonSet *>& polygons, const RNScalar *values = NULL, int operation = 0, RNBoolean antialias = FALSE);
+  void RasterizeWorldPolygons(const RNArray<R2PolygonSet *>& polygons, const RNScalar *values = NULL, int operation = 0, RNBoolean antialias = FALSE);
+    // Fills all polygons in one scanline pass with their values (or index plus one if values is NULL),
+    // cells are filled if their centers are inside or, when antialiasing, with values scaled by the covered fraction
 
   // Relationship functions
   RNScalar Dot(const R2Grid& grid) const;
@@ -201,6 +205,16 @@ public:
   int ConnectedComponents(RNScalar isolevel = 0, int max_components = 0, int *seeds = NULL, int *sizes = NULL, int *grid_components = NULL);
   int GenerateIsoContour(RNScalar isolevel, R2Point *points, int max_points) const;
 
+  // Peak extraction functions
+  int FindGridPeaks(int max_peaks, RNLength grid_min_spacing, R2Point *grid_positions, RNScalar *values = NULL, R2Vector *grid_normals = NULL,
+    RNScalar min_value = 0, RNBoolean local_maxima_only = FALSE, RNBoolean subpixel = FALSE) const;
+  int FindWorldPeaks(int max_peaks, RNLength world_min_spacing, R2Point *world_positions, RNScalar *values = NULL, R2Vector *world_normals = NULL,
+    RNScalar min_value = 0, RNBoolean local_maxima_only = FALSE, RNBoolean subpixel = FALSE) const;
+    // Greedily picks entries greater than min_value in order of decreasing value (ties in index order),
+    // skipping entries within the RasterizeCircle footprint of min_spacing around an earlier peak,
+    // optionally refines positions with parabolic fits and computes normalized gradients as normals,
+    // and returns the number of peaks found (at most max_peaks)
+
   // Debugging functions
   const RNScalar *GridValues(void) const;
   void IndicesToIndex(int i, int j, int& index) const;
@@ -0,0 +1,1157 @@
+// Source file for the R2 polygon set class
+
+
+
+// Include files
+
+#include "R2Shapes/R2Shapes.h"
+
+
+
+// Constructors/destructors
+
+R2PolygonSet::
+R2PolygonSet(void)
+  : contours(),
+    bbox(R2null_box)
+{
+}
+
+
+
+R2PolygonSet::
+R2PolygonSet(const R2PolygonSet& set)
+  : contours(),
+    bbox(set.bbox)
+{
+  // Copy contours
+  for (int i = 0; i < set.contours.NEntries(); i++) {
+    contours.Insert(new R2Polygon(*(set.contours[i])));
+  }
+}
+
+
+
+R2PolygonSet::
+R2PolygonSet(const R2Polygon& polygon)
+  : contours(),
+    bbox(R2null_box)
+{
+  // Insert polygon as outer boundary
+  InsertPolygon(polygon);
+}
+
+
+
+R2PolygonSet::
+~R2PolygonSet(void)
+{
+  // Delete contours
+  Empty();
+}
+
+
+
+// Property functions
+
+int R2PolygonSet::
+NPoints(void) const
+{
+  // Return total number of points of all contours
+  int npoints = 0;
+  for (int i = 0; i < contours.NEntries(); i++) {
+    npoints += contours[i]->NPoints();
+  }
+  return npoints;
+}
+
+
+
+RNArea R2PolygonSet::
+Area(void) const
+{
+  // Sum signed areas of contours (holes are negative)
+  RNArea area = 0;
+  for (int i = 0; i < contours.NEntries(); i++) {
+    area += contours[i]->Area();
+  }
+  return area;
+}
+
+
+
+RNLength R2PolygonSet::
+Perimeter(void) const
+{
+  // Sum perimeters of contours
+  RNLength perimeter = 0;
+  for (int i = 0; i < contours.NEntries(); i++) {
+    perimeter += contours[i]->Perimeter();
+  }
+  return perimeter;
+}
+
+
+
+int R2PolygonSet::
+WindingNumber(const R2Point& point) const
+{
+  // Check bounding box
+  if (!R2Contains(bbox, point)) return 0;
+
+  // Count signed crossings of ray in positive x direction
+  int winding = 0;
+  for (int i = 0; i < contours.NEntries(); i++) {
+    R2Polygon *contour = contours[i];
+    int npoints = contour->NPoints();
+    if (npoints < 3) continue;
+    const R2Point *p1 = &(contour->Point(npoints-1));
+    for (int j = 0; j < npoints; j++) {
+      const R2Point *p2 = &(contour->Point(j));
+      if ((p1->Y() > point.Y()) != (p2->Y() > point.Y())) {
+        RNScalar t = (point.Y() - p1->Y()) / (p2->Y() - p1->Y());
+        RNCoord x = p1->X() + t * (p2->X() - p1->X());
+        if (x > point.X()) winding += (p2->Y() > p1->Y()) ? 1 : -1;
+      }
+      p1 = p2;
+    }
+  }
+
+  // Return winding number
+  return winding;
+}
+
+
+
+RNBoolean R2PolygonSet::
+Contains(const R2Point& point, int fill_rule) const
+{
+  // Return whether point is in filled region
+  int winding = WindingNumber(point);
+  if (fill_rule == R2_POLYGON_EVEN_ODD_FILL_RULE) return (winding % 2) ? TRUE : FALSE;
+  else if (fill_rule == R2_POLYGON_POSITIVE_FILL_RULE) return (winding > 0) ? TRUE : FALSE;
+  else return (winding != 0) ? TRUE : FALSE;
+}
+
+
+
+// Insertion functions
+
+void R2PolygonSet::
+InsertContour(const R2Point *points, int npoints)
+{
+  // Check number of points
+  if (npoints < 3) return;
+
+  // Insert contour
+  R2Polygon *contour = new R2Polygon(points, npoints);
+  contours.Insert(contour);
+  bbox.Union(contour->BBox());
+}
+
+
+
+void R2PolygonSet::
+InsertPolygon(const R2Polygon& polygon, RNBoolean hole)
+{
+  // Check number of points
+  int npoints = polygon.NPoints();
+  if (npoints < 3) return;
+
+  // Compute orientation of points
+  RNScalar sum = 0;
+  const R2Point *p1 = &(polygon.Point(npoints-1));
+  for (int i = 0; i < npoints; i++) {
+    const R2Point *p2 = &(polygon.Point(i));
+    sum += p1->X()*p2->Y() - p2->X()*p1->Y();
+    p1 = p2;
+  }
+
+  // Copy points, reversing them if orientation is wrong
+  R2Point *points = new R2Point [ npoints ];
+  RNBoolean reverse = ((sum < 0) != hole) ? TRUE : FALSE;
+  for (int i = 0; i < npoints; i++) {
+    points[i] = (reverse) ? polygon.Point(npoints-1-i) : polygon.Point(i);
+  }
+
+  // Insert contour
+  InsertContour(points, npoints);
+
+  // Delete points
+  delete [] points;
+}
+
+
+
+void R2PolygonSet::
+InsertPolygons(const R2PolygonSet& set)
+{
+  // Insert copies of all contours of set
+  for (int i = 0; i < set.contours.NEntries(); i++) {
+    R2Polygon *contour = new R2Polygon(*(set.contours[i]));
+    contours.Insert(contour);
+    bbox.Union(contour->BBox());
+  }
+}
+
+
+
+// Manipulation functions
+
+void R2PolygonSet::
+Empty(void)
+{
+  // Delete contours
+  for (int i = 0; i < contours.NEntries(); i++) delete contours[i];
+  contours.Empty();
+  bbox = R2null_box;
+}
+
+
+
+void R2PolygonSet::
+Transform(const R2Transformation& transformation)
+{
+  // Transform contours
+  for (int i = 0; i < contours.NEntries(); i++) {
+    R2Polygon *contour = contours[i];
+    contour->Transform(transformation);
+
+    // Reverse contours if transformation is mirrored
+    if (transformation.IsMirrored()) {
+      int npoints = contour->NPoints();
+      R2Point *points = new R2Point [ npoints ];
+      for (int j = 0; j < npoints; j++) points[j] = contour->Point(npoints-1-j);
+      contours[i] = new R2Polygon(points, npoints);
+      delete [] points;
+      delete contour;
+    }
+  }
+
+  // Update bounding box
+  UpdateBBox();
+}
+
+
+
+R2PolygonSet& R2PolygonSet::
+operator=(const R2PolygonSet& set)
+{
+  // Check for self assignment
+  if (&set == this) return *this;
+
+  // Copy contours
+  Empty();
+  InsertPolygons(set);
+  return *this;
+}
+
+
+
+void R2PolygonSet::
+UpdateBBox(void)
+{
+  // Recompute bounding box
+  bbox = R2null_box;
+  for (int i = 0; i < contours.NEntries(); i++) {
+    bbox.Union(contours[i]->BBox());
+  }
+}
+
+
+
+// Boolean operation internal types and functions
+
+struct R2PolygonBooleanEdge {
+  R2Point p1, p2;
+  int operand;
+};
+
+struct R2PolygonBooleanPoint {
+  R2Point position;
+  int edge;
+  RNScalar t;
+  int parent;
+};
+
+struct R2PolygonBooleanCell {
+  long long ix, iy;
+  int point;
+};
+
+struct R2PolygonBooleanSegment {
+  int vertex1, vertex2;
+  int winding[2];
+  int count[2];
+};
+
+struct R2PolygonBooleanHalfEdge {
+  int vertex;
+  RNAngle angle;
+  int halfedge;
+};
+
+struct R2PolygonBooleanBands {
+  RNCoord min;
+  RNLength width;
+  int nbands;
+  int *first;
+  int *segments;
+};
+
+
+
+static int
+CompareBooleanEdgeXMins(const void *data1, const void *data2)
+{
+  // Compare edges by minimum x coordinate
+  const R2PolygonBooleanEdge *edge1 = *((const R2PolygonBooleanEdge **) data1);
+  const R2PolygonBooleanEdge *edge2 = *((const R2PolygonBooleanEdge **) data2);
+  RNCoord x1 = (edge1->p1.X() < edge1->p2.X()) ? edge1->p1.X() : edge1->p2.X();
+  RNCoord x2 = (edge2->p1.X() < edge2->p2.X()) ? edge2->p1.X() : edge2->p2.X();
+  if (x1 < x2) return -1;
+  else if (x1 > x2) return 1;
+  else return 0;
+}
+
+
+
+static int
+CompareBooleanPointEdges(const void *data1, const void *data2)
+{
+  // Compare points by edge and then position along edge
+  const R2PolygonBooleanPoint *point1 = *((const R2PolygonBooleanPoint **) data1);
+  const R2PolygonBooleanPoint *point2 = *((const R2PolygonBooleanPoint **) data2);
+  if (point1->edge < point2->edge) return -1;
+  else if (point1->edge > point2->edge) return 1;
+  else if (point1->t < point2->t) return -1;
+  else if (point1->t > point2->t) return 1;
+  else return 0;
+}
+
+
+
+static int
+CompareBooleanCells(const void *data1, const void *data2)
+{
+  // Compare cells lexicographically
+  const R2PolygonBooleanCell *cell1 = (const R2PolygonBooleanCell *) data1;
+  const R2PolygonBooleanCell *cell2 = (const R2PolygonBooleanCell *) data2;
+  if (cell1->ix < cell2->ix) return -1;
+  else if (cell1->ix > cell2->ix) return 1;
+  else if (cell1->iy < cell2->iy) return -1;
+  else if (cell1->iy > cell2->iy) return 1;
+  else return 0;
+}
+
+
+
+static int
+CompareBooleanSegments(const void *data1, const void *data2)
+{
+  // Compare segments by vertices
+  const R2PolygonBooleanSegment *segment1 = (const R2PolygonBooleanSegment *) data1;
+  const R2PolygonBooleanSegment *segment2 = (const R2PolygonBooleanSegment *) data2;
+  if (segment1->vertex1 < segment2->vertex1) return -1;
+  else if (segment1->vertex1 > segment2->vertex1) return 1;
+  else if (segment1->vertex2 < segment2->vertex2) return -1;
+  else if (segment1->vertex2 > segment2->vertex2) return 1;
+  else return 0;
+}
+
+
+
+static int
+CompareBooleanHalfEdges(const void *data1, const void *data2)
+{
+  // Compare half edges by origin vertex and then angle
+  const R2PolygonBooleanHalfEdge *halfedge1 = (const R2PolygonBooleanHalfEdge *) data1;
+  const R2PolygonBooleanHalfEdge *halfedge2 = (const R2PolygonBooleanHalfEdge *) data2;
+  if (halfedge1->vertex < halfedge2->vertex) return -1;
+  else if (halfedge1->vertex > halfedge2->vertex) return 1;
+  else if (halfedge1->angle < halfedge2->angle) return -1;
+  else if (halfedge1->angle > halfedge2->angle) return 1;
+  else return 0;
+}
+
+
+
+static void
+InsertBooleanPoint(R2PolygonBooleanPoint **points, int *npoints, int *nallocated,
+  const R2Point& position, int edge, RNScalar t)
+{
+  // Grow array
+  if (*npoints >= *nallocated) {
+    int allocated = (*nallocated > 0) ? 2 * (*nallocated) : 1024;
+    R2PolygonBooleanPoint *array = new R2PolygonBooleanPoint [ allocated ];
+    for (int i = 0; i < *npoints; i++) array[i] = (*points)[i];
+    if (*points) delete [] *points;
+    *points = array;
+    *nallocated = allocated;
+  }
+
+  // Insert point
+  R2PolygonBooleanPoint *point = &((*points)[(*npoints)++]);
+  point->position = position;
+  point->edge = edge;
+  point->t = t;
+  point->parent = -1;
+}
+
+
+
+static void
+SplitBooleanEdges(const R2PolygonBooleanEdge *edges, int index1, int index2, RNLength epsilon,
+  R2PolygonBooleanPoint **points, int *npoints, int *nallocated)
+{
+  // Get edge geometry
+  const R2PolygonBooleanEdge *edge1 = &edges[index1];
+  const R2PolygonBooleanEdge *edge2 = &edges[index2];
+  R2Vector v1 = edge1->p2 - edge1->p1;
+  R2Vector v2 = edge2->p2 - edge2->p1;
+  RNLength length1 = v1.Length();
+  RNLength length2 = v2.Length();
+
+  // Compute signed distances of endpoints to the other edge's line
+  R2Vector w11 = edge2->p1 - edge1->p1, w12 = edge2->p2 - edge1->p1;
+  R2Vector w21 = edge1->p1 - edge2->p1, w22 = edge1->p2 - edge2->p1;
+  RNLength d11 = (v1.X()*w11.Y() - v1.Y()*w11.X()) / length1;
+  RNLength d12 = (v1.X()*w12.Y() - v1.Y()*w12.X()) / length1;
+  RNLength d21 = (v2.X()*w21.Y() - v2.Y()*w21.X()) / length2;
+  RNLength d22 = (v2.X()*w22.Y() - v2.Y()*w22.X()) / length2;
+
+  // Split edges where endpoints of the other edge touch them (T junctions and collinear overlaps)
+  RNBoolean touching = FALSE;
+  const R2Point *endpoints2[2] = { &edge2->p1, &edge2->p2 };
+  RNLength distances2[2] = { d11, d12 };
+  for (int k = 0; k < 2; k++) {
+    if (fabs(distances2[k]) > epsilon) continue;
+    RNScalar t = (*endpoints2[k] - edge1->p1).Dot(v1) / (length1 * length1);
+    if ((t * length1 > epsilon) && ((1 - t) * length1 > epsilon)) {
+      InsertBooleanPoint(points, npoints, nallocated, *endpoints2[k], index1, t);
+    }
+    touching = TRUE;
+  }
+  const R2Point *endpoints1[2] = { &edge1->p1, &edge1->p2 };
+  RNLength distances1[2] = { d21, d22 };
+  for (int k = 0; k < 2; k++) {
+    if (fabs(distances1[k]) > epsilon) continue;
+    RNScalar t = (*endpoints1[k] - edge2->p1).Dot(v2) / (length2 * length2);
+    if ((t * length2 > epsilon) && ((1 - t) * length2 > epsilon)) {
+      InsertBooleanPoint(points, npoints, nallocated, *endpoints1[k], index2, t);
+    }
+    touching = TRUE;
+  }
+
+  // Split both edges at proper crossing
+  if (touching) return;
+  if ((d11 > 0) == (d12 > 0)) return;
+  if ((d21 > 0) == (d22 > 0)) return;
+  RNScalar t2 = d11 / (d11 - d12);
+  R2Point position = edge2->p1 + t2 * v2;
+  RNScalar t1 = (position - edge1->p1).Dot(v1) / (length1 * length1);
+  InsertBooleanPoint(points, npoints, nallocated, position, index1, t1);
+  InsertBooleanPoint(points, npoints, nallocated, position, index2, t2);
+}
+
+
+
+static int
+FindBooleanRoot(R2PolygonBooleanPoint *points, int index)
+{
+  // Find root of union-find tree, compressing path
+  int root = index;
+  while (points[root].parent != root) root = points[root].parent;
+  while (points[index].parent != root) {
+    int parent = points[index].parent;
+    points[index].parent = root;
+    index = parent;
+  }
+  return root;
+}
+
+
+
+static void
+CreateBooleanBands(R2PolygonBooleanBands *bands, const R2PolygonBooleanSegment *segments, int nsegments,
+  const R2Point *positions, RNDimension dim, RNCoord min, RNCoord max)
+{
+  // Choose number of bands so that few segments are in every band, halving it while long segments
+  // would be inserted into too many bands
+  bands->min = min;
+  bands->nbands = nsegments / 2 + 1;
+  while (bands->nbands > 1) {
+    bands->width = (max - min) / bands->nbands;
+    if (bands->width <= 0) { bands->nbands = 1; break; }
+    long long nentries = 0;
+    for (int i = 0; i < nsegments; i++) {
+      RNCoord c1 = positions[segments[i].vertex1][dim];
+      RNCoord c2 = positions[segments[i].vertex2][dim];
+      nentries += (long long) (fabs(c2 - c1) / bands->width) + 2;
+    }
+    if (nentries <= 8 * (long long) nsegments) break;
+    bands->nbands /= 2;
+  }
+  bands->width = (max - min) / bands->nbands;
+  if (bands->width <= 0) bands->width = 1;
+  bands->first = new int [ bands->nbands + 1 ];
+  for (int i = 0; i <= bands->nbands; i++) bands->first[i] = 0;
+
+  // Count segments overlapping every band
+  for (int pass = 0; pass < 2; pass++) {
+    for (int i = 0; i < nsegments; i++) {
+      RNCoord c1 = positions[segments[i].vertex1][dim];
+      RNCoord c2 = positions[segments[i].vertex2][dim];
+      int b1 = (int) (((c1 < c2) ? c1 - min : c2 - min) / bands->width);
+      int b2 = (int) (((c1 < c2) ? c2 - min : c1 - min) / bands->width);
+      if (b1 < 0) b1 = 0;
+      if (b2 > bands->nbands - 1) b2 = bands->nbands - 1;
+      for (int b = b1; b <= b2; b++) {
+        if (pass == 0) bands->first[b+1]++;
+        else bands->segments[bands->first[b]++] = i;
+      }
+    }
+
+    // Convert counts to offsets, or restore offsets after filling
+    if (pass == 0) {
+      for (int b = 0; b < bands->nbands; b++) bands->first[b+1] += bands->first[b];
+      bands->segments = new int [ bands->first[bands->nbands] + 1 ];
+    }
+    else {
+      for (int b = bands->nbands; b > 0; b--) bands->first[b] = bands->first[b-1];
+      bands->first[0] = 0;
+    }
+  }
+}
+
+
+
+static void
+ComputeBooleanWinding(const R2PolygonBooleanBands *bands, const R2PolygonBooleanSegment *segments,
+  const R2Point *positions, RNDimension dim, const R2Point& point, int exclude, int winding[2], int count[2])
+{
+  // Find band containing point (rays go along the other dimension)
+  int b = (int) ((point[dim] - bands->min) / bands->width);
+  if (b < 0) b = 0;
+  if (b > bands->nbands - 1) b = bands->nbands - 1;
+
+  // Count crossings of ray from point in positive direction
+  RNDimension ray_dim = 1 - dim;
+  winding[0] = winding[1] = count[0] = count[1] = 0;
+  for (int i = bands->first[b]; i < bands->first[b+1]; i++) {
+    int index = bands->segments[i];
+    if (index == exclude) continue;
+    const R2PolygonBooleanSegment *segment = &segments[index];
+    const R2Point& p1 = positions[segment->vertex1];
+    const R2Point& p2 = positions[segment->vertex2];
+    if ((p1[dim] > point[dim]) == (p2[dim] > point[dim])) continue;
+    RNScalar t = (point[dim] - p1[dim]) / (p2[dim] - p1[dim]);
+    RNCoord c = p1[ray_dim] + t * (p2[ray_dim] - p1[ray_dim]);
+    if (c <= point[ray_dim]) continue;
+
+    // Counterclockwise boundaries go up on the right side and left on the top side
+    int sign = (p2[dim] > p1[dim]) ? 1 : -1;
+    if (dim == RN_X) sign = -sign;
+    for (int k = 0; k < 2; k++) {
+      winding[k] += sign * segment->winding[k];
+      count[k] += segment->count[k];
+    }
+  }
+}
+
+
+
+static RNBoolean
+IsBooleanFilled(int winding, int count, int fill_rule)
+{
+  // Return whether winding number is filled
+  if (fill_rule == R2_POLYGON_EVEN_ODD_FILL_RULE) return (count % 2) ? TRUE : FALSE;
+  else if (fill_rule == R2_POLYGON_POSITIVE_FILL_RULE) return (winding > 0) ? TRUE : FALSE;
+  else return (winding != 0) ? TRUE : FALSE;
+}
+
+
+
+static RNBoolean
+IsBooleanResult(RNBoolean filled1, RNBoolean filled2, int operation)
+{
+  // Return whether operation fills region
+  if (operation == R2_POLYGON_INTERSECTION_OPERATION) return filled1 && filled2;
+  else if (operation == R2_POLYGON_DIFFERENCE_OPERATION) return filled1 && !filled2;
+  else if (operation == R2_POLYGON_XOR_OPERATION) return filled1 != filled2;
+  else return filled1 || filled2;
+}
+
+
+
+static void
+ComputeBoolean(const RNArray<R2Polygon *> *operands[2], int operation, int fill_rule, RNArray<R2Polygon *>& result)
+{
+  // Count edges and compute bounding box
+  int max_edges = 0;
+  R2Box bbox = R2null_box;
+  for (int k = 0; k < 2; k++) {
+    for (int i = 0; i < operands[k]->NEntries(); i++) {
+      max_edges += operands[k]->Kth(i)->NPoints();
+      bbox.Union(operands[k]->Kth(i)->BBox());
+    }
+  }
+
+  // Compute tolerance for merging points
+  if (max_edges < 3) return;
+  RNLength extent = (bbox.XLength() > bbox.YLength()) ? bbox.XLength() : bbox.YLength();
+  if (extent <= 0) return;
+  RNCoord origin_extent = fabs(bbox.XMin()) + fabs(bbox.YMin()) + fabs(bbox.XMax()) + fabs(bbox.YMax());
+  RNLength epsilon = 1E-9 * ((origin_extent > extent) ? origin_extent : extent);
+
+  // Create edges (skipping degenerate ones)
+  R2PolygonBooleanEdge *edges = new R2PolygonBooleanEdge [ max_edges ];
+  int nedges = 0;
+  for (int k = 0; k < 2; k++) {
+    for (int i = 0; i < operands[k]->NEntries(); i++) {
+      R2Polygon *polygon = operands[k]->Kth(i);
+      int npoints = polygon->NPoints();
+      if (npoints < 3) continue;
+      for (int j = 0; j < npoints; j++) {
+        const R2Point& p1 = polygon->Point(j);
+        const R2Point& p2 = polygon->Point((j+1) % npoints);
+        if (R2Distance(p1, p2) <= epsilon) continue;
+        edges[nedges].p1 = p1;
+        edges[nedges].p2 = p2;
+        edges[nedges].operand = k;
+        nedges++;
+      }
+    }
+  }
+
+  // Create points at endpoints of edges
+  R2PolygonBooleanPoint *points = NULL;
+  int npoints = 0, nallocated = 0;
+  for (int i = 0; i < nedges; i++) {
+    InsertBooleanPoint(&points, &npoints, &nallocated, edges[i].p1, i, 0);
+    InsertBooleanPoint(&points, &npoints, &nallocated, edges[i].p2, i, 1);
+  }
+
+  // Create points where edges touch or cross (sweeping in x)
+  R2PolygonBooleanEdge **sorted_edges = new R2PolygonBooleanEdge * [ nedges ];
+  for (int i = 0; i < nedges; i++) sorted_edges[i] = &edges[i];
+  qsort(sorted_edges, nedges, sizeof(R2PolygonBooleanEdge *), CompareBooleanEdgeXMins);
+  for (int i = 0; i < nedges; i++) {
+    R2PolygonBooleanEdge *edge1 = sorted_edges[i];
+    RNCoord xmax1 = (edge1->p1.X() > edge1->p2.X()) ? edge1->p1.X() : edge1->p2.X();
+    RNCoord ymin1 = (edge1->p1.Y() < edge1->p2.Y()) ? edge1->p1.Y() : edge1->p2.Y();
+    RNCoord ymax1 = (edge1->p1.Y() > edge1->p2.Y()) ? edge1->p1.Y() : edge1->p2.Y();
+    for (int j = i+1; j < nedges; j++) {
+      R2PolygonBooleanEdge *edge2 = sorted_edges[j];
+      RNCoord xmin2 = (edge2->p1.X() < edge2->p2.X()) ? edge2->p1.X() : edge2->p2.X();
+      if (xmin2 > xmax1 + epsilon) break;
+      if ((edge2->p1.Y() < ymin1 - epsilon) && (edge2->p2.Y() < ymin1 - epsilon)) continue;
+      if ((edge2->p1.Y() > ymax1 + epsilon) && (edge2->p2.Y() > ymax1 + epsilon)) continue;
+      SplitBooleanEdges(edges, edge1 - edges, edge2 - edges, epsilon, &points, &npoints, &nallocated);
+    }
+  }
+
+  // Merge points within tolerance (hashing them into sorted grid cells)
+  RNLength cell_size = 2 * epsilon;
+  R2PolygonBooleanCell *cells = new R2PolygonBooleanCell [ npoints ];
+  for (int i = 0; i < npoints; i++) {
+    cells[i].ix = (long long) floor((points[i].position.X() - bbox.XMin()) / cell_size);
+    cells[i].iy = (long long) floor((points[i].position.Y() - bbox.YMin()) / cell_size);
+    cells[i].point = i;
+    points[i].parent = i;
+  }
+  qsort(cells, npoints, sizeof(R2PolygonBooleanCell), CompareBooleanCells);
+  for (int i = 0; i < npoints; i++) {
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        // Find first entry of neighbor cell
+        R2PolygonBooleanCell key;
+        key.ix = cells[i].ix + dx;
+        key.iy = cells[i].iy + dy;
+        int lo = 0, hi = npoints;
+        while (lo < hi) {
+          int mid = (lo + hi) / 2;
+          if (CompareBooleanCells(&cells[mid], &key) < 0) lo = mid + 1;
+          else hi = mid;
+        }
+
+        // Merge with points of neighbor cell
+        for (int j = lo; j < npoints; j++) {
+          if (CompareBooleanCells(&cells[j], &key) != 0) break;
+          if (j == i) continue;
+          const R2Point& position1 = points[cells[i].point].position;
+          const R2Point& position2 = points[cells[j].point].position;
+          if (R2SquaredDistance(position1, position2) > cell_size * cell_size) continue;
+          int root1 = FindBooleanRoot(points, cells[i].point);
+          int root2 = FindBooleanRoot(points, cells[j].point);
+          if (root1 < root2) points[root2].parent = root1;
+          else if (root2 < root1) points[root1].parent = root2;
+        }
+      }
+    }
+  }
+  delete [] cells;
+
+  // Create vertices at roots of merged points
+  int *vertex_indices = new int [ npoints ];
+  R2Point *positions = new R2Point [ npoints ];
+  int nvertices = 0;
+  for (int i = 0; i < npoints; i++) {
+    int root = FindBooleanRoot(points, i);
+    if (root == i) {
+      positions[nvertices] = points[i].position;
+      vertex_indices[i] = nvertices++;
+    }
+    else {
+      vertex_indices[i] = vertex_indices[root];
+    }
+  }
+
+  // Create segments between consecutive points along every edge
+  R2PolygonBooleanPoint **sorted_points = new R2PolygonBooleanPoint * [ npoints ];
+  for (int i = 0; i < npoints; i++) sorted_points[i] = &points[i];
+  qsort(sorted_points, npoints, sizeof(R2PolygonBooleanPoint *), CompareBooleanPointEdges);
+  R2PolygonBooleanSegment *segments = new R2PolygonBooleanSegment [ npoints ];
+  int nsegments = 0;
+  for (int i = 0; i < npoints-1; i++) {
+    if (sorted_points[i]->edge != sorted_points[i+1]->edge) continue;
+    int v1 = vertex_indices[sorted_points[i] - points];
+    int v2 = vertex_indices[sorted_points[i+1] - points];
+    if (v1 == v2) continue;
+    int operand = edges[sorted_points[i]->edge].operand;
+    R2PolygonBooleanSegment *segment = &segments[nsegments++];
+    segment->vertex1 = (v1 < v2) ? v1 : v2;
+    segment->vertex2 = (v1 < v2) ? v2 : v1;
+    segment->winding[0] = segment->winding[1] = 0;
+    segment->count[0] = segment->count[1] = 0;
+    segment->winding[operand] = (v1 < v2) ? 1 : -1;
+    segment->count[operand] = 1;
+  }
+
+  // Merge overlapping segments
+  qsort(segments, nsegments, sizeof(R2PolygonBooleanSegment), CompareBooleanSegments);
+  int nmerged = 0;
+  for (int i = 0; i < nsegments; i++) {
+    if ((nmerged > 0) && (CompareBooleanSegments(&segments[nmerged-1], &segments[i]) == 0)) {
+      for (int k = 0; k < 2; k++) {
+        segments[nmerged-1].winding[k] += segments[i].winding[k];
+        segments[nmerged-1].count[k] += segments[i].count[k];
+      }
+    }
+    else {
+      segments[nmerged++] = segments[i];
+    }
+  }
+  nsegments = nmerged;
+
+  // Create bands of segments for casting rays in x (bands along y) and in y (bands along x)
+  R2Box vertex_bbox = R2null_box;
+  for (int i = 0; i < nvertices; i++) vertex_bbox.Union(positions[i]);
+  R2PolygonBooleanBands bands[2];
+  CreateBooleanBands(&bands[RN_X], segments, nsegments, positions, RN_X, vertex_bbox.XMin(), vertex_bbox.XMax());
+  CreateBooleanBands(&bands[RN_Y], segments, nsegments, positions, RN_Y, vertex_bbox.YMin(), vertex_bbox.YMax());
+
+  // Sort half edges (2*i runs from vertex1 to vertex2 of segment i, 2*i+1 back) counterclockwise around vertices
+  int nhalfedges = 2 * nsegments;
+  R2PolygonBooleanHalfEdge *around = new R2PolygonBooleanHalfEdge [ nhalfedges + 1 ];
+  for (int h = 0; h < nhalfedges; h++) {
+    const R2PolygonBooleanSegment *segment = &segments[h/2];
+    int origin = (h % 2) ? segment->vertex2 : segment->vertex1;
+    int destination = (h % 2) ? segment->vertex1 : segment->vertex2;
+    R2Vector direction = positions[destination] - positions[origin];
+    around[h].vertex = origin;
+    around[h].angle = atan2(direction.Y(), direction.X());
+    around[h].halfedge = h;
+  }
+  qsort(around, nhalfedges, sizeof(R2PolygonBooleanHalfEdge), CompareBooleanHalfEdges);
+  int *first_around = new int [ nvertices + 1 ];
+  int *slots = new int [ nhalfedges + 1 ];
+  for (int i = 0; i <= nvertices; i++) first_around[i] = nhalfedges;
+  for (int j = nhalfedges-1; j >= 0; j--) {
+    first_around[around[j].vertex] = j;
+    slots[around[j].halfedge] = j;
+  }
+  for (int i = nvertices-1; i >= 0; i--) {
+    if (first_around[i] > first_around[i+1]) first_around[i] = first_around[i+1];
+  }
+
+  // Find faces to the left of half edges (tracing them by turning as sharply clockwise as possible)
+  int *faces = new int [ nhalfedges + 1 ];
+  int *next = new int [ nhalfedges + 1 ];
+  for (int h = 0; h < nhalfedges; h++) {
+    int twin = h ^ 1;
+    int v = around[slots[twin]].vertex;
+    int degree = first_around[v+1] - first_around[v];
+    int k = first_around[v] + (slots[twin] - first_around[v] + degree - 1) % degree;
+    next[h] = around[k].halfedge;
+    faces[h] = -1;
+  }
+  int nfaces = 0;
+  for (int h = 0; h < nhalfedges; h++) {
+    if (faces[h] >= 0) continue;
+    int g = h;
+    while (faces[g] < 0) { faces[g] = nfaces; g = next[g]; }
+    nfaces++;
+  }
+
+  // Build lists of half edges bounding every face
+  int *first_bounding = new int [ nfaces + 1 ];
+  int *bounding = new int [ nhalfedges + 1 ];
+  for (int f = 0; f <= nfaces; f++) first_bounding[f] = 0;
+  for (int h = 0; h < nhalfedges; h++) first_bounding[faces[h] + 1]++;
+  for (int f = 0; f < nfaces; f++) first_bounding[f+1] += first_bounding[f];
+  for (int h = 0; h < nhalfedges; h++) bounding[first_bounding[faces[h]]++] = h;
+  for (int f = nfaces; f > 0; f--) first_bounding[f] = first_bounding[f-1];
+  first_bounding[0] = 0;
+
+  // Compute winding numbers of faces, casting one ray per connected component and propagating across segments
+  int *face_windings = new int [ 4 * nfaces + 1 ];
+  RNBoolean *face_known = new RNBoolean [ nfaces + 1 ];
+  int *queue = new int [ nfaces + 1 ];
+  for (int f = 0; f < nfaces; f++) face_known[f] = FALSE;
+  for (int i = 0; i < nsegments; i++) {
+    if (face_known[faces[2*i]]) continue;
+    R2PolygonBooleanSegment *segment = &segments[i];
+    const R2Point& p1 = positions[segment->vertex1];
+    const R2Point& p2 = positions[segment->vertex2];
+    R2Point midpoint(0.5 * (p1.X() + p2.X()), 0.5 * (p1.Y() + p2.Y()));
+
+    // Compute winding numbers just beside the midpoint (rays avoid running along the segment)
+    RNLength dx = p2.X() - p1.X(), dy = p2.Y() - p1.Y();
+    RNDimension dim = (fabs(dy) >= fabs(dx)) ? RN_Y : RN_X;
+    int winding[2], count[2];
+    ComputeBooleanWinding(&bands[dim], segments, positions, dim, midpoint, i, winding, count);
+
+    // Assign winding numbers to faces on left and right sides
+    int *left = &face_windings[4*faces[2*i]];
+    int *right = &face_windings[4*faces[2*i+1]];
+    RNBoolean ray_side_is_left = (dim == RN_Y) ? (dy < 0) : (dx > 0);
+    for (int k = 0; k < 2; k++) {
+      if (ray_side_is_left) {
+        left[2*k] = winding[k];
+        left[2*k+1] = count[k];
+        right[2*k] = winding[k] - segment->winding[k];
+        right[2*k+1] = count[k] + segment->count[k];
+      }
+      else {
+        right[2*k] = winding[k];
+        right[2*k+1] = count[k];
+        left[2*k] = winding[k] + segment->winding[k];
+        left[2*k+1] = count[k] + segment->count[k];
+      }
+    }
+
+    // Propagate winding numbers to other faces of component
+    int nqueue = 0;
+    face_known[faces[2*i]] = TRUE;
+    queue[nqueue++] = faces[2*i];
+    if (!face_known[faces[2*i+1]]) {
+      face_known[faces[2*i+1]] = TRUE;
+      queue[nqueue++] = faces[2*i+1];
+    }
+    for (int q = 0; q < nqueue; q++) {
+      int f = queue[q];
+      for (int j = first_bounding[f]; j < first_bounding[f+1]; j++) {
+        int h = bounding[j];
+        int g = faces[h ^ 1];
+        if (face_known[g]) continue;
+        const R2PolygonBooleanSegment *crossed = &segments[h/2];
+        int sign = (h % 2) ? 1 : -1;
+        for (int k = 0; k < 2; k++) {
+          face_windings[4*g+2*k] = face_windings[4*f+2*k] + sign * crossed->winding[k];
+          face_windings[4*g+2*k+1] = face_windings[4*f+2*k+1] + crossed->count[k];
+        }
+        face_known[g] = TRUE;
+        queue[nqueue++] = g;
+      }
+    }
+  }
+
+  // Keep segments with the result filled on exactly one side, oriented with the filled side on the left
+  int *result_vertices = new int [ 2 * nsegments + 1 ];
+  int nresult = 0;
+  for (int i = 0; i < nsegments; i++) {
+    R2PolygonBooleanSegment *segment = &segments[i];
+    const int *left_windings = &face_windings[4*faces[2*i]];
+    const int *right_windings = &face_windings[4*faces[2*i+1]];
+    RNBoolean left = IsBooleanResult(IsBooleanFilled(left_windings[0], left_windings[1], fill_rule),
+      IsBooleanFilled(left_windings[2], left_windings[3], fill_rule), operation);
+    RNBoolean right = IsBooleanResult(IsBooleanFilled(right_windings[0], right_windings[1], fill_rule),
+      IsBooleanFilled(right_windings[2], right_windings[3], fill_rule), operation);
+    if (left == right) continue;
+    result_vertices[2*nresult+0] = (left) ? segment->vertex1 : segment->vertex2;
+    result_vertices[2*nresult+1] = (left) ? segment->vertex2 : segment->vertex1;
+    nresult++;
+  }
+
+  // Build lists of outgoing result segments for every vertex
+  int *first_outgoing = new int [ nvertices + 1 ];
+  int *outgoing = new int [ nresult + 1 ];
+  for (int i = 0; i <= nvertices; i++) first_outgoing[i] = 0;
+  for (int i = 0; i < nresult; i++) first_outgoing[result_vertices[2*i] + 1]++;
+  for (int i = 0; i < nvertices; i++) first_outgoing[i+1] += first_outgoing[i];
+  for (int i = 0; i < nresult; i++) outgoing[first_outgoing[result_vertices[2*i]]++] = i;
+  for (int i = nvertices; i > 0; i--) first_outgoing[i] = first_outgoing[i-1];
+  first_outgoing[0] = 0;
+
+  // Trace loops, turning as sharply clockwise as possible at vertices with several outgoing segments
+  RNBoolean *marked = new RNBoolean [ nresult + 1 ];
+  for (int i = 0; i < nresult; i++) marked[i] = FALSE;
+  R2Point *loop = new R2Point [ nresult + 1 ];
+  for (int i = 0; i < nresult; i++) {
+    if (marked[i]) continue;
+    int nloop = 0;
+    int current = i;
+    while (TRUE) {
+      // Add start of segment to loop
+      marked[current] = TRUE;
+      int v1 = result_vertices[2*current+0];
+      int v2 = result_vertices[2*current+1];
+      loop[nloop++] = positions[v1];
+
+      // Find next segment
+      int next = -1;
+      RNAngle best_angle = RN_INFINITY;
+      R2Vector back = positions[v1] - positions[v2];
+      for (int j = first_outgoing[v2]; j < first_outgoing[v2+1]; j++) {
+        int candidate = outgoing[j];
+        R2Vector direction = positions[result_vertices[2*candidate+1]] - positions[v2];
+        RNAngle angle = atan2(direction.X()*back.Y() - direction.Y()*back.X(), direction.Dot(back));
+        if (angle <= 0) angle += RN_TWO_PI;
+        if (angle < best_angle) { best_angle = angle; next = candidate; }
+      }
+
+      // Check if loop is done
+      if ((next < 0) || (next == i) || marked[next]) break;
+      current = next;
+    }
+
+    // Remove collinear points
+    RNBoolean removed = TRUE;
+    while (removed && (nloop >= 3)) {
+      removed = FALSE;
+      int nkept = 0;
+      for (int j = 0; j < nloop; j++) {
+        const R2Point& p0 = (nkept > 0) ? loop[nkept-1] : loop[nloop-1];
+        const R2Point& p1 = loop[j];
+        const R2Point& p2 = loop[(j+1) % nloop];
+        R2Vector v1 = p1 - p0, v2 = p2 - p1;
+        RNLength cross = v1.X()*v2.Y() - v1.Y()*v2.X();
+        if ((fabs(cross) <= epsilon * (v1.Length() + v2.Length())) && (v1.Dot(v2) >= 0)) { removed = TRUE; continue; }
+        loop[nkept++] = p1;
+      }
+      nloop = nkept;
+    }
+
+    // Create contour
+    if (nloop < 3) continue;
+    R2Polygon *contour = new R2Polygon(loop, nloop);
+    if (fabs(contour->Area()) <= epsilon * epsilon) { delete contour; continue; }
+    result.Insert(contour);
+  }
+
+  // Delete temporary memory
+  delete [] loop;
+  delete [] marked;
+  delete [] outgoing;
+  delete [] first_outgoing;
+  delete [] result_vertices;
+  delete [] queue;
+  delete [] face_known;
+  delete [] face_windings;
+  delete [] bounding;
+  delete [] first_bounding;
+  delete [] next;
+  delete [] faces;
+  delete [] slots;
+  delete [] first_around;
+  delete [] around;
+  for (int k = 0; k < 2; k++) {
+    delete [] bands[k].first;
+    delete [] bands[k].segments;
+  }
+  delete [] segments;
+  delete [] sorted_points;
+  delete [] positions;
+  delete [] vertex_indices;
+  delete [] sorted_edges;
+  delete [] points;
+  delete [] edges;
+}
+
+
+
+// Boolean operations
+
+void R2PolygonSet::
+Combine(const R2PolygonSet& set, int operation, int fill_rule)
+{
+  // Compute boundary of result
+  RNArray<R2Polygon *> result;
+  const RNArray<R2Polygon *> *operands[2] = { &contours, &set.contours };
+  ComputeBoolean(operands, operation, fill_rule, result);
+
+  // Replace contours
+  Empty();
+  contours = result;
+  UpdateBBox();
+}
+
+
+
+void R2PolygonSet::
+Union(const RNArray<R2PolygonSet *>& sets)
+{
+  // Gather contours of all sets into one operand (nonzero winding adds the regions of sets)
+  RNArray<R2Polygon *> gathered;
+  for (int i = 0; i < sets.NEntries(); i++) {
+    for (int j = 0; j < sets[i]->contours.NEntries(); j++) {
+      gathered.Insert(sets[i]->contours[j]);
+    }
+  }
+
+  // Compute boundary of union
+  RNArray<R2Polygon *> result;
+  const RNArray<R2Polygon *> *operands[2] = { &contours, &gathered };
+  ComputeBoolean(operands, R2_POLYGON_UNION_OPERATION, R2_POLYGON_NONZERO_FILL_RULE, result);
+
+  // Replace contours
+  Empty();
+  contours = result;
+  UpdateBBox();
+}
+
+
+
+void R2PolygonSet::
+Simplify(int fill_rule)
+{
+  // Replace contours by boundary of filled region
+  R2PolygonSet empty;
+  Combine(empty, R2_POLYGON_UNION_OPERATION, fill_rule);
+}
+
+
+
+// Offset functions
+
+void R2PolygonSet::
+Offset(RNLength distance, int join, RNScalar miter_limit, RNLength tolerance)
+{
+  // Check distance
+  if (distance == 0) { Simplify(); return; }
+  RNLength radius = fabs(distance);
+  if (tolerance <= 0) tolerance = 0.01 * radius;
+  if (tolerance > radius) tolerance = radius;
+  RNAngle arc_step = 2 * acos(1 - tolerance / radius);
+  if (arc_step < 0.01) arc_step = 0.01;
+
+  // Offset every contour, leaving loops where offset edges overlap
+  RNArray<R2Polygon *> offset_contours;
+  for (int c = 0; c < contours.NEntries(); c++) {
+    R2Polygon *contour = contours[c];
+    int npoints = contour->NPoints();
+    if (npoints < 3) continue;
+
+    // Compute outward normals of edges (filled region is on the left)
+    R2Vector *normals = new R2Vector [ npoints ];
+    for (int i = 0; i < npoints; i++) {
+      R2Vector direction = contour->Point((i+1) % npoints) - contour->Point(i);
+      RNLength length = direction.Length();
+      if (length > 0) direction /= length;
+      normals[i] = R2Vector(direction.Y(), -direction.X());
+    }
+
+    // Create offset points at every vertex
+    RNArray<R2Point *> offset_points;
+    for (int i = 0; i < npoints; i++) {
+      const R2Point& p = contour->Point(i);
+      const R2Vector& n1 = normals[(i + npoints - 1) % npoints];
+      const R2Vector& n2 = normals[i];
+      RNScalar sine = n1.X()*n2.Y() - n1.Y()*n2.X();
+      RNScalar cosine = n1.Dot(n2);
+      RNBoolean reversal = (1 + cosine < 1E-6);
+
+      // Check for nearly straight vertex
+      if ((fabs(sine) < 1E-6) && (cosine > 0)) {
+        offset_points.Insert(new R2Point(p + distance * n2));
+      }
+
+      // Check for vertex where offset edges overlap (sign of sine is meaningless where edges reverse)
+      else if (!reversal && (sine * distance < 0)) {
+        offset_points.Insert(new R2Point(p + distance * n1));
+        offset_points.Insert(new R2Point(p));
+        offset_points.Insert(new R2Point(p + distance * n2));
+      }
+
+      // Fill gap between offset edges with round join
+      else if (join == R2_POLYGON_ROUND_JOIN) {
+        RNAngle angle = (reversal) ? ((distance > 0) ? RN_PI : -RN_PI) : atan2(sine, cosine);
+        int nsteps = (int) ceil(fabs(angle) / arc_step);
+        if (nsteps < 1) nsteps = 1;
+        for (int k = 0; k <= nsteps; k++) {
+          R2Vector n = n1;
+          n.Rotate(angle * k / nsteps);
+          offset_points.Insert(new R2Point(p + distance * n));
+        }
+      }
+
+      // Fill gap between offset edges with miter or square join
+      else {
+        if ((join == R2_POLYGON_MITER_JOIN) && (1 + cosine > 0) && (sqrt(2 / (1 + cosine)) <= miter_limit)) {
+          offset_points.Insert(new R2Point(p + (distance / (1 + cosine)) * (n1 + n2)));
+        }
+        else if ((join == R2_POLYGON_SQUARE_JOIN) && reversal) {
+          // Edges reverse direction (bisector is undefined), so cap with square along incoming edge
+          R2Vector t1(-n1.Y(), n1.X());
+          offset_points.Insert(new R2Point(p + distance * n1 + radius * t1));
+          offset_points.Insert(new R2Point(p + distance * n2 + radius * t1));
+        }
+        else if (join == R2_POLYGON_SQUARE_JOIN) {
+          R2Vector bisector = n1 + n2;
+          bisector.Normalize();
+          R2Vector t1(-n1.Y(), n1.X()), t2(-n2.Y(), n2.X());
+          RNScalar s1 = distance * (1 - n1.Dot(bisector)) / t1.Dot(bisector);
+          RNScalar s2 = distance * (1 - n2.Dot(bisector)) / t2.Dot(bisector);
+          offset_points.Insert(new R2Point(p + distance * n1 + s1 * t1));
+          offset_points.Insert(new R2Point(p + distance * n2 + s2 * t2));
+        }
+        else {
+          offset_points.Insert(new R2Point(p + distance * n1));
+          offset_points.Insert(new R2Point(p + distance * n2));
+        }
+      }
+    }
+
+    // Create offset contour
+    offset_contours.Insert(new R2Polygon(offset_points));
+
+    // Delete temporary memory
+    for (int i = 0; i < offset_points.NEntries(); i++) delete offset_points[i];
+    delete [] normals;
+  }
+
+  // Replace contours by positively wound region of offset contours
+  RNArray<R2Polygon *> result;
+  RNArray<R2Polygon *> empty;
+  const RNArray<R2Polygon *> *operands[2] = { &offset_contours, &empty };
+  ComputeBoolean(operands, R2_POLYGON_UNION_OPERATION, R2_POLYGON_POSITIVE_FILL_RULE, result);
+  for (int i = 0; i < offset_contours.NEntries(); i++) delete offset_contours[i];
+  Empty();
+  contours = result;
+  UpdateBBox();
+}
+
+
+
+// Print functions
+
+void R2PolygonSet::
+Print(FILE *fp) const
+{
+  // Print contours
+  fprintf(fp, "%d\n", contours.NEntries());
+  for (int i = 0; i < contours.NEntries(); i++) {
+    contours[i]->Print(fp);
+  }
+}
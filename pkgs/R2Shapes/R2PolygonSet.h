@@ -0,0 +1,186 @@
+// Include file for R2 polygon set class
+
+#ifndef __R2POLYGONSET__H__
+#define __R2POLYGONSET__H__
+
+
+
+// Boolean operation constants
+
+const int R2_POLYGON_UNION_OPERATION = 0;
+const int R2_POLYGON_INTERSECTION_OPERATION = 1;
+const int R2_POLYGON_DIFFERENCE_OPERATION = 2;
+const int R2_POLYGON_XOR_OPERATION = 3;
+
+
+
+// Fill rule constants
+
+const int R2_POLYGON_NONZERO_FILL_RULE = 0;
+const int R2_POLYGON_EVEN_ODD_FILL_RULE = 1;
+const int R2_POLYGON_POSITIVE_FILL_RULE = 2;
+
+
+
+// Offset join constants
+
+const int R2_POLYGON_MITER_JOIN = 0;
+const int R2_POLYGON_ROUND_JOIN = 1;
+const int R2_POLYGON_SQUARE_JOIN = 2;
+
+
+
+// Class definition
+
+class R2PolygonSet {
+public:
+  // Constructors/destructors
+  R2PolygonSet(void);
+  R2PolygonSet(const R2PolygonSet& set);
+  R2PolygonSet(const R2Polygon& polygon);
+  ~R2PolygonSet(void);
+
+  // Contour access functions
+  int NContours(void) const;
+  const R2Polygon *Contour(int k) const;
+    // Outer boundaries are counterclockwise and holes are clockwise (their area is negative)
+  RNBoolean IsHole(int k) const;
+
+  // Property functions
+  RNBoolean IsEmpty(void) const;
+  int NPoints(void) const;
+  RNArea Area(void) const;
+    // Sum of signed contour areas
+  RNLength Perimeter(void) const;
+  const R2Box& BBox(void) const;
+  int WindingNumber(const R2Point& point) const;
+  RNBoolean Contains(const R2Point& point, int fill_rule = R2_POLYGON_NONZERO_FILL_RULE) const;
+
+  // Insertion functions
+  void InsertContour(const R2Point *points, int npoints);
+    // Keeps the orientation of the points
+  void InsertPolygon(const R2Polygon& polygon, RNBoolean hole = FALSE);
+    // Orients the polygon counterclockwise (or clockwise if it is a hole)
+  void InsertPolygons(const R2PolygonSet& set);
+
+  // Manipulation functions
+  void Empty(void);
+  void Transform(const R2Transformation& transformation);
+  R2PolygonSet& operator=(const R2PolygonSet& set);
+
+  // Boolean operations
+  void Union(const R2PolygonSet& set);
+  void Union(const RNArray<R2PolygonSet *>& sets);
+    // Merges many sets in one pass
+  void Intersect(const R2PolygonSet& set);
+  void Subtract(const R2PolygonSet& set);
+  void XOr(const R2PolygonSet& set);
+  void Combine(const R2PolygonSet& set, int operation, int fill_rule = R2_POLYGON_NONZERO_FILL_RULE);
+    // Replaces contours by the boundary of the operation applied to the regions filled by this and set,
+    // resolving crossings, overlapping edges, and touching vertices
+  void Simplify(int fill_rule = R2_POLYGON_NONZERO_FILL_RULE);
+    // Replaces contours by simple non-overlapping ones bounding the filled region
+
+  // Offset functions
+  void Offset(RNLength distance, int join = R2_POLYGON_MITER_JOIN, RNScalar miter_limit = 2, RNLength tolerance = 0);
+    // Grows (or shrinks if distance is negative) the filled region, miters longer than miter_limit times
+    // the distance are beveled, and round joins deviate at most tolerance from the arc (default is 1% of distance)
+
+  // Print functions
+  void Print(FILE *fp = stdout) const;
+
+public:
+  // Internal functions
+  void UpdateBBox(void);
+
+private:
+  RNArray<R2Polygon *> contours;
+  R2Box bbox;
+};
+
+
+
+// Inline functions
+
+inline int R2PolygonSet::
+NContours(void) const
+{
+  // Return number of contours
+  return contours.NEntries();
+}
+
+
+
+inline const R2Polygon *R2PolygonSet::
+Contour(int k) const
+{
+  // Return kth contour
+  return contours.Kth(k);
+}
+
+
+
+inline RNBoolean R2PolygonSet::
+IsHole(int k) const
+{
+  // Return whether kth contour is a hole
+  return (contours.Kth(k)->Area() < 0) ? TRUE : FALSE;
+}
+
+
+
+inline RNBoolean R2PolygonSet::
+IsEmpty(void) const
+{
+  // Return whether set has no contours
+  return contours.IsEmpty();
+}
+
+
+
+inline const R2Box& R2PolygonSet::
+BBox(void) const
+{
+  // Return bounding box
+  return bbox;
+}
+
+
+
+inline void R2PolygonSet::
+Union(const R2PolygonSet& set)
+{
+  // Replace by union
+  Combine(set, R2_POLYGON_UNION_OPERATION);
+}
+
+
+
+inline void R2PolygonSet::
+Intersect(const R2PolygonSet& set)
+{
+  // Replace by intersection
+  Combine(set, R2_POLYGON_INTERSECTION_OPERATION);
+}
+
+
+
+inline void R2PolygonSet::
+Subtract(const R2PolygonSet& set)
+{
+  // Replace by difference
+  Combine(set, R2_POLYGON_DIFFERENCE_OPERATION);
+}
+
+
+
+inline void R2PolygonSet::
+XOr(const R2PolygonSet& set)
+{
+  // Replace by symmetric difference
+  Combine(set, R2_POLYGON_XOR_OPERATION);
+}
+
+
+
+#endif
@@ -29,6 +29,7 @@ class R2Polyline;
 class R2Box;
 class R2Circle;
 class R2Polygon;
+class R2PolygonSet;
 class R2Grid;
 
 
@@ -72,6 +73,7 @@ class R2Grid;
 #include "R2Shapes/R2Box.h"
 #include "R2Shapes/R2Circle.h"
 #include "R2Shapes/R2Polygon.h"
+#include "R2Shapes/R2PolygonSet.h"
 
 
 
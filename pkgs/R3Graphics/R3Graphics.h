@@ -55,6 +55,12 @@ class R3SceneElement;
 
 
 
+/* Rendering include files */
+
+#include "R3Graphics/R3PathTracer.h"
+
+
+
 /* Initialization functions */
 
 int R3InitGraphics(void);
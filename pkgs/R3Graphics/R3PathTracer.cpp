@@ -0,0 +1,578 @@
+/* Source file for the R3 path tracer class */
+
+
+
+/* Include files */
+
+#include "R3Graphics.h"
+
+
+
+/* Sampler definition */
+
+struct R3PathTracerSampler {
+  // Random numbers for one sample of one pixel (splitmix64)
+  R3PathTracerSampler(unsigned int seed, int pixel_index, int sample_index);
+  RNScalar Next(void);
+  unsigned long long state;
+};
+
+
+
+R3PathTracerSampler::
+R3PathTracerSampler(unsigned int seed, int pixel_index, int sample_index)
+{
+  // Hash seed, pixel, and sample into the initial state
+  state = ((unsigned long long) seed << 32) ^ (unsigned long long) pixel_index;
+  state = state * 0x9E3779B97F4A7C15ULL + (unsigned long long) sample_index;
+  Next(); Next();
+}
+
+
+
+RNScalar R3PathTracerSampler::
+Next(void)
+{
+  // Return uniform random number in [0,1)
+  state += 0x9E3779B97F4A7C15ULL;
+  unsigned long long z = state;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z = z ^ (z >> 31);
+  return (RNScalar) (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+
+/* Utility functions */
+
+static R3Vector
+SampleDirection(const R3Vector& axis, RNScalar cos_theta, RNScalar phi)
+{
+  // Return direction at angle acos(cos_theta) from axis and at azimuth phi around it
+  RNDimension dim = axis.MinDimension();
+  R3Vector axis1 = axis % R3xyz_triad[dim];
+  axis1.Normalize();
+  R3Vector axis2 = axis % axis1;
+  axis2.Normalize();
+  RNScalar sin_theta = sqrt(1.0 - cos_theta * cos_theta);
+  R3Vector direction = cos_theta * axis;
+  direction += sin_theta * cos(phi) * axis1;
+  direction += sin_theta * sin(phi) * axis2;
+  direction.Normalize();
+  return direction;
+}
+
+
+
+static RNScalar
+RayOffset(const R3Point& point)
+{
+  // Return distance to move ray origins off surfaces
+  RNScalar size = fabs(point.X()) + fabs(point.Y()) + fabs(point.Z());
+  return 1.0E-4 + 1.0E-6 * size;
+}
+
+
+
+/* Member functions */
+
+R3PathTracer::
+R3PathTracer(R3Scene *scene)
+  : scene(scene),
+    viewer(),
+    width(0),
+    height(0),
+    eye(0, 0, 0),
+    far_origin(0, 0, 0),
+    far_right(0, 0, 0),
+    far_up(0, 0, 0),
+    max_samples_per_pixel(16),
+    max_time(0),
+    max_depth(3),
+    tile_size(16),
+    nthreads(0),
+    seed(0),
+    nsamples(0),
+    color_sums(NULL),
+    luminance_sums(NULL),
+    luminance_squared_sums(NULL),
+    albedos(NULL),
+    normals(NULL),
+    depths(NULL),
+    nodes(NULL),
+    materials(NULL)
+{
+}
+
+
+
+R3PathTracer::
+~R3PathTracer(void)
+{
+  // Delete buffers
+  if (color_sums) delete [] color_sums;
+  if (luminance_sums) delete [] luminance_sums;
+  if (luminance_squared_sums) delete [] luminance_squared_sums;
+  if (albedos) delete [] albedos;
+  if (normals) delete [] normals;
+  if (depths) delete [] depths;
+  if (nodes) delete [] nodes;
+  if (materials) delete [] materials;
+}
+
+
+
+void R3PathTracer::
+Reset(const R3Viewer& viewer)
+{
+  // Reallocate buffers if image size changed
+  int npixels = viewer.Viewport().Width() * viewer.Viewport().Height();
+  if (!color_sums || (npixels != width * height)) {
+    if (color_sums) delete [] color_sums;
+    if (luminance_sums) delete [] luminance_sums;
+    if (luminance_squared_sums) delete [] luminance_squared_sums;
+    if (albedos) delete [] albedos;
+    if (normals) delete [] normals;
+    if (depths) delete [] depths;
+    if (nodes) delete [] nodes;
+    if (materials) delete [] materials;
+    color_sums = new RNRgb [ npixels ];
+    luminance_sums = new RNScalar [ npixels ];
+    luminance_squared_sums = new RNScalar [ npixels ];
+    albedos = new RNRgb [ npixels ];
+    normals = new R3Vector [ npixels ];
+    depths = new RNScalar [ npixels ];
+    nodes = new R3SceneNode * [ npixels ];
+    materials = new R3Material * [ npixels ];
+  }
+
+  // Remember view
+  this->viewer = viewer;
+  this->width = viewer.Viewport().Width();
+  this->height = viewer.Viewport().Height();
+
+  // Compute vectors for camera rays (the same as R3Viewer::WorldRay)
+  const R3Camera& camera = viewer.Camera();
+  eye = camera.Origin();
+  far_origin = camera.Origin() + camera.Towards() * camera.Far();
+  far_right = camera.Right() * camera.Far() * tan(camera.XFOV());
+  far_up = camera.Up() * camera.Far() * tan(camera.YFOV());
+
+  // Clear buffers
+  nsamples = 0;
+  for (int i = 0; i < npixels; i++) {
+    color_sums[i] = RNblack_rgb;
+    luminance_sums[i] = 0;
+    luminance_squared_sums[i] = 0;
+    albedos[i] = RNblack_rgb;
+    normals[i] = R3zero_vector;
+    depths[i] = 0;
+    nodes[i] = NULL;
+    materials[i] = NULL;
+  }
+}
+
+
+
+struct R3PathTracerPass {
+  R3PathTracer *tracer;
+  int nsamples;
+};
+
+
+
+static void
+RenderTileCallback(int tile_index, int thread_index, void *data)
+{
+  // Render one tile of a pass
+  R3PathTracerPass *pass = (R3PathTracerPass *) data;
+  pass->tracer->RenderTile(tile_index, pass->nsamples);
+}
+
+
+
+int R3PathTracer::
+RenderPass(int nsamples)
+{
+  // Check viewer
+  if (!color_sums) {
+    fprintf(stderr, "Path tracer has no viewer\n");
+    return 0;
+  }
+
+  // Check number of samples
+  if (nsamples <= 0) return this->nsamples;
+
+  // Update bounding boxes before threads read them
+  scene->BBox();
+
+  // Render tiles in parallel
+  int ntiles_x = (width + tile_size - 1) / tile_size;
+  int ntiles_y = (height + tile_size - 1) / tile_size;
+  R3PathTracerPass pass;
+  pass.tracer = this;
+  pass.nsamples = nsamples;
+  RNParallelFor(ntiles_x * ntiles_y, RenderTileCallback, &pass, nthreads, 1);
+
+  // Update number of samples
+  this->nsamples += nsamples;
+
+  // Return number of samples per pixel
+  return this->nsamples;
+}
+
+
+
+int R3PathTracer::
+Render(void)
+{
+  // Start timer
+  RNTime start_time;
+  start_time.Read();
+
+  // Add one sample per pixel at a time
+  RNScalar pass_time = 0;
+  do {
+    // Check sample budget
+    if ((max_samples_per_pixel > 0) && (nsamples >= max_samples_per_pixel)) break;
+    if ((max_samples_per_pixel <= 0) && (max_time <= 0) && (nsamples > 0)) break;
+
+    // Check time budget (expect the next pass to take as long as the last one)
+    RNScalar elapsed = start_time.Elapsed();
+    if ((max_time > 0) && (pass_time > 0) && (elapsed + pass_time > max_time)) break;
+
+    // Render pass
+    if (!RenderPass(1)) return 0;
+    pass_time = start_time.Elapsed() - elapsed;
+  } while (TRUE);
+
+  // Return number of samples per pixel
+  return nsamples;
+}
+
+
+
+void R3PathTracer::
+RenderTile(int tile_index, int nsamples)
+{
+  // Get pixel range of tile
+  int ntiles_x = (width + tile_size - 1) / tile_size;
+  int ix0 = (tile_index % ntiles_x) * tile_size;
+  int iy0 = (tile_index / ntiles_x) * tile_size;
+  int ix1 = (ix0 + tile_size < width) ? ix0 + tile_size : width;
+  int iy1 = (iy0 + tile_size < height) ? iy0 + tile_size : height;
+  const R2Viewport& viewport = viewer.Viewport();
+
+  // Trace samples for every pixel
+  for (int iy = iy0; iy < iy1; iy++) {
+    for (int ix = ix0; ix < ix1; ix++) {
+      int pixel_index = iy * width + ix;
+      for (int k = 0; k < nsamples; k++) {
+        // Seed sampler for this pixel and sample
+        int sample_index = this->nsamples + k;
+        R3PathTracerSampler sampler(seed, pixel_index, sample_index);
+
+        // Jitter position within pixel (first sample goes through the same point as R3Viewer::WorldRay)
+        RNScalar jx = (sample_index == 0) ? 0 : sampler.Next() - 0.5;
+        RNScalar jy = (sample_index == 0) ? 0 : sampler.Next() - 0.5;
+        RNScalar dx = 2.0 * (ix + jx - viewport.XCenter()) / (RNScalar) width;
+        RNScalar dy = 2.0 * (iy + jy - viewport.YCenter()) / (RNScalar) height;
+        R3Point far_point = far_origin + (far_right * dx) + (far_up * dy);
+        R3Ray ray(eye, far_point);
+
+        // Trace path
+        RNRgb color = TracePath(ray, sampler, pixel_index, (sample_index == 0));
+
+        // Accumulate sample
+        RNScalar luminance = color.Luminance();
+        color_sums[pixel_index] += color;
+        luminance_sums[pixel_index] += luminance;
+        luminance_squared_sums[pixel_index] += luminance * luminance;
+      }
+    }
+  }
+}
+
+
+
+RNRgb R3PathTracer::
+TracePath(const R3Ray& camera_ray, R3PathTracerSampler& sampler, int pixel_index, RNBoolean first_sample) const
+{
+  // Initialize path
+  RNRgb radiance = RNblack_rgb;
+  RNRgb throughput = RNwhite_rgb;
+  R3Ray ray = camera_ray;
+
+  // Follow path through scene
+  for (int depth = 0; depth <= max_depth; depth++) {
+    // Find next hit
+    R3SceneNode *node = NULL;
+    R3Material *material = NULL;
+    R3Point point;
+    R3Vector normal;
+    RNScalar t;
+    if (!scene->Intersects(ray, &node, &material, NULL, &point, &normal, &t)) {
+      if (depth == 0) radiance += scene->Background();
+      break;
+    }
+
+    // Get material properties
+    const R3Brdf *brdf = (material) ? material->Brdf() : NULL;
+    if (!brdf) brdf = &R3default_brdf;
+    const RNRgb& Dc = brdf->Diffuse();
+    const RNRgb& Sc = brdf->Specular();
+    const RNRgb& Tc = brdf->Transmission();
+    RNScalar s = brdf->Shininess();
+
+    // Make normal face the incoming ray
+    normal.Normalize();
+    R3Vector V = -(ray.Vector());
+    if (normal.Dot(V) < 0) normal.Flip();
+
+    // Remember arbitrary output variables at pixel center
+    if ((depth == 0) && first_sample) {
+      const R3Camera& camera = viewer.Camera();
+      albedos[pixel_index] = Dc;
+      normals[pixel_index] = normal;
+      depths[pixel_index] = (point - camera.Origin()).Dot(camera.Towards());
+      nodes[pixel_index] = node;
+      materials[pixel_index] = material;
+    }
+
+    // Add emission and direct lighting
+    radiance += throughput * brdf->Emission();
+    radiance += throughput * DirectLighting(brdf, point, normal, V, sampler);
+    if (depth == max_depth) break;
+
+    // Choose lobe for next direction with probability proportional to albedo
+    // (the remaining probability terminates the path)
+    RNScalar pd = Dc.Luminance();
+    RNScalar ps = Sc.Luminance();
+    RNScalar pt = (brdf->IsTransparent()) ? Tc.Luminance() : 0.0;
+    RNScalar sum = pd + ps + pt;
+    if (sum > 1.0) { pd /= sum; ps /= sum; pt /= sum; }
+    RNScalar u = sampler.Next();
+    RNScalar u1 = sampler.Next();
+    RNScalar u2 = sampler.Next();
+    RNScalar offset = RayOffset(point);
+    if (u < pd) {
+      // Sample cosine-weighted diffuse lobe
+      R3Vector L = SampleDirection(normal, sqrt(1.0 - u1), RN_TWO_PI * u2);
+      throughput *= Dc / pd;
+      ray = R3Ray(point + offset * normal, L, TRUE);
+    }
+    else if (u < pd + ps) {
+      // Sample Phong lobe around mirror direction
+      R3Vector R = 2.0 * normal.Dot(V) * normal - V;
+      R3Vector L = SampleDirection(R, pow(u1, 1.0 / (s + 1.0)), RN_TWO_PI * u2);
+      RNScalar NL = normal.Dot(L);
+      if (NL <= 0) break;
+      throughput *= Sc * ((s + 2.0) / (s + 1.0) * NL / ps);
+      ray = R3Ray(point + offset * normal, L, TRUE);
+    }
+    else if (u < pd + ps + pt) {
+      // Pass straight through transparent surface
+      throughput *= Tc / pt;
+      ray = R3Ray(point - offset * normal, ray.Vector(), TRUE);
+    }
+    else {
+      // Absorb
+      break;
+    }
+  }
+
+  // Return radiance along camera ray
+  return radiance;
+}
+
+
+
+RNRgb R3PathTracer::
+DirectLighting(const R3Brdf *brdf, const R3Point& point, const R3Vector& normal,
+  const R3Vector& V, R3PathTracerSampler& sampler) const
+{
+  // Light intensities are irradiances here, as in R3Light::Reflection, so that
+  // a white diffuse surface facing a light of intensity 1 reflects radiance 1
+  const RNRgb& Dc = brdf->Diffuse();
+  const RNRgb& Sc = brdf->Specular();
+  RNScalar s = brdf->Shininess();
+  RNBoolean specular = brdf->IsSpecular();
+  R3Vector R = 2.0 * normal.Dot(V) * normal - V;
+  R3Point origin = point + RayOffset(point) * normal;
+
+  // Sum contributions of lights
+  RNRgb sum = RNblack_rgb;
+  for (int i = 0; i < scene->NLights(); i++) {
+    R3Light *light = scene->Light(i);
+    if (!light->IsActive()) continue;
+
+    // Sample direction, distance, and intensity of light
+    R3Vector L;
+    RNScalar max_t;
+    RNScalar I;
+    if (light->ClassID() == R3DirectionalLight::CLASS_ID()) {
+      R3DirectionalLight *directional_light = (R3DirectionalLight *) light;
+      L = -(directional_light->Direction());
+      L.Normalize();
+      max_t = RN_INFINITY;
+      I = directional_light->IntensityAtPoint(point);
+    }
+    else if ((light->ClassID() == R3PointLight::CLASS_ID()) || (light->ClassID() == R3SpotLight::CLASS_ID())) {
+      R3PointLight *point_light = (R3PointLight *) light;
+      L = point_light->Position() - point;
+      max_t = L.Length();
+      if (RNIsZero(max_t)) continue;
+      L /= max_t;
+      I = point_light->IntensityAtPoint(point);
+    }
+    else if (light->ClassID() == R3AreaLight::CLASS_ID()) {
+      // Sample point on disk uniformly
+      R3AreaLight *area_light = (R3AreaLight *) light;
+      const R3Vector& direction = area_light->Direction();
+      RNScalar r = area_light->Radius() * sqrt(sampler.Next());
+      R3Vector offset = SampleDirection(direction, 0.0, RN_TWO_PI * sampler.Next());
+      R3Point light_point = area_light->Position() + r * offset;
+      L = light_point - point;
+      max_t = L.Length();
+      if (RNIsZero(max_t)) continue;
+      L /= max_t;
+
+      // Compute intensity as in R3AreaLight::IntensityAtPoint
+      RNScalar cos_light = -(direction.Dot(L));
+      if (cos_light <= 0) continue;
+      RNScalar denom = area_light->ConstantAttenuation();
+      denom += max_t * area_light->LinearAttenuation();
+      denom += max_t * max_t * area_light->QuadraticAttenuation();
+      I = area_light->Intensity() * cos_light;
+      if (RNIsPositive(denom)) I /= denom;
+      I *= RN_PI * area_light->Radius() * area_light->Radius();
+    }
+    else {
+      continue;
+    }
+
+    // Evaluate reflection
+    if (I <= 0) continue;
+    RNScalar NL = normal.Dot(L);
+    if (NL <= 0) continue;
+    RNRgb reflectance = Dc;
+    if (specular) {
+      RNScalar RL = R.Dot(L);
+      if (RL > 0) reflectance += Sc * (0.5 * (s + 2.0) * pow(RL, s));
+    }
+    RNRgb contribution = (I * NL) * reflectance * light->Color();
+    if (contribution.Luminance() <= 0) continue;
+
+    // Trace shadow ray
+    if (max_t < RN_INFINITY) max_t -= RayOffset(point);
+    contribution *= Transmittance(origin, L, max_t);
+    sum += contribution;
+  }
+
+  // Return sum of contributions
+  return sum;
+}
+
+
+
+RNRgb R3PathTracer::
+Transmittance(const R3Point& point, const R3Vector& direction, RNScalar max_t) const
+{
+  // Parameter
+  const int max_surfaces = 8;
+
+  // Pass through transparent surfaces until reach max_t
+  RNRgb transmittance = RNwhite_rgb;
+  R3Point origin = point;
+  for (int i = 0; i < max_surfaces; i++) {
+    R3Material *material = NULL;
+    R3Point hit_point;
+    RNScalar t;
+    R3Ray ray(origin, direction, TRUE);
+    if (!scene->Intersects(ray, NULL, &material, NULL, &hit_point, NULL, &t, 0, max_t)) return transmittance;
+    const R3Brdf *brdf = (material) ? material->Brdf() : NULL;
+    if (!brdf || !brdf->IsTransparent()) return RNblack_rgb;
+    transmittance *= brdf->Transmission();
+    if (transmittance.Luminance() <= 0) return RNblack_rgb;
+    RNScalar offset = RayOffset(hit_point);
+    origin = hit_point + offset * direction;
+    if (max_t < RN_INFINITY) max_t -= t + offset;
+    if (max_t <= 0) return transmittance;
+  }
+
+  // Too many surfaces
+  return RNblack_rgb;
+}
+
+
+
+RNRgb R3PathTracer::
+PixelColor(int ix, int iy) const
+{
+  // Return mean of samples
+  if (nsamples == 0) return RNblack_rgb;
+  return color_sums[iy * width + ix] / nsamples;
+}
+
+
+
+RNScalar R3PathTracer::
+PixelVariance(int ix, int iy) const
+{
+  // Return variance of the mean luminance
+  if (nsamples < 2) return 0;
+  int pixel_index = iy * width + ix;
+  RNScalar mean = luminance_sums[pixel_index] / nsamples;
+  RNScalar variance = (luminance_squared_sums[pixel_index] - nsamples * mean * mean) / (nsamples - 1);
+  if (variance < 0) variance = 0;
+  return variance / nsamples;
+}
+
+
+
+RNRgb R3PathTracer::
+PixelAlbedo(int ix, int iy) const
+{
+  // Return diffuse color of surface at pixel center
+  return albedos[iy * width + ix];
+}
+
+
+
+R3Vector R3PathTracer::
+PixelNormal(int ix, int iy) const
+{
+  // Return normal of surface at pixel center (facing the camera)
+  return normals[iy * width + ix];
+}
+
+
+
+RNScalar R3PathTracer::
+PixelDepth(int ix, int iy) const
+{
+  // Return depth of surface at pixel center
+  return depths[iy * width + ix];
+}
+
+
+
+R3SceneNode *R3PathTracer::
+PixelNode(int ix, int iy) const
+{
+  // Return node at pixel center
+  return nodes[iy * width + ix];
+}
+
+
+
+R3Material *R3PathTracer::
+PixelMaterial(int ix, int iy) const
+{
+  // Return material at pixel center
+  return materials[iy * width + ix];
+}
+
+
+
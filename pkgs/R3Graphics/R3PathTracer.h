@@ -0,0 +1,262 @@
+/* Include file for the R3 path tracer class */
+
+
+
+/* Class declarations */
+
+struct R3PathTracerSampler;
+
+
+
+/* Class definition */
+
+class R3PathTracer {
+public:
+  // Constructor functions
+  R3PathTracer(R3Scene *scene);
+  ~R3PathTracer(void);
+
+  // Property functions
+  R3Scene *Scene(void) const;
+  const R3Viewer& Viewer(void) const;
+  int Width(void) const;
+  int Height(void) const;
+  int NSamples(void) const;
+
+  // Parameter access functions
+  int MaxSamplesPerPixel(void) const;
+  RNScalar MaxTime(void) const;
+  int MaxDepth(void) const;
+  int TileSize(void) const;
+  int NThreads(void) const;
+  unsigned int Seed(void) const;
+
+  // Parameter manipulation functions
+  void SetMaxSamplesPerPixel(int nsamples);
+    // Render() stops after this many samples per pixel (0 means no limit if there is a time budget)
+  void SetMaxTime(RNScalar seconds);
+    // Render() does not start a pass that is expected to end after this many seconds (0 means no limit)
+  void SetMaxDepth(int nbounces);
+    // Number of indirect bounces after the first hit (0 means direct lighting only)
+  void SetTileSize(int npixels);
+  void SetNThreads(int nthreads);
+  void SetSeed(unsigned int seed);
+    // Every sample of every pixel is seeded from this, so images do not depend on tiles or threads
+
+  // Rendering functions
+  void Reset(const R3Viewer& viewer);
+    // Clears accumulated samples and sets the camera and image size (from the viewport)
+  int Render(void);
+    // Adds passes until max samples per pixel or the time budget is reached, returns samples per pixel
+  int RenderPass(int nsamples = 1);
+    // Adds nsamples samples to every pixel, returns samples per pixel
+
+  // Output functions (arbitrary output variables are taken at pixel centers)
+  RNRgb PixelColor(int ix, int iy) const;
+  RNScalar PixelVariance(int ix, int iy) const;
+    // Variance of the mean luminance of the pixel (0 with fewer than two samples)
+  RNRgb PixelAlbedo(int ix, int iy) const;
+  R3Vector PixelNormal(int ix, int iy) const;
+  RNScalar PixelDepth(int ix, int iy) const;
+    // Distance along the camera view direction (0 where nothing was hit)
+  R3SceneNode *PixelNode(int ix, int iy) const;
+  R3Material *PixelMaterial(int ix, int iy) const;
+
+public:
+  // Internal functions
+  void RenderTile(int tile_index, int nsamples);
+  RNRgb TracePath(const R3Ray& ray, R3PathTracerSampler& sampler, int pixel_index, RNBoolean first_sample) const;
+  RNRgb DirectLighting(const R3Brdf *brdf, const R3Point& point, const R3Vector& normal,
+    const R3Vector& view_direction, R3PathTracerSampler& sampler) const;
+  RNRgb Transmittance(const R3Point& point, const R3Vector& direction, RNScalar max_t) const;
+
+private:
+  // Scene and view
+  R3Scene *scene;
+  R3Viewer viewer;
+  int width, height;
+  R3Point eye;
+  R3Point far_origin;
+  R3Vector far_right, far_up;
+
+  // Parameters
+  int max_samples_per_pixel;
+  RNScalar max_time;
+  int max_depth;
+  int tile_size;
+  int nthreads;
+  unsigned int seed;
+
+  // Accumulated samples
+  int nsamples;
+  RNRgb *color_sums;
+  RNScalar *luminance_sums;
+  RNScalar *luminance_squared_sums;
+
+  // Arbitrary output variables
+  RNRgb *albedos;
+  R3Vector *normals;
+  RNScalar *depths;
+  R3SceneNode **nodes;
+  R3Material **materials;
+};
+
+
+
+/* Inline functions */
+
+inline R3Scene *R3PathTracer::
+Scene(void) const
+{
+  // Return scene
+  return scene;
+}
+
+
+
+inline const R3Viewer& R3PathTracer::
+Viewer(void) const
+{
+  // Return viewer
+  return viewer;
+}
+
+
+
+inline int R3PathTracer::
+Width(void) const
+{
+  // Return image width
+  return width;
+}
+
+
+
+inline int R3PathTracer::
+Height(void) const
+{
+  // Return image height
+  return height;
+}
+
+
+
+inline int R3PathTracer::
+NSamples(void) const
+{
+  // Return number of samples accumulated in every pixel
+  return nsamples;
+}
+
+
+
+inline int R3PathTracer::
+MaxSamplesPerPixel(void) const
+{
+  // Return sample budget
+  return max_samples_per_pixel;
+}
+
+
+
+inline RNScalar R3PathTracer::
+MaxTime(void) const
+{
+  // Return time budget in seconds
+  return max_time;
+}
+
+
+
+inline int R3PathTracer::
+MaxDepth(void) const
+{
+  // Return number of indirect bounces
+  return max_depth;
+}
+
+
+
+inline int R3PathTracer::
+TileSize(void) const
+{
+  // Return width and height of tiles
+  return tile_size;
+}
+
+
+
+inline int R3PathTracer::
+NThreads(void) const
+{
+  // Return number of threads (0 means one per processor)
+  return nthreads;
+}
+
+
+
+inline unsigned int R3PathTracer::
+Seed(void) const
+{
+  // Return random seed
+  return seed;
+}
+
+
+
+inline void R3PathTracer::
+SetMaxSamplesPerPixel(int nsamples)
+{
+  // Set sample budget
+  this->max_samples_per_pixel = nsamples;
+}
+
+
+
+inline void R3PathTracer::
+SetMaxTime(RNScalar seconds)
+{
+  // Set time budget in seconds
+  this->max_time = seconds;
+}
+
+
+
+inline void R3PathTracer::
+SetMaxDepth(int nbounces)
+{
+  // Set number of indirect bounces
+  if (nbounces < 0) nbounces = 0;
+  this->max_depth = nbounces;
+}
+
+
+
+inline void R3PathTracer::
+SetTileSize(int npixels)
+{
+  // Set width and height of tiles
+  if (npixels < 1) npixels = 1;
+  this->tile_size = npixels;
+}
+
+
+
+inline void R3PathTracer::
+SetNThreads(int nthreads)
+{
+  // Set number of threads (0 means one per processor)
+  this->nthreads = nthreads;
+}
+
+
+
+inline void R3PathTracer::
+SetSeed(unsigned int seed)
+{
+  // Set random seed
+  this->seed = seed;
+}
+
+
+
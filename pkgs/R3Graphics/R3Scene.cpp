@@ -734,6 +734,33 @@ Intersects(const R3Ray& ray,
 
 
 
+void R3Scene::
+ComputeNodeOverlaps(const R3Grid& grid, RNArea *overlap_areas, RNArea *total_areas, RNScalar min_value) const
+{
+  // Compute overlaps with grid cells above min_value
+  root->ComputeOverlapAreas(R3identity_affine, &grid, min_value, NULL, NULL, overlap_areas, total_areas);
+}
+
+
+
+void R3Scene::
+ComputeNodeOverlaps(const R3Box& box, RNArea *overlap_areas, RNArea *total_areas) const
+{
+  // Compute overlaps with box
+  root->ComputeOverlapAreas(R3identity_affine, NULL, 0, &box, NULL, overlap_areas, total_areas);
+}
+
+
+
+void R3Scene::
+ComputeNodeOverlaps(const R3Frustum& frustum, RNArea *overlap_areas, RNArea *total_areas) const
+{
+  // Compute overlaps with frustum
+  root->ComputeOverlapAreas(R3identity_affine, NULL, 0, NULL, &frustum, overlap_areas, total_areas);
+}
+
+
+
 int R3Scene::
 LoadLights(int min_index, int max_index) const
 {
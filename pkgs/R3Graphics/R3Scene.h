@@ -97,6 +97,15 @@ public:
     R3Point *hit_point = NULL, R3Vector *hit_normal = NULL, RNScalar *hit_t = NULL,
     RNScalar min_t = 0.0, RNScalar max_t = RN_INFINITY) const;
 
+  // Overlap functions (arrays are indexed by node SceneIndex)
+  void ComputeNodeOverlaps(const R3Grid& grid, RNArea *overlap_areas, RNArea *total_areas = NULL,
+    RNScalar min_value = RN_EPSILON) const;
+  void ComputeNodeOverlaps(const R3Box& box, RNArea *overlap_areas, RNArea *total_areas = NULL) const;
+  void ComputeNodeOverlaps(const R3Frustum& frustum, RNArea *overlap_areas, RNArea *total_areas = NULL) const;
+    // Fill triangle area of the subtree of every node and the part of it inside the region
+    // (where grid values are above min_value), counting every triangle, including those of
+    // referenced scenes, whose centroid is inside, using cached node statistics in one pass
+
   // I/O functions
   int ReadFile(const char *filename, R3SceneNode *parent_node = NULL);
   int ReadObjFile(const char *filename, R3SceneNode *parent_node = NULL);
@@ -12,6 +12,49 @@
 
 
 
+////////////////////////////////////////////////////////////////////////
+// STATISTICS DEFINITIONS
+////////////////////////////////////////////////////////////////////////
+
+struct R3SceneNodeStatistics {
+  // Constructor functions
+  R3SceneNodeStatistics(void);
+  ~R3SceneNodeStatistics(void);
+
+  // Triangles of subtree
+  int ntriangles;
+  RNArea area;
+
+  // Triangle centroids of elements (in node coordinates, before transformation)
+  int nelement_samples;
+  R3Point *element_sample_positions;
+  RNArea *element_sample_areas;
+};
+
+
+
+R3SceneNodeStatistics::
+R3SceneNodeStatistics(void)
+  : ntriangles(0),
+    area(0),
+    nelement_samples(0),
+    element_sample_positions(NULL),
+    element_sample_areas(NULL)
+{
+}
+
+
+
+R3SceneNodeStatistics::
+~R3SceneNodeStatistics(void)
+{
+  // Delete samples
+  if (element_sample_positions) delete [] element_sample_positions;
+  if (element_sample_areas) delete [] element_sample_areas;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // PKG INITIALIZATION FUNCTIONS
 ////////////////////////////////////////////////////////////////////////
@@ -48,6 +91,8 @@ R3SceneNode(R3Scene *scene)
     info(),
     transformation(R3identity_affine),
     bbox(FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX),
+    world_bbox(FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX),
+    statistics(NULL),
     name(NULL),
     data(NULL)
 {
@@ -71,6 +116,8 @@ R3SceneNode(const R3SceneNode& node)
     info(node.info),
     transformation(node.transformation),
     bbox(FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX),
+    world_bbox(FLT_MAX, FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX),
+    statistics(NULL),
     name((node.name) ? strdup(node.name) : NULL),
     data(NULL)
 {
@@ -109,6 +156,9 @@ R3SceneNode::
     scene->RemoveNode(this);
   }
 
+  // Delete statistics
+  if (statistics) delete statistics;
+
   // Delete name
   if (name) free(name);
 }
@@ -279,6 +329,9 @@ WorldBBox(void) const
   // Note that BBox() returns bounding box after xform (in parent's coordinate frame)
   // Note that this bbox will be over-estimating, since it is a transformed AABB
 
+  // Check cached box
+  if (world_bbox[0][0] != FLT_MAX) return world_bbox;
+
   // Start for bbox in parent's coordinate frame
   R3Box box = BBox();
 
@@ -289,8 +342,11 @@ WorldBBox(void) const
     ancestor = ancestor->Parent();
   }
 
+  // Remember box until this node, an ancestor, or the subtree changes
+  ((R3SceneNode *) this)->world_bbox = box;
+
   // Return box;
-  return bbox;
+  return box;
 }
 
 
@@ -397,6 +453,24 @@ CumulativeParentTransformation(void) const
 
 
 
+int R3SceneNode::
+NTriangles(void) const
+{
+  // Return number of triangles in subtree
+  return Statistics()->ntriangles;
+}
+
+
+
+RNArea R3SceneNode::
+TriangleArea(void) const
+{
+  // Return area of triangles in subtree
+  return Statistics()->area;
+}
+
+
+
 void R3SceneNode::
 InsertChild(R3SceneNode *node) 
 {
@@ -411,7 +485,8 @@ InsertChild(R3SceneNode *node)
   node->parent_index = children.NEntries();
   children.Insert(node);
 
-  // Invalidate bounding box
+  // Invalidate bounding boxes
+  node->InvalidateWorldBBox();
   InvalidateBBox();
 }
 
@@ -431,7 +506,8 @@ RemoveChild(R3SceneNode *node)
   node->parent = NULL;
   node->parent_index = -1;
 
-  // Invalidate bounding box
+  // Invalidate bounding boxes
+  node->InvalidateWorldBBox();
   InvalidateBBox();
 }
 
@@ -526,7 +602,8 @@ SetTransformation(const R3Affine& transformation)
   // Set transformation
   this->transformation = transformation;
 
-  // Invalidate bounding box
+  // Invalidate bounding boxes
+  InvalidateWorldBBox();
   InvalidateBBox();
 }
 
@@ -538,7 +615,8 @@ Transform(const R3Affine& transformation)
   // Set transformation
   this->transformation.Transform(transformation);
 
-  // Invalidate bounding box
+  // Invalidate bounding boxes
+  InvalidateWorldBBox();
   InvalidateBBox();
 }
 
@@ -837,6 +915,13 @@ InvalidateBBox(void)
 {
   // Invalidate bounding box
   bbox[0][0] = FLT_MAX;
+  world_bbox[0][0] = FLT_MAX;
+
+  // Invalidate statistics
+  if (statistics) {
+    delete statistics;
+    statistics = NULL;
+  }
 
   // Invalidate parent's bounding box
   if (parent) parent->InvalidateBBox();
@@ -844,3 +929,193 @@ InvalidateBBox(void)
 
 
 
+void R3SceneNode::
+InvalidateWorldBBox(void)
+{
+  // Invalidate world bounding box
+  world_bbox[0][0] = FLT_MAX;
+
+  // Invalidate world bounding boxes of children
+  for (int i = 0; i < children.NEntries(); i++) {
+    R3SceneNode *child = children.Kth(i);
+    child->InvalidateWorldBBox();
+  }
+}
+
+
+
+R3SceneNodeStatistics *R3SceneNode::
+Statistics(void) const
+{
+  // Compute counts and element samples
+  if (!statistics) {
+    R3SceneNodeStatistics *s = new R3SceneNodeStatistics();
+
+    // Count triangles of elements
+    for (int i = 0; i < elements.NEntries(); i++) {
+      R3SceneElement *element = elements.Kth(i);
+      for (int j = 0; j < element->NShapes(); j++) {
+        R3Shape *shape = element->Shape(j);
+        if (shape->ClassID() != R3TriangleArray::CLASS_ID()) continue;
+        s->nelement_samples += ((R3TriangleArray *) shape)->NTriangles();
+      }
+    }
+
+    // Fill element samples with triangle centroids
+    if (s->nelement_samples > 0) {
+      s->element_sample_positions = new R3Point [ s->nelement_samples ];
+      s->element_sample_areas = new RNArea [ s->nelement_samples ];
+      int count = 0;
+      for (int i = 0; i < elements.NEntries(); i++) {
+        R3SceneElement *element = elements.Kth(i);
+        for (int j = 0; j < element->NShapes(); j++) {
+          R3Shape *shape = element->Shape(j);
+          if (shape->ClassID() != R3TriangleArray::CLASS_ID()) continue;
+          R3TriangleArray *triangles = (R3TriangleArray *) shape;
+          for (int k = 0; k < triangles->NTriangles(); k++) {
+            R3Triangle *triangle = triangles->Triangle(k);
+            s->element_sample_positions[count] = triangle->Centroid();
+            s->element_sample_areas[count] = triangle->Area();
+            s->area += s->element_sample_areas[count];
+            count++;
+          }
+        }
+      }
+    }
+    s->ntriangles = s->nelement_samples;
+
+    // Add triangles of referenced scenes
+    for (int i = 0; i < references.NEntries(); i++) {
+      R3Scene *referenced_scene = references.Kth(i)->ReferencedScene();
+      if (!referenced_scene) continue;
+      R3SceneNode *root = referenced_scene->Root();
+      s->ntriangles += root->NTriangles();
+      s->area += root->TriangleArea();
+    }
+
+    // Add triangles of children
+    for (int i = 0; i < children.NEntries(); i++) {
+      R3SceneNode *child = children.Kth(i);
+      s->ntriangles += child->NTriangles();
+      s->area += child->TriangleArea();
+    }
+
+    // Remember statistics
+    ((R3SceneNode *) this)->statistics = s;
+  }
+
+  // Return statistics
+  return statistics;
+}
+
+
+
+static int
+ClassifyOverlapBox(const R3Box& world_box,
+  const R3Grid *grid, const R3Box *box, const R3Frustum *frustum)
+{
+  // Return -1 if box is outside the query region, 1 if inside, and 0 otherwise
+  if (world_box.IsEmpty()) return -1;
+  if (grid) {
+    if (!R3Intersects(world_box, grid->WorldBox())) return -1;
+  }
+  else if (box) {
+    if (!R3Intersects(world_box, *box)) return -1;
+    if (R3Contains(*box, world_box)) return 1;
+  }
+  else if (frustum) {
+    if (!frustum->Intersects(world_box)) return -1;
+    if (frustum->Contains(world_box)) return 1;
+  }
+  return 0;
+}
+
+
+
+static RNBoolean
+ContainsOverlapPoint(const R3Point& world_point,
+  const R3Grid *grid, RNScalar min_value, const R3Box *box, const R3Frustum *frustum)
+{
+  // Return whether point is inside the query region
+  if (grid) return (grid->WorldValue(world_point) > min_value) ? TRUE : FALSE;
+  else if (box) return R3Contains(*box, world_point);
+  else if (frustum) return frustum->Contains(world_point);
+  return FALSE;
+}
+
+
+
+static void
+FillOverlapAreas(const R3SceneNode *node, RNBoolean inside,
+  RNArea *overlap_areas, RNArea *total_areas)
+{
+  // Check if results are needed (not for nodes of referenced scenes)
+  if (!overlap_areas && !total_areas) return;
+
+  // Set overlap of subtree that is entirely inside or outside the query region
+  RNArea area = node->TriangleArea();
+  if (overlap_areas) overlap_areas[node->SceneIndex()] = (inside) ? area : 0.0;
+  if (total_areas) total_areas[node->SceneIndex()] = area;
+  for (int i = 0; i < node->NChildren(); i++) {
+    FillOverlapAreas(node->Child(i), inside, overlap_areas, total_areas);
+  }
+}
+
+
+
+RNArea R3SceneNode::
+ComputeOverlapAreas(const R3Affine& parent_transformation,
+  const R3Grid *grid, RNScalar min_value, const R3Box *box, const R3Frustum *frustum,
+  RNArea *overlap_areas, RNArea *total_areas) const
+{
+  // Check whether the whole subtree is inside or outside the query region
+  R3Box world_box = BBox();
+  world_box.Transform(parent_transformation);
+  int classification = ClassifyOverlapBox(world_box, grid, box, frustum);
+  if (classification != 0) {
+    FillOverlapAreas(this, (classification > 0), overlap_areas, total_areas);
+    return (classification > 0) ? TriangleArea() : 0.0;
+  }
+
+  // Update transformation
+  R3Affine node_transformation = R3identity_affine;
+  node_transformation.Transform(parent_transformation);
+  node_transformation.Transform(transformation);
+
+  // Sum overlapping areas of element triangles
+  RNArea overlap_area = 0;
+  R3SceneNodeStatistics *s = Statistics();
+  for (int i = 0; i < s->nelement_samples; i++) {
+    R3Point position = s->element_sample_positions[i];
+    position.Transform(node_transformation);
+    if (!ContainsOverlapPoint(position, grid, min_value, box, frustum)) continue;
+    overlap_area += s->element_sample_areas[i];
+  }
+
+  // Sum overlapping areas of referenced scenes (traversing their nodes without filling results,
+  // since those are indexed by nodes of the referenced scene)
+  for (int i = 0; i < references.NEntries(); i++) {
+    R3Scene *referenced_scene = references.Kth(i)->ReferencedScene();
+    if (!referenced_scene) continue;
+    R3SceneNode *root = referenced_scene->Root();
+    overlap_area += root->ComputeOverlapAreas(node_transformation,
+      grid, min_value, box, frustum, NULL, NULL);
+  }
+
+  // Sum overlapping areas of children
+  for (int i = 0; i < children.NEntries(); i++) {
+    R3SceneNode *child = children.Kth(i);
+    overlap_area += child->ComputeOverlapAreas(node_transformation,
+      grid, min_value, box, frustum, overlap_areas, total_areas);
+  }
+
+  // Fill result for this node
+  if (overlap_areas) overlap_areas[scene_index] = overlap_area;
+  if (total_areas) total_areas[scene_index] = TriangleArea();
+
+  // Return overlapping area of subtree
+  return overlap_area;
+}
+
+
+
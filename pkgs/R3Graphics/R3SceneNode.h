@@ -9,6 +9,12 @@ void R3StopSceneNode();
 
 
 
+/* Statistics definitions */
+
+struct R3SceneNodeStatistics;
+
+
+
 /* Class definition */
 
 class R3SceneNode {
@@ -38,6 +44,11 @@ public:
   R3Affine CumulativeParentTransformation(void) const;
   R3Point ClosestPoint(const R3Point& point) const;
 
+  // Statistics functions (cached until the subtree changes, shared by all references to a scene)
+  int NTriangles(void) const;
+  RNArea TriangleArea(void) const;
+    // Triangles of elements, children, and referenced scenes (areas are measured in element coordinates)
+
   // Access functions
   R3Scene *Scene(void) const;
   int SceneIndex(void) const;
@@ -88,6 +99,11 @@ public:
   // Internal update functions
   void UpdateBBox(void);
   void InvalidateBBox(void);
+  void InvalidateWorldBBox(void);
+  R3SceneNodeStatistics *Statistics(void) const;
+  RNArea ComputeOverlapAreas(const R3Affine& parent_transformation,
+    const R3Grid *grid, RNScalar min_value, const R3Box *box, const R3Frustum *frustum,
+    RNArea *overlap_areas, RNArea *total_areas) const;
 
 private:
   friend class R3Scene;
@@ -101,6 +117,8 @@ private:
   RNSymbolTable<const char *> info;
   R3Affine transformation;
   R3Box bbox;
+  R3Box world_bbox;
+  R3SceneNodeStatistics *statistics;
   char *name;
   void *data;
 };
@@ -0,0 +1,669 @@
+/* Source file for GAPS batched distance and intersection utility */
+
+
+
+/* Include files */
+
+#include "R3Shapes/R3Shapes.h"
+#if defined(__AVX__)
+#  include <immintrin.h>
+#  define R3_BATCH_AVX
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#  include <emmintrin.h>
+#  define R3_BATCH_SSE
+#endif
+
+
+
+/* Private variables */
+
+#if defined(R3_BATCH_AVX)
+static int R3batch_kernels = R3_BATCH_AVX_KERNELS;
+#elif defined(R3_BATCH_SSE)
+static int R3batch_kernels = R3_BATCH_SSE_KERNELS;
+#else
+static int R3batch_kernels = R3_BATCH_SCALAR_KERNELS;
+#endif
+
+
+
+/* Lane types (every kernel is written once in terms of these operations) */
+
+template <class T>
+struct R3BatchScalar {
+  typedef T Real;
+  typedef T Vec;
+  typedef bool Mask;
+  enum { NLANES = 1 };
+  static Vec Load(const T *p) { return *p; }
+  static void Store(T *p, Vec a) { *p = a; }
+  static Vec Set(T a) { return a; }
+  static Vec Add(Vec a, Vec b) { return a + b; }
+  static Vec Sub(Vec a, Vec b) { return a - b; }
+  static Vec Mul(Vec a, Vec b) { return a * b; }
+  static Vec Div(Vec a, Vec b) { return a / b; }
+  static Vec Min(Vec a, Vec b) { return (a < b) ? a : b; }
+  static Vec Max(Vec a, Vec b) { return (a > b) ? a : b; }
+  static Vec Sqrt(Vec a) { return sqrt(a); }
+  static Mask Less(Vec a, Vec b) { return a < b; }
+  static Mask LessEqual(Vec a, Vec b) { return a <= b; }
+  static Mask And(Mask a, Mask b) { return a && b; }
+  static bool Any(Mask m) { return m; }
+  static Vec Select(Mask m, Vec a, Vec b) { return (m) ? a : b; }
+};
+
+#ifdef R3_BATCH_SSE
+
+template <class T> struct R3BatchSSE;
+
+template <>
+struct R3BatchSSE<float> {
+  typedef float Real;
+  typedef __m128 Vec;
+  typedef __m128 Mask;
+  enum { NLANES = 4 };
+  static Vec Load(const float *p) { return _mm_loadu_ps(p); }
+  static void Store(float *p, Vec a) { _mm_storeu_ps(p, a); }
+  static Vec Set(float a) { return _mm_set1_ps(a); }
+  static Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+  static Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+  static Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+  static Vec Div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+  static Vec Min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+  static Vec Max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+  static Vec Sqrt(Vec a) { return _mm_sqrt_ps(a); }
+  static Mask Less(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+  static Mask LessEqual(Vec a, Vec b) { return _mm_cmple_ps(a, b); }
+  static Mask And(Mask a, Mask b) { return _mm_and_ps(a, b); }
+  static bool Any(Mask m) { return _mm_movemask_ps(m) != 0; }
+  static Vec Select(Mask m, Vec a, Vec b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+};
+
+template <>
+struct R3BatchSSE<double> {
+  typedef double Real;
+  typedef __m128d Vec;
+  typedef __m128d Mask;
+  enum { NLANES = 2 };
+  static Vec Load(const double *p) { return _mm_loadu_pd(p); }
+  static void Store(double *p, Vec a) { _mm_storeu_pd(p, a); }
+  static Vec Set(double a) { return _mm_set1_pd(a); }
+  static Vec Add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+  static Vec Sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+  static Vec Mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+  static Vec Div(Vec a, Vec b) { return _mm_div_pd(a, b); }
+  static Vec Min(Vec a, Vec b) { return _mm_min_pd(a, b); }
+  static Vec Max(Vec a, Vec b) { return _mm_max_pd(a, b); }
+  static Vec Sqrt(Vec a) { return _mm_sqrt_pd(a); }
+  static Mask Less(Vec a, Vec b) { return _mm_cmplt_pd(a, b); }
+  static Mask LessEqual(Vec a, Vec b) { return _mm_cmple_pd(a, b); }
+  static Mask And(Mask a, Mask b) { return _mm_and_pd(a, b); }
+  static bool Any(Mask m) { return _mm_movemask_pd(m) != 0; }
+  static Vec Select(Mask m, Vec a, Vec b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+};
+
+#endif
+
+#ifdef R3_BATCH_AVX
+
+template <class T> struct R3BatchAVX;
+
+template <>
+struct R3BatchAVX<float> {
+  typedef float Real;
+  typedef __m256 Vec;
+  typedef __m256 Mask;
+  enum { NLANES = 8 };
+  static Vec Load(const float *p) { return _mm256_loadu_ps(p); }
+  static void Store(float *p, Vec a) { _mm256_storeu_ps(p, a); }
+  static Vec Set(float a) { return _mm256_set1_ps(a); }
+  static Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+  static Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+  static Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+  static Vec Div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+  static Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+  static Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+  static Vec Sqrt(Vec a) { return _mm256_sqrt_ps(a); }
+  static Mask Less(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static Mask LessEqual(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+  static Mask And(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+  static bool Any(Mask m) { return _mm256_movemask_ps(m) != 0; }
+  static Vec Select(Mask m, Vec a, Vec b) { return _mm256_blendv_ps(b, a, m); }
+};
+
+template <>
+struct R3BatchAVX<double> {
+  typedef double Real;
+  typedef __m256d Vec;
+  typedef __m256d Mask;
+  enum { NLANES = 4 };
+  static Vec Load(const double *p) { return _mm256_loadu_pd(p); }
+  static void Store(double *p, Vec a) { _mm256_storeu_pd(p, a); }
+  static Vec Set(double a) { return _mm256_set1_pd(a); }
+  static Vec Add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+  static Vec Sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+  static Vec Mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+  static Vec Div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+  static Vec Min(Vec a, Vec b) { return _mm256_min_pd(a, b); }
+  static Vec Max(Vec a, Vec b) { return _mm256_max_pd(a, b); }
+  static Vec Sqrt(Vec a) { return _mm256_sqrt_pd(a); }
+  static Mask Less(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static Mask LessEqual(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+  static Mask And(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+  static bool Any(Mask m) { return _mm256_movemask_pd(m) != 0; }
+  static Vec Select(Mask m, Vec a, Vec b) { return _mm256_blendv_pd(b, a, m); }
+};
+
+#endif
+
+
+
+/* Kernels (process primitives first, first+NLANES, ... and return index of first unprocessed one) */
+
+template <class K>
+static int
+PointBoxKernel(const typename K::Real *p, const R3BoxBatch<typename K::Real>& boxes,
+  int first, int n, typename K::Real *distances)
+{
+  // Compute distance to closest point in every box
+  typedef typename K::Vec Vec;
+  const Vec px = K::Set(p[0]), py = K::Set(p[1]), pz = K::Set(p[2]);
+  const Vec zero = K::Set(0);
+  int i = first;
+  for ( ; i + K::NLANES <= n; i += K::NLANES) {
+    Vec dx = K::Max(K::Max(K::Sub(K::Load(boxes.xmin + i), px), K::Sub(px, K::Load(boxes.xmax + i))), zero);
+    Vec dy = K::Max(K::Max(K::Sub(K::Load(boxes.ymin + i), py), K::Sub(py, K::Load(boxes.ymax + i))), zero);
+    Vec dz = K::Max(K::Max(K::Sub(K::Load(boxes.zmin + i), pz), K::Sub(pz, K::Load(boxes.zmax + i))), zero);
+    Vec dd = K::Add(K::Add(K::Mul(dx, dx), K::Mul(dy, dy)), K::Mul(dz, dz));
+    K::Store(distances + i, K::Sqrt(dd));
+  }
+
+  // Return index of first unprocessed box
+  return i;
+}
+
+
+
+template <class K>
+static typename K::Vec
+SquaredSegmentDistance(typename K::Vec px, typename K::Vec py, typename K::Vec pz,
+  typename K::Vec ax, typename K::Vec ay, typename K::Vec az,
+  typename K::Vec bx, typename K::Vec by, typename K::Vec bz)
+{
+  // Compute parameter of closest point on segment (zero for segments of zero length)
+  typedef typename K::Vec Vec;
+  const Vec zero = K::Set(0), one = K::Set(1);
+  Vec abx = K::Sub(bx, ax), aby = K::Sub(by, ay), abz = K::Sub(bz, az);
+  Vec apx = K::Sub(px, ax), apy = K::Sub(py, ay), apz = K::Sub(pz, az);
+  Vec abab = K::Add(K::Add(K::Mul(abx, abx), K::Mul(aby, aby)), K::Mul(abz, abz));
+  Vec abap = K::Add(K::Add(K::Mul(abx, apx), K::Mul(aby, apy)), K::Mul(abz, apz));
+  Vec t = K::Select(K::Less(zero, abab), K::Div(abap, abab), zero);
+  t = K::Min(K::Max(t, zero), one);
+
+  // Return squared distance to closest point
+  Vec dx = K::Sub(apx, K::Mul(abx, t)), dy = K::Sub(apy, K::Mul(aby, t)), dz = K::Sub(apz, K::Mul(abz, t));
+  return K::Add(K::Add(K::Mul(dx, dx), K::Mul(dy, dy)), K::Mul(dz, dz));
+}
+
+
+
+template <class K>
+static int
+PointTriangleKernel(const typename K::Real *p, const R3TriangleBatch<typename K::Real>& triangles,
+  int first, int n, typename K::Real *distances)
+{
+  // Compute distance to closest point in every triangle (Ericson, Real-Time Collision Detection, 5.1.5),
+  // evaluating all Voronoi regions and selecting in reverse order of precedence
+  typedef typename K::Vec Vec;
+  typedef typename K::Mask Mask;
+  const Vec px = K::Set(p[0]), py = K::Set(p[1]), pz = K::Set(p[2]);
+  const Vec zero = K::Set(0), one = K::Set(1);
+  const Vec tolerance = K::Set((sizeof(typename K::Real) == sizeof(float)) ? 1E-6 : 1E-14);
+  int i = first;
+  for ( ; i + K::NLANES <= n; i += K::NLANES) {
+    // Load vertices
+    Vec ax = K::Load(triangles.x0 + i), ay = K::Load(triangles.y0 + i), az = K::Load(triangles.z0 + i);
+    Vec bx = K::Load(triangles.x1 + i), by = K::Load(triangles.y1 + i), bz = K::Load(triangles.z1 + i);
+    Vec cx = K::Load(triangles.x2 + i), cy = K::Load(triangles.y2 + i), cz = K::Load(triangles.z2 + i);
+
+    // Compute edge vectors and dot products
+    Vec abx = K::Sub(bx, ax), aby = K::Sub(by, ay), abz = K::Sub(bz, az);
+    Vec acx = K::Sub(cx, ax), acy = K::Sub(cy, ay), acz = K::Sub(cz, az);
+    Vec apx = K::Sub(px, ax), apy = K::Sub(py, ay), apz = K::Sub(pz, az);
+    Vec bpx = K::Sub(px, bx), bpy = K::Sub(py, by), bpz = K::Sub(pz, bz);
+    Vec cpx = K::Sub(px, cx), cpy = K::Sub(py, cy), cpz = K::Sub(pz, cz);
+    Vec d1 = K::Add(K::Add(K::Mul(abx, apx), K::Mul(aby, apy)), K::Mul(abz, apz));
+    Vec d2 = K::Add(K::Add(K::Mul(acx, apx), K::Mul(acy, apy)), K::Mul(acz, apz));
+    Vec d3 = K::Add(K::Add(K::Mul(abx, bpx), K::Mul(aby, bpy)), K::Mul(abz, bpz));
+    Vec d4 = K::Add(K::Add(K::Mul(acx, bpx), K::Mul(acy, bpy)), K::Mul(acz, bpz));
+    Vec d5 = K::Add(K::Add(K::Mul(abx, cpx), K::Mul(aby, cpy)), K::Mul(abz, cpz));
+    Vec d6 = K::Add(K::Add(K::Mul(acx, cpx), K::Mul(acy, cpy)), K::Mul(acz, cpz));
+    Vec va = K::Sub(K::Mul(d3, d6), K::Mul(d5, d4));
+    Vec vb = K::Sub(K::Mul(d5, d2), K::Mul(d1, d6));
+    Vec vc = K::Sub(K::Mul(d1, d4), K::Mul(d3, d2));
+
+    // Interior (barycentric coordinates v and w)
+    Vec area = K::Add(K::Add(va, vb), vc);
+    Vec denom = K::Div(one, area);
+    Vec v = K::Mul(vb, denom);
+    Vec w = K::Mul(vc, denom);
+    Vec qx = K::Add(ax, K::Add(K::Mul(abx, v), K::Mul(acx, w)));
+    Vec qy = K::Add(ay, K::Add(K::Mul(aby, v), K::Mul(acy, w)));
+    Vec qz = K::Add(az, K::Add(K::Mul(abz, v), K::Mul(acz, w)));
+
+    // Edge BC
+    Vec d43 = K::Sub(d4, d3), d56 = K::Sub(d5, d6);
+    Mask m = K::And(K::LessEqual(va, zero), K::And(K::LessEqual(zero, d43), K::LessEqual(zero, d56)));
+    Vec t = K::Div(d43, K::Add(d43, d56));
+    qx = K::Select(m, K::Add(bx, K::Mul(K::Sub(cx, bx), t)), qx);
+    qy = K::Select(m, K::Add(by, K::Mul(K::Sub(cy, by), t)), qy);
+    qz = K::Select(m, K::Add(bz, K::Mul(K::Sub(cz, bz), t)), qz);
+
+    // Edge AC
+    m = K::And(K::LessEqual(vb, zero), K::And(K::LessEqual(zero, d2), K::LessEqual(d6, zero)));
+    t = K::Div(d2, K::Sub(d2, d6));
+    qx = K::Select(m, K::Add(ax, K::Mul(acx, t)), qx);
+    qy = K::Select(m, K::Add(ay, K::Mul(acy, t)), qy);
+    qz = K::Select(m, K::Add(az, K::Mul(acz, t)), qz);
+
+    // Vertex C
+    m = K::And(K::LessEqual(zero, d6), K::LessEqual(d5, d6));
+    qx = K::Select(m, cx, qx);
+    qy = K::Select(m, cy, qy);
+    qz = K::Select(m, cz, qz);
+
+    // Edge AB
+    m = K::And(K::LessEqual(vc, zero), K::And(K::LessEqual(zero, d1), K::LessEqual(d3, zero)));
+    t = K::Div(d1, K::Sub(d1, d3));
+    qx = K::Select(m, K::Add(ax, K::Mul(abx, t)), qx);
+    qy = K::Select(m, K::Add(ay, K::Mul(aby, t)), qy);
+    qz = K::Select(m, K::Add(az, K::Mul(abz, t)), qz);
+
+    // Vertex B
+    m = K::And(K::LessEqual(zero, d3), K::LessEqual(d4, d3));
+    qx = K::Select(m, bx, qx);
+    qy = K::Select(m, by, qy);
+    qz = K::Select(m, bz, qz);
+
+    // Vertex A
+    m = K::And(K::LessEqual(d1, zero), K::LessEqual(d2, zero));
+    qx = K::Select(m, ax, qx);
+    qy = K::Select(m, ay, qy);
+    qz = K::Select(m, az, qz);
+
+    // Compute distance to closest point
+    Vec dx = K::Sub(px, qx), dy = K::Sub(py, qy), dz = K::Sub(pz, qz);
+    Vec dd = K::Add(K::Add(K::Mul(dx, dx), K::Mul(dy, dy)), K::Mul(dz, dz));
+
+    // Use closest point on edges for degenerate triangles (area is squared norm of cross product,
+    // which is zero or lost in roundoff for collinear or coincident vertices)
+    Vec abab = K::Add(K::Add(K::Mul(abx, abx), K::Mul(aby, aby)), K::Mul(abz, abz));
+    Vec acac = K::Add(K::Add(K::Mul(acx, acx), K::Mul(acy, acy)), K::Mul(acz, acz));
+    Mask degenerate = K::LessEqual(area, K::Mul(tolerance, K::Mul(abab, acac)));
+    if (K::Any(degenerate)) {
+      Vec ddab = SquaredSegmentDistance<K>(px, py, pz, ax, ay, az, bx, by, bz);
+      Vec ddac = SquaredSegmentDistance<K>(px, py, pz, ax, ay, az, cx, cy, cz);
+      Vec ddbc = SquaredSegmentDistance<K>(px, py, pz, bx, by, bz, cx, cy, cz);
+      dd = K::Select(degenerate, K::Min(K::Min(ddab, ddac), ddbc), dd);
+    }
+
+    // Store distance
+    K::Store(distances + i, K::Sqrt(dd));
+  }
+
+  // Return index of first unprocessed triangle
+  return i;
+}
+
+
+
+template <class K>
+static int
+RayBoxKernel(const typename K::Real *s, const typename K::Real *inverse_d, const R3BoxBatch<typename K::Real>& boxes,
+  int first, int n, typename K::Real *hit_ts)
+{
+  // Intersect ray with slabs of every box
+  typedef typename K::Vec Vec;
+  typedef typename K::Mask Mask;
+  const Vec sx = K::Set(s[0]), sy = K::Set(s[1]), sz = K::Set(s[2]);
+  const Vec ix = K::Set(inverse_d[0]), iy = K::Set(inverse_d[1]), iz = K::Set(inverse_d[2]);
+  const Vec zero = K::Set(0), miss = K::Set(-1);
+  int i = first;
+  for ( ; i + K::NLANES <= n; i += K::NLANES) {
+    Vec tx1 = K::Mul(K::Sub(K::Load(boxes.xmin + i), sx), ix);
+    Vec tx2 = K::Mul(K::Sub(K::Load(boxes.xmax + i), sx), ix);
+    Vec ty1 = K::Mul(K::Sub(K::Load(boxes.ymin + i), sy), iy);
+    Vec ty2 = K::Mul(K::Sub(K::Load(boxes.ymax + i), sy), iy);
+    Vec tz1 = K::Mul(K::Sub(K::Load(boxes.zmin + i), sz), iz);
+    Vec tz2 = K::Mul(K::Sub(K::Load(boxes.zmax + i), sz), iz);
+    Vec tnear = K::Max(K::Max(K::Min(tx1, tx2), K::Min(ty1, ty2)), K::Min(tz1, tz2));
+    Vec tfar = K::Min(K::Min(K::Max(tx1, tx2), K::Max(ty1, ty2)), K::Max(tz1, tz2));
+    Mask hit = K::And(K::LessEqual(tnear, tfar), K::LessEqual(zero, tfar));
+    K::Store(hit_ts + i, K::Select(hit, K::Max(tnear, zero), miss));
+  }
+
+  // Return index of first unprocessed box
+  return i;
+}
+
+
+
+template <class K>
+static int
+RayTriangleKernel(const typename K::Real *s, const typename K::Real *d, const R3TriangleBatch<typename K::Real>& triangles,
+  int first, int n, typename K::Real *hit_ts)
+{
+  // Intersect ray with every triangle (Moller-Trumbore, both sides)
+  typedef typename K::Vec Vec;
+  typedef typename K::Mask Mask;
+  const Vec sx = K::Set(s[0]), sy = K::Set(s[1]), sz = K::Set(s[2]);
+  const Vec dx = K::Set(d[0]), dy = K::Set(d[1]), dz = K::Set(d[2]);
+  const Vec zero = K::Set(0), one = K::Set(1), miss = K::Set(-1);
+  int i = first;
+  for ( ; i + K::NLANES <= n; i += K::NLANES) {
+    // Compute edge vectors
+    Vec ax = K::Load(triangles.x0 + i), ay = K::Load(triangles.y0 + i), az = K::Load(triangles.z0 + i);
+    Vec e1x = K::Sub(K::Load(triangles.x1 + i), ax), e1y = K::Sub(K::Load(triangles.y1 + i), ay), e1z = K::Sub(K::Load(triangles.z1 + i), az);
+    Vec e2x = K::Sub(K::Load(triangles.x2 + i), ax), e2y = K::Sub(K::Load(triangles.y2 + i), ay), e2z = K::Sub(K::Load(triangles.z2 + i), az);
+
+    // Compute determinant (zero for rays parallel to the triangle and for degenerate triangles, which are missed)
+    Vec qx = K::Sub(K::Mul(dy, e2z), K::Mul(dz, e2y));
+    Vec qy = K::Sub(K::Mul(dz, e2x), K::Mul(dx, e2z));
+    Vec qz = K::Sub(K::Mul(dx, e2y), K::Mul(dy, e2x));
+    Vec det = K::Add(K::Add(K::Mul(e1x, qx), K::Mul(e1y, qy)), K::Mul(e1z, qz));
+    Vec inverse_det = K::Div(one, det);
+
+    // Compute barycentric coordinates
+    Vec tx = K::Sub(sx, ax), ty = K::Sub(sy, ay), tz = K::Sub(sz, az);
+    Vec u = K::Mul(K::Add(K::Add(K::Mul(tx, qx), K::Mul(ty, qy)), K::Mul(tz, qz)), inverse_det);
+    Vec rx = K::Sub(K::Mul(ty, e1z), K::Mul(tz, e1y));
+    Vec ry = K::Sub(K::Mul(tz, e1x), K::Mul(tx, e1z));
+    Vec rz = K::Sub(K::Mul(tx, e1y), K::Mul(ty, e1x));
+    Vec v = K::Mul(K::Add(K::Add(K::Mul(dx, rx), K::Mul(dy, ry)), K::Mul(dz, rz)), inverse_det);
+    Vec t = K::Mul(K::Add(K::Add(K::Mul(e2x, rx), K::Mul(e2y, ry)), K::Mul(e2z, rz)), inverse_det);
+
+    // Check intersection
+    Mask hit = K::And(K::And(K::LessEqual(zero, u), K::LessEqual(zero, v)),
+      K::And(K::LessEqual(K::Add(u, v), one), K::LessEqual(zero, t)));
+    hit = K::And(hit, K::Less(zero, K::Mul(det, det)));
+    K::Store(hit_ts + i, K::Select(hit, t, miss));
+  }
+
+  // Return index of first unprocessed triangle
+  return i;
+}
+
+
+
+template <class K>
+static int
+SphereBoxKernel(const typename K::Real *c, typename K::Real r, const R3BoxBatch<typename K::Real>& boxes,
+  int first, int n, typename K::Real *hits)
+{
+  // Compare squared distance from center to every box with squared radius
+  typedef typename K::Vec Vec;
+  const Vec cx = K::Set(c[0]), cy = K::Set(c[1]), cz = K::Set(c[2]);
+  const Vec rr = K::Set(r * r);
+  const Vec zero = K::Set(0), one = K::Set(1);
+  int i = first;
+  for ( ; i + K::NLANES <= n; i += K::NLANES) {
+    Vec dx = K::Max(K::Max(K::Sub(K::Load(boxes.xmin + i), cx), K::Sub(cx, K::Load(boxes.xmax + i))), zero);
+    Vec dy = K::Max(K::Max(K::Sub(K::Load(boxes.ymin + i), cy), K::Sub(cy, K::Load(boxes.ymax + i))), zero);
+    Vec dz = K::Max(K::Max(K::Sub(K::Load(boxes.zmin + i), cz), K::Sub(cz, K::Load(boxes.zmax + i))), zero);
+    Vec dd = K::Add(K::Add(K::Mul(dx, dx), K::Mul(dy, dy)), K::Mul(dz, dz));
+    K::Store(hits + i, K::Select(K::LessEqual(dd, rr), one, zero));
+  }
+
+  // Return index of first unprocessed box
+  return i;
+}
+
+
+
+/* Kernel dispatch (widest kernels first, narrower ones for the remainder) */
+
+#if defined(R3_BATCH_AVX) && defined(R3_BATCH_SSE)
+#define R3_BATCH_DISPATCH(KERNEL, T, ...) { \
+  int i = 0; \
+  if (R3batch_kernels >= R3_BATCH_AVX_KERNELS) i = KERNEL<R3BatchAVX<T> >(__VA_ARGS__, i, n, results); \
+  if (R3batch_kernels >= R3_BATCH_SSE_KERNELS) i = KERNEL<R3BatchSSE<T> >(__VA_ARGS__, i, n, results); \
+  KERNEL<R3BatchScalar<T> >(__VA_ARGS__, i, n, results); }
+#elif defined(R3_BATCH_SSE)
+#define R3_BATCH_DISPATCH(KERNEL, T, ...) { \
+  int i = 0; \
+  if (R3batch_kernels >= R3_BATCH_SSE_KERNELS) i = KERNEL<R3BatchSSE<T> >(__VA_ARGS__, i, n, results); \
+  KERNEL<R3BatchScalar<T> >(__VA_ARGS__, i, n, results); }
+#else
+#define R3_BATCH_DISPATCH(KERNEL, T, ...) { \
+  KERNEL<R3BatchScalar<T> >(__VA_ARGS__, 0, n, results); }
+#endif
+
+
+
+template <class T>
+static void
+ComputeDistances(const R3Point& point, const R3BoxBatch<T>& boxes, int n, T *results)
+{
+  // Compute distances
+  const T p[3] = { (T) point.X(), (T) point.Y(), (T) point.Z() };
+  R3_BATCH_DISPATCH(PointBoxKernel, T, p, boxes);
+}
+
+
+
+template <class T>
+static void
+ComputeDistances(const R3Point& point, const R3TriangleBatch<T>& triangles, int n, T *results)
+{
+  // Compute distances
+  const T p[3] = { (T) point.X(), (T) point.Y(), (T) point.Z() };
+  R3_BATCH_DISPATCH(PointTriangleKernel, T, p, triangles);
+}
+
+
+
+template <class T>
+static int
+CountHits(int n, const T *results)
+{
+  // Count non-negative results
+  int count = 0;
+  for (int i = 0; i < n; i++) {
+    if (results[i] >= 0) count++;
+  }
+
+  // Return number of hits
+  return count;
+}
+
+
+
+template <class T>
+static int
+ComputeIntersections(const R3Ray& ray, const R3BoxBatch<T>& boxes, int n, T *results)
+{
+  // Compute inverse of direction (huge but finite for axis-aligned rays, so that products stay well defined)
+  const T huge = (sizeof(T) == sizeof(float)) ? (T) 1E30 : (T) 1E300;
+  const R3Point& start = ray.Start();
+  const R3Vector& vector = ray.Vector();
+  const T s[3] = { (T) start.X(), (T) start.Y(), (T) start.Z() };
+  T inverse_d[3];
+  for (int dim = 0; dim < 3; dim++) {
+    if (vector[dim] > 0) inverse_d[dim] = ((T) (1.0 / vector[dim]) < huge) ? (T) (1.0 / vector[dim]) : huge;
+    else if (vector[dim] < 0) inverse_d[dim] = ((T) (1.0 / vector[dim]) > -huge) ? (T) (1.0 / vector[dim]) : -huge;
+    else inverse_d[dim] = huge;
+  }
+
+  // Compute intersections
+  R3_BATCH_DISPATCH(RayBoxKernel, T, s, inverse_d, boxes);
+
+  // Return number of hits
+  return CountHits(n, results);
+}
+
+
+
+template <class T>
+static int
+ComputeIntersections(const R3Ray& ray, const R3TriangleBatch<T>& triangles, int n, T *results)
+{
+  // Compute intersections
+  const R3Point& start = ray.Start();
+  const R3Vector& vector = ray.Vector();
+  const T s[3] = { (T) start.X(), (T) start.Y(), (T) start.Z() };
+  const T d[3] = { (T) vector.X(), (T) vector.Y(), (T) vector.Z() };
+  R3_BATCH_DISPATCH(RayTriangleKernel, T, s, d, triangles);
+
+  // Return number of hits
+  return CountHits(n, results);
+}
+
+
+
+template <class T>
+static int
+ComputeIntersections(const R3Sphere& sphere, const R3BoxBatch<T>& boxes, int nboxes, RNBoolean *hits)
+{
+  // Compute intersections in blocks (kernels produce 0 or 1 in the box type)
+  const int block_size = 1024;
+  T results[block_size];
+  const R3Point& center = sphere.Center();
+  const T c[3] = { (T) center.X(), (T) center.Y(), (T) center.Z() };
+  const T r = (T) sphere.Radius();
+  int count = 0;
+  for (int first = 0; first < nboxes; first += block_size) {
+    // Compute intersections for block
+    int n = (nboxes - first < block_size) ? nboxes - first : block_size;
+    R3BoxBatch<T> block = boxes;
+    block.xmin += first; block.ymin += first; block.zmin += first;
+    block.xmax += first; block.ymax += first; block.zmax += first;
+    R3_BATCH_DISPATCH(SphereBoxKernel, T, c, r, block);
+
+    // Copy results
+    for (int i = 0; i < n; i++) {
+      hits[first + i] = (results[i] > 0) ? TRUE : FALSE;
+      if (hits[first + i]) count++;
+    }
+  }
+
+  // Return number of hits
+  return count;
+}
+
+
+
+/* Public functions */
+
+void
+R3Distances(const R3Point& point, const R3BoxBatch<double>& boxes, int nboxes, double *distances)
+{
+  // Compute distances from point to boxes
+  ComputeDistances(point, boxes, nboxes, distances);
+}
+
+
+
+void
+R3Distances(const R3Point& point, const R3BoxBatch<float>& boxes, int nboxes, float *distances)
+{
+  // Compute distances from point to boxes
+  ComputeDistances(point, boxes, nboxes, distances);
+}
+
+
+
+void
+R3Distances(const R3Point& point, const R3TriangleBatch<double>& triangles, int ntriangles, double *distances)
+{
+  // Compute distances from point to triangles
+  ComputeDistances(point, triangles, ntriangles, distances);
+}
+
+
+
+void
+R3Distances(const R3Point& point, const R3TriangleBatch<float>& triangles, int ntriangles, float *distances)
+{
+  // Compute distances from point to triangles
+  ComputeDistances(point, triangles, ntriangles, distances);
+}
+
+
+
+int
+R3Intersections(const R3Ray& ray, const R3BoxBatch<double>& boxes, int nboxes, double *hit_ts)
+{
+  // Intersect ray with boxes
+  return ComputeIntersections(ray, boxes, nboxes, hit_ts);
+}
+
+
+
+int
+R3Intersections(const R3Ray& ray, const R3BoxBatch<float>& boxes, int nboxes, float *hit_ts)
+{
+  // Intersect ray with boxes
+  return ComputeIntersections(ray, boxes, nboxes, hit_ts);
+}
+
+
+
+int
+R3Intersections(const R3Ray& ray, const R3TriangleBatch<double>& triangles, int ntriangles, double *hit_ts)
+{
+  // Intersect ray with triangles
+  return ComputeIntersections(ray, triangles, ntriangles, hit_ts);
+}
+
+
+
+int
+R3Intersections(const R3Ray& ray, const R3TriangleBatch<float>& triangles, int ntriangles, float *hit_ts)
+{
+  // Intersect ray with triangles
+  return ComputeIntersections(ray, triangles, ntriangles, hit_ts);
+}
+
+
+
+int
+R3Intersections(const R3Sphere& sphere, const R3BoxBatch<double>& boxes, int nboxes, RNBoolean *hits)
+{
+  // Intersect sphere with boxes
+  return ComputeIntersections(sphere, boxes, nboxes, hits);
+}
+
+
+
+int
+R3Intersections(const R3Sphere& sphere, const R3BoxBatch<float>& boxes, int nboxes, RNBoolean *hits)
+{
+  // Intersect sphere with boxes
+  return ComputeIntersections(sphere, boxes, nboxes, hits);
+}
+
+
+
+int
+R3BatchKernels(void)
+{
+  // Return kernels used by batched functions
+  return R3batch_kernels;
+}
+
+
+
+void
+R3SetBatchKernels(int kernels)
+{
+  // Set kernels used by batched functions (limited to ones compiled in)
+#if defined(R3_BATCH_AVX)
+  const int max_kernels = R3_BATCH_AVX_KERNELS;
+#elif defined(R3_BATCH_SSE)
+  const int max_kernels = R3_BATCH_SSE_KERNELS;
+#else
+  const int max_kernels = R3_BATCH_SCALAR_KERNELS;
+#endif
+  R3batch_kernels = (kernels < max_kernels) ? kernels : max_kernels;
+}
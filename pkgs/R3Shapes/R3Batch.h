@@ -0,0 +1,57 @@
+/* Include file for GAPS batched distance and intersection utility */
+
+
+
+/* Structure-of-arrays batches (primitive i has coordinates at index i of every array) */
+
+template <class T>
+struct R3BoxBatch {
+  const T *xmin, *ymin, *zmin;
+  const T *xmax, *ymax, *zmax;
+};
+
+template <class T>
+struct R3TriangleBatch {
+  const T *x0, *y0, *z0;
+  const T *x1, *y1, *z1;
+  const T *x2, *y2, *z2;
+};
+
+
+
+/* Kernel sets */
+
+#define R3_BATCH_SCALAR_KERNELS 0
+#define R3_BATCH_SSE_KERNELS    1
+#define R3_BATCH_AVX_KERNELS    2
+
+
+
+/* Function declarations */
+
+void R3Distances(const R3Point& point, const R3BoxBatch<double>& boxes, int nboxes, double *distances);
+void R3Distances(const R3Point& point, const R3BoxBatch<float>& boxes, int nboxes, float *distances);
+void R3Distances(const R3Point& point, const R3TriangleBatch<double>& triangles, int ntriangles, double *distances);
+void R3Distances(const R3Point& point, const R3TriangleBatch<float>& triangles, int ntriangles, float *distances);
+  // Fills distances with the distance from point to every primitive (zero inside boxes,
+  // and distance to closest edge for degenerate triangles)
+
+int R3Intersections(const R3Ray& ray, const R3BoxBatch<double>& boxes, int nboxes, double *hit_ts);
+int R3Intersections(const R3Ray& ray, const R3BoxBatch<float>& boxes, int nboxes, float *hit_ts);
+int R3Intersections(const R3Ray& ray, const R3TriangleBatch<double>& triangles, int ntriangles, double *hit_ts);
+int R3Intersections(const R3Ray& ray, const R3TriangleBatch<float>& triangles, int ntriangles, float *hit_ts);
+  // Fills hit_ts with the ray parameter of the first intersection with every primitive
+  // (0 if the ray starts inside a box, -1 if there is no intersection or the triangle is degenerate),
+  // and returns number of hits
+
+int R3Intersections(const R3Sphere& sphere, const R3BoxBatch<double>& boxes, int nboxes, RNBoolean *hits);
+int R3Intersections(const R3Sphere& sphere, const R3BoxBatch<float>& boxes, int nboxes, RNBoolean *hits);
+  // Fills hits with whether sphere intersects every box, and returns number of hits
+
+int R3BatchKernels(void);
+void R3SetBatchKernels(int kernels);
+  // Kernels used by batched functions (default is the best set compiled in, e.g., AVX with -mavx),
+  // R3_BATCH_SCALAR_KERNELS selects the scalar reference implementation
+
+
+
@@ -0,0 +1,179 @@
+// Source file for face bounding hierarchy class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Parameters
+////////////////////////////////////////////////////////////////////////
+
+// Depth after which nodes are split by count rather than by position
+static const int max_spatial_split_depth = 48;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3FaceHierarchy::
+R3FaceHierarchy(void)
+  : nfaces(0),
+    ordered_faces(NULL),
+    nnodes(0),
+    node_boxes(NULL),
+    node_children(NULL),
+    node_first_faces(NULL),
+    node_nfaces(NULL)
+{
+}
+
+
+
+R3FaceHierarchy::
+~R3FaceHierarchy(void)
+{
+  // Delete arrays
+  Empty();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Construction functions
+////////////////////////////////////////////////////////////////////////
+
+int R3FaceHierarchy::
+BuildNode(int *face_indices, int nfaces, const double *face_boxes, const R3Point *face_centroids,
+  int max_faces_per_leaf, int *nordered, int depth)
+{
+  // Allocate node covering the next run of ordered faces
+  int node = nnodes++;
+  node_children[2*node+0] = -1;
+  node_children[2*node+1] = -1;
+  node_first_faces[node] = *nordered;
+  node_nfaces[node] = nfaces;
+
+  // Compute bounding box of faces and their centroids
+  double *box = &node_boxes[6*node];
+  for (int dim = 0; dim < 3; dim++) { box[dim] = RN_INFINITY; box[3+dim] = -RN_INFINITY; }
+  R3Box centroid_bbox = R3null_box;
+  for (int i = 0; i < nfaces; i++) {
+    const double *face_box = &face_boxes[6*face_indices[i]];
+    for (int dim = 0; dim < 3; dim++) {
+      if (face_box[dim] < box[dim]) box[dim] = face_box[dim];
+      if (face_box[3+dim] > box[3+dim]) box[3+dim] = face_box[3+dim];
+    }
+    centroid_bbox.Union(face_centroids[face_indices[i]]);
+  }
+
+  // Check if leaf
+  if (nfaces <= max_faces_per_leaf) {
+    for (int i = 0; i < nfaces; i++) {
+      ordered_faces[(*nordered)++] = face_indices[i];
+    }
+    return node;
+  }
+
+  // Partition faces at middle of longest centroid axis
+  int nleft = 0;
+  if (depth < max_spatial_split_depth) {
+    int dim = centroid_bbox.LongestAxis();
+    RNCoord split = centroid_bbox.AxisCenter(dim);
+    for (int i = 0; i < nfaces; i++) {
+      if (face_centroids[face_indices[i]][dim] < split) {
+        int swap = face_indices[i];
+        face_indices[i] = face_indices[nleft];
+        face_indices[nleft++] = swap;
+      }
+    }
+  }
+
+  // Split by count if partition was degenerate
+  if ((nleft == 0) || (nleft == nfaces)) nleft = nfaces / 2;
+
+  // Build children
+  node_children[2*node+0] = BuildNode(face_indices, nleft,
+    face_boxes, face_centroids, max_faces_per_leaf, nordered, depth+1);
+  node_children[2*node+1] = BuildNode(&face_indices[nleft], nfaces - nleft,
+    face_boxes, face_centroids, max_faces_per_leaf, nordered, depth+1);
+
+  // Return node
+  return node;
+}
+
+
+
+void R3FaceHierarchy::
+Build(const double *face_boxes, const R3Point *face_centroids, int nfaces, int max_faces_per_leaf)
+{
+  // Delete previous hierarchy
+  Empty();
+
+  // Check faces
+  if (nfaces <= 0) return;
+  if (max_faces_per_leaf < 1) max_faces_per_leaf = 1;
+  this->nfaces = nfaces;
+
+  // Allocate nodes
+  int max_nodes = 2 * nfaces;
+  ordered_faces = new int [ nfaces ];
+  node_boxes = new double [ 6 * max_nodes ];
+  node_children = new int [ 2 * max_nodes ];
+  node_first_faces = new int [ max_nodes ];
+  node_nfaces = new int [ max_nodes ];
+
+  // Build nodes recursively from root
+  int *face_indices = new int [ nfaces ];
+  for (int i = 0; i < nfaces; i++) face_indices[i] = i;
+  int nordered = 0;
+  BuildNode(face_indices, nfaces, face_boxes, face_centroids, max_faces_per_leaf, &nordered, 0);
+  assert(nordered == nfaces);
+  delete [] face_indices;
+}
+
+
+
+void R3FaceHierarchy::
+Build(const R3Point *points, int npoints, int max_points_per_leaf)
+{
+  // Build hierarchy over points as degenerate boxes
+  double *boxes = new double [ 6 * npoints ];
+  for (int i = 0; i < npoints; i++) {
+    for (int dim = 0; dim < 3; dim++) {
+      boxes[6*i+dim] = points[i][dim];
+      boxes[6*i+3+dim] = points[i][dim];
+    }
+  }
+  Build(boxes, points, npoints, max_points_per_leaf);
+  delete [] boxes;
+}
+
+
+
+void R3FaceHierarchy::
+Empty(void)
+{
+  // Delete faces
+  if (ordered_faces) delete [] ordered_faces;
+  ordered_faces = NULL;
+  nfaces = 0;
+
+  // Delete nodes
+  if (node_boxes) delete [] node_boxes;
+  if (node_children) delete [] node_children;
+  if (node_first_faces) delete [] node_first_faces;
+  if (node_nfaces) delete [] node_nfaces;
+  node_boxes = NULL;
+  node_children = NULL;
+  node_first_faces = NULL;
+  node_nfaces = NULL;
+  nnodes = 0;
+}
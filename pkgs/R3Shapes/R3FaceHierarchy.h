@@ -0,0 +1,198 @@
+// Include file for face bounding hierarchy class
+
+
+
+// Class definition
+
+class R3FaceHierarchy {
+public:
+  // Constructors/destructors
+  R3FaceHierarchy(void);
+  ~R3FaceHierarchy(void);
+
+  // Construction functions
+  void Build(const double *face_boxes, const R3Point *face_centroids, int nfaces, int max_faces_per_leaf);
+    // Builds a binary hierarchy over nfaces faces given by their bounding boxes (six values per face,
+    // low xyz followed by high xyz) and centroids, with at most max_faces_per_leaf faces in every leaf
+  void Build(const R3Point *points, int npoints, int max_points_per_leaf);
+    // Builds a hierarchy over points, which are then accessed with the point access functions
+  void Empty(void);
+
+  // Property functions
+  int NFaces(void) const;
+  int NNodes(void) const;
+
+  // Face access functions
+  int Face(int k) const;
+    // Index (in the arrays given to Build) of the kth face in hierarchy order
+
+  // Node access functions
+  const double *NodeBox(int node) const;
+    // Bounding box of all faces in node (six values as for Build), the root is node 0
+  int NodeChild(int node, int k) const;
+    // Child k (0 or 1) of an interior node, or -1 if the node is a leaf
+  int NodeFirstFace(int node) const;
+  int NodeNFaces(int node) const;
+    // Every node covers the run of faces from NodeFirstFace to NodeFirstFace + NodeNFaces - 1 in hierarchy order
+
+  // Point access functions (for hierarchies built over points)
+  int NPoints(void) const;
+  int Point(int k) const;
+  int NodeFirstPoint(int node) const;
+  int NodeNPoints(int node) const;
+
+  // Box utility functions
+  static RNBoolean BoxesOverlap(const double *box1, const double *box2);
+  static RNScalar BoxDistanceSquared(const double *box, const R3Point& position);
+
+  // Size of traversal stack (enough for spatial splits plus log2 of any face count)
+  static const int max_stack_size = 256;
+
+public:
+  // Internal functions
+  int BuildNode(int *face_indices, int nfaces, const double *face_boxes, const R3Point *face_centroids,
+    int max_faces_per_leaf, int *nordered, int depth);
+
+public:
+  // Faces in hierarchy order
+  int nfaces;
+  int *ordered_faces;
+
+  // Nodes
+  int nnodes;
+  double *node_boxes;
+  int *node_children;
+  int *node_first_faces;
+  int *node_nfaces;
+};
+
+
+
+// Inline functions
+
+inline int R3FaceHierarchy::
+NFaces(void) const
+{
+  // Return number of faces
+  return nfaces;
+}
+
+
+
+inline int R3FaceHierarchy::
+NNodes(void) const
+{
+  // Return number of nodes (0 if there are no faces)
+  return nnodes;
+}
+
+
+
+inline int R3FaceHierarchy::
+Face(int k) const
+{
+  // Return index of kth face in hierarchy order
+  return ordered_faces[k];
+}
+
+
+
+inline const double *R3FaceHierarchy::
+NodeBox(int node) const
+{
+  // Return bounding box of node
+  return &node_boxes[6*node];
+}
+
+
+
+inline int R3FaceHierarchy::
+NodeChild(int node, int k) const
+{
+  // Return child of node
+  return node_children[2*node+k];
+}
+
+
+
+inline int R3FaceHierarchy::
+NodeFirstFace(int node) const
+{
+  // Return hierarchy order of first face in node
+  return node_first_faces[node];
+}
+
+
+
+inline int R3FaceHierarchy::
+NodeNFaces(int node) const
+{
+  // Return number of faces in node
+  return node_nfaces[node];
+}
+
+
+
+inline int R3FaceHierarchy::
+NPoints(void) const
+{
+  // Return number of points
+  return nfaces;
+}
+
+
+
+inline int R3FaceHierarchy::
+Point(int k) const
+{
+  // Return index of kth point in hierarchy order
+  return ordered_faces[k];
+}
+
+
+
+inline int R3FaceHierarchy::
+NodeFirstPoint(int node) const
+{
+  // Return hierarchy order of first point in node
+  return node_first_faces[node];
+}
+
+
+
+inline int R3FaceHierarchy::
+NodeNPoints(int node) const
+{
+  // Return number of points in node
+  return node_nfaces[node];
+}
+
+
+
+inline RNBoolean R3FaceHierarchy::
+BoxesOverlap(const double *box1, const double *box2)
+{
+  // Return whether closed boxes share any point
+  if ((box1[0] > box2[3]) || (box2[0] > box1[3])) return FALSE;
+  if ((box1[1] > box2[4]) || (box2[1] > box1[4])) return FALSE;
+  if ((box1[2] > box2[5]) || (box2[2] > box1[5])) return FALSE;
+  return TRUE;
+}
+
+
+
+inline RNScalar R3FaceHierarchy::
+BoxDistanceSquared(const double *box, const R3Point& position)
+{
+  // Sum squared distances outside box along every axis
+  RNScalar distance_squared = 0;
+  for (int dim = 0; dim < 3; dim++) {
+    RNScalar delta = 0;
+    if (position[dim] < box[dim]) delta = box[dim] - position[dim];
+    else if (position[dim] > box[3+dim]) delta = position[dim] - box[3+dim];
+    distance_squared += delta * delta;
+  }
+
+  // Return squared distance
+  return distance_squared;
+}
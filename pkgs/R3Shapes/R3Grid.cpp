@@ -4652,6 +4652,322 @@ ConnectedComponents(RNScalar isolevel, int max_components, int *seeds, int *size
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Peak extraction functions
+////////////////////////////////////////////////////////////////////////
+
+static RNBoolean
+IsHigherPeak(const RNScalar *values, int index1, int index2)
+{
+  // Order by decreasing value, breaking ties by increasing index
+  if (values[index1] > values[index2]) return TRUE;
+  if (values[index1] < values[index2]) return FALSE;
+  return (index1 < index2);
+}
+
+
+
+static void
+SiftPeakDown(const RNScalar *values, int *heap, int nentries, int i)
+{
+  // Restore heap order below entry i
+  while (TRUE) {
+    int best = i;
+    int left = 2*i + 1;
+    int right = left + 1;
+    if ((left < nentries) && IsHigherPeak(values, heap[left], heap[best])) best = left;
+    if ((right < nentries) && IsHigherPeak(values, heap[right], heap[best])) best = right;
+    if (best == i) return;
+    int swap = heap[i]; heap[i] = heap[best]; heap[best] = swap;
+    i = best;
+  }
+}
+
+
+
+static RNBoolean
+IsInsideRasterizedSphere(const R3Grid *grid, const R3Point& center, RNLength radius, int i, int j, int k)
+{
+  // Return whether RasterizeGridSphere(center, radius, ...) would touch entry (i, j, k)
+  int ijk[3] = { i, j, k };
+  int mn[3], mx[3];
+  for (int dim = 0; dim < 3; dim++) {
+    mx[dim]= (int) (center[dim]+radius);
+    if (mx[dim] > grid->Resolution(dim)-1) mx[dim] = grid->Resolution(dim)-1;
+    mn[dim]= (int) (center[dim]-radius);
+    if (mn[dim] < 0) mn[dim] = 0;
+    if ((ijk[dim] < mn[dim]) || (ijk[dim] > mx[dim])) return FALSE;
+  }
+
+  // Check span in y (same arithmetic as the rasterizer)
+  RNScalar radius_squared = radius * radius;
+  RNCoord z = (int) (k - center[2]);
+  RNLength xy_radius_squared = radius_squared - z*z;
+  if (xy_radius_squared < 0) return FALSE;
+  RNLength y = sqrt(xy_radius_squared);
+  int y1 = (int) (center[1] - y + 0.5);
+  int y2 = (int) (center[1] + y + 0.5);
+  if (y1 < mn[1]) y1 = mn[1];
+  if (y2 > mx[1]) y2 = mx[1];
+  if ((j < y1) || (j > y2)) return FALSE;
+
+  // Check span in x
+  RNCoord yj = (int) (j - center[1]);
+  RNLength x_squared = xy_radius_squared - yj*yj;
+  if (x_squared < 0) return FALSE;
+  RNLength x = sqrt(x_squared);
+  int x1 = (int) (center[0] - x + 0.5);
+  int x2 = (int) (center[0] + x + 0.5);
+  if (x1 < mn[0]) x1 = mn[0];
+  if (x2 > mx[0]) x2 = mx[0];
+  if ((i < x1) || (i > x2)) return FALSE;
+
+  // Entry is inside
+  return TRUE;
+}
+
+
+
+static int
+FindPeakIndices(const R3Grid *grid, int max_peaks, RNLength grid_radius, RNBoolean world_centers,
+  RNScalar min_value, RNBoolean local_maxima_only, int *peak_indices)
+{
+  // Check number of peaks
+  if (max_peaks <= 0) return 0;
+
+  // Gather candidates (entries greater than min_value, optionally without any greater 26-neighbor)
+  const RNScalar *values = grid->GridValues();
+  int xres = grid->XResolution();
+  int yres = grid->YResolution();
+  int zres = grid->ZResolution();
+  int *heap = new int [ grid->NEntries() ];
+  int nentries = 0;
+  for (int index = 0; index < grid->NEntries(); index++) {
+    RNScalar value = values[index];
+    if (value <= min_value) continue;
+    if (local_maxima_only) {
+      int i, j, k;
+      grid->IndexToIndices(index, i, j, k);
+      for (int t = k-1; t <= k+1; t++) {
+        if ((t < 0) || (t >= zres)) continue;
+        for (int s = j-1; s <= j+1; s++) {
+          if ((s < 0) || (s >= yres)) continue;
+          for (int r = i-1; r <= i+1; r++) {
+            if ((r < 0) || (r >= xres)) continue;
+            if (grid->GridValue(r, s, t) > value) goto notmaximum;
+          }
+        }
+      }
+    }
+    heap[nentries++] = index;
+  notmaximum:;
+  }
+
+  // Build max heap over candidates
+  for (int i = nentries/2 - 1; i >= 0; i--) {
+    SiftPeakDown(values, heap, nentries, i);
+  }
+
+  // Allocate spatial hash of accepted peaks (cells are wider than any suppression footprint)
+  int cell_size = (int) grid_radius + 2;
+  int ncells[3] = { xres / cell_size + 1, yres / cell_size + 1, zres / cell_size + 1 };
+  int table_size = 1;
+  while (table_size < 2 * max_peaks) table_size *= 2;
+  long long *table_cells = NULL;
+  int *table_heads = NULL;
+  int *peak_nexts = NULL;
+  R3Point *peak_centers = NULL;
+  if (grid_radius > 0) {
+    table_cells = new long long [ table_size ];
+    table_heads = new int [ table_size ];
+    peak_nexts = new int [ max_peaks ];
+    peak_centers = new R3Point [ max_peaks ];
+    for (int i = 0; i < table_size; i++) table_cells[i] = -1;
+  }
+
+  // Pop candidates in order, skipping ones inside the footprint of an earlier peak
+  int npeaks = 0;
+  while ((nentries > 0) && (npeaks < max_peaks)) {
+    // Pop highest candidate
+    int index = heap[0];
+    heap[0] = heap[--nentries];
+    SiftPeakDown(values, heap, nentries, 0);
+
+    // Check if no suppression
+    if (grid_radius <= 0) {
+      peak_indices[npeaks++] = index;
+      continue;
+    }
+
+    // Check peaks in neighboring cells
+    int ijk[3], cell[3];
+    grid->IndexToIndices(index, ijk[0], ijk[1], ijk[2]);
+    for (int dim = 0; dim < 3; dim++) cell[dim] = ijk[dim] / cell_size;
+    RNBoolean suppressed = FALSE;
+    for (int cz = cell[2]-1; !suppressed && (cz <= cell[2]+1); cz++) {
+      if ((cz < 0) || (cz >= ncells[2])) continue;
+      for (int cy = cell[1]-1; !suppressed && (cy <= cell[1]+1); cy++) {
+        if ((cy < 0) || (cy >= ncells[1])) continue;
+        for (int cx = cell[0]-1; !suppressed && (cx <= cell[0]+1); cx++) {
+          if ((cx < 0) || (cx >= ncells[0])) continue;
+          long long key = ((long long) cz * ncells[1] + cy) * ncells[0] + cx;
+          int slot = (int) (key % table_size);
+          while ((table_cells[slot] >= 0) && (table_cells[slot] != key)) slot = (slot + 1) & (table_size - 1);
+          if (table_cells[slot] < 0) continue;
+          for (int p = table_heads[slot]; p >= 0; p = peak_nexts[p]) {
+            if (IsInsideRasterizedSphere(grid, peak_centers[p], grid_radius, ijk[0], ijk[1], ijk[2])) {
+              suppressed = TRUE;
+              break;
+            }
+          }
+        }
+      }
+    }
+
+    // Check if suppressed
+    if (suppressed) continue;
+
+    // Insert peak into spatial hash
+    long long key = ((long long) cell[2] * ncells[1] + cell[1]) * ncells[0] + cell[0];
+    int slot = (int) (key % table_size);
+    while ((table_cells[slot] >= 0) && (table_cells[slot] != key)) slot = (slot + 1) & (table_size - 1);
+    if (table_cells[slot] < 0) { table_cells[slot] = key; table_heads[slot] = -1; }
+    peak_centers[npeaks] = R3Point(ijk[0], ijk[1], ijk[2]);
+    if (world_centers) peak_centers[npeaks] = grid->GridPosition(grid->WorldPosition(ijk[0], ijk[1], ijk[2]));
+    peak_nexts[npeaks] = table_heads[slot];
+    table_heads[slot] = npeaks;
+    peak_indices[npeaks++] = index;
+  }
+
+  // Delete temporary memory
+  if (table_cells) delete [] table_cells;
+  if (table_heads) delete [] table_heads;
+  if (peak_nexts) delete [] peak_nexts;
+  if (peak_centers) delete [] peak_centers;
+  delete [] heap;
+
+  // Return number of peaks
+  return npeaks;
+}
+
+
+
+static R3Point
+RefinedPeakPosition(const R3Grid *grid, int i, int j, int k, RNBoolean subvoxel)
+{
+  // Start at grid entry
+  int ijk[3] = { i, j, k };
+  R3Point position(i, j, k);
+  if (!subvoxel) return position;
+
+  // Fit a parabola through the entry and its two neighbors along each axis
+  RNScalar value = grid->GridValue(i, j, k);
+  for (int dim = 0; dim < 3; dim++) {
+    if ((ijk[dim] <= 0) || (ijk[dim] >= grid->Resolution(dim)-1)) continue;
+    int lo[3] = { i, j, k }; lo[dim]--;
+    int hi[3] = { i, j, k }; hi[dim]++;
+    RNScalar value0 = grid->GridValue(lo[0], lo[1], lo[2]);
+    RNScalar value1 = grid->GridValue(hi[0], hi[1], hi[2]);
+    RNScalar curvature = value0 - 2*value + value1;
+    if (curvature >= 0) continue;
+    RNScalar offset = 0.5 * (value0 - value1) / curvature;
+    if (offset < -0.5) offset = -0.5;
+    if (offset > 0.5) offset = 0.5;
+    position[dim] += offset;
+  }
+
+  // Return position
+  return position;
+}
+
+
+
+static R3Vector
+PeakGradientVector(const R3Grid *grid, int i, int j, int k)
+{
+  // Compute gradient with central differences (one-sided at the boundary)
+  int ijk[3] = { i, j, k };
+  R3Vector gradient(0, 0, 0);
+  for (int dim = 0; dim < 3; dim++) {
+    int lo[3] = { i, j, k };
+    int hi[3] = { i, j, k };
+    if (ijk[dim] > 0) lo[dim]--;
+    if (ijk[dim] < grid->Resolution(dim)-1) hi[dim]++;
+    if (hi[dim] == lo[dim]) continue;
+    RNScalar value0 = grid->GridValue(lo[0], lo[1], lo[2]);
+    RNScalar value1 = grid->GridValue(hi[0], hi[1], hi[2]);
+    gradient[dim] = (value1 - value0) / (hi[dim] - lo[dim]);
+  }
+
+  // Return gradient
+  return gradient;
+}
+
+
+
+int R3Grid::
+FindGridPeaks(int max_peaks, RNLength grid_min_spacing, R3Point *grid_positions, RNScalar *values, R3Vector *grid_normals,
+  RNScalar min_value, RNBoolean local_maxima_only, RNBoolean subvoxel) const
+{
+  // Find peak entries
+  int *peak_indices = new int [ (max_peaks > 0) ? max_peaks : 1 ];
+  int npeaks = FindPeakIndices(this, max_peaks, grid_min_spacing, FALSE, min_value, local_maxima_only, peak_indices);
+
+  // Fill peak info
+  for (int p = 0; p < npeaks; p++) {
+    int i, j, k;
+    IndexToIndices(peak_indices[p], i, j, k);
+    if (grid_positions) grid_positions[p] = RefinedPeakPosition(this, i, j, k, subvoxel);
+    if (values) values[p] = grid_values[peak_indices[p]];
+    if (grid_normals) {
+      grid_normals[p] = PeakGradientVector(this, i, j, k);
+      grid_normals[p].Normalize();
+    }
+  }
+
+  // Delete peak indices
+  delete [] peak_indices;
+
+  // Return number of peaks
+  return npeaks;
+}
+
+
+
+int R3Grid::
+FindWorldPeaks(int max_peaks, RNLength world_min_spacing, R3Point *world_positions, RNScalar *values, R3Vector *world_normals,
+  RNScalar min_value, RNBoolean local_maxima_only, RNBoolean subvoxel) const
+{
+  // Find peak entries (suppressing the same entries as RasterizeWorldSphere)
+  int *peak_indices = new int [ (max_peaks > 0) ? max_peaks : 1 ];
+  RNLength grid_radius = world_min_spacing * WorldToGridScaleFactor();
+  int npeaks = FindPeakIndices(this, max_peaks, grid_radius, TRUE, min_value, local_maxima_only, peak_indices);
+
+  // Fill peak info
+  for (int p = 0; p < npeaks; p++) {
+    int i, j, k;
+    IndexToIndices(peak_indices[p], i, j, k);
+    if (world_positions) {
+      if (subvoxel) world_positions[p] = WorldPosition(RefinedPeakPosition(this, i, j, k, TRUE));
+      else world_positions[p] = WorldPosition(i, j, k);
+    }
+    if (values) values[p] = grid_values[peak_indices[p]];
+    if (world_normals) {
+      world_normals[p] = PeakGradientVector(this, i, j, k);
+      world_normals[p].Transform(GridToWorldTransformation());
+      world_normals[p].Normalize();
+    }
+  }
+
+  // Delete peak indices
+  delete [] peak_indices;
+
+  // Return number of peaks
+  return npeaks;
+}
+
+
+
 static R3MeshVertex *
 InterpolatedVertex(const R3Grid *grid, int ix0, int iy0, int iz0, int dim,
   R3Mesh *mesh, R3MeshVertex **vertices, RNScalar isolevel)
@@ -181,6 +181,16 @@ public:
   int ConnectedComponents(RNScalar isolevel = 0, int max_components = 0, int *seeds = NULL, int *sizes = NULL, int *grid_components = NULL);
   int GenerateIsoSurface(RNScalar isolevel, R3Mesh *mesh) const;
 
+  // Peak extraction functions
+  int FindGridPeaks(int max_peaks, RNLength grid_min_spacing, R3Point *grid_positions, RNScalar *values = NULL, R3Vector *grid_normals = NULL,
+    RNScalar min_value = 0, RNBoolean local_maxima_only = FALSE, RNBoolean subvoxel = FALSE) const;
+  int FindWorldPeaks(int max_peaks, RNLength world_min_spacing, R3Point *world_positions, RNScalar *values = NULL, R3Vector *world_normals = NULL,
+    RNScalar min_value = 0, RNBoolean local_maxima_only = FALSE, RNBoolean subvoxel = FALSE) const;
+    // Greedily picks entries greater than min_value in order of decreasing value (ties in index order),
+    // skipping entries within the RasterizeSphere footprint of min_spacing around an earlier peak,
+    // optionally refines positions with parabolic fits and computes normalized gradients as normals,
+    // and returns the number of peaks found (at most max_peaks)
+
   // Debugging functions
   const RNScalar *GridValues(void) const;
   void IndicesToIndex(int i, int j, int k, int& index) const;
@@ -0,0 +1,500 @@
+// Source file for ICP alignment class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3ICPAligner::
+R3ICPAligner(int npoints1, const R3Point *points1, const R3Vector *normals1,
+  int npoints2, const R3Point *points2, const R3Vector *normals2)
+  : npoints1(npoints1),
+    points1(points1),
+    normals1(normals1),
+    kdtree1(NULL),
+    search_tree1(NULL),
+    npoints2(npoints2),
+    points2(points2),
+    normals2(normals2),
+    kdtree2(NULL),
+    search_tree2(NULL),
+    bbox1(R3null_box),
+    objective(R3_ICP_POINT_TO_POINT_OBJECTIVE),
+    kernel(R3_ICP_NO_KERNEL),
+    kernel_parameter(0),
+    nlevels(1),
+    max_iterations(128),
+    convergence_tolerance(1.0E-6),
+    max_distance(0),
+    nthreads(0),
+    niterations(0),
+    converged(FALSE)
+{
+  // Build kdtree for points1 (owned by this aligner, so several can coexist)
+  if (npoints1 > 0) {
+    RNArray<const R3Point *> array1;
+    for (int i = 0; i < npoints1; i++) array1.Insert(&points1[i]);
+    kdtree1 = new R3Kdtree<const R3Point *>(array1);
+  }
+
+  // Build kdtree for points2
+  if (npoints2 > 0) {
+    RNArray<const R3Point *> array2;
+    for (int i = 0; i < npoints2; i++) array2.Insert(&points2[i]);
+    kdtree2 = new R3Kdtree<const R3Point *>(array2);
+  }
+
+  // Compute bounding box of points1
+  for (int i = 0; i < npoints1; i++) bbox1.Union(points1[i]);
+}
+
+
+
+R3ICPAligner::
+~R3ICPAligner(void)
+{
+  // Delete kdtrees
+  if (kdtree1) delete kdtree1;
+  if (kdtree2) delete kdtree2;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Correspondence functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3ICPAlignerCorrespondenceData {
+  const R3ICPAligner *aligner;
+  const R3Affine *affine12;
+  const R3Affine *affine21;
+  int npoints1;
+  R3Point *correspondences1;
+  R3Point *correspondences2;
+  R3Vector *normals2;
+  RNBoolean *found;
+};
+
+
+
+static void
+FindCorrespondence(int index, int, void *data)
+{
+  // Get convenient variables
+  R3ICPAlignerCorrespondenceData *loop = (R3ICPAlignerCorrespondenceData *) data;
+  const R3ICPAligner *aligner = loop->aligner;
+  RNLength max_distance = (aligner->max_distance > 0) ? aligner->max_distance : FLT_MAX;
+  loop->found[index] = FALSE;
+
+  // Check direction
+  if (index < loop->npoints1) {
+    // Find closest point in set2 to transformed point1
+    const R3Point& point1 = aligner->points1[index];
+    R3Point position1 = point1;
+    position1.Transform(*(loop->affine12));
+    if (aligner->search_tree2) {
+      R3MeshIntersection closest;
+      aligner->search_tree2->FindClosest(position1, closest, 0, max_distance);
+      if (closest.type == R3_MESH_NULL_TYPE) return;
+      loop->correspondences2[index] = closest.point;
+      if (loop->normals2) {
+        if (closest.face) loop->normals2[index] = aligner->search_tree2->mesh->FaceNormal(closest.face);
+        else loop->normals2[index] = R3zero_vector;
+      }
+    }
+    else {
+      const R3Point *closest = aligner->kdtree2->FindClosest(position1, 0, max_distance);
+      if (!closest) return;
+      loop->correspondences2[index] = *closest;
+      if (loop->normals2) {
+        if (aligner->normals2) loop->normals2[index] = aligner->normals2[closest - aligner->points2];
+        else loop->normals2[index] = R3zero_vector;
+      }
+    }
+    loop->correspondences1[index] = point1;
+    loop->found[index] = TRUE;
+  }
+  else {
+    // Find closest point in set1 to transformed point2
+    int index2 = index - loop->npoints1;
+    const R3Point& point2 = aligner->points2[index2];
+    R3Point position2 = point2;
+    position2.Transform(*(loop->affine21));
+    if (aligner->search_tree1) {
+      R3MeshIntersection closest;
+      aligner->search_tree1->FindClosest(position2, closest, 0, max_distance);
+      if (closest.type == R3_MESH_NULL_TYPE) return;
+      loop->correspondences1[index] = closest.point;
+    }
+    else {
+      const R3Point *closest = aligner->kdtree1->FindClosest(position2, 0, max_distance);
+      if (!closest) return;
+      loop->correspondences1[index] = *closest;
+    }
+    loop->correspondences2[index] = point2;
+    if (loop->normals2) {
+      if (aligner->normals2) loop->normals2[index] = aligner->normals2[index2];
+      else loop->normals2[index] = R3zero_vector;
+    }
+    loop->found[index] = TRUE;
+  }
+}
+
+
+
+void R3ICPAligner::
+FindCorrespondences(const R3Affine& affine12, const R3Affine& affine21, int npoints1, int npoints2,
+  R3Point *correspondences1, R3Point *correspondences2, R3Vector *normals2, RNBoolean *found) const
+{
+  // Find closest points in both directions in parallel
+  R3ICPAlignerCorrespondenceData data;
+  data.aligner = this;
+  data.affine12 = &affine12;
+  data.affine21 = &affine21;
+  data.npoints1 = npoints1;
+  data.correspondences1 = correspondences1;
+  data.correspondences2 = correspondences2;
+  data.normals2 = normals2;
+  data.found = found;
+
+  // Mesh search trees are not thread-safe, so search them serially
+  int n = (search_tree1 || search_tree2) ? 1 : nthreads;
+  RNParallelFor(npoints1 + npoints2, FindCorrespondence, &data, n, 256);
+}
+
+
+
+int R3ICPAligner::
+CreateCorrespondences(const R3Affine& affine12, R3Point *correspondences1, R3Point *correspondences2,
+  R3Vector *normals2, int npoints1, int npoints2) const
+{
+  // Check number of points
+  if ((npoints1 < 0) || (npoints1 > this->npoints1)) npoints1 = this->npoints1;
+  if ((npoints2 < 0) || (npoints2 > this->npoints2)) npoints2 = this->npoints2;
+  int n = npoints1 + npoints2;
+  if (n == 0) return 0;
+
+  // Find correspondences
+  R3Affine affine21 = affine12.Inverse();
+  RNBoolean *found = new RNBoolean [ n ];
+  FindCorrespondences(affine12, affine21, npoints1, npoints2, correspondences1, correspondences2, normals2, found);
+
+  // Compact correspondences that were found
+  int ncorrespondences = 0;
+  for (int i = 0; i < n; i++) {
+    if (!found[i]) continue;
+    correspondences1[ncorrespondences] = correspondences1[i];
+    correspondences2[ncorrespondences] = correspondences2[i];
+    if (normals2) normals2[ncorrespondences] = normals2[i];
+    ncorrespondences++;
+  }
+
+  // Delete temporary data
+  delete [] found;
+
+  // Return number of correspondences
+  return ncorrespondences;
+}
+
+
+
+RNScalar R3ICPAligner::
+RMSD(const R3Affine& affine12) const
+{
+  // Create correspondences
+  int max_correspondences = npoints1 + npoints2;
+  if (max_correspondences == 0) return RN_INFINITY;
+  R3Point *correspondences1 = new R3Point [ max_correspondences ];
+  R3Point *correspondences2 = new R3Point [ max_correspondences ];
+  int ncorrespondences = CreateCorrespondences(affine12, correspondences1, correspondences2);
+
+  // Add SSD of correspondences
+  RNScalar ssd = 0;
+  for (int i = 0; i < ncorrespondences; i++) {
+    R3Point position1 = correspondences1[i];
+    position1.Transform(affine12);
+    ssd += R3SquaredDistance(position1, correspondences2[i]);
+  }
+
+  // Delete correspondences
+  delete [] correspondences1;
+  delete [] correspondences2;
+
+  // Return RMSD
+  if (ncorrespondences == 0) return RN_INFINITY;
+  return sqrt(ssd / ncorrespondences);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Weighting functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+CompareResiduals(const void *data1, const void *data2)
+{
+  RNScalar r1 = *((const RNScalar *) data1);
+  RNScalar r2 = *((const RNScalar *) data2);
+  if (r1 < r2) return -1;
+  else if (r1 > r2) return 1;
+  else return 0;
+}
+
+
+
+void R3ICPAligner::
+ComputeWeights(const R3Affine& affine12, int ncorrespondences,
+  const R3Point *correspondences1, const R3Point *correspondences2, const R3Vector *normals2,
+  const RNBoolean *found, RNScalar *weights) const
+{
+  // Compute residuals
+  RNScalar *residuals = new RNScalar [ ncorrespondences ];
+  RNScalar *sorted_residuals = new RNScalar [ ncorrespondences ];
+  int nfound = 0;
+  for (int i = 0; i < ncorrespondences; i++) {
+    residuals[i] = RN_INFINITY;
+    if (!found[i]) continue;
+    R3Point position1 = correspondences1[i];
+    position1.Transform(affine12);
+    R3Vector delta = position1 - correspondences2[i];
+    if (normals2) residuals[i] = fabs(delta.Dot(normals2[i]));
+    else residuals[i] = delta.Length();
+    sorted_residuals[nfound++] = residuals[i];
+  }
+
+  // Compute residual threshold/scale for kernel
+  RNScalar scale = kernel_parameter;
+  if ((kernel != R3_ICP_NO_KERNEL) && (nfound > 0)) {
+    qsort(sorted_residuals, nfound, sizeof(RNScalar), CompareResiduals);
+    if (kernel == R3_ICP_TRIMMED_KERNEL) {
+      RNScalar fraction = ((kernel_parameter > 0) && (kernel_parameter <= 1)) ? kernel_parameter : 0.9;
+      int k = (int) (fraction * nfound);
+      if (k >= nfound) k = nfound - 1;
+      scale = sorted_residuals[k];
+    }
+    else if (scale <= 0) {
+      // Estimate scale from median residual
+      scale = 2.5 * 1.4826 * sorted_residuals[nfound / 2];
+      if (scale <= 0) scale = RN_EPSILON;
+    }
+  }
+
+  // Compute weights
+  for (int i = 0; i < ncorrespondences; i++) {
+    RNScalar r = residuals[i];
+    if (!found[i]) weights[i] = 0;
+    else if (kernel == R3_ICP_TRIMMED_KERNEL) weights[i] = (r <= scale) ? 1 : 0;
+    else if (kernel == R3_ICP_HUBER_KERNEL) weights[i] = (r <= scale) ? 1 : scale / r;
+    else if (kernel == R3_ICP_TUKEY_KERNEL) { RNScalar u = r / scale; weights[i] = (u < 1) ? (1 - u*u) * (1 - u*u) : 0; }
+    else weights[i] = 1;
+  }
+
+  // Delete temporary data
+  delete [] residuals;
+  delete [] sorted_residuals;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Point-to-plane functions
+////////////////////////////////////////////////////////////////////////
+
+static RNBoolean
+SolveLinearSystem(int n, RNScalar A[6][6], RNScalar b[6], RNScalar x[6])
+{
+  // Solve A x = b with gaussian elimination and partial pivoting
+  for (int c = 0; c < n; c++) {
+    int pivot = c;
+    for (int r = c+1; r < n; r++) if (fabs(A[r][c]) > fabs(A[pivot][c])) pivot = r;
+    if (fabs(A[pivot][c]) < 1.0E-20) return FALSE;
+    if (pivot != c) {
+      for (int k = 0; k < n; k++) { RNScalar t = A[c][k]; A[c][k] = A[pivot][k]; A[pivot][k] = t; }
+      RNScalar t = b[c]; b[c] = b[pivot]; b[pivot] = t;
+    }
+    for (int r = c+1; r < n; r++) {
+      RNScalar f = A[r][c] / A[c][c];
+      for (int k = c; k < n; k++) A[r][k] -= f * A[c][k];
+      b[r] -= f * b[c];
+    }
+  }
+
+  // Back substitution
+  for (int r = n-1; r >= 0; r--) {
+    RNScalar sum = b[r];
+    for (int k = r+1; k < n; k++) sum -= A[r][k] * x[k];
+    x[r] = sum / A[r][r];
+  }
+
+  // Return success
+  return TRUE;
+}
+
+
+
+R3Affine R3ICPAligner::
+PointToPlaneUpdate(const R3Affine& affine12, int ncorrespondences,
+  const R3Point *correspondences1, const R3Point *correspondences2, const R3Vector *normals2,
+  const RNScalar *weights, RNBoolean translation, RNBoolean rotation) const
+{
+  // Determine unknowns (rx, ry, rz, tx, ty, tz)
+  int first = (rotation) ? 0 : 3;
+  int last = (translation) ? 6 : 3;
+  int n = last - first;
+  if (n <= 0) return affine12;
+
+  // Build normal equations for linearized point-to-plane distances
+  RNScalar A[6][6] = { { 0 } };
+  RNScalar b[6] = { 0 };
+  for (int i = 0; i < ncorrespondences; i++) {
+    if (weights[i] <= 0) continue;
+    const R3Vector& normal = normals2[i];
+    if (normal.IsZero()) continue;
+    R3Point position1 = correspondences1[i];
+    position1.Transform(affine12);
+    R3Vector cross = position1.Vector() % normal;
+    RNScalar row[6] = { cross[0], cross[1], cross[2], normal[0], normal[1], normal[2] };
+    RNScalar rhs = (correspondences2[i] - position1).Dot(normal);
+    for (int j = first; j < last; j++) {
+      for (int k = first; k < last; k++) A[j-first][k-first] += weights[i] * row[j] * row[k];
+      b[j-first] += weights[i] * row[j] * rhs;
+    }
+  }
+
+  // Regularize slightly to handle degenerate configurations (e.g., planes)
+  RNScalar trace = 0;
+  for (int j = 0; j < n; j++) trace += A[j][j];
+  for (int j = 0; j < n; j++) A[j][j] += 1.0E-9 * trace + 1.0E-20;
+
+  // Solve for incremental motion
+  RNScalar x[6] = { 0 };
+  if (!SolveLinearSystem(n, A, b, x)) return affine12;
+  RNScalar motion[6] = { 0 };
+  for (int j = first; j < last; j++) motion[j] = x[j-first];
+
+  // Compose incremental motion with current transformation
+  R3Affine result = R3identity_affine;
+  result.Translate(R3Vector(motion[3], motion[4], motion[5]));
+  R3Vector axis(motion[0], motion[1], motion[2]);
+  RNAngle angle = axis.Length();
+  if (angle > 0) result.Rotate(axis / angle, angle);
+  result.Transform(affine12);
+  return result;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Alignment functions
+////////////////////////////////////////////////////////////////////////
+
+RNBoolean R3ICPAligner::
+Align(R3Affine& affine12, RNBoolean translation, RNBoolean rotation, int scale)
+{
+  // Initialize statistics
+  niterations = 0;
+  converged = FALSE;
+
+  // Check points
+  if ((npoints1 == 0) || (npoints2 == 0)) return FALSE;
+
+  // Determine objective
+  RNBoolean point_to_plane = (objective == R3_ICP_POINT_TO_PLANE_OBJECTIVE) && (scale == 0);
+  if (!normals2 && !search_tree2) point_to_plane = FALSE;
+
+  // Allocate arrays of correspondences
+  int max_correspondences = npoints1 + npoints2;
+  R3Point *correspondences1 = new R3Point [ max_correspondences ];
+  R3Point *correspondences2 = new R3Point [ max_correspondences ];
+  R3Vector *correspondence_normals = (point_to_plane || (kernel != R3_ICP_NO_KERNEL)) ? new R3Vector [ max_correspondences ] : NULL;
+  RNBoolean *found = new RNBoolean [ max_correspondences ];
+  RNScalar *weights = new RNScalar [ max_correspondences ];
+
+  // Compute convergence threshold
+  RNLength threshold = convergence_tolerance * bbox1.DiagonalLength();
+
+  // Iterate over levels of sample pyramid (coarse to fine)
+  for (int level = 0; level < nlevels; level++) {
+    // Determine number of samples at this level (samples are assumed to be in random order)
+    int level_npoints1 = npoints1;
+    int level_npoints2 = npoints2;
+    for (int k = level; k < nlevels-1; k++) { level_npoints1 /= 4; level_npoints2 /= 4; }
+    if (level_npoints1 < 16) level_npoints1 = (npoints1 < 16) ? npoints1 : 16;
+    if (level_npoints2 < 16) level_npoints2 = (npoints2 < 16) ? npoints2 : 16;
+    int level_ncorrespondences = level_npoints1 + level_npoints2;
+
+    // Iterate until converged at this level
+    RNBoolean level_converged = FALSE;
+    for (int iteration = 0; iteration < max_iterations; iteration++) {
+      // Update correspondences
+      R3Affine affine21 = affine12.Inverse();
+      FindCorrespondences(affine12, affine21, level_npoints1, level_npoints2,
+        correspondences1, correspondences2, correspondence_normals, found);
+
+      // Compact correspondences that were found (unfound slots hold stale or uninitialized points)
+      int ncorrespondences = 0;
+      for (int i = 0; i < level_ncorrespondences; i++) {
+        if (!found[i]) continue;
+        correspondences1[ncorrespondences] = correspondences1[i];
+        correspondences2[ncorrespondences] = correspondences2[i];
+        if (correspondence_normals) correspondence_normals[ncorrespondences] = correspondence_normals[i];
+        found[ncorrespondences] = TRUE;
+        ncorrespondences++;
+      }
+
+      // Check number of correspondences
+      if (ncorrespondences == 0) break;
+
+      // Compute weights
+      const R3Vector *residual_normals = (point_to_plane) ? correspondence_normals : NULL;
+      ComputeWeights(affine12, ncorrespondences, correspondences1, correspondences2, residual_normals, found, weights);
+
+      // Update transformation
+      R3Affine previous_affine12 = affine12;
+      if (point_to_plane) {
+        affine12 = PointToPlaneUpdate(affine12, ncorrespondences, correspondences1, correspondences2,
+          correspondence_normals, weights, translation, rotation);
+      }
+      else {
+        R4Matrix matrix = R3AlignPoints(ncorrespondences, correspondences2, correspondences1,
+          weights, translation, rotation, scale);
+        affine12 = R3Affine(matrix, 0);
+      }
+      niterations++;
+
+      // Check for convergence (maximum motion of bounding box corners)
+      RNLength motion = 0;
+      for (int corner = 0; corner < 8; corner++) {
+        R3Point p = bbox1.Corner(corner);
+        R3Point p0 = p; p0.Transform(previous_affine12);
+        R3Point p1 = p; p1.Transform(affine12);
+        RNLength d = R3Distance(p0, p1);
+        if (d > motion) motion = d;
+      }
+      if (motion <= threshold) { level_converged = TRUE; break; }
+    }
+
+    // Remember whether finest level converged
+    if (level == nlevels-1) converged = level_converged;
+  }
+
+  // Delete arrays of correspondences
+  delete [] correspondences1;
+  delete [] correspondences2;
+  if (correspondence_normals) delete [] correspondence_normals;
+  delete [] found;
+  delete [] weights;
+
+  // Return whether converged
+  return converged;
+}
@@ -0,0 +1,209 @@
+// Include file for ICP alignment class
+
+
+
+// Objective functions
+
+#define R3_ICP_POINT_TO_POINT_OBJECTIVE  0
+#define R3_ICP_POINT_TO_PLANE_OBJECTIVE  1
+
+
+
+// Robust kernels
+
+#define R3_ICP_NO_KERNEL                 0
+#define R3_ICP_TRIMMED_KERNEL            1
+#define R3_ICP_HUBER_KERNEL              2
+#define R3_ICP_TUKEY_KERNEL              3
+
+
+
+// Class definition
+
+class R3ICPAligner {
+public:
+  // Constructors/destructors
+  R3ICPAligner(int npoints1, const R3Point *points1, const R3Vector *normals1,
+    int npoints2, const R3Point *points2, const R3Vector *normals2);
+  ~R3ICPAligner(void);
+
+  // Property functions
+  int NPoints1(void) const;
+  int NPoints2(void) const;
+  int NIterations(void) const;
+  RNBoolean IsConverged(void) const;
+
+  // Parameter manipulation functions
+  void SetObjective(int objective);
+    // Point-to-plane uses normals of second point set (falls back to point-to-point without them)
+  void SetKernel(int kernel, RNScalar parameter = 0);
+    // Trimmed parameter is the fraction of correspondences kept (default 0.9),
+    // Huber/Tukey parameter is the residual scale (default estimated from median residual)
+  void SetNLevels(int nlevels);
+    // Number of levels in coarse-to-fine sample pyramid (each level has 4x more samples)
+  void SetMaxIterations(int max_iterations);
+    // Maximum number of iterations per level
+  void SetConvergenceTolerance(RNScalar tolerance);
+    // Converged when points move less than tolerance times bounding box diagonal
+  void SetMaxDistance(RNLength max_distance);
+    // Correspondences further than max_distance are ignored (0 means no limit)
+  void SetSearchTrees(R3MeshSearchTree *tree1, R3MeshSearchTree *tree2);
+    // Find correspondences on mesh surfaces rather than point sets (serial)
+  void SetNThreads(int nthreads);
+
+  // Alignment functions
+  RNBoolean Align(R3Affine& affine12, RNBoolean translation = TRUE, RNBoolean rotation = TRUE, int scale = 0);
+    // Refines affine12 (mapping points1 onto points2), returns whether converged
+  RNScalar RMSD(const R3Affine& affine12) const;
+    // Returns root mean squared distance of symmetric closest point correspondences
+  int CreateCorrespondences(const R3Affine& affine12,
+    R3Point *correspondences1, R3Point *correspondences2,
+    R3Vector *normals2 = NULL, int npoints1 = -1, int npoints2 = -1) const;
+    // Fills arrays (npoints1 + npoints2 entries) with symmetric closest point correspondences
+
+public:
+  // Internal functions
+  void FindCorrespondences(const R3Affine& affine12, const R3Affine& affine21, int npoints1, int npoints2,
+    R3Point *correspondences1, R3Point *correspondences2, R3Vector *normals2, RNBoolean *found) const;
+  void ComputeWeights(const R3Affine& affine12, int ncorrespondences,
+    const R3Point *correspondences1, const R3Point *correspondences2, const R3Vector *normals2,
+    const RNBoolean *found, RNScalar *weights) const;
+  R3Affine PointToPlaneUpdate(const R3Affine& affine12, int ncorrespondences,
+    const R3Point *correspondences1, const R3Point *correspondences2, const R3Vector *normals2,
+    const RNScalar *weights, RNBoolean translation, RNBoolean rotation) const;
+
+public:
+  int npoints1;
+  const R3Point *points1;
+  const R3Vector *normals1;
+  R3Kdtree<const R3Point *> *kdtree1;
+  R3MeshSearchTree *search_tree1;
+  int npoints2;
+  const R3Point *points2;
+  const R3Vector *normals2;
+  R3Kdtree<const R3Point *> *kdtree2;
+  R3MeshSearchTree *search_tree2;
+  R3Box bbox1;
+  int objective;
+  int kernel;
+  RNScalar kernel_parameter;
+  int nlevels;
+  int max_iterations;
+  RNScalar convergence_tolerance;
+  RNLength max_distance;
+  int nthreads;
+  int niterations;
+  RNBoolean converged;
+};
+
+
+
+// Inline functions
+
+inline int R3ICPAligner::
+NPoints1(void) const
+{
+  // Return number of points in first set
+  return npoints1;
+}
+
+
+
+inline int R3ICPAligner::
+NPoints2(void) const
+{
+  // Return number of points in second set
+  return npoints2;
+}
+
+
+
+inline int R3ICPAligner::
+NIterations(void) const
+{
+  // Return number of iterations executed by last call to Align
+  return niterations;
+}
+
+
+
+inline RNBoolean R3ICPAligner::
+IsConverged(void) const
+{
+  // Return whether last call to Align converged
+  return converged;
+}
+
+
+
+inline void R3ICPAligner::
+SetObjective(int objective)
+{
+  // Set objective function
+  this->objective = objective;
+}
+
+
+
+inline void R3ICPAligner::
+SetKernel(int kernel, RNScalar parameter)
+{
+  // Set robust kernel
+  this->kernel = kernel;
+  this->kernel_parameter = parameter;
+}
+
+
+
+inline void R3ICPAligner::
+SetNLevels(int nlevels)
+{
+  // Set number of pyramid levels
+  this->nlevels = (nlevels > 0) ? nlevels : 1;
+}
+
+
+
+inline void R3ICPAligner::
+SetMaxIterations(int max_iterations)
+{
+  // Set maximum number of iterations per level
+  this->max_iterations = max_iterations;
+}
+
+
+
+inline void R3ICPAligner::
+SetConvergenceTolerance(RNScalar tolerance)
+{
+  // Set convergence tolerance
+  this->convergence_tolerance = tolerance;
+}
+
+
+
+inline void R3ICPAligner::
+SetMaxDistance(RNLength max_distance)
+{
+  // Set maximum correspondence distance
+  this->max_distance = max_distance;
+}
+
+
+
+inline void R3ICPAligner::
+SetSearchTrees(R3MeshSearchTree *tree1, R3MeshSearchTree *tree2)
+{
+  // Set mesh search trees
+  this->search_tree1 = tree1;
+  this->search_tree2 = tree2;
+}
+
+
+
+inline void R3ICPAligner::
+SetNThreads(int nthreads)
+{
+  // Set number of threads (0 means default)
+  this->nthreads = nthreads;
+}
@@ -548,21 +548,38 @@ FindClosest(R3KdtreeNode<PtrType> *node, const R3Box& node_box,
     // Compute distance from point to split plane
     RNLength side = query_position[node->split_dimension] - node->split_coordinate;
 
-    // Search children nodes
-    if ((side <= 0) || (side*side <= max_distance_squared)) {
-      // Search negative side 
+    // Search children nodes (on side of query first, so that max distance shrinks quickly)
+    if (side <= 0) {
+      // Search negative side first
       R3Box child_box(node_box);
       child_box[RN_HI][node->split_dimension] = node->split_coordinate;
       FindClosest(node->children[0], child_box, query_point, query_position, 
         min_distance_squared, max_distance_squared, max_points, IsCompatible, compatible_data,
         points, distances_squared);
+      if (points.NEntries() == max_points) max_distance_squared = distances_squared[max_points-1];
+      if (side*side <= max_distance_squared) {
+        R3Box child_box(node_box);
+        child_box[RN_LO][node->split_dimension] = node->split_coordinate;
+        FindClosest(node->children[1], child_box, query_point, query_position, 
+          min_distance_squared, max_distance_squared, max_points, IsCompatible, compatible_data,
+          points, distances_squared);
+      }
     }
-    if ((side >= 0) || (side*side <= max_distance_squared)) {
+    else {
+      // Search positive side first
       R3Box child_box(node_box);
       child_box[RN_LO][node->split_dimension] = node->split_coordinate;
       FindClosest(node->children[1], child_box, query_point, query_position, 
         min_distance_squared, max_distance_squared, max_points, IsCompatible, compatible_data,
         points, distances_squared);
+      if (points.NEntries() == max_points) max_distance_squared = distances_squared[max_points-1];
+      if (side*side <= max_distance_squared) {
+        R3Box child_box(node_box);
+        child_box[RN_HI][node->split_dimension] = node->split_coordinate;
+        FindClosest(node->children[0], child_box, query_point, query_position, 
+          min_distance_squared, max_distance_squared, max_points, IsCompatible, compatible_data,
+          points, distances_squared);
+      }
     }
   }
   else {
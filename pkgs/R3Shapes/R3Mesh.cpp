@@ -1605,46 +1605,260 @@ MergeVertex(R3MeshVertex *v1, R3MeshVertex *v2)
 
 
 
+static int
+R3MeshFindMergeRoot(int *parents, int i)
+{
+  // Find root of union-find set (with path halving)
+  while (parents[i] != i) {
+    parents[i] = parents[parents[i]];
+    i = parents[i];
+  }
+  return i;
+}
+
+
+
+struct R3MeshMergeCell {
+  int coords[3];
+  int head;
+};
+
+
+
+static R3MeshMergeCell *
+R3MeshFindMergeCell(R3MeshMergeCell *cells, int table_size, int cx, int cy, int cz)
+{
+  // Return cell in hash table (or empty cell where it would be inserted)
+  unsigned int hash = ((unsigned int) cx * 73856093U) ^ ((unsigned int) cy * 19349663U) ^ ((unsigned int) cz * 83492791U);
+  int slot = (int) (hash & (unsigned int) (table_size - 1));
+  while (cells[slot].head >= 0) {
+    const int *coords = cells[slot].coords;
+    if ((coords[0] == cx) && (coords[1] == cy) && (coords[2] == cz)) return &cells[slot];
+    slot = (slot + 1) & (table_size - 1);
+  }
+  return &cells[slot];
+}
+
+
+
 void R3Mesh::
 MergeCoincidentVertices(RNLength epsilon)
 {
+  // Check number of vertices
+  int nvertices = NVertices();
+  if (nvertices < 2) return;
+
   // Compute epsilon
   if (epsilon < 0.0) epsilon = 0.0001 * bbox.DiagonalLength();
-
-  // Load all vertices into a regular grid
-  const int NUM_GRID_CELLS = 32;
-  RNArray<R3MeshVertex *> grid[NUM_GRID_CELLS][NUM_GRID_CELLS][NUM_GRID_CELLS];
-  for (int i = 0; i < vertices.NEntries(); i++) {
-    R3MeshVertex *v = vertices[i];
-    const R3Point& p = v->position;
-    int ix = (int) (NUM_GRID_CELLS * (p.X() - bbox.XMin()) / bbox.XLength());
-    int iy = (int) (NUM_GRID_CELLS * (p.Y() - bbox.YMin()) / bbox.YLength());
-    int iz = (int) (NUM_GRID_CELLS * (p.Z() - bbox.ZMin()) / bbox.ZLength());
-    if (ix < 0) ix = 0; else if (ix > NUM_GRID_CELLS-1) ix = NUM_GRID_CELLS-1;
-    if (iy < 0) iy = 0; else if (iy > NUM_GRID_CELLS-1) iy = NUM_GRID_CELLS-1;
-    if (iz < 0) iz = 0; else if (iz > NUM_GRID_CELLS-1) iz = NUM_GRID_CELLS-1;
-    grid[ix][iy][iz].Insert(v);
-  }
-
-  // Merge coincident vertices in same grid cell
-  for (int ix = 0; ix < NUM_GRID_CELLS; ix++) {
-    for (int iy = 0; iy < NUM_GRID_CELLS; iy++) {
-      for (int iz = 0; iz < NUM_GRID_CELLS; iz++) {
-        // Consider all pairs of vertices in same cell
-        for (int j = 0; j < grid[ix][iy][iz].NEntries(); j++) {
-          R3MeshVertex *v1 = grid[ix][iy][iz].Kth(j);
-          for (int k = j+1; k < grid[ix][iy][iz].NEntries(); k++) {
-            R3MeshVertex *v2 = grid[ix][iy][iz].Kth(k);
-            // Check if vertices are coincident
-            if (R3Contains(v1->position, v2->position)) {
-              // Merge coincident vertices
-              MergeVertex(v1, v2);
-            }
+  RNLength epsilon_squared = epsilon * epsilon;
+
+  // Compute size of hash cells (several times epsilon, so that vertices
+  // within epsilon are in the same or adjacent cells, and few vertices
+  // are within epsilon of the sides of their cells)
+  RNLength cell_size = 4 * epsilon;
+  RNLength min_cell_size = bbox.LongestAxisLength() / (1 << 30);
+  if (cell_size < min_cell_size) cell_size = min_cell_size;
+  if (cell_size <= 0) cell_size = 1;
+  const R3Point& origin = bbox.Min();
+
+  // Allocate hash table of cells with linked lists of vertices
+  int table_size = 1;
+  while (table_size < 2 * nvertices) table_size *= 2;
+  R3MeshMergeCell *cells = new R3MeshMergeCell [ table_size ];
+  for (int i = 0; i < table_size; i++) cells[i].head = -1;
+  int *next_vertices = new int [ nvertices ];
+  int *parents = new int [ nvertices ];
+
+  // Copy vertex positions into one array (for locality)
+  R3Point *positions = new R3Point [ nvertices ];
+  for (int i = 0; i < nvertices; i++) positions[i] = vertices[i]->position;
+
+  // Union each vertex with previous vertices within epsilon in its own and adjacent cells
+  int nmerged = 0;
+  for (int i = 0; i < nvertices; i++) {
+    const R3Point& position = positions[i];
+    RNCoord x = (position.X() - origin.X()) / cell_size;
+    RNCoord y = (position.Y() - origin.Y()) / cell_size;
+    RNCoord z = (position.Z() - origin.Z()) / cell_size;
+    int cx = (int) floor(x);
+    int cy = (int) floor(y);
+    int cz = (int) floor(z);
+    parents[i] = i;
+
+    // Compute range of cells overlapped by the epsilon ball around vertex
+    RNScalar r = epsilon / cell_size;
+    int x1 = (x - r < cx) ? cx-1 : cx, x2 = (x + r >= cx+1) ? cx+1 : cx;
+    int y1 = (y - r < cy) ? cy-1 : cy, y2 = (y + r >= cy+1) ? cy+1 : cy;
+    int z1 = (z - r < cz) ? cz-1 : cz, z2 = (z + r >= cz+1) ? cz+1 : cz;
+
+    // Check cells in range
+    for (int ix = x1; ix <= x2; ix++) {
+      for (int iy = y1; iy <= y2; iy++) {
+        for (int iz = z1; iz <= z2; iz++) {
+          R3MeshMergeCell *cell = R3MeshFindMergeCell(cells, table_size, ix, iy, iz);
+          for (int j = cell->head; j >= 0; j = next_vertices[j]) {
+            if (R3SquaredDistance(position, positions[j]) > epsilon_squared) continue;
+            int root_i = R3MeshFindMergeRoot(parents, i);
+            int root_j = R3MeshFindMergeRoot(parents, j);
+            if (root_i == root_j) continue;
+            if (root_i < root_j) parents[root_j] = root_i;
+            else parents[root_i] = root_j;
+            nmerged++;
           }
         }
       }
     }
+
+    // Insert vertex into its cell
+    R3MeshMergeCell *cell = R3MeshFindMergeCell(cells, table_size, cx, cy, cz);
+    if (cell->head < 0) {
+      cell->coords[0] = cx;
+      cell->coords[1] = cy;
+      cell->coords[2] = cz;
+    }
+    next_vertices[i] = cell->head;
+    cell->head = i;
+  }
+
+  // Delete hash table
+  delete [] cells;
+  delete [] next_vertices;
+  delete [] positions;
+
+  // Check if found any coincident vertices
+  if (nmerged == 0) {
+    delete [] parents;
+    return;
   }
+
+  // Find representative vertex of every set (the one with the smallest index)
+  for (int i = 0; i < nvertices; i++) {
+    parents[i] = R3MeshFindMergeRoot(parents, i);
+  }
+
+  // Remember vertices (indices change as merged vertices are deleted)
+  R3MeshVertex **vertex_pointers = new R3MeshVertex * [ nvertices ];
+  for (int i = 0; i < nvertices; i++) {
+    vertex_pointers[i] = vertices[i];
+  }
+
+  // Merge attributes into representatives (positions and colors are averaged,
+  // normals are averaged over the vertices whose normals are up to date,
+  // and texture coordinates are taken from the representative)
+  int *counts = new int [ nvertices ];
+  int *normal_counts = new int [ nvertices ];
+  for (int i = 0; i < nvertices; i++) {
+    R3MeshVertex *vertex = vertex_pointers[i];
+    int r = parents[i];
+    R3MeshVertex *representative = vertex_pointers[r];
+    RNBoolean normal_uptodate = vertex->flags[R3_MESH_VERTEX_NORMAL_UPTODATE];
+    if (r == i) {
+      counts[i] = 1;
+      normal_counts[i] = (normal_uptodate) ? 1 : 0;
+    }
+    else {
+      int count = ++counts[r];
+      representative->position += (vertex->position - representative->position) / count;
+      representative->color += (vertex->color - representative->color) / count;
+      if (normal_uptodate) {
+        if (normal_counts[r] == 0) representative->normal = vertex->normal;
+        else representative->normal += vertex->normal;
+        normal_counts[r]++;
+      }
+    }
+  }
+
+  // Find faces with merged vertices and their representatives (other faces keep their vertices and edges)
+  RNArray<R3MeshFace *> relink_faces;
+  RNArray<R3MeshVertex *> relink_vertices;
+  for (int i = 0; i < NFaces(); i++) {
+    R3MeshFace *face = faces[i];
+    int v0 = face->vertex[0]->id, v1 = face->vertex[1]->id, v2 = face->vertex[2]->id;
+    if ((parents[v0] == v0) && (parents[v1] == v1) && (parents[v2] == v2)) continue;
+    relink_faces.Insert(face);
+    relink_vertices.Insert(vertex_pointers[parents[v0]]);
+    relink_vertices.Insert(vertex_pointers[parents[v1]]);
+    relink_vertices.Insert(vertex_pointers[parents[v2]]);
+  }
+
+  // Detach these faces from their edges
+  for (int i = 0; i < relink_faces.NEntries(); i++) {
+    R3MeshFace *face = relink_faces.Kth(i);
+    for (int k = 0; k < 3; k++) {
+      R3MeshEdge *edge = face->edge[k];
+      if (edge->face[0] == face) edge->face[0] = NULL;
+      if (edge->face[1] == face) edge->face[1] = NULL;
+    }
+  }
+
+  // Delete merged vertices (their edges are no longer attached to any face)
+  for (int i = 0; i < nvertices; i++) {
+    if (parents[i] != i) DeleteVertex(vertex_pointers[i]);
+  }
+
+  // Relink faces to representatives, deleting ones that collapsed
+  RNArray<R3MeshFace *> degenerate_triangle_faces;
+  RNArray<R3MeshVertex *> degenerate_triangle_vertices;
+  for (int i = 0; i < relink_faces.NEntries(); i++) {
+    R3MeshFace *face = relink_faces.Kth(i);
+    R3MeshVertex *v1 = relink_vertices.Kth(3*i+0);
+    R3MeshVertex *v2 = relink_vertices.Kth(3*i+1);
+    R3MeshVertex *v3 = relink_vertices.Kth(3*i+2);
+    if ((v1 == v2) || (v2 == v3) || (v1 == v3)) { DeallocateFace(face); continue; }
+    if (RelinkFace(face, v1, v2, v3)) continue;
+
+    // Must have been degeneracy (e.g., flips or three faces sharing an edge)
+    degenerate_triangle_faces.Insert(face);
+    degenerate_triangle_vertices.Insert(v1);
+    degenerate_triangle_vertices.Insert(v2);
+    degenerate_triangle_vertices.Insert(v3);
+  }
+
+  // Relink degenerate triangles (as the file readers do)
+  for (int i = 0; i < degenerate_triangle_faces.NEntries(); i++) {
+    R3MeshFace *face = degenerate_triangle_faces.Kth(i);
+    R3MeshVertex *v1 = degenerate_triangle_vertices.Kth(3*i+0);
+    R3MeshVertex *v2 = degenerate_triangle_vertices.Kth(3*i+1);
+    R3MeshVertex *v3 = degenerate_triangle_vertices.Kth(3*i+2);
+    if (RelinkFace(face, v1, v2, v3)) continue;
+    if (RelinkFace(face, v1, v3, v2)) continue;
+    R3MeshVertex *v1a = CreateVertex(*v1);
+    R3MeshVertex *v2a = CreateVertex(*v2);
+    R3MeshVertex *v3a = CreateVertex(*v3);
+    RelinkFace(face, v1a, v2a, v3a);
+  }
+
+  // Delete edges of representatives left without faces (by faces that collapsed or failed to relink)
+  for (int i = 0; i < relink_vertices.NEntries(); i++) {
+    R3MeshVertex *vertex = relink_vertices.Kth(i);
+    for (int j = vertex->edges.NEntries() - 1; j >= 0; j--) {
+      R3MeshEdge *edge = vertex->edges.Kth(j);
+      if (!edge->face[0] && !edge->face[1]) DeleteEdge(edge);
+    }
+  }
+
+  // Invalidate properties of faces and edges around moved representatives
+  for (int i = 0; i < nvertices; i++) {
+    if ((parents[i] != i) || (counts[i] == 1)) continue;
+    R3MeshVertex *vertex = vertex_pointers[i];
+    SetVertexPosition(vertex, vertex->position);
+  }
+
+  // Set merged normals (creating faces marked them out of date)
+  for (int i = 0; i < nvertices; i++) {
+    if (parents[i] != i) continue;
+    if (normal_counts[i] == 0) continue;
+    R3MeshVertex *vertex = vertex_pointers[i];
+    R3Vector normal = vertex->normal;
+    normal.Normalize();
+    SetVertexNormal(vertex, normal);
+  }
+
+  // Delete temporary memory
+  delete [] counts;
+  delete [] normal_counts;
+  delete [] vertex_pointers;
+  delete [] parents;
 }
 
 
@@ -2160,7 +2374,7 @@ SwapEdge(R3MeshEdge *edge)
   edge->vertex[0] = vf[0];
   edge->vertex[1] = vf[1];
   edge->length = 0;
-  edge->flags = 0;
+  edge->flags.Remove(R3_MESH_EDGE_LENGTH_UPTODATE);
 
   // Update faces
   UpdateFaceRefs(f[0], vf[0], vf[1], v[1], edge, ef[1][1], ef[0][1]);
@@ -6453,6 +6667,34 @@ UpdateFaceRefs(R3MeshFace *f,
   v2->flags.Remove(R3_MESH_VERTEX_NORMAL_UPTODATE | R3_MESH_VERTEX_CURVATURE_UPTODATE);
   v3->flags.Remove(R3_MESH_VERTEX_NORMAL_UPTODATE | R3_MESH_VERTEX_CURVATURE_UPTODATE);
 }
+
+
+
+RNBoolean R3Mesh::
+RelinkFace(R3MeshFace *f, R3MeshVertex *v1, R3MeshVertex *v2, R3MeshVertex *v3)
+{
+  // Get/create edges
+  R3MeshEdge *e1 = EdgeBetweenVertices(v1, v2);
+  if (!e1) e1 = CreateEdge(v1, v2);
+  R3MeshEdge *e2 = EdgeBetweenVertices(v2, v3);
+  if (!e2) e2 = CreateEdge(v2, v3);
+  R3MeshEdge *e3 = EdgeBetweenVertices(v3, v1);
+  if (!e3) e3 = CreateEdge(v3, v1);
+
+  // Check if another face is on the same side of an edge
+  if ((e1->vertex[0] == v1) && e1->face[0]) return FALSE;
+  if ((e1->vertex[0] == v2) && e1->face[1]) return FALSE;
+  if ((e2->vertex[0] == v2) && e2->face[0]) return FALSE;
+  if ((e2->vertex[0] == v3) && e2->face[1]) return FALSE;
+  if ((e3->vertex[0] == v3) && e3->face[0]) return FALSE;
+  if ((e3->vertex[0] == v1) && e3->face[1]) return FALSE;
+
+  // Update face pointers (keeping face ID)
+  UpdateFaceRefs(f, v1, v2, v3, e1, e2, e3);
+
+  // Return success
+  return TRUE;
+}
  
    
 
@@ -448,7 +448,9 @@ class R3Mesh {
     virtual R3MeshVertex *MergeVertex(R3MeshVertex *v1, R3MeshVertex *v2);
       // Merge vertex v2 into vertex v1 (v2 is deleted)
     virtual void MergeCoincidentVertices(RNLength epsilon = -1.0);
-      // Merge all vertices within epsilon of each other (negative epsilon says "select epsilon automatically")
+      // Merge all vertices within epsilon of each other, transitively (negative epsilon says "select epsilon automatically"),
+      // averaging positions, colors, and up-to-date normals, and dropping faces that collapse (vertex IDs change,
+      // and the last faces take the IDs of dropped ones), only faces with merged vertices are relinked
     virtual R3MeshVertex *CollapseEdge(R3MeshEdge *edge, const R3Point& point);
       // Collapses an edge into a vertex at point
     virtual R3MeshVertex *CollapseFace(R3MeshFace *face, const R3Point& point);
@@ -663,6 +665,7 @@ class R3Mesh {
     virtual void UpdateFaceBBox(R3MeshFace *f) const;  
     virtual void UpdateFaceRefs(R3MeshFace *f, R3MeshVertex *v1, R3MeshVertex *v2, R3MeshVertex *v3,
                                 R3MeshEdge *e1, R3MeshEdge *e2, R3MeshEdge *e3);
+    virtual RNBoolean RelinkFace(R3MeshFace *f, R3MeshVertex *v1, R3MeshVertex *v2, R3MeshVertex *v3);
   
   protected:
     // Arrays of all vertices, edges, faces
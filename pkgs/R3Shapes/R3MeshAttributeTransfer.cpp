@@ -0,0 +1,551 @@
+// Source file for mesh attribute transfer class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Hierarchy parameters
+////////////////////////////////////////////////////////////////////////
+
+// Maximum number of faces in a leaf (one batch of distance computations)
+static const int max_faces_per_leaf = 8;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3MeshAttributeTransfer::
+R3MeshAttributeTransfer(R3Mesh *source_mesh)
+  : mesh(source_mesh),
+    interpolation(R3_MESH_TRANSFER_BARYCENTRIC_INTERPOLATION),
+    max_distance(0),
+    max_normal_angle(0),
+    nthreads(0),
+    nfaces(0),
+    faces(NULL),
+    hierarchy()
+{
+  // Initialize face arrays
+  for (int i = 0; i < 9; i++) face_coordinates[i] = NULL;
+  for (int i = 0; i < 3; i++) face_normals[i] = NULL;
+
+  // Build bounding hierarchy over source faces
+  BuildHierarchy();
+}
+
+
+
+R3MeshAttributeTransfer::
+~R3MeshAttributeTransfer(void)
+{
+  // Delete face arrays
+  if (faces) delete [] faces;
+  for (int i = 0; i < 9; i++) if (face_coordinates[i]) delete [] face_coordinates[i];
+  for (int i = 0; i < 3; i++) if (face_normals[i]) delete [] face_normals[i];
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Hierarchy construction functions
+////////////////////////////////////////////////////////////////////////
+
+void R3MeshAttributeTransfer::
+BuildHierarchy(void)
+{
+  // Check mesh
+  nfaces = (mesh) ? mesh->NFaces() : 0;
+  if (nfaces == 0) return;
+
+  // Build hierarchy over face boxes
+  double *face_boxes = new double [ 6 * nfaces ];
+  R3Point *centroids = new R3Point [ nfaces ];
+  for (int i = 0; i < nfaces; i++) {
+    R3MeshFace *face = mesh->Face(i);
+    const R3Box& bbox = mesh->FaceBBox(face);
+    for (int dim = 0; dim < 3; dim++) {
+      face_boxes[6*i+dim] = bbox[RN_LO][dim];
+      face_boxes[6*i+3+dim] = bbox[RN_HI][dim];
+    }
+    centroids[i] = mesh->FaceCentroid(face);
+  }
+  hierarchy.Build(face_boxes, centroids, nfaces, max_faces_per_leaf);
+  delete [] face_boxes;
+  delete [] centroids;
+
+  // Get faces in hierarchy order
+  faces = new R3MeshFace * [ nfaces ];
+  for (int i = 0; i < nfaces; i++) faces[i] = mesh->Face(hierarchy.Face(i));
+
+  // Copy face coordinates and normals into structure of arrays in hierarchy order
+  for (int i = 0; i < 9; i++) face_coordinates[i] = new double [ nfaces ];
+  for (int i = 0; i < 3; i++) face_normals[i] = new double [ nfaces ];
+  for (int i = 0; i < nfaces; i++) {
+    R3MeshFace *face = faces[i];
+    for (int k = 0; k < 3; k++) {
+      const R3Point& position = mesh->VertexPosition(mesh->VertexOnFace(face, k));
+      for (int dim = 0; dim < 3; dim++) face_coordinates[3*k+dim][i] = position[dim];
+    }
+    const R3Vector& normal = mesh->FaceNormal(face);
+    for (int dim = 0; dim < 3; dim++) face_normals[dim][i] = normal[dim];
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Correspondence functions
+////////////////////////////////////////////////////////////////////////
+
+static R3Point
+ClosestBarycentrics(const R3Point& p, const R3Point& a, const R3Point& b, const R3Point& c)
+{
+  // Check vertex region of a
+  R3Vector ab = b - a;
+  R3Vector ac = c - a;
+  R3Vector ap = p - a;
+  RNScalar d1 = ab.Dot(ap);
+  RNScalar d2 = ac.Dot(ap);
+  if ((d1 <= 0) && (d2 <= 0)) return R3Point(1, 0, 0);
+
+  // Check vertex region of b
+  R3Vector bp = p - b;
+  RNScalar d3 = ab.Dot(bp);
+  RNScalar d4 = ac.Dot(bp);
+  if ((d3 >= 0) && (d4 <= d3)) return R3Point(0, 1, 0);
+
+  // Check edge region of ab
+  RNScalar vc = d1*d4 - d3*d2;
+  if ((vc <= 0) && (d1 >= 0) && (d3 <= 0)) {
+    RNScalar v = (d1 - d3 > 0) ? d1 / (d1 - d3) : 0;
+    return R3Point(1 - v, v, 0);
+  }
+
+  // Check vertex region of c
+  R3Vector cp = p - c;
+  RNScalar d5 = ab.Dot(cp);
+  RNScalar d6 = ac.Dot(cp);
+  if ((d6 >= 0) && (d5 <= d6)) return R3Point(0, 0, 1);
+
+  // Check edge region of ac
+  RNScalar vb = d5*d2 - d1*d6;
+  if ((vb <= 0) && (d2 >= 0) && (d6 <= 0)) {
+    RNScalar w = (d2 - d6 > 0) ? d2 / (d2 - d6) : 0;
+    return R3Point(1 - w, 0, w);
+  }
+
+  // Check edge region of bc
+  RNScalar va = d3*d6 - d5*d4;
+  if ((va <= 0) && (d4 - d3 >= 0) && (d5 - d6 >= 0)) {
+    RNScalar denom = (d4 - d3) + (d5 - d6);
+    RNScalar w = (denom > 0) ? (d4 - d3) / denom : 0;
+    return R3Point(0, 1 - w, w);
+  }
+
+  // Point projects inside face
+  RNScalar denom = va + vb + vc;
+  if (denom <= 0) return R3Point(1, 0, 0);
+  RNScalar v = vb / denom;
+  RNScalar w = vc / denom;
+  return R3Point(1 - v - w, v, w);
+}
+
+
+
+void R3MeshAttributeTransfer::
+FindCorrespondence(const R3Point& position, const R3Vector *normal, R3MeshTransferSample& sample) const
+{
+  // Initialize sample
+  sample.face = NULL;
+  sample.barycentrics = R3zero_point;
+  sample.position = position;
+  sample.distance = RN_INFINITY;
+  if (hierarchy.NNodes() == 0) return;
+
+  // Get normal compatibility threshold
+  R3Vector query_normal = R3zero_vector;
+  RNScalar min_dot = -RN_INFINITY;
+  if (normal && (max_normal_angle > 0)) {
+    query_normal = *normal;
+    query_normal.Normalize();
+    if (!query_normal.IsZero()) min_dot = cos(max_normal_angle);
+  }
+
+  // Traverse hierarchy, visiting nearer children first
+  double best_distance = (max_distance > 0) ? max_distance : RN_INFINITY;
+  int best_face = -1;
+  double distances[max_faces_per_leaf];
+  int stack[R3FaceHierarchy::max_stack_size];
+  int nstack = 0;
+  stack[nstack++] = 0;
+  while (nstack > 0) {
+    // Pop node and check its distance
+    int node = stack[--nstack];
+    if (R3FaceHierarchy::BoxDistanceSquared(hierarchy.NodeBox(node), position) >= best_distance * best_distance) continue;
+
+    // Check if interior node
+    if (hierarchy.NodeChild(node, 0) >= 0) {
+      int child0 = hierarchy.NodeChild(node, 0);
+      int child1 = hierarchy.NodeChild(node, 1);
+      RNScalar d0 = R3FaceHierarchy::BoxDistanceSquared(hierarchy.NodeBox(child0), position);
+      RNScalar d1 = R3FaceHierarchy::BoxDistanceSquared(hierarchy.NodeBox(child1), position);
+      assert(nstack + 2 <= R3FaceHierarchy::max_stack_size);
+      if (d0 <= d1) { stack[nstack++] = child1; stack[nstack++] = child0; }
+      else { stack[nstack++] = child0; stack[nstack++] = child1; }
+      continue;
+    }
+
+    // Compute distances to all faces in leaf with one batch
+    int first = hierarchy.NodeFirstFace(node);
+    int n = hierarchy.NodeNFaces(node);
+    R3TriangleBatch<double> batch;
+    batch.x0 = &face_coordinates[0][first]; batch.y0 = &face_coordinates[1][first]; batch.z0 = &face_coordinates[2][first];
+    batch.x1 = &face_coordinates[3][first]; batch.y1 = &face_coordinates[4][first]; batch.z1 = &face_coordinates[5][first];
+    batch.x2 = &face_coordinates[6][first]; batch.y2 = &face_coordinates[7][first]; batch.z2 = &face_coordinates[8][first];
+    R3Distances(position, batch, n, distances);
+
+    // Update closest compatible face
+    for (int i = 0; i < n; i++) {
+      if (distances[i] >= best_distance) continue;
+      if (min_dot > -RN_INFINITY) {
+        int f = first + i;
+        RNScalar dot = face_normals[0][f]*query_normal[0] + face_normals[1][f]*query_normal[1] + face_normals[2][f]*query_normal[2];
+        if (dot < min_dot) continue;
+      }
+      best_distance = distances[i];
+      best_face = first + i;
+    }
+  }
+
+  // Check if found face
+  if (best_face < 0) return;
+
+  // Compute closest point and its barycentric coordinates
+  R3Point p0(face_coordinates[0][best_face], face_coordinates[1][best_face], face_coordinates[2][best_face]);
+  R3Point p1(face_coordinates[3][best_face], face_coordinates[4][best_face], face_coordinates[5][best_face]);
+  R3Point p2(face_coordinates[6][best_face], face_coordinates[7][best_face], face_coordinates[8][best_face]);
+  R3Point b = ClosestBarycentrics(position, p0, p1, p2);
+  sample.face = faces[best_face];
+  sample.barycentrics = b;
+  sample.position.Reset(b[0]*p0[0] + b[1]*p1[0] + b[2]*p2[0],
+    b[0]*p0[1] + b[1]*p1[1] + b[2]*p2[1], b[0]*p0[2] + b[1]*p1[2] + b[2]*p2[2]);
+  sample.distance = best_distance;
+}
+
+
+
+struct R3MeshTransferQueryData {
+  const R3MeshAttributeTransfer *transfer;
+  const R3Point *positions;
+  const R3Vector *normals;
+  R3MeshTransferSample *samples;
+};
+
+
+
+static void
+FindTransferCorrespondence(int index, int thread_index, void *data)
+{
+  // Find closest compatible point for one query (hierarchy is read-only, so queries can run concurrently)
+  R3MeshTransferQueryData *query_data = (R3MeshTransferQueryData *) data;
+  const R3Vector *normal = (query_data->normals) ? &query_data->normals[index] : NULL;
+  query_data->transfer->FindCorrespondence(query_data->positions[index], normal, query_data->samples[index]);
+}
+
+
+
+int R3MeshAttributeTransfer::
+FindCorrespondences(int npoints, const R3Point *positions, const R3Vector *normals,
+  R3MeshTransferSample *samples) const
+{
+  // Find correspondences in parallel batches of queries
+  R3MeshTransferQueryData data;
+  data.transfer = this;
+  data.positions = positions;
+  data.normals = normals;
+  data.samples = samples;
+  RNParallelFor(npoints, FindTransferCorrespondence, &data, nthreads, 256);
+
+  // Count correspondences
+  int count = 0;
+  for (int i = 0; i < npoints; i++) {
+    if (samples[i].face) count++;
+  }
+
+  // Return number of correspondences
+  return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Interpolation functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+NearestVertexOnFace(const R3MeshTransferSample& sample)
+{
+  // Return index of vertex with largest barycentric coordinate
+  return sample.barycentrics.Vector().MaxDimension();
+}
+
+
+
+RNRgb R3MeshAttributeTransfer::
+SampleColor(const R3MeshTransferSample& sample) const
+{
+  // Check sample
+  if (!sample.face) return RNblack_rgb;
+
+  // Check interpolation
+  if (interpolation == R3_MESH_TRANSFER_NEAREST_VERTEX_INTERPOLATION) {
+    return mesh->VertexColor(mesh->VertexOnFace(sample.face, NearestVertexOnFace(sample)));
+  }
+
+  // Blend colors of face vertices
+  RNRgb color(0, 0, 0);
+  for (int k = 0; k < 3; k++) {
+    color += sample.barycentrics[k] * mesh->VertexColor(mesh->VertexOnFace(sample.face, k));
+  }
+
+  // Return color
+  return color;
+}
+
+
+
+R3Vector R3MeshAttributeTransfer::
+SampleNormal(const R3MeshTransferSample& sample) const
+{
+  // Check sample
+  if (!sample.face) return R3zero_vector;
+
+  // Check interpolation
+  if (interpolation == R3_MESH_TRANSFER_NEAREST_VERTEX_INTERPOLATION) {
+    return mesh->VertexNormal(mesh->VertexOnFace(sample.face, NearestVertexOnFace(sample)));
+  }
+
+  // Blend normals of face vertices
+  R3Vector normal(0, 0, 0);
+  for (int k = 0; k < 3; k++) {
+    normal += sample.barycentrics[k] * mesh->VertexNormal(mesh->VertexOnFace(sample.face, k));
+  }
+
+  // Return unit normal (face normal if vertex normals cancel)
+  normal.Normalize();
+  if (normal.IsZero()) normal = mesh->FaceNormal(sample.face);
+  return normal;
+}
+
+
+
+R2Point R3MeshAttributeTransfer::
+SampleTextureCoords(const R3MeshTransferSample& sample) const
+{
+  // Check sample
+  if (!sample.face) return R2zero_point;
+
+  // Check interpolation
+  if (interpolation == R3_MESH_TRANSFER_NEAREST_VERTEX_INTERPOLATION) {
+    return mesh->VertexTextureCoords(mesh->VertexOnFace(sample.face, NearestVertexOnFace(sample)));
+  }
+
+  // Blend texture coordinates of face vertices
+  RNCoord u = 0, v = 0;
+  for (int k = 0; k < 3; k++) {
+    const R2Point& texcoords = mesh->VertexTextureCoords(mesh->VertexOnFace(sample.face, k));
+    u += sample.barycentrics[k] * texcoords.X();
+    v += sample.barycentrics[k] * texcoords.Y();
+  }
+
+  // Return texture coordinates
+  return R2Point(u, v);
+}
+
+
+
+RNScalar R3MeshAttributeTransfer::
+SampleValue(const R3MeshTransferSample& sample, const R3MeshProperty *property) const
+{
+  // Check sample
+  if (!sample.face) return 0;
+
+  // Check interpolation
+  if (interpolation == R3_MESH_TRANSFER_NEAREST_VERTEX_INTERPOLATION) {
+    return property->VertexValue(mesh->VertexOnFace(sample.face, NearestVertexOnFace(sample)));
+  }
+
+  // Blend values of face vertices
+  RNScalar value = 0;
+  for (int k = 0; k < 3; k++) {
+    value += sample.barycentrics[k] * property->VertexValue(mesh->VertexOnFace(sample.face, k));
+  }
+
+  // Return value
+  return value;
+}
+
+
+
+int R3MeshAttributeTransfer::
+SampleCategory(const R3MeshTransferSample& sample) const
+{
+  // Return category of closest face
+  if (!sample.face) return -1;
+  return mesh->FaceCategory(sample.face);
+}
+
+
+
+int R3MeshAttributeTransfer::
+SampleSegment(const R3MeshTransferSample& sample) const
+{
+  // Return segment of closest face
+  if (!sample.face) return -1;
+  return mesh->FaceSegment(sample.face);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Transfer functions
+////////////////////////////////////////////////////////////////////////
+
+static R3MeshTransferSample *
+FindVertexCorrespondences(const R3MeshAttributeTransfer *transfer, R3Mesh *target_mesh, int *count)
+{
+  // Gather target vertex positions and normals (normals are computed here, since queries run in parallel)
+  int nvertices = target_mesh->NVertices();
+  R3Point *positions = new R3Point [ nvertices ];
+  R3Vector *normals = (transfer->max_normal_angle > 0) ? new R3Vector [ nvertices ] : NULL;
+  for (int i = 0; i < nvertices; i++) {
+    R3MeshVertex *vertex = target_mesh->Vertex(i);
+    positions[i] = target_mesh->VertexPosition(vertex);
+    if (normals) normals[i] = target_mesh->VertexNormal(vertex);
+  }
+
+  // Find correspondences
+  R3MeshTransferSample *samples = new R3MeshTransferSample [ (nvertices > 0) ? nvertices : 1 ];
+  *count = transfer->FindCorrespondences(nvertices, positions, normals, samples);
+
+  // Delete temporary memory
+  delete [] positions;
+  if (normals) delete [] normals;
+
+  // Return samples
+  return samples;
+}
+
+
+
+int R3MeshAttributeTransfer::
+TransferVertexAttributes(R3Mesh *target_mesh, int attributes) const
+{
+  // Find correspondences
+  int count = 0;
+  R3MeshTransferSample *samples = FindVertexCorrespondences(this, target_mesh, &count);
+
+  // Copy attributes
+  for (int i = 0; i < target_mesh->NVertices(); i++) {
+    const R3MeshTransferSample& sample = samples[i];
+    if (!sample.face) continue;
+    R3MeshVertex *vertex = target_mesh->Vertex(i);
+    if (attributes & R3_MESH_TRANSFER_COLORS) target_mesh->SetVertexColor(vertex, SampleColor(sample));
+    if (attributes & R3_MESH_TRANSFER_NORMALS) target_mesh->SetVertexNormal(vertex, SampleNormal(sample));
+    if (attributes & R3_MESH_TRANSFER_TEXTURE_COORDS) target_mesh->SetVertexTextureCoords(vertex, SampleTextureCoords(sample));
+  }
+
+  // Delete samples
+  delete [] samples;
+
+  // Return number of vertices with values
+  return count;
+}
+
+
+
+int R3MeshAttributeTransfer::
+TransferFaceAttributes(R3Mesh *target_mesh, int attributes) const
+{
+  // Gather target face centroids and normals
+  int ntargets = target_mesh->NFaces();
+  R3Point *positions = new R3Point [ ntargets ];
+  R3Vector *normals = (max_normal_angle > 0) ? new R3Vector [ ntargets ] : NULL;
+  for (int i = 0; i < ntargets; i++) {
+    R3MeshFace *face = target_mesh->Face(i);
+    positions[i] = target_mesh->FaceCentroid(face);
+    if (normals) normals[i] = target_mesh->FaceNormal(face);
+  }
+
+  // Find correspondences
+  R3MeshTransferSample *samples = new R3MeshTransferSample [ (ntargets > 0) ? ntargets : 1 ];
+  int count = FindCorrespondences(ntargets, positions, normals, samples);
+
+  // Copy attributes
+  for (int i = 0; i < ntargets; i++) {
+    const R3MeshTransferSample& sample = samples[i];
+    if (!sample.face) continue;
+    R3MeshFace *face = target_mesh->Face(i);
+    if (attributes & R3_MESH_TRANSFER_CATEGORIES) target_mesh->SetFaceCategory(face, SampleCategory(sample));
+    if (attributes & R3_MESH_TRANSFER_SEGMENTS) target_mesh->SetFaceSegment(face, SampleSegment(sample));
+  }
+
+  // Delete temporary memory
+  delete [] positions;
+  if (normals) delete [] normals;
+  delete [] samples;
+
+  // Return number of faces with values
+  return count;
+}
+
+
+
+int R3MeshAttributeTransfer::
+Transfer(R3Mesh *target_mesh, int attributes) const
+{
+  // Transfer vertex and face attributes
+  int count = 0;
+  if (attributes & R3_MESH_TRANSFER_VERTEX_ATTRIBUTES) count += TransferVertexAttributes(target_mesh, attributes);
+  if (attributes & R3_MESH_TRANSFER_FACE_ATTRIBUTES) count += TransferFaceAttributes(target_mesh, attributes);
+
+  // Return number of target vertices and faces with values
+  return count;
+}
+
+
+
+int R3MeshAttributeTransfer::
+TransferProperties(const R3MeshPropertySet& source_properties, R3MeshPropertySet *target_properties) const
+{
+  // Find correspondences
+  R3Mesh *target_mesh = target_properties->Mesh();
+  int count = 0;
+  R3MeshTransferSample *samples = FindVertexCorrespondences(this, target_mesh, &count);
+
+  // Create target properties
+  for (int i = 0; i < source_properties.NProperties(); i++) {
+    R3MeshProperty *source_property = source_properties.Property(i);
+    R3MeshProperty *target_property = new R3MeshProperty(target_mesh, source_property->Name());
+    for (int j = 0; j < target_mesh->NVertices(); j++) {
+      if (!samples[j].face) continue;
+      target_property->SetVertexValue(j, SampleValue(samples[j], source_property));
+    }
+    target_properties->Insert(target_property);
+  }
+
+  // Delete samples
+  delete [] samples;
+
+  // Return number of vertices with values
+  return count;
+}
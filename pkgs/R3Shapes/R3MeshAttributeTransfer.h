@@ -0,0 +1,195 @@
+// Include file for mesh attribute transfer class
+
+
+
+// Interpolation methods
+
+#define R3_MESH_TRANSFER_NEAREST_VERTEX_INTERPOLATION  0
+#define R3_MESH_TRANSFER_BARYCENTRIC_INTERPOLATION     1
+
+
+
+// Attribute flags
+
+#define R3_MESH_TRANSFER_COLORS          0x01
+#define R3_MESH_TRANSFER_NORMALS         0x02
+#define R3_MESH_TRANSFER_TEXTURE_COORDS  0x04
+#define R3_MESH_TRANSFER_CATEGORIES      0x08
+#define R3_MESH_TRANSFER_SEGMENTS        0x10
+#define R3_MESH_TRANSFER_VERTEX_ATTRIBUTES \
+  (R3_MESH_TRANSFER_COLORS | R3_MESH_TRANSFER_NORMALS | R3_MESH_TRANSFER_TEXTURE_COORDS)
+#define R3_MESH_TRANSFER_FACE_ATTRIBUTES \
+  (R3_MESH_TRANSFER_CATEGORIES | R3_MESH_TRANSFER_SEGMENTS)
+
+
+
+// Correspondence definition
+
+struct R3MeshTransferSample {
+  R3MeshFace *face;
+  R3Point barycentrics;
+  R3Point position;
+  RNLength distance;
+};
+
+
+
+// Class definition
+
+class R3MeshAttributeTransfer {
+public:
+  // Constructors/destructors
+  R3MeshAttributeTransfer(R3Mesh *source_mesh);
+  ~R3MeshAttributeTransfer(void);
+
+  // Property functions
+  R3Mesh *SourceMesh(void) const;
+  int Interpolation(void) const;
+  RNLength MaxDistance(void) const;
+  RNAngle MaxNormalAngle(void) const;
+  int NThreads(void) const;
+
+  // Parameter manipulation functions
+  void SetInterpolation(int interpolation);
+    // Barycentric blends the vertices of the closest face, nearest vertex copies the one with largest weight
+  void SetMaxDistance(RNLength max_distance);
+    // Targets further than max_distance from the source surface get no values (0 means no limit)
+  void SetMaxNormalAngle(RNAngle max_normal_angle);
+    // Source faces whose normal is more than max_normal_angle from the target normal are ignored (0 means no check)
+  void SetNThreads(int nthreads);
+
+  // Correspondence functions
+  int FindCorrespondences(int npoints, const R3Point *positions, const R3Vector *normals,
+    R3MeshTransferSample *samples) const;
+    // Fills samples with the closest compatible point on the source surface (face is NULL if none),
+    // normals can be NULL, returns number of samples with a face
+
+  // Interpolation functions
+  RNRgb SampleColor(const R3MeshTransferSample& sample) const;
+  R3Vector SampleNormal(const R3MeshTransferSample& sample) const;
+  R2Point SampleTextureCoords(const R3MeshTransferSample& sample) const;
+  RNScalar SampleValue(const R3MeshTransferSample& sample, const R3MeshProperty *property) const;
+  int SampleCategory(const R3MeshTransferSample& sample) const;
+  int SampleSegment(const R3MeshTransferSample& sample) const;
+    // Return source attributes at a sample (for transfers to point sets)
+
+  // Transfer functions
+  int Transfer(R3Mesh *target_mesh, int attributes) const;
+    // Copies vertex attributes at target vertices and face attributes at target face centroids,
+    // returns number of target vertices and faces that received values
+  int TransferProperties(const R3MeshPropertySet& source_properties, R3MeshPropertySet *target_properties) const;
+    // Inserts a property for every source property with values at target vertices (target_properties->Mesh()),
+    // returns number of target vertices that received values
+
+public:
+  // Internal functions
+  void BuildHierarchy(void);
+  void FindCorrespondence(const R3Point& position, const R3Vector *normal, R3MeshTransferSample& sample) const;
+  int TransferVertexAttributes(R3Mesh *target_mesh, int attributes) const;
+  int TransferFaceAttributes(R3Mesh *target_mesh, int attributes) const;
+
+public:
+  // Source mesh
+  R3Mesh *mesh;
+
+  // Parameters
+  int interpolation;
+  RNLength max_distance;
+  RNAngle max_normal_angle;
+  int nthreads;
+
+  // Faces in hierarchy order (structure of arrays)
+  int nfaces;
+  R3MeshFace **faces;
+  double *face_coordinates[9];
+  double *face_normals[3];
+
+  // Bounding hierarchy (leaves are runs of faces)
+  R3FaceHierarchy hierarchy;
+};
+
+
+
+// Inline functions
+
+inline R3Mesh *R3MeshAttributeTransfer::
+SourceMesh(void) const
+{
+  // Return source mesh
+  return mesh;
+}
+
+
+
+inline int R3MeshAttributeTransfer::
+Interpolation(void) const
+{
+  // Return interpolation method
+  return interpolation;
+}
+
+
+
+inline RNLength R3MeshAttributeTransfer::
+MaxDistance(void) const
+{
+  // Return maximum distance to source surface
+  return max_distance;
+}
+
+
+
+inline RNAngle R3MeshAttributeTransfer::
+MaxNormalAngle(void) const
+{
+  // Return maximum angle between target and source normals
+  return max_normal_angle;
+}
+
+
+
+inline int R3MeshAttributeTransfer::
+NThreads(void) const
+{
+  // Return number of threads used for correspondence queries
+  return nthreads;
+}
+
+
+
+inline void R3MeshAttributeTransfer::
+SetInterpolation(int interpolation)
+{
+  // Set interpolation method
+  this->interpolation = interpolation;
+}
+
+
+
+inline void R3MeshAttributeTransfer::
+SetMaxDistance(RNLength max_distance)
+{
+  // Set maximum distance to source surface
+  this->max_distance = max_distance;
+}
+
+
+
+inline void R3MeshAttributeTransfer::
+SetMaxNormalAngle(RNAngle max_normal_angle)
+{
+  // Set maximum angle between target and source normals
+  this->max_normal_angle = max_normal_angle;
+}
+
+
+
+inline void R3MeshAttributeTransfer::
+SetNThreads(int nthreads)
+{
+  // Set number of threads used for correspondence queries
+  this->nthreads = nthreads;
+}
+
+
+
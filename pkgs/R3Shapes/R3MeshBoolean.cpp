@@ -0,0 +1,1994 @@
+// Source file for mesh boolean operation class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Parameters
+////////////////////////////////////////////////////////////////////////
+
+// Maximum number of faces in a hierarchy leaf
+static const int max_faces_per_leaf = 4;
+
+// Displacement of perturbed vertices relative to bounding box diagonal (grows on every retry)
+static const RNScalar perturbation_scale = 1E-9;
+static const RNScalar perturbation_growth = 4;
+
+// Random displacement of perturbed vertices relative to the offset of the second solid along its normals
+static const RNScalar perturbation_jitter = 0.125;
+
+// Number of passes splitting or removing faces with collinear corners in the result
+static const int max_collinear_passes = 8;
+
+// Number of ray directions tried for each winding number
+static const int max_winding_rays = 8;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3MeshBoolean::
+R3MeshBoolean(R3Mesh *mesh1, R3Mesh *mesh2)
+  : nthreads(0),
+    max_perturbations(8),
+    nintersection_segments(0),
+    nperturbations(0)
+{
+  // Remember operands
+  meshes[0] = mesh1;
+  meshes[1] = mesh2;
+}
+
+
+
+R3MeshBoolean::
+~R3MeshBoolean(void)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Operand snapshots
+////////////////////////////////////////////////////////////////////////
+
+struct BooleanSolid {
+  // Mesh and global index of its first vertex
+  R3Mesh *mesh;
+  int vertex_offset;
+
+  // Faces (edge k joins vertices k and k+1)
+  int nvertices;
+  int nfaces;
+  const R3Point *positions;
+  int *face_vertices;
+  int *face_edges;
+  double *face_boxes;
+  RNBoolean *face_degenerate;
+  R3Box bbox;
+
+  // Bounding hierarchy over face boxes
+  R3FaceHierarchy hierarchy;
+};
+
+
+
+static void
+CreateBooleanSolid(BooleanSolid *solid, R3Mesh *mesh, int vertex_offset, const R3Point *positions)
+{
+  // Initialize solid
+  solid->mesh = mesh;
+  solid->vertex_offset = vertex_offset;
+  solid->nvertices = mesh->NVertices();
+  solid->nfaces = mesh->NFaces();
+  solid->positions = positions;
+  solid->bbox = R3null_box;
+  for (int i = 0; i < solid->nvertices; i++) solid->bbox.Union(positions[i]);
+
+  // Copy faces
+  int nfaces = solid->nfaces;
+  solid->face_vertices = new int [ 3 * nfaces + 1 ];
+  solid->face_edges = new int [ 3 * nfaces + 1 ];
+  solid->face_boxes = new double [ 6 * nfaces + 1 ];
+  solid->face_degenerate = new RNBoolean [ nfaces + 1 ];
+  R3Point *centroids = new R3Point [ nfaces + 1 ];
+  for (int i = 0; i < nfaces; i++) {
+    R3MeshFace *face = mesh->Face(i);
+    R3MeshVertex *vertices[3];
+    for (int k = 0; k < 3; k++) vertices[k] = mesh->VertexOnFace(face, k);
+    for (int k = 0; k < 3; k++) {
+      R3MeshEdge *edge = mesh->EdgeBetweenVertices(vertices[k], vertices[(k+1)%3]);
+      solid->face_vertices[3*i+k] = mesh->VertexID(vertices[k]);
+      solid->face_edges[3*i+k] = (edge) ? mesh->EdgeID(edge) : -1;
+    }
+    const R3Point& p0 = positions[solid->face_vertices[3*i+0]];
+    const R3Point& p1 = positions[solid->face_vertices[3*i+1]];
+    const R3Point& p2 = positions[solid->face_vertices[3*i+2]];
+    for (int dim = 0; dim < 3; dim++) {
+      RNCoord lo = p0[dim], hi = p0[dim];
+      if (p1[dim] < lo) lo = p1[dim]; else if (p1[dim] > hi) hi = p1[dim];
+      if (p2[dim] < lo) lo = p2[dim]; else if (p2[dim] > hi) hi = p2[dim];
+      solid->face_boxes[6*i+dim] = lo;
+      solid->face_boxes[6*i+3+dim] = hi;
+    }
+    solid->face_degenerate[i] = ((R3Orientation(p0, p1, p2, RN_X) == 0) &&
+      (R3Orientation(p0, p1, p2, RN_Y) == 0) && (R3Orientation(p0, p1, p2, RN_Z) == 0)) ? TRUE : FALSE;
+    centroids[i] = (p0 + p1 + p2) / 3.0;
+  }
+
+  // Build hierarchy
+  solid->hierarchy.Build(solid->face_boxes, centroids, nfaces, max_faces_per_leaf);
+
+  // Delete temporary memory
+  delete [] centroids;
+}
+
+
+
+static void
+DeleteBooleanSolid(BooleanSolid *solid)
+{
+  // Delete arrays
+  delete [] solid->face_vertices;
+  delete [] solid->face_edges;
+  delete [] solid->face_boxes;
+  delete [] solid->face_degenerate;
+  solid->hierarchy.Empty();
+}
+
+
+
+static RNScalar
+PerturbationValue(int index, int seed)
+{
+  // Return deterministic pseudo-random value in [-1, 1]
+  unsigned int h = (unsigned int) index * 2654435761U + (unsigned int) seed * 40503U + 12345U;
+  h ^= h >> 15; h *= 2246822519U;
+  h ^= h >> 13; h *= 3266489917U;
+  h ^= h >> 16;
+  return 2.0 * (h / 4294967295.0) - 1.0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Intersection curve functions
+////////////////////////////////////////////////////////////////////////
+
+// Intersection point between an edge of one solid and a face of the other
+// (type 0 is an edge of solid 0 with a face of solid 1, type 1 is an edge of solid 1 with a face of solid 0)
+struct BooleanKey {
+  int type;
+  int edge;
+  int face;
+};
+
+// Intersection segment between face[0] of solid 0 and face[1] of solid 1
+struct BooleanSegment {
+  int faces[2];
+  BooleanKey keys[2];
+  int points[2];
+};
+
+
+
+static int
+EdgeCrossesTriangle(const R3Point& p, const R3Point& q, const R3Point& t0, const R3Point& t1, const R3Point& t2)
+{
+  // Given endpoints strictly on opposite sides of the triangle plane, return 1 if the edge crosses
+  // the interior of the triangle, 0 if it misses it, and -1 if it passes through its boundary
+  int o1 = R3Orientation(p, q, t0, t1);
+  int o2 = R3Orientation(p, q, t1, t2);
+  int o3 = R3Orientation(p, q, t2, t0);
+  if ((o1 * o2 < 0) || (o2 * o3 < 0) || (o3 * o1 < 0)) return 0;
+  if ((o1 == 0) || (o2 == 0) || (o3 == 0)) return -1;
+  return 1;
+}
+
+
+
+struct BooleanSegmentData {
+  const BooleanSolid *solids;
+  RNArray<BooleanSegment *> *results;
+  int degenerate;
+};
+
+
+
+static void
+FindBooleanSegments(int index, int thread_index, void *data)
+{
+  // Get face of solid 0
+  BooleanSegmentData *segment_data = (BooleanSegmentData *) data;
+  if (segment_data->degenerate) return;
+  const BooleanSolid *solid0 = &segment_data->solids[0];
+  const BooleanSolid *solid1 = &segment_data->solids[1];
+  if (solid0->face_degenerate[index]) return;
+  if (solid1->hierarchy.NNodes() == 0) return;
+  const double *box = &solid0->face_boxes[6*index];
+  R3Point a[3];
+  for (int k = 0; k < 3; k++) a[k] = solid0->positions[solid0->face_vertices[3*index+k]];
+
+  // Traverse hierarchy of solid 1
+  int stack[R3FaceHierarchy::max_stack_size];
+  int nstack = 0;
+  stack[nstack++] = 0;
+  while (nstack > 0) {
+    // Pop node and check its box
+    int node = stack[--nstack];
+    if (!R3FaceHierarchy::BoxesOverlap(solid1->hierarchy.NodeBox(node), box)) continue;
+
+    // Check if interior node
+    if (solid1->hierarchy.NodeChild(node, 0) >= 0) {
+      assert(nstack + 2 <= R3FaceHierarchy::max_stack_size);
+      stack[nstack++] = solid1->hierarchy.NodeChild(node, 1);
+      stack[nstack++] = solid1->hierarchy.NodeChild(node, 0);
+      continue;
+    }
+
+    // Test faces in leaf
+    int first = solid1->hierarchy.NodeFirstFace(node);
+    for (int i = 0; i < solid1->hierarchy.NodeNFaces(node); i++) {
+      int face = solid1->hierarchy.Face(first + i);
+      if (solid1->face_degenerate[face]) continue;
+      if (!R3FaceHierarchy::BoxesOverlap(&solid1->face_boxes[6*face], box)) continue;
+      R3Point b[3];
+      for (int k = 0; k < 3; k++) b[k] = solid1->positions[solid1->face_vertices[3*face+k]];
+
+      // Check sides of vertices with respect to the other plane (any vertex on a plane is degenerate)
+      int sa[3], sb[3];
+      for (int k = 0; k < 3; k++) sb[k] = R3Orientation(b[0], b[1], b[2], a[k]);
+      if ((sb[0] == 0) || (sb[1] == 0) || (sb[2] == 0)) { segment_data->degenerate = 1; return; }
+      if ((sb[0] == sb[1]) && (sb[1] == sb[2])) continue;
+      for (int k = 0; k < 3; k++) sa[k] = R3Orientation(a[0], a[1], a[2], b[k]);
+      if ((sa[0] == 0) || (sa[1] == 0) || (sa[2] == 0)) { segment_data->degenerate = 1; return; }
+      if ((sa[0] == sa[1]) && (sa[1] == sa[2])) continue;
+
+      // Find edges of each face crossing the other face
+      BooleanKey keys[6];
+      int nkeys = 0;
+      for (int k = 0; k < 3; k++) {
+        if (sb[k] == sb[(k+1)%3]) continue;
+        int status = EdgeCrossesTriangle(a[k], a[(k+1)%3], b[0], b[1], b[2]);
+        if (status < 0) { segment_data->degenerate = 1; return; }
+        if (status == 0) continue;
+        keys[nkeys].type = 0;
+        keys[nkeys].edge = solid0->face_edges[3*index+k];
+        keys[nkeys].face = face;
+        nkeys++;
+      }
+      for (int k = 0; k < 3; k++) {
+        if (sa[k] == sa[(k+1)%3]) continue;
+        int status = EdgeCrossesTriangle(b[k], b[(k+1)%3], a[0], a[1], a[2]);
+        if (status < 0) { segment_data->degenerate = 1; return; }
+        if (status == 0) continue;
+        keys[nkeys].type = 1;
+        keys[nkeys].edge = solid1->face_edges[3*face+k];
+        keys[nkeys].face = index;
+        nkeys++;
+      }
+
+      // Create segment (triangles in general position meet in a segment with two such endpoints)
+      if (nkeys == 0) continue;
+      if (nkeys != 2) { segment_data->degenerate = 1; return; }
+      BooleanSegment *segment = new BooleanSegment();
+      segment->faces[0] = index;
+      segment->faces[1] = face;
+      segment->keys[0] = keys[0];
+      segment->keys[1] = keys[1];
+      segment->points[0] = -1;
+      segment->points[1] = -1;
+      segment_data->results[thread_index].Insert(segment);
+    }
+  }
+}
+
+
+
+static int
+CompareBooleanKeys(const void *data1, const void *data2)
+{
+  // Compare type, then edge, then face
+  const BooleanKey *key1 = (const BooleanKey *) data1;
+  const BooleanKey *key2 = (const BooleanKey *) data2;
+  if (key1->type != key2->type) return (key1->type < key2->type) ? -1 : 1;
+  if (key1->edge != key2->edge) return (key1->edge < key2->edge) ? -1 : 1;
+  if (key1->face != key2->face) return (key1->face < key2->face) ? -1 : 1;
+  return 0;
+}
+
+
+
+static R3Point
+BooleanKeyPosition(const BooleanSolid *solids, const BooleanKey& key, RNScalar *parameter)
+{
+  // Get edge of one solid and face of the other (parameter is kept where the edge is parallel to the face)
+  const BooleanSolid *edge_solid = &solids[key.type];
+  const BooleanSolid *face_solid = &solids[1 - key.type];
+  R3MeshEdge *edge = edge_solid->mesh->Edge(key.edge);
+  int v0 = edge_solid->mesh->VertexID(edge_solid->mesh->VertexOnEdge(edge, 0));
+  int v1 = edge_solid->mesh->VertexID(edge_solid->mesh->VertexOnEdge(edge, 1));
+  const R3Point& p0 = edge_solid->positions[v0];
+  const R3Point& p1 = edge_solid->positions[v1];
+  const R3Point& t0 = face_solid->positions[face_solid->face_vertices[3*key.face+0]];
+  const R3Point& t1 = face_solid->positions[face_solid->face_vertices[3*key.face+1]];
+  const R3Point& t2 = face_solid->positions[face_solid->face_vertices[3*key.face+2]];
+
+  // Intersect edge with plane of face (in extended precision, since faces can be slivers)
+  long double e1[3], e2[3], normal[3], d0 = 0, d1 = 0;
+  for (int dim = 0; dim < 3; dim++) {
+    e1[dim] = (long double) t1[dim] - (long double) t0[dim];
+    e2[dim] = (long double) t2[dim] - (long double) t0[dim];
+  }
+  normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+  normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+  normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+  for (int dim = 0; dim < 3; dim++) {
+    d0 += normal[dim] * ((long double) p0[dim] - (long double) t0[dim]);
+    d1 += normal[dim] * ((long double) p1[dim] - (long double) t0[dim]);
+  }
+  long double t = (d0 != d1) ? d0 / (d0 - d1) : (long double) *parameter;
+  if (t < 0) t = 0;
+  else if (t > 1) t = 1;
+  *parameter = (RNScalar) t;
+  R3Point position;
+  for (int dim = 0; dim < 3; dim++) {
+    position[dim] = (RNCoord) ((long double) p0[dim] + t * ((long double) p1[dim] - (long double) p0[dim]));
+  }
+  return position;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Coplanar face functions
+////////////////////////////////////////////////////////////////////////
+
+// Faces of each solid lying in the plane of a face of the other solid and overlapping it
+// (faces[s][face_first[s][f]] through faces[s][face_first[s][f+1]-1] are coplanar with face f of solid s)
+struct BooleanCoplanarFaces {
+  int *face_first[2];
+  int *faces[2];
+};
+
+// Pair of overlapping coplanar faces (face[0] of solid 0 and face[1] of solid 1)
+struct BooleanCoplanarPair {
+  int faces[2];
+};
+
+
+
+static RNBoolean
+CoplanarTrianglesOverlap(const R3Point *a, const R3Point *b)
+{
+  // Return whether coplanar triangles share interior points (no edge of either separates them)
+  RNDimension dim = R3ProjectionDimension(a[0], a[1], a[2]);
+  const R3Point *triangles[2] = { a, b };
+  for (int i = 0; i < 2; i++) {
+    const R3Point *t = triangles[i];
+    const R3Point *u = triangles[1-i];
+    int sign = R3Orientation(t[0], t[1], t[2], dim);
+    for (int k = 0; k < 3; k++) {
+      if ((R3Orientation(t[k], t[(k+1)%3], u[0], dim) != sign) &&
+          (R3Orientation(t[k], t[(k+1)%3], u[1], dim) != sign) &&
+          (R3Orientation(t[k], t[(k+1)%3], u[2], dim) != sign)) return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+
+
+struct BooleanCoplanarData {
+  const BooleanSolid *solids;
+  RNArray<BooleanCoplanarPair *> *results;
+};
+
+
+
+static void
+FindCoplanarFaces(int index, int thread_index, void *data)
+{
+  // Get face of solid 0
+  BooleanCoplanarData *coplanar_data = (BooleanCoplanarData *) data;
+  const BooleanSolid *solid0 = &coplanar_data->solids[0];
+  const BooleanSolid *solid1 = &coplanar_data->solids[1];
+  if (solid0->face_degenerate[index]) return;
+  if (solid1->hierarchy.NNodes() == 0) return;
+  const double *box = &solid0->face_boxes[6*index];
+  R3Point a[3];
+  for (int k = 0; k < 3; k++) a[k] = solid0->positions[solid0->face_vertices[3*index+k]];
+
+  // Traverse hierarchy of solid 1
+  int stack[R3FaceHierarchy::max_stack_size];
+  int nstack = 0;
+  stack[nstack++] = 0;
+  while (nstack > 0) {
+    // Pop node and check its box
+    int node = stack[--nstack];
+    if (!R3FaceHierarchy::BoxesOverlap(solid1->hierarchy.NodeBox(node), box)) continue;
+
+    // Check if interior node
+    if (solid1->hierarchy.NodeChild(node, 0) >= 0) {
+      assert(nstack + 2 <= R3FaceHierarchy::max_stack_size);
+      stack[nstack++] = solid1->hierarchy.NodeChild(node, 1);
+      stack[nstack++] = solid1->hierarchy.NodeChild(node, 0);
+      continue;
+    }
+
+    // Test faces in leaf
+    int first = solid1->hierarchy.NodeFirstFace(node);
+    for (int i = 0; i < solid1->hierarchy.NodeNFaces(node); i++) {
+      int face = solid1->hierarchy.Face(first + i);
+      if (solid1->face_degenerate[face]) continue;
+      if (!R3FaceHierarchy::BoxesOverlap(&solid1->face_boxes[6*face], box)) continue;
+      R3Point b[3];
+      for (int k = 0; k < 3; k++) b[k] = solid1->positions[solid1->face_vertices[3*face+k]];
+      if (R3Orientation(b[0], b[1], b[2], a[0]) != 0) continue;
+      if (R3Orientation(b[0], b[1], b[2], a[1]) != 0) continue;
+      if (R3Orientation(b[0], b[1], b[2], a[2]) != 0) continue;
+      if (!CoplanarTrianglesOverlap(a, b)) continue;
+      BooleanCoplanarPair *pair = new BooleanCoplanarPair();
+      pair->faces[0] = index;
+      pair->faces[1] = face;
+      coplanar_data->results[thread_index].Insert(pair);
+    }
+  }
+}
+
+
+
+static void
+CreateCoplanarFaces(BooleanCoplanarFaces *coplanar, const BooleanSolid *solids, int nthreads)
+{
+  // Find pairs of coplanar faces in parallel
+  BooleanCoplanarData coplanar_data;
+  coplanar_data.solids = solids;
+  coplanar_data.results = new RNArray<BooleanCoplanarPair *> [ nthreads ];
+  RNParallelFor(solids[0].nfaces, FindCoplanarFaces, &coplanar_data, nthreads, 64);
+
+  // Group pairs by face of each solid (counting sort)
+  for (int s = 0; s < 2; s++) {
+    int nfaces = solids[s].nfaces;
+    int npairs = 0;
+    coplanar->face_first[s] = new int [ nfaces + 2 ];
+    for (int f = 0; f <= nfaces + 1; f++) coplanar->face_first[s][f] = 0;
+    for (int t = 0; t < nthreads; t++) {
+      for (int i = 0; i < coplanar_data.results[t].NEntries(); i++) {
+        coplanar->face_first[s][coplanar_data.results[t].Kth(i)->faces[s] + 2]++;
+        npairs++;
+      }
+    }
+    for (int f = 2; f <= nfaces + 1; f++) coplanar->face_first[s][f] += coplanar->face_first[s][f-1];
+    coplanar->faces[s] = new int [ npairs + 1 ];
+    for (int t = 0; t < nthreads; t++) {
+      for (int i = 0; i < coplanar_data.results[t].NEntries(); i++) {
+        BooleanCoplanarPair *pair = coplanar_data.results[t].Kth(i);
+        coplanar->faces[s][coplanar->face_first[s][pair->faces[s] + 1]++] = pair->faces[1-s];
+      }
+    }
+  }
+
+  // Delete pairs
+  for (int t = 0; t < nthreads; t++) {
+    for (int i = 0; i < coplanar_data.results[t].NEntries(); i++) delete coplanar_data.results[t].Kth(i);
+  }
+  delete [] coplanar_data.results;
+}
+
+
+
+static void
+DeleteCoplanarFaces(BooleanCoplanarFaces *coplanar)
+{
+  // Delete arrays
+  for (int s = 0; s < 2; s++) {
+    delete [] coplanar->face_first[s];
+    delete [] coplanar->faces[s];
+  }
+}
+
+
+
+static int
+CoplanarPieceOrientation(const BooleanSolid *solids, const BooleanCoplanarFaces *coplanar, int s, int face, const R3Point& point)
+{
+  // Return 1 if point of face of solid s lies strictly inside a coplanar face of the other solid with
+  // the same orientation, -1 if it lies inside one with the opposite orientation, and 0 otherwise
+  // (points on boundaries of coplanar faces are left to the winding number)
+  const BooleanSolid *solid = &solids[s];
+  const BooleanSolid *other = &solids[1-s];
+  const R3Point& a0 = solid->positions[solid->face_vertices[3*face+0]];
+  const R3Point& a1 = solid->positions[solid->face_vertices[3*face+1]];
+  const R3Point& a2 = solid->positions[solid->face_vertices[3*face+2]];
+  RNDimension dim = R3ProjectionDimension(a0, a1, a2);
+  int sign = R3Orientation(a0, a1, a2, dim);
+  for (int i = coplanar->face_first[s][face]; i < coplanar->face_first[s][face+1]; i++) {
+    int g = coplanar->faces[s][i];
+    const R3Point& b0 = other->positions[other->face_vertices[3*g+0]];
+    const R3Point& b1 = other->positions[other->face_vertices[3*g+1]];
+    const R3Point& b2 = other->positions[other->face_vertices[3*g+2]];
+    int other_sign = R3Orientation(b0, b1, b2, dim);
+    if (R3Orientation(b0, b1, point, dim) != other_sign) continue;
+    if (R3Orientation(b1, b2, point, dim) != other_sign) continue;
+    if (R3Orientation(b2, b0, point, dim) != other_sign) continue;
+    return (other_sign == sign) ? 1 : -1;
+  }
+  return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Face triangulation functions
+////////////////////////////////////////////////////////////////////////
+
+// Triangulation of one face (local vertices 0-2 are its corners)
+struct BooleanTriangulation {
+  const R3Point *points;
+  const int *ids;
+  int npoints;
+  RNDimension dim;
+  int sign;
+  int ntriangles;
+  int *vertices;
+  int *neighbors;
+  int *vertex_triangles;
+  int nconstraints;
+  int max_constraints;
+  int *constraints;
+};
+
+
+
+static inline int
+Orient(const BooleanTriangulation *tr, int a, int b, int c)
+{
+  // Return orientation of local vertices in projection of face (1 is counterclockwise)
+  return tr->sign * R3Orientation(tr->points[tr->ids[a]], tr->points[tr->ids[b]], tr->points[tr->ids[c]], tr->dim);
+}
+
+
+
+static int
+InCircle(const BooleanTriangulation *tr, int a, int b, int c, int d)
+{
+  // Get projected coordinates relative to d
+  RNDimension dim1 = (tr->dim + 1) % 3;
+  RNDimension dim2 = (tr->dim + 2) % 3;
+  const R3Point& pd = tr->points[tr->ids[d]];
+  const R3Point& pa = tr->points[tr->ids[a]];
+  const R3Point& pb = tr->points[tr->ids[b]];
+  const R3Point& pc = tr->points[tr->ids[c]];
+  double adx = pa[dim1] - pd[dim1], ady = pa[dim2] - pd[dim2];
+  double bdx = pb[dim1] - pd[dim1], bdy = pb[dim2] - pd[dim2];
+  double cdx = pc[dim1] - pd[dim1], cdy = pc[dim2] - pd[dim2];
+
+  // Compute determinant and its error bound (Shewchuk) in floating point
+  double alift = adx * adx + ady * ady;
+  double blift = bdx * bdx + bdy * bdy;
+  double clift = cdx * cdx + cdy * cdy;
+  double bdxcdy = bdx * cdy, cdxbdy = cdx * bdy;
+  double cdxady = cdx * ady, adxcdy = adx * cdy;
+  double adxbdy = adx * bdy, bdxady = bdx * ady;
+  double det = alift * (bdxcdy - cdxbdy) + blift * (cdxady - adxcdy) + clift * (adxbdy - bdxady);
+  double permanent = (fabs(bdxcdy) + fabs(cdxbdy)) * alift +
+    (fabs(cdxady) + fabs(adxcdy)) * blift + (fabs(adxbdy) + fabs(bdxady)) * clift;
+  double error_bound = (10.0 + 96.0 * 1.1102230246251565e-16) * 1.1102230246251565e-16 * permanent;
+
+  // Return 1 if d is certainly inside the circle through counterclockwise (a,b,c), -1 if certainly
+  // outside, and 0 if nearly cocircular (where either diagonal is acceptable)
+  if (det > error_bound) return tr->sign;
+  if (-det > error_bound) return -tr->sign;
+  return 0;
+}
+
+
+
+static inline void
+SetTriangle(BooleanTriangulation *tr, int t, int a, int b, int c, int na, int nb, int nc)
+{
+  // Set vertices and neighbors across edges (a,b), (b,c), (c,a)
+  tr->vertices[3*t+0] = a; tr->vertices[3*t+1] = b; tr->vertices[3*t+2] = c;
+  tr->neighbors[3*t+0] = na; tr->neighbors[3*t+1] = nb; tr->neighbors[3*t+2] = nc;
+  tr->vertex_triangles[a] = t; tr->vertex_triangles[b] = t; tr->vertex_triangles[c] = t;
+}
+
+
+
+static inline void
+ReplaceNeighbor(BooleanTriangulation *tr, int t, int old_neighbor, int new_neighbor)
+{
+  // Replace neighbor of triangle t
+  if (t < 0) return;
+  for (int k = 0; k < 3; k++) {
+    if (tr->neighbors[3*t+k] == old_neighbor) { tr->neighbors[3*t+k] = new_neighbor; return; }
+  }
+}
+
+
+
+static void
+SplitTriangle(BooleanTriangulation *tr, int t, int p)
+{
+  // Replace triangle by three meeting at p
+  int a = tr->vertices[3*t+0], b = tr->vertices[3*t+1], c = tr->vertices[3*t+2];
+  int na = tr->neighbors[3*t+0], nb = tr->neighbors[3*t+1], nc = tr->neighbors[3*t+2];
+  int t1 = tr->ntriangles++;
+  int t2 = tr->ntriangles++;
+  SetTriangle(tr, t, a, b, p, na, t1, t2);
+  SetTriangle(tr, t1, b, c, p, nb, t2, t);
+  SetTriangle(tr, t2, c, a, p, nc, t, t1);
+  ReplaceNeighbor(tr, nb, t, t1);
+  ReplaceNeighbor(tr, nc, t, t2);
+}
+
+
+
+static void
+SplitEdge(BooleanTriangulation *tr, int t, int k, int p)
+{
+  // Get edge (a,b) of triangle t
+  int a = tr->vertices[3*t+k], b = tr->vertices[3*t+(k+1)%3], c = tr->vertices[3*t+(k+2)%3];
+  int u = tr->neighbors[3*t+k];
+  int nbc = tr->neighbors[3*t+(k+1)%3];
+  int nca = tr->neighbors[3*t+(k+2)%3];
+
+  // Split boundary edge
+  if (u < 0) {
+    int t1 = tr->ntriangles++;
+    SetTriangle(tr, t, a, p, c, -1, t1, nca);
+    SetTriangle(tr, t1, p, b, c, -1, nbc, t);
+    ReplaceNeighbor(tr, nbc, t, t1);
+    return;
+  }
+
+  // Split interior edge shared with triangle (b,a,d)
+  int j = 0;
+  while ((j < 3) && (tr->vertices[3*u+j] != b)) j++;
+  assert((j < 3) && (tr->vertices[3*u+(j+1)%3] == a));
+  int d = tr->vertices[3*u+(j+2)%3];
+  int nad = tr->neighbors[3*u+(j+1)%3];
+  int ndb = tr->neighbors[3*u+(j+2)%3];
+  int t1 = tr->ntriangles++;
+  int u1 = tr->ntriangles++;
+  SetTriangle(tr, t, a, p, c, u1, t1, nca);
+  SetTriangle(tr, t1, p, b, c, u, nbc, t);
+  SetTriangle(tr, u, b, p, d, t1, u1, ndb);
+  SetTriangle(tr, u1, p, a, d, t, nad, u);
+  ReplaceNeighbor(tr, nbc, t, t1);
+  ReplaceNeighbor(tr, nad, u, u1);
+}
+
+
+
+static RNBoolean
+FlipEdge(BooleanTriangulation *tr, int t, int k)
+{
+  // Get triangles (a,b,c) and (b,a,d) sharing edge k of t
+  int a = tr->vertices[3*t+k], b = tr->vertices[3*t+(k+1)%3], c = tr->vertices[3*t+(k+2)%3];
+  int u = tr->neighbors[3*t+k];
+  if (u < 0) return FALSE;
+  int j = 0;
+  while ((j < 3) && (tr->vertices[3*u+j] != b)) j++;
+  if ((j == 3) || (tr->vertices[3*u+(j+1)%3] != a)) return FALSE;
+  int d = tr->vertices[3*u+(j+2)%3];
+
+  // Check if quadrilateral is strictly convex
+  if (Orient(tr, c, a, d) <= 0) return FALSE;
+  if (Orient(tr, d, b, c) <= 0) return FALSE;
+
+  // Replace diagonal (a,b) by (c,d)
+  int nbc = tr->neighbors[3*t+(k+1)%3];
+  int nca = tr->neighbors[3*t+(k+2)%3];
+  int nad = tr->neighbors[3*u+(j+1)%3];
+  int ndb = tr->neighbors[3*u+(j+2)%3];
+  SetTriangle(tr, t, c, a, d, nca, nad, u);
+  SetTriangle(tr, u, d, b, c, ndb, nbc, t);
+  ReplaceNeighbor(tr, nad, u, t);
+  ReplaceNeighbor(tr, nbc, t, u);
+  return TRUE;
+}
+
+
+
+static RNBoolean
+FindEdge(const BooleanTriangulation *tr, int a, int b, int *triangle, int *edge)
+{
+  // Visit triangles around a, turning one way and then the other from the starting triangle
+  int start = tr->vertex_triangles[a];
+  for (int direction = 0; direction < 2; direction++) {
+    int t = start;
+    for (int step = 0; (t >= 0) && (step <= tr->ntriangles); step++) {
+      int i = 0;
+      while ((i < 3) && (tr->vertices[3*t+i] != a)) i++;
+      if (i == 3) return FALSE;
+      if (tr->vertices[3*t+(i+1)%3] == b) { *triangle = t; *edge = i; return TRUE; }
+      if (tr->vertices[3*t+(i+2)%3] == b) { *triangle = t; *edge = (i+2)%3; return TRUE; }
+      t = (direction == 0) ? tr->neighbors[3*t+i] : tr->neighbors[3*t+(i+2)%3];
+      if (t == start) break;
+    }
+  }
+
+  // Edge not found
+  return FALSE;
+}
+
+
+
+static int
+LocatePoint(const BooleanTriangulation *tr, int p, int start)
+{
+  // Walk towards point
+  int t = start;
+  for (int step = 0; step <= tr->ntriangles; step++) {
+    int next = -1;
+    RNBoolean inside = TRUE;
+    for (int m = 0; m < 3; m++) {
+      int k = (m + step) % 3;
+      if (Orient(tr, tr->vertices[3*t+k], tr->vertices[3*t+(k+1)%3], p) >= 0) continue;
+      inside = FALSE;
+      if (tr->neighbors[3*t+k] >= 0) { next = tr->neighbors[3*t+k]; break; }
+    }
+    if (inside) return t;
+    if (next < 0) break;
+    t = next;
+  }
+
+  // Search all triangles (walk can fail only when point is outside or triangles are inverted by round-off)
+  for (int s = 0; s < tr->ntriangles; s++) {
+    if (Orient(tr, tr->vertices[3*s+0], tr->vertices[3*s+1], p) < 0) continue;
+    if (Orient(tr, tr->vertices[3*s+1], tr->vertices[3*s+2], p) < 0) continue;
+    if (Orient(tr, tr->vertices[3*s+2], tr->vertices[3*s+0], p) < 0) continue;
+    return s;
+  }
+
+  // Return last triangle visited
+  return t;
+}
+
+
+
+static void
+InsertPoint(BooleanTriangulation *tr, int p, int start)
+{
+  // Find triangle containing point
+  int t = LocatePoint(tr, p, start);
+
+  // Split edge if point is on one, or else split triangle
+  int nzero = 0, zero_edge = -1, nnegative = 0;
+  for (int k = 0; k < 3; k++) {
+    int o = Orient(tr, tr->vertices[3*t+k], tr->vertices[3*t+(k+1)%3], p);
+    if (o == 0) { nzero++; zero_edge = k; }
+    else if (o < 0) nnegative++;
+  }
+  if ((nzero == 1) && (nnegative == 0)) SplitEdge(tr, t, zero_edge, p);
+  else SplitTriangle(tr, t, p);
+}
+
+
+
+static int
+FindFirstCrossing(const BooleanTriangulation *tr, int u, int v, int *triangle, int *left, int *right, int *collinear)
+{
+  // Visit triangles around u looking for the one that segment (u,v) leaves through its opposite edge
+  int start = tr->vertex_triangles[u];
+  for (int direction = 0; direction < 2; direction++) {
+    int t = start;
+    for (int step = 0; (t >= 0) && (step <= tr->ntriangles); step++) {
+      int i = 0;
+      while ((i < 3) && (tr->vertices[3*t+i] != u)) i++;
+      if (i == 3) return 0;
+      int x = tr->vertices[3*t+(i+1)%3];
+      int y = tr->vertices[3*t+(i+2)%3];
+      int ox = Orient(tr, u, x, v);
+      int oy = Orient(tr, u, v, y);
+      if ((ox == 0) && (oy > 0)) { *collinear = x; return 2; }
+      if ((oy == 0) && (ox > 0)) { *collinear = y; return 2; }
+      if ((ox > 0) && (oy > 0)) { *triangle = t; *left = y; *right = x; return 1; }
+      t = (direction == 0) ? tr->neighbors[3*t+i] : tr->neighbors[3*t+(i+2)%3];
+      if (t == start) break;
+    }
+  }
+
+  // Crossing not found
+  return 0;
+}
+
+
+
+static RNBoolean
+IsConstraint(const BooleanTriangulation *tr, int a, int b)
+{
+  // Check if edge was inserted as a constraint
+  for (int i = 0; i < tr->nconstraints; i++) {
+    int c0 = tr->constraints[2*i+0], c1 = tr->constraints[2*i+1];
+    if (((c0 == a) && (c1 == b)) || ((c0 == b) && (c1 == a))) return TRUE;
+  }
+  return FALSE;
+}
+
+
+
+static RNBoolean
+AddConstraint(BooleanTriangulation *tr, int a, int b)
+{
+  // Remember edge so that it is never flipped
+  if (IsConstraint(tr, a, b)) return TRUE;
+  if (tr->nconstraints >= tr->max_constraints) return FALSE;
+  tr->constraints[2*tr->nconstraints+0] = a;
+  tr->constraints[2*tr->nconstraints+1] = b;
+  tr->nconstraints++;
+  return TRUE;
+}
+
+
+
+static RNBoolean
+InsertConstraint(BooleanTriangulation *tr, int u0, int v0, int *stack, int *queue, int max_queue)
+{
+  // Insert edges of constraint, splitting it at vertices found exactly on it
+  int nstack = 0;
+  stack[nstack++] = u0;
+  stack[nstack++] = v0;
+  int max_steps = 8 * (tr->ntriangles + 16) * (tr->npoints + 16);
+  int steps = 0;
+  while (nstack > 0) {
+    if (++steps > max_steps) return FALSE;
+    int v = stack[--nstack];
+    int u = stack[--nstack];
+    int t, k;
+    if (FindEdge(tr, u, v, &t, &k)) {
+      if (!AddConstraint(tr, u, v)) return FALSE;
+      continue;
+    }
+
+    // Find first triangle crossed by segment
+    int left, right, collinear;
+    int status = FindFirstCrossing(tr, u, v, &t, &left, &right, &collinear);
+    if (status == 0) return FALSE;
+    if (status == 2) {
+      if (nstack + 4 > 4 * tr->npoints) return FALSE;
+      stack[nstack++] = collinear; stack[nstack++] = v;
+      stack[nstack++] = u; stack[nstack++] = collinear;
+      continue;
+    }
+
+    // Walk along segment collecting crossed edges
+    int nqueue = 0;
+    RNBoolean split = FALSE;
+    while (TRUE) {
+      if (++steps > max_steps) return FALSE;
+      if (nqueue + 2 > max_queue) return FALSE;
+      if (IsConstraint(tr, left, right)) return FALSE;
+      queue[nqueue++] = left;
+      queue[nqueue++] = right;
+      k = 0;
+      while ((k < 3) && (tr->vertices[3*t+k] + tr->vertices[3*t+(k+1)%3] != left + right)) k++;
+      if (k == 3) return FALSE;
+      int next = tr->neighbors[3*t+k];
+      if (next < 0) return FALSE;
+      int c = tr->vertices[3*next+0] + tr->vertices[3*next+1] + tr->vertices[3*next+2] - left - right;
+      t = next;
+      if (c == v) break;
+      int o = Orient(tr, u, v, c);
+      if (o > 0) left = c;
+      else if (o < 0) right = c;
+      else {
+        // Vertex on segment, so recover (u,c) now and (c,v) later
+        if (nstack + 2 > 4 * tr->npoints) return FALSE;
+        stack[nstack++] = c; stack[nstack++] = v;
+        v = c;
+        split = TRUE;
+        break;
+      }
+    }
+
+    // Flip crossed edges until none remains (Sloan)
+    int head = 0;
+    int count = nqueue / 2;
+    while (count > 0) {
+      if (++steps > max_steps) return FALSE;
+      int a = queue[2*head+0];
+      int b = queue[2*head+1];
+      head = (head + 1) % (max_queue / 2);
+      count--;
+      if (!FindEdge(tr, a, b, &t, &k)) return FALSE;
+      int tail = (head + count) % (max_queue / 2);
+      if (!FlipEdge(tr, t, k)) {
+        // Not convex, so try again later
+        queue[2*tail+0] = a;
+        queue[2*tail+1] = b;
+        count++;
+        continue;
+      }
+
+      // Check if new diagonal still crosses segment
+      int c = tr->vertices[3*t+0];
+      int d = tr->vertices[3*t+2];
+      if ((Orient(tr, u, v, c) * Orient(tr, u, v, d) < 0) && (Orient(tr, c, d, u) * Orient(tr, c, d, v) < 0)) {
+        queue[2*tail+0] = c;
+        queue[2*tail+1] = d;
+        count++;
+      }
+    }
+
+    // Check that edge was recovered
+    if (!FindEdge(tr, u, v, &t, &k)) return FALSE;
+    if (!AddConstraint(tr, u, v)) return FALSE;
+    if (split) continue;
+  }
+
+  // Return success
+  return TRUE;
+}
+
+
+
+static void
+PushEdge(int **stack, int *nstack, int *max_stack, int a, int b)
+{
+  // Grow stack if it is full
+  if (*nstack + 2 > *max_stack) {
+    int *buffer = new int [ 2 * (*max_stack) ];
+    for (int i = 0; i < *nstack; i++) buffer[i] = (*stack)[i];
+    delete [] *stack;
+    *stack = buffer;
+    *max_stack *= 2;
+  }
+
+  // Push edge
+  (*stack)[(*nstack)++] = a;
+  (*stack)[(*nstack)++] = b;
+}
+
+
+
+static void
+MakeDelaunay(BooleanTriangulation *tr)
+{
+  // Push every interior edge once
+  int max_stack = 6 * tr->ntriangles + 16;
+  int *stack = new int [ max_stack ];
+  int nstack = 0;
+  for (int t = 0; t < tr->ntriangles; t++) {
+    for (int k = 0; k < 3; k++) {
+      if (tr->neighbors[3*t+k] <= t) continue;
+      PushEdge(&stack, &nstack, &max_stack, tr->vertices[3*t+k], tr->vertices[3*t+(k+1)%3]);
+    }
+  }
+
+  // Flip unconstrained edges facing a vertex inside the circumcircle until none remains (Lawson)
+  int max_steps = 8 * (tr->ntriangles + 16) * (tr->npoints + 16);
+  for (int steps = 0; (nstack > 0) && (steps < max_steps); steps++) {
+    int b = stack[--nstack];
+    int a = stack[--nstack];
+    if (IsConstraint(tr, a, b)) continue;
+
+    // Get triangles (a,b,c) and (b,a,d) sharing edge, if it still exists
+    int t, k;
+    if (!FindEdge(tr, a, b, &t, &k)) continue;
+    if (tr->vertices[3*t+k] != a) { int swap = a; a = b; b = swap; }
+    int u = tr->neighbors[3*t+k];
+    if (u < 0) continue;
+    int c = tr->vertices[3*t+(k+2)%3];
+    int d = tr->vertices[3*u+0] + tr->vertices[3*u+1] + tr->vertices[3*u+2] - a - b;
+
+    // Flip edge if d is inside circle through (a,b,c), and check edges of the new triangles
+    if (InCircle(tr, a, b, c, d) <= 0) continue;
+    if (!FlipEdge(tr, t, k)) continue;
+    PushEdge(&stack, &nstack, &max_stack, c, a);
+    PushEdge(&stack, &nstack, &max_stack, a, d);
+    PushEdge(&stack, &nstack, &max_stack, d, b);
+    PushEdge(&stack, &nstack, &max_stack, b, c);
+  }
+
+  // Delete stack
+  delete [] stack;
+}
+
+
+
+struct BooleanTriangulationData {
+  const BooleanSolid *solids;
+  const R3Point *points;
+  const BooleanKey *point_keys;
+  const RNScalar *point_parameters;
+  int npoint_keys_offset;
+  BooleanSegment **segments;
+  int *face_first_segments[2];
+  int *face_segments[2];
+  int *cut_faces[2];
+  int ncut_faces[2];
+  int *face_npieces[2];
+  int **face_pieces[2];
+  int *face_nconstraints[2];
+  int **face_constraints[2];
+  int failed;
+};
+
+
+
+static int
+CompareInts(const void *data1, const void *data2)
+{
+  // Compare integers
+  int value1 = *((const int *) data1);
+  int value2 = *((const int *) data2);
+  if (value1 < value2) return -1;
+  if (value1 > value2) return 1;
+  return 0;
+}
+
+
+
+static int
+CompareEdgeParameters(const void *data1, const void *data2)
+{
+  // Compare parameters stored before point ids, then ids
+  const double *value1 = (const double *) data1;
+  const double *value2 = (const double *) data2;
+  if (value1[0] < value2[0]) return -1;
+  if (value1[0] > value2[0]) return 1;
+  if (value1[1] < value2[1]) return -1;
+  if (value1[1] > value2[1]) return 1;
+  return 0;
+}
+
+
+
+static void
+TriangulateBooleanFace(int index, int thread_index, void *data)
+{
+  // Get face
+  BooleanTriangulationData *tdata = (BooleanTriangulationData *) data;
+  int s = (index < tdata->ncut_faces[0]) ? 0 : 1;
+  int face = (s == 0) ? tdata->cut_faces[0][index] : tdata->cut_faces[1][index - tdata->ncut_faces[0]];
+  const BooleanSolid *solid = &tdata->solids[s];
+  int first_segment = tdata->face_first_segments[s][face];
+  int nsegments = tdata->face_first_segments[s][face+1] - first_segment;
+  const int *segment_indices = &tdata->face_segments[s][first_segment];
+
+  // Collect unique intersection points on face
+  int nunique = 0;
+  int *unique = new int [ 2 * nsegments ];
+  for (int i = 0; i < nsegments; i++) {
+    BooleanSegment *segment = tdata->segments[segment_indices[i]];
+    unique[nunique++] = segment->points[0];
+    unique[nunique++] = segment->points[1];
+  }
+  qsort(unique, nunique, sizeof(int), CompareInts);
+  int n = 0;
+  for (int i = 0; i < nunique; i++) {
+    if ((n == 0) || (unique[n-1] != unique[i])) unique[n++] = unique[i];
+  }
+  nunique = n;
+
+  // Create local vertices (corners first)
+  int npoints = 3 + nunique;
+  int *ids = new int [ npoints ];
+  for (int k = 0; k < 3; k++) ids[k] = solid->vertex_offset + solid->face_vertices[3*face+k];
+  for (int i = 0; i < nunique; i++) ids[3+i] = unique[i];
+
+  // Choose projection where corners are counterclockwise
+  const R3Point& p0 = tdata->points[ids[0]];
+  const R3Point& p1 = tdata->points[ids[1]];
+  const R3Point& p2 = tdata->points[ids[2]];
+  RNDimension dim = R3ProjectionDimension(p0, p1, p2);
+
+  // Initialize triangulation
+  BooleanTriangulation tr;
+  tr.points = tdata->points;
+  tr.ids = ids;
+  tr.npoints = npoints;
+  tr.dim = dim;
+  tr.sign = R3Orientation(p0, p1, p2, dim);
+  tr.ntriangles = 0;
+  int max_triangles = 2 * npoints + 1;
+  tr.vertices = new int [ 3 * max_triangles ];
+  tr.neighbors = new int [ 3 * max_triangles ];
+  tr.vertex_triangles = new int [ npoints ];
+  tr.nconstraints = 0;
+  tr.max_constraints = nsegments + 2 * npoints;
+  tr.constraints = new int [ 2 * tr.max_constraints ];
+  for (int i = 0; i < npoints; i++) tr.vertex_triangles[i] = -1;
+  SetTriangle(&tr, tr.ntriangles++, 0, 1, 2, -1, -1, -1);
+
+  // Insert points on edges in order along each edge (ordered by the parameters they were
+  // constructed with, so that both faces on an edge agree even where round-off reorders them)
+  double *edge_points = new double [ 2 * (nunique + 1) ];
+  for (int k = 0; k < 3; k++) {
+    int edge = solid->face_edges[3*face+k];
+    if (edge < 0) continue;
+    R3MeshVertex *vertex0 = solid->mesh->VertexOnEdge(solid->mesh->Edge(edge), 0);
+    RNBoolean reversed = (solid->mesh->VertexID(vertex0) != solid->face_vertices[3*face+k]) ? TRUE : FALSE;
+    int nedge_points = 0;
+    for (int i = 0; i < nunique; i++) {
+      const BooleanKey& key = tdata->point_keys[unique[i] - tdata->npoint_keys_offset];
+      if ((key.type != s) || (key.edge != edge)) continue;
+      edge_points[2*nedge_points+0] = tdata->point_parameters[unique[i] - tdata->npoint_keys_offset];
+      edge_points[2*nedge_points+1] = 3 + i;
+      nedge_points++;
+    }
+    qsort(edge_points, nedge_points, 2 * sizeof(double), CompareEdgeParameters);
+    int previous = k;
+    for (int i = 0; i < nedge_points; i++) {
+      int p = (int) edge_points[2*((reversed) ? nedge_points - 1 - i : i)+1];
+      int t, e;
+      if (!FindEdge(&tr, previous, (k+1)%3, &t, &e)) { tdata->failed = 1; break; }
+      SplitEdge(&tr, t, e, p);
+      previous = p;
+    }
+  }
+  delete [] edge_points;
+
+  // Insert points inside face
+  int last = 0;
+  for (int i = 0; i < nunique; i++) {
+    const BooleanKey& key = tdata->point_keys[unique[i] - tdata->npoint_keys_offset];
+    if (key.type == s) continue;
+    InsertPoint(&tr, 3 + i, last);
+    last = tr.vertex_triangles[3 + i];
+  }
+
+  // Insert segments as constraints
+  int *stack = new int [ 4 * npoints + 4 ];
+  int max_queue = 2 * (3 * max_triangles + 2);
+  int *queue = new int [ max_queue ];
+  for (int i = 0; i < nsegments; i++) {
+    BooleanSegment *segment = tdata->segments[segment_indices[i]];
+    int *u = (int *) bsearch(&segment->points[0], unique, nunique, sizeof(int), CompareInts);
+    int *v = (int *) bsearch(&segment->points[1], unique, nunique, sizeof(int), CompareInts);
+    if (!u || !v || !InsertConstraint(&tr, 3 + (u - unique), 3 + (v - unique), stack, queue, max_queue)) {
+      tdata->failed = 1;
+      break;
+    }
+  }
+  delete [] stack;
+  delete [] queue;
+
+  // Restore Delaunay property away from constraints (recovery flips leave arbitrary triangles)
+  MakeDelaunay(&tr);
+
+  // Store triangles as global point ids
+  int *pieces = new int [ 3 * tr.ntriangles ];
+  for (int t = 0; t < tr.ntriangles; t++) {
+    for (int k = 0; k < 3; k++) pieces[3*t+k] = ids[tr.vertices[3*t+k]];
+  }
+  tdata->face_pieces[s][face] = pieces;
+  tdata->face_npieces[s][face] = tr.ntriangles;
+
+  // Store constraint edges as global point ids (segments split at collinear points have several)
+  int *constraints = new int [ 2 * tr.nconstraints + 1 ];
+  for (int i = 0; i < tr.nconstraints; i++) {
+    int p0 = ids[tr.constraints[2*i+0]], p1 = ids[tr.constraints[2*i+1]];
+    constraints[2*i+0] = (p0 < p1) ? p0 : p1;
+    constraints[2*i+1] = (p0 < p1) ? p1 : p0;
+  }
+  tdata->face_constraints[s][face] = constraints;
+  tdata->face_nconstraints[s][face] = tr.nconstraints;
+
+  // Delete temporary memory
+  delete [] tr.vertices;
+  delete [] tr.neighbors;
+  delete [] tr.vertex_triangles;
+  delete [] tr.constraints;
+  delete [] ids;
+  delete [] unique;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Classification functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+FindRoot(int *parents, int i)
+{
+  // Find root of union-find set with path halving
+  while (parents[i] != i) {
+    parents[i] = parents[parents[i]];
+    i = parents[i];
+  }
+  return i;
+}
+
+
+
+static void
+UnionSets(int *parents, int i, int j)
+{
+  // Merge union-find sets (smaller root becomes parent)
+  i = FindRoot(parents, i);
+  j = FindRoot(parents, j);
+  if (i < j) parents[j] = i;
+  else if (j < i) parents[i] = j;
+}
+
+
+
+static int
+CompareEdgeRecords(const void *data1, const void *data2)
+{
+  // Compare vertex pairs of records (vertex, vertex, piece)
+  const int *record1 = (const int *) data1;
+  const int *record2 = (const int *) data2;
+  if (record1[0] != record2[0]) return (record1[0] < record2[0]) ? -1 : 1;
+  if (record1[1] != record2[1]) return (record1[1] < record2[1]) ? -1 : 1;
+  return 0;
+}
+
+
+
+static int
+ComparePositionRecords(const void *data1, const void *data2)
+{
+  // Compare coordinates of records (x, y, z, point), then points
+  const double *record1 = (const double *) data1;
+  const double *record2 = (const double *) data2;
+  for (int i = 0; i < 4; i++) {
+    if (record1[i] < record2[i]) return -1;
+    if (record1[i] > record2[i]) return 1;
+  }
+  return 0;
+}
+
+
+
+static RNBoolean
+SegmentOverlapsBox(const R3Point& p, const R3Vector& d, const double *box)
+{
+  // Clip parametric segment p + t * d (t in [0,1]) against box slabs
+  double tmin = 0, tmax = 1;
+  for (int dim = 0; dim < 3; dim++) {
+    if (d[dim] == 0) {
+      if ((p[dim] < box[dim]) || (p[dim] > box[3+dim])) return FALSE;
+      continue;
+    }
+    double t1 = (box[dim] - p[dim]) / d[dim];
+    double t2 = (box[3+dim] - p[dim]) / d[dim];
+    if (t1 > t2) { double swap = t1; t1 = t2; t2 = swap; }
+    if (t1 > tmin) tmin = t1;
+    if (t2 < tmax) tmax = t2;
+    if (tmin > tmax) return FALSE;
+  }
+  return TRUE;
+}
+
+
+
+static int
+BooleanWindingNumber(const BooleanSolid *solid, const R3Point& point, RNBoolean *degenerate)
+{
+  // Get ray length reaching outside solid
+  R3Vector extent = solid->bbox.Max() - solid->bbox.Min();
+  RNLength length = 2 * (extent.Length() + R3Distance(point, solid->bbox.Centroid())) + 1;
+  RNLength margin = 1E-6 * (extent.Length() + 1);
+
+  // Cast rays until one misses all edges and vertices
+  for (int ray = 0; ray < max_winding_rays; ray++) {
+    // Choose direction
+    RNAngle theta = 0.7548776662 + 2.3999632297 * ray;
+    RNScalar z = 0.8 * cos(1.3247179572 + 2.0 * ray);
+    RNScalar r = sqrt(1 - z * z);
+    R3Vector direction(r * cos(theta), r * sin(theta), z);
+    R3Point end = point + length * direction;
+    R3Vector d = end - point;
+
+    // Sum signed crossings of faces
+    int winding = 0;
+    RNBoolean bad = FALSE;
+    int stack[R3FaceHierarchy::max_stack_size];
+    int nstack = 0;
+    if (solid->hierarchy.NNodes() > 0) stack[nstack++] = 0;
+    while ((nstack > 0) && !bad) {
+      // Pop node and check its box (expanded to account for round-off)
+      int node = stack[--nstack];
+      double box[6];
+      for (int dim = 0; dim < 3; dim++) {
+        box[dim] = solid->hierarchy.NodeBox(node)[dim] - margin;
+        box[3+dim] = solid->hierarchy.NodeBox(node)[3+dim] + margin;
+      }
+      if (!SegmentOverlapsBox(point, d, box)) continue;
+
+      // Check if interior node
+      if (solid->hierarchy.NodeChild(node, 0) >= 0) {
+        assert(nstack + 2 <= R3FaceHierarchy::max_stack_size);
+        stack[nstack++] = solid->hierarchy.NodeChild(node, 1);
+        stack[nstack++] = solid->hierarchy.NodeChild(node, 0);
+        continue;
+      }
+
+      // Check faces in leaf
+      int first = solid->hierarchy.NodeFirstFace(node);
+      for (int i = 0; i < solid->hierarchy.NodeNFaces(node); i++) {
+        int face = solid->hierarchy.Face(first + i);
+        if (solid->face_degenerate[face]) continue;
+        const R3Point& t0 = solid->positions[solid->face_vertices[3*face+0]];
+        const R3Point& t1 = solid->positions[solid->face_vertices[3*face+1]];
+        const R3Point& t2 = solid->positions[solid->face_vertices[3*face+2]];
+        int sp = R3Orientation(t0, t1, t2, point);
+        int sq = R3Orientation(t0, t1, t2, end);
+        if (sp * sq > 0) continue;
+        if ((sp == 0) || (sq == 0)) { bad = TRUE; break; }
+        int status = EdgeCrossesTriangle(point, end, t0, t1, t2);
+        if (status < 0) { bad = TRUE; break; }
+        if (status > 0) winding -= sp;
+      }
+    }
+
+    // Return winding number if ray was in general position
+    if (!bad) return winding;
+  }
+
+  // All rays were degenerate
+  *degenerate = TRUE;
+  return 0;
+}
+
+
+
+struct BooleanClassificationData {
+  const BooleanSolid *solids;
+  const R3Point *points;
+  int *component_solids;
+  int *component_pieces;
+  int **piece_points;
+  int *windings;
+  int degenerate;
+};
+
+
+
+static void
+ClassifyBooleanComponent(int index, int thread_index, void *data)
+{
+  // Compute winding number of other solid at centroid of representative piece
+  BooleanClassificationData *cdata = (BooleanClassificationData *) data;
+  int s = cdata->component_solids[index];
+  const int *piece = &cdata->piece_points[s][3*cdata->component_pieces[index]];
+  R3Point centroid = (cdata->points[piece[0]] + cdata->points[piece[1]] + cdata->points[piece[2]]) / 3.0;
+  RNBoolean degenerate = FALSE;
+  cdata->windings[index] = BooleanWindingNumber(&cdata->solids[1-s], centroid, &degenerate);
+  if (degenerate) cdata->degenerate = 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Operation functions
+////////////////////////////////////////////////////////////////////////
+
+static int
+ComputeBoolean(R3MeshBoolean *boolean, int operation, R3Mesh *result, R3Point **positions,
+  const BooleanSolid *originals, const BooleanCoplanarFaces *coplanar, RNBoolean last, RNBoolean *degenerate)
+{
+  // Snapshot operands (intersection points are numbered after the vertices of both meshes)
+  R3Mesh *mesh0 = boolean->meshes[0];
+  R3Mesh *mesh1 = boolean->meshes[1];
+  BooleanSolid solids[2];
+  CreateBooleanSolid(&solids[0], mesh0, 0, positions[0]);
+  CreateBooleanSolid(&solids[1], mesh1, mesh0->NVertices(), positions[1]);
+  int nvertices = mesh0->NVertices() + mesh1->NVertices();
+  int nthreads = (boolean->nthreads > 0) ? boolean->nthreads : RNNumberOfThreads();
+  if (nthreads < 1) nthreads = 1;
+
+  // Find intersection segments in parallel
+  BooleanSegmentData segment_data;
+  segment_data.solids = solids;
+  segment_data.results = new RNArray<BooleanSegment *> [ nthreads ];
+  segment_data.degenerate = 0;
+  RNParallelFor(solids[0].nfaces, FindBooleanSegments, &segment_data, nthreads, 64);
+  int nsegments = 0;
+  for (int t = 0; t < nthreads; t++) nsegments += segment_data.results[t].NEntries();
+  BooleanSegment **segments = new BooleanSegment * [ nsegments + 1 ];
+  nsegments = 0;
+  for (int t = 0; t < nthreads; t++) {
+    for (int i = 0; i < segment_data.results[t].NEntries(); i++) {
+      segments[nsegments++] = segment_data.results[t].Kth(i);
+    }
+  }
+  delete [] segment_data.results;
+  *degenerate = (segment_data.degenerate) ? TRUE : FALSE;
+
+  // Number unique intersection points
+  BooleanKey *keys = new BooleanKey [ 2 * nsegments + 1 ];
+  int nkeys = 0;
+  if (!*degenerate) {
+    for (int i = 0; i < nsegments; i++) {
+      keys[nkeys++] = segments[i]->keys[0];
+      keys[nkeys++] = segments[i]->keys[1];
+    }
+    qsort(keys, nkeys, sizeof(BooleanKey), CompareBooleanKeys);
+    int n = 0;
+    for (int i = 0; i < nkeys; i++) {
+      if ((n == 0) || (CompareBooleanKeys(&keys[n-1], &keys[i]) != 0)) keys[n++] = keys[i];
+    }
+    nkeys = n;
+    for (int i = 0; i < nsegments; i++) {
+      for (int k = 0; k < 2; k++) {
+        BooleanKey *key = (BooleanKey *) bsearch(&segments[i]->keys[k], keys, nkeys, sizeof(BooleanKey), CompareBooleanKeys);
+        segments[i]->points[k] = nvertices + (key - keys);
+      }
+    }
+  }
+
+  // Compute positions of all points, and their positions without perturbation for the result
+  // (edges parallel to faces before perturbation keep the parameters of the perturbed crossings)
+  int npoints = nvertices + nkeys;
+  R3Point *points = new R3Point [ npoints + 1 ];
+  R3Point *result_points = new R3Point [ npoints + 1 ];
+  for (int i = 0; i < solids[0].nvertices; i++) points[i] = positions[0][i];
+  for (int i = 0; i < solids[1].nvertices; i++) points[solids[1].vertex_offset + i] = positions[1][i];
+  for (int i = 0; i < originals[0].nvertices; i++) result_points[i] = originals[0].positions[i];
+  for (int i = 0; i < originals[1].nvertices; i++) result_points[originals[1].vertex_offset + i] = originals[1].positions[i];
+  RNScalar *parameters = new RNScalar [ nkeys + 1 ];
+  for (int i = 0; i < nkeys; i++) {
+    parameters[i] = 0.5;
+    points[nvertices + i] = BooleanKeyPosition(solids, keys[i], &parameters[i]);
+    RNScalar parameter = parameters[i];
+    result_points[nvertices + i] = BooleanKeyPosition(originals, keys[i], &parameter);
+  }
+
+  // Group segments by face of each solid (counting sort)
+  int *face_first_segments[2], *face_segments[2];
+  int *cut_faces[2], ncut_faces[2];
+  int *face_npieces[2], **face_pieces[2];
+  int *face_nconstraints[2], **face_constraints[2];
+  for (int s = 0; s < 2; s++) {
+    int nfaces = solids[s].nfaces;
+    face_first_segments[s] = new int [ nfaces + 2 ];
+    face_segments[s] = new int [ nsegments + 1 ];
+    for (int f = 0; f <= nfaces + 1; f++) face_first_segments[s][f] = 0;
+    if (!*degenerate) {
+      for (int i = 0; i < nsegments; i++) face_first_segments[s][segments[i]->faces[s] + 2]++;
+    }
+    for (int f = 2; f <= nfaces + 1; f++) face_first_segments[s][f] += face_first_segments[s][f-1];
+    if (!*degenerate) {
+      for (int i = 0; i < nsegments; i++) face_segments[s][face_first_segments[s][segments[i]->faces[s] + 1]++] = i;
+    }
+    cut_faces[s] = new int [ nfaces + 1 ];
+    ncut_faces[s] = 0;
+    face_npieces[s] = new int [ nfaces + 1 ];
+    face_pieces[s] = new int * [ nfaces + 1 ];
+    face_nconstraints[s] = new int [ nfaces + 1 ];
+    face_constraints[s] = new int * [ nfaces + 1 ];
+    for (int f = 0; f < nfaces; f++) {
+      face_npieces[s][f] = 0;
+      face_pieces[s][f] = NULL;
+      face_nconstraints[s][f] = 0;
+      face_constraints[s][f] = NULL;
+      if (face_first_segments[s][f+1] > face_first_segments[s][f]) cut_faces[s][ncut_faces[s]++] = f;
+    }
+  }
+
+  // Triangulate cut faces in parallel
+  BooleanTriangulationData tdata;
+  tdata.solids = solids;
+  tdata.points = points;
+  tdata.point_keys = keys;
+  tdata.point_parameters = parameters;
+  tdata.npoint_keys_offset = nvertices;
+  tdata.segments = segments;
+  tdata.failed = 0;
+  for (int s = 0; s < 2; s++) {
+    tdata.face_first_segments[s] = face_first_segments[s];
+    tdata.face_segments[s] = face_segments[s];
+    tdata.cut_faces[s] = cut_faces[s];
+    tdata.ncut_faces[s] = ncut_faces[s];
+    tdata.face_npieces[s] = face_npieces[s];
+    tdata.face_pieces[s] = face_pieces[s];
+    tdata.face_nconstraints[s] = face_nconstraints[s];
+    tdata.face_constraints[s] = face_constraints[s];
+  }
+  if (!*degenerate) {
+    RNParallelFor(ncut_faces[0] + ncut_faces[1], TriangulateBooleanFace, &tdata, nthreads, 16);
+    if (tdata.failed) *degenerate = TRUE;
+  }
+
+  // Build pieces of each solid and group them into components bounded by intersection curves
+  int npieces[2] = { 0, 0 };
+  int *piece_points[2] = { NULL, NULL };
+  int *piece_faces[2] = { NULL, NULL };
+  int *piece_components[2] = { NULL, NULL };
+  int ncomponents = 0;
+  int *component_solids = NULL, *component_pieces = NULL;
+  RNArea *component_areas = NULL;
+  if (!*degenerate) {
+    // Count components to allocate
+    int max_components = 0;
+    for (int s = 0; s < 2; s++) {
+      for (int f = 0; f < solids[s].nfaces; f++) npieces[s] += (face_pieces[s][f]) ? face_npieces[s][f] : 1;
+      max_components += npieces[s];
+    }
+    component_solids = new int [ max_components + 1 ];
+    component_pieces = new int [ max_components + 1 ];
+    component_areas = new RNArea [ max_components + 1 ];
+
+    for (int s = 0; s < 2; s++) {
+      // Create pieces
+      const BooleanSolid *solid = &solids[s];
+      R3Mesh *mesh = solid->mesh;
+      piece_points[s] = new int [ 3 * npieces[s] + 1 ];
+      piece_faces[s] = new int [ npieces[s] + 1 ];
+      int *face_first_pieces = new int [ solid->nfaces + 1 ];
+      int n = 0;
+      for (int f = 0; f < solid->nfaces; f++) {
+        face_first_pieces[f] = n;
+        if (face_pieces[s][f]) {
+          for (int i = 0; i < face_npieces[s][f]; i++) {
+            for (int k = 0; k < 3; k++) piece_points[s][3*n+k] = face_pieces[s][f][3*i+k];
+            piece_faces[s][n++] = f;
+          }
+        }
+        else {
+          for (int k = 0; k < 3; k++) piece_points[s][3*n+k] = solid->vertex_offset + solid->face_vertices[3*f+k];
+          piece_faces[s][n++] = f;
+        }
+      }
+
+      // Join uncut faces across mesh edges, and collect edges of pieces near cut faces
+      int *parents = new int [ npieces[s] + 1 ];
+      for (int i = 0; i < npieces[s]; i++) parents[i] = i;
+      int *records = new int [ 9 * npieces[s] + 1 ];
+      int nrecords = 0;
+      for (int f = 0; f < solid->nfaces; f++) {
+        RNBoolean cut = (face_pieces[s][f]) ? TRUE : FALSE;
+        int first = face_first_pieces[f];
+        int count = (cut) ? face_npieces[s][f] : 1;
+        for (int k = 0; k < 3; k++) {
+          RNBoolean record = cut;
+          if (!cut) {
+            R3MeshFace *face = mesh->Face(f);
+            int e = solid->face_edges[3*f+k];
+            R3MeshFace *neighbor = (e >= 0) ? mesh->FaceAcrossEdge(mesh->Edge(e), face) : NULL;
+            if (!neighbor) continue;
+            int g = mesh->FaceID(neighbor);
+            if (face_pieces[s][g]) record = TRUE;
+            else UnionSets(parents, first, face_first_pieces[g]);
+          }
+          if (!record) continue;
+          for (int i = first; i < first + count; i++) {
+            int p0 = piece_points[s][3*i+k], p1 = piece_points[s][3*i+(k+1)%3];
+            records[3*nrecords+0] = (p0 < p1) ? p0 : p1;
+            records[3*nrecords+1] = (p0 < p1) ? p1 : p0;
+            records[3*nrecords+2] = i;
+            nrecords++;
+          }
+        }
+      }
+
+      // Sort edges of intersection curves (they separate pieces on different sides of the other solid)
+      int nconstraints = 0;
+      for (int f = 0; f < solid->nfaces; f++) nconstraints += face_nconstraints[s][f];
+      int *constraints = new int [ 2 * nconstraints + 1 ];
+      nconstraints = 0;
+      for (int f = 0; f < solid->nfaces; f++) {
+        for (int i = 0; i < 2 * face_nconstraints[s][f]; i++) constraints[nconstraints++] = face_constraints[s][f][i];
+      }
+      nconstraints /= 2;
+      qsort(constraints, nconstraints, 2 * sizeof(int), CompareEdgeRecords);
+
+      // Join pieces sharing edges that are not on intersection curves
+      qsort(records, nrecords, 3 * sizeof(int), CompareEdgeRecords);
+      for (int i = 0; i < nrecords; ) {
+        int j = i + 1;
+        while ((j < nrecords) && (CompareEdgeRecords(&records[3*i], &records[3*j]) == 0)) j++;
+        if ((j - i > 1) && !bsearch(&records[3*i], constraints, nconstraints, 2 * sizeof(int), CompareEdgeRecords)) {
+          for (int m = i + 1; m < j; m++) UnionSets(parents, records[3*i+2], records[3*m+2]);
+        }
+        i = j;
+      }
+      delete [] constraints;
+      delete [] records;
+      delete [] face_first_pieces;
+
+      // Number components and choose largest piece of each as representative
+      piece_components[s] = new int [ npieces[s] + 1 ];
+      for (int i = 0; i < npieces[s]; i++) {
+        int root = FindRoot(parents, i);
+        if (root == i) {
+          component_solids[ncomponents] = s;
+          component_pieces[ncomponents] = i;
+          component_areas[ncomponents] = -1;
+          piece_components[s][i] = ncomponents++;
+        }
+        else {
+          piece_components[s][i] = piece_components[s][root];
+        }
+        int c = piece_components[s][i];
+        const int *piece = &piece_points[s][3*i];
+        RNArea area = 0.5 * ((points[piece[1]] - points[piece[0]]) % (points[piece[2]] - points[piece[0]])).Length();
+        if (area > component_areas[c]) {
+          component_areas[c] = area;
+          component_pieces[c] = i;
+        }
+      }
+      delete [] parents;
+    }
+  }
+
+  // Compute winding number of other solid for every component in parallel
+  int *windings = new int [ ncomponents + 1 ];
+  if (!*degenerate) {
+    BooleanClassificationData cdata;
+    cdata.solids = solids;
+    cdata.points = points;
+    cdata.component_solids = component_solids;
+    cdata.component_pieces = component_pieces;
+    cdata.piece_points = piece_points;
+    cdata.windings = windings;
+    cdata.degenerate = 0;
+    RNParallelFor(ncomponents, ClassifyBooleanComponent, &cdata, nthreads, 1);
+    if (cdata.degenerate) *degenerate = TRUE;
+  }
+
+  // Merge points at identical positions (pieces narrower than the perturbation collapse onto them),
+  // preferring vertices of the operands
+  int *canonical = new int [ npoints + 1 ];
+  if (!*degenerate) {
+    double *records = new double [ 4 * npoints + 1 ];
+    for (int i = 0; i < npoints; i++) {
+      for (int dim = 0; dim < 3; dim++) records[4*i+dim] = result_points[i][dim];
+      records[4*i+3] = i;
+    }
+    qsort(records, npoints, 4 * sizeof(double), ComparePositionRecords);
+    for (int i = 0; i < npoints; ) {
+      int j = i + 1;
+      while ((j < npoints) && (records[4*j+0] == records[4*i+0]) &&
+        (records[4*j+1] == records[4*i+1]) && (records[4*j+2] == records[4*i+2])) j++;
+      for (int m = i; m < j; m++) canonical[(int) records[4*m+3]] = (int) records[4*i+3];
+      i = j;
+    }
+    delete [] records;
+  }
+
+  // Select pieces by operation (as triangles of merged points with their solid and source face)
+  int ntriangles = 0;
+  int *triangles = new int [ 5 * (npieces[0] + npieces[1]) + 1 ];
+  if (!*degenerate) {
+    for (int s = 0; s < 2; s++) {
+      for (int i = 0; i < npieces[s]; i++) {
+        // Skip pieces that collapse without perturbation
+        int c[3];
+        for (int k = 0; k < 3; k++) c[k] = canonical[piece_points[s][3*i+k]];
+        if ((c[0] == c[1]) || (c[1] == c[2]) || (c[2] == c[0])) continue;
+
+        // Check if piece is kept (pieces on a coplanar face of the other solid are kept once, from the
+        // second solid, where both faces point the same way for union and intersection and where they
+        // point opposite ways for difference, as the perturbation separates them, and other pieces are
+        // kept by the winding number of the other solid)
+        const int *piece = &piece_points[s][3*i];
+        R3Point centroid = (result_points[piece[0]] + result_points[piece[1]] + result_points[piece[2]]) / 3.0;
+        int orientation = CoplanarPieceOrientation(originals, coplanar, s, piece_faces[s][i], centroid);
+        RNBoolean inside = (windings[piece_components[s][i]] != 0) ? TRUE : FALSE;
+        RNBoolean keep = FALSE, flip = FALSE;
+        if (operation == R3_MESH_UNION_OPERATION) {
+          if (orientation > 0) keep = (s == 1);
+          else if (orientation < 0) keep = FALSE;
+          else keep = !inside;
+        }
+        else if (operation == R3_MESH_INTERSECTION_OPERATION) {
+          if (orientation > 0) keep = (s == 1);
+          else if (orientation < 0) keep = FALSE;
+          else keep = inside;
+        }
+        else if (operation == R3_MESH_DIFFERENCE_OPERATION) {
+          if (orientation > 0) keep = FALSE;
+          else if (orientation < 0) keep = (s == 1);
+          else keep = (s == 0) ? !inside : inside;
+          flip = (s == 1);
+        }
+        if (!keep) continue;
+
+        // Remember triangle
+        int *triangle = &triangles[5*ntriangles++];
+        triangle[0] = c[0];
+        triangle[1] = (flip) ? c[2] : c[1];
+        triangle[2] = (flip) ? c[1] : c[2];
+        triangle[3] = s;
+        triangle[4] = piece_faces[s][i];
+      }
+    }
+  }
+
+  // Remove triangles whose corners became collinear (if another triangle is across the edge
+  // between the outer corners, it is split at the middle corner, and otherwise the triangle is a fold)
+  int ncollinear = 0;
+  if (!*degenerate) {
+    int *records = new int [ 9 * ntriangles + 1 ];
+    RNBoolean *modified = new RNBoolean [ ntriangles + 1 ];
+    for (int pass = 0; pass <= max_collinear_passes; pass++) {
+      // Sort directed edges of triangles
+      int nrecords = 0;
+      for (int t = 0; t < ntriangles; t++) {
+        modified[t] = FALSE;
+        if (triangles[5*t] < 0) continue;
+        for (int k = 0; k < 3; k++) {
+          records[3*nrecords+0] = triangles[5*t+k];
+          records[3*nrecords+1] = triangles[5*t+(k+1)%3];
+          records[3*nrecords+2] = t;
+          nrecords++;
+        }
+      }
+      qsort(records, nrecords, 3 * sizeof(int), CompareEdgeRecords);
+
+      // Split or remove collinear triangles
+      ncollinear = 0;
+      for (int t = 0; t < ntriangles; t++) {
+        // Check if triangle is collinear
+        int *triangle = &triangles[5*t];
+        if ((triangle[0] < 0) || modified[t]) continue;
+        const R3Point& p0 = result_points[triangle[0]];
+        const R3Point& p1 = result_points[triangle[1]];
+        const R3Point& p2 = result_points[triangle[2]];
+        if ((R3Orientation(p0, p1, p2, RN_X) != 0) || (R3Orientation(p0, p1, p2, RN_Y) != 0) ||
+          (R3Orientation(p0, p1, p2, RN_Z) != 0)) continue;
+        ncollinear++;
+        if (pass == max_collinear_passes) continue;
+
+        // Find outer corners a and b, and middle corner c
+        RNLength d[3];
+        for (int k = 0; k < 3; k++) d[k] = R3Distance(result_points[triangle[k]], result_points[triangle[(k+1)%3]]);
+        int k = (d[0] >= d[1]) ? ((d[0] >= d[2]) ? 0 : 2) : ((d[1] >= d[2]) ? 1 : 2);
+        int a = triangle[k], b = triangle[(k+1)%3], c = triangle[(k+2)%3];
+
+        // Find triangle across edge between outer corners
+        int key[2] = { b, a };
+        int *record = (int *) bsearch(key, records, nrecords, 3 * sizeof(int), CompareEdgeRecords);
+        int n = (record) ? record[2] : -1;
+        if ((n >= 0) && ((triangles[5*n] < 0) || modified[n])) continue;
+
+        // Split triangle across edge (replacing both triangles), or remove fold or pair of opposite folds
+        if (n >= 0) {
+          int *neighbor = &triangles[5*n];
+          int m = 0;
+          while ((m < 3) && (neighbor[m] != b)) m++;
+          int e = neighbor[(m+2)%3];
+          if (e == c) {
+            triangle[0] = -1;
+            neighbor[0] = -1;
+            modified[t] = TRUE;
+            modified[n] = TRUE;
+            continue;
+          }
+          triangle[0] = c;
+          triangle[1] = a;
+          triangle[2] = e;
+          triangle[3] = neighbor[3];
+          triangle[4] = neighbor[4];
+          neighbor[0] = b;
+          neighbor[1] = c;
+          neighbor[2] = e;
+          modified[n] = TRUE;
+        }
+        else {
+          triangle[0] = -1;
+        }
+        modified[t] = TRUE;
+      }
+      if (ncollinear == 0) break;
+    }
+    delete [] records;
+    delete [] modified;
+  }
+
+  // Create result mesh from selected triangles
+  int nfailed = 0;
+  if (!*degenerate) {
+    R3MeshVertex **vertices = new R3MeshVertex * [ npoints + 1 ];
+    for (int i = 0; i < npoints; i++) vertices[i] = NULL;
+    for (int t = 0; t < ntriangles; t++) {
+      const int *triangle = &triangles[5*t];
+      if (triangle[0] < 0) continue;
+      int s = triangle[3];
+      RNBoolean flip = ((operation == R3_MESH_DIFFERENCE_OPERATION) && (s == 1)) ? TRUE : FALSE;
+
+      // Create vertices (copying attributes of mesh vertices)
+      R3MeshVertex *v[3];
+      for (int k = 0; k < 3; k++) {
+        int p = triangle[k];
+        if (!vertices[p]) {
+          if (p < nvertices) {
+            int u = (p < solids[1].vertex_offset) ? 0 : 1;
+            R3Mesh *source_mesh = solids[u].mesh;
+            R3MeshVertex *source = source_mesh->Vertex(p - solids[u].vertex_offset);
+            R3Vector normal = source_mesh->VertexNormal(source);
+            if (flip) normal.Flip();
+            vertices[p] = result->CreateVertex(result_points[p], normal,
+              source_mesh->VertexColor(source), source_mesh->VertexTextureCoords(source));
+          }
+          else {
+            vertices[p] = result->CreateVertex(result_points[p]);
+          }
+        }
+        v[k] = vertices[p];
+      }
+
+      // Create face (copying attributes of source face)
+      R3Mesh *mesh = solids[s].mesh;
+      R3MeshFace *face = result->CreateFace(v[0], v[1], v[2]);
+      if (!face) { nfailed++; continue; }
+      R3MeshFace *source = mesh->Face(triangle[4]);
+      result->SetFaceMaterial(face, mesh->FaceMaterial(source));
+      result->SetFaceSegment(face, mesh->FaceSegment(source));
+      result->SetFaceCategory(face, mesh->FaceCategory(source));
+    }
+    delete [] vertices;
+  }
+
+  // Count boundary edges of result that were not on boundaries of operands
+  int nopen = 0;
+  if (!*degenerate) {
+    for (int i = 0; i < result->NEdges(); i++) {
+      if (result->IsEdgeOnBoundary(result->Edge(i))) nopen++;
+    }
+    for (int s = 0; s < 2; s++) {
+      R3Mesh *mesh = solids[s].mesh;
+      for (int i = 0; i < mesh->NEdges(); i++) {
+        if (mesh->IsEdgeOnBoundary(mesh->Edge(i))) nopen--;
+      }
+    }
+  }
+
+  // Check faces that would have made result non-manifold, left it open, or stayed degenerate (pieces
+  // narrower than round-off error of intersection points can be misclassified, so retry with larger perturbation)
+  if ((nfailed > 0) || (nopen > 0) || (ncollinear > 0)) {
+    if (!last) *degenerate = TRUE;
+    else if (nfailed > 0) fprintf(stderr, "Warning: skipped %d faces that would make boolean result non-manifold\n", nfailed);
+    else if (nopen > 0) fprintf(stderr, "Warning: boolean result has %d boundary edges not in operands\n", nopen);
+    else fprintf(stderr, "Warning: boolean result has %d faces with collinear vertices\n", ncollinear);
+  }
+
+  // Remember statistics
+  boolean->nintersection_segments = (*degenerate) ? 0 : nsegments;
+
+  // Delete temporary memory
+  for (int s = 0; s < 2; s++) {
+    for (int f = 0; f < solids[s].nfaces; f++) {
+      if (face_pieces[s][f]) delete [] face_pieces[s][f];
+      if (face_constraints[s][f]) delete [] face_constraints[s][f];
+    }
+    delete [] face_pieces[s];
+    delete [] face_npieces[s];
+    delete [] face_constraints[s];
+    delete [] face_nconstraints[s];
+    delete [] cut_faces[s];
+    delete [] face_segments[s];
+    delete [] face_first_segments[s];
+    if (piece_points[s]) delete [] piece_points[s];
+    if (piece_faces[s]) delete [] piece_faces[s];
+    if (piece_components[s]) delete [] piece_components[s];
+    DeleteBooleanSolid(&solids[s]);
+  }
+  if (component_solids) delete [] component_solids;
+  if (component_pieces) delete [] component_pieces;
+  if (component_areas) delete [] component_areas;
+  for (int i = 0; i < nsegments; i++) delete segments[i];
+  delete [] segments;
+  delete [] windings;
+  delete [] parameters;
+  delete [] triangles;
+  delete [] canonical;
+  delete [] result_points;
+  delete [] points;
+  delete [] keys;
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3MeshBoolean::
+Compute(int operation, R3Mesh *result)
+{
+  // Check arguments
+  if (!meshes[0] || !meshes[1] || !result || (result == meshes[0]) || (result == meshes[1]) || (meshes[0] == meshes[1])) {
+    fprintf(stderr, "Invalid meshes for boolean operation\n");
+    return 0;
+  }
+  if ((operation < R3_MESH_UNION_OPERATION) || (operation > R3_MESH_DIFFERENCE_OPERATION)) {
+    fprintf(stderr, "Invalid boolean operation: %d\n", operation);
+    return 0;
+  }
+
+  // Get positions of both meshes
+  R3Point *positions[2];
+  R3Box bbox = R3null_box;
+  for (int s = 0; s < 2; s++) {
+    positions[s] = new R3Point [ meshes[s]->NVertices() + 1 ];
+    for (int i = 0; i < meshes[s]->NVertices(); i++) positions[s][i] = meshes[s]->VertexPosition(meshes[s]->Vertex(i));
+    bbox.Union(meshes[s]->BBox());
+  }
+  RNLength scale = perturbation_scale * bbox.DiagonalLength();
+  if (scale <= 0) scale = perturbation_scale;
+
+  // Snapshot operands without perturbation and find their overlapping coplanar faces
+  int nthreads = (this->nthreads > 0) ? this->nthreads : RNNumberOfThreads();
+  if (nthreads < 1) nthreads = 1;
+  R3Point *original_positions[2];
+  BooleanSolid originals[2];
+  for (int s = 0; s < 2; s++) {
+    original_positions[s] = new R3Point [ meshes[s]->NVertices() + 1 ];
+    for (int i = 0; i < meshes[s]->NVertices(); i++) original_positions[s][i] = positions[s][i];
+  }
+  CreateBooleanSolid(&originals[0], meshes[0], 0, original_positions[0]);
+  CreateBooleanSolid(&originals[1], meshes[1], meshes[0]->NVertices(), original_positions[1]);
+  BooleanCoplanarFaces coplanar;
+  CreateCoplanarFaces(&coplanar, originals, nthreads);
+
+  // Compute directions moving faces of second mesh coplanar with the first one along their normals
+  // (other vertices move along their normals)
+  R3Vector *directions = new R3Vector [ meshes[1]->NVertices() + 1 ];
+  for (int i = 0; i < meshes[1]->NVertices(); i++) directions[i] = R3zero_vector;
+  for (int f = 0; f < meshes[1]->NFaces(); f++) {
+    if (coplanar.face_first[1][f+1] == coplanar.face_first[1][f]) continue;
+    R3MeshFace *face = meshes[1]->Face(f);
+    for (int k = 0; k < 3; k++) directions[meshes[1]->VertexID(meshes[1]->VertexOnFace(face, k))] += meshes[1]->FaceNormal(face);
+  }
+  for (int i = 0; i < meshes[1]->NVertices(); i++) {
+    if (directions[i].IsZero()) directions[i] = meshes[1]->VertexNormal(meshes[1]->Vertex(i));
+    else directions[i].Normalize();
+  }
+
+  // Compute operation, perturbing vertices until configuration is not degenerate (the second mesh
+  // is grown along its normals for union and difference and shrunk for intersection, so that its
+  // faces coplanar with the first mesh separate from them on the side where their pieces are split
+  // along the boundaries of the overlap, and both meshes are jittered, so that sliver faces are widened)
+  RNScalar direction = (operation == R3_MESH_INTERSECTION_OPERATION) ? -1 : 1;
+  int status = 0;
+  nintersection_segments = 0;
+  nperturbations = 0;
+  while (TRUE) {
+    RNBoolean degenerate = FALSE;
+    result->Empty();
+    if (!ComputeBoolean(this, operation, result, positions, originals, &coplanar, (nperturbations >= max_perturbations), &degenerate)) break;
+    if (!degenerate) { status = 1; break; }
+    if (nperturbations >= max_perturbations) break;
+    nperturbations++;
+    int index = 0;
+    for (int s = 0; s < 2; s++) {
+      for (int i = 0; i < meshes[s]->NVertices(); i++, index++) {
+        R3Vector offset(PerturbationValue(3*index+0, nperturbations), PerturbationValue(3*index+1, nperturbations), PerturbationValue(3*index+2, nperturbations));
+        offset *= perturbation_jitter;
+        if (s == 1) offset += direction * directions[i];
+        positions[s][i] = original_positions[s][i] + scale * offset;
+      }
+    }
+    scale *= perturbation_growth;
+  }
+
+  // Delete positions and snapshots
+  DeleteCoplanarFaces(&coplanar);
+  delete [] directions;
+  DeleteBooleanSolid(&originals[0]);
+  DeleteBooleanSolid(&originals[1]);
+  delete [] original_positions[0];
+  delete [] original_positions[1];
+  delete [] positions[0];
+  delete [] positions[1];
+
+  // Check status
+  if (!status) {
+    result->Empty();
+    fprintf(stderr, "Unable to resolve degenerate configuration in boolean operation\n");
+    return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
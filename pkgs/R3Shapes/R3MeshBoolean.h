@@ -0,0 +1,137 @@
+// Include file for mesh boolean operation class
+
+
+
+// Operation constants
+
+#define R3_MESH_UNION_OPERATION         0
+#define R3_MESH_INTERSECTION_OPERATION  1
+#define R3_MESH_DIFFERENCE_OPERATION    2
+
+
+
+// Class definition
+
+class R3MeshBoolean {
+public:
+  // Constructors/destructors
+  R3MeshBoolean(R3Mesh *mesh1, R3Mesh *mesh2);
+  ~R3MeshBoolean(void);
+
+  // Property functions
+  R3Mesh *Mesh1(void) const;
+  R3Mesh *Mesh2(void) const;
+  int NThreads(void) const;
+  int MaxPerturbations(void) const;
+
+  // Parameter manipulation functions
+  void SetNThreads(int nthreads);
+  void SetMaxPerturbations(int max_perturbations);
+    // Number of times the meshes may be perturbed to escape degenerate configurations (default 8)
+
+  // Operation functions
+  int Compute(int operation, R3Mesh *result);
+    // Fills result with the boundary of the union, intersection, or difference (mesh1 minus mesh2)
+    // of the solids bounded by the two meshes, which should be closed, consistently oriented, and free
+    // of self-intersections (result is emptied first).  Faces are split along the intersection curves,
+    // which are shared by the faces of both meshes in the result, and faces are kept by the winding
+    // number of the other mesh at their pieces.  Pieces keep the material, segment, and category of
+    // their source faces.  Touching configurations are resolved by retrying with the vertices of mesh2
+    // offset along its normals and the vertices of both meshes jittered by 1E-9 of the bounding box size,
+    // growing 4 times on every retry.  Pieces on overlapping coplanar faces are classified explicitly:
+    // for union and intersection one copy is kept where the faces point the same way and none where
+    // they point opposite ways, and for difference the reverse.  Result vertices are placed at the
+    // unperturbed positions, coincident vertices are merged, and faces that become degenerate are
+    // removed.  Results that are non-manifold by nature (e.g., solids touching along an edge) are
+    // reported with a warning.  Returns 1 on success and 0 on error
+
+  // Statistics functions
+  int NIntersectionSegments(void) const;
+    // Number of segments in the intersection curves of the last operation
+  int NPerturbations(void) const;
+    // Number of times the meshes were perturbed in the last operation
+
+public:
+  // Internal data
+  R3Mesh *meshes[2];
+  int nthreads;
+  int max_perturbations;
+  int nintersection_segments;
+  int nperturbations;
+};
+
+
+
+// Inline functions
+
+inline R3Mesh *R3MeshBoolean::
+Mesh1(void) const
+{
+  // Return first operand
+  return meshes[0];
+}
+
+
+
+inline R3Mesh *R3MeshBoolean::
+Mesh2(void) const
+{
+  // Return second operand
+  return meshes[1];
+}
+
+
+
+inline int R3MeshBoolean::
+NThreads(void) const
+{
+  // Return number of threads (0 means RNNumberOfThreads())
+  return nthreads;
+}
+
+
+
+inline int R3MeshBoolean::
+MaxPerturbations(void) const
+{
+  // Return maximum number of perturbations
+  return max_perturbations;
+}
+
+
+
+inline void R3MeshBoolean::
+SetNThreads(int nthreads)
+{
+  // Set number of threads
+  this->nthreads = nthreads;
+}
+
+
+
+inline void R3MeshBoolean::
+SetMaxPerturbations(int max_perturbations)
+{
+  // Set maximum number of perturbations
+  this->max_perturbations = max_perturbations;
+}
+
+
+
+inline int R3MeshBoolean::
+NIntersectionSegments(void) const
+{
+  // Return number of intersection segments of last operation
+  return nintersection_segments;
+}
+
+
+
+inline int R3MeshBoolean::
+NPerturbations(void) const
+{
+  // Return number of perturbations of last operation
+  return nperturbations;
+}
+
+
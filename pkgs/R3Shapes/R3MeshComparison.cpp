@@ -0,0 +1,401 @@
+// Source file for mesh comparison class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Comparison parameters
+////////////////////////////////////////////////////////////////////////
+
+// Seed of the random numbers of surface samples
+static const unsigned long long sample_seed = 0x5DEECE66DULL;
+
+// Smallest barycentric coordinate of closest points inside faces (others take signs from vertex normals)
+static const RNScalar min_interior_barycentric = 1.0E-6;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Subdivision data
+////////////////////////////////////////////////////////////////////////
+
+struct R3MeshComparisonTriangle {
+  // Triangle of the bound-driven subdivision, with distances of its corners to the other mesh
+  R3Point points[3];
+  RNLength distances[3];
+  RNLength bound;
+};
+
+
+
+static RNLength
+TriangleBound(const R3MeshComparisonTriangle& triangle)
+{
+  // Return largest possible distance of a point in triangle (distances change at most by the distance moved)
+  RNLength bound = RN_INFINITY;
+  for (int i = 0; i < 3; i++) {
+    RNLength d1 = R3Distance(triangle.points[i], triangle.points[(i+1)%3]);
+    RNLength d2 = R3Distance(triangle.points[i], triangle.points[(i+2)%3]);
+    RNLength corner_bound = triangle.distances[i] + ((d1 > d2) ? d1 : d2);
+    if (corner_bound < bound) bound = corner_bound;
+  }
+  return bound;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3MeshComparison::
+R3MeshComparison(R3Mesh *mesh0, R3Mesh *mesh1)
+  : nsamples(100000),
+    hausdorff_tolerance(0),
+    max_refinement_queries(10000000),
+    nthreads(0)
+{
+  // Initialize meshes
+  meshes[0] = mesh0;
+  meshes[1] = mesh1;
+
+  // Initialize data
+  for (int k = 0; k < 2; k++) {
+    trees[k] = NULL;
+    vertex_distances[k] = NULL;
+    sample_distances[k] = NULL;
+  }
+
+  // Initialize statistics
+  Reset();
+}
+
+
+
+R3MeshComparison::
+~R3MeshComparison(void)
+{
+  // Delete data
+  for (int k = 0; k < 2; k++) {
+    if (trees[k]) delete trees[k];
+    if (vertex_distances[k]) delete [] vertex_distances[k];
+    if (sample_distances[k]) delete [] sample_distances[k];
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Comparison functions
+////////////////////////////////////////////////////////////////////////
+
+int R3MeshComparison::
+Compare(void)
+{
+  // Check meshes
+  for (int k = 0; k < 2; k++) {
+    if (meshes[k]->NFaces() == 0) {
+      fprintf(stderr, "Unable to compare mesh without faces\n");
+      return 0;
+    }
+  }
+
+  // Delete previous results
+  Reset();
+
+  // Build closest point hierarchies
+  for (int k = 0; k < 2; k++) {
+    if (!trees[k]) trees[k] = new R3MeshAttributeTransfer(meshes[k]);
+    trees[k]->SetNThreads(nthreads);
+  }
+
+  // Measure distances in both directions
+  for (int k = 0; k < 2; k++) {
+    MeasureVertices(k);
+    MeasureSamples(k);
+    RefineHausdorff(k);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+void R3MeshComparison::
+MeasureVertices(int k)
+{
+  // Gather vertex positions
+  R3Mesh *mesh = meshes[k];
+  int nvertices = mesh->NVertices();
+  R3Point *positions = new R3Point [ nvertices + 1 ];
+  for (int i = 0; i < nvertices; i++) positions[i] = mesh->VertexPosition(mesh->Vertex(i));
+
+  // Find closest points on other mesh
+  const R3MeshAttributeTransfer *tree = trees[1-k];
+  R3Mesh *other_mesh = meshes[1-k];
+  R3MeshTransferSample *samples = new R3MeshTransferSample [ nvertices + 1 ];
+  tree->FindCorrespondences(nvertices, positions, NULL, samples);
+
+  // Sign distances by the side of the closest face (or the interpolated vertex normal at its edges and corners)
+  vertex_distances[k] = new RNLength [ nvertices + 1 ];
+  for (int i = 0; i < nvertices; i++) {
+    const R3MeshTransferSample& sample = samples[i];
+    if (!sample.face) { vertex_distances[k][i] = RN_UNKNOWN; continue; }
+    const R3Point& b = sample.barycentrics;
+    RNBoolean interior = ((b[0] > min_interior_barycentric) && (b[1] > min_interior_barycentric) &&
+      (b[2] > min_interior_barycentric)) ? TRUE : FALSE;
+    R3Vector normal = (interior) ? other_mesh->FaceNormal(sample.face) : tree->SampleNormal(sample);
+    RNScalar side = normal.Dot(positions[i] - sample.position);
+    vertex_distances[k][i] = (side < 0) ? -sample.distance : sample.distance;
+
+    // Update largest distance
+    if (sample.distance > hausdorff[k]) {
+      hausdorff[k] = sample.distance;
+      hausdorff_points[k] = positions[i];
+    }
+  }
+
+  // Delete temporary memory
+  delete [] positions;
+  delete [] samples;
+}
+
+
+
+void R3MeshComparison::
+MeasureSamples(int k)
+{
+  // Sample points uniformly by area
+  if (nsamples <= 0) return;
+  R3Point *positions = new R3Point [ nsamples ];
+  SampleSurface(k, positions);
+
+  // Find closest points on other mesh
+  R3MeshTransferSample *samples = new R3MeshTransferSample [ nsamples ];
+  trees[1-k]->FindCorrespondences(nsamples, positions, NULL, samples);
+
+  // Compute statistics
+  sample_distances[k] = new RNLength [ nsamples ];
+  RNScalar sum = 0, sum_squared = 0;
+  for (int i = 0; i < nsamples; i++) {
+    RNLength distance = samples[i].distance;
+    sample_distances[k][i] = distance;
+    sum += distance;
+    sum_squared += distance * distance;
+    if (distance > hausdorff[k]) {
+      hausdorff[k] = distance;
+      hausdorff_points[k] = positions[i];
+    }
+  }
+  mean[k] = sum / nsamples;
+  rms[k] = sqrt(sum_squared / nsamples);
+
+  // Sort distances for percentiles
+  qsort(sample_distances[k], nsamples, sizeof(RNLength), RNCompareScalars);
+
+  // Delete temporary memory
+  delete [] positions;
+  delete [] samples;
+}
+
+
+
+void R3MeshComparison::
+RefineHausdorff(int k)
+{
+  // Make triangles for faces of mesh k (with distances of its vertices)
+  R3Mesh *mesh = meshes[k];
+  int ntriangles = mesh->NFaces();
+  R3MeshComparisonTriangle *triangles = new R3MeshComparisonTriangle [ ntriangles ];
+  for (int i = 0; i < ntriangles; i++) {
+    R3MeshFace *face = mesh->Face(i);
+    R3MeshComparisonTriangle& triangle = triangles[i];
+    for (int j = 0; j < 3; j++) {
+      R3MeshVertex *vertex = mesh->VertexOnFace(face, j);
+      triangle.points[j] = mesh->VertexPosition(vertex);
+      triangle.distances[j] = fabs(vertex_distances[k][mesh->VertexID(vertex)]);
+    }
+    triangle.bound = TriangleBound(triangle);
+  }
+
+  // Subdivide triangles whose bounds exceed the largest distance found (by more than the tolerance)
+  hausdorff_bound[k] = hausdorff[k];
+  while (ntriangles > 0) {
+    // Keep triangles that could contain points further than the tolerance beyond the largest distance
+    int nkept = 0;
+    RNBoolean refine = ((hausdorff_tolerance > 0) && (nrefinement_queries[k] + 3 * ntriangles <= max_refinement_queries)) ? TRUE : FALSE;
+    for (int i = 0; i < ntriangles; i++) {
+      const R3MeshComparisonTriangle& triangle = triangles[i];
+      if (!refine || (triangle.bound <= hausdorff[k] + hausdorff_tolerance)) {
+        if (triangle.bound > hausdorff_bound[k]) hausdorff_bound[k] = triangle.bound;
+      }
+      else {
+        triangles[nkept++] = triangle;
+      }
+    }
+    if (nkept == 0) break;
+
+    // Find distances of edge midpoints of kept triangles
+    R3Point *midpoints = new R3Point [ 3 * nkept ];
+    R3MeshTransferSample *samples = new R3MeshTransferSample [ 3 * nkept ];
+    for (int i = 0; i < nkept; i++) {
+      const R3MeshComparisonTriangle& triangle = triangles[i];
+      for (int j = 0; j < 3; j++) {
+        midpoints[3*i+j] = 0.5 * (triangle.points[j] + triangle.points[(j+1)%3].Vector());
+      }
+    }
+    trees[1-k]->FindCorrespondences(3 * nkept, midpoints, NULL, samples);
+    nrefinement_queries[k] += 3 * nkept;
+
+    // Update largest distance
+    for (int i = 0; i < 3 * nkept; i++) {
+      if (samples[i].distance > hausdorff[k]) {
+        hausdorff[k] = samples[i].distance;
+        hausdorff_points[k] = midpoints[i];
+      }
+    }
+
+    // Split kept triangles into four
+    R3MeshComparisonTriangle *children = new R3MeshComparisonTriangle [ 4 * nkept ];
+    for (int i = 0; i < nkept; i++) {
+      const R3MeshComparisonTriangle& triangle = triangles[i];
+      const R3Point *m = &midpoints[3*i];
+      RNLength md[3] = { samples[3*i+0].distance, samples[3*i+1].distance, samples[3*i+2].distance };
+      for (int j = 0; j < 3; j++) {
+        // Corner triangle (corner j, midpoint after it, midpoint before it)
+        R3MeshComparisonTriangle& corner = children[4*i+j];
+        corner.points[0] = triangle.points[j]; corner.distances[0] = triangle.distances[j];
+        corner.points[1] = m[j]; corner.distances[1] = md[j];
+        corner.points[2] = m[(j+2)%3]; corner.distances[2] = md[(j+2)%3];
+        corner.bound = TriangleBound(corner);
+      }
+      R3MeshComparisonTriangle& center = children[4*i+3];
+      for (int j = 0; j < 3; j++) { center.points[j] = m[j]; center.distances[j] = md[j]; }
+      center.bound = TriangleBound(center);
+    }
+
+    // Continue with children
+    delete [] midpoints;
+    delete [] samples;
+    delete [] triangles;
+    triangles = children;
+    ntriangles = 4 * nkept;
+  }
+
+  // Delete triangles
+  delete [] triangles;
+}
+
+
+
+void R3MeshComparison::
+SampleSurface(int k, R3Point *points) const
+{
+  // Accumulate face areas
+  R3Mesh *mesh = meshes[k];
+  int nfaces = mesh->NFaces();
+  RNArea *cumulative_areas = new RNArea [ nfaces ];
+  RNArea total_area = 0;
+  for (int i = 0; i < nfaces; i++) {
+    total_area += mesh->FaceArea(mesh->Face(i));
+    cumulative_areas[i] = total_area;
+  }
+
+  // Sample points (splitmix64 random numbers, so that the same points are sampled every time)
+  unsigned long long state = sample_seed + k;
+  for (int i = 0; i < nsamples; i++) {
+    RNScalar r[3];
+    for (int j = 0; j < 3; j++) {
+      state += 0x9E3779B97F4A7C15ULL;
+      unsigned long long z = state;
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      z = z ^ (z >> 31);
+      r[j] = (RNScalar) (z >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // Find face with probability proportional to its area
+    RNArea target = r[0] * total_area;
+    int low = 0, high = nfaces - 1;
+    while (low < high) {
+      int middle = (low + high) / 2;
+      if (cumulative_areas[middle] <= target) low = middle + 1;
+      else high = middle;
+    }
+
+    // Sample point uniformly in face
+    R3MeshFace *face = mesh->Face(low);
+    const R3Point& p0 = mesh->VertexPosition(mesh->VertexOnFace(face, 0));
+    const R3Point& p1 = mesh->VertexPosition(mesh->VertexOnFace(face, 1));
+    const R3Point& p2 = mesh->VertexPosition(mesh->VertexOnFace(face, 2));
+    RNScalar s = sqrt(r[1]);
+    points[i] = p0 + s * (1 - r[2]) * (p1 - p0) + s * r[2] * (p2 - p0);
+  }
+
+  // Delete areas
+  delete [] cumulative_areas;
+}
+
+
+
+void R3MeshComparison::
+Reset(void)
+{
+  // Delete distances
+  for (int k = 0; k < 2; k++) {
+    if (vertex_distances[k]) delete [] vertex_distances[k];
+    if (sample_distances[k]) delete [] sample_distances[k];
+    vertex_distances[k] = NULL;
+    sample_distances[k] = NULL;
+  }
+
+  // Reset statistics
+  for (int k = 0; k < 2; k++) {
+    hausdorff[k] = 0;
+    hausdorff_bound[k] = 0;
+    hausdorff_points[k] = R3zero_point;
+    mean[k] = 0;
+    rms[k] = 0;
+    nrefinement_queries[k] = 0;
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Statistics functions
+////////////////////////////////////////////////////////////////////////
+
+RNLength R3MeshComparison::
+Percentile(int k, RNScalar percentile) const
+{
+  // Return distance at percentile of sorted sample distances (100=max, 0=min)
+  if (!sample_distances[k]) return 0;
+  int index = (int) (nsamples * percentile / 100.0);
+  if (index >= nsamples) index = nsamples - 1;
+  if (index < 0) index = 0;
+  return sample_distances[k][index];
+}
+
+
+
+R3MeshProperty *R3MeshComparison::
+VertexDistanceProperty(int k, const char *name) const
+{
+  // Check distances
+  if (!vertex_distances[k]) {
+    fprintf(stderr, "Unable to make property before meshes are compared\n");
+    return NULL;
+  }
+
+  // Return new property with signed distances of vertices
+  return new R3MeshProperty(meshes[k], name, vertex_distances[k]);
+}
@@ -0,0 +1,247 @@
+// Include file for mesh comparison class
+
+
+
+// Class definition
+
+class R3MeshComparison {
+public:
+  // Constructors/destructors
+  R3MeshComparison(R3Mesh *mesh0, R3Mesh *mesh1);
+  ~R3MeshComparison(void);
+
+  // Property functions
+  R3Mesh *Mesh(int k) const;
+  int NSamples(void) const;
+  RNLength HausdorffTolerance(void) const;
+  int MaxRefinementQueries(void) const;
+  int NThreads(void) const;
+
+  // Parameter manipulation functions
+  void SetNSamples(int nsamples);
+    // Number of points sampled uniformly by area on each mesh (default 100000), the same
+    // points are sampled every time
+  void SetHausdorffTolerance(RNLength tolerance);
+    // Subdivides the faces that could still contain points further from the other mesh than the
+    // furthest point found, until the upper bound of the Hausdorff distance is within this distance
+    // of the lower bound (default 0 means only samples and vertices are measured)
+  void SetMaxRefinementQueries(int max_queries);
+    // Subdivision stops after this many closest point queries per direction (default 10000000)
+  void SetNThreads(int nthreads);
+
+  // Comparison functions
+  int Compare(void);
+    // Finds closest points on the other mesh for the vertices and samples of both meshes,
+    // returns 1 on success and 0 on error
+
+  // Statistics functions (direction k measures distances from mesh k to the other mesh)
+  RNLength Hausdorff(int k) const;
+    // Largest distance found from a point of mesh k (lower bound of the one-sided Hausdorff distance)
+  RNLength HausdorffBound(int k) const;
+    // Upper bound of the one-sided Hausdorff distance (from distances at face corners, which
+    // differ by at most the distance between the corners)
+  const R3Point& HausdorffPoint(int k) const;
+    // Point of mesh k with the largest distance found
+  RNLength SymmetricHausdorff(void) const;
+  RNLength Mean(int k) const;
+  RNLength RMS(int k) const;
+  RNLength Percentile(int k, RNScalar percentile) const;
+    // Statistics of the distances of the area-uniform samples (percentile from 0 to 100)
+  int NRefinementQueries(int k) const;
+    // Number of closest point queries of the bound-driven subdivision
+
+  // Vertex distance functions
+  RNLength VertexDistance(int k, int vertex_index) const;
+    // Signed distance from vertex of mesh k to the other mesh (negative behind its surface)
+  R3MeshProperty *VertexDistanceProperty(int k, const char *name = "Distance") const;
+    // Returns a new property with the signed distances of the vertices of mesh k (deleted by the caller)
+
+public:
+  // Internal functions
+  void SampleSurface(int k, R3Point *points) const;
+  void MeasureVertices(int k);
+  void MeasureSamples(int k);
+  void RefineHausdorff(int k);
+  void Reset(void);
+
+public:
+  // Meshes and closest point hierarchies over their faces
+  R3Mesh *meshes[2];
+  R3MeshAttributeTransfer *trees[2];
+
+  // Parameters
+  int nsamples;
+  RNLength hausdorff_tolerance;
+  int max_refinement_queries;
+  int nthreads;
+
+  // Distances of vertices (signed) and samples (sorted) of each mesh
+  RNLength *vertex_distances[2];
+  RNLength *sample_distances[2];
+
+  // Statistics
+  RNLength hausdorff[2];
+  RNLength hausdorff_bound[2];
+  R3Point hausdorff_points[2];
+  RNLength mean[2];
+  RNLength rms[2];
+  int nrefinement_queries[2];
+};
+
+
+
+// Inline functions
+
+inline R3Mesh *R3MeshComparison::
+Mesh(int k) const
+{
+  // Return kth mesh
+  return meshes[k];
+}
+
+
+
+inline int R3MeshComparison::
+NSamples(void) const
+{
+  // Return number of samples per mesh
+  return nsamples;
+}
+
+
+
+inline RNLength R3MeshComparison::
+HausdorffTolerance(void) const
+{
+  // Return tolerance of bound-driven Hausdorff distance
+  return hausdorff_tolerance;
+}
+
+
+
+inline int R3MeshComparison::
+MaxRefinementQueries(void) const
+{
+  // Return maximum number of queries of bound-driven subdivision
+  return max_refinement_queries;
+}
+
+
+
+inline int R3MeshComparison::
+NThreads(void) const
+{
+  // Return number of threads (0 means RNNumberOfThreads())
+  return nthreads;
+}
+
+
+
+inline void R3MeshComparison::
+SetNSamples(int nsamples)
+{
+  // Set number of samples per mesh
+  this->nsamples = nsamples;
+}
+
+
+
+inline void R3MeshComparison::
+SetHausdorffTolerance(RNLength tolerance)
+{
+  // Set tolerance of bound-driven Hausdorff distance
+  this->hausdorff_tolerance = tolerance;
+}
+
+
+
+inline void R3MeshComparison::
+SetMaxRefinementQueries(int max_queries)
+{
+  // Set maximum number of queries of bound-driven subdivision
+  this->max_refinement_queries = max_queries;
+}
+
+
+
+inline void R3MeshComparison::
+SetNThreads(int nthreads)
+{
+  // Set number of threads
+  this->nthreads = nthreads;
+}
+
+
+
+inline RNLength R3MeshComparison::
+Hausdorff(int k) const
+{
+  // Return one-sided Hausdorff distance from mesh k
+  return hausdorff[k];
+}
+
+
+
+inline RNLength R3MeshComparison::
+HausdorffBound(int k) const
+{
+  // Return upper bound of one-sided Hausdorff distance from mesh k
+  return hausdorff_bound[k];
+}
+
+
+
+inline const R3Point& R3MeshComparison::
+HausdorffPoint(int k) const
+{
+  // Return point of mesh k with largest distance
+  return hausdorff_points[k];
+}
+
+
+
+inline RNLength R3MeshComparison::
+SymmetricHausdorff(void) const
+{
+  // Return symmetric Hausdorff distance
+  return (hausdorff[0] > hausdorff[1]) ? hausdorff[0] : hausdorff[1];
+}
+
+
+
+inline RNLength R3MeshComparison::
+Mean(int k) const
+{
+  // Return mean distance from samples of mesh k
+  return mean[k];
+}
+
+
+
+inline RNLength R3MeshComparison::
+RMS(int k) const
+{
+  // Return root mean square distance from samples of mesh k
+  return rms[k];
+}
+
+
+
+inline int R3MeshComparison::
+NRefinementQueries(int k) const
+{
+  // Return number of queries of bound-driven subdivision
+  return nrefinement_queries[k];
+}
+
+
+
+inline RNLength R3MeshComparison::
+VertexDistance(int k, int vertex_index) const
+{
+  // Return signed distance from vertex of mesh k
+  return (vertex_distances[k]) ? vertex_distances[k][vertex_index] : RN_UNKNOWN;
+}
+
+
+
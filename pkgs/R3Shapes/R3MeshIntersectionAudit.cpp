@@ -0,0 +1,596 @@
+// Source file for mesh self-intersection audit class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Hierarchy parameters
+////////////////////////////////////////////////////////////////////////
+
+// Maximum number of faces in a leaf
+static const int max_faces_per_leaf = 4;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3MeshIntersectionAudit::
+R3MeshIntersectionAudit(R3Mesh *mesh)
+  : mesh(mesh),
+    nthreads(0),
+    nfaces(0),
+    faces(NULL),
+    face_boxes(NULL),
+    face_degenerate(NULL),
+    hierarchy(),
+    intersections(),
+    intersecting_faces()
+{
+}
+
+
+
+R3MeshIntersectionAudit::
+~R3MeshIntersectionAudit(void)
+{
+  // Delete results and hierarchy
+  EmptyIntersections();
+  DeleteHierarchy();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Hierarchy construction functions
+////////////////////////////////////////////////////////////////////////
+
+void R3MeshIntersectionAudit::
+BuildHierarchy(void)
+{
+  // Delete previous hierarchy
+  DeleteHierarchy();
+
+  // Check mesh
+  nfaces = (mesh) ? mesh->NFaces() : 0;
+  if (nfaces == 0) return;
+
+  // Compute face boxes and centroids
+  double *boxes = new double [ 6 * nfaces ];
+  R3Point *centroids = new R3Point [ nfaces ];
+  for (int i = 0; i < nfaces; i++) {
+    R3MeshFace *face = mesh->Face(i);
+    const R3Box& bbox = mesh->FaceBBox(face);
+    for (int dim = 0; dim < 3; dim++) {
+      boxes[6*i+dim] = bbox[RN_LO][dim];
+      boxes[6*i+3+dim] = bbox[RN_HI][dim];
+    }
+    centroids[i] = mesh->FaceCentroid(face);
+  }
+
+  // Build hierarchy
+  hierarchy.Build(boxes, centroids, nfaces, max_faces_per_leaf);
+  delete [] centroids;
+
+  // Copy faces and their boxes in hierarchy order, and flag faces that are degenerate (collinear vertices)
+  faces = new R3MeshFace * [ nfaces ];
+  face_boxes = new double [ 6 * nfaces ];
+  face_degenerate = new RNBoolean [ nfaces ];
+  for (int i = 0; i < nfaces; i++) {
+    int index = hierarchy.Face(i);
+    R3MeshFace *face = mesh->Face(index);
+    faces[i] = face;
+    for (int j = 0; j < 6; j++) face_boxes[6*i+j] = boxes[6*index+j];
+    const R3Point& p0 = mesh->VertexPosition(mesh->VertexOnFace(face, 0));
+    const R3Point& p1 = mesh->VertexPosition(mesh->VertexOnFace(face, 1));
+    const R3Point& p2 = mesh->VertexPosition(mesh->VertexOnFace(face, 2));
+    face_degenerate[i] = ((R3Orientation(p0, p1, p2, RN_X) == 0) &&
+      (R3Orientation(p0, p1, p2, RN_Y) == 0) && (R3Orientation(p0, p1, p2, RN_Z) == 0)) ? TRUE : FALSE;
+  }
+
+  // Delete temporary memory
+  delete [] boxes;
+}
+
+
+
+void R3MeshIntersectionAudit::
+DeleteHierarchy(void)
+{
+  // Delete face arrays
+  if (faces) delete [] faces;
+  if (face_boxes) delete [] face_boxes;
+  if (face_degenerate) delete [] face_degenerate;
+  faces = NULL;
+  face_boxes = NULL;
+  face_degenerate = NULL;
+  nfaces = 0;
+
+  // Delete hierarchy
+  hierarchy.Empty();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Narrow phase functions
+////////////////////////////////////////////////////////////////////////
+
+static RNBoolean
+IsInsideWedge(const R3Point& point, const R3Point& apex, const R3Point& p1, const R3Point& p2)
+{
+  // Check if point is in plane of triangle (apex, p1, p2)
+  if (R3Orientation(apex, p1, p2, point) != 0) return FALSE;
+
+  // Check if point is within closed wedge at apex spanned by p1 and p2
+  RNDimension dim = R3ProjectionDimension(apex, p1, p2);
+  int orientation = R3Orientation(apex, p1, p2, dim);
+  if (R3Orientation(apex, p1, point, dim) * orientation < 0) return FALSE;
+  if (R3Orientation(apex, point, p2, dim) * orientation < 0) return FALSE;
+  if (point == apex) return FALSE;
+  return TRUE;
+}
+
+
+
+static RNBoolean
+TrianglesOverlap(const R3Point *a, const R3Point *b, int nshared, const int *a_shared, const int *b_shared)
+{
+  // Check triangles with no shared vertices
+  if (nshared == 0) return R3TrianglesIntersect(a[0], a[1], a[2], b[0], b[1], b[2]);
+
+  // Check triangles with all vertices shared (duplicate faces)
+  if (nshared == 3) return TRUE;
+
+  // Check triangles with shared edge (they overlap only if coplanar and folded onto each other)
+  if (nshared == 2) {
+    int ia = 3 - a_shared[0] - a_shared[1];
+    int ib = 3 - b_shared[0] - b_shared[1];
+    const R3Point& u = a[a_shared[0]];
+    const R3Point& v = a[a_shared[1]];
+    if (R3Orientation(u, v, a[ia], b[ib]) != 0) return FALSE;
+    RNDimension dim = R3ProjectionDimension(u, v, a[ia]);
+    return (R3Orientation(u, v, a[ia], dim) * R3Orientation(u, v, b[ib], dim) > 0) ? TRUE : FALSE;
+  }
+
+  // Check triangles with shared vertex (they overlap beyond it if an opposite edge crosses
+  // the other triangle, or an edge at the shared vertex runs into the other triangle)
+  const R3Point& s = a[a_shared[0]];
+  const R3Point& a1 = a[(a_shared[0] + 1) % 3];
+  const R3Point& a2 = a[(a_shared[0] + 2) % 3];
+  const R3Point& b1 = b[(b_shared[0] + 1) % 3];
+  const R3Point& b2 = b[(b_shared[0] + 2) % 3];
+  if (R3SegmentIntersectsTriangle(a1, a2, b[0], b[1], b[2])) return TRUE;
+  if (R3SegmentIntersectsTriangle(b1, b2, a[0], a[1], a[2])) return TRUE;
+  if (IsInsideWedge(a1, s, b1, b2) || IsInsideWedge(a2, s, b1, b2)) return TRUE;
+  if (IsInsideWedge(b1, s, a1, a2) || IsInsideWedge(b2, s, a1, a2)) return TRUE;
+  return FALSE;
+}
+
+
+
+static int
+PlaneCrossings(const R3Point *a, const R3Point *b, R3Point *crossings)
+{
+  // Compute points where boundary of triangle a meets plane of triangle b
+  R3Vector normal = (b[1] - b[0]) % (b[2] - b[0]);
+  int sides[3];
+  RNScalar distances[3];
+  for (int i = 0; i < 3; i++) {
+    sides[i] = R3Orientation(b[0], b[1], b[2], a[i]);
+    distances[i] = normal.Dot(a[i] - b[0]);
+  }
+
+  // Collect vertices on plane and crossings of edges with vertices on opposite sides
+  int ncrossings = 0;
+  for (int i = 0; i < 3; i++) {
+    int j = (i + 1) % 3;
+    if (sides[i] == 0) {
+      crossings[ncrossings++] = a[i];
+    }
+    else if (sides[i] * sides[j] < 0) {
+      RNScalar denom = distances[i] - distances[j];
+      RNScalar t = (denom != 0) ? distances[i] / denom : 0.5;
+      if (t < 0) t = 0;
+      else if (t > 1) t = 1;
+      crossings[ncrossings++] = a[i] + t * (a[j] - a[i]);
+    }
+  }
+
+  // Return number of points
+  return ncrossings;
+}
+
+
+
+static void
+ComputeIntersectionSegment(const R3Point *a, const R3Point *b, R3Point& point1, R3Point& point2)
+{
+  // Compute extents of triangles along line of intersection of their planes
+  R3Point crossings[2][3];
+  int ncrossings[2];
+  ncrossings[0] = PlaneCrossings(a, b, crossings[0]);
+  ncrossings[1] = PlaneCrossings(b, a, crossings[1]);
+  R3Vector direction = ((a[1] - a[0]) % (a[2] - a[0])) % ((b[1] - b[0]) % (b[2] - b[0]));
+  RNScalar tmin[2], tmax[2];
+  R3Point pmin[2], pmax[2];
+  for (int k = 0; k < 2; k++) {
+    tmin[k] = RN_INFINITY;
+    tmax[k] = -RN_INFINITY;
+    for (int i = 0; i < ncrossings[k]; i++) {
+      RNScalar t = direction.Dot(crossings[k][i].Vector());
+      if (t < tmin[k]) { tmin[k] = t; pmin[k] = crossings[k][i]; }
+      if (t > tmax[k]) { tmax[k] = t; pmax[k] = crossings[k][i]; }
+    }
+  }
+
+  // Check for missing crossings (possible only with round-off)
+  if ((ncrossings[0] == 0) || (ncrossings[1] == 0)) {
+    point1 = (ncrossings[0] > 0) ? crossings[0][0] : ((ncrossings[1] > 0) ? crossings[1][0] : a[0]);
+    point2 = point1;
+    return;
+  }
+
+  // Segment is the overlap of the extents
+  point1 = (tmin[0] > tmin[1]) ? pmin[0] : pmin[1];
+  point2 = (tmax[0] < tmax[1]) ? pmax[0] : pmax[1];
+  if (direction.Dot(point1.Vector()) > direction.Dot(point2.Vector())) point2 = point1;
+}
+
+
+
+static void
+ComputeOverlapExtent(const R3Point *a, const R3Point *b, R3Point& point1, R3Point& point2)
+{
+  // Collect vertices inside the other triangle and crossings of edges
+  R3Point points[15];
+  int npoints = 0;
+  RNDimension dim = R3ProjectionDimension(a[0], a[1], a[2]);
+  for (int i = 0; i < 3; i++) {
+    if (R3PointInTriangle(a[i], b[0], b[1], b[2], dim)) points[npoints++] = a[i];
+    if (R3PointInTriangle(b[i], a[0], a[1], a[2], dim)) points[npoints++] = b[i];
+  }
+  RNDimension dim1 = (dim + 1) % 3;
+  RNDimension dim2 = (dim + 2) % 3;
+  for (int i = 0; i < 3; i++) {
+    const R3Point& p0 = a[i];
+    const R3Point& p1 = a[(i+1)%3];
+    for (int j = 0; j < 3; j++) {
+      const R3Point& q0 = b[j];
+      const R3Point& q1 = b[(j+1)%3];
+      if (R3Orientation(p0, p1, q0, dim) * R3Orientation(p0, p1, q1, dim) >= 0) continue;
+      if (R3Orientation(q0, q1, p0, dim) * R3Orientation(q0, q1, p1, dim) >= 0) continue;
+      RNScalar d0 = (q1[dim1] - q0[dim1]) * (p0[dim2] - q0[dim2]) - (q1[dim2] - q0[dim2]) * (p0[dim1] - q0[dim1]);
+      RNScalar d1 = (q1[dim1] - q0[dim1]) * (p1[dim2] - q0[dim2]) - (q1[dim2] - q0[dim2]) * (p1[dim1] - q0[dim1]);
+      RNScalar t = (d0 != d1) ? d0 / (d0 - d1) : 0.5;
+      points[npoints++] = p0 + t * (p1 - p0);
+    }
+  }
+
+  // Return extreme points along longest axis of their bounding box
+  if (npoints == 0) { point1 = a[0]; point2 = a[0]; return; }
+  R3Box bbox = R3null_box;
+  for (int i = 0; i < npoints; i++) bbox.Union(points[i]);
+  int axis = bbox.LongestAxis();
+  point1 = points[0];
+  point2 = points[0];
+  for (int i = 1; i < npoints; i++) {
+    if (points[i][axis] < point1[axis]) point1 = points[i];
+    if (points[i][axis] > point2[axis]) point2 = points[i];
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Audit functions
+////////////////////////////////////////////////////////////////////////
+
+void R3MeshIntersectionAudit::
+FindFaceIntersections(int index, RNArray<R3MeshFaceIntersection *>& result) const
+{
+  // Get face
+  if (face_degenerate[index]) return;
+  R3MeshFace *face = faces[index];
+  const double *box = &face_boxes[6*index];
+  R3MeshVertex *vertices[3];
+  R3Point a[3];
+  for (int k = 0; k < 3; k++) {
+    vertices[k] = mesh->VertexOnFace(face, k);
+    a[k] = mesh->VertexPosition(vertices[k]);
+  }
+
+  // Traverse hierarchy, visiting only faces after this one in hierarchy order (each pair is tested once)
+  int stack[R3FaceHierarchy::max_stack_size];
+  int nstack = 0;
+  stack[nstack++] = 0;
+  while (nstack > 0) {
+    // Pop node and check its range and box
+    int node = stack[--nstack];
+    if (hierarchy.NodeFirstFace(node) + hierarchy.NodeNFaces(node) <= index + 1) continue;
+    if (!R3FaceHierarchy::BoxesOverlap(hierarchy.NodeBox(node), box)) continue;
+
+    // Check if interior node
+    if (hierarchy.NodeChild(node, 0) >= 0) {
+      assert(nstack + 2 <= R3FaceHierarchy::max_stack_size);
+      stack[nstack++] = hierarchy.NodeChild(node, 1);
+      stack[nstack++] = hierarchy.NodeChild(node, 0);
+      continue;
+    }
+
+    // Test faces in leaf
+    int first = hierarchy.NodeFirstFace(node);
+    int last = first + hierarchy.NodeNFaces(node);
+    if (first <= index) first = index + 1;
+    for (int j = first; j < last; j++) {
+      // Check boxes
+      if (face_degenerate[j]) continue;
+      if (!R3FaceHierarchy::BoxesOverlap(&face_boxes[6*j], box)) continue;
+
+      // Get other face and its shared vertices
+      R3MeshFace *other_face = faces[j];
+      R3Point b[3];
+      int a_shared[3], b_shared[3], nshared = 0;
+      for (int k = 0; k < 3; k++) {
+        R3MeshVertex *vertex = mesh->VertexOnFace(other_face, k);
+        b[k] = mesh->VertexPosition(vertex);
+        for (int m = 0; m < 3; m++) {
+          if (vertex != vertices[m]) continue;
+          a_shared[nshared] = m;
+          b_shared[nshared] = k;
+          nshared++;
+        }
+      }
+
+      // Sort shared vertices in order of this face (so shared vertex pairs are consistent)
+      if ((nshared == 2) && (a_shared[0] > a_shared[1])) {
+        int swap = a_shared[0]; a_shared[0] = a_shared[1]; a_shared[1] = swap;
+        swap = b_shared[0]; b_shared[0] = b_shared[1]; b_shared[1] = swap;
+      }
+
+      // Test triangles
+      if (!TrianglesOverlap(a, b, nshared, a_shared, b_shared)) continue;
+
+      // Create intersection
+      R3MeshFaceIntersection *intersection = new R3MeshFaceIntersection();
+      RNBoolean swap = (mesh->FaceID(face) > mesh->FaceID(other_face)) ? TRUE : FALSE;
+      intersection->face1 = (swap) ? other_face : face;
+      intersection->face2 = (swap) ? face : other_face;
+      intersection->coplanar = (nshared == 3) ||
+        ((R3Orientation(a[0], a[1], a[2], b[0]) == 0) &&
+         (R3Orientation(a[0], a[1], a[2], b[1]) == 0) &&
+         (R3Orientation(a[0], a[1], a[2], b[2]) == 0));
+      if (intersection->coplanar) ComputeOverlapExtent(a, b, intersection->point1, intersection->point2);
+      else ComputeIntersectionSegment(a, b, intersection->point1, intersection->point2);
+      result.Insert(intersection);
+    }
+  }
+}
+
+
+
+struct R3MeshIntersectionQueryData {
+  const R3MeshIntersectionAudit *audit;
+  RNArray<R3MeshFaceIntersection *> *results;
+};
+
+
+
+static void
+FindAuditIntersections(int index, int thread_index, void *data)
+{
+  // Find intersections of one face (hierarchy is read-only, so queries can run concurrently)
+  R3MeshIntersectionQueryData *query_data = (R3MeshIntersectionQueryData *) data;
+  query_data->audit->FindFaceIntersections(index, query_data->results[thread_index]);
+}
+
+
+
+static R3Mesh *sort_mesh = NULL;
+
+static int
+CompareIntersections(const void *data1, const void *data2)
+{
+  // Compare face IDs
+  R3MeshFaceIntersection *intersection1 = *((R3MeshFaceIntersection **) data1);
+  R3MeshFaceIntersection *intersection2 = *((R3MeshFaceIntersection **) data2);
+  int id1 = sort_mesh->FaceID(intersection1->face1);
+  int id2 = sort_mesh->FaceID(intersection2->face1);
+  if (id1 != id2) return id1 - id2;
+  id1 = sort_mesh->FaceID(intersection1->face2);
+  id2 = sort_mesh->FaceID(intersection2->face2);
+  return id1 - id2;
+}
+
+
+
+static int
+CompareFaces(const void *data1, const void *data2)
+{
+  // Compare face IDs
+  R3MeshFace *face1 = *((R3MeshFace **) data1);
+  R3MeshFace *face2 = *((R3MeshFace **) data2);
+  return sort_mesh->FaceID(face1) - sort_mesh->FaceID(face2);
+}
+
+
+
+void R3MeshIntersectionAudit::
+EmptyIntersections(void)
+{
+  // Delete intersections
+  for (int i = 0; i < intersections.NEntries(); i++) delete intersections[i];
+  intersections.Empty();
+  intersecting_faces.Empty();
+}
+
+
+
+int R3MeshIntersectionAudit::
+FindIntersections(void)
+{
+  // Empty previous results
+  EmptyIntersections();
+
+  // Check mesh
+  if (!mesh) {
+    fprintf(stderr, "No mesh for intersection audit\n");
+    return -1;
+  }
+
+  // Build hierarchy over current faces
+  BuildHierarchy();
+  if (nfaces == 0) return 0;
+
+  // Find intersections in parallel, with one result list per thread
+  int nresults = (nthreads > 0) ? nthreads : RNNumberOfThreads();
+  if (nresults < 1) nresults = 1;
+  R3MeshIntersectionQueryData data;
+  data.audit = this;
+  data.results = new RNArray<R3MeshFaceIntersection *> [ nresults ];
+  RNParallelFor(nfaces, FindAuditIntersections, &data, nresults, 64);
+
+  // Merge results
+  for (int t = 0; t < nresults; t++) {
+    for (int i = 0; i < data.results[t].NEntries(); i++) {
+      intersections.Insert(data.results[t].Kth(i));
+    }
+  }
+  delete [] data.results;
+
+  // Sort intersections by face IDs
+  sort_mesh = mesh;
+  intersections.Sort(CompareIntersections);
+
+  // Collect intersecting faces
+  R3mesh_mark++;
+  for (int i = 0; i < intersections.NEntries(); i++) {
+    R3MeshFaceIntersection *intersection = intersections.Kth(i);
+    for (int k = 0; k < 2; k++) {
+      R3MeshFace *face = (k == 0) ? intersection->face1 : intersection->face2;
+      if (mesh->FaceMark(face) == R3mesh_mark) continue;
+      mesh->SetFaceMark(face, R3mesh_mark);
+      intersecting_faces.Insert(face);
+    }
+  }
+  intersecting_faces.Sort(CompareFaces);
+
+  // Hierarchy is not valid after the mesh changes
+  DeleteHierarchy();
+
+  // Return number of intersecting pairs
+  return intersections.NEntries();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Repair functions
+////////////////////////////////////////////////////////////////////////
+
+int R3MeshIntersectionAudit::
+RemoveIntersections(int max_iterations)
+{
+  // Find intersections
+  int count = FindIntersections();
+  if (count <= 0) return count;
+
+  // Iteratively remove intersecting faces and fill the holes
+  for (int iteration = 0; iteration < max_iterations; iteration++) {
+    // Mark intersecting faces and rings of neighbors (more rings on later iterations)
+    RNArray<R3MeshFace *> region;
+    RNMark region_mark = ++R3mesh_mark;
+    for (int i = 0; i < intersecting_faces.NEntries(); i++) {
+      R3MeshFace *face = intersecting_faces.Kth(i);
+      mesh->SetFaceMark(face, region_mark);
+      region.Insert(face);
+    }
+    int ring_start = 0;
+    for (int ring = 0; ring < iteration; ring++) {
+      int ring_end = region.NEntries();
+      for (int i = ring_start; i < ring_end; i++) {
+        R3MeshFace *face = region.Kth(i);
+        for (int k = 0; k < 3; k++) {
+          R3MeshVertex *vertex = mesh->VertexOnFace(face, k);
+          for (int j = 0; j < mesh->VertexValence(vertex); j++) {
+            R3MeshEdge *edge = mesh->EdgeOnVertex(vertex, j);
+            for (int m = 0; m < 2; m++) {
+              R3MeshFace *neighbor = mesh->FaceOnEdge(edge, m);
+              if (!neighbor || (mesh->FaceMark(neighbor) == region_mark)) continue;
+              mesh->SetFaceMark(neighbor, region_mark);
+              region.Insert(neighbor);
+            }
+          }
+        }
+      }
+      ring_start = ring_end;
+    }
+
+    // Remember edges that will bound holes (edges of region that were not on the mesh boundary)
+    RNArray<R3MeshEdge *> hole_edges;
+    for (int i = 0; i < region.NEntries(); i++) {
+      R3MeshFace *face = region.Kth(i);
+      for (int k = 0; k < 3; k++) {
+        R3MeshEdge *edge = mesh->EdgeOnFace(face, k);
+        R3MeshFace *neighbor = mesh->FaceAcrossEdge(edge, face);
+        if (!neighbor || (mesh->FaceMark(neighbor) == region_mark)) continue;
+        hole_edges.Insert(edge);
+      }
+    }
+
+    // Delete faces in region
+    for (int i = 0; i < region.NEntries(); i++) {
+      mesh->DeleteFace(region.Kth(i));
+    }
+
+    // Fill holes (filling one hole fills it for all of its edges)
+    int nkept_faces = mesh->NFaces();
+    for (int i = 0; i < hole_edges.NEntries(); i++) {
+      mesh->FillHole(hole_edges.Kth(i));
+    }
+
+    // Copy face attributes into new faces from neighbors
+    RNMark copied_mark = ++R3mesh_mark;
+    RNBoolean done = FALSE;
+    while (!done) {
+      done = TRUE;
+      for (int i = nkept_faces; i < mesh->NFaces(); i++) {
+        R3MeshFace *face = mesh->Face(i);
+        if (mesh->FaceMark(face) == copied_mark) continue;
+        for (int k = 0; k < 3; k++) {
+          R3MeshFace *neighbor = mesh->FaceAcrossEdge(mesh->EdgeOnFace(face, k), face);
+          if (!neighbor) continue;
+          if ((mesh->FaceID(neighbor) >= nkept_faces) && (mesh->FaceMark(neighbor) != copied_mark)) continue;
+          mesh->SetFaceMaterial(face, mesh->FaceMaterial(neighbor));
+          mesh->SetFaceSegment(face, mesh->FaceSegment(neighbor));
+          mesh->SetFaceCategory(face, mesh->FaceCategory(neighbor));
+          mesh->SetFaceMark(face, copied_mark);
+          done = FALSE;
+          break;
+        }
+      }
+    }
+
+    // Delete edges and vertices left inside holes
+    mesh->DeleteUnusedEdges();
+    mesh->DeleteUnusedVertices();
+
+    // Audit again
+    count = FindIntersections();
+    if (count <= 0) break;
+  }
+
+  // Return number of remaining intersecting pairs
+  return count;
+}
+
+
+
@@ -0,0 +1,145 @@
+// Include file for mesh self-intersection audit class
+
+
+
+// Intersection definition
+
+struct R3MeshFaceIntersection {
+  R3MeshFace *face1;
+  R3MeshFace *face2;
+  R3Point point1;
+  R3Point point2;
+  RNBoolean coplanar;
+};
+
+
+
+// Class definition
+
+class R3MeshIntersectionAudit {
+public:
+  // Constructors/destructors
+  R3MeshIntersectionAudit(R3Mesh *mesh);
+  ~R3MeshIntersectionAudit(void);
+
+  // Property functions
+  R3Mesh *Mesh(void) const;
+  int NThreads(void) const;
+
+  // Parameter manipulation functions
+  void SetNThreads(int nthreads);
+
+  // Audit functions
+  int FindIntersections(void);
+    // Finds all pairs of faces that share points other than their common vertices and edges
+    // (decided with exact predicates), returns number of pairs or -1 if there was an error.
+    // Vertices are compared by identity, so coincident vertices that have not been merged
+    // (see R3Mesh::MergeCoincidentVertices) make their faces count as touching
+  int NIntersections(void) const;
+  const R3MeshFaceIntersection& Intersection(int k) const;
+    // Pairs are sorted by face IDs (face1 has the lower ID), points are the ends of the
+    // intersection segment, or of the widest extent of the overlap for coplanar pairs
+  int NIntersectingFaces(void) const;
+  R3MeshFace *IntersectingFace(int k) const;
+    // Faces in any pair, sorted by ID (valid until the mesh is modified)
+
+  // Repair functions
+  int RemoveIntersections(int max_iterations = 4);
+    // Deletes intersecting faces and refills the holes, deleting growing rings of neighboring
+    // faces on later iterations, returns number of remaining pairs (refilled faces inherit
+    // material, segment, and category from neighbors, and vertex IDs change)
+
+public:
+  // Internal functions
+  void BuildHierarchy(void);
+  void DeleteHierarchy(void);
+  void EmptyIntersections(void);
+  void FindFaceIntersections(int index, RNArray<R3MeshFaceIntersection *>& result) const;
+
+public:
+  // Mesh
+  R3Mesh *mesh;
+
+  // Parameters
+  int nthreads;
+
+  // Faces in hierarchy order
+  int nfaces;
+  R3MeshFace **faces;
+  double *face_boxes;
+  RNBoolean *face_degenerate;
+
+  // Bounding hierarchy (every node covers a run of faces)
+  R3FaceHierarchy hierarchy;
+
+  // Results
+  RNArray<R3MeshFaceIntersection *> intersections;
+  RNArray<R3MeshFace *> intersecting_faces;
+};
+
+
+
+// Inline functions
+
+inline R3Mesh *R3MeshIntersectionAudit::
+Mesh(void) const
+{
+  // Return mesh
+  return mesh;
+}
+
+
+
+inline int R3MeshIntersectionAudit::
+NThreads(void) const
+{
+  // Return number of threads (0 means RNNumberOfThreads())
+  return nthreads;
+}
+
+
+
+inline void R3MeshIntersectionAudit::
+SetNThreads(int nthreads)
+{
+  // Set number of threads
+  this->nthreads = nthreads;
+}
+
+
+
+inline int R3MeshIntersectionAudit::
+NIntersections(void) const
+{
+  // Return number of intersecting face pairs
+  return intersections.NEntries();
+}
+
+
+
+inline const R3MeshFaceIntersection& R3MeshIntersectionAudit::
+Intersection(int k) const
+{
+  // Return kth intersecting face pair
+  return *(intersections.Kth(k));
+}
+
+
+
+inline int R3MeshIntersectionAudit::
+NIntersectingFaces(void) const
+{
+  // Return number of faces in any intersecting pair
+  return intersecting_faces.NEntries();
+}
+
+
+
+inline R3MeshFace *R3MeshIntersectionAudit::
+IntersectingFace(int k) const
+{
+  // Return kth face in any intersecting pair
+  return intersecting_faces.Kth(k);
+}
+
+
@@ -0,0 +1,545 @@
+// Source file for the mesh property smoother class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constant definitions
+////////////////////////////////////////////////////////////////////////
+
+static const int max_heat_iterations = 1000;
+static const RNScalar heat_tolerance = 1.0E-8;
+static const int heat_chunk_size = 4096;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3MeshPropertySmoother::
+R3MeshPropertySmoother(R3Mesh *mesh, int method)
+  : mesh(mesh),
+    method(method),
+    nthreads(0),
+    nsubsteps(1),
+    nvertices(0),
+    neighbor_offsets(NULL),
+    neighbor_indices(NULL),
+    neighbor_weights(NULL),
+    diagonal_weights(NULL),
+    masses(NULL)
+{
+  // Build the data structures needed by the method (once for all properties and scales)
+  if (method == R3_MESH_PROPERTY_HEAT_SMOOTHING) UpdateLaplacian();
+  else UpdateAdjacency();
+}
+
+
+
+R3MeshPropertySmoother::
+~R3MeshPropertySmoother(void)
+{
+  // Delete adjacency and laplacian
+  if (neighbor_offsets) delete [] neighbor_offsets;
+  if (neighbor_indices) delete [] neighbor_indices;
+  if (neighbor_weights) delete [] neighbor_weights;
+  if (diagonal_weights) delete [] diagonal_weights;
+  if (masses) delete [] masses;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Smoothing functions
+////////////////////////////////////////////////////////////////////////
+
+int R3MeshPropertySmoother::
+Smooth(const RNArray<R3MeshProperty *>& properties, const RNScalar *sigmas, int nsigmas, R3MeshProperty **results) const
+{
+  // Check arguments
+  if (properties.IsEmpty()) return 1;
+  if (nsigmas <= 0) return 1;
+  for (int j = 1; j < nsigmas; j++) {
+    if (sigmas[j] < sigmas[j-1]) {
+      fprintf(stderr, "Smoothing scales must be increasing\n");
+      return 0;
+    }
+  }
+
+  // Allocate result values
+  int nresults = properties.NEntries() * nsigmas;
+  RNScalar **values = new RNScalar * [ nresults ];
+  for (int i = 0; i < nresults; i++) {
+    values[i] = new RNScalar [ nvertices ];
+    for (int k = 0; k < nvertices; k++) values[i][k] = 0;
+  }
+
+  // Compute result values
+  int status = 0;
+  if (method == R3_MESH_PROPERTY_HEAT_SMOOTHING) status = SmoothWithHeat(properties, sigmas, nsigmas, values);
+  else status = SmoothWithDijkstra(properties, sigmas, nsigmas, values);
+
+  // Copy result values into properties
+  if (status) {
+    for (int i = 0; i < nresults; i++) {
+      R3MeshProperty *result = results[i];
+      for (int k = 0; k < nvertices; k++) result->values[k] = values[i][k];
+      result->ResetStatistics();
+    }
+  }
+
+  // Delete result values
+  for (int i = 0; i < nresults; i++) delete [] values[i];
+  delete [] values;
+
+  // Return status
+  return status;
+}
+
+
+
+int R3MeshPropertySmoother::
+Smooth(R3MeshProperty *property, RNScalar sigma) const
+{
+  // Check sigma
+  if (sigma <= 0) return 1;
+
+  // Smooth property in place
+  RNArray<R3MeshProperty *> properties;
+  properties.Insert(property);
+  return Smooth(properties, &sigma, 1, &property);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Dijkstra smoothing functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3MeshPropertySmootherDijkstraEntry {
+  int vertex_index;
+  R3MeshPropertySmootherDijkstraEntry **heappointer;
+  RNScalar distance;
+};
+
+struct R3MeshPropertySmootherDijkstraScratch {
+  R3MeshPropertySmootherDijkstraEntry *entries;
+  int *visited;
+  RNScalar *value_sums;
+  RNScalar *weight_sums;
+};
+
+struct R3MeshPropertySmootherDijkstraData {
+  const R3MeshPropertySmoother *smoother;
+  const RNArray<R3MeshProperty *> *properties;
+  const RNScalar *sigmas;
+  int nsigmas;
+  RNScalar **results;
+  R3MeshPropertySmootherDijkstraScratch *scratch;
+};
+
+
+
+static void
+SmoothVertexWithDijkstra(int source_index, int thread_index, void *data)
+{
+  // Get convenient variables
+  R3MeshPropertySmootherDijkstraData *loop = (R3MeshPropertySmootherDijkstraData *) data;
+  const R3MeshPropertySmoother *smoother = loop->smoother;
+  const RNArray<R3MeshProperty *>& properties = *(loop->properties);
+  const RNScalar *sigmas = loop->sigmas;
+  int nsigmas = loop->nsigmas;
+  int nproperties = properties.NEntries();
+  RNScalar max_distance = 3 * sigmas[nsigmas-1];
+  R3MeshPropertySmootherDijkstraScratch& scratch = loop->scratch[thread_index];
+  R3MeshPropertySmootherDijkstraEntry *entries = scratch.entries;
+
+  // Initialize priority queue (entries with negative distance have not been visited)
+  R3MeshPropertySmootherDijkstraEntry tmp;
+  RNHeap<R3MeshPropertySmootherDijkstraEntry *> heap(&tmp, &(tmp.distance), &(tmp.heappointer));
+  R3MeshPropertySmootherDijkstraEntry *source = &entries[source_index];
+  source->distance = 0;
+  source->heappointer = NULL;
+  heap.Push(source);
+  int nvisited = 0;
+  scratch.visited[nvisited++] = source_index;
+
+  // Initialize sums
+  for (int i = 0; i < nproperties * nsigmas; i++) {
+    scratch.value_sums[i] = 0;
+    scratch.weight_sums[i] = 0;
+  }
+
+  // Visit vertices within 3 sigma in order of increasing distance
+  while (!heap.IsEmpty()) {
+    R3MeshPropertySmootherDijkstraEntry *entry = heap.Pop();
+    entry->heappointer = NULL;
+    RNScalar distance = entry->distance;
+    int vertex_index = entry->vertex_index;
+
+    // Accumulate weighted values for every property and scale (largest scales first)
+    for (int j = nsigmas-1; j >= 0; j--) {
+      RNScalar sigma = sigmas[j];
+      if (distance > 3 * sigma) break;
+      RNScalar weight = exp(distance * distance / (-2 * sigma * sigma));
+      for (int i = 0; i < nproperties; i++) {
+        RNScalar value = properties[i]->VertexValue(vertex_index);
+        if (value == RN_UNKNOWN) continue;
+        scratch.value_sums[i*nsigmas + j] += weight * value;
+        scratch.weight_sums[i*nsigmas + j] += weight;
+      }
+    }
+
+    // Relax edges to neighbors
+    for (int k = smoother->neighbor_offsets[vertex_index]; k < smoother->neighbor_offsets[vertex_index+1]; k++) {
+      R3MeshPropertySmootherDijkstraEntry *neighbor = &entries[ smoother->neighbor_indices[k] ];
+      RNScalar new_distance = distance + smoother->neighbor_weights[k];
+      if (new_distance > max_distance) continue;
+      if (neighbor->distance < 0) {
+        neighbor->distance = new_distance;
+        neighbor->heappointer = NULL;
+        heap.Push(neighbor);
+        scratch.visited[nvisited++] = neighbor->vertex_index;
+      }
+      else if ((new_distance < neighbor->distance) && (neighbor->heappointer)) {
+        neighbor->distance = new_distance;
+        heap.Update(neighbor);
+      }
+    }
+  }
+
+  // Reset visited entries for next source vertex
+  for (int i = 0; i < nvisited; i++) entries[scratch.visited[i]].distance = -1;
+
+  // Assign blurred values (normalized by total weight)
+  for (int i = 0; i < nproperties * nsigmas; i++) {
+    if (scratch.weight_sums[i] > 0) {
+      loop->results[i][source_index] = scratch.value_sums[i] / scratch.weight_sums[i];
+    }
+  }
+}
+
+
+
+int R3MeshPropertySmoother::
+SmoothWithDijkstra(const RNArray<R3MeshProperty *>& properties, const RNScalar *sigmas, int nsigmas, RNScalar **results) const
+{
+  // Check adjacency
+  if (!neighbor_offsets) return 0;
+
+  // Allocate scratch buffers (reused for every source vertex processed by a thread)
+  int nproperties = properties.NEntries();
+  int nthreads = (this->nthreads > 0) ? this->nthreads : RNNumberOfThreads();
+  R3MeshPropertySmootherDijkstraScratch *scratch = new R3MeshPropertySmootherDijkstraScratch [ nthreads ];
+  for (int t = 0; t < nthreads; t++) {
+    scratch[t].entries = new R3MeshPropertySmootherDijkstraEntry [ nvertices ];
+    scratch[t].visited = new int [ nvertices ];
+    scratch[t].value_sums = new RNScalar [ nproperties * nsigmas ];
+    scratch[t].weight_sums = new RNScalar [ nproperties * nsigmas ];
+    for (int k = 0; k < nvertices; k++) {
+      scratch[t].entries[k].vertex_index = k;
+      scratch[t].entries[k].heappointer = NULL;
+      scratch[t].entries[k].distance = -1;
+    }
+  }
+
+  // Smooth values at all vertices in parallel
+  R3MeshPropertySmootherDijkstraData data;
+  data.smoother = this;
+  data.properties = &properties;
+  data.sigmas = sigmas;
+  data.nsigmas = nsigmas;
+  data.results = results;
+  data.scratch = scratch;
+  RNParallelFor(nvertices, SmoothVertexWithDijkstra, &data, nthreads, 64);
+
+  // Delete scratch buffers
+  for (int t = 0; t < nthreads; t++) {
+    delete [] scratch[t].entries;
+    delete [] scratch[t].visited;
+    delete [] scratch[t].value_sums;
+    delete [] scratch[t].weight_sums;
+  }
+  delete [] scratch;
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Heat diffusion smoothing functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3MeshPropertySmootherHeatData {
+  const R3MeshPropertySmoother *smoother;
+  RNScalar *y;
+  const RNScalar *x;
+  RNScalar dt;
+};
+
+
+
+static void
+MultiplyHeatChunk(int chunk_index, int, void *data)
+{
+  // Compute y = (M + dt * L) x for one chunk of rows
+  R3MeshPropertySmootherHeatData *loop = (R3MeshPropertySmootherHeatData *) data;
+  const R3MeshPropertySmoother *smoother = loop->smoother;
+  int start = chunk_index * heat_chunk_size;
+  int end = start + heat_chunk_size;
+  if (end > smoother->nvertices) end = smoother->nvertices;
+  for (int i = start; i < end; i++) {
+    RNScalar sum = smoother->diagonal_weights[i] * loop->x[i];
+    for (int k = smoother->neighbor_offsets[i]; k < smoother->neighbor_offsets[i+1]; k++) {
+      sum -= smoother->neighbor_weights[k] * loop->x[ smoother->neighbor_indices[k] ];
+    }
+    loop->y[i] = smoother->masses[i] * loop->x[i] + loop->dt * sum;
+  }
+}
+
+
+
+void R3MeshPropertySmoother::
+MultiplyHeat(RNScalar *y, const RNScalar *x, RNScalar dt) const
+{
+  // Multiply x by the implicit heat operator (M + dt * L) in parallel over rows
+  R3MeshPropertySmootherHeatData data;
+  data.smoother = this;
+  data.y = y;
+  data.x = x;
+  data.dt = dt;
+  int nchunks = (nvertices + heat_chunk_size - 1) / heat_chunk_size;
+  RNParallelFor(nchunks, MultiplyHeatChunk, &data, nthreads);
+}
+
+
+
+int R3MeshPropertySmoother::
+SolveHeat(RNScalar *x, const RNScalar *b, RNScalar dt) const
+{
+  // Solve (M + dt * L) x = b with Jacobi-preconditioned conjugate gradients (x holds initial guess)
+  RNScalar *r = new RNScalar [ nvertices ];
+  RNScalar *z = new RNScalar [ nvertices ];
+  RNScalar *p = new RNScalar [ nvertices ];
+  RNScalar *q = new RNScalar [ nvertices ];
+
+  // Initialize residual and search direction
+  RNScalar bnorm = 0;
+  RNScalar rz = 0;
+  MultiplyHeat(q, x, dt);
+  for (int i = 0; i < nvertices; i++) {
+    RNScalar diagonal = masses[i] + dt * diagonal_weights[i];
+    r[i] = b[i] - q[i];
+    z[i] = (diagonal > 0) ? r[i] / diagonal : r[i];
+    p[i] = z[i];
+    rz += r[i] * z[i];
+    bnorm += b[i] * b[i];
+  }
+
+  // Iterate until residual is small
+  RNScalar tolerance = heat_tolerance * heat_tolerance * bnorm;
+  for (int iteration = 0; iteration < max_heat_iterations; iteration++) {
+    // Check residual
+    RNScalar rnorm = 0;
+    for (int i = 0; i < nvertices; i++) rnorm += r[i] * r[i];
+    if (rnorm <= tolerance) break;
+
+    // Update solution and residual
+    MultiplyHeat(q, p, dt);
+    RNScalar pq = 0;
+    for (int i = 0; i < nvertices; i++) pq += p[i] * q[i];
+    if (pq <= 0) break;
+    RNScalar alpha = rz / pq;
+    RNScalar new_rz = 0;
+    for (int i = 0; i < nvertices; i++) {
+      RNScalar diagonal = masses[i] + dt * diagonal_weights[i];
+      x[i] += alpha * p[i];
+      r[i] -= alpha * q[i];
+      z[i] = (diagonal > 0) ? r[i] / diagonal : r[i];
+      new_rz += r[i] * z[i];
+    }
+
+    // Update search direction
+    RNScalar beta = new_rz / rz;
+    for (int i = 0; i < nvertices; i++) p[i] = z[i] + beta * p[i];
+    rz = new_rz;
+  }
+
+  // Delete temporary vectors
+  delete [] r;
+  delete [] z;
+  delete [] p;
+  delete [] q;
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3MeshPropertySmoother::
+SmoothWithHeat(const RNArray<R3MeshProperty *>& properties, const RNScalar *sigmas, int nsigmas, RNScalar **results) const
+{
+  // Check laplacian
+  if (!masses) return 0;
+
+  // Allocate temporary vectors
+  RNScalar *u = new RNScalar [ nvertices ];
+  RNScalar *w = new RNScalar [ nvertices ];
+  RNScalar *b = new RNScalar [ nvertices ];
+
+  // Diffuse each property through all scales
+  for (int i = 0; i < properties.NEntries(); i++) {
+    R3MeshProperty *property = properties[i];
+
+    // Initialize values (unknown values get zero weight)
+    RNBoolean unknowns = FALSE;
+    for (int k = 0; k < nvertices; k++) {
+      RNScalar value = property->VertexValue(k);
+      if (value == RN_UNKNOWN) { u[k] = 0; w[k] = 0; unknowns = TRUE; }
+      else { u[k] = value; w[k] = 1; }
+    }
+
+    // Diffuse from one scale to the next (heat kernel at time t matches Gaussian with sigma^2 = 2t)
+    RNScalar previous_time = 0;
+    for (int j = 0; j < nsigmas; j++) {
+      RNScalar time = 0.5 * sigmas[j] * sigmas[j];
+      RNScalar dt = (time - previous_time) / nsubsteps;
+      if (dt > 0) {
+        for (int s = 0; s < nsubsteps; s++) {
+          // Implicit euler step for values
+          for (int k = 0; k < nvertices; k++) b[k] = masses[k] * u[k];
+          SolveHeat(u, b, dt);
+
+          // Implicit euler step for weights (constant weights stay constant)
+          if (unknowns) {
+            for (int k = 0; k < nvertices; k++) b[k] = masses[k] * w[k];
+            SolveHeat(w, b, dt);
+          }
+        }
+      }
+
+      // Assign diffused values (normalized by diffused weights)
+      RNScalar *result = results[i*nsigmas + j];
+      for (int k = 0; k < nvertices; k++) {
+        if (w[k] > RN_EPSILON) result[k] = u[k] / w[k];
+      }
+
+      // Remember time
+      previous_time = time;
+    }
+  }
+
+  // Delete temporary vectors
+  delete [] u;
+  delete [] w;
+  delete [] b;
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Update functions
+////////////////////////////////////////////////////////////////////////
+
+void R3MeshPropertySmoother::
+UpdateAdjacency(void)
+{
+  // Build compressed adjacency lists with edge lengths (neighbor_weights)
+  nvertices = mesh->NVertices();
+  neighbor_offsets = new int [ nvertices + 1 ];
+  neighbor_offsets[0] = 0;
+  for (int i = 0; i < nvertices; i++) {
+    R3MeshVertex *vertex = mesh->Vertex(i);
+    neighbor_offsets[i+1] = neighbor_offsets[i] + mesh->VertexValence(vertex);
+  }
+
+  // Fill neighbor indices and edge lengths
+  int nneighbors = neighbor_offsets[nvertices];
+  neighbor_indices = new int [ nneighbors ];
+  neighbor_weights = new RNScalar [ nneighbors ];
+  for (int i = 0; i < nvertices; i++) {
+    R3MeshVertex *vertex = mesh->Vertex(i);
+    for (int j = 0; j < mesh->VertexValence(vertex); j++) {
+      R3MeshEdge *edge = mesh->EdgeOnVertex(vertex, j);
+      R3MeshVertex *neighbor_vertex = mesh->VertexAcrossEdge(edge, vertex);
+      neighbor_indices[neighbor_offsets[i] + j] = mesh->VertexID(neighbor_vertex);
+      neighbor_weights[neighbor_offsets[i] + j] = mesh->EdgeLength(edge);
+    }
+  }
+}
+
+
+
+static RNScalar
+Cotangent(const R3Point& apex, const R3Point& p1, const R3Point& p2)
+{
+  // Return cotangent of angle at apex
+  R3Vector v1 = p1 - apex;
+  R3Vector v2 = p2 - apex;
+  RNScalar sine = (v1 % v2).Length();
+  if (RNIsZero(sine)) return 0;
+  return v1.Dot(v2) / sine;
+}
+
+
+
+void R3MeshPropertySmoother::
+UpdateLaplacian(void)
+{
+  // Build adjacency structure
+  UpdateAdjacency();
+
+  // Initialize weights and lumped masses
+  int nneighbors = neighbor_offsets[nvertices];
+  for (int k = 0; k < nneighbors; k++) neighbor_weights[k] = 0;
+  diagonal_weights = new RNScalar [ nvertices ];
+  masses = new RNScalar [ nvertices ];
+  for (int i = 0; i < nvertices; i++) {
+    diagonal_weights[i] = 0;
+    masses[i] = 0;
+  }
+
+  // Accumulate cotangent weights and masses from faces
+  for (int f = 0; f < mesh->NFaces(); f++) {
+    R3MeshFace *face = mesh->Face(f);
+    RNArea area = mesh->FaceArea(face);
+    for (int c = 0; c < 3; c++) {
+      R3MeshVertex *apex = mesh->VertexOnFace(face, c);
+      R3MeshVertex *vertex1 = mesh->VertexOnFace(face, (c+1)%3);
+      R3MeshVertex *vertex2 = mesh->VertexOnFace(face, (c+2)%3);
+      int apex_index = mesh->VertexID(apex);
+      int index1 = mesh->VertexID(vertex1);
+      int index2 = mesh->VertexID(vertex2);
+      masses[apex_index] += area / 3.0;
+      RNScalar weight = 0.5 * Cotangent(mesh->VertexPosition(apex), mesh->VertexPosition(vertex1), mesh->VertexPosition(vertex2));
+      for (int k = neighbor_offsets[index1]; k < neighbor_offsets[index1+1]; k++) {
+        if (neighbor_indices[k] == index2) { neighbor_weights[k] += weight; break; }
+      }
+      for (int k = neighbor_offsets[index2]; k < neighbor_offsets[index2+1]; k++) {
+        if (neighbor_indices[k] == index1) { neighbor_weights[k] += weight; break; }
+      }
+    }
+  }
+
+  // Clamp negative weights (keeps operator positive semi-definite) and compute diagonal
+  for (int i = 0; i < nvertices; i++) {
+    for (int k = neighbor_offsets[i]; k < neighbor_offsets[i+1]; k++) {
+      if (neighbor_weights[k] < 0) neighbor_weights[k] = 0;
+      diagonal_weights[i] += neighbor_weights[k];
+    }
+  }
+}
@@ -0,0 +1,118 @@
+// Include file for mesh property smoother class
+
+
+
+// Smoothing methods
+
+#define R3_MESH_PROPERTY_DIJKSTRA_SMOOTHING  0
+#define R3_MESH_PROPERTY_HEAT_SMOOTHING      1
+
+
+
+// Class definition
+
+class R3MeshPropertySmoother {
+public:
+  // Constructors/destructors
+  R3MeshPropertySmoother(R3Mesh *mesh, int method = R3_MESH_PROPERTY_DIJKSTRA_SMOOTHING);
+  ~R3MeshPropertySmoother(void);
+
+  // Property functions
+  R3Mesh *Mesh(void) const;
+  int Method(void) const;
+  int NThreads(void) const;
+  int NHeatSubsteps(void) const;
+
+  // Parameter manipulation functions
+  void SetNThreads(int nthreads);
+  void SetNHeatSubsteps(int nsubsteps);
+
+  // Smoothing functions
+  int Smooth(const RNArray<R3MeshProperty *>& properties,
+    const RNScalar *sigmas, int nsigmas, R3MeshProperty **results) const;
+    // Writes the Gaussian smoothing of properties[i] at scale sigmas[j] into results[i*nsigmas + j]
+    // (sigmas must be increasing, results must be allocated for the mesh)
+  int Smooth(R3MeshProperty *property, RNScalar sigma) const;
+    // Replaces property values with smoothed ones
+
+public:
+  // Internal smoothing functions
+  int SmoothWithDijkstra(const RNArray<R3MeshProperty *>& properties,
+    const RNScalar *sigmas, int nsigmas, RNScalar **results) const;
+  int SmoothWithHeat(const RNArray<R3MeshProperty *>& properties,
+    const RNScalar *sigmas, int nsigmas, RNScalar **results) const;
+  int SolveHeat(RNScalar *x, const RNScalar *b, RNScalar dt) const;
+  void MultiplyHeat(RNScalar *y, const RNScalar *x, RNScalar dt) const;
+
+  // Internal update functions
+  void UpdateAdjacency(void);
+  void UpdateLaplacian(void);
+
+public:
+  R3Mesh *mesh;
+  int method;
+  int nthreads;
+  int nsubsteps;
+  int nvertices;
+  int *neighbor_offsets;
+  int *neighbor_indices;
+  RNScalar *neighbor_weights;
+  RNScalar *diagonal_weights;
+  RNScalar *masses;
+};
+
+
+
+// Inline functions
+
+inline R3Mesh *R3MeshPropertySmoother::
+Mesh(void) const
+{
+  // Return mesh
+  return mesh;
+}
+
+
+
+inline int R3MeshPropertySmoother::
+Method(void) const
+{
+  // Return smoothing method
+  return method;
+}
+
+
+
+inline int R3MeshPropertySmoother::
+NThreads(void) const
+{
+  // Return number of threads (0 means default)
+  return nthreads;
+}
+
+
+
+inline int R3MeshPropertySmoother::
+NHeatSubsteps(void) const
+{
+  // Return number of implicit steps per scale
+  return nsubsteps;
+}
+
+
+
+inline void R3MeshPropertySmoother::
+SetNThreads(int nthreads)
+{
+  // Set number of threads (0 means default)
+  this->nthreads = nthreads;
+}
+
+
+
+inline void R3MeshPropertySmoother::
+SetNHeatSubsteps(int nsubsteps)
+{
+  // Set number of implicit steps per scale
+  this->nsubsteps = (nsubsteps > 0) ? nsubsteps : 1;
+}
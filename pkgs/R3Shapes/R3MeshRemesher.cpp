@@ -0,0 +1,811 @@
+// Source file for mesh remeshing class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Parameters
+////////////////////////////////////////////////////////////////////////
+
+// Edges longer than this times their target length are split
+static const RNScalar split_ratio = 4.0 / 3.0;
+
+// Edges shorter than this times their target length are collapsed
+static const RNScalar collapse_ratio = 4.0 / 5.0;
+
+// Fraction of the way vertices move towards the centroid of their neighbors in every relaxation
+static const RNScalar relaxation_factor = 0.5;
+
+// Number of closest feature samples checked when projecting onto feature edges
+static const int max_feature_samples = 8;
+
+// Number of vertices processed by every parallel task
+static const int chunk_size = 256;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3MeshRemesher::
+R3MeshRemesher(R3Mesh *mesh)
+  : mesh(mesh),
+    target_edge_length(0),
+    min_edge_length(0),
+    approximation_error(0),
+    feature_angle(RN_PI / 4.0),
+    niterations(10),
+    nthreads(0),
+    reference_mesh(NULL),
+    reference_tree(NULL),
+    reference_sizing(NULL),
+    reference_features(NULL),
+    nreference_features(0),
+    reference_feature_samples(NULL),
+    reference_feature_sample_edges(NULL),
+    reference_feature_kdtree(NULL),
+    sizing(NULL),
+    nsizing_allocated(0),
+    nsplits(0),
+    ncollapses(0),
+    nswaps(0)
+{
+}
+
+
+
+R3MeshRemesher::
+~R3MeshRemesher(void)
+{
+  // Delete reference data
+  DeleteReference();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Feature functions
+////////////////////////////////////////////////////////////////////////
+
+RNBoolean R3MeshRemesher::
+IsFeatureEdge(const R3MeshEdge *edge) const
+{
+  // Return whether edge is marked as feature or on boundary
+  if (mesh->EdgeFlags(edge)[R3_MESH_EDGE_USER_FLAG]) return TRUE;
+  if (mesh->IsEdgeOnBoundary(edge)) return TRUE;
+  return FALSE;
+}
+
+
+
+int R3MeshRemesher::
+NFeatureEdges(const R3MeshVertex *vertex) const
+{
+  // Count feature edges on vertex (0 is a free vertex, 2 is on a feature line unless it turns sharply, others are corners)
+  int count = 0;
+  for (int i = 0; i < mesh->VertexValence(vertex); i++) {
+    R3MeshEdge *edge = mesh->EdgeOnVertex(vertex, i);
+    if (IsFeatureEdge(edge)) count++;
+  }
+  return count;
+}
+
+
+
+RNBoolean R3MeshRemesher::
+IsCornerVertex(const R3MeshVertex *vertex) const
+{
+  // Check number of feature edges (vertices on feature lines have two)
+  R3MeshEdge *features[2] = { NULL, NULL };
+  int count = 0;
+  for (int i = 0; i < mesh->VertexValence(vertex); i++) {
+    R3MeshEdge *edge = mesh->EdgeOnVertex(vertex, i);
+    if (!IsFeatureEdge(edge)) continue;
+    if (count < 2) features[count] = edge;
+    count++;
+  }
+  if (count == 0) return FALSE;
+  if (count != 2) return TRUE;
+
+  // Check whether feature line turns by more than feature angle at vertex
+  const R3Point& position = mesh->VertexPosition(vertex);
+  R3Vector d0 = position - mesh->VertexPosition(mesh->VertexAcrossEdge(features[0], vertex));
+  R3Vector d1 = mesh->VertexPosition(mesh->VertexAcrossEdge(features[1], vertex)) - position;
+  RNLength l0 = d0.Length();
+  RNLength l1 = d1.Length();
+  if (RNIsZero(l0) || RNIsZero(l1)) return FALSE;
+  return (d0.Dot(d1) < cos(feature_angle) * l0 * l1) ? TRUE : FALSE;
+}
+
+
+
+static RNBoolean
+IsSharpEdge(R3Mesh *mesh, R3MeshEdge *edge, RNAngle feature_angle)
+{
+  // Return whether normals of faces on edge differ by more than feature angle
+  R3MeshFace *face0 = mesh->FaceOnEdge(edge, 0);
+  R3MeshFace *face1 = mesh->FaceOnEdge(edge, 1);
+  if (!face0 || !face1) return FALSE;
+  RNScalar dot = mesh->FaceNormal(face0).Dot(mesh->FaceNormal(face1));
+  return (dot < cos(feature_angle)) ? TRUE : FALSE;
+}
+
+
+
+static void
+SetFeatureFlag(R3Mesh *mesh, R3MeshEdge *edge, RNBoolean feature)
+{
+  // Add or remove feature flag of edge
+  RNFlags flags = mesh->EdgeFlags(edge);
+  if (feature) flags.Add(R3_MESH_EDGE_USER_FLAG);
+  else flags.Remove(R3_MESH_EDGE_USER_FLAG);
+  mesh->SetEdgeFlags(edge, flags);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Reference functions
+////////////////////////////////////////////////////////////////////////
+
+void R3MeshRemesher::
+InitializeReference(void)
+{
+  // Copy mesh (vertex IDs of copy match those of mesh)
+  reference_mesh = new R3Mesh(*mesh);
+  reference_tree = new R3MeshSearchTree(reference_mesh);
+
+  // Determine range of edge lengths
+  RNLength max_length = target_edge_length;
+  if (max_length <= 0) max_length = mesh->AverageEdgeLength();
+  RNLength min_length = min_edge_length;
+  if (min_length <= 0) min_length = 0.1 * max_length;
+  if (min_length > max_length) min_length = max_length;
+
+  // Find feature edges of reference mesh
+  int nvertices = reference_mesh->NVertices();
+  RNBoolean *feature_vertices = new RNBoolean [ nvertices ];
+  for (int i = 0; i < nvertices; i++) feature_vertices[i] = FALSE;
+  reference_features = new int [ 2 * reference_mesh->NEdges() ];
+  nreference_features = 0;
+  for (int i = 0; i < reference_mesh->NEdges(); i++) {
+    R3MeshEdge *edge = reference_mesh->Edge(i);
+    if (!reference_mesh->IsEdgeOnBoundary(edge) && !IsSharpEdge(reference_mesh, edge, feature_angle)) continue;
+    int i0 = reference_mesh->VertexID(reference_mesh->VertexOnEdge(edge, 0));
+    int i1 = reference_mesh->VertexID(reference_mesh->VertexOnEdge(edge, 1));
+    reference_features[2*nreference_features+0] = i0;
+    reference_features[2*nreference_features+1] = i1;
+    feature_vertices[i0] = feature_vertices[i1] = TRUE;
+    nreference_features++;
+  }
+
+  // Sample feature edges (every half of the shortest target length) for closest feature search
+  int nsamples = 0;
+  for (int i = 0; i < nreference_features; i++) {
+    const R3Point& p0 = reference_mesh->VertexPosition(reference_mesh->Vertex(reference_features[2*i+0]));
+    const R3Point& p1 = reference_mesh->VertexPosition(reference_mesh->Vertex(reference_features[2*i+1]));
+    nsamples += 1 + (int) (R3Distance(p0, p1) / (0.5 * min_length));
+  }
+  reference_feature_samples = new R3Point [ nsamples + 1 ];
+  reference_feature_sample_edges = new int [ nsamples + 1 ];
+  RNArray<const R3Point *> samples;
+  for (int i = 0; i < nreference_features; i++) {
+    const R3Point& p0 = reference_mesh->VertexPosition(reference_mesh->Vertex(reference_features[2*i+0]));
+    const R3Point& p1 = reference_mesh->VertexPosition(reference_mesh->Vertex(reference_features[2*i+1]));
+    int n = 1 + (int) (R3Distance(p0, p1) / (0.5 * min_length));
+    for (int j = 0; j < n; j++) {
+      int sample_index = samples.NEntries();
+      reference_feature_samples[sample_index] = p0 + (p1 - p0) * ((j + 0.5) / n);
+      reference_feature_sample_edges[sample_index] = i;
+      samples.Insert(&reference_feature_samples[sample_index]);
+    }
+  }
+  if (samples.NEntries() > 0) {
+    reference_feature_kdtree = new R3Kdtree<const R3Point *>(samples);
+  }
+
+  // Compute maximum curvatures of reference vertices (from mean and Gauss curvatures)
+  RNScalar *curvatures = new RNScalar [ nvertices ];
+  for (int i = 0; i < nvertices; i++) {
+    curvatures[i] = 0;
+    if (approximation_error <= 0) continue;
+    R3MeshVertex *vertex = reference_mesh->Vertex(i);
+    if (feature_vertices[i]) continue;
+    RNScalar h = reference_mesh->VertexMeanCurvature(vertex);
+    RNScalar k = reference_mesh->VertexGaussCurvature(vertex);
+    RNScalar d = h*h - k;
+    curvatures[i] = fabs(h) + ((d > 0) ? sqrt(d) : 0);
+  }
+
+  // Compute target edge lengths of reference vertices, averaging curvatures over one-rings
+  // (feature vertices only use their neighbors not on features)
+  reference_sizing = new RNLength [ nvertices ];
+  for (int i = 0; i < nvertices; i++) {
+    reference_sizing[i] = max_length;
+    if (approximation_error <= 0) continue;
+    R3MeshVertex *vertex = reference_mesh->Vertex(i);
+    RNScalar sum = 0;
+    int count = 0;
+    if (!feature_vertices[i]) { sum += curvatures[i]; count++; }
+    for (int j = 0; j < reference_mesh->VertexValence(vertex); j++) {
+      R3MeshEdge *edge = reference_mesh->EdgeOnVertex(vertex, j);
+      int neighbor_index = reference_mesh->VertexID(reference_mesh->VertexAcrossEdge(edge, vertex));
+      if (feature_vertices[neighbor_index]) continue;
+      sum += curvatures[neighbor_index];
+      count++;
+    }
+    if (count == 0) continue;
+    RNScalar curvature = sum / count;
+    RNScalar e = approximation_error;
+    RNScalar d = (curvature > 0) ? 6 * e / curvature - 3 * e * e : 0;
+    if (d <= 0) continue;
+    RNLength length = sqrt(d);
+    if (length < min_length) length = min_length;
+    if (length < reference_sizing[i]) reference_sizing[i] = length;
+  }
+
+  // Delete temporary data
+  delete [] curvatures;
+  delete [] feature_vertices;
+}
+
+
+
+void R3MeshRemesher::
+DeleteReference(void)
+{
+  // Delete reference data
+  if (reference_feature_kdtree) delete reference_feature_kdtree;
+  if (reference_feature_sample_edges) delete [] reference_feature_sample_edges;
+  if (reference_feature_samples) delete [] reference_feature_samples;
+  if (reference_features) delete [] reference_features;
+  if (reference_sizing) delete [] reference_sizing;
+  if (reference_tree) delete reference_tree;
+  if (reference_mesh) delete reference_mesh;
+  if (sizing) delete [] sizing;
+  reference_feature_kdtree = NULL;
+  reference_feature_samples = NULL;
+  reference_feature_sample_edges = NULL;
+  reference_features = NULL;
+  nreference_features = 0;
+  reference_sizing = NULL;
+  reference_tree = NULL;
+  reference_mesh = NULL;
+  sizing = NULL;
+  nsizing_allocated = 0;
+}
+
+
+
+void R3MeshRemesher::
+SetSizing(int vertex_id, RNLength value)
+{
+  // Grow array of target edge lengths
+  if (vertex_id >= nsizing_allocated) {
+    int nallocated = 2 * nsizing_allocated;
+    if (nallocated <= vertex_id) nallocated = vertex_id + 1;
+    RNLength *allocated = new RNLength [ nallocated ];
+    for (int i = 0; i < nsizing_allocated; i++) allocated[i] = sizing[i];
+    if (sizing) delete [] sizing;
+    sizing = allocated;
+    nsizing_allocated = nallocated;
+  }
+
+  // Set target edge length of vertex
+  sizing[vertex_id] = value;
+}
+
+
+
+R3Point R3MeshRemesher::
+ProjectVertex(const R3Point& position, RNBoolean feature, RNLength *result_sizing) const
+{
+  // Project onto closest feature edge of reference mesh
+  if (feature && reference_feature_kdtree) {
+    RNArray<const R3Point *> samples;
+    reference_feature_kdtree->FindClosest(position, 0, FLT_MAX, max_feature_samples, samples);
+    R3Point closest_position = position;
+    RNLength closest_distance = FLT_MAX;
+    for (int i = 0; i < samples.NEntries(); i++) {
+      // Find closest point on feature edge of sample
+      int edge_index = reference_feature_sample_edges[samples.Kth(i) - reference_feature_samples];
+      int i0 = reference_features[2*edge_index+0];
+      int i1 = reference_features[2*edge_index+1];
+      const R3Point& p0 = reference_mesh->VertexPosition(reference_mesh->Vertex(i0));
+      const R3Point& p1 = reference_mesh->VertexPosition(reference_mesh->Vertex(i1));
+      R3Vector v = p1 - p0;
+      RNScalar length_squared = v.Dot(v);
+      RNScalar t = (length_squared > 0) ? v.Dot(position - p0) / length_squared : 0;
+      if (t < 0) t = 0;
+      else if (t > 1) t = 1;
+      R3Point point = p0 + t * v;
+
+      // Remember closest point
+      RNLength distance = R3Distance(position, point);
+      if (distance < closest_distance) {
+        closest_position = point;
+        closest_distance = distance;
+        *result_sizing = (1 - t) * reference_sizing[i0] + t * reference_sizing[i1];
+      }
+    }
+
+    // Return closest point on features
+    if (closest_distance < FLT_MAX) return closest_position;
+  }
+
+  // Project onto closest point of reference surface
+  R3MeshIntersection closest;
+  reference_tree->FindClosest(position, closest);
+  if (closest.type == R3_MESH_FACE_TYPE) {
+    R3Point b = reference_mesh->FaceBarycentric(closest.face, closest.point);
+    RNScalar weights[3] = { b[0], b[1], b[2] };
+    RNScalar total_weight = 0;
+    RNLength sum = 0;
+    for (int i = 0; i < 3; i++) {
+      if (weights[i] < 0) weights[i] = 0;
+      int vertex_index = reference_mesh->VertexID(reference_mesh->VertexOnFace(closest.face, i));
+      sum += weights[i] * reference_sizing[vertex_index];
+      total_weight += weights[i];
+    }
+    if (total_weight > 0) *result_sizing = sum / total_weight;
+    else *result_sizing = reference_sizing[reference_mesh->VertexID(reference_mesh->VertexOnFace(closest.face, 0))];
+    return closest.point;
+  }
+  else if (closest.type == R3_MESH_EDGE_TYPE) {
+    int i0 = reference_mesh->VertexID(reference_mesh->VertexOnEdge(closest.edge, 0));
+    int i1 = reference_mesh->VertexID(reference_mesh->VertexOnEdge(closest.edge, 1));
+    *result_sizing = 0.5 * (reference_sizing[i0] + reference_sizing[i1]);
+    return closest.point;
+  }
+  else if (closest.type == R3_MESH_VERTEX_TYPE) {
+    *result_sizing = reference_sizing[reference_mesh->VertexID(closest.vertex)];
+    return closest.point;
+  }
+
+  // Keep position if nothing was found
+  *result_sizing = 0;
+  return position;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Geometry utility functions
+////////////////////////////////////////////////////////////////////////
+
+static R3Vector
+FaceCross(R3Mesh *mesh, R3MeshFace *face, const R3MeshVertex *vertex, const R3Point& position)
+{
+  // Return cross product of face edges (area-weighted normal) with vertex moved to position
+  R3Point p[3];
+  for (int i = 0; i < 3; i++) {
+    R3MeshVertex *v = mesh->VertexOnFace(face, i);
+    p[i] = (v == vertex) ? position : mesh->VertexPosition(v);
+  }
+  R3Vector cross = p[1] - p[0];
+  cross.Cross(p[2] - p[0]);
+  return cross;
+}
+
+
+
+static RNBoolean
+IsNormalPreserved(R3Mesh *mesh, R3MeshVertex *vertex, const R3Point& position, const R3MeshEdge *edge)
+{
+  // Check whether moving vertex to position flips or degenerates any of its faces (except ones on edge)
+  for (int i = 0; i < mesh->VertexValence(vertex); i++) {
+    R3MeshEdge *e = mesh->EdgeOnVertex(vertex, i);
+    R3MeshFace *face = mesh->FaceOnEdge(e, vertex, RN_CCW);
+    if (!face) continue;
+    if (mesh->IsEdgeOnFace(edge, face)) continue;
+    R3Vector n0 = FaceCross(mesh, face, NULL, R3zero_point);
+    R3Vector n1 = FaceCross(mesh, face, vertex, position);
+    RNLength l0 = n0.Length();
+    RNLength l1 = n1.Length();
+    if (RNIsZero(l1)) return FALSE;
+    if (RNIsZero(l0)) continue;
+    if (n0.Dot(n1) < 0.5 * l0 * l1) return FALSE;
+  }
+
+  // Normals are preserved
+  return TRUE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Edge operations
+////////////////////////////////////////////////////////////////////////
+
+int R3MeshRemesher::
+SplitLongEdges(void)
+{
+  // Split edges longer than 4/3 of their target lengths at their midpoints
+  int count = 0;
+  for (int i = 0; i < mesh->NEdges(); i++) {
+    R3MeshEdge *edge = mesh->Edge(i);
+    R3MeshVertex *v0 = mesh->VertexOnEdge(edge, 0);
+    R3MeshVertex *v1 = mesh->VertexOnEdge(edge, 1);
+    RNLength s0 = sizing[mesh->VertexID(v0)];
+    RNLength s1 = sizing[mesh->VertexID(v1)];
+    RNLength target = (s0 < s1) ? s0 : s1;
+    const R3Point& p0 = mesh->VertexPosition(v0);
+    const R3Point& p1 = mesh->VertexPosition(v1);
+    if (R3Distance(p0, p1) <= split_ratio * target) continue;
+
+    // Split edge (the last edge moves into its slot, so it is checked again)
+    RNBoolean feature = mesh->EdgeFlags(edge)[R3_MESH_EDGE_USER_FLAG];
+    R3MeshEdge *e0 = NULL, *e1 = NULL;
+    R3MeshVertex *vertex = mesh->SplitEdge(edge, 0.5 * (p0 + p1), &e0, &e1);
+    if (!vertex) continue;
+
+    // Update feature flags and target edge lengths
+    if (feature) {
+      SetFeatureFlag(mesh, e0, TRUE);
+      SetFeatureFlag(mesh, e1, TRUE);
+    }
+    SetSizing(mesh->VertexID(vertex), 0.5 * (s0 + s1));
+    count++;
+    i--;
+  }
+
+  // Return number of splits
+  return count;
+}
+
+
+
+RNBoolean R3MeshRemesher::
+CanCollapseEdge(R3MeshEdge *edge, R3MeshVertex *vertex, const R3Point& position) const
+{
+  // Get kept vertex
+  R3MeshVertex *kept_vertex = mesh->VertexAcrossEdge(edge, vertex);
+
+  // Check link condition (vertices adjacent to both must be the ones across faces on edge)
+  int nfaces = 0;
+  if (mesh->FaceOnEdge(edge, 0)) nfaces++;
+  if (mesh->FaceOnEdge(edge, 1)) nfaces++;
+  int ncommon = 0;
+  for (int i = 0; i < mesh->VertexValence(vertex); i++) {
+    R3MeshVertex *neighbor = mesh->VertexAcrossEdge(mesh->EdgeOnVertex(vertex, i), vertex);
+    if (neighbor == kept_vertex) continue;
+    if (mesh->EdgeBetweenVertices(neighbor, kept_vertex)) ncommon++;
+  }
+  if (ncommon != nfaces) return FALSE;
+
+  // Check that collapse does not create long edges
+  RNLength s0 = sizing[mesh->VertexID(vertex)];
+  RNLength s1 = sizing[mesh->VertexID(kept_vertex)];
+  RNLength target = (s0 < s1) ? s0 : s1;
+  for (int k = 0; k < 2; k++) {
+    R3MeshVertex *v = (k == 0) ? vertex : kept_vertex;
+    for (int i = 0; i < mesh->VertexValence(v); i++) {
+      R3MeshVertex *neighbor = mesh->VertexAcrossEdge(mesh->EdgeOnVertex(v, i), v);
+      if ((neighbor == vertex) || (neighbor == kept_vertex)) continue;
+      if (R3Distance(position, mesh->VertexPosition(neighbor)) > split_ratio * target) return FALSE;
+    }
+  }
+
+  // Check that collapse does not flip faces
+  if (!IsNormalPreserved(mesh, vertex, position, edge)) return FALSE;
+  if (!IsNormalPreserved(mesh, kept_vertex, position, edge)) return FALSE;
+
+  // Collapse is OK
+  return TRUE;
+}
+
+
+
+int R3MeshRemesher::
+CollapseShortEdges(void)
+{
+  // Collapse edges shorter than 4/5 of their target lengths
+  int count = 0;
+  for (int i = 0; i < mesh->NEdges(); i++) {
+    if (mesh->NFaces() <= 4) break;
+    R3MeshEdge *edge = mesh->Edge(i);
+    R3MeshVertex *v0 = mesh->VertexOnEdge(edge, 0);
+    R3MeshVertex *v1 = mesh->VertexOnEdge(edge, 1);
+    RNLength s0 = sizing[mesh->VertexID(v0)];
+    RNLength s1 = sizing[mesh->VertexID(v1)];
+    RNLength target = (s0 < s1) ? s0 : s1;
+    const R3Point& p0 = mesh->VertexPosition(v0);
+    const R3Point& p1 = mesh->VertexPosition(v1);
+    if (R3Distance(p0, p1) >= collapse_ratio * target) continue;
+
+    // Count feature edges on vertices (corners count as -1)
+    RNBoolean feature = IsFeatureEdge(edge);
+    int nfeatures0 = (IsCornerVertex(v0)) ? -1 : NFeatureEdges(v0);
+    int nfeatures1 = (IsCornerVertex(v1)) ? -1 : NFeatureEdges(v1);
+
+    // Try removing either vertex (free vertices, and feature line vertices along their feature)
+    R3MeshVertex *removed_vertex = NULL;
+    R3Point position = R3zero_point;
+    RNBoolean midpoint = FALSE;
+    for (int k = 0; k < 2; k++) {
+      R3MeshVertex *vr = (k == 0) ? v1 : v0;
+      R3MeshVertex *vk = (k == 0) ? v0 : v1;
+      int nfeatures_removed = (k == 0) ? nfeatures1 : nfeatures0;
+      int nfeatures_kept = (k == 0) ? nfeatures0 : nfeatures1;
+
+      // Check features of removed vertex
+      if (nfeatures_removed == 0) {
+        // Free vertex moves onto kept vertex, unless both are free
+        midpoint = (nfeatures_kept == 0) ? TRUE : FALSE;
+      }
+      else if ((nfeatures_removed == 2) && feature) {
+        // Feature line vertex moves along its feature, and its other feature edge must not be on a face of edge
+        R3MeshEdge *other_feature = NULL;
+        for (int j = 0; j < mesh->VertexValence(vr); j++) {
+          R3MeshEdge *e = mesh->EdgeOnVertex(vr, j);
+          if ((e != edge) && IsFeatureEdge(e)) other_feature = e;
+        }
+        if (!other_feature) continue;
+        R3MeshFace *f0 = mesh->FaceOnEdge(edge, 0);
+        R3MeshFace *f1 = mesh->FaceOnEdge(edge, 1);
+        if (f0 && mesh->IsEdgeOnFace(other_feature, f0)) continue;
+        if (f1 && mesh->IsEdgeOnFace(other_feature, f1)) continue;
+        midpoint = (nfeatures_kept == 2) ? TRUE : FALSE;
+      }
+      else {
+        // Corners are never removed
+        continue;
+      }
+
+      // Check collapse
+      position = (midpoint) ? 0.5 * (p0 + p1) : mesh->VertexPosition(vk);
+      if (!CanCollapseEdge(edge, vr, position)) continue;
+      removed_vertex = vr;
+      break;
+    }
+
+    // Check if found vertex to remove
+    if (!removed_vertex) continue;
+
+    // Orient edge so that its first vertex is kept
+    if (removed_vertex == v0) mesh->FlipEdge(edge);
+    R3MeshVertex *kept_vertex = mesh->VertexAcrossEdge(edge, removed_vertex);
+    RNLength kept_sizing = (midpoint) ? 0.5 * (s0 + s1) : sizing[mesh->VertexID(kept_vertex)];
+
+    // Collapse edge
+    int removed_id = mesh->VertexID(removed_vertex);
+    int tail_id = mesh->NVertices() - 1;
+    if (!mesh->CollapseEdge(edge, position)) continue;
+
+    // Update target edge lengths (the last vertex moves into the slot of the removed vertex)
+    sizing[removed_id] = sizing[tail_id];
+    sizing[mesh->VertexID(kept_vertex)] = kept_sizing;
+    count++;
+    i--;
+  }
+
+  // Return number of collapses
+  return count;
+}
+
+
+
+static int
+ValenceDeviation(R3Mesh *mesh, R3MeshVertex *vertex, int change)
+{
+  // Return difference between valence and optimal valence (6 for interior and 4 for boundary vertices)
+  int target = (mesh->IsVertexOnBoundary(vertex)) ? 4 : 6;
+  int deviation = mesh->VertexValence(vertex) + change - target;
+  return (deviation < 0) ? -deviation : deviation;
+}
+
+
+
+int R3MeshRemesher::
+SwapEdges(void)
+{
+  // Swap edges that make valences closer to optimal
+  RNScalar min_dot = cos(feature_angle);
+  int count = 0;
+  for (int i = 0; i < mesh->NEdges(); i++) {
+    R3MeshEdge *edge = mesh->Edge(i);
+    if (IsFeatureEdge(edge)) continue;
+
+    // Get faces and vertices
+    R3MeshFace *f0 = mesh->FaceOnEdge(edge, 0);
+    R3MeshFace *f1 = mesh->FaceOnEdge(edge, 1);
+    R3MeshVertex *va = mesh->VertexOnEdge(edge, 0);
+    R3MeshVertex *vb = mesh->VertexOnEdge(edge, 1);
+    R3MeshVertex *vc = mesh->VertexAcrossFace(f0, edge);
+    R3MeshVertex *vd = mesh->VertexAcrossFace(f1, edge);
+    if (mesh->EdgeBetweenVertices(vc, vd)) continue;
+
+    // Check if swap reduces valence deviation
+    int deviation0 = ValenceDeviation(mesh, va, 0) + ValenceDeviation(mesh, vb, 0) +
+      ValenceDeviation(mesh, vc, 0) + ValenceDeviation(mesh, vd, 0);
+    int deviation1 = ValenceDeviation(mesh, va, -1) + ValenceDeviation(mesh, vb, -1) +
+      ValenceDeviation(mesh, vc, 1) + ValenceDeviation(mesh, vd, 1);
+    if (deviation1 >= deviation0) continue;
+
+    // Get vertices of f0 in counterclockwise order starting at vc
+    int k = 0;
+    while ((k < 2) && (mesh->VertexOnFace(f0, k) != vc)) k++;
+    R3MeshVertex *vp = mesh->VertexOnFace(f0, (k + 1) % 3);
+    R3MeshVertex *vq = mesh->VertexOnFace(f0, (k + 2) % 3);
+
+    // Check if new faces (c,p,d) and (d,q,c) are convex and do not create a sharp edge
+    const R3Point& pc = mesh->VertexPosition(vc);
+    const R3Point& pd = mesh->VertexPosition(vd);
+    const R3Point& pp = mesh->VertexPosition(vp);
+    const R3Point& pq = mesh->VertexPosition(vq);
+    R3Vector old_normal = FaceCross(mesh, f0, NULL, R3zero_point) + FaceCross(mesh, f1, NULL, R3zero_point);
+    R3Vector n0 = pp - pc; n0.Cross(pd - pc);
+    R3Vector n1 = pq - pd; n1.Cross(pc - pd);
+    RNLength l0 = n0.Length();
+    RNLength l1 = n1.Length();
+    if (RNIsZero(l0) || RNIsZero(l1)) continue;
+    if (n0.Dot(old_normal) <= 0) continue;
+    if (n1.Dot(old_normal) <= 0) continue;
+    if (n0.Dot(n1) < min_dot * l0 * l1) continue;
+
+    // Swap edge
+    if (!mesh->SwapEdge(edge)) continue;
+    count++;
+  }
+
+  // Return number of swaps
+  return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Vertex relaxation
+////////////////////////////////////////////////////////////////////////
+
+struct R3MeshRemesherData {
+  const R3MeshRemesher *remesher;
+  const int *nfeatures;
+  R3Point *positions;
+};
+
+
+
+static void
+RelaxVertex(int index, int, void *data)
+{
+  // Get convenient variables
+  R3MeshRemesherData *loop = (R3MeshRemesherData *) data;
+  const R3MeshRemesher *remesher = loop->remesher;
+  R3Mesh *mesh = remesher->mesh;
+  R3MeshVertex *vertex = mesh->Vertex(index);
+  const R3Point& position = mesh->VertexPosition(vertex);
+  loop->positions[index] = position;
+
+  // Move free vertices towards area-weighted centroids of their one-rings within their tangent planes
+  if (loop->nfeatures[index] == 0) {
+    R3Point centroid = R3zero_point;
+    R3Vector normal = R3zero_vector;
+    RNArea total_area = 0;
+    for (int i = 0; i < mesh->VertexValence(vertex); i++) {
+      R3MeshEdge *edge = mesh->EdgeOnVertex(vertex, i);
+      R3MeshFace *face = mesh->FaceOnEdge(edge, vertex, RN_CCW);
+      if (!face) continue;
+      R3Vector cross = FaceCross(mesh, face, NULL, R3zero_point);
+      RNArea area = 0.5 * cross.Length();
+      R3Point face_centroid = R3zero_point;
+      for (int j = 0; j < 3; j++) face_centroid += mesh->VertexPosition(mesh->VertexOnFace(face, j));
+      face_centroid /= 3.0;
+      centroid += area * face_centroid;
+      normal += cross;
+      total_area += area;
+    }
+    if (RNIsZero(total_area)) return;
+    centroid /= total_area;
+    normal.Normalize();
+    R3Vector displacement = centroid - position;
+    displacement -= displacement.Dot(normal) * normal;
+    loop->positions[index] = position + relaxation_factor * displacement;
+  }
+
+  // Move feature line vertices towards centroids of their feature neighbors
+  else if (loop->nfeatures[index] == 2) {
+    R3Point centroid = R3zero_point;
+    for (int i = 0; i < mesh->VertexValence(vertex); i++) {
+      R3MeshEdge *edge = mesh->EdgeOnVertex(vertex, i);
+      if (!remesher->IsFeatureEdge(edge)) continue;
+      centroid += mesh->VertexPosition(mesh->VertexAcrossEdge(edge, vertex));
+    }
+    centroid /= 2.0;
+    loop->positions[index] = position + relaxation_factor * (centroid - position);
+  }
+}
+
+
+
+void R3MeshRemesher::
+RelaxVertices(void)
+{
+  // Count feature edges on vertices (corners count as -1)
+  int nvertices = mesh->NVertices();
+  int *nfeatures = new int [ nvertices ];
+  for (int i = 0; i < nvertices; i++) {
+    R3MeshVertex *vertex = mesh->Vertex(i);
+    nfeatures[i] = (IsCornerVertex(vertex)) ? -1 : NFeatureEdges(vertex);
+  }
+
+  // Compute relaxed positions in parallel (from positions and topology only)
+  R3MeshRemesherData data;
+  data.remesher = this;
+  data.nfeatures = nfeatures;
+  data.positions = new R3Point [ nvertices ];
+  RNParallelFor(nvertices, RelaxVertex, &data, nthreads, chunk_size);
+
+  // Project relaxed positions onto reference mesh (corners stay where they are)
+  for (int i = 0; i < nvertices; i++) {
+    if ((nfeatures[i] != 0) && (nfeatures[i] != 2)) continue;
+    R3MeshVertex *vertex = mesh->Vertex(i);
+    RNLength vertex_sizing = 0;
+    R3Point position = ProjectVertex(data.positions[i], (nfeatures[i] == 2), &vertex_sizing);
+    mesh->SetVertexPosition(vertex, position);
+    if (vertex_sizing > 0) sizing[i] = vertex_sizing;
+  }
+
+  // Delete temporary data
+  delete [] data.positions;
+  delete [] nfeatures;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Remeshing functions
+////////////////////////////////////////////////////////////////////////
+
+int R3MeshRemesher::
+Remesh(void)
+{
+  // Check mesh
+  nsplits = ncollapses = nswaps = 0;
+  if (mesh->NFaces() == 0) {
+    fprintf(stderr, "Unable to remesh mesh without faces\n");
+    return 0;
+  }
+
+  // Mark feature edges
+  for (int i = 0; i < mesh->NEdges(); i++) {
+    R3MeshEdge *edge = mesh->Edge(i);
+    SetFeatureFlag(mesh, edge, IsSharpEdge(mesh, edge, feature_angle));
+  }
+
+  // Copy mesh for projection and compute target edge lengths
+  InitializeReference();
+  for (int i = 0; i < mesh->NVertices(); i++) {
+    SetSizing(i, reference_sizing[i]);
+  }
+
+  // Iteratively split, collapse, swap, and relax
+  for (int iteration = 0; iteration < niterations; iteration++) {
+    nsplits += SplitLongEdges();
+    ncollapses += CollapseShortEdges();
+    nswaps += SwapEdges();
+    RelaxVertices();
+  }
+
+  // Clear feature flags
+  for (int i = 0; i < mesh->NEdges(); i++) {
+    SetFeatureFlag(mesh, mesh->Edge(i), FALSE);
+  }
+
+  // Delete reference data
+  DeleteReference();
+
+  // Return success
+  return 1;
+}
+
+
+
@@ -0,0 +1,248 @@
+// Include file for mesh remeshing class
+
+
+
+// Class definition
+
+class R3MeshRemesher {
+public:
+  // Constructors/destructors
+  R3MeshRemesher(R3Mesh *mesh);
+  ~R3MeshRemesher(void);
+
+  // Property functions
+  R3Mesh *Mesh(void) const;
+  RNLength TargetEdgeLength(void) const;
+  RNLength MinEdgeLength(void) const;
+  RNLength ApproximationError(void) const;
+  RNAngle FeatureAngle(void) const;
+  int NIterations(void) const;
+  int NThreads(void) const;
+
+  // Parameter manipulation functions
+  void SetTargetEdgeLength(RNLength target_edge_length);
+    // Edge length of isotropic remeshing, and longest edge length of adaptive remeshing
+    // (default 0 means the average edge length of the input mesh)
+  void SetMinEdgeLength(RNLength min_edge_length);
+    // Shortest edge length of adaptive remeshing (default 0 means a tenth of the target edge length)
+  void SetApproximationError(RNLength approximation_error);
+    // Adaptive remeshing sizes edges so that they stay within this distance of a circle with the
+    // maximum curvature of the input surface, l = sqrt(6 e / k - 3 e^2) (default 0 means isotropic)
+  void SetFeatureAngle(RNAngle feature_angle);
+    // Edges whose faces' normals differ by more than this angle are features (default 45 degrees),
+    // features and boundaries are only split and collapsed along their own direction
+  void SetNIterations(int niterations);
+    // Number of split, collapse, swap, and smoothing passes (default 10)
+  void SetNThreads(int nthreads);
+
+  // Remeshing functions
+  int Remesh(void);
+    // Remeshes the mesh in place with edges of the target lengths (within 4/5 to 4/3 of them),
+    // valences close to 6 (4 on boundaries), and vertices relaxed in tangent planes and
+    // projected back onto the input surface (and onto input feature edges for feature vertices).
+    // Vertex and edge IDs change, and faces keep material, segment, and category of the faces
+    // they were split from.  Returns 1 on success and 0 on error
+
+  // Statistics functions
+  int NSplits(void) const;
+  int NCollapses(void) const;
+  int NSwaps(void) const;
+    // Numbers of edge operations of the last Remesh
+
+public:
+  // Internal functions
+  RNBoolean IsFeatureEdge(const R3MeshEdge *edge) const;
+  int NFeatureEdges(const R3MeshVertex *vertex) const;
+  RNBoolean IsCornerVertex(const R3MeshVertex *vertex) const;
+  int SplitLongEdges(void);
+  int CollapseShortEdges(void);
+  int SwapEdges(void);
+  void RelaxVertices(void);
+  RNBoolean CanCollapseEdge(R3MeshEdge *edge, R3MeshVertex *vertex, const R3Point& position) const;
+  R3Point ProjectVertex(const R3Point& position, RNBoolean feature, RNLength *sizing) const;
+  void InitializeReference(void);
+  void DeleteReference(void);
+  void SetSizing(int vertex_id, RNLength value);
+
+public:
+  // Mesh being remeshed
+  R3Mesh *mesh;
+
+  // Parameters
+  RNLength target_edge_length;
+  RNLength min_edge_length;
+  RNLength approximation_error;
+  RNAngle feature_angle;
+  int niterations;
+  int nthreads;
+
+  // Copy of input mesh for projection, with target edge lengths of its vertices
+  R3Mesh *reference_mesh;
+  R3MeshSearchTree *reference_tree;
+  RNLength *reference_sizing;
+
+  // Feature edges of input mesh (as pairs of reference vertex IDs), found by points sampled on them
+  int *reference_features;
+  int nreference_features;
+  R3Point *reference_feature_samples;
+  int *reference_feature_sample_edges;
+  R3Kdtree<const R3Point *> *reference_feature_kdtree;
+
+  // Target edge lengths of vertices of mesh (indexed by vertex ID)
+  RNLength *sizing;
+  int nsizing_allocated;
+
+  // Statistics
+  int nsplits;
+  int ncollapses;
+  int nswaps;
+};
+
+
+
+// Inline functions
+
+inline R3Mesh *R3MeshRemesher::
+Mesh(void) const
+{
+  // Return mesh
+  return mesh;
+}
+
+
+
+inline RNLength R3MeshRemesher::
+TargetEdgeLength(void) const
+{
+  // Return target edge length
+  return target_edge_length;
+}
+
+
+
+inline RNLength R3MeshRemesher::
+MinEdgeLength(void) const
+{
+  // Return minimum edge length of adaptive remeshing
+  return min_edge_length;
+}
+
+
+
+inline RNLength R3MeshRemesher::
+ApproximationError(void) const
+{
+  // Return approximation error of adaptive remeshing
+  return approximation_error;
+}
+
+
+
+inline RNAngle R3MeshRemesher::
+FeatureAngle(void) const
+{
+  // Return feature angle
+  return feature_angle;
+}
+
+
+
+inline int R3MeshRemesher::
+NIterations(void) const
+{
+  // Return number of iterations
+  return niterations;
+}
+
+
+
+inline int R3MeshRemesher::
+NThreads(void) const
+{
+  // Return number of threads (0 means RNNumberOfThreads())
+  return nthreads;
+}
+
+
+
+inline void R3MeshRemesher::
+SetTargetEdgeLength(RNLength target_edge_length)
+{
+  // Set target edge length
+  this->target_edge_length = target_edge_length;
+}
+
+
+
+inline void R3MeshRemesher::
+SetMinEdgeLength(RNLength min_edge_length)
+{
+  // Set minimum edge length of adaptive remeshing
+  this->min_edge_length = min_edge_length;
+}
+
+
+
+inline void R3MeshRemesher::
+SetApproximationError(RNLength approximation_error)
+{
+  // Set approximation error of adaptive remeshing
+  this->approximation_error = approximation_error;
+}
+
+
+
+inline void R3MeshRemesher::
+SetFeatureAngle(RNAngle feature_angle)
+{
+  // Set feature angle
+  this->feature_angle = feature_angle;
+}
+
+
+
+inline void R3MeshRemesher::
+SetNIterations(int niterations)
+{
+  // Set number of iterations
+  this->niterations = niterations;
+}
+
+
+
+inline void R3MeshRemesher::
+SetNThreads(int nthreads)
+{
+  // Set number of threads
+  this->nthreads = nthreads;
+}
+
+
+
+inline int R3MeshRemesher::
+NSplits(void) const
+{
+  // Return number of edge splits
+  return nsplits;
+}
+
+
+
+inline int R3MeshRemesher::
+NCollapses(void) const
+{
+  // Return number of edge collapses
+  return ncollapses;
+}
+
+
+
+inline int R3MeshRemesher::
+NSwaps(void) const
+{
+  // Return number of edge swaps
+  return nswaps;
+}
+
+
+
@@ -19,6 +19,7 @@
 static const int max_faces_per_node = 128;
 static const RNScalar max_area_ratio = 0.1;
 static const int max_depth = 64;
+static const int max_faces_per_batch = 64;
 
 
 
@@ -546,17 +547,41 @@ FindClosest(const R3Point& query_position, const R3Vector& query_normal, R3MeshI
     }
   }
   else {
-    // Update based on distance to each small face
-    for (int i = 0; i < node->small_faces.NEntries(); i++) {
-      // Get face container and check mark
-      R3MeshSearchTreeFace *face_container = node->small_faces[i];
-      if (face_container->mark == mark) continue;
-      face_container->mark = mark;
+    // Update based on distance to small faces, in batches
+    R3MeshFace *batch_faces[max_faces_per_batch];
+    double batch_coordinates[9][max_faces_per_batch];
+    double batch_distances[max_faces_per_batch];
+    R3TriangleBatch<double> batch;
+    batch.x0 = batch_coordinates[0]; batch.y0 = batch_coordinates[1]; batch.z0 = batch_coordinates[2];
+    batch.x1 = batch_coordinates[3]; batch.y1 = batch_coordinates[4]; batch.z1 = batch_coordinates[5];
+    batch.x2 = batch_coordinates[6]; batch.y2 = batch_coordinates[7]; batch.z2 = batch_coordinates[8];
+    int i = 0;
+    while (i < node->small_faces.NEntries()) {
+      // Gather coordinates of next unmarked faces
+      int nbatch = 0;
+      while ((i < node->small_faces.NEntries()) && (nbatch < max_faces_per_batch)) {
+        R3MeshSearchTreeFace *face_container = node->small_faces[i++];
+        if (face_container->mark == mark) continue;
+        face_container->mark = mark;
+        R3MeshFace *face = face_container->face;
+        for (int k = 0; k < 3; k++) {
+          const R3Point& position = mesh->VertexPosition(mesh->VertexOnFace(face, k));
+          for (int dim = 0; dim < 3; dim++) batch_coordinates[3*k+dim][nbatch] = position[dim];
+        }
+        batch_faces[nbatch++] = face;
+      }
 
-      // Find closest point in mesh face
-      FindClosest(query_position, query_normal, closest, 
-        min_distance_squared, max_distance_squared, 
-        IsCompatible, compatible_data, face_container->face);
+      // Compute distances to all faces in batch
+      if (nbatch == 0) break;
+      R3Distances(query_position, batch, nbatch, batch_distances);
+
+      // Find closest point in faces that may be closer than the current one
+      for (int j = 0; j < nbatch; j++) {
+        if (batch_distances[j] * batch_distances[j] >= max_distance_squared) continue;
+        FindClosest(query_position, query_normal, closest, 
+          min_distance_squared, max_distance_squared, 
+          IsCompatible, compatible_data, batch_faces[j]);
+      }
     }
   }
 }
@@ -0,0 +1,657 @@
+// Source file for mesh slicer class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Contour functions
+////////////////////////////////////////////////////////////////////////
+
+R3MeshSliceContour::
+R3MeshSliceContour(int plane_index, const R3Point *positions, const R2Point *points, int npoints, RNBoolean closed)
+  : plane_index(plane_index),
+    positions(NULL),
+    points(NULL),
+    npoints(npoints),
+    closed(closed),
+    area(0),
+    parent(-1),
+    depth(0)
+{
+  // Copy points
+  this->positions = new R3Point [ npoints ];
+  this->points = new R2Point [ npoints ];
+  for (int i = 0; i < npoints; i++) {
+    this->positions[i] = positions[i];
+    this->points[i] = points[i];
+  }
+
+  // Compute signed area by sum of cross products
+  if (closed) {
+    RNScalar sum = 0;
+    const R2Point *p1 = &points[npoints-1];
+    for (int i = 0; i < npoints; i++) {
+      const R2Point *p2 = &points[i];
+      sum += p1->X()*p2->Y() - p2->X()*p1->Y();
+      p1 = p2;
+    }
+    area = 0.5 * sum;
+  }
+}
+
+
+
+R3MeshSliceContour::
+~R3MeshSliceContour(void)
+{
+  // Delete points
+  if (positions) delete [] positions;
+  if (points) delete [] points;
+}
+
+
+
+R2Polygon R3MeshSliceContour::
+Polygon(void) const
+{
+  // Return polygon in plane coordinates
+  return R2Polygon(points, npoints);
+}
+
+
+
+R3Polyline R3MeshSliceContour::
+Polyline(void) const
+{
+  // Check if open
+  if (!closed) return R3Polyline(positions, npoints);
+
+  // Return polyline with first position repeated at end
+  R3Point *loop_positions = new R3Point [ npoints + 1 ];
+  for (int i = 0; i < npoints; i++) loop_positions[i] = positions[i];
+  loop_positions[npoints] = positions[0];
+  R3Polyline polyline(loop_positions, npoints + 1);
+  delete [] loop_positions;
+  return polyline;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3MeshSlicer::
+R3MeshSlicer(void)
+  : vertex_positions(NULL),
+    nvertices(0),
+    vertex_allocated(0),
+    triangle_vertices(NULL),
+    ntriangles(0),
+    triangle_allocated(0),
+    nthreads(0),
+    normal(0, 0, 1),
+    first_offset(0),
+    spacing(0),
+    nplanes(0),
+    contours(NULL)
+{
+  // Initialize plane axes
+  axes[0] = R3posx_vector;
+  axes[1] = R3posy_vector;
+}
+
+
+
+R3MeshSlicer::
+~R3MeshSlicer(void)
+{
+  // Delete contours
+  EmptyContours();
+
+  // Delete triangles
+  EmptyTriangles();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Input functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+ReserveSlicerArrays(R3Point **vertex_positions, int nvertices, int *vertex_allocated, int nvertices_needed,
+  int **triangle_vertices, int ntriangles, int *triangle_allocated, int ntriangles_needed)
+{
+  // Grow vertex array
+  if (nvertices_needed > *vertex_allocated) {
+    int allocated = 2 * (*vertex_allocated);
+    if (allocated < nvertices_needed) allocated = nvertices_needed;
+    R3Point *positions = new R3Point [ allocated ];
+    for (int i = 0; i < nvertices; i++) positions[i] = (*vertex_positions)[i];
+    if (*vertex_positions) delete [] *vertex_positions;
+    *vertex_positions = positions;
+    *vertex_allocated = allocated;
+  }
+
+  // Grow triangle array
+  if (ntriangles_needed > *triangle_allocated) {
+    int allocated = 2 * (*triangle_allocated);
+    if (allocated < ntriangles_needed) allocated = ntriangles_needed;
+    int *vertices = new int [ 3 * allocated ];
+    for (int i = 0; i < 3 * ntriangles; i++) vertices[i] = (*triangle_vertices)[i];
+    if (*triangle_vertices) delete [] *triangle_vertices;
+    *triangle_vertices = vertices;
+    *triangle_allocated = allocated;
+  }
+}
+
+
+
+int R3MeshSlicer::
+InsertMesh(R3Mesh *mesh)
+{
+  // Allocate space
+  ReserveSlicerArrays(&vertex_positions, nvertices, &vertex_allocated, nvertices + mesh->NVertices(),
+    &triangle_vertices, ntriangles, &triangle_allocated, ntriangles + mesh->NFaces());
+
+  // Copy vertices
+  int first_vertex = nvertices;
+  for (int i = 0; i < mesh->NVertices(); i++) {
+    R3MeshVertex *vertex = mesh->Vertex(i);
+    vertex_positions[nvertices++] = mesh->VertexPosition(vertex);
+  }
+
+  // Copy faces
+  for (int i = 0; i < mesh->NFaces(); i++) {
+    R3MeshFace *face = mesh->Face(i);
+    int *v = &triangle_vertices[3 * ntriangles++];
+    for (int k = 0; k < 3; k++) v[k] = first_vertex + mesh->VertexID(mesh->VertexOnFace(face, k));
+  }
+
+  // Return number of triangles inserted
+  return mesh->NFaces();
+}
+
+
+
+int R3MeshSlicer::
+InsertTriangles(R3TriangleArray *triangles, const R3Transformation *transformation)
+{
+  // Allocate space
+  ReserveSlicerArrays(&vertex_positions, nvertices, &vertex_allocated, nvertices + triangles->NVertices(),
+    &triangle_vertices, ntriangles, &triangle_allocated, ntriangles + triangles->NTriangles());
+
+  // Copy vertices (remembering their indices in marks)
+  int first_vertex = nvertices;
+  for (int i = 0; i < triangles->NVertices(); i++) {
+    R3TriangleVertex *vertex = triangles->Vertex(i);
+    R3Point position = vertex->Position();
+    if (transformation) transformation->Apply(position);
+    vertex_positions[nvertices++] = position;
+    vertex->SetMark(i);
+  }
+
+  // Copy triangles (reversing mirrored ones to keep outward orientation)
+  RNBoolean mirrored = (transformation) ? transformation->IsMirrored() : FALSE;
+  for (int i = 0; i < triangles->NTriangles(); i++) {
+    R3Triangle *triangle = triangles->Triangle(i);
+    int *v = &triangle_vertices[3 * ntriangles++];
+    for (int k = 0; k < 3; k++) {
+      R3TriangleVertex *vertex = triangle->Vertex((mirrored) ? 2 - k : k);
+      v[k] = first_vertex + vertex->Mark();
+    }
+  }
+
+  // Return number of triangles inserted
+  return triangles->NTriangles();
+}
+
+
+
+void R3MeshSlicer::
+EmptyTriangles(void)
+{
+  // Delete vertices and triangles
+  if (vertex_positions) { delete [] vertex_positions; vertex_positions = NULL; }
+  if (triangle_vertices) { delete [] triangle_vertices; triangle_vertices = NULL; }
+  nvertices = vertex_allocated = 0;
+  ntriangles = triangle_allocated = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Slicing functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3MeshSlicerData {
+  R3MeshSlicer *slicer;
+  const RNScalar *heights;
+  const int *plane_starts;
+  const int *plane_triangles;
+};
+
+
+
+static void
+SliceMeshPlane(int plane_index, int thread_index, void *data)
+{
+  // Compute contours on one plane
+  R3MeshSlicerData *slicer_data = (R3MeshSlicerData *) data;
+  int start = slicer_data->plane_starts[plane_index];
+  int end = slicer_data->plane_starts[plane_index+1];
+  slicer_data->slicer->SlicePlane(plane_index, slicer_data->heights, &slicer_data->plane_triangles[start], end - start);
+  slicer_data->slicer->ComputeHierarchy(plane_index);
+}
+
+
+
+int R3MeshSlicer::
+Slice(const R3Plane& plane, RNLength spacing, int nplanes)
+{
+  // Delete previous contours
+  EmptyContours();
+
+  // Check parameters
+  RNLength normal_length = plane.Normal().Length();
+  if (RNIsZero(normal_length)) {
+    fprintf(stderr, "Invalid slicing plane normal\n");
+    return -1;
+  }
+  if ((nplanes > 1) && (spacing <= 0)) {
+    fprintf(stderr, "Invalid slicing plane spacing: %g\n", spacing);
+    return -1;
+  }
+  if (nplanes < 0) nplanes = 0;
+
+  // Set planes (offsets are along the unit normal)
+  this->normal = plane.Normal() / normal_length;
+  this->first_offset = -plane.D() / normal_length;
+  this->spacing = spacing;
+  this->nplanes = nplanes;
+
+  // Compute plane axes, starting from the world axis least aligned
+  // with the normal (so that horizontal planes have x and y axes)
+  int dim = 0;
+  for (int i = 1; i < 3; i++) {
+    if (fabs(normal[i]) < fabs(normal[dim])) dim = i;
+  }
+  R3Vector axis = R3xyz_triad[dim];
+  axes[0] = axis - axis.Dot(normal) * normal;
+  axes[0].Normalize();
+  axes[1] = normal % axes[0];
+  axes[1].Normalize();
+
+  // Allocate contours
+  if (nplanes == 0) return 0;
+  contours = new RNArray<R3MeshSliceContour *> [ nplanes ];
+
+  // Compute heights of vertices along normal
+  RNScalar *heights = new RNScalar [ nvertices ];
+  for (int i = 0; i < nvertices; i++) {
+    heights[i] = normal.Dot(vertex_positions[i].Vector());
+  }
+
+  // Sweep triangles into the planes between their lowest and highest vertices
+  // (a triangle crosses plane k if its lowest vertex is below and its highest is not)
+  int *plane_starts = new int [ nplanes + 1 ];
+  for (int k = 0; k <= nplanes; k++) plane_starts[k] = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    int *plane_triangles = (pass == 1) ? new int [ plane_starts[nplanes] ] : NULL;
+    int *plane_counts = (pass == 1) ? new int [ nplanes ] : NULL;
+    if (pass == 1) for (int k = 0; k < nplanes; k++) plane_counts[k] = 0;
+    for (int i = 0; i < ntriangles; i++) {
+      const int *v = &triangle_vertices[3*i];
+      RNScalar hmin = heights[v[0]], hmax = heights[v[0]];
+      for (int j = 1; j < 3; j++) {
+        if (heights[v[j]] < hmin) hmin = heights[v[j]];
+        if (heights[v[j]] > hmax) hmax = heights[v[j]];
+      }
+      if (hmin == hmax) continue;
+      int k = (spacing > 0) ? (int) floor((hmin - first_offset) / spacing) - 1 : 0;
+      if (k < 0) k = 0;
+      while ((k < nplanes) && (first_offset + k * spacing <= hmin)) k++;
+      for ( ; (k < nplanes) && (first_offset + k * spacing <= hmax); k++) {
+        if (pass == 0) plane_starts[k+1]++;
+        else plane_triangles[plane_starts[k] + plane_counts[k]++] = i;
+        if (spacing <= 0) break;
+      }
+    }
+
+    // Compute starts of planes from counts
+    if (pass == 0) {
+      for (int k = 0; k < nplanes; k++) plane_starts[k+1] += plane_starts[k];
+    }
+    else {
+      // Slice planes in parallel
+      R3MeshSlicerData data;
+      data.slicer = this;
+      data.heights = heights;
+      data.plane_starts = plane_starts;
+      data.plane_triangles = plane_triangles;
+      RNParallelFor(nplanes, SliceMeshPlane, &data, nthreads);
+      delete [] plane_triangles;
+      delete [] plane_counts;
+    }
+  }
+
+  // Delete temporary memory
+  delete [] plane_starts;
+  delete [] heights;
+
+  // Return number of contours
+  int ncontours = 0;
+  for (int k = 0; k < nplanes; k++) ncontours += contours[k].NEntries();
+  return ncontours;
+}
+
+
+
+int R3MeshSlicer::
+Slice(const R3Vector& normal, RNLength spacing)
+{
+  // Check parameters
+  RNLength normal_length = normal.Length();
+  if (RNIsZero(normal_length) || (spacing <= 0)) {
+    fprintf(stderr, "Invalid slicing normal or spacing\n");
+    return -1;
+  }
+
+  // Compute range of heights
+  R3Vector direction = normal / normal_length;
+  RNInterval range = RNnull_interval;
+  for (int i = 0; i < nvertices; i++) {
+    range.Union(direction.Dot(vertex_positions[i].Vector()));
+  }
+
+  // Slice at multiples of spacing within range
+  int kmin = 0, kmax = -1;
+  if (!range.IsEmpty()) {
+    kmin = (int) ceil(range.Min() / spacing);
+    kmax = (int) floor(range.Max() / spacing);
+  }
+  return Slice(R3Plane(direction, -kmin * spacing), spacing, kmax - kmin + 1);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Result functions
+////////////////////////////////////////////////////////////////////////
+
+R3CoordSystem R3MeshSlicer::
+PlaneCoordSystem(int plane_index) const
+{
+  // Return coordinate system with origin at closest point of plane to world origin
+  R3Point origin = R3zero_point + (first_offset + plane_index * spacing) * normal;
+  return R3CoordSystem(origin, R3Triad(axes[0], axes[1], normal));
+}
+
+
+
+void R3MeshSlicer::
+EmptyContours(void)
+{
+  // Delete contours
+  if (contours) {
+    for (int k = 0; k < nplanes; k++) {
+      for (int i = 0; i < contours[k].NEntries(); i++) delete contours[k].Kth(i);
+    }
+    delete [] contours;
+    contours = NULL;
+  }
+
+  // Reset planes
+  nplanes = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Internal functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3MeshSliceSegment {
+  long long start_key;
+  long long end_key;
+  R3Point start_position;
+  R3Point end_position;
+};
+
+
+
+static int
+CompareSliceSegments(const void *data1, const void *data2)
+{
+  const R3MeshSliceSegment *segment1 = (const R3MeshSliceSegment *) data1;
+  const R3MeshSliceSegment *segment2 = (const R3MeshSliceSegment *) data2;
+  if (segment1->start_key < segment2->start_key) return -1;
+  else if (segment1->start_key > segment2->start_key) return 1;
+  else return 0;
+}
+
+
+
+static int
+CompareSliceKeys(const void *data1, const void *data2)
+{
+  long long key1 = *((const long long *) data1);
+  long long key2 = *((const long long *) data2);
+  if (key1 < key2) return -1;
+  else if (key1 > key2) return 1;
+  else return 0;
+}
+
+
+
+static int
+FindSliceSegment(const R3MeshSliceSegment *segments, const RNBoolean *used, int nsegments, long long key)
+{
+  // Find first segment starting with key
+  int low = 0, high = nsegments;
+  while (low < high) {
+    int mid = (low + high) / 2;
+    if (segments[mid].start_key < key) low = mid + 1;
+    else high = mid;
+  }
+
+  // Return first unused one
+  for (int i = low; (i < nsegments) && (segments[i].start_key == key); i++) {
+    if (!used[i]) return i;
+  }
+
+  // Not found
+  return -1;
+}
+
+
+
+void R3MeshSlicer::
+SlicePlane(int plane_index, const RNScalar *heights, const int *plane_triangles, int nplane_triangles)
+{
+  // Check triangles
+  if (nplane_triangles == 0) return;
+
+  // Compute one segment per triangle, directed so that the
+  // inside of the mesh (behind its faces) is on the left
+  RNScalar offset = first_offset + plane_index * spacing;
+  R3MeshSliceSegment *segments = new R3MeshSliceSegment [ nplane_triangles ];
+  int nsegments = 0;
+  for (int i = 0; i < nplane_triangles; i++) {
+    const int *v = &triangle_vertices[3 * plane_triangles[i]];
+    R3MeshSliceSegment& segment = segments[nsegments];
+    int found = 0;
+    for (int j = 0; j < 3; j++) {
+      int v1 = v[j], v2 = v[(j+1)%3];
+      RNBoolean above1 = (heights[v1] >= offset);
+      RNBoolean above2 = (heights[v2] >= offset);
+      if (above1 == above2) continue;
+
+      // Compute crossing on edge (from the smaller vertex index, so that both faces agree exactly)
+      int vlow = (v1 < v2) ? v1 : v2;
+      int vhigh = (v1 < v2) ? v2 : v1;
+      RNScalar t = (offset - heights[vlow]) / (heights[vhigh] - heights[vlow]);
+      const R3Point& p1 = vertex_positions[vlow];
+      const R3Point& p2 = vertex_positions[vhigh];
+      R3Point position = p1 + t * (p2 - p1);
+      long long key = (long long) vlow * nvertices + vhigh;
+
+      // Segments start where the boundary goes down through the plane
+      if (above1) { segment.start_key = key; segment.start_position = position; }
+      else { segment.end_key = key; segment.end_position = position; }
+      found++;
+    }
+    if (found == 2) nsegments++;
+  }
+
+  // Sort segments by start edge, and end edges for finding chain starts
+  qsort(segments, nsegments, sizeof(R3MeshSliceSegment), CompareSliceSegments);
+  long long *end_keys = new long long [ nsegments ];
+  for (int i = 0; i < nsegments; i++) end_keys[i] = segments[i].end_key;
+  qsort(end_keys, nsegments, sizeof(long long), CompareSliceKeys);
+
+  // Chain segments into contours (first ones starting at boundaries of open meshes, then loops)
+  RNBoolean *used = new RNBoolean [ nsegments ];
+  for (int i = 0; i < nsegments; i++) used[i] = FALSE;
+  R3Point *positions = new R3Point [ nsegments + 1 ];
+  R2Point *points = new R2Point [ nsegments + 1 ];
+  for (int pass = 0; pass < 2; pass++) {
+    for (int first = 0; first < nsegments; first++) {
+      if (used[first]) continue;
+      if ((pass == 0) && bsearch(&segments[first].start_key, end_keys, nsegments, sizeof(long long), CompareSliceKeys)) continue;
+
+      // Trace chain
+      int npositions = 0;
+      int current = first;
+      while (current >= 0) {
+        used[current] = TRUE;
+        const R3Point& position = segments[current].start_position;
+        if ((npositions == 0) || (position != positions[npositions-1])) positions[npositions++] = position;
+        int next = FindSliceSegment(segments, used, nsegments, segments[current].end_key);
+        if (next < 0) break;
+        current = next;
+      }
+
+      // Close or end chain
+      RNBoolean closed = (segments[current].end_key == segments[first].start_key);
+      if (closed) {
+        if ((npositions > 1) && (positions[npositions-1] == positions[0])) npositions--;
+        if (npositions < 3) continue;
+      }
+      else {
+        const R3Point& position = segments[current].end_position;
+        if (position != positions[npositions-1]) positions[npositions++] = position;
+        if (npositions < 2) continue;
+      }
+
+      // Compute plane coordinates
+      for (int i = 0; i < npositions; i++) {
+        const R3Vector& vector = positions[i].Vector();
+        points[i].Reset(axes[0].Dot(vector), axes[1].Dot(vector));
+      }
+
+      // Create contour
+      R3MeshSliceContour *contour = new R3MeshSliceContour(plane_index, positions, points, npositions, closed);
+      contours[plane_index].Insert(contour);
+    }
+  }
+
+  // Delete temporary memory
+  delete [] segments;
+  delete [] end_keys;
+  delete [] used;
+  delete [] positions;
+  delete [] points;
+}
+
+
+
+static RNBoolean
+SliceContourContains(const R3MeshSliceContour *contour, const R2Point& point)
+{
+  // Count crossings of ray in positive x direction
+  RNBoolean inside = FALSE;
+  const R2Point *p1 = &contour->points[contour->npoints-1];
+  for (int i = 0; i < contour->npoints; i++) {
+    const R2Point *p2 = &contour->points[i];
+    if ((p1->Y() > point.Y()) != (p2->Y() > point.Y())) {
+      RNCoord x = p1->X() + (point.Y() - p1->Y()) * (p2->X() - p1->X()) / (p2->Y() - p1->Y());
+      if (point.X() < x) inside = !inside;
+    }
+    p1 = p2;
+  }
+  return inside;
+}
+
+
+
+static int
+CompareSliceContourAreas(const void *data1, const void *data2)
+{
+  const R3MeshSliceContour *contour1 = *((const R3MeshSliceContour **) data1);
+  const R3MeshSliceContour *contour2 = *((const R3MeshSliceContour **) data2);
+  RNArea area1 = fabs(contour1->area);
+  RNArea area2 = fabs(contour2->area);
+  if (area1 < area2) return -1;
+  else if (area1 > area2) return 1;
+  else return 0;
+}
+
+
+
+void R3MeshSlicer::
+ComputeHierarchy(int plane_index)
+{
+  // Get closed contours sorted by increasing absolute area
+  RNArray<R3MeshSliceContour *>& plane_contours = contours[plane_index];
+  RNArray<R3MeshSliceContour *> closed_contours;
+  for (int i = 0; i < plane_contours.NEntries(); i++) {
+    R3MeshSliceContour *contour = plane_contours.Kth(i);
+    if (contour->closed) closed_contours.Insert(contour);
+  }
+  if (closed_contours.NEntries() < 2) return;
+  closed_contours.Sort(CompareSliceContourAreas);
+
+  // Compute bounding boxes
+  int ncontours = closed_contours.NEntries();
+  R2Box *boxes = new R2Box [ ncontours ];
+  for (int i = 0; i < ncontours; i++) {
+    R3MeshSliceContour *contour = closed_contours.Kth(i);
+    boxes[i] = R2null_box;
+    for (int j = 0; j < contour->npoints; j++) boxes[i].Union(contour->points[j]);
+  }
+
+  // Find smallest larger contour containing each contour
+  for (int i = 0; i < ncontours; i++) {
+    R3MeshSliceContour *contour = closed_contours.Kth(i);
+    const R2Point& point = contour->points[0];
+    for (int j = i+1; j < ncontours; j++) {
+      R3MeshSliceContour *container = closed_contours.Kth(j);
+      if (!R2Contains(boxes[j], boxes[i])) continue;
+      if (!SliceContourContains(container, point)) continue;
+      contour->parent = plane_contours.EntryIndex(plane_contours.FindEntry(container));
+      break;
+    }
+  }
+
+  // Compute depths (containers first)
+  for (int i = ncontours-1; i >= 0; i--) {
+    R3MeshSliceContour *contour = closed_contours.Kth(i);
+    if (contour->parent < 0) continue;
+    contour->depth = plane_contours.Kth(contour->parent)->depth + 1;
+  }
+
+  // Delete temporary memory
+  delete [] boxes;
+}
+
+
+
@@ -0,0 +1,268 @@
+// Include file for mesh slicer class
+
+
+
+// Contour definition
+
+class R3MeshSliceContour {
+public:
+  // Constructors/destructors
+  R3MeshSliceContour(int plane_index, const R3Point *positions, const R2Point *points, int npoints, RNBoolean closed);
+  ~R3MeshSliceContour(void);
+
+  // Property functions
+  int PlaneIndex(void) const;
+  RNBoolean IsClosed(void) const;
+  RNArea Area(void) const;
+    // Signed area in plane coordinates, positive for outer boundaries (counterclockwise
+    // seen from the positive side of the plane) and negative for holes (0 if not closed)
+  int Parent(void) const;
+    // Index of the smallest closed contour of the same plane that contains this one (-1 if none)
+  int Depth(void) const;
+    // Number of closed contours of the same plane that contain this one
+
+  // Point access functions
+  int NPoints(void) const;
+  const R2Point& Point(int k) const;
+    // Position in the coordinate system of the plane
+  const R3Point& Position(int k) const;
+    // Position in world coordinates
+
+  // Shape functions
+  R2Polygon Polygon(void) const;
+  R3Polyline Polyline(void) const;
+    // Closed contours repeat their first position at the end
+
+public:
+  // Data fields
+  int plane_index;
+  R3Point *positions;
+  R2Point *points;
+  int npoints;
+  RNBoolean closed;
+  RNArea area;
+  int parent;
+  int depth;
+};
+
+
+
+// Class definition
+
+class R3MeshSlicer {
+public:
+  // Constructors/destructors
+  R3MeshSlicer(void);
+  ~R3MeshSlicer(void);
+
+  // Input functions
+  int InsertMesh(R3Mesh *mesh);
+  int InsertTriangles(R3TriangleArray *triangles, const R3Transformation *transformation = NULL);
+    // Inserts triangles (with transformation into world coordinates), returns number of triangles inserted,
+    // slices are traced across shared vertices, so coincident vertices should be merged beforehand
+  void EmptyTriangles(void);
+
+  // Input property functions
+  int NTriangles(void) const;
+  int NVertices(void) const;
+
+  // Parameter functions
+  int NThreads(void) const;
+  void SetNThreads(int nthreads);
+
+  // Slicing functions
+  int Slice(const R3Plane& plane, RNLength spacing, int nplanes);
+    // Slices with nplanes planes parallel to plane, each offset by spacing along the plane normal from the previous one,
+    // returns total number of contours or -1 on failure
+  int Slice(const R3Vector& normal, RNLength spacing);
+    // Slices with planes perpendicular to normal at every multiple of spacing within the bounding box of the triangles
+
+  // Result access functions
+  int NPlanes(void) const;
+  R3Plane Plane(int plane_index) const;
+  R3CoordSystem PlaneCoordSystem(int plane_index) const;
+    // Plane coordinates of contour points are along the x and y axes, the z axis is the plane normal
+  int NContours(int plane_index) const;
+  R3MeshSliceContour *Contour(int plane_index, int k) const;
+  void EmptyContours(void);
+
+public:
+  // Internal functions
+  void SlicePlane(int plane_index, const RNScalar *heights, const int *plane_triangles, int nplane_triangles);
+  void ComputeHierarchy(int plane_index);
+
+public:
+  // Triangles
+  R3Point *vertex_positions;
+  int nvertices;
+  int vertex_allocated;
+  int *triangle_vertices;
+  int ntriangles;
+  int triangle_allocated;
+
+  // Parameters
+  int nthreads;
+
+  // Planes
+  R3Vector normal;
+  R3Vector axes[2];
+  RNScalar first_offset;
+  RNLength spacing;
+  int nplanes;
+
+  // Contours
+  RNArray<R3MeshSliceContour *> *contours;
+};
+
+
+
+// Inline functions
+
+inline int R3MeshSliceContour::
+PlaneIndex(void) const
+{
+  // Return index of plane
+  return plane_index;
+}
+
+
+
+inline RNBoolean R3MeshSliceContour::
+IsClosed(void) const
+{
+  // Return whether contour is a closed loop
+  return closed;
+}
+
+
+
+inline RNArea R3MeshSliceContour::
+Area(void) const
+{
+  // Return signed area
+  return area;
+}
+
+
+
+inline int R3MeshSliceContour::
+Parent(void) const
+{
+  // Return index of containing contour
+  return parent;
+}
+
+
+
+inline int R3MeshSliceContour::
+Depth(void) const
+{
+  // Return nesting depth
+  return depth;
+}
+
+
+
+inline int R3MeshSliceContour::
+NPoints(void) const
+{
+  // Return number of points
+  return npoints;
+}
+
+
+
+inline const R2Point& R3MeshSliceContour::
+Point(int k) const
+{
+  // Return kth point in plane coordinates
+  assert((0 <= k) && (k < npoints));
+  return points[k];
+}
+
+
+
+inline const R3Point& R3MeshSliceContour::
+Position(int k) const
+{
+  // Return kth point in world coordinates
+  assert((0 <= k) && (k < npoints));
+  return positions[k];
+}
+
+
+
+inline int R3MeshSlicer::
+NTriangles(void) const
+{
+  // Return number of triangles
+  return ntriangles;
+}
+
+
+
+inline int R3MeshSlicer::
+NVertices(void) const
+{
+  // Return number of vertices
+  return nvertices;
+}
+
+
+
+inline int R3MeshSlicer::
+NThreads(void) const
+{
+  // Return number of threads used for slicing
+  return nthreads;
+}
+
+
+
+inline void R3MeshSlicer::
+SetNThreads(int nthreads)
+{
+  // Set number of threads used for slicing
+  this->nthreads = nthreads;
+}
+
+
+
+inline int R3MeshSlicer::
+NPlanes(void) const
+{
+  // Return number of planes
+  return nplanes;
+}
+
+
+
+inline R3Plane R3MeshSlicer::
+Plane(int plane_index) const
+{
+  // Return plane
+  return R3Plane(normal, -(first_offset + plane_index * spacing));
+}
+
+
+
+inline int R3MeshSlicer::
+NContours(int plane_index) const
+{
+  // Return number of contours on plane
+  assert((0 <= plane_index) && (plane_index < nplanes));
+  return contours[plane_index].NEntries();
+}
+
+
+
+inline R3MeshSliceContour *R3MeshSlicer::
+Contour(int plane_index, int k) const
+{
+  // Return kth contour on plane
+  assert((0 <= plane_index) && (plane_index < nplanes));
+  return contours[plane_index].Kth(k);
+}
+
+
+
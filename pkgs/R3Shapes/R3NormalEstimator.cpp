@@ -0,0 +1,775 @@
+// Source file for point normal estimation class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Parameters
+////////////////////////////////////////////////////////////////////////
+
+// Maximum number of neighbors of a point in the graph used for MST orientation
+static const int max_graph_neighbors = 8;
+
+// Maximum number of points in a leaf of the hierarchy used to join graph components
+static const int max_points_per_leaf = 8;
+
+// Tukey biweight constant (in units of the residual scale) for robust plane fits
+// (smaller than the usual 4.685, so that neighborhoods across creases pick one side)
+static const RNScalar tukey_constant = 3.0;
+
+// Number of points processed by every parallel task
+static const int chunk_size = 256;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3NormalEstimator::
+R3NormalEstimator(int npoints, const R3Point *points)
+  : npoints(npoints),
+    points(points),
+    kdtree(NULL),
+    max_neighbors(16),
+    max_distance(0),
+    nrobust_iterations(0),
+    orientation_method(R3_NORMAL_MST_ORIENTATION),
+    viewpoint(0, 0, 0),
+    viewpoints(NULL),
+    selected(NULL),
+    nthreads(0),
+    ncomponents(0)
+{
+  // Build kdtree for points
+  if (npoints > 0) {
+    RNArray<const R3Point *> array;
+    for (int i = 0; i < npoints; i++) array.Insert(&points[i]);
+    kdtree = new R3Kdtree<const R3Point *>(array);
+  }
+}
+
+
+
+R3NormalEstimator::
+~R3NormalEstimator(void)
+{
+  // Delete kdtree
+  if (kdtree) delete kdtree;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Plane fitting functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+DiagonalizeCovariance(RNScalar a[3][3], RNScalar eigenvalues[3], R3Vector eigenvectors[3])
+{
+  // Initialize rotation
+  RNScalar v[3][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } };
+
+  // Apply Jacobi rotations until off-diagonal entries vanish
+  for (int sweep = 0; sweep < 32; sweep++) {
+    RNScalar off = a[0][1]*a[0][1] + a[0][2]*a[0][2] + a[1][2]*a[1][2];
+    RNScalar diagonal = a[0][0]*a[0][0] + a[1][1]*a[1][1] + a[2][2]*a[2][2];
+    if (off <= 1.0E-30 * diagonal) break;
+    for (int p = 0; p < 2; p++) {
+      for (int q = p+1; q < 3; q++) {
+        if (a[p][q] == 0) continue;
+        RNScalar theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+        RNScalar t = 1.0 / (fabs(theta) + sqrt(theta*theta + 1));
+        if (theta < 0) t = -t;
+        RNScalar c = 1.0 / sqrt(t*t + 1);
+        RNScalar s = t * c;
+        for (int k = 0; k < 3; k++) {
+          RNScalar akp = a[k][p], akq = a[k][q];
+          a[k][p] = c*akp - s*akq;
+          a[k][q] = s*akp + c*akq;
+        }
+        for (int k = 0; k < 3; k++) {
+          RNScalar apk = a[p][k], aqk = a[q][k];
+          a[p][k] = c*apk - s*aqk;
+          a[q][k] = s*apk + c*aqk;
+        }
+        for (int k = 0; k < 3; k++) {
+          RNScalar vkp = v[k][p], vkq = v[k][q];
+          v[k][p] = c*vkp - s*vkq;
+          v[k][q] = s*vkp + c*vkq;
+        }
+      }
+    }
+  }
+
+  // Sort eigenvalues in increasing order (eigenvectors are columns of v)
+  int order[3] = { 0, 1, 2 };
+  for (int i = 0; i < 2; i++) {
+    for (int j = i+1; j < 3; j++) {
+      if (a[order[j]][order[j]] < a[order[i]][order[i]]) {
+        int swap = order[i]; order[i] = order[j]; order[j] = swap;
+      }
+    }
+  }
+
+  // Fill results
+  for (int i = 0; i < 3; i++) {
+    int k = order[i];
+    eigenvalues[i] = (a[k][k] > 0) ? a[k][k] : 0;
+    eigenvectors[i].Reset(v[0][k], v[1][k], v[2][k]);
+  }
+}
+
+
+
+static RNBoolean
+FitPlane(const RNArray<const R3Point *>& neighbors, const RNScalar *weights,
+  R3Point& centroid, R3Vector& normal, RNScalar eigenvalues[3])
+{
+  // Compute weighted centroid
+  RNScalar total_weight = 0;
+  RNScalar sum[3] = { 0, 0, 0 };
+  for (int i = 0; i < neighbors.NEntries(); i++) {
+    const R3Point *position = neighbors.Kth(i);
+    RNScalar w = (weights) ? weights[i] : 1.0;
+    sum[0] += w * position->X();
+    sum[1] += w * position->Y();
+    sum[2] += w * position->Z();
+    total_weight += w;
+  }
+  if (total_weight <= 0) return FALSE;
+  centroid.Reset(sum[0] / total_weight, sum[1] / total_weight, sum[2] / total_weight);
+
+  // Compute weighted covariance
+  RNScalar m[3][3] = { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } };
+  for (int i = 0; i < neighbors.NEntries(); i++) {
+    RNScalar w = (weights) ? weights[i] : 1.0;
+    if (w == 0) continue;
+    R3Vector d = *(neighbors.Kth(i)) - centroid;
+    for (int j = 0; j < 3; j++) {
+      for (int k = j; k < 3; k++) {
+        m[j][k] += w * d[j] * d[k];
+      }
+    }
+  }
+  for (int j = 0; j < 3; j++) {
+    for (int k = j; k < 3; k++) {
+      m[j][k] /= total_weight;
+      m[k][j] = m[j][k];
+    }
+  }
+
+  // Normal is eigenvector of smallest eigenvalue
+  R3Vector eigenvectors[3];
+  DiagonalizeCovariance(m, eigenvalues, eigenvectors);
+  if (eigenvalues[1] <= 0) return FALSE;
+  normal = eigenvectors[0];
+  normal.Normalize();
+
+  // Return success
+  return TRUE;
+}
+
+
+
+static int
+CompareResiduals(const void *data1, const void *data2)
+{
+  // Compare residuals for qsort
+  RNScalar r1 = *((const RNScalar *) data1);
+  RNScalar r2 = *((const RNScalar *) data2);
+  if (r1 < r2) return -1;
+  else if (r1 > r2) return 1;
+  else return 0;
+}
+
+
+
+static RNBoolean
+UpdateRobustWeights(const RNArray<const R3Point *>& neighbors,
+  const R3Point& centroid, const R3Vector& normal,
+  RNScalar *weights, RNScalar *residuals)
+{
+  // Compute residuals
+  int n = neighbors.NEntries();
+  for (int i = 0; i < n; i++) {
+    R3Vector d = *(neighbors.Kth(i)) - centroid;
+    weights[i] = fabs(normal.Dot(d));
+    residuals[i] = weights[i];
+  }
+
+  // Estimate residual scale from median residual
+  qsort(residuals, n, sizeof(RNScalar), CompareResiduals);
+  RNScalar scale = 1.4826 * residuals[n/2];
+  if (scale <= 0) return FALSE;
+
+  // Compute Tukey biweights
+  int count = 0;
+  RNScalar c = tukey_constant * scale;
+  for (int i = 0; i < n; i++) {
+    RNScalar u = weights[i] / c;
+    if (u < 1) { weights[i] = (1 - u*u) * (1 - u*u); count++; }
+    else weights[i] = 0;
+  }
+
+  // Return whether enough neighbors remain for a plane fit
+  return (count >= 3) ? TRUE : FALSE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Estimation functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3NormalEstimatorData {
+  const R3NormalEstimator *estimator;
+  R3Vector *normals;
+  RNScalar *curvatures;
+  RNScalar *planarities;
+  int *graph_neighbors;
+};
+
+
+
+static void
+EstimateNormal(int index, int, void *data)
+{
+  // Get convenient variables
+  R3NormalEstimatorData *loop = (R3NormalEstimatorData *) data;
+  const R3NormalEstimator *estimator = loop->estimator;
+  const R3Point& position = estimator->points[index];
+  RNLength max_distance = (estimator->max_distance > 0) ? estimator->max_distance : FLT_MAX;
+  loop->normals[index] = R3zero_vector;
+  if (loop->curvatures) loop->curvatures[index] = 0;
+  if (loop->planarities) loop->planarities[index] = 0;
+
+  // Check if point is selected
+  if (estimator->selected && !estimator->selected[index]) {
+    if (loop->graph_neighbors) {
+      int *graph_neighbors = &loop->graph_neighbors[index * max_graph_neighbors];
+      for (int i = 0; i < max_graph_neighbors; i++) graph_neighbors[i] = -1;
+    }
+    return;
+  }
+
+  // Find neighbors (sorted by distance if number is limited)
+  RNArray<const R3Point *> neighbors;
+  if (estimator->max_neighbors > 0) {
+    estimator->kdtree->FindClosest(position, 0, max_distance, estimator->max_neighbors, neighbors);
+  }
+  else {
+    estimator->kdtree->FindAll(position, 0, max_distance, neighbors);
+  }
+
+  // Remember closest other neighbors for orientation graph
+  if (loop->graph_neighbors) {
+    int *graph_neighbors = &loop->graph_neighbors[index * max_graph_neighbors];
+    RNLength graph_distances[max_graph_neighbors];
+    int ngraph_neighbors = 0;
+    for (int i = 0; i < neighbors.NEntries(); i++) {
+      int neighbor_index = neighbors.Kth(i) - estimator->points;
+      if (neighbor_index == index) continue;
+      RNLength d = R3SquaredDistance(position, *(neighbors.Kth(i)));
+      int slot = ngraph_neighbors;
+      while ((slot > 0) && (graph_distances[slot-1] > d)) slot--;
+      if (slot >= max_graph_neighbors) continue;
+      int last = (ngraph_neighbors < max_graph_neighbors) ? ngraph_neighbors++ : max_graph_neighbors - 1;
+      for (int j = last; j > slot; j--) {
+        graph_neighbors[j] = graph_neighbors[j-1];
+        graph_distances[j] = graph_distances[j-1];
+      }
+      graph_neighbors[slot] = neighbor_index;
+      graph_distances[slot] = d;
+    }
+    for (int i = ngraph_neighbors; i < max_graph_neighbors; i++) graph_neighbors[i] = -1;
+  }
+
+  // Check number of neighbors
+  int n = neighbors.NEntries();
+  if (n < 3) return;
+
+  // Fit plane
+  R3Point centroid;
+  R3Vector normal;
+  RNScalar eigenvalues[3];
+  if (!FitPlane(neighbors, NULL, centroid, normal, eigenvalues)) return;
+
+  // Refit plane with neighbors weighted by residuals
+  if (estimator->nrobust_iterations > 0) {
+    RNScalar *weights = new RNScalar [ 2 * n ];
+    RNScalar *residuals = weights + n;
+    for (int iteration = 0; iteration < estimator->nrobust_iterations; iteration++) {
+      if (!UpdateRobustWeights(neighbors, centroid, normal, weights, residuals)) break;
+      R3Point robust_centroid;
+      R3Vector robust_normal;
+      RNScalar robust_eigenvalues[3];
+      if (!FitPlane(neighbors, weights, robust_centroid, robust_normal, robust_eigenvalues)) break;
+      centroid = robust_centroid;
+      normal = robust_normal;
+      for (int i = 0; i < 3; i++) eigenvalues[i] = robust_eigenvalues[i];
+    }
+    delete [] weights;
+  }
+
+  // Orient normal towards viewpoint
+  if (estimator->orientation_method == R3_NORMAL_VIEWPOINT_ORIENTATION) {
+    const R3Point& origin = (estimator->viewpoints) ? estimator->viewpoints[index] : estimator->viewpoint;
+    if (normal.Dot(origin - position) < 0) normal.Flip();
+  }
+
+  // Fill results
+  loop->normals[index] = normal;
+  RNScalar sum = eigenvalues[0] + eigenvalues[1] + eigenvalues[2];
+  if (loop->curvatures) loop->curvatures[index] = eigenvalues[0] / sum;
+  if (loop->planarities) loop->planarities[index] = (eigenvalues[1] - eigenvalues[0]) / eigenvalues[2];
+}
+
+
+
+int R3NormalEstimator::
+Compute(R3Vector *normals, RNScalar *curvatures, RNScalar *planarities)
+{
+  // Check parameters
+  ncomponents = 0;
+  if (npoints == 0) return 0;
+  if ((max_neighbors <= 0) && (max_distance <= 0)) {
+    fprintf(stderr, "Normal estimation needs a maximum number of neighbors or a maximum distance\n");
+    return -1;
+  }
+
+  // Allocate orientation graph
+  int *graph_neighbors = NULL;
+  if (orientation_method == R3_NORMAL_MST_ORIENTATION) {
+    graph_neighbors = new int [ npoints * max_graph_neighbors ];
+    if (!graph_neighbors) {
+      fprintf(stderr, "Unable to allocate orientation graph\n");
+      return -1;
+    }
+  }
+
+  // Estimate normals in parallel
+  R3NormalEstimatorData data;
+  data.estimator = this;
+  data.normals = normals;
+  data.curvatures = curvatures;
+  data.planarities = planarities;
+  data.graph_neighbors = graph_neighbors;
+  RNParallelFor(npoints, EstimateNormal, &data, nthreads, chunk_size);
+
+  // Orient normals along minimum spanning tree
+  if (graph_neighbors) {
+    OrientByMST(normals, graph_neighbors, max_graph_neighbors);
+    delete [] graph_neighbors;
+  }
+
+  // Count points with normals
+  int count = 0;
+  for (int i = 0; i < npoints; i++) {
+    if (!normals[i].IsZero()) count++;
+  }
+
+  // Return number of points with normals
+  return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Orientation functions
+////////////////////////////////////////////////////////////////////////
+
+struct R3NormalEstimatorEdge {
+  RNScalar cost;
+  int source;
+  int target;
+};
+
+
+
+static void
+PushEdge(R3NormalEstimatorEdge *heap, int& nedges, const R3NormalEstimatorEdge& edge)
+{
+  // Bubble up from last slot
+  int i = nedges++;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (heap[parent].cost <= edge.cost) break;
+    heap[i] = heap[parent];
+    i = parent;
+  }
+  heap[i] = edge;
+}
+
+
+
+static R3NormalEstimatorEdge
+PopEdge(R3NormalEstimatorEdge *heap, int& nedges)
+{
+  // Remove cheapest edge and bubble down last one
+  R3NormalEstimatorEdge result = heap[0];
+  R3NormalEstimatorEdge edge = heap[--nedges];
+  int i = 0;
+  while (TRUE) {
+    int child = 2 * i + 1;
+    if (child >= nedges) break;
+    if ((child + 1 < nedges) && (heap[child+1].cost < heap[child].cost)) child++;
+    if (edge.cost <= heap[child].cost) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  if (nedges > 0) heap[i] = edge;
+  return result;
+}
+
+
+
+struct R3NormalEstimatorSeed {
+  RNCoord z;
+  int index;
+};
+
+
+
+static int
+CompareSeeds(const void *data1, const void *data2)
+{
+  // Sort seeds from highest to lowest
+  const R3NormalEstimatorSeed *seed1 = (const R3NormalEstimatorSeed *) data1;
+  const R3NormalEstimatorSeed *seed2 = (const R3NormalEstimatorSeed *) data2;
+  if (seed1->z > seed2->z) return -1;
+  else if (seed1->z < seed2->z) return 1;
+  else return seed1->index - seed2->index;
+}
+
+
+
+static int
+FindRoot(int *parents, int i)
+{
+  // Find root of union-find set with path halving
+  while (parents[i] != i) {
+    parents[i] = parents[parents[i]];
+    i = parents[i];
+  }
+  return i;
+}
+
+
+
+static RNBoolean
+UnionSets(int *parents, int i, int j)
+{
+  // Merge union-find sets (smaller root becomes parent), returning whether they were different
+  i = FindRoot(parents, i);
+  j = FindRoot(parents, j);
+  if (i < j) parents[j] = i;
+  else if (j < i) parents[i] = j;
+  else return FALSE;
+  return TRUE;
+}
+
+
+
+struct R3NormalEstimatorBridgeData {
+  const R3Point *points;
+  const R3Vector *normals;
+  const int *components;
+  const R3FaceHierarchy *hierarchy;
+  const int *node_components;
+  int *closest_points;
+  RNScalar *closest_distances;
+};
+
+
+
+static void
+FindClosestBridge(int index, int, void *data)
+{
+  // Get convenient variables
+  R3NormalEstimatorBridgeData *bridge_data = (R3NormalEstimatorBridgeData *) data;
+  const R3FaceHierarchy *hierarchy = bridge_data->hierarchy;
+  const R3Point& position = bridge_data->points[index];
+  int component = bridge_data->components[index];
+  bridge_data->closest_points[index] = -1;
+  bridge_data->closest_distances[index] = RN_INFINITY;
+  if (component < 0) return;
+
+  // Traverse hierarchy, visiting nearer children first and skipping nodes without points of other components
+  RNScalar best_distance_squared = RN_INFINITY;
+  int best_point = -1;
+  int stack[R3FaceHierarchy::max_stack_size];
+  int nstack = 0;
+  stack[nstack++] = 0;
+  while (nstack > 0) {
+    // Pop node and check its component and distance
+    int node = stack[--nstack];
+    int node_component = bridge_data->node_components[node];
+    if ((node_component == component) || (node_component == -2)) continue;
+    if (R3FaceHierarchy::BoxDistanceSquared(hierarchy->NodeBox(node), position) >= best_distance_squared) continue;
+
+    // Check if interior node
+    if (hierarchy->NodeChild(node, 0) >= 0) {
+      int child0 = hierarchy->NodeChild(node, 0);
+      int child1 = hierarchy->NodeChild(node, 1);
+      RNScalar d0 = R3FaceHierarchy::BoxDistanceSquared(hierarchy->NodeBox(child0), position);
+      RNScalar d1 = R3FaceHierarchy::BoxDistanceSquared(hierarchy->NodeBox(child1), position);
+      assert(nstack + 2 <= R3FaceHierarchy::max_stack_size);
+      if (d0 <= d1) { stack[nstack++] = child1; stack[nstack++] = child0; }
+      else { stack[nstack++] = child0; stack[nstack++] = child1; }
+      continue;
+    }
+
+    // Check points in leaf
+    int first = hierarchy->NodeFirstPoint(node);
+    for (int k = first; k < first + hierarchy->NodeNPoints(node); k++) {
+      int j = hierarchy->Point(k);
+      int other_component = bridge_data->components[j];
+      if ((other_component < 0) || (other_component == component)) continue;
+      RNScalar d = R3SquaredDistance(position, bridge_data->points[j]);
+      if ((d < best_distance_squared) || ((d == best_distance_squared) && (j < best_point))) {
+        best_distance_squared = d;
+        best_point = j;
+      }
+    }
+  }
+
+  // Remember closest point of another component
+  bridge_data->closest_points[index] = best_point;
+  bridge_data->closest_distances[index] = best_distance_squared;
+}
+
+
+
+int R3NormalEstimator::
+FindBridges(const R3Vector *normals, int *parents, int *bridges)
+{
+  // Build hierarchy over points
+  R3FaceHierarchy hierarchy;
+  hierarchy.Build(points, npoints, max_points_per_leaf);
+
+  // Allocate temporary data
+  int *components = new int [ npoints ];
+  int *node_components = new int [ hierarchy.NNodes() ];
+  int *closest_points = new int [ npoints ];
+  RNScalar *closest_distances = new RNScalar [ npoints ];
+  int *best_points = new int [ 2 * npoints ];
+  RNScalar *best_distances = new RNScalar [ npoints ];
+
+  // Join components along their shortest connections until one is left (Boruvka)
+  int nbridges = 0;
+  while (TRUE) {
+    // Label points by component (-1 for points without normals)
+    int nroots = 0;
+    for (int i = 0; i < npoints; i++) {
+      if (normals[i].IsZero()) { components[i] = -1; continue; }
+      components[i] = FindRoot(parents, i);
+      if (components[i] == i) nroots++;
+    }
+    if (nroots <= 1) break;
+
+    // Label nodes by component of all their points (-1 if mixed, -2 if none), children come after parents
+    for (int node = hierarchy.NNodes() - 1; node >= 0; node--) {
+      int label = -2;
+      if (hierarchy.NodeChild(node, 0) >= 0) {
+        int label0 = node_components[hierarchy.NodeChild(node, 0)];
+        int label1 = node_components[hierarchy.NodeChild(node, 1)];
+        if (label0 == -2) label = label1;
+        else if ((label1 == -2) || (label1 == label0)) label = label0;
+        else label = -1;
+      }
+      else {
+        int first = hierarchy.NodeFirstPoint(node);
+        for (int k = first; k < first + hierarchy.NodeNPoints(node); k++) {
+          int component = components[hierarchy.Point(k)];
+          if (component < 0) continue;
+          if (label == -2) label = component;
+          else if (label != component) { label = -1; break; }
+        }
+      }
+      node_components[node] = label;
+    }
+
+    // Find closest point of another component for every point in parallel
+    R3NormalEstimatorBridgeData bridge_data;
+    bridge_data.points = points;
+    bridge_data.normals = normals;
+    bridge_data.components = components;
+    bridge_data.hierarchy = &hierarchy;
+    bridge_data.node_components = node_components;
+    bridge_data.closest_points = closest_points;
+    bridge_data.closest_distances = closest_distances;
+    RNParallelFor(npoints, FindClosestBridge, &bridge_data, nthreads, chunk_size);
+
+    // Find shortest connection leaving every component
+    for (int i = 0; i < npoints; i++) best_points[2*i+0] = -1;
+    for (int i = 0; i < npoints; i++) {
+      int j = closest_points[i];
+      if (j < 0) continue;
+      int c = components[i];
+      if ((best_points[2*c+0] >= 0) && (closest_distances[i] >= best_distances[c])) continue;
+      best_points[2*c+0] = i;
+      best_points[2*c+1] = j;
+      best_distances[c] = closest_distances[i];
+    }
+
+    // Merge components along their shortest connections
+    int nmerged = 0;
+    for (int c = 0; c < npoints; c++) {
+      int i = best_points[2*c+0];
+      if (i < 0) continue;
+      int j = best_points[2*c+1];
+      if (!UnionSets(parents, i, j)) continue;
+      bridges[2*nbridges+0] = i;
+      bridges[2*nbridges+1] = j;
+      nbridges++;
+      nmerged++;
+    }
+    if (nmerged == 0) break;
+  }
+
+  // Delete temporary data
+  delete [] components;
+  delete [] node_components;
+  delete [] closest_points;
+  delete [] closest_distances;
+  delete [] best_points;
+  delete [] best_distances;
+
+  // Return number of bridges
+  return nbridges;
+}
+
+
+
+int R3NormalEstimator::
+OrientByMST(R3Vector *normals, const int *graph_neighbors, int max_graph_neighbors)
+{
+  // Find components of neighbor graph between points with normals
+  int *parents = new int [ npoints ];
+  for (int i = 0; i < npoints; i++) parents[i] = i;
+  for (int i = 0; i < npoints; i++) {
+    if (normals[i].IsZero()) continue;
+    for (int k = 0; k < max_graph_neighbors; k++) {
+      int j = graph_neighbors[i * max_graph_neighbors + k];
+      if ((j < 0) || normals[j].IsZero()) continue;
+      UnionSets(parents, i, j);
+    }
+  }
+
+  // Connect components with edges of the Euclidean minimum spanning tree (neighbor graphs of
+  // unevenly spaced samples, e.g., scan lines, fall apart into pieces that cannot be oriented alone)
+  int *bridges = new int [ 2 * npoints ];
+  int nbridges = FindBridges(normals, parents, bridges);
+  delete [] parents;
+
+  // Count edges of symmetric graph
+  int *offsets = new int [ npoints + 1 ];
+  for (int i = 0; i <= npoints; i++) offsets[i] = 0;
+  for (int i = 0; i < npoints; i++) {
+    if (normals[i].IsZero()) continue;
+    for (int k = 0; k < max_graph_neighbors; k++) {
+      int j = graph_neighbors[i * max_graph_neighbors + k];
+      if ((j < 0) || normals[j].IsZero()) continue;
+      offsets[i+1]++;
+      offsets[j+1]++;
+    }
+  }
+  for (int b = 0; b < nbridges; b++) {
+    offsets[bridges[2*b+0]+1]++;
+    offsets[bridges[2*b+1]+1]++;
+  }
+
+  // Fill adjacency lists
+  for (int i = 0; i < npoints; i++) offsets[i+1] += offsets[i];
+  int nadjacencies = offsets[npoints];
+  int *adjacencies = new int [ nadjacencies + 1 ];
+  int *fill = new int [ npoints ];
+  for (int i = 0; i < npoints; i++) fill[i] = offsets[i];
+  for (int i = 0; i < npoints; i++) {
+    if (normals[i].IsZero()) continue;
+    for (int k = 0; k < max_graph_neighbors; k++) {
+      int j = graph_neighbors[i * max_graph_neighbors + k];
+      if ((j < 0) || normals[j].IsZero()) continue;
+      adjacencies[fill[i]++] = j;
+      adjacencies[fill[j]++] = i;
+    }
+  }
+  for (int b = 0; b < nbridges; b++) {
+    int i = bridges[2*b+0], j = bridges[2*b+1];
+    adjacencies[fill[i]++] = j;
+    adjacencies[fill[j]++] = i;
+  }
+  delete [] fill;
+  delete [] bridges;
+
+  // Sort seeds so that every component is started from its highest point
+  R3NormalEstimatorSeed *seeds = new R3NormalEstimatorSeed [ npoints ];
+  for (int i = 0; i < npoints; i++) {
+    seeds[i].z = points[i].Z();
+    seeds[i].index = i;
+  }
+  qsort(seeds, npoints, sizeof(R3NormalEstimatorSeed), CompareSeeds);
+
+  // Grow minimum spanning trees with Prim's algorithm, flipping normals along tree edges
+  R3NormalEstimatorEdge *heap = new R3NormalEstimatorEdge [ nadjacencies + 1 ];
+  RNBoolean *visited = new RNBoolean [ npoints ];
+  for (int i = 0; i < npoints; i++) visited[i] = FALSE;
+  ncomponents = 0;
+  for (int s = 0; s < npoints; s++) {
+    // Check seed
+    int seed = seeds[s].index;
+    if (visited[seed] || normals[seed].IsZero()) continue;
+
+    // Point seed normal up
+    if (normals[seed].Z() < 0) normals[seed].Flip();
+    ncomponents++;
+
+    // Visit component
+    int nedges = 0;
+    R3NormalEstimatorEdge edge;
+    edge.cost = 0;
+    edge.source = seed;
+    edge.target = seed;
+    PushEdge(heap, nedges, edge);
+    while (nedges > 0) {
+      // Visit target of cheapest edge
+      edge = PopEdge(heap, nedges);
+      int i = edge.target;
+      if (visited[i]) continue;
+      if (normals[i].Dot(normals[edge.source]) < 0) normals[i].Flip();
+      visited[i] = TRUE;
+
+      // Push edges to unvisited neighbors (each adjacency is pushed at most once)
+      for (int a = offsets[i]; a < offsets[i+1]; a++) {
+        int j = adjacencies[a];
+        if (visited[j]) continue;
+        R3NormalEstimatorEdge neighbor_edge;
+        neighbor_edge.cost = 1.0 - fabs(normals[i].Dot(normals[j]));
+        neighbor_edge.source = i;
+        neighbor_edge.target = j;
+        PushEdge(heap, nedges, neighbor_edge);
+      }
+    }
+  }
+
+  // Delete temporary data
+  delete [] visited;
+  delete [] heap;
+  delete [] seeds;
+  delete [] adjacencies;
+  delete [] offsets;
+
+  // Return number of components
+  return ncomponents;
+}
+
+
+
@@ -0,0 +1,256 @@
+// Include file for point normal estimation class
+
+
+
+// Orientation methods
+
+#define R3_NORMAL_NO_ORIENTATION         0
+#define R3_NORMAL_MST_ORIENTATION        1
+#define R3_NORMAL_VIEWPOINT_ORIENTATION  2
+
+
+
+// Class definition
+
+class R3NormalEstimator {
+public:
+  // Constructors/destructors
+  R3NormalEstimator(int npoints, const R3Point *points);
+  ~R3NormalEstimator(void);
+
+  // Property functions
+  int NPoints(void) const;
+  const R3Point *Points(void) const;
+  int MaxNeighbors(void) const;
+  RNLength MaxDistance(void) const;
+  int NRobustIterations(void) const;
+  int OrientationMethod(void) const;
+  const R3Point& Viewpoint(void) const;
+  const RNBoolean *Selection(void) const;
+  int NThreads(void) const;
+
+  // Parameter manipulation functions
+  void SetMaxNeighbors(int max_neighbors);
+    // Number of closest points in a neighborhood, including the point itself (default 16, 0 means no limit)
+  void SetMaxDistance(RNLength max_distance);
+    // Radius of a neighborhood (default 0 means no limit), at least one of the two limits must be set
+  void SetNRobustIterations(int niterations);
+    // Number of times the plane fit is repeated with neighbors weighted by their distance to the
+    // previous plane (Tukey biweight, scale from the median distance), so that neighborhoods
+    // straddling creases and outliers follow the dominant surface (default 0)
+  void SetOrientationMethod(int orientation_method);
+    // No orientation leaves the sign of every normal arbitrary.  MST orientation propagates signs
+    // along a minimum spanning tree of the neighbor graph weighted by 1 - |n1.n2|, starting from the
+    // highest point, whose normal points up.  The neighbor graph is connected with edges of the
+    // Euclidean minimum spanning tree, so all points with normals are oriented from one seed, even
+    // separate objects.  Viewpoint orientation points every normal towards the viewpoint (or its sensor origin)
+  void SetViewpoint(const R3Point& viewpoint);
+    // Sets viewpoint orientation with one viewpoint for all points
+  void SetViewpoints(const R3Point *viewpoints);
+    // Sets viewpoint orientation with one sensor origin per point (array of NPoints, not copied)
+  void SetSelection(const RNBoolean *selected);
+    // Restricts estimation to points with selected[i] TRUE (array of NPoints, not copied, default NULL
+    // selects all points), other points are still neighbors but get zero normals
+  void SetNThreads(int nthreads);
+
+  // Estimation functions
+  int Compute(R3Vector *normals, RNScalar *curvatures = NULL, RNScalar *planarities = NULL);
+    // Fills arrays (NPoints entries) with unit normals from a weighted PCA of every neighborhood,
+    // surface variations l0/(l0+l1+l2), and planarities (l1-l0)/l2, where l0 <= l1 <= l2 are the
+    // covariance eigenvalues.  Points with fewer than 3 neighbors get zero normals, curvatures,
+    // and planarities.  Returns the number of points with normals or -1 on error
+
+  // Statistics functions
+  int NComponents(void) const;
+    // Number of trees grown by the last MST orientation (1 if any point has a normal)
+
+public:
+  // Internal functions
+  int OrientByMST(R3Vector *normals, const int *graph_neighbors, int max_graph_neighbors);
+  int FindBridges(const R3Vector *normals, int *parents, int *bridges);
+
+public:
+  // Internal data
+  int npoints;
+  const R3Point *points;
+  R3Kdtree<const R3Point *> *kdtree;
+  int max_neighbors;
+  RNLength max_distance;
+  int nrobust_iterations;
+  int orientation_method;
+  R3Point viewpoint;
+  const R3Point *viewpoints;
+  const RNBoolean *selected;
+  int nthreads;
+  int ncomponents;
+};
+
+
+
+// Inline functions
+
+inline int R3NormalEstimator::
+NPoints(void) const
+{
+  // Return number of points
+  return npoints;
+}
+
+
+
+inline const R3Point *R3NormalEstimator::
+Points(void) const
+{
+  // Return points
+  return points;
+}
+
+
+
+inline int R3NormalEstimator::
+MaxNeighbors(void) const
+{
+  // Return maximum number of points in a neighborhood
+  return max_neighbors;
+}
+
+
+
+inline RNLength R3NormalEstimator::
+MaxDistance(void) const
+{
+  // Return radius of a neighborhood
+  return max_distance;
+}
+
+
+
+inline int R3NormalEstimator::
+NRobustIterations(void) const
+{
+  // Return number of reweighted plane fits
+  return nrobust_iterations;
+}
+
+
+
+inline int R3NormalEstimator::
+OrientationMethod(void) const
+{
+  // Return orientation method
+  return orientation_method;
+}
+
+
+
+inline const R3Point& R3NormalEstimator::
+Viewpoint(void) const
+{
+  // Return viewpoint
+  return viewpoint;
+}
+
+
+
+inline const RNBoolean *R3NormalEstimator::
+Selection(void) const
+{
+  // Return selection of points to estimate (NULL if all)
+  return selected;
+}
+
+
+
+inline int R3NormalEstimator::
+NThreads(void) const
+{
+  // Return number of threads (0 means RNNumberOfThreads())
+  return nthreads;
+}
+
+
+
+inline void R3NormalEstimator::
+SetMaxNeighbors(int max_neighbors)
+{
+  // Set maximum number of points in a neighborhood
+  this->max_neighbors = max_neighbors;
+}
+
+
+
+inline void R3NormalEstimator::
+SetMaxDistance(RNLength max_distance)
+{
+  // Set radius of a neighborhood
+  this->max_distance = max_distance;
+}
+
+
+
+inline void R3NormalEstimator::
+SetNRobustIterations(int niterations)
+{
+  // Set number of reweighted plane fits
+  this->nrobust_iterations = niterations;
+}
+
+
+
+inline void R3NormalEstimator::
+SetOrientationMethod(int orientation_method)
+{
+  // Set orientation method
+  this->orientation_method = orientation_method;
+}
+
+
+
+inline void R3NormalEstimator::
+SetViewpoint(const R3Point& viewpoint)
+{
+  // Set viewpoint orientation towards one viewpoint
+  this->orientation_method = R3_NORMAL_VIEWPOINT_ORIENTATION;
+  this->viewpoint = viewpoint;
+  this->viewpoints = NULL;
+}
+
+
+
+inline void R3NormalEstimator::
+SetViewpoints(const R3Point *viewpoints)
+{
+  // Set viewpoint orientation towards sensor origins
+  this->orientation_method = R3_NORMAL_VIEWPOINT_ORIENTATION;
+  this->viewpoints = viewpoints;
+}
+
+
+
+inline void R3NormalEstimator::
+SetSelection(const RNBoolean *selected)
+{
+  // Set selection of points to estimate
+  this->selected = selected;
+}
+
+
+
+inline void R3NormalEstimator::
+SetNThreads(int nthreads)
+{
+  // Set number of threads
+  this->nthreads = nthreads;
+}
+
+
+
+inline int R3NormalEstimator::
+NComponents(void) const
+{
+  // Return number of components of last MST orientation
+  return ncomponents;
+}
+
+
+
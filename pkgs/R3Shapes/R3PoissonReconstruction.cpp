@@ -0,0 +1,1663 @@
+// Source file for screened Poisson surface reconstruction class
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Parameters
+////////////////////////////////////////////////////////////////////////
+
+// Width of the octree cube relative to the longest side of the bounding box
+static const RNScalar domain_scale = 1.1;
+
+// Deepest coarsest level (it covers the whole cube, so it is the only full level)
+static const int max_min_depth = 5;
+
+// Deepest supported level (cell coordinates are packed in 20 bits)
+static const int max_supported_depth = 18;
+
+// Number of cells around cells with points that are solved at every level
+static const int dilation_radius = 2;
+
+// Conjugate gradient iterations on the coarsest level
+static const int coarse_iterations = 256;
+
+// Relative residual at which conjugate gradient iterations stop
+static const RNScalar solver_tolerance = 1E-12;
+
+// Number of corners or leaves per parallel block
+static const int block_size = 4096;
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Internal structures
+////////////////////////////////////////////////////////////////////////
+
+struct R3PoissonHash {
+  // Open addressing table from packed cell coordinates to indices
+  RNUInt64 *keys;
+  int *values;
+  int size;
+  int count;
+};
+
+struct R3PoissonLevel {
+  // Depth and cell width in unit cube
+  int depth;
+  RNScalar width;
+
+  // Cells (corners are numbered by x, y, z bits)
+  int ncells;
+  RNUInt64 *cell_keys;
+  R3PoissonHash *cell_hash;
+  int *cell_corners;
+  int *cell_first_leaf;
+  int *cell_nleaves;
+
+  // Corners and implicit function values
+  int ncorners;
+  RNUInt64 *corner_keys;
+  R3PoissonHash *corner_hash;
+  double *values;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Hash table functions
+////////////////////////////////////////////////////////////////////////
+
+static const RNUInt64 empty_key = ~((RNUInt64) 0);
+
+
+
+static RNUInt64
+PackKey(int i, int j, int k)
+{
+  // Return key of cell or corner coordinates
+  return ((RNUInt64) i << 40) | ((RNUInt64) j << 20) | (RNUInt64) k;
+}
+
+
+
+static void
+UnpackKey(RNUInt64 key, int& i, int& j, int& k)
+{
+  // Return coordinates of cell or corner key
+  i = (int) ((key >> 40) & 0xFFFFF);
+  j = (int) ((key >> 20) & 0xFFFFF);
+  k = (int) (key & 0xFFFFF);
+}
+
+
+
+static RNUInt64
+MortonCode(RNUInt64 key, int depth)
+{
+  // Interleave bits of cell coordinates (so that cells of any coarser level are runs)
+  int i, j, k;
+  RNUInt64 code = 0;
+  UnpackKey(key, i, j, k);
+  for (int b = depth-1; b >= 0; b--) {
+    code = (code << 3) | (RNUInt64) ((((i >> b) & 1) << 2) | (((j >> b) & 1) << 1) | ((k >> b) & 1));
+  }
+  return code;
+}
+
+
+
+static int
+HashSlot(RNUInt64 key, int size)
+{
+  // Return first slot of key (multiplicative hashing)
+  key *= (RNUInt64) 0x9E3779B97F4A7C15ULL;
+  return (int) ((key >> 32) & (RNUInt64) (size - 1));
+}
+
+
+
+static R3PoissonHash *
+CreateHash(int expected_count)
+{
+  // Allocate table at most half full
+  R3PoissonHash *hash = new R3PoissonHash();
+  hash->size = 1024;
+  while (hash->size < 2 * expected_count) hash->size *= 2;
+  hash->keys = new RNUInt64 [ hash->size ];
+  hash->values = new int [ hash->size ];
+  for (int i = 0; i < hash->size; i++) hash->keys[i] = empty_key;
+  hash->count = 0;
+  return hash;
+}
+
+
+
+static void
+DeleteHash(R3PoissonHash *hash)
+{
+  // Delete table
+  if (!hash) return;
+  delete [] hash->keys;
+  delete [] hash->values;
+  delete hash;
+}
+
+
+
+static int
+FindHash(const R3PoissonHash *hash, RNUInt64 key)
+{
+  // Return value of key, or -1 if it is not in table
+  int slot = HashSlot(key, hash->size);
+  while (hash->keys[slot] != empty_key) {
+    if (hash->keys[slot] == key) return hash->values[slot];
+    slot = (slot + 1) & (hash->size - 1);
+  }
+  return -1;
+}
+
+
+
+static int
+InsertHash(R3PoissonHash *hash, RNUInt64 key, int value)
+{
+  // Grow table when it becomes half full
+  if (2 * (hash->count + 1) > hash->size) {
+    RNUInt64 *old_keys = hash->keys;
+    int *old_values = hash->values;
+    int old_size = hash->size;
+    hash->size *= 2;
+    hash->keys = new RNUInt64 [ hash->size ];
+    hash->values = new int [ hash->size ];
+    for (int i = 0; i < hash->size; i++) hash->keys[i] = empty_key;
+    for (int i = 0; i < old_size; i++) {
+      if (old_keys[i] == empty_key) continue;
+      int slot = HashSlot(old_keys[i], hash->size);
+      while (hash->keys[slot] != empty_key) slot = (slot + 1) & (hash->size - 1);
+      hash->keys[slot] = old_keys[i];
+      hash->values[slot] = old_values[i];
+    }
+    delete [] old_keys;
+    delete [] old_values;
+  }
+
+  // Return existing value of key, or insert value
+  int slot = HashSlot(key, hash->size);
+  while (hash->keys[slot] != empty_key) {
+    if (hash->keys[slot] == key) return hash->values[slot];
+    slot = (slot + 1) & (hash->size - 1);
+  }
+  hash->keys[slot] = key;
+  hash->values[slot] = value;
+  hash->count++;
+  return value;
+}
+
+
+
+static int
+KeyArrayCapacity(int nkeys)
+{
+  // Return allocated size of a key array grown by InsertKey
+  if (nkeys == 0) return 0;
+  int capacity = 1024;
+  while (capacity < nkeys) capacity *= 2;
+  return capacity;
+}
+
+
+
+static int
+InsertKey(R3PoissonHash *hash, RNUInt64 key, RNUInt64 *&keys, int& nkeys, int& capacity)
+{
+  // Insert key into table and array if it is new, and return its index
+  int index = InsertHash(hash, key, nkeys);
+  if (index < nkeys) return index;
+  if (nkeys == capacity) {
+    capacity = (capacity > 0) ? 2 * capacity : 1024;
+    RNUInt64 *new_keys = new RNUInt64 [ capacity ];
+    for (int i = 0; i < nkeys; i++) new_keys[i] = keys[i];
+    if (keys) delete [] keys;
+    keys = new_keys;
+  }
+  keys[nkeys++] = key;
+  return index;
+}
+
+
+
+static void
+DeleteLevel(R3PoissonLevel *level)
+{
+  // Delete arrays of level
+  if (level->cell_keys) delete [] level->cell_keys;
+  if (level->cell_corners) delete [] level->cell_corners;
+  if (level->cell_first_leaf) delete [] level->cell_first_leaf;
+  if (level->cell_nleaves) delete [] level->cell_nleaves;
+  if (level->corner_keys) delete [] level->corner_keys;
+  if (level->values) delete [] level->values;
+  DeleteHash(level->cell_hash);
+  DeleteHash(level->corner_hash);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+R3PoissonReconstruction::
+R3PoissonReconstruction(const R3Box& bbox, int max_depth)
+  : bbox(bbox),
+    origin(0, 0, 0),
+    scale(1),
+    max_depth(max_depth),
+    min_depth(0),
+    nthreads(0),
+    screening_weight(4),
+    niterations(8),
+    trim_depth(0),
+    leaf_hash(NULL),
+    leaf_keys(NULL),
+    leaf_sums(NULL),
+    nleaves(0),
+    ninserted_points(0),
+    levels(NULL),
+    nlevels(0),
+    iso_value(0)
+{
+  // Check depth
+  if (this->max_depth < 1) this->max_depth = 1;
+  if (this->max_depth > max_supported_depth) this->max_depth = max_supported_depth;
+  min_depth = (this->max_depth < max_min_depth) ? this->max_depth : max_min_depth;
+
+  // Compute cube around bounding box
+  if (!bbox.IsEmpty()) {
+    scale = domain_scale * bbox.LongestAxisLength();
+    if (RNIsZero(scale)) scale = 1;
+    R3Point centroid = bbox.Centroid();
+    origin = centroid - 0.5 * R3Vector(scale, scale, scale);
+  }
+
+  // Create table of leaves
+  leaf_hash = CreateHash(0);
+}
+
+
+
+R3PoissonReconstruction::
+~R3PoissonReconstruction(void)
+{
+  // Delete levels
+  for (int i = 0; i < nlevels; i++) DeleteLevel(&levels[i]);
+  if (levels) delete [] levels;
+
+  // Delete leaves
+  DeleteHash(leaf_hash);
+  if (leaf_keys) delete [] leaf_keys;
+  if (leaf_sums) delete [] leaf_sums;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Property functions
+////////////////////////////////////////////////////////////////////////
+
+int R3PoissonReconstruction::
+NNodes(void) const
+{
+  // Return number of cells at all levels
+  int count = 0;
+  for (int i = 0; i < nlevels; i++) count += levels[i].ncells;
+  return count;
+}
+
+
+
+R3Point R3PoissonReconstruction::
+UnitPosition(const R3Point& position) const
+{
+  // Return position in unit cube
+  return R3Point((position.X() - origin.X()) / scale,
+    (position.Y() - origin.Y()) / scale,
+    (position.Z() - origin.Z()) / scale);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Input functions
+////////////////////////////////////////////////////////////////////////
+
+int R3PoissonReconstruction::
+InsertPoint(const R3Point& position, const R3Vector& normal, RNScalar weight)
+{
+  // Check weight
+  if (weight <= 0) return 0;
+
+  // Check if point is inside cube
+  R3Point p = UnitPosition(position);
+  if ((p.X() < 0) || (p.Y() < 0) || (p.Z() < 0)) return 0;
+  if ((p.X() > 1) || (p.Y() > 1) || (p.Z() > 1)) return 0;
+
+  // Find leaf cell
+  int n = 1 << max_depth;
+  int i = (int) (p.X() * n); if (i >= n) i = n - 1;
+  int j = (int) (p.Y() * n); if (j >= n) j = n - 1;
+  int k = (int) (p.Z() * n); if (k >= n) k = n - 1;
+  RNUInt64 key = PackKey(i, j, k);
+
+  // Find or create leaf
+  int capacity = KeyArrayCapacity(nleaves);
+  int leaf = InsertKey(leaf_hash, key, leaf_keys, nleaves, capacity);
+  if (leaf == nleaves - 1) {
+    // Grow sums along with keys
+    if (capacity > KeyArrayCapacity(leaf)) {
+      double *sums = new double [ 7 * capacity ];
+      for (int m = 0; m < 7 * leaf; m++) sums[m] = leaf_sums[m];
+      if (leaf_sums) delete [] leaf_sums;
+      leaf_sums = sums;
+    }
+
+    // Initialize sums
+    for (int m = 0; m < 7; m++) leaf_sums[7*leaf+m] = 0;
+  }
+
+  // Add point to leaf
+  double *sums = &leaf_sums[7*leaf];
+  sums[0] += weight * p.X();
+  sums[1] += weight * p.Y();
+  sums[2] += weight * p.Z();
+  sums[3] += weight * normal.X();
+  sums[4] += weight * normal.Y();
+  sums[5] += weight * normal.Z();
+  sums[6] += weight;
+  ninserted_points++;
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3PoissonReconstruction::
+InsertPoints(int npoints, const R3Point *positions, const R3Vector *normals, const RNScalar *weights)
+{
+  // Insert points
+  int count = 0;
+  for (int i = 0; i < npoints; i++) {
+    RNScalar weight = (weights) ? weights[i] : 1.0;
+    count += InsertPoint(positions[i], normals[i], weight);
+  }
+
+  // Return number of points inserted
+  return count;
+}
+
+
+
+int R3PoissonReconstruction::
+InsertPoints(R3Mesh *mesh)
+{
+  // Insert vertices
+  int count = 0;
+  for (int i = 0; i < mesh->NVertices(); i++) {
+    R3MeshVertex *vertex = mesh->Vertex(i);
+    count += InsertPoint(mesh->VertexPosition(vertex), mesh->VertexNormal(vertex));
+  }
+
+  // Return number of points inserted
+  return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Octree construction
+////////////////////////////////////////////////////////////////////////
+
+static int
+CompareMortonCodes(const void *data1, const void *data2)
+{
+  // Compare codes of leaves
+  RNUInt64 code1 = *((const RNUInt64 *) data1);
+  RNUInt64 code2 = *((const RNUInt64 *) data2);
+  if (code1 < code2) return -1;
+  if (code1 > code2) return 1;
+  return 0;
+}
+
+
+
+static void
+SortLeaves(R3PoissonHash *leaf_hash, RNUInt64 *leaf_keys, double *leaf_sums, int nleaves, int depth)
+{
+  // Sort pairs of Morton codes and leaf indices
+  RNUInt64 *pairs = new RNUInt64 [ 2 * nleaves ];
+  for (int i = 0; i < nleaves; i++) {
+    pairs[2*i+0] = MortonCode(leaf_keys[i], depth);
+    pairs[2*i+1] = (RNUInt64) i;
+  }
+  qsort(pairs, nleaves, 2 * sizeof(RNUInt64), CompareMortonCodes);
+
+  // Permute keys and sums
+  RNUInt64 *keys = new RNUInt64 [ nleaves ];
+  double *sums = new double [ 7 * nleaves ];
+  for (int i = 0; i < nleaves; i++) {
+    int leaf = (int) pairs[2*i+1];
+    keys[i] = leaf_keys[leaf];
+    for (int m = 0; m < 7; m++) sums[7*i+m] = leaf_sums[7*leaf+m];
+  }
+  for (int i = 0; i < nleaves; i++) {
+    leaf_keys[i] = keys[i];
+    for (int m = 0; m < 7; m++) leaf_sums[7*i+m] = sums[7*i+m];
+  }
+
+  // Update table of leaves
+  for (int slot = 0; slot < leaf_hash->size; slot++) leaf_hash->keys[slot] = empty_key;
+  leaf_hash->count = 0;
+  for (int i = 0; i < nleaves; i++) InsertHash(leaf_hash, leaf_keys[i], i);
+
+  // Delete temporary memory
+  delete [] pairs;
+  delete [] keys;
+  delete [] sums;
+}
+
+
+
+static void
+DilateCells(R3PoissonLevel *level, int& capacity)
+{
+  // Insert cells within dilation radius of current cells (one axis at a time)
+  int n = 1 << level->depth;
+  for (int a = 0; a < 3; a++) {
+    int ncells = level->ncells;
+    for (int c = 0; c < ncells; c++) {
+      int ijk[3];
+      UnpackKey(level->cell_keys[c], ijk[0], ijk[1], ijk[2]);
+      int center = ijk[a];
+      for (int d = -dilation_radius; d <= dilation_radius; d++) {
+        if ((d == 0) || (center + d < 0) || (center + d >= n)) continue;
+        ijk[a] = center + d;
+        InsertKey(level->cell_hash, PackKey(ijk[0], ijk[1], ijk[2]), level->cell_keys, level->ncells, capacity);
+      }
+    }
+  }
+}
+
+
+
+static void
+CreateLevelCorners(R3PoissonLevel *level, const RNUInt64 *leaf_keys, int nleaves, int max_depth)
+{
+  // Create corners of cells
+  int capacity = 0;
+  level->corner_hash = CreateHash(2 * level->ncells);
+  level->cell_corners = new int [ 8 * level->ncells ];
+  for (int c = 0; c < level->ncells; c++) {
+    int i, j, k;
+    UnpackKey(level->cell_keys[c], i, j, k);
+    for (int q = 0; q < 8; q++) {
+      RNUInt64 key = PackKey(i + (q & 1), j + ((q >> 1) & 1), k + ((q >> 2) & 1));
+      level->cell_corners[8*c+q] = InsertKey(level->corner_hash, key, level->corner_keys, level->ncorners, capacity);
+    }
+  }
+
+  // Find runs of sorted leaves in cells
+  int shift = max_depth - level->depth;
+  level->cell_first_leaf = new int [ level->ncells ];
+  level->cell_nleaves = new int [ level->ncells ];
+  for (int c = 0; c < level->ncells; c++) { level->cell_first_leaf[c] = 0; level->cell_nleaves[c] = 0; }
+  for (int l = 0; l < nleaves; l++) {
+    int i, j, k;
+    UnpackKey(leaf_keys[l], i, j, k);
+    int c = FindHash(level->cell_hash, PackKey(i >> shift, j >> shift, k >> shift));
+    if (c < 0) continue;
+    if (level->cell_nleaves[c] == 0) level->cell_first_leaf[c] = l;
+    level->cell_nleaves[c]++;
+  }
+
+  // Allocate values
+  level->values = new double [ level->ncorners + 1 ];
+  for (int i = 0; i < level->ncorners; i++) level->values[i] = 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Solver
+////////////////////////////////////////////////////////////////////////
+
+struct PoissonSolveData {
+  // Level and next coarser level
+  R3PoissonLevel *level;
+  const R3PoissonLevel *coarse;
+
+  // Sorted leaves, their cells at level, and trilinear weights of cell corners
+  const double *leaf_sums;
+  const int *leaf_cells;
+  float *leaf_weights;
+  int nleaves;
+
+  // Corner neighbors (-x, +x, -y, +y, -z, +z) and cells (offset by x, y, z bits), or -1
+  const int *corner_neighbors;
+  const int *corner_cells;
+  const RNBoolean *corner_free;
+
+  // Coefficients of edges, screening, and normal splats
+  double edge_weight;
+  double screening_weight;
+  double splat_weight;
+
+  // Vectors
+  const double *x;
+  double *y;
+  double *s;
+  double *normals;
+  double *b;
+  double *diagonal;
+};
+
+
+
+static void
+LeafWeightsBlock(int index, int, void *data)
+{
+  // Compute trilinear weights of cell corners at mean positions of leaves in block
+  PoissonSolveData *solve_data = (PoissonSolveData *) data;
+  const R3PoissonLevel *level = solve_data->level;
+  double n = 1 << level->depth;
+  int end = (index + 1) * block_size;
+  if (end > solve_data->nleaves) end = solve_data->nleaves;
+  for (int l = index * block_size; l < end; l++) {
+    int i, j, k;
+    const double *sums = &solve_data->leaf_sums[7*l];
+    UnpackKey(level->cell_keys[solve_data->leaf_cells[l]], i, j, k);
+    double t[3];
+    t[0] = n * sums[0] / sums[6] - i;
+    t[1] = n * sums[1] / sums[6] - j;
+    t[2] = n * sums[2] / sums[6] - k;
+    for (int a = 0; a < 3; a++) {
+      if (t[a] < 0) t[a] = 0;
+      else if (t[a] > 1) t[a] = 1;
+    }
+    float *weights = &solve_data->leaf_weights[8*l];
+    for (int q = 0; q < 8; q++) {
+      double w = (q & 1) ? t[0] : 1 - t[0];
+      w *= (q & 2) ? t[1] : 1 - t[1];
+      w *= (q & 4) ? t[2] : 1 - t[2];
+      weights[q] = (float) w;
+    }
+  }
+}
+
+
+
+static void
+ProlongateBlock(int index, int, void *data)
+{
+  // Interpolate values of coarser level at corners of block
+  PoissonSolveData *solve_data = (PoissonSolveData *) data;
+  R3PoissonLevel *level = solve_data->level;
+  const R3PoissonLevel *coarse = solve_data->coarse;
+  int end = (index + 1) * block_size;
+  if (end > level->ncorners) end = level->ncorners;
+  for (int c = index * block_size; c < end; c++) {
+    int ijk[3];
+    UnpackKey(level->corner_keys[c], ijk[0], ijk[1], ijk[2]);
+    int lo[3], hi[3];
+    for (int a = 0; a < 3; a++) {
+      lo[a] = ijk[a] >> 1;
+      hi[a] = (ijk[a] & 1) ? lo[a] + 1 : lo[a];
+    }
+    double value = 0, total = 0;
+    for (int q = 0; q < 8; q++) {
+      int i = (q & 1) ? hi[0] : lo[0];
+      int j = (q & 2) ? hi[1] : lo[1];
+      int k = (q & 4) ? hi[2] : lo[2];
+      int corner = FindHash(coarse->corner_hash, PackKey(i, j, k));
+      if (corner < 0) continue;
+      value += coarse->values[corner];
+      total += 1;
+    }
+    level->values[c] = (total > 0) ? value / total : 0;
+  }
+}
+
+
+
+static void
+SplatBlock(int index, int, void *data)
+{
+  // Gather normals of leaves at corners of block, and compute diagonal of system
+  PoissonSolveData *solve_data = (PoissonSolveData *) data;
+  const R3PoissonLevel *level = solve_data->level;
+  int end = (index + 1) * block_size;
+  if (end > level->ncorners) end = level->ncorners;
+  for (int c = index * block_size; c < end; c++) {
+    double *normal = &solve_data->normals[3*c];
+    double diagonal = 0;
+    normal[0] = normal[1] = normal[2] = 0;
+    for (int n = 0; n < 6; n++) {
+      if (solve_data->corner_neighbors[6*c+n] >= 0) diagonal += solve_data->edge_weight;
+    }
+    for (int b = 0; b < 8; b++) {
+      int cell = solve_data->corner_cells[8*c+b];
+      if (cell < 0) continue;
+      int first = level->cell_first_leaf[cell];
+      int last = first + level->cell_nleaves[cell];
+      for (int l = first; l < last; l++) {
+        const double *sums = &solve_data->leaf_sums[7*l];
+        double w = solve_data->leaf_weights[8*l+7-b];
+        double splat = w * solve_data->splat_weight / sums[6];
+        normal[0] += splat * sums[3];
+        normal[1] += splat * sums[4];
+        normal[2] += splat * sums[5];
+        diagonal += solve_data->screening_weight * w * w;
+      }
+    }
+    solve_data->diagonal[c] = (diagonal > 0) ? diagonal : 1;
+  }
+}
+
+
+
+static void
+RightHandSideBlock(int index, int, void *data)
+{
+  // Compute right hand side at corners of block (divergence of normals on edges)
+  PoissonSolveData *solve_data = (PoissonSolveData *) data;
+  const R3PoissonLevel *level = solve_data->level;
+  double h2 = solve_data->edge_weight * solve_data->edge_weight;
+  int end = (index + 1) * block_size;
+  if (end > level->ncorners) end = level->ncorners;
+  for (int c = index * block_size; c < end; c++) {
+    double b = 0;
+    if (solve_data->corner_free[c]) {
+      for (int a = 0; a < 3; a++) {
+        int lower = solve_data->corner_neighbors[6*c+2*a+0];
+        int upper = solve_data->corner_neighbors[6*c+2*a+1];
+        if (lower >= 0) b += 0.5 * h2 * (solve_data->normals[3*lower+a] + solve_data->normals[3*c+a]);
+        if (upper >= 0) b -= 0.5 * h2 * (solve_data->normals[3*upper+a] + solve_data->normals[3*c+a]);
+      }
+    }
+    solve_data->b[c] = b;
+  }
+}
+
+
+
+static void
+LeafValuesBlock(int index, int, void *data)
+{
+  // Interpolate vector at leaves of block
+  PoissonSolveData *solve_data = (PoissonSolveData *) data;
+  const R3PoissonLevel *level = solve_data->level;
+  int end = (index + 1) * block_size;
+  if (end > solve_data->nleaves) end = solve_data->nleaves;
+  for (int l = index * block_size; l < end; l++) {
+    int cell = solve_data->leaf_cells[l];
+    const float *weights = &solve_data->leaf_weights[8*l];
+    double value = 0;
+    for (int q = 0; q < 8; q++) value += weights[q] * solve_data->x[level->cell_corners[8*cell+q]];
+    solve_data->s[l] = value;
+  }
+}
+
+
+
+static void
+MultiplyBlock(int index, int, void *data)
+{
+  // Multiply system matrix by vector at free corners of block (uses leaf values in s)
+  PoissonSolveData *solve_data = (PoissonSolveData *) data;
+  const R3PoissonLevel *level = solve_data->level;
+  const double *x = solve_data->x;
+  int end = (index + 1) * block_size;
+  if (end > level->ncorners) end = level->ncorners;
+  for (int c = index * block_size; c < end; c++) {
+    double y = 0;
+    if (solve_data->corner_free[c]) {
+      for (int n = 0; n < 6; n++) {
+        int neighbor = solve_data->corner_neighbors[6*c+n];
+        if (neighbor >= 0) y += solve_data->edge_weight * (x[c] - x[neighbor]);
+      }
+      for (int b = 0; b < 8; b++) {
+        int cell = solve_data->corner_cells[8*c+b];
+        if (cell < 0) continue;
+        int first = level->cell_first_leaf[cell];
+        int last = first + level->cell_nleaves[cell];
+        for (int l = first; l < last; l++) {
+          y += solve_data->screening_weight * solve_data->leaf_weights[8*l+7-b] * solve_data->s[l];
+        }
+      }
+    }
+    solve_data->y[c] = y;
+  }
+}
+
+
+
+static void
+Multiply(PoissonSolveData *solve_data, const double *x, double *y, int nthreads)
+{
+  // Compute y = A x at free corners
+  solve_data->x = x;
+  solve_data->y = y;
+  int nleaf_blocks = (solve_data->nleaves + block_size - 1) / block_size;
+  int ncorner_blocks = (solve_data->level->ncorners + block_size - 1) / block_size;
+  RNParallelFor(nleaf_blocks, LeafValuesBlock, solve_data, nthreads, 1);
+  RNParallelFor(ncorner_blocks, MultiplyBlock, solve_data, nthreads, 1);
+}
+
+
+
+static double
+Dot(const double *x, const double *y, int n)
+{
+  // Return dot product
+  double sum = 0;
+  for (int i = 0; i < n; i++) sum += x[i] * y[i];
+  return sum;
+}
+
+
+
+static void
+SolveLevel(R3PoissonLevel *level, const R3PoissonLevel *coarse,
+  const double *leaf_sums, int nleaves, int max_depth,
+  RNScalar screening_weight, int niterations, int nthreads)
+{
+  // Initialize solve data
+  int n = level->ncorners;
+  int ncorner_blocks = (n + block_size - 1) / block_size;
+  RNScalar leaf_width = 1.0 / (1 << max_depth);
+  RNScalar leaf_area = leaf_width * leaf_width;
+  PoissonSolveData solve_data;
+  solve_data.level = level;
+  solve_data.coarse = coarse;
+  solve_data.leaf_sums = leaf_sums;
+  solve_data.nleaves = nleaves;
+  solve_data.edge_weight = level->width;
+  solve_data.screening_weight = screening_weight * leaf_area;
+  solve_data.splat_weight = leaf_area / (level->width * level->width * level->width);
+
+  // Find cells of leaves
+  int *leaf_cells = new int [ nleaves + 1 ];
+  for (int l = 0; l < nleaves; l++) leaf_cells[l] = -1;
+  for (int c = 0; c < level->ncells; c++) {
+    int first = level->cell_first_leaf[c];
+    int last = first + level->cell_nleaves[c];
+    for (int l = first; l < last; l++) leaf_cells[l] = c;
+  }
+  solve_data.leaf_cells = leaf_cells;
+
+  // Compute trilinear weights at leaves
+  int nleaf_blocks = (nleaves + block_size - 1) / block_size;
+  float *leaf_weights = new float [ 8 * nleaves + 1 ];
+  solve_data.leaf_weights = leaf_weights;
+  RNParallelFor(nleaf_blocks, LeafWeightsBlock, &solve_data, nthreads, 1);
+
+  // Find cells around corners
+  int *corner_cells = new int [ 8 * n ];
+  for (int i = 0; i < 8 * n; i++) corner_cells[i] = -1;
+  for (int c = 0; c < level->ncells; c++) {
+    for (int q = 0; q < 8; q++) corner_cells[8*level->cell_corners[8*c+q] + (7-q)] = c;
+  }
+  solve_data.corner_cells = corner_cells;
+
+  // Find corner neighbors, and corners that are free (all cells around them are at this
+  // level, or this is the coarsest level, which covers the whole cube)
+  int resolution = 1 << level->depth;
+  int *corner_neighbors = new int [ 6 * n ];
+  RNBoolean *corner_free = new RNBoolean [ n ];
+  for (int c = 0; c < n; c++) {
+    int ijk[3];
+    UnpackKey(level->corner_keys[c], ijk[0], ijk[1], ijk[2]);
+    for (int a = 0; a < 3; a++) {
+      for (int dir = 0; dir < 2; dir++) {
+        int nijk[3] = { ijk[0], ijk[1], ijk[2] };
+        nijk[a] += (dir == 0) ? -1 : 1;
+        int neighbor = -1;
+        if ((nijk[a] >= 0) && (nijk[a] <= resolution)) {
+          neighbor = FindHash(level->corner_hash, PackKey(nijk[0], nijk[1], nijk[2]));
+        }
+        corner_neighbors[6*c+2*a+dir] = neighbor;
+      }
+    }
+    corner_free[c] = TRUE;
+    if (coarse) {
+      for (int b = 0; b < 8; b++) {
+        if (corner_cells[8*c+b] < 0) { corner_free[c] = FALSE; break; }
+      }
+    }
+  }
+  solve_data.corner_neighbors = corner_neighbors;
+  solve_data.corner_free = corner_free;
+
+  // Allocate right hand side, diagonal, and leaf values
+  double *b = new double [ n ];
+  double *diagonal = new double [ n ];
+  double *s = new double [ nleaves + 1 ];
+  solve_data.b = b;
+  solve_data.diagonal = diagonal;
+  solve_data.s = s;
+
+  // Initialize values from coarser level (they stay fixed at corners that are not free)
+  if (coarse) RNParallelFor(ncorner_blocks, ProlongateBlock, &solve_data, nthreads, 1);
+
+  // Compute right hand side and diagonal
+  double *normals = new double [ 3 * n ];
+  solve_data.normals = normals;
+  RNParallelFor(ncorner_blocks, SplatBlock, &solve_data, nthreads, 1);
+  RNParallelFor(ncorner_blocks, RightHandSideBlock, &solve_data, nthreads, 1);
+  delete [] normals;
+
+  // Compute initial residual and search direction (preconditioned by diagonal)
+  double *x = level->values;
+  double *r = new double [ n ];
+  double *p = new double [ n ];
+  double *q = new double [ n ];
+  Multiply(&solve_data, x, q, nthreads);
+  double rz = 0;
+  for (int i = 0; i < n; i++) {
+    r[i] = (corner_free[i]) ? b[i] - q[i] : 0;
+    p[i] = r[i] / diagonal[i];
+    rz += r[i] * p[i];
+  }
+
+  // Run preconditioned conjugate gradient iterations
+  double rz0 = rz;
+  for (int iteration = 0; iteration < niterations; iteration++) {
+    if (rz <= solver_tolerance * rz0) break;
+    Multiply(&solve_data, p, q, nthreads);
+    double pq = Dot(p, q, n);
+    if (pq <= 0) break;
+    double alpha = rz / pq;
+    double rz_new = 0;
+    for (int i = 0; i < n; i++) {
+      x[i] += alpha * p[i];
+      r[i] -= alpha * q[i];
+      rz_new += r[i] * r[i] / diagonal[i];
+    }
+    double beta = rz_new / rz;
+    for (int i = 0; i < n; i++) p[i] = r[i] / diagonal[i] + beta * p[i];
+    rz = rz_new;
+  }
+
+  // Delete temporary memory
+  delete [] leaf_cells;
+  delete [] leaf_weights;
+  delete [] corner_cells;
+  delete [] corner_neighbors;
+  delete [] corner_free;
+  delete [] b;
+  delete [] diagonal;
+  delete [] s;
+  delete [] r;
+  delete [] p;
+  delete [] q;
+}
+
+
+
+static double
+EvaluateUnit(const R3PoissonLevel *levels, int nlevels, double x, double y, double z)
+{
+  // Interpolate values of deepest level with a cell containing position
+  double u[3] = { x, y, z };
+  for (int l = nlevels - 1; l >= 0; l--) {
+    const R3PoissonLevel *level = &levels[l];
+    int resolution = 1 << level->depth;
+    int ijk[3];
+    double t[3];
+    for (int a = 0; a < 3; a++) {
+      double v = u[a] * resolution;
+      ijk[a] = (int) floor(v);
+      if (ijk[a] < 0) ijk[a] = 0;
+      else if (ijk[a] >= resolution) ijk[a] = resolution - 1;
+      t[a] = v - ijk[a];
+      if (t[a] < 0) t[a] = 0;
+      else if (t[a] > 1) t[a] = 1;
+    }
+    int cell = FindHash(level->cell_hash, PackKey(ijk[0], ijk[1], ijk[2]));
+    if (cell < 0) continue;
+    double value = 0;
+    for (int q = 0; q < 8; q++) {
+      double w = (q & 1) ? t[0] : 1 - t[0];
+      w *= (q & 2) ? t[1] : 1 - t[1];
+      w *= (q & 4) ? t[2] : 1 - t[2];
+      value += w * level->values[level->cell_corners[8*cell+q]];
+    }
+    return value;
+  }
+
+  // Should not get here (coarsest level covers the cube)
+  return 0;
+}
+
+
+
+struct PoissonIsoData {
+  const R3PoissonLevel *levels;
+  int nlevels;
+  const double *leaf_sums;
+  int nleaves;
+  double *block_sums;
+};
+
+
+
+static void
+IsoValueBlock(int index, int, void *data)
+{
+  // Sum weighted values at leaves of block
+  PoissonIsoData *iso_data = (PoissonIsoData *) data;
+  int end = (index + 1) * block_size;
+  if (end > iso_data->nleaves) end = iso_data->nleaves;
+  double value_sum = 0, weight_sum = 0;
+  for (int l = index * block_size; l < end; l++) {
+    const double *sums = &iso_data->leaf_sums[7*l];
+    double value = EvaluateUnit(iso_data->levels, iso_data->nlevels, sums[0] / sums[6], sums[1] / sums[6], sums[2] / sums[6]);
+    value_sum += sums[6] * value;
+    weight_sum += sums[6];
+  }
+  iso_data->block_sums[2*index+0] = value_sum;
+  iso_data->block_sums[2*index+1] = weight_sum;
+}
+
+
+
+int R3PoissonReconstruction::
+Solve(void)
+{
+  // Check points
+  if (nleaves == 0) {
+    fprintf(stderr, "No points for Poisson reconstruction\n");
+    return 0;
+  }
+
+  // Delete previous levels
+  for (int i = 0; i < nlevels; i++) DeleteLevel(&levels[i]);
+  if (levels) delete [] levels;
+  levels = NULL;
+  nlevels = 0;
+
+  // Sort leaves (so that the leaves in every cell are a run)
+  SortLeaves(leaf_hash, leaf_keys, leaf_sums, nleaves, max_depth);
+
+  // Create levels fine to coarse (cells near leaves, and parents of cells of finer level)
+  nlevels = max_depth - min_depth + 1;
+  levels = new R3PoissonLevel [ nlevels ];
+  for (int l = nlevels - 1; l >= 0; l--) {
+    R3PoissonLevel *level = &levels[l];
+    level->depth = min_depth + l;
+    level->width = 1.0 / (1 << level->depth);
+    level->ncells = 0;
+    level->cell_keys = NULL;
+    level->cell_corners = NULL;
+    level->cell_first_leaf = NULL;
+    level->cell_nleaves = NULL;
+    level->ncorners = 0;
+    level->corner_keys = NULL;
+    level->corner_hash = NULL;
+    level->values = NULL;
+    int capacity = 0;
+    if (l == 0) {
+      // Coarsest level covers cube
+      int resolution = 1 << level->depth;
+      level->cell_hash = CreateHash(resolution * resolution * resolution);
+      for (int k = 0; k < resolution; k++) {
+        for (int j = 0; j < resolution; j++) {
+          for (int i = 0; i < resolution; i++) {
+            InsertKey(level->cell_hash, PackKey(i, j, k), level->cell_keys, level->ncells, capacity);
+          }
+        }
+      }
+    }
+    else {
+      // Cells with leaves and cells near them
+      int shift = max_depth - level->depth;
+      level->cell_hash = CreateHash((l == nlevels - 1) ? 8 * nleaves : levels[l+1].ncells / 2);
+      for (int i = 0; i < nleaves; i++) {
+        int ci, cj, ck;
+        UnpackKey(leaf_keys[i], ci, cj, ck);
+        InsertKey(level->cell_hash, PackKey(ci >> shift, cj >> shift, ck >> shift), level->cell_keys, level->ncells, capacity);
+      }
+      DilateCells(level, capacity);
+
+      // Parents of cells at finer level
+      if (l < nlevels - 1) {
+        const R3PoissonLevel *finer = &levels[l+1];
+        for (int i = 0; i < finer->ncells; i++) {
+          int ci, cj, ck;
+          UnpackKey(finer->cell_keys[i], ci, cj, ck);
+          InsertKey(level->cell_hash, PackKey(ci >> 1, cj >> 1, ck >> 1), level->cell_keys, level->ncells, capacity);
+        }
+      }
+    }
+    CreateLevelCorners(level, leaf_keys, nleaves, max_depth);
+  }
+
+  // Solve levels coarse to fine
+  for (int l = 0; l < nlevels; l++) {
+    const R3PoissonLevel *coarse = (l > 0) ? &levels[l-1] : NULL;
+    int level_iterations = (l > 0) ? niterations : coarse_iterations;
+    SolveLevel(&levels[l], coarse, leaf_sums, nleaves, max_depth,
+      screening_weight, level_iterations, nthreads);
+  }
+
+  // Compute iso value (weighted average at leaves)
+  PoissonIsoData iso_data;
+  int nleaf_blocks = (nleaves + block_size - 1) / block_size;
+  iso_data.levels = levels;
+  iso_data.nlevels = nlevels;
+  iso_data.leaf_sums = leaf_sums;
+  iso_data.nleaves = nleaves;
+  iso_data.block_sums = new double [ 2 * nleaf_blocks ];
+  RNParallelFor(nleaf_blocks, IsoValueBlock, &iso_data, nthreads, 1);
+  double value_sum = 0, weight_sum = 0;
+  for (int i = 0; i < nleaf_blocks; i++) {
+    value_sum += iso_data.block_sums[2*i+0];
+    weight_sum += iso_data.block_sums[2*i+1];
+  }
+  iso_value = (weight_sum > 0) ? value_sum / weight_sum : 0;
+  delete [] iso_data.block_sums;
+
+  // Return success
+  return 1;
+}
+
+
+
+RNScalar R3PoissonReconstruction::
+Value(const R3Point& position) const
+{
+  // Check levels
+  if (nlevels == 0) return 0;
+
+  // Return implicit function at position
+  R3Point p = UnitPosition(position);
+  return EvaluateUnit(levels, nlevels, p.X(), p.Y(), p.Z());
+}
+
+
+
+RNScalar R3PoissonReconstruction::
+DensityDepth(const R3Point& unit_position) const
+{
+  // Return deepest level with leaves in a cell next to position
+  for (int l = nlevels - 1; l >= 0; l--) {
+    const R3PoissonLevel *level = &levels[l];
+    int resolution = 1 << level->depth;
+    int i = (int) floor(unit_position.X() * resolution);
+    int j = (int) floor(unit_position.Y() * resolution);
+    int k = (int) floor(unit_position.Z() * resolution);
+    for (int dk = -1; dk <= 1; dk++) {
+      if ((k + dk < 0) || (k + dk >= resolution)) continue;
+      for (int dj = -1; dj <= 1; dj++) {
+        if ((j + dj < 0) || (j + dj >= resolution)) continue;
+        for (int di = -1; di <= 1; di++) {
+          if ((i + di < 0) || (i + di >= resolution)) continue;
+          int cell = FindHash(level->cell_hash, PackKey(i + di, j + dj, k + dk));
+          if ((cell >= 0) && (level->cell_nleaves[cell] > 0)) return level->depth;
+        }
+      }
+    }
+  }
+
+  // No leaves nearby
+  return 0;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Surface extraction
+////////////////////////////////////////////////////////////////////////
+
+struct PoissonExtractData {
+  // Reconstruction
+  const R3PoissonReconstruction *poisson;
+  const R3PoissonLevel *level;
+
+  // Values at corners that are not at finest level
+  R3PoissonHash *corner_hash;
+  RNUInt64 *corner_keys;
+  double *corner_values;
+  int ncorners;
+
+  // Vertices on edges (world position and density)
+  R3PoissonHash *vertex_hash;
+  RNUInt64 *vertex_keys;
+  double *vertex_data;
+  int nvertices;
+};
+
+
+
+static double
+ExtractCornerValue(PoissonExtractData *extract_data, int i, int j, int k)
+{
+  // Return value at corner of finest level
+  const R3PoissonLevel *level = extract_data->level;
+  RNUInt64 key = PackKey(i, j, k);
+  int corner = FindHash(level->corner_hash, key);
+  if (corner >= 0) return level->values[corner];
+
+  // Return value at other corner (evaluated at coarser levels the first time)
+  int capacity = KeyArrayCapacity(extract_data->ncorners);
+  int index = InsertKey(extract_data->corner_hash, key, extract_data->corner_keys, extract_data->ncorners, capacity);
+  if (index == extract_data->ncorners - 1) {
+    if (capacity > KeyArrayCapacity(index)) {
+      double *values = new double [ capacity ];
+      for (int m = 0; m < index; m++) values[m] = extract_data->corner_values[m];
+      if (extract_data->corner_values) delete [] extract_data->corner_values;
+      extract_data->corner_values = values;
+    }
+    const R3PoissonReconstruction *poisson = extract_data->poisson;
+    double n = 1 << level->depth;
+    extract_data->corner_values[index] = EvaluateUnit(poisson->levels, poisson->nlevels, i / n, j / n, k / n);
+  }
+  return extract_data->corner_values[index];
+}
+
+
+
+static int
+ExtractEdgeVertex(PoissonExtractData *extract_data, int i, int j, int k, int axis,
+  double value0, double value1, double iso_value)
+{
+  // Return existing vertex on edge
+  RNUInt64 key = (PackKey(i, j, k) << 2) | (RNUInt64) axis;
+  int capacity = KeyArrayCapacity(extract_data->nvertices);
+  int index = InsertKey(extract_data->vertex_hash, key, extract_data->vertex_keys, extract_data->nvertices, capacity);
+  if (index < extract_data->nvertices - 1) return index;
+
+  // Grow vertex data along with keys
+  if (capacity > KeyArrayCapacity(index)) {
+    double *data = new double [ 4 * capacity ];
+    for (int m = 0; m < 4 * index; m++) data[m] = extract_data->vertex_data[m];
+    if (extract_data->vertex_data) delete [] extract_data->vertex_data;
+    extract_data->vertex_data = data;
+  }
+
+  // Compute position where value crosses iso value
+  const R3PoissonReconstruction *poisson = extract_data->poisson;
+  double n = 1 << extract_data->level->depth;
+  double t = (value1 != value0) ? (iso_value - value0) / (value1 - value0) : 0.5;
+  if (t < 0) t = 0;
+  else if (t > 1) t = 1;
+  double u[3] = { i / n, j / n, k / n };
+  u[axis] += t / n;
+  R3Point unit_position(u[0], u[1], u[2]);
+  double *data = &extract_data->vertex_data[4*index];
+  data[0] = poisson->origin.X() + poisson->scale * u[0];
+  data[1] = poisson->origin.Y() + poisson->scale * u[1];
+  data[2] = poisson->origin.Z() + poisson->scale * u[2];
+  data[3] = poisson->DensityDepth(unit_position);
+
+  // Return new vertex
+  return index;
+}
+
+
+
+int R3PoissonReconstruction::
+ExtractSurface(R3Mesh *mesh) const
+{
+  // Initialize marching cubes edge table
+  static const int edgeTable[256]={
+    0x0  , 0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c,
+    0x80c, 0x905, 0xa0f, 0xb06, 0xc0a, 0xd03, 0xe09, 0xf00,
+    0x190, 0x99 , 0x393, 0x29a, 0x596, 0x49f, 0x795, 0x69c,
+    0x99c, 0x895, 0xb9f, 0xa96, 0xd9a, 0xc93, 0xf99, 0xe90,
+    0x230, 0x339, 0x33 , 0x13a, 0x636, 0x73f, 0x435, 0x53c,
+    0xa3c, 0xb35, 0x83f, 0x936, 0xe3a, 0xf33, 0xc39, 0xd30,
+    0x3a0, 0x2a9, 0x1a3, 0xaa , 0x7a6, 0x6af, 0x5a5, 0x4ac,
+    0xbac, 0xaa5, 0x9af, 0x8a6, 0xfaa, 0xea3, 0xda9, 0xca0,
+    0x460, 0x569, 0x663, 0x76a, 0x66 , 0x16f, 0x265, 0x36c,
+    0xc6c, 0xd65, 0xe6f, 0xf66, 0x86a, 0x963, 0xa69, 0xb60,
+    0x5f0, 0x4f9, 0x7f3, 0x6fa, 0x1f6, 0xff , 0x3f5, 0x2fc,
+    0xdfc, 0xcf5, 0xfff, 0xef6, 0x9fa, 0x8f3, 0xbf9, 0xaf0,
+    0x650, 0x759, 0x453, 0x55a, 0x256, 0x35f, 0x55 , 0x15c,
+    0xe5c, 0xf55, 0xc5f, 0xd56, 0xa5a, 0xb53, 0x859, 0x950,
+    0x7c0, 0x6c9, 0x5c3, 0x4ca, 0x3c6, 0x2cf, 0x1c5, 0xcc ,
+    0xfcc, 0xec5, 0xdcf, 0xcc6, 0xbca, 0xac3, 0x9c9, 0x8c0,
+    0x8c0, 0x9c9, 0xac3, 0xbca, 0xcc6, 0xdcf, 0xec5, 0xfcc,
+    0xcc , 0x1c5, 0x2cf, 0x3c6, 0x4ca, 0x5c3, 0x6c9, 0x7c0,
+    0x950, 0x859, 0xb53, 0xa5a, 0xd56, 0xc5f, 0xf55, 0xe5c,
+    0x15c, 0x55 , 0x35f, 0x256, 0x55a, 0x453, 0x759, 0x650,
+    0xaf0, 0xbf9, 0x8f3, 0x9fa, 0xef6, 0xfff, 0xcf5, 0xdfc,
+    0x2fc, 0x3f5, 0xff , 0x1f6, 0x6fa, 0x7f3, 0x4f9, 0x5f0,
+    0xb60, 0xa69, 0x963, 0x86a, 0xf66, 0xe6f, 0xd65, 0xc6c,
+    0x36c, 0x265, 0x16f, 0x66 , 0x76a, 0x663, 0x569, 0x460,
+    0xca0, 0xda9, 0xea3, 0xfaa, 0x8a6, 0x9af, 0xaa5, 0xbac,
+    0x4ac, 0x5a5, 0x6af, 0x7a6, 0xaa , 0x1a3, 0x2a9, 0x3a0,
+    0xd30, 0xc39, 0xf33, 0xe3a, 0x936, 0x83f, 0xb35, 0xa3c,
+    0x53c, 0x435, 0x73f, 0x636, 0x13a, 0x33 , 0x339, 0x230,
+    0xe90, 0xf99, 0xc93, 0xd9a, 0xa96, 0xb9f, 0x895, 0x99c,
+    0x69c, 0x795, 0x49f, 0x596, 0x29a, 0x393, 0x99 , 0x190,
+    0xf00, 0xe09, 0xd03, 0xc0a, 0xb06, 0xa0f, 0x905, 0x80c,
+    0x70c, 0x605, 0x50f, 0x406, 0x30a, 0x203, 0x109, 0x0   
+  };
+
+  // Initialize marching cubes triangle table
+  static const int triTable[256][16] =
+    {{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 1, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 8, 3, 9, 8, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 8, 3, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {9, 2, 10, 0, 2, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {2, 8, 3, 2, 10, 8, 10, 9, 8, -1, -1, -1, -1, -1, -1, -1},
+     {3, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 11, 2, 8, 11, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 9, 0, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 11, 2, 1, 9, 11, 9, 8, 11, -1, -1, -1, -1, -1, -1, -1},
+     {3, 10, 1, 11, 10, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 10, 1, 0, 8, 10, 8, 11, 10, -1, -1, -1, -1, -1, -1, -1},
+     {3, 9, 0, 3, 11, 9, 11, 10, 9, -1, -1, -1, -1, -1, -1, -1},
+     {9, 8, 10, 10, 8, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {4, 3, 0, 7, 3, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 1, 9, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {4, 1, 9, 4, 7, 1, 7, 3, 1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 2, 10, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {3, 4, 7, 3, 0, 4, 1, 2, 10, -1, -1, -1, -1, -1, -1, -1},
+     {9, 2, 10, 9, 0, 2, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1},
+     {2, 10, 9, 2, 9, 7, 2, 7, 3, 7, 9, 4, -1, -1, -1, -1},
+     {8, 4, 7, 3, 11, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {11, 4, 7, 11, 2, 4, 2, 0, 4, -1, -1, -1, -1, -1, -1, -1},
+     {9, 0, 1, 8, 4, 7, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1},
+     {4, 7, 11, 9, 4, 11, 9, 11, 2, 9, 2, 1, -1, -1, -1, -1},
+     {3, 10, 1, 3, 11, 10, 7, 8, 4, -1, -1, -1, -1, -1, -1, -1},
+     {1, 11, 10, 1, 4, 11, 1, 0, 4, 7, 11, 4, -1, -1, -1, -1},
+     {4, 7, 8, 9, 0, 11, 9, 11, 10, 11, 0, 3, -1, -1, -1, -1},
+     {4, 7, 11, 4, 11, 9, 9, 11, 10, -1, -1, -1, -1, -1, -1, -1},
+     {9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {9, 5, 4, 0, 8, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 5, 4, 1, 5, 0, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {8, 5, 4, 8, 3, 5, 3, 1, 5, -1, -1, -1, -1, -1, -1, -1},
+     {1, 2, 10, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {3, 0, 8, 1, 2, 10, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+     {5, 2, 10, 5, 4, 2, 4, 0, 2, -1, -1, -1, -1, -1, -1, -1},
+     {2, 10, 5, 3, 2, 5, 3, 5, 4, 3, 4, 8, -1, -1, -1, -1},
+     {9, 5, 4, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 11, 2, 0, 8, 11, 4, 9, 5, -1, -1, -1, -1, -1, -1, -1},
+     {0, 5, 4, 0, 1, 5, 2, 3, 11, -1, -1, -1, -1, -1, -1, -1},
+     {2, 1, 5, 2, 5, 8, 2, 8, 11, 4, 8, 5, -1, -1, -1, -1},
+     {10, 3, 11, 10, 1, 3, 9, 5, 4, -1, -1, -1, -1, -1, -1, -1},
+     {4, 9, 5, 0, 8, 1, 8, 10, 1, 8, 11, 10, -1, -1, -1, -1},
+     {5, 4, 0, 5, 0, 11, 5, 11, 10, 11, 0, 3, -1, -1, -1, -1},
+     {5, 4, 8, 5, 8, 10, 10, 8, 11, -1, -1, -1, -1, -1, -1, -1},
+     {9, 7, 8, 5, 7, 9, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {9, 3, 0, 9, 5, 3, 5, 7, 3, -1, -1, -1, -1, -1, -1, -1},
+     {0, 7, 8, 0, 1, 7, 1, 5, 7, -1, -1, -1, -1, -1, -1, -1},
+     {1, 5, 3, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {9, 7, 8, 9, 5, 7, 10, 1, 2, -1, -1, -1, -1, -1, -1, -1},
+     {10, 1, 2, 9, 5, 0, 5, 3, 0, 5, 7, 3, -1, -1, -1, -1},
+     {8, 0, 2, 8, 2, 5, 8, 5, 7, 10, 5, 2, -1, -1, -1, -1},
+     {2, 10, 5, 2, 5, 3, 3, 5, 7, -1, -1, -1, -1, -1, -1, -1},
+     {7, 9, 5, 7, 8, 9, 3, 11, 2, -1, -1, -1, -1, -1, -1, -1},
+     {9, 5, 7, 9, 7, 2, 9, 2, 0, 2, 7, 11, -1, -1, -1, -1},
+     {2, 3, 11, 0, 1, 8, 1, 7, 8, 1, 5, 7, -1, -1, -1, -1},
+     {11, 2, 1, 11, 1, 7, 7, 1, 5, -1, -1, -1, -1, -1, -1, -1},
+     {9, 5, 8, 8, 5, 7, 10, 1, 3, 10, 3, 11, -1, -1, -1, -1},
+     {5, 7, 0, 5, 0, 9, 7, 11, 0, 1, 0, 10, 11, 10, 0, -1},
+     {11, 10, 0, 11, 0, 3, 10, 5, 0, 8, 0, 7, 5, 7, 0, -1},
+     {11, 10, 5, 7, 11, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 8, 3, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {9, 0, 1, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 8, 3, 1, 9, 8, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
+     {1, 6, 5, 2, 6, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 6, 5, 1, 2, 6, 3, 0, 8, -1, -1, -1, -1, -1, -1, -1},
+     {9, 6, 5, 9, 0, 6, 0, 2, 6, -1, -1, -1, -1, -1, -1, -1},
+     {5, 9, 8, 5, 8, 2, 5, 2, 6, 3, 2, 8, -1, -1, -1, -1},
+     {2, 3, 11, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {11, 0, 8, 11, 2, 0, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1},
+     {0, 1, 9, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1, -1, -1, -1},
+     {5, 10, 6, 1, 9, 2, 9, 11, 2, 9, 8, 11, -1, -1, -1, -1},
+     {6, 3, 11, 6, 5, 3, 5, 1, 3, -1, -1, -1, -1, -1, -1, -1},
+     {0, 8, 11, 0, 11, 5, 0, 5, 1, 5, 11, 6, -1, -1, -1, -1},
+     {3, 11, 6, 0, 3, 6, 0, 6, 5, 0, 5, 9, -1, -1, -1, -1},
+     {6, 5, 9, 6, 9, 11, 11, 9, 8, -1, -1, -1, -1, -1, -1, -1},
+     {5, 10, 6, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {4, 3, 0, 4, 7, 3, 6, 5, 10, -1, -1, -1, -1, -1, -1, -1},
+     {1, 9, 0, 5, 10, 6, 8, 4, 7, -1, -1, -1, -1, -1, -1, -1},
+     {10, 6, 5, 1, 9, 7, 1, 7, 3, 7, 9, 4, -1, -1, -1, -1},
+     {6, 1, 2, 6, 5, 1, 4, 7, 8, -1, -1, -1, -1, -1, -1, -1},
+     {1, 2, 5, 5, 2, 6, 3, 0, 4, 3, 4, 7, -1, -1, -1, -1},
+     {8, 4, 7, 9, 0, 5, 0, 6, 5, 0, 2, 6, -1, -1, -1, -1},
+     {7, 3, 9, 7, 9, 4, 3, 2, 9, 5, 9, 6, 2, 6, 9, -1},
+     {3, 11, 2, 7, 8, 4, 10, 6, 5, -1, -1, -1, -1, -1, -1, -1},
+     {5, 10, 6, 4, 7, 2, 4, 2, 0, 2, 7, 11, -1, -1, -1, -1},
+     {0, 1, 9, 4, 7, 8, 2, 3, 11, 5, 10, 6, -1, -1, -1, -1},
+     {9, 2, 1, 9, 11, 2, 9, 4, 11, 7, 11, 4, 5, 10, 6, -1},
+     {8, 4, 7, 3, 11, 5, 3, 5, 1, 5, 11, 6, -1, -1, -1, -1},
+     {5, 1, 11, 5, 11, 6, 1, 0, 11, 7, 11, 4, 0, 4, 11, -1},
+     {0, 5, 9, 0, 6, 5, 0, 3, 6, 11, 6, 3, 8, 4, 7, -1},
+     {6, 5, 9, 6, 9, 11, 4, 7, 9, 7, 11, 9, -1, -1, -1, -1},
+     {10, 4, 9, 6, 4, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {4, 10, 6, 4, 9, 10, 0, 8, 3, -1, -1, -1, -1, -1, -1, -1},
+     {10, 0, 1, 10, 6, 0, 6, 4, 0, -1, -1, -1, -1, -1, -1, -1},
+     {8, 3, 1, 8, 1, 6, 8, 6, 4, 6, 1, 10, -1, -1, -1, -1},
+     {1, 4, 9, 1, 2, 4, 2, 6, 4, -1, -1, -1, -1, -1, -1, -1},
+     {3, 0, 8, 1, 2, 9, 2, 4, 9, 2, 6, 4, -1, -1, -1, -1},
+     {0, 2, 4, 4, 2, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {8, 3, 2, 8, 2, 4, 4, 2, 6, -1, -1, -1, -1, -1, -1, -1},
+     {10, 4, 9, 10, 6, 4, 11, 2, 3, -1, -1, -1, -1, -1, -1, -1},
+     {0, 8, 2, 2, 8, 11, 4, 9, 10, 4, 10, 6, -1, -1, -1, -1},
+     {3, 11, 2, 0, 1, 6, 0, 6, 4, 6, 1, 10, -1, -1, -1, -1},
+     {6, 4, 1, 6, 1, 10, 4, 8, 1, 2, 1, 11, 8, 11, 1, -1},
+     {9, 6, 4, 9, 3, 6, 9, 1, 3, 11, 6, 3, -1, -1, -1, -1},
+     {8, 11, 1, 8, 1, 0, 11, 6, 1, 9, 1, 4, 6, 4, 1, -1},
+     {3, 11, 6, 3, 6, 0, 0, 6, 4, -1, -1, -1, -1, -1, -1, -1},
+     {6, 4, 8, 11, 6, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {7, 10, 6, 7, 8, 10, 8, 9, 10, -1, -1, -1, -1, -1, -1, -1},
+     {0, 7, 3, 0, 10, 7, 0, 9, 10, 6, 7, 10, -1, -1, -1, -1},
+     {10, 6, 7, 1, 10, 7, 1, 7, 8, 1, 8, 0, -1, -1, -1, -1},
+     {10, 6, 7, 10, 7, 1, 1, 7, 3, -1, -1, -1, -1, -1, -1, -1},
+     {1, 2, 6, 1, 6, 8, 1, 8, 9, 8, 6, 7, -1, -1, -1, -1},
+     {2, 6, 9, 2, 9, 1, 6, 7, 9, 0, 9, 3, 7, 3, 9, -1},
+     {7, 8, 0, 7, 0, 6, 6, 0, 2, -1, -1, -1, -1, -1, -1, -1},
+     {7, 3, 2, 6, 7, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {2, 3, 11, 10, 6, 8, 10, 8, 9, 8, 6, 7, -1, -1, -1, -1},
+     {2, 0, 7, 2, 7, 11, 0, 9, 7, 6, 7, 10, 9, 10, 7, -1},
+     {1, 8, 0, 1, 7, 8, 1, 10, 7, 6, 7, 10, 2, 3, 11, -1},
+     {11, 2, 1, 11, 1, 7, 10, 6, 1, 6, 7, 1, -1, -1, -1, -1},
+     {8, 9, 6, 8, 6, 7, 9, 1, 6, 11, 6, 3, 1, 3, 6, -1},
+     {0, 9, 1, 11, 6, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {7, 8, 0, 7, 0, 6, 3, 11, 0, 11, 6, 0, -1, -1, -1, -1},
+     {7, 11, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {7, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {3, 0, 8, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 1, 9, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {8, 1, 9, 8, 3, 1, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1},
+     {10, 1, 2, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 2, 10, 3, 0, 8, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+     {2, 9, 0, 2, 10, 9, 6, 11, 7, -1, -1, -1, -1, -1, -1, -1},
+     {6, 11, 7, 2, 10, 3, 10, 8, 3, 10, 9, 8, -1, -1, -1, -1},
+     {7, 2, 3, 6, 2, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {7, 0, 8, 7, 6, 0, 6, 2, 0, -1, -1, -1, -1, -1, -1, -1},
+     {2, 7, 6, 2, 3, 7, 0, 1, 9, -1, -1, -1, -1, -1, -1, -1},
+     {1, 6, 2, 1, 8, 6, 1, 9, 8, 8, 7, 6, -1, -1, -1, -1},
+     {10, 7, 6, 10, 1, 7, 1, 3, 7, -1, -1, -1, -1, -1, -1, -1},
+     {10, 7, 6, 1, 7, 10, 1, 8, 7, 1, 0, 8, -1, -1, -1, -1},
+     {0, 3, 7, 0, 7, 10, 0, 10, 9, 6, 10, 7, -1, -1, -1, -1},
+     {7, 6, 10, 7, 10, 8, 8, 10, 9, -1, -1, -1, -1, -1, -1, -1},
+     {6, 8, 4, 11, 8, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {3, 6, 11, 3, 0, 6, 0, 4, 6, -1, -1, -1, -1, -1, -1, -1},
+     {8, 6, 11, 8, 4, 6, 9, 0, 1, -1, -1, -1, -1, -1, -1, -1},
+     {9, 4, 6, 9, 6, 3, 9, 3, 1, 11, 3, 6, -1, -1, -1, -1},
+     {6, 8, 4, 6, 11, 8, 2, 10, 1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 2, 10, 3, 0, 11, 0, 6, 11, 0, 4, 6, -1, -1, -1, -1},
+     {4, 11, 8, 4, 6, 11, 0, 2, 9, 2, 10, 9, -1, -1, -1, -1},
+     {10, 9, 3, 10, 3, 2, 9, 4, 3, 11, 3, 6, 4, 6, 3, -1},
+     {8, 2, 3, 8, 4, 2, 4, 6, 2, -1, -1, -1, -1, -1, -1, -1},
+     {0, 4, 2, 4, 6, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 9, 0, 2, 3, 4, 2, 4, 6, 4, 3, 8, -1, -1, -1, -1},
+     {1, 9, 4, 1, 4, 2, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1},
+     {8, 1, 3, 8, 6, 1, 8, 4, 6, 6, 10, 1, -1, -1, -1, -1},
+     {10, 1, 0, 10, 0, 6, 6, 0, 4, -1, -1, -1, -1, -1, -1, -1},
+     {4, 6, 3, 4, 3, 8, 6, 10, 3, 0, 3, 9, 10, 9, 3, -1},
+     {10, 9, 4, 6, 10, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {4, 9, 5, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 8, 3, 4, 9, 5, 11, 7, 6, -1, -1, -1, -1, -1, -1, -1},
+     {5, 0, 1, 5, 4, 0, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1},
+     {11, 7, 6, 8, 3, 4, 3, 5, 4, 3, 1, 5, -1, -1, -1, -1},
+     {9, 5, 4, 10, 1, 2, 7, 6, 11, -1, -1, -1, -1, -1, -1, -1},
+     {6, 11, 7, 1, 2, 10, 0, 8, 3, 4, 9, 5, -1, -1, -1, -1},
+     {7, 6, 11, 5, 4, 10, 4, 2, 10, 4, 0, 2, -1, -1, -1, -1},
+     {3, 4, 8, 3, 5, 4, 3, 2, 5, 10, 5, 2, 11, 7, 6, -1},
+     {7, 2, 3, 7, 6, 2, 5, 4, 9, -1, -1, -1, -1, -1, -1, -1},
+     {9, 5, 4, 0, 8, 6, 0, 6, 2, 6, 8, 7, -1, -1, -1, -1},
+     {3, 6, 2, 3, 7, 6, 1, 5, 0, 5, 4, 0, -1, -1, -1, -1},
+     {6, 2, 8, 6, 8, 7, 2, 1, 8, 4, 8, 5, 1, 5, 8, -1},
+     {9, 5, 4, 10, 1, 6, 1, 7, 6, 1, 3, 7, -1, -1, -1, -1},
+     {1, 6, 10, 1, 7, 6, 1, 0, 7, 8, 7, 0, 9, 5, 4, -1},
+     {4, 0, 10, 4, 10, 5, 0, 3, 10, 6, 10, 7, 3, 7, 10, -1},
+     {7, 6, 10, 7, 10, 8, 5, 4, 10, 4, 8, 10, -1, -1, -1, -1},
+     {6, 9, 5, 6, 11, 9, 11, 8, 9, -1, -1, -1, -1, -1, -1, -1},
+     {3, 6, 11, 0, 6, 3, 0, 5, 6, 0, 9, 5, -1, -1, -1, -1},
+     {0, 11, 8, 0, 5, 11, 0, 1, 5, 5, 6, 11, -1, -1, -1, -1},
+     {6, 11, 3, 6, 3, 5, 5, 3, 1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 2, 10, 9, 5, 11, 9, 11, 8, 11, 5, 6, -1, -1, -1, -1},
+     {0, 11, 3, 0, 6, 11, 0, 9, 6, 5, 6, 9, 1, 2, 10, -1},
+     {11, 8, 5, 11, 5, 6, 8, 0, 5, 10, 5, 2, 0, 2, 5, -1},
+     {6, 11, 3, 6, 3, 5, 2, 10, 3, 10, 5, 3, -1, -1, -1, -1},
+     {5, 8, 9, 5, 2, 8, 5, 6, 2, 3, 8, 2, -1, -1, -1, -1},
+     {9, 5, 6, 9, 6, 0, 0, 6, 2, -1, -1, -1, -1, -1, -1, -1},
+     {1, 5, 8, 1, 8, 0, 5, 6, 8, 3, 8, 2, 6, 2, 8, -1},
+     {1, 5, 6, 2, 1, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 3, 6, 1, 6, 10, 3, 8, 6, 5, 6, 9, 8, 9, 6, -1},
+     {10, 1, 0, 10, 0, 6, 9, 5, 0, 5, 6, 0, -1, -1, -1, -1},
+     {0, 3, 8, 5, 6, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {10, 5, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {11, 5, 10, 7, 5, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {11, 5, 10, 11, 7, 5, 8, 3, 0, -1, -1, -1, -1, -1, -1, -1},
+     {5, 11, 7, 5, 10, 11, 1, 9, 0, -1, -1, -1, -1, -1, -1, -1},
+     {10, 7, 5, 10, 11, 7, 9, 8, 1, 8, 3, 1, -1, -1, -1, -1},
+     {11, 1, 2, 11, 7, 1, 7, 5, 1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 8, 3, 1, 2, 7, 1, 7, 5, 7, 2, 11, -1, -1, -1, -1},
+     {9, 7, 5, 9, 2, 7, 9, 0, 2, 2, 11, 7, -1, -1, -1, -1},
+     {7, 5, 2, 7, 2, 11, 5, 9, 2, 3, 2, 8, 9, 8, 2, -1},
+     {2, 5, 10, 2, 3, 5, 3, 7, 5, -1, -1, -1, -1, -1, -1, -1},
+     {8, 2, 0, 8, 5, 2, 8, 7, 5, 10, 2, 5, -1, -1, -1, -1},
+     {9, 0, 1, 5, 10, 3, 5, 3, 7, 3, 10, 2, -1, -1, -1, -1},
+     {9, 8, 2, 9, 2, 1, 8, 7, 2, 10, 2, 5, 7, 5, 2, -1},
+     {1, 3, 5, 3, 7, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 8, 7, 0, 7, 1, 1, 7, 5, -1, -1, -1, -1, -1, -1, -1},
+     {9, 0, 3, 9, 3, 5, 5, 3, 7, -1, -1, -1, -1, -1, -1, -1},
+     {9, 8, 7, 5, 9, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {5, 8, 4, 5, 10, 8, 10, 11, 8, -1, -1, -1, -1, -1, -1, -1},
+     {5, 0, 4, 5, 11, 0, 5, 10, 11, 11, 3, 0, -1, -1, -1, -1},
+     {0, 1, 9, 8, 4, 10, 8, 10, 11, 10, 4, 5, -1, -1, -1, -1},
+     {10, 11, 4, 10, 4, 5, 11, 3, 4, 9, 4, 1, 3, 1, 4, -1},
+     {2, 5, 1, 2, 8, 5, 2, 11, 8, 4, 5, 8, -1, -1, -1, -1},
+     {0, 4, 11, 0, 11, 3, 4, 5, 11, 2, 11, 1, 5, 1, 11, -1},
+     {0, 2, 5, 0, 5, 9, 2, 11, 5, 4, 5, 8, 11, 8, 5, -1},
+     {9, 4, 5, 2, 11, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {2, 5, 10, 3, 5, 2, 3, 4, 5, 3, 8, 4, -1, -1, -1, -1},
+     {5, 10, 2, 5, 2, 4, 4, 2, 0, -1, -1, -1, -1, -1, -1, -1},
+     {3, 10, 2, 3, 5, 10, 3, 8, 5, 4, 5, 8, 0, 1, 9, -1},
+     {5, 10, 2, 5, 2, 4, 1, 9, 2, 9, 4, 2, -1, -1, -1, -1},
+     {8, 4, 5, 8, 5, 3, 3, 5, 1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 4, 5, 1, 0, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {8, 4, 5, 8, 5, 3, 9, 0, 5, 0, 3, 5, -1, -1, -1, -1},
+     {9, 4, 5, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {4, 11, 7, 4, 9, 11, 9, 10, 11, -1, -1, -1, -1, -1, -1, -1},
+     {0, 8, 3, 4, 9, 7, 9, 11, 7, 9, 10, 11, -1, -1, -1, -1},
+     {1, 10, 11, 1, 11, 4, 1, 4, 0, 7, 4, 11, -1, -1, -1, -1},
+     {3, 1, 4, 3, 4, 8, 1, 10, 4, 7, 4, 11, 10, 11, 4, -1},
+     {4, 11, 7, 9, 11, 4, 9, 2, 11, 9, 1, 2, -1, -1, -1, -1},
+     {9, 7, 4, 9, 11, 7, 9, 1, 11, 2, 11, 1, 0, 8, 3, -1},
+     {11, 7, 4, 11, 4, 2, 2, 4, 0, -1, -1, -1, -1, -1, -1, -1},
+     {11, 7, 4, 11, 4, 2, 8, 3, 4, 3, 2, 4, -1, -1, -1, -1},
+     {2, 9, 10, 2, 7, 9, 2, 3, 7, 7, 4, 9, -1, -1, -1, -1},
+     {9, 10, 7, 9, 7, 4, 10, 2, 7, 8, 7, 0, 2, 0, 7, -1},
+     {3, 7, 10, 3, 10, 2, 7, 4, 10, 1, 10, 0, 4, 0, 10, -1},
+     {1, 10, 2, 8, 7, 4, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {4, 9, 1, 4, 1, 7, 7, 1, 3, -1, -1, -1, -1, -1, -1, -1},
+     {4, 9, 1, 4, 1, 7, 0, 8, 1, 8, 7, 1, -1, -1, -1, -1},
+     {4, 0, 3, 7, 4, 3, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {4, 8, 7, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {9, 10, 8, 10, 11, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {3, 0, 9, 3, 9, 11, 11, 9, 10, -1, -1, -1, -1, -1, -1, -1},
+     {0, 1, 10, 0, 10, 8, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1},
+     {3, 1, 10, 11, 3, 10, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 2, 11, 1, 11, 9, 9, 11, 8, -1, -1, -1, -1, -1, -1, -1},
+     {3, 0, 9, 3, 9, 11, 1, 2, 9, 2, 11, 9, -1, -1, -1, -1},
+     {0, 2, 11, 8, 0, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {3, 2, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {2, 3, 8, 2, 8, 10, 10, 8, 9, -1, -1, -1, -1, -1, -1, -1},
+     {9, 10, 2, 0, 9, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {2, 3, 8, 2, 8, 10, 0, 1, 8, 1, 10, 8, -1, -1, -1, -1},
+     {1, 10, 2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {1, 3, 8, 9, 1, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 9, 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {0, 3, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1},
+     {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}};
+
+  // Corners of marching cubes edges (lower corner first) and their axes
+  static const int edge_corners[12][2] = {
+    { 0, 1 }, { 1, 2 }, { 3, 2 }, { 0, 3 }, { 4, 5 }, { 5, 6 },
+    { 7, 6 }, { 4, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 } };
+  static const int edge_axes[12] = { 0, 2, 0, 2, 0, 2, 0, 2, 1, 1, 1, 1 };
+
+  // Offsets of marching cubes corners
+  static const int corner_offsets[8][3] = {
+    { 0, 0, 0 }, { 1, 0, 0 }, { 1, 0, 1 }, { 0, 0, 1 },
+    { 0, 1, 0 }, { 1, 1, 0 }, { 1, 1, 1 }, { 0, 1, 1 } };
+
+  // Corners of cube sides and offsets of neighbor cells across them
+  static const int side_corners[6][4] = {
+    { 0, 3, 4, 7 }, { 1, 2, 5, 6 }, { 0, 1, 2, 3 },
+    { 4, 5, 6, 7 }, { 0, 1, 4, 5 }, { 2, 3, 6, 7 } };
+  static const int side_offsets[6][3] = {
+    { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 },
+    { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+
+  // Check levels
+  if (nlevels == 0) {
+    fprintf(stderr, "Poisson reconstruction has not been solved\n");
+    return -1;
+  }
+
+  // Initialize extraction data
+  const R3PoissonLevel *level = &levels[nlevels-1];
+  int resolution = 1 << level->depth;
+  PoissonExtractData extract_data;
+  extract_data.poisson = this;
+  extract_data.level = level;
+  extract_data.corner_hash = CreateHash(0);
+  extract_data.corner_keys = NULL;
+  extract_data.corner_values = NULL;
+  extract_data.ncorners = 0;
+  extract_data.vertex_hash = CreateHash(level->ncells);
+  extract_data.vertex_keys = NULL;
+  extract_data.vertex_data = NULL;
+  extract_data.nvertices = 0;
+
+  // Seed cells with leaves (visited cells are appended to array, which is also the queue)
+  R3PoissonHash *cell_hash = CreateHash(level->ncells);
+  RNUInt64 *cell_keys = NULL;
+  int ncells = 0, cell_capacity = 0;
+  for (int c = 0; c < level->ncells; c++) {
+    if (level->cell_nleaves[c] == 0) continue;
+    InsertKey(cell_hash, level->cell_keys[c], cell_keys, ncells, cell_capacity);
+  }
+
+  // March through cells, following surface across sides of cells
+  int *faces = NULL;
+  int nfaces = 0, face_capacity = 0;
+  for (int c = 0; c < ncells; c++) {
+    // Compute corner values
+    int i, j, k;
+    UnpackKey(cell_keys[c], i, j, k);
+    double values[8];
+    int cubeindex = 0;
+    for (int q = 0; q < 8; q++) {
+      values[q] = ExtractCornerValue(&extract_data,
+        i + corner_offsets[q][0], j + corner_offsets[q][1], k + corner_offsets[q][2]);
+      if (values[q] < iso_value) cubeindex |= (1 << q);
+    }
+
+    // Check if cube is entirely inside or outside surface
+    if (edgeTable[cubeindex] == 0) continue;
+
+    // Visit neighbor cells across sides crossed by surface
+    for (int side = 0; side < 6; side++) {
+      int count = 0;
+      for (int m = 0; m < 4; m++) if (cubeindex & (1 << side_corners[side][m])) count++;
+      if ((count == 0) || (count == 4)) continue;
+      int ni = i + side_offsets[side][0];
+      int nj = j + side_offsets[side][1];
+      int nk = k + side_offsets[side][2];
+      if ((ni < 0) || (nj < 0) || (nk < 0)) continue;
+      if ((ni >= resolution) || (nj >= resolution) || (nk >= resolution)) continue;
+      InsertKey(cell_hash, PackKey(ni, nj, nk), cell_keys, ncells, cell_capacity);
+    }
+
+    // Find vertices on edges crossed by surface
+    int vertlist[12];
+    for (int e = 0; e < 12; e++) {
+      if (!(edgeTable[cubeindex] & (1 << e))) continue;
+      int q0 = edge_corners[e][0], q1 = edge_corners[e][1];
+      vertlist[e] = ExtractEdgeVertex(&extract_data,
+        i + corner_offsets[q0][0], j + corner_offsets[q0][1], k + corner_offsets[q0][2],
+        edge_axes[e], values[q0], values[q1], iso_value);
+    }
+
+    // Add triangles
+    for (int m = 0; triTable[cubeindex][m] != -1; m += 3) {
+      if (nfaces == face_capacity) {
+        face_capacity = (face_capacity > 0) ? 2 * face_capacity : 1024;
+        int *new_faces = new int [ 3 * face_capacity ];
+        for (int f = 0; f < 3 * nfaces; f++) new_faces[f] = faces[f];
+        if (faces) delete [] faces;
+        faces = new_faces;
+      }
+      faces[3*nfaces+0] = vertlist[triTable[cubeindex][m+0]];
+      faces[3*nfaces+1] = vertlist[triTable[cubeindex][m+1]];
+      faces[3*nfaces+2] = vertlist[triTable[cubeindex][m+2]];
+      nfaces++;
+    }
+  }
+
+  // Create faces whose vertices are dense enough, with vertices as they are used
+  int nvertices = extract_data.nvertices;
+  const double *vertex_data = extract_data.vertex_data;
+  R3MeshVertex **vertices = new R3MeshVertex * [ nvertices + 1 ];
+  for (int v = 0; v < nvertices; v++) vertices[v] = NULL;
+  int ncreated = 0;
+  for (int f = 0; f < nfaces; f++) {
+    // Check densities
+    const int *face = &faces[3*f];
+    if (vertex_data[4*face[0]+3] < trim_depth) continue;
+    if (vertex_data[4*face[1]+3] < trim_depth) continue;
+    if (vertex_data[4*face[2]+3] < trim_depth) continue;
+
+    // Create vertices
+    R3MeshVertex *v[3];
+    for (int m = 0; m < 3; m++) {
+      int index = face[m];
+      if (!vertices[index]) {
+        const double *data = &vertex_data[4*index];
+        vertices[index] = mesh->CreateVertex(R3Point(data[0], data[1], data[2]));
+        mesh->SetVertexValue(vertices[index], data[3]);
+      }
+      v[m] = vertices[index];
+    }
+
+    // Create face
+    if (mesh->CreateFace(v[0], v[1], v[2])) ncreated++;
+  }
+
+  // Delete temporary memory
+  delete [] vertices;
+  if (faces) delete [] faces;
+  if (cell_keys) delete [] cell_keys;
+  DeleteHash(cell_hash);
+  if (extract_data.corner_keys) delete [] extract_data.corner_keys;
+  if (extract_data.corner_values) delete [] extract_data.corner_values;
+  DeleteHash(extract_data.corner_hash);
+  if (extract_data.vertex_keys) delete [] extract_data.vertex_keys;
+  if (extract_data.vertex_data) delete [] extract_data.vertex_data;
+  DeleteHash(extract_data.vertex_hash);
+
+  // Return number of faces created
+  return ncreated;
+}
@@ -0,0 +1,222 @@
+// Include file for screened Poisson surface reconstruction class
+
+
+
+// Internal structure declarations
+
+struct R3PoissonHash;
+struct R3PoissonLevel;
+
+
+
+// Class definition
+
+class R3PoissonReconstruction {
+public:
+  // Constructors/destructors
+  R3PoissonReconstruction(const R3Box& bbox, int max_depth = 8);
+    // The octree covers a cube around bbox, and points outside it are ignored.
+    // Octree cells at max_depth (at most 18) have width 1.1 * bbox.LongestAxisLength() / 2^max_depth
+    // The surface may stay open where it reaches the cube, so pass a larger bbox to close big holes
+  ~R3PoissonReconstruction(void);
+
+  // Property functions
+  const R3Box& BBox(void) const;
+  int MaxDepth(void) const;
+  int NThreads(void) const;
+  RNScalar ScreeningWeight(void) const;
+  int NIterations(void) const;
+  RNScalar TrimDepth(void) const;
+
+  // Parameter manipulation functions
+  void SetNThreads(int nthreads);
+  void SetScreeningWeight(RNScalar screening_weight);
+    // Weight pulling the implicit function to the iso value at the points (default 4, 0 for unscreened)
+  void SetNIterations(int niterations);
+    // Number of conjugate gradient iterations at every octree depth (default 8)
+  void SetTrimDepth(RNScalar trim_depth);
+    // Faces with a vertex whose density (the deepest octree depth with points in a cell next
+    // to it) is below the trim depth are not extracted (default 0, trimming nothing)
+
+  // Input functions
+  int InsertPoint(const R3Point& position, const R3Vector& normal, RNScalar weight = 1);
+  int InsertPoints(int npoints, const R3Point *positions, const R3Vector *normals, const RNScalar *weights = NULL);
+  int InsertPoints(R3Mesh *mesh);
+    // Points are merged into the octree leaf that contains them as they are inserted (so memory
+    // grows with the number of leaves, not of points), and normals should point outward.
+    // The mesh version inserts vertex positions and normals.  Return the number of points inserted
+
+  // Reconstruction functions
+  int Solve(void);
+    // Solves the screened Poisson equation coarse to fine (a cascadic multigrid with conjugate
+    // gradient iterations at every depth) on the cells near the points, with the coarser
+    // solution as boundary condition.  Returns 1 on success and 0 on error
+  RNScalar Value(const R3Point& position) const;
+    // Implicit function after Solve, below the iso value inside the surface
+  RNScalar IsoValue(void) const;
+    // Weighted average of the implicit function at the points
+  int ExtractSurface(R3Mesh *mesh) const;
+    // Adds the iso surface, marched through cells of max depth that are connected to the points
+    // (so holes in the input are closed), with shared vertices whose value is their density.
+    // Returns the number of faces created or -1 on error
+
+  // Statistics functions
+  int NInsertedPoints(void) const;
+  int NLeaves(void) const;
+    // Number of octree leaves with points
+  int NNodes(void) const;
+    // Number of octree cells in the solve, at all depths
+
+public:
+  // Internal functions
+  R3Point UnitPosition(const R3Point& position) const;
+  RNScalar DensityDepth(const R3Point& unit_position) const;
+
+public:
+  // Domain (world position is origin + scale * unit position)
+  R3Box bbox;
+  R3Point origin;
+  RNLength scale;
+
+  // Parameters
+  int max_depth;
+  int min_depth;
+  int nthreads;
+  RNScalar screening_weight;
+  int niterations;
+  RNScalar trim_depth;
+
+  // Leaves with points (keys of cells at max depth, and sums of unit positions, normals, and weights)
+  R3PoissonHash *leaf_hash;
+  RNUInt64 *leaf_keys;
+  double *leaf_sums;
+  int nleaves;
+  int ninserted_points;
+
+  // Octree levels from min_depth to max_depth (after Solve)
+  R3PoissonLevel *levels;
+  int nlevels;
+  RNScalar iso_value;
+};
+
+
+
+// Inline functions
+
+inline const R3Box& R3PoissonReconstruction::
+BBox(void) const
+{
+  // Return bounding box of points
+  return bbox;
+}
+
+
+
+inline int R3PoissonReconstruction::
+MaxDepth(void) const
+{
+  // Return depth of octree leaves
+  return max_depth;
+}
+
+
+
+inline int R3PoissonReconstruction::
+NThreads(void) const
+{
+  // Return number of threads (0 means RNNumberOfThreads())
+  return nthreads;
+}
+
+
+
+inline RNScalar R3PoissonReconstruction::
+ScreeningWeight(void) const
+{
+  // Return screening weight
+  return screening_weight;
+}
+
+
+
+inline int R3PoissonReconstruction::
+NIterations(void) const
+{
+  // Return number of solver iterations per depth
+  return niterations;
+}
+
+
+
+inline RNScalar R3PoissonReconstruction::
+TrimDepth(void) const
+{
+  // Return trim depth
+  return trim_depth;
+}
+
+
+
+inline void R3PoissonReconstruction::
+SetNThreads(int nthreads)
+{
+  // Set number of threads
+  this->nthreads = nthreads;
+}
+
+
+
+inline void R3PoissonReconstruction::
+SetScreeningWeight(RNScalar screening_weight)
+{
+  // Set screening weight
+  this->screening_weight = screening_weight;
+}
+
+
+
+inline void R3PoissonReconstruction::
+SetNIterations(int niterations)
+{
+  // Set number of solver iterations per depth
+  this->niterations = niterations;
+}
+
+
+
+inline void R3PoissonReconstruction::
+SetTrimDepth(RNScalar trim_depth)
+{
+  // Set trim depth
+  this->trim_depth = trim_depth;
+}
+
+
+
+inline RNScalar R3PoissonReconstruction::
+IsoValue(void) const
+{
+  // Return iso value
+  return iso_value;
+}
+
+
+
+inline int R3PoissonReconstruction::
+NInsertedPoints(void) const
+{
+  // Return number of points inserted
+  return ninserted_points;
+}
+
+
+
+inline int R3PoissonReconstruction::
+NLeaves(void) const
+{
+  // Return number of leaves with points
+  return nleaves;
+}
+
+
+
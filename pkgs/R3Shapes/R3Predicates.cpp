@@ -0,0 +1,368 @@
+/* Source file for R3 exact geometric predicates */
+
+
+
+/* Include files */
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+/* Floating point expansion arithmetic (Shewchuk, "Adaptive Precision Floating-Point
+   Arithmetic and Fast Robust Geometric Predicates") used when the error bound of the
+   floating point determinant cannot certify its sign */
+
+static const double predicate_epsilon = 1.1102230246251565e-16; // 2^-53
+static const double orient2_error_bound = (3.0 + 16.0 * predicate_epsilon) * predicate_epsilon;
+static const double orient3_error_bound = (7.0 + 56.0 * predicate_epsilon) * predicate_epsilon;
+
+
+
+static inline void
+TwoSum(double a, double b, double& x, double& y)
+{
+  // Compute x + y == a + b exactly, with x the rounded sum
+  x = a + b;
+  double bvirt = x - a;
+  double avirt = x - bvirt;
+  double bround = b - bvirt;
+  double around = a - avirt;
+  y = around + bround;
+}
+
+
+
+static inline void
+TwoProduct(double a, double b, double& x, double& y)
+{
+  // Compute x + y == a * b exactly, with x the rounded product
+  x = a * b;
+  y = fma(a, b, -x);
+}
+
+
+
+static inline RNBoolean
+IsExactDifference(double difference, double a, double b)
+{
+  // Return whether difference == a - b exactly
+  double bvirt = a - difference;
+  double avirt = difference + bvirt;
+  double bround = bvirt - b;
+  double around = a - avirt;
+  return ((around + bround) == 0) ? TRUE : FALSE;
+}
+
+
+
+static int
+GrowExpansion(int n, double *e, double b)
+{
+  // Add b to nonoverlapping expansion e (increasing magnitude), dropping zero components
+  int m = 0;
+  double q = b;
+  for (int i = 0; i < n; i++) {
+    double sum, error;
+    TwoSum(q, e[i], sum, error);
+    q = sum;
+    if (error != 0) e[m++] = error;
+  }
+  if ((q != 0) || (m == 0)) e[m++] = q;
+  return m;
+}
+
+
+
+static int
+AccumulateProduct(int n, double *e, double a, double b, double c, double sign)
+{
+  // Add sign * a * b * c to expansion e exactly (four components)
+  double x, y, p1, p2, p3, p4;
+  TwoProduct(a, b, x, y);
+  TwoProduct(sign * x, c, p1, p2);
+  TwoProduct(sign * y, c, p3, p4);
+  n = GrowExpansion(n, e, p4);
+  n = GrowExpansion(n, e, p3);
+  n = GrowExpansion(n, e, p2);
+  n = GrowExpansion(n, e, p1);
+  return n;
+}
+
+
+
+static int
+AccumulateDeterminant(int n, double *e, const double *a, const double *b, const double *c, double sign)
+{
+  // Add sign * det(a, b, c) (rows) to expansion e exactly
+  double ax = a[0], ay = a[1], az = a[2];
+  double bx = b[0], by = b[1], bz = b[2];
+  double cx = c[0], cy = c[1], cz = c[2];
+  n = AccumulateProduct(n, e, ax, by, cz, sign);
+  n = AccumulateProduct(n, e, ax, bz, cy, -sign);
+  n = AccumulateProduct(n, e, ay, bx, cz, -sign);
+  n = AccumulateProduct(n, e, ay, bz, cx, sign);
+  n = AccumulateProduct(n, e, az, bx, cy, sign);
+  n = AccumulateProduct(n, e, az, by, cx, -sign);
+  return n;
+}
+
+
+
+static int
+ExpansionSign(int n, const double *e)
+{
+  // Return sign of most significant component
+  double value = e[n-1];
+  if (value > 0) return 1;
+  else if (value < 0) return -1;
+  else return 0;
+}
+
+
+
+/* Orientation predicate functions */
+
+int
+R3Orientation(const R3Point& point1, const R3Point& point2, const R3Point& point3, const R3Point& point4)
+{
+  // Compute determinant in floating point
+  double ux = (double) point2.X() - (double) point1.X();
+  double uy = (double) point2.Y() - (double) point1.Y();
+  double uz = (double) point2.Z() - (double) point1.Z();
+  double vx = (double) point3.X() - (double) point1.X();
+  double vy = (double) point3.Y() - (double) point1.Y();
+  double vz = (double) point3.Z() - (double) point1.Z();
+  double wx = (double) point4.X() - (double) point1.X();
+  double wy = (double) point4.Y() - (double) point1.Y();
+  double wz = (double) point4.Z() - (double) point1.Z();
+  double vywz = vy * wz, vzwy = vz * wy;
+  double vzwx = vz * wx, vxwz = vx * wz;
+  double vxwy = vx * wy, vywx = vy * wx;
+  double det = ux * (vywz - vzwy) + uy * (vzwx - vxwz) + uz * (vxwy - vywx);
+
+  // Return sign if it is certain
+  double permanent = (fabs(vywz) + fabs(vzwy)) * fabs(ux)
+    + (fabs(vzwx) + fabs(vxwz)) * fabs(uy)
+    + (fabs(vxwy) + fabs(vywx)) * fabs(uz);
+  double error_bound = orient3_error_bound * permanent;
+  if (det > error_bound) return 1;
+  if (-det > error_bound) return -1;
+
+  // Compute determinant of differences exactly if they were computed without round-off (common for
+  // coplanar points with few significant bits), or else expand the 4x4 homogeneous determinant into 3x3 ones
+  double e[128];
+  int n = 0;
+  if (IsExactDifference(ux, point2.X(), point1.X()) && IsExactDifference(uy, point2.Y(), point1.Y()) &&
+      IsExactDifference(uz, point2.Z(), point1.Z()) && IsExactDifference(vx, point3.X(), point1.X()) &&
+      IsExactDifference(vy, point3.Y(), point1.Y()) && IsExactDifference(vz, point3.Z(), point1.Z()) &&
+      IsExactDifference(wx, point4.X(), point1.X()) && IsExactDifference(wy, point4.Y(), point1.Y()) &&
+      IsExactDifference(wz, point4.Z(), point1.Z())) {
+    double u[3] = { ux, uy, uz };
+    double v[3] = { vx, vy, vz };
+    double w[3] = { wx, wy, wz };
+    n = AccumulateDeterminant(n, e, u, v, w, 1);
+    return ExpansionSign(n, e);
+  }
+  double p1[3] = { point1.X(), point1.Y(), point1.Z() };
+  double p2[3] = { point2.X(), point2.Y(), point2.Z() };
+  double p3[3] = { point3.X(), point3.Y(), point3.Z() };
+  double p4[3] = { point4.X(), point4.Y(), point4.Z() };
+  n = AccumulateDeterminant(n, e, p2, p3, p4, 1);
+  n = AccumulateDeterminant(n, e, p1, p3, p4, -1);
+  n = AccumulateDeterminant(n, e, p1, p2, p4, 1);
+  n = AccumulateDeterminant(n, e, p1, p2, p3, -1);
+  return ExpansionSign(n, e);
+}
+
+
+
+int
+R3Orientation(const R3Point& point1, const R3Point& point2, const R3Point& point3, RNDimension dim)
+{
+  // Get projected coordinates
+  RNDimension dim1 = (dim + 1) % 3;
+  RNDimension dim2 = (dim + 2) % 3;
+  double ax = point1[dim1], ay = point1[dim2];
+  double bx = point2[dim1], by = point2[dim2];
+  double cx = point3[dim1], cy = point3[dim2];
+
+  // Compute determinant in floating point
+  double left = (bx - ax) * (cy - ay);
+  double right = (by - ay) * (cx - ax);
+  double det = left - right;
+
+  // Return sign if it is certain
+  double error_bound = orient2_error_bound * (fabs(left) + fabs(right));
+  if (det > error_bound) return 1;
+  if (-det > error_bound) return -1;
+
+  // Compute determinant exactly from differences if they have no round-off, or else as (b x c) - (a x c) + (a x b)
+  double e[32];
+  int n = 0;
+  double x, y;
+  double ux = bx - ax, uy = by - ay, vx = cx - ax, vy = cy - ay;
+  if (IsExactDifference(ux, bx, ax) && IsExactDifference(uy, by, ay) &&
+      IsExactDifference(vx, cx, ax) && IsExactDifference(vy, cy, ay)) {
+    TwoProduct(ux, vy, x, y); n = GrowExpansion(n, e, y); n = GrowExpansion(n, e, x);
+    TwoProduct(-uy, vx, x, y); n = GrowExpansion(n, e, y); n = GrowExpansion(n, e, x);
+    return ExpansionSign(n, e);
+  }
+  TwoProduct(bx, cy, x, y); n = GrowExpansion(n, e, y); n = GrowExpansion(n, e, x);
+  TwoProduct(-by, cx, x, y); n = GrowExpansion(n, e, y); n = GrowExpansion(n, e, x);
+  TwoProduct(-ax, cy, x, y); n = GrowExpansion(n, e, y); n = GrowExpansion(n, e, x);
+  TwoProduct(ay, cx, x, y); n = GrowExpansion(n, e, y); n = GrowExpansion(n, e, x);
+  TwoProduct(ax, by, x, y); n = GrowExpansion(n, e, y); n = GrowExpansion(n, e, x);
+  TwoProduct(-ay, bx, x, y); n = GrowExpansion(n, e, y); n = GrowExpansion(n, e, x);
+  return ExpansionSign(n, e);
+}
+
+
+
+/* Triangle predicate functions */
+
+RNDimension
+R3ProjectionDimension(const R3Point& triangle0, const R3Point& triangle1, const R3Point& triangle2)
+{
+  // Return a dimension along which the triangle does not project to a degenerate one,
+  // trying the dominant normal direction first
+  R3Vector normal = (triangle1 - triangle0) % (triangle2 - triangle0);
+  RNDimension dim = normal.MaxDimension();
+  if (R3Orientation(triangle0, triangle1, triangle2, dim) != 0) return dim;
+  if (R3Orientation(triangle0, triangle1, triangle2, (dim + 1) % 3) != 0) return (dim + 1) % 3;
+  return (dim + 2) % 3;
+}
+
+
+
+static RNBoolean
+SegmentsIntersect(const R3Point& p0, const R3Point& p1, const R3Point& q0, const R3Point& q1, RNDimension dim)
+{
+  // Check sides of each segment with respect to the other
+  int o1 = R3Orientation(p0, p1, q0, dim);
+  int o2 = R3Orientation(p0, p1, q1, dim);
+  if (o1 * o2 > 0) return FALSE;
+  int o3 = R3Orientation(q0, q1, p0, dim);
+  int o4 = R3Orientation(q0, q1, p1, dim);
+  if (o3 * o4 > 0) return FALSE;
+  if ((o1 != 0) || (o2 != 0) || (o3 != 0) || (o4 != 0)) return TRUE;
+
+  // Segments are collinear, so check overlap of their projected extents
+  for (int k = 1; k <= 2; k++) {
+    RNDimension d = (dim + k) % 3;
+    RNCoord pmin = (p0[d] < p1[d]) ? p0[d] : p1[d];
+    RNCoord pmax = (p0[d] < p1[d]) ? p1[d] : p0[d];
+    RNCoord qmin = (q0[d] < q1[d]) ? q0[d] : q1[d];
+    RNCoord qmax = (q0[d] < q1[d]) ? q1[d] : q0[d];
+    if ((pmax < qmin) || (qmax < pmin)) return FALSE;
+  }
+
+  // Extents overlap
+  return TRUE;
+}
+
+
+
+static RNBoolean
+CoplanarTrianglesIntersect(const R3Point *a, const R3Point *b, RNDimension dim)
+{
+  // Check pairs of edges
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      if (SegmentsIntersect(a[i], a[(i+1)%3], b[j], b[(j+1)%3], dim)) return TRUE;
+    }
+  }
+
+  // Check containment of one triangle in the other
+  if (R3PointInTriangle(a[0], b[0], b[1], b[2], dim)) return TRUE;
+  if (R3PointInTriangle(b[0], a[0], a[1], a[2], dim)) return TRUE;
+  return FALSE;
+}
+
+
+
+RNBoolean
+R3PointInTriangle(const R3Point& point,
+  const R3Point& triangle0, const R3Point& triangle1, const R3Point& triangle2, RNDimension dim)
+{
+  // Check that point is not strictly outside any edge
+  int o1 = R3Orientation(triangle0, triangle1, point, dim);
+  int o2 = R3Orientation(triangle1, triangle2, point, dim);
+  if (o1 * o2 < 0) return FALSE;
+  int o3 = R3Orientation(triangle2, triangle0, point, dim);
+  if ((o1 * o3 < 0) || (o2 * o3 < 0)) return FALSE;
+  return TRUE;
+}
+
+
+
+RNBoolean
+R3SegmentIntersectsTriangle(const R3Point& segment0, const R3Point& segment1,
+  const R3Point& triangle0, const R3Point& triangle1, const R3Point& triangle2)
+{
+  // Check sides of segment endpoints with respect to triangle plane
+  int s0 = R3Orientation(triangle0, triangle1, triangle2, segment0);
+  int s1 = R3Orientation(triangle0, triangle1, triangle2, segment1);
+  if (s0 * s1 > 0) return FALSE;
+
+  // Check segment in plane of triangle
+  if ((s0 == 0) && (s1 == 0)) {
+    RNDimension dim = R3ProjectionDimension(triangle0, triangle1, triangle2);
+    if (R3PointInTriangle(segment0, triangle0, triangle1, triangle2, dim)) return TRUE;
+    if (SegmentsIntersect(segment0, segment1, triangle0, triangle1, dim)) return TRUE;
+    if (SegmentsIntersect(segment0, segment1, triangle1, triangle2, dim)) return TRUE;
+    if (SegmentsIntersect(segment0, segment1, triangle2, triangle0, dim)) return TRUE;
+    return FALSE;
+  }
+
+  // Check segment touching plane at one endpoint
+  if ((s0 == 0) || (s1 == 0)) {
+    const R3Point& point = (s0 == 0) ? segment0 : segment1;
+    RNDimension dim = R3ProjectionDimension(triangle0, triangle1, triangle2);
+    return R3PointInTriangle(point, triangle0, triangle1, triangle2, dim);
+  }
+
+  // Check segment crossing plane inside triangle (line passes the three edges on consistent sides)
+  int o1 = R3Orientation(segment0, segment1, triangle0, triangle1);
+  int o2 = R3Orientation(segment0, segment1, triangle1, triangle2);
+  if (o1 * o2 < 0) return FALSE;
+  int o3 = R3Orientation(segment0, segment1, triangle2, triangle0);
+  if ((o1 * o3 < 0) || (o2 * o3 < 0)) return FALSE;
+  return TRUE;
+}
+
+
+
+RNBoolean
+R3TrianglesIntersect(const R3Point& triangle0, const R3Point& triangle1, const R3Point& triangle2,
+  const R3Point& other0, const R3Point& other1, const R3Point& other2)
+{
+  // Check sides of other triangle with respect to plane of triangle
+  int a0 = R3Orientation(triangle0, triangle1, triangle2, other0);
+  int a1 = R3Orientation(triangle0, triangle1, triangle2, other1);
+  int a2 = R3Orientation(triangle0, triangle1, triangle2, other2);
+  if ((a0 * a1 > 0) && (a1 * a2 > 0)) return FALSE;
+
+  // Check coplanar triangles
+  if ((a0 == 0) && (a1 == 0) && (a2 == 0)) {
+    R3Point a[3] = { triangle0, triangle1, triangle2 };
+    R3Point b[3] = { other0, other1, other2 };
+    RNDimension dim = R3ProjectionDimension(triangle0, triangle1, triangle2);
+    return CoplanarTrianglesIntersect(a, b, dim);
+  }
+
+  // Check sides of triangle with respect to plane of other triangle
+  int b0 = R3Orientation(other0, other1, other2, triangle0);
+  int b1 = R3Orientation(other0, other1, other2, triangle1);
+  int b2 = R3Orientation(other0, other1, other2, triangle2);
+  if ((b0 * b1 > 0) && (b1 * b2 > 0)) return FALSE;
+
+  // Check edges of each triangle against the other (the intersection of non-coplanar
+  // triangles is a segment whose endpoints lie on edges of one or the other)
+  if (R3SegmentIntersectsTriangle(triangle0, triangle1, other0, other1, other2)) return TRUE;
+  if (R3SegmentIntersectsTriangle(triangle1, triangle2, other0, other1, other2)) return TRUE;
+  if (R3SegmentIntersectsTriangle(triangle2, triangle0, other0, other1, other2)) return TRUE;
+  if (R3SegmentIntersectsTriangle(other0, other1, triangle0, triangle1, triangle2)) return TRUE;
+  if (R3SegmentIntersectsTriangle(other1, other2, triangle0, triangle1, triangle2)) return TRUE;
+  if (R3SegmentIntersectsTriangle(other2, other0, triangle0, triangle1, triangle2)) return TRUE;
+  return FALSE;
+}
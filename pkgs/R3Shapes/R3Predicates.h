@@ -0,0 +1,36 @@
+/* Include file for R3 exact geometric predicates */
+
+
+
+/* Orientation predicate function declarations */
+
+int R3Orientation(const R3Point& point1, const R3Point& point2, const R3Point& point3, const R3Point& point4);
+  // Returns 1 if point4 is on the side of the plane through (point1, point2, point3) that their
+  // counterclockwise normal points to, -1 if it is on the other side, and 0 if the points are coplanar
+  // (sign of (point2-point1) % (point3-point1) . (point4-point1), computed exactly)
+
+int R3Orientation(const R3Point& point1, const R3Point& point2, const R3Point& point3, RNDimension dim);
+  // Returns 1 if (point1, point2, point3) are counterclockwise after dropping coordinate dim
+  // (viewed from the positive dim axis), -1 if clockwise, and 0 if collinear (computed exactly)
+
+
+
+/* Triangle predicate function declarations */
+
+RNDimension R3ProjectionDimension(const R3Point& triangle0, const R3Point& triangle1, const R3Point& triangle2);
+  // Returns a coordinate whose dropping leaves the triangle non-degenerate (trying the dominant
+  // normal direction first), or the last one tried if the triangle is degenerate in all three
+
+RNBoolean R3PointInTriangle(const R3Point& point,
+  const R3Point& triangle0, const R3Point& triangle1, const R3Point& triangle2, RNDimension dim);
+  // Returns whether a point coplanar with a triangle is inside or on its boundary,
+  // testing after dropping coordinate dim (the triangle must not be degenerate in that projection)
+
+RNBoolean R3SegmentIntersectsTriangle(const R3Point& segment0, const R3Point& segment1,
+  const R3Point& triangle0, const R3Point& triangle1, const R3Point& triangle2);
+  // Returns whether a segment and a non-degenerate triangle share any point (computed exactly)
+
+RNBoolean R3TrianglesIntersect(const R3Point& triangle0, const R3Point& triangle1, const R3Point& triangle2,
+  const R3Point& other0, const R3Point& other1, const R3Point& other2);
+  // Returns whether two non-degenerate triangles share any point (computed exactly)
+
@@ -0,0 +1,1361 @@
+/* Source file for the R3 progressive mesh class */
+
+
+
+/* Include files */
+
+#include "R3Shapes/R3Shapes.h"
+
+
+
+/* Parameters */
+
+// Number of vertex splits in every chunk of files
+static const int default_nsplits_per_chunk = 4096;
+
+// Weight of planes keeping boundaries in place during simplification (relative to planes of faces)
+static const RNScalar boundary_weight = 100;
+
+// Applied splits are collapsed when their errors project to less than this fraction of the maximum pixel error
+static const RNScalar collapse_fraction = 0.8;
+
+// Maximum number of faces around a vertex
+static const int max_fan_faces = 1024;
+
+// File format
+static const char file_magic[4] = { 'P', 'M', 'S', 'H' };
+static const int file_version = 1;
+
+
+
+/* Simplification data */
+
+struct R3ProgressiveMeshBuildVertex {
+  // Quadric (upper triangle of 4x4 matrix), error, and radius of vertex during simplification
+  RNScalar quadric[10];
+  RNScalar error;
+  RNScalar radius;
+};
+
+struct R3ProgressiveMeshBuildEdge {
+  // Best collapse of edge and its position in heap
+  R3MeshEdge *edge;
+  R3Point position;
+  RNScalar cost;
+  R3ProgressiveMeshBuildEdge **heappointer;
+};
+
+struct R3ProgressiveMeshBuildCollapse {
+  // Edge collapse with temporary vertex and face IDs (parent vertex of collapse k is nvertices + k)
+  int children[2];
+  int flags;
+  int faces[2];
+  int neighbors[4];
+  R3Point positions[2];
+  RNScalar error;
+  RNScalar radius;
+};
+
+struct R3ProgressiveMeshBuilder {
+  // Mesh being simplified and its temporary data
+  R3Mesh *mesh;
+  R3ProgressiveMeshBuildVertex *vertices;
+  R3ProgressiveMeshBuildEdge *edges;
+  int *face_ids;
+};
+
+
+
+/* Quadric functions */
+
+static void
+AddQuadric(RNScalar quadric[10], const R3Vector& normal, RNScalar d, RNScalar weight)
+{
+  // Add weighted squared distance to plane (normal, d)
+  RNScalar a = normal.X(), b = normal.Y(), c = normal.Z();
+  quadric[0] += weight * a * a; quadric[1] += weight * a * b; quadric[2] += weight * a * c; quadric[3] += weight * a * d;
+  quadric[4] += weight * b * b; quadric[5] += weight * b * c; quadric[6] += weight * b * d;
+  quadric[7] += weight * c * c; quadric[8] += weight * c * d;
+  quadric[9] += weight * d * d;
+}
+
+
+
+static RNScalar
+EvaluateQuadric(const RNScalar q[10], const R3Point& p)
+{
+  // Return weighted sum of squared distances to planes of quadric
+  RNScalar x = p.X(), y = p.Y(), z = p.Z();
+  RNScalar value = q[0]*x*x + 2*q[1]*x*y + 2*q[2]*x*z + 2*q[3]*x
+    + q[4]*y*y + 2*q[5]*y*z + 2*q[6]*y
+    + q[7]*z*z + 2*q[8]*z
+    + q[9];
+  return (value > 0) ? value : 0;
+}
+
+
+
+static RNBoolean
+MinimizeQuadric(const RNScalar q[10], R3Point *result)
+{
+  // Solve for point minimizing quadric (Cramer's rule), fail if system is badly conditioned
+  RNScalar a00 = q[0], a01 = q[1], a02 = q[2];
+  RNScalar a11 = q[4], a12 = q[5], a22 = q[7];
+  RNScalar b0 = -q[3], b1 = -q[6], b2 = -q[8];
+  RNScalar c00 = a11*a22 - a12*a12;
+  RNScalar c01 = a02*a12 - a01*a22;
+  RNScalar c02 = a01*a12 - a02*a11;
+  RNScalar det = a00*c00 + a01*c01 + a02*c02;
+  RNScalar scale = a00 + a11 + a22;
+  if (fabs(det) <= 1.0E-9 * scale * scale * scale) return FALSE;
+  RNScalar c11 = a00*a22 - a02*a02;
+  RNScalar c12 = a01*a02 - a00*a12;
+  RNScalar c22 = a00*a11 - a01*a01;
+  result->Reset((c00*b0 + c01*b1 + c02*b2) / det,
+    (c01*b0 + c11*b1 + c12*b2) / det,
+    (c02*b0 + c12*b1 + c22*b2) / det);
+  return TRUE;
+}
+
+
+
+/* Simplification functions */
+
+static R3ProgressiveMeshBuildVertex *
+BuildVertex(const R3ProgressiveMeshBuilder& builder, const R3MeshVertex *vertex)
+{
+  // Return simplification data of vertex
+  return (R3ProgressiveMeshBuildVertex *) builder.mesh->VertexData(vertex);
+}
+
+
+
+static int
+BuildVertexID(const R3ProgressiveMeshBuilder& builder, const R3MeshVertex *vertex)
+{
+  // Return temporary ID of vertex
+  return BuildVertex(builder, vertex) - builder.vertices;
+}
+
+
+
+static int
+BuildFaceID(const R3ProgressiveMeshBuilder& builder, const R3MeshFace *face)
+{
+  // Return temporary ID of face (-1 for none)
+  if (!face) return -1;
+  return (int *) builder.mesh->FaceData(face) - builder.face_ids;
+}
+
+
+
+static int
+FaceVertexIndex(R3Mesh *mesh, const R3MeshFace *face, const R3MeshVertex *vertex)
+{
+  // Return index of vertex on face
+  for (int i = 0; i < 3; i++) {
+    if (mesh->VertexOnFace(face, i) == vertex) return i;
+  }
+  return -1;
+}
+
+
+
+static R3Vector
+FaceCross(R3Mesh *mesh, const R3MeshFace *face, const R3MeshVertex *vertex, const R3Point& position)
+{
+  // Return cross product of face edges with vertex moved to position
+  R3Point p[3];
+  for (int i = 0; i < 3; i++) {
+    R3MeshVertex *v = mesh->VertexOnFace(face, i);
+    p[i] = (v == vertex) ? position : mesh->VertexPosition(v);
+  }
+  R3Vector cross = p[1] - p[0];
+  cross.Cross(p[2] - p[0]);
+  return cross;
+}
+
+
+
+static void
+InitializeBuildVertex(const R3ProgressiveMeshBuilder& builder, R3MeshVertex *vertex)
+{
+  // Sum quadrics of planes of faces (weighted by area) and of boundary edges
+  R3Mesh *mesh = builder.mesh;
+  R3ProgressiveMeshBuildVertex *data = BuildVertex(builder, vertex);
+  for (int i = 0; i < 10; i++) data->quadric[i] = 0;
+  data->error = 0;
+  data->radius = 0;
+  for (int i = 0; i < mesh->VertexValence(vertex); i++) {
+    R3MeshEdge *edge = mesh->EdgeOnVertex(vertex, i);
+    R3MeshFace *face = mesh->FaceOnEdge(edge, vertex, RN_CCW);
+    if (face) {
+      R3Vector normal = FaceCross(mesh, face, NULL, R3zero_point);
+      RNLength length = normal.Length();
+      if (RNIsPositive(length)) {
+        normal /= length;
+        RNScalar d = -normal.Dot(mesh->VertexPosition(vertex).Vector());
+        AddQuadric(data->quadric, normal, d, 0.5 * length);
+      }
+    }
+    if (mesh->IsEdgeOnBoundary(edge)) {
+      R3MeshFace *boundary_face = mesh->FaceOnEdge(edge);
+      if (!boundary_face) continue;
+      R3Vector direction = mesh->VertexPosition(mesh->VertexAcrossEdge(edge, vertex)) - mesh->VertexPosition(vertex);
+      RNLength length = direction.Length();
+      R3Vector normal = direction % FaceCross(mesh, boundary_face, NULL, R3zero_point);
+      if (!RNIsPositive(length) || !RNIsPositive(normal.Length())) continue;
+      normal.Normalize();
+      RNScalar d = -normal.Dot(mesh->VertexPosition(vertex).Vector());
+      AddQuadric(data->quadric, normal, d, boundary_weight * length * length);
+    }
+  }
+}
+
+
+
+static void
+UpdateBuildEdge(const R3ProgressiveMeshBuilder& builder, R3MeshEdge *edge, RNHeap<R3ProgressiveMeshBuildEdge *>& heap)
+{
+  // Get quadric of collapsed edge
+  R3Mesh *mesh = builder.mesh;
+  R3MeshVertex *v0 = mesh->VertexOnEdge(edge, 0);
+  R3MeshVertex *v1 = mesh->VertexOnEdge(edge, 1);
+  const RNScalar *q0 = BuildVertex(builder, v0)->quadric;
+  const RNScalar *q1 = BuildVertex(builder, v1)->quadric;
+  RNScalar q[10];
+  for (int i = 0; i < 10; i++) q[i] = q0[i] + q1[i];
+
+  // Find position minimizing quadric (or the best of the vertices and the midpoint)
+  R3ProgressiveMeshBuildEdge *data = (R3ProgressiveMeshBuildEdge *) mesh->EdgeData(edge);
+  const R3Point& p0 = mesh->VertexPosition(v0);
+  const R3Point& p1 = mesh->VertexPosition(v1);
+  R3Point position;
+  if (!MinimizeQuadric(q, &position) || (R3Distance(position, 0.5 * (p0 + p1)) > 2 * R3Distance(p0, p1))) {
+    R3Point candidates[3] = { p0, p1, 0.5 * (p0 + p1) };
+    position = candidates[2];
+    RNScalar best_cost = EvaluateQuadric(q, position);
+    for (int i = 0; i < 2; i++) {
+      RNScalar cost = EvaluateQuadric(q, candidates[i]);
+      if (cost < best_cost) { position = candidates[i]; best_cost = cost; }
+    }
+  }
+
+  // Update heap
+  data->position = position;
+  data->cost = EvaluateQuadric(q, position);
+  if (data->heappointer) heap.Update(data);
+  else heap.Push(data);
+}
+
+
+
+static RNBoolean
+CheckBuildCollapse(const R3ProgressiveMeshBuilder& builder, R3MeshEdge *edge, const R3Point& position,
+  R3ProgressiveMeshBuildCollapse *collapse)
+{
+  // Get vertices on edge
+  R3Mesh *mesh = builder.mesh;
+  R3MeshVertex *v[2];
+  v[0] = mesh->VertexOnEdge(edge, 0);
+  v[1] = mesh->VertexOnEdge(edge, 1);
+
+  // Find left face (v0, v1, vl) and right face (v1, v0, vr)
+  R3MeshFace *faces[2] = { NULL, NULL };
+  for (int k = 0; k < 2; k++) {
+    R3MeshFace *face = mesh->FaceOnEdge(edge, k);
+    if (!face) continue;
+    int i = FaceVertexIndex(mesh, face, v[0]);
+    if (mesh->VertexOnFace(face, (i + 1) % 3) == v[1]) faces[0] = face;
+    else faces[1] = face;
+  }
+  if (!faces[0] && !faces[1]) return FALSE;
+
+  // Find faces adjacent to left and right faces (each must have one, or its third vertex would be isolated)
+  R3MeshVertex *sides[2] = { NULL, NULL };
+  R3MeshFace *neighbors[4] = { NULL, NULL, NULL, NULL };
+  for (int k = 0; k < 2; k++) {
+    if (!faces[k]) continue;
+    R3MeshVertex *va = (k == 0) ? v[1] : v[0];
+    R3MeshVertex *vb = (k == 0) ? v[0] : v[1];
+    sides[k] = mesh->VertexAcrossFace(faces[k], edge);
+    neighbors[2*k+0] = mesh->FaceAcrossEdge(mesh->EdgeBetweenVertices(va, sides[k]), faces[k]);
+    neighbors[2*k+1] = mesh->FaceAcrossEdge(mesh->EdgeBetweenVertices(sides[k], vb), faces[k]);
+    if (!neighbors[2*k+0] && !neighbors[2*k+1]) return FALSE;
+  }
+
+  // Check link condition (vertices adjacent to both must be the ones across left and right faces)
+  int ncommon = 0;
+  for (int i = 0; i < mesh->VertexValence(v[0]); i++) {
+    R3MeshVertex *neighbor = mesh->VertexAcrossEdge(mesh->EdgeOnVertex(v[0], i), v[0]);
+    if (neighbor == v[1]) continue;
+    if (mesh->EdgeBetweenVertices(neighbor, v[1])) ncommon++;
+  }
+  if (ncommon != ((faces[0]) ? 1 : 0) + ((faces[1]) ? 1 : 0)) return FALSE;
+
+  // Check that faces around both vertices form one fan (splits walk across faces from the neighbors)
+  for (int k = 0; k < 2; k++) {
+    int nboundary_edges = 0;
+    for (int i = 0; i < mesh->VertexValence(v[k]); i++) {
+      if (mesh->IsEdgeOnBoundary(mesh->EdgeOnVertex(v[k], i))) nboundary_edges++;
+    }
+    if (nboundary_edges > 2) return FALSE;
+  }
+
+  // Check that faces do not flip, and find distance of position from their planes and boundaries
+  RNLength deviation = 0;
+  for (int k = 0; k < 2; k++) {
+    for (int i = 0; i < mesh->VertexValence(v[k]); i++) {
+      R3MeshEdge *e = mesh->EdgeOnVertex(v[k], i);
+      if (mesh->IsEdgeOnBoundary(e)) {
+        const R3Point& p0 = mesh->VertexPosition(mesh->VertexOnEdge(e, 0));
+        const R3Point& p1 = mesh->VertexPosition(mesh->VertexOnEdge(e, 1));
+        R3Vector direction = p1 - p0;
+        RNLength length = direction.Length();
+        if (RNIsPositive(length)) {
+          RNLength distance = ((position - p0) % direction).Length() / length;
+          if (distance > deviation) deviation = distance;
+        }
+      }
+      R3MeshFace *face = mesh->FaceOnEdge(e, v[k], RN_CCW);
+      if (!face) continue;
+      R3Vector n0 = FaceCross(mesh, face, NULL, R3zero_point);
+      RNLength l0 = n0.Length();
+      if (RNIsPositive(l0)) {
+        RNLength distance = fabs(n0.Dot(position - mesh->VertexPosition(v[k]))) / l0;
+        if (distance > deviation) deviation = distance;
+      }
+      if ((face == faces[0]) || (face == faces[1])) continue;
+      R3Vector n1 = FaceCross(mesh, face, v[k], position);
+      if (!RNIsPositive(n1.Length())) return FALSE;
+      if (n0.Dot(n1) <= 0) return FALSE;
+    }
+  }
+
+  // Fill collapse
+  for (int k = 0; k < 2; k++) {
+    const R3ProgressiveMeshBuildVertex *data = BuildVertex(builder, v[k]);
+    RNLength radius = R3Distance(position, mesh->VertexPosition(v[k])) + data->radius;
+    if ((k == 0) || (radius > collapse->radius)) collapse->radius = radius;
+    if ((k == 0) || (data->error > collapse->error)) collapse->error = data->error;
+    collapse->children[k] = BuildVertexID(builder, v[k]);
+    collapse->positions[k] = mesh->VertexPosition(v[k]);
+    collapse->faces[k] = BuildFaceID(builder, faces[k]);
+  }
+  collapse->error += deviation;
+  collapse->flags = 0;
+  if (faces[0]) collapse->flags |= R3_PROGRESSIVE_MESH_LEFT_FACE;
+  if (faces[1]) collapse->flags |= R3_PROGRESSIVE_MESH_RIGHT_FACE;
+  for (int k = 0; k < 4; k++) collapse->neighbors[k] = BuildFaceID(builder, neighbors[k]);
+
+  // Collapse is OK
+  return TRUE;
+}
+
+
+
+/* Refinement data */
+
+struct R3ProgressiveMeshCandidate {
+  // Split considered by Refine
+  int split_index;
+  RNScalar pixel_error;
+};
+
+
+
+static int
+CompareCandidates(const void *data1, const void *data2)
+{
+  // Sort candidates by decreasing pixel error
+  const R3ProgressiveMeshCandidate *candidate1 = (const R3ProgressiveMeshCandidate *) data1;
+  const R3ProgressiveMeshCandidate *candidate2 = (const R3ProgressiveMeshCandidate *) data2;
+  if (candidate1->pixel_error > candidate2->pixel_error) return -1;
+  if (candidate1->pixel_error < candidate2->pixel_error) return 1;
+  return 0;
+}
+
+
+
+/* Member functions */
+
+R3ProgressiveMesh::
+R3ProgressiveMesh(void)
+  : nbase_vertices(0),
+    nbase_faces(0),
+    nsplits(0),
+    nloaded_splits(0),
+    splits(NULL),
+    base_positions(NULL),
+    base_faces(NULL),
+    bbox(R3null_box),
+    vertex_positions(NULL),
+    vertex_splits(NULL),
+    vertex_active_indices(NULL),
+    face_vertices(NULL),
+    face_neighbors(NULL),
+    face_active_indices(NULL),
+    active_vertices(NULL),
+    nactive_vertices(0),
+    active_faces(NULL),
+    nactive_faces(0),
+    napplied_splits(0),
+    max_pixel_error(1),
+    max_faces(0),
+    fp(NULL),
+    nsplits_per_chunk(default_nsplits_per_chunk)
+{
+}
+
+
+
+R3ProgressiveMesh::
+~R3ProgressiveMesh(void)
+{
+  // Delete everything
+  Reset();
+}
+
+
+
+int R3ProgressiveMesh::
+Build(const R3Mesh *input_mesh, int min_faces)
+{
+  // Check mesh
+  Reset();
+  if (input_mesh->NFaces() == 0) {
+    fprintf(stderr, "Unable to build progressive mesh without faces\n");
+    return 0;
+  }
+
+  // Copy mesh (it is simplified in place)
+  R3Mesh mesh(*input_mesh);
+  int nvertices = mesh.NVertices();
+  int nedges = mesh.NEdges();
+  int nfaces = mesh.NFaces();
+  if (min_faces < 4) min_faces = 4;
+
+  // Allocate simplification data (every collapse creates one temporary vertex)
+  R3ProgressiveMeshBuilder builder;
+  builder.mesh = &mesh;
+  builder.vertices = new R3ProgressiveMeshBuildVertex [ 2 * nvertices ];
+  builder.edges = new R3ProgressiveMeshBuildEdge [ nedges ];
+  builder.face_ids = new int [ nfaces ];
+  R3ProgressiveMeshBuildCollapse *collapses = new R3ProgressiveMeshBuildCollapse [ nvertices ];
+  int ncollapses = 0;
+  for (int i = 0; i < nvertices; i++) mesh.SetVertexData(mesh.Vertex(i), &builder.vertices[i]);
+  for (int i = 0; i < nfaces; i++) mesh.SetFaceData(mesh.Face(i), &builder.face_ids[i]);
+  for (int i = 0; i < nvertices; i++) InitializeBuildVertex(builder, mesh.Vertex(i));
+
+  // Fill heap with best collapses of edges
+  R3ProgressiveMeshBuildEdge tmp;
+  RNHeap<R3ProgressiveMeshBuildEdge *> heap(&tmp, &(tmp.cost), &(tmp.heappointer));
+  for (int i = 0; i < nedges; i++) {
+    R3MeshEdge *edge = mesh.Edge(i);
+    builder.edges[i].edge = edge;
+    builder.edges[i].heappointer = NULL;
+    mesh.SetEdgeData(edge, &builder.edges[i]);
+    UpdateBuildEdge(builder, edge, heap);
+  }
+
+  // Collapse edges in order of increasing cost
+  while (!heap.IsEmpty() && (mesh.NFaces() > min_faces)) {
+    // Check collapse (edges popped here are pushed again when their vertices change)
+    R3ProgressiveMeshBuildEdge *data = heap.Pop();
+    R3MeshEdge *edge = data->edge;
+    R3ProgressiveMeshBuildCollapse *collapse = &collapses[ncollapses];
+    if (!CheckBuildCollapse(builder, edge, data->position, collapse)) continue;
+
+    // Remove edges deleted by collapse from heap
+    R3MeshVertex *v0 = mesh.VertexOnEdge(edge, 0);
+    R3MeshVertex *v1 = mesh.VertexOnEdge(edge, 1);
+    for (int k = 0; k < 2; k++) {
+      R3MeshFace *face = mesh.FaceOnEdge(edge, k);
+      if (!face) continue;
+      R3MeshEdge *deleted_edge = mesh.EdgeAcrossVertex(v1, edge, face);
+      R3ProgressiveMeshBuildEdge *deleted_data = (R3ProgressiveMeshBuildEdge *) mesh.EdgeData(deleted_edge);
+      if (deleted_data->heappointer) heap.Remove(deleted_data);
+    }
+
+    // Sum quadrics of vertices
+    R3ProgressiveMeshBuildVertex *parent = &builder.vertices[nvertices + ncollapses];
+    const R3ProgressiveMeshBuildVertex *child0 = BuildVertex(builder, v0);
+    const R3ProgressiveMeshBuildVertex *child1 = BuildVertex(builder, v1);
+    for (int i = 0; i < 10; i++) parent->quadric[i] = child0->quadric[i] + child1->quadric[i];
+    parent->error = collapse->error;
+    parent->radius = collapse->radius;
+
+    // Collapse edge
+    R3MeshVertex *vertex = mesh.CollapseEdge(edge, data->position);
+    if (!vertex) break;
+    mesh.SetVertexData(vertex, parent);
+    ncollapses++;
+
+    // Update collapses of edges on remaining vertex
+    for (int i = 0; i < mesh.VertexValence(vertex); i++) {
+      UpdateBuildEdge(builder, mesh.EdgeOnVertex(vertex, i), heap);
+    }
+  }
+
+  // Number base vertices and faces in mesh order
+  nbase_vertices = mesh.NVertices();
+  nbase_faces = mesh.NFaces();
+  nsplits = ncollapses;
+  nloaded_splits = ncollapses;
+  int *vertex_ids = new int [ nvertices + ncollapses ];
+  int *face_ids = new int [ nfaces ];
+  base_positions = new R3Point [ nbase_vertices ];
+  for (int i = 0; i < nbase_vertices; i++) {
+    R3MeshVertex *vertex = mesh.Vertex(i);
+    vertex_ids[BuildVertexID(builder, vertex)] = i;
+    base_positions[i] = mesh.VertexPosition(vertex);
+  }
+  for (int i = 0; i < nbase_faces; i++) {
+    face_ids[BuildFaceID(builder, mesh.Face(i))] = i;
+  }
+
+  // Number children and faces of splits (splits are the collapses in reverse order)
+  for (int k = 0; k < ncollapses; k++) {
+    const R3ProgressiveMeshBuildCollapse& collapse = collapses[k];
+    int split_index = ncollapses - 1 - k;
+    for (int j = 0; j < 2; j++) {
+      vertex_ids[collapse.children[j]] = nbase_vertices + 2*split_index + j;
+      if (collapse.faces[j] >= 0) face_ids[collapse.faces[j]] = nbase_faces + 2*split_index + j;
+    }
+  }
+
+  // Fill base faces
+  base_faces = new int [ 3 * nbase_faces ];
+  for (int i = 0; i < nbase_faces; i++) {
+    R3MeshFace *face = mesh.Face(i);
+    for (int j = 0; j < 3; j++) {
+      base_faces[3*i+j] = vertex_ids[BuildVertexID(builder, mesh.VertexOnFace(face, j))];
+    }
+  }
+
+  // Fill splits
+  splits = new R3ProgressiveMeshSplit [ nsplits ];
+  for (int k = 0; k < ncollapses; k++) {
+    const R3ProgressiveMeshBuildCollapse& collapse = collapses[k];
+    R3ProgressiveMeshSplit& split = splits[ncollapses - 1 - k];
+    split.parent = vertex_ids[nvertices + k];
+    split.flags = collapse.flags;
+    for (int j = 0; j < 4; j++) {
+      split.neighbors[j] = (collapse.neighbors[j] >= 0) ? face_ids[collapse.neighbors[j]] : -1;
+    }
+    for (int j = 0; j < 2; j++) {
+      for (int d = 0; d < 3; d++) split.positions[j][d] = collapse.positions[j][d];
+    }
+    split.error = collapse.error;
+    split.radius = collapse.radius;
+  }
+
+  // Remember bounding box of fully refined mesh
+  bbox = input_mesh->BBox();
+
+  // Delete simplification data
+  delete [] builder.vertices;
+  delete [] builder.edges;
+  delete [] builder.face_ids;
+  delete [] collapses;
+  delete [] vertex_ids;
+  delete [] face_ids;
+
+  // Make base mesh active
+  InitializeActiveMesh();
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3ProgressiveMesh::
+Refine(const R3Point& viewpoint, const R3Halfspace *frustum_halfspaces, int nfrustum_halfspaces,
+  RNScalar pixels_per_unit, RNLength near_distance, int max_operations)
+{
+  // Allocate candidates
+  R3ProgressiveMeshCandidate *candidates = new R3ProgressiveMeshCandidate [ nactive_vertices + 1 ];
+  int ncandidates = 0;
+  int noperations = 0;
+
+  // Find applied splits with small errors (each one is found from its first child)
+  for (int i = 0; i < nactive_vertices; i++) {
+    int vertex_id = active_vertices[i];
+    if (vertex_id < nbase_vertices) continue;
+    if ((vertex_id - nbase_vertices) % 2 != 0) continue;
+    int split_index = (vertex_id - nbase_vertices) / 2;
+    if (!IsSplitCollapsible(split_index)) continue;
+    RNScalar pixel_error = SplitPixelError(split_index, viewpoint,
+      frustum_halfspaces, nfrustum_halfspaces, pixels_per_unit, near_distance);
+    if (pixel_error >= collapse_fraction * max_pixel_error) continue;
+    candidates[ncandidates].split_index = split_index;
+    candidates[ncandidates].pixel_error = pixel_error;
+    ncandidates++;
+  }
+
+  // Collapse them
+  for (int i = 0; i < ncandidates; i++) {
+    if ((max_operations > 0) && (noperations >= max_operations)) break;
+    if (!IsSplitCollapsible(candidates[i].split_index)) continue;
+    ApplyCollapse(candidates[i].split_index);
+    noperations++;
+  }
+
+  // Find loaded splits of active vertices with large errors
+  ncandidates = 0;
+  for (int i = 0; i < nactive_vertices; i++) {
+    int split_index = vertex_splits[active_vertices[i]];
+    if (split_index < 0) continue;
+    RNScalar pixel_error = SplitPixelError(split_index, viewpoint,
+      frustum_halfspaces, nfrustum_halfspaces, pixels_per_unit, near_distance);
+    if (pixel_error <= max_pixel_error) continue;
+    candidates[ncandidates].split_index = split_index;
+    candidates[ncandidates].pixel_error = pixel_error;
+    ncandidates++;
+  }
+
+  // Apply them in order of decreasing error (forcing the splits they depend on)
+  qsort(candidates, ncandidates, sizeof(R3ProgressiveMeshCandidate), CompareCandidates);
+  for (int i = 0; i < ncandidates; i++) {
+    if ((max_operations > 0) && (noperations >= max_operations)) break;
+    if ((max_faces > 0) && (nactive_faces >= max_faces)) break;
+    if (IsSplitApplied(candidates[i].split_index)) continue;
+    noperations += ForceSplit(candidates[i].split_index);
+  }
+
+  // Delete candidates
+  delete [] candidates;
+
+  // Return number of operations
+  return noperations;
+}
+
+
+
+int R3ProgressiveMesh::
+RefineCompletely(void)
+{
+  // Apply all loaded splits
+  int count = 0;
+  for (int i = 0; i < nloaded_splits; i++) {
+    if (IsSplitApplied(i)) continue;
+    count += ForceSplit(i);
+  }
+
+  // Return number of splits applied
+  return count;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Input/output functions
+////////////////////////////////////////////////////////////////////////
+
+int R3ProgressiveMesh::
+ReadFile(const char *filename)
+{
+  // Read header and base mesh
+  if (!OpenFile(filename)) return 0;
+
+  // Read all splits
+  if (ReadSplits(0) < 0) return 0;
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3ProgressiveMesh::
+OpenFile(const char *filename)
+{
+  // Delete previous data
+  Reset();
+
+  // Open file
+  fp = fopen(filename, "rb");
+  if (!fp) {
+    fprintf(stderr, "Unable to open progressive mesh file %s\n", filename);
+    return 0;
+  }
+
+  // Read header
+  char magic[4];
+  int header[5];
+  float bbox_coords[6];
+  if ((fread(magic, sizeof(char), 4, fp) != 4) ||
+      (fread(header, sizeof(int), 5, fp) != 5) ||
+      (fread(bbox_coords, sizeof(float), 6, fp) != 6)) {
+    fprintf(stderr, "Unable to read header of progressive mesh file %s\n", filename);
+    CloseFile();
+    return 0;
+  }
+
+  // Check header
+  if (strncmp(magic, file_magic, 4) || (header[0] != file_version) ||
+      (header[1] < 0) || (header[2] < 0) || (header[3] < 0) || (header[4] <= 0)) {
+    fprintf(stderr, "Invalid header in progressive mesh file %s\n", filename);
+    CloseFile();
+    return 0;
+  }
+
+  // Remember header
+  nbase_vertices = header[1];
+  nbase_faces = header[2];
+  nsplits = header[3];
+  nsplits_per_chunk = header[4];
+  bbox.Reset(R3Point(bbox_coords[0], bbox_coords[1], bbox_coords[2]),
+    R3Point(bbox_coords[3], bbox_coords[4], bbox_coords[5]));
+
+  // Read base mesh
+  float *coords = new float [ 3 * nbase_vertices + 1 ];
+  base_positions = new R3Point [ nbase_vertices ];
+  base_faces = new int [ 3 * nbase_faces ];
+  if ((fread(coords, sizeof(float), 3 * nbase_vertices, fp) != (size_t) (3 * nbase_vertices)) ||
+      (fread(base_faces, sizeof(int), 3 * nbase_faces, fp) != (size_t) (3 * nbase_faces))) {
+    fprintf(stderr, "Unable to read base mesh of progressive mesh file %s\n", filename);
+    delete [] coords;
+    Reset();
+    return 0;
+  }
+  for (int i = 0; i < nbase_vertices; i++) {
+    base_positions[i].Reset(coords[3*i+0], coords[3*i+1], coords[3*i+2]);
+  }
+  delete [] coords;
+
+  // Check base faces
+  for (int i = 0; i < 3 * nbase_faces; i++) {
+    if ((base_faces[i] < 0) || (base_faces[i] >= nbase_vertices)) {
+      fprintf(stderr, "Invalid base face in progressive mesh file %s\n", filename);
+      Reset();
+      return 0;
+    }
+  }
+
+  // Make base mesh active
+  splits = new R3ProgressiveMeshSplit [ nsplits + 1 ];
+  InitializeActiveMesh();
+
+  // Close file if there are no splits
+  if (nsplits == 0) CloseFile();
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3ProgressiveMesh::
+ReadSplits(int max_splits)
+{
+  // Read chunks until there are enough splits
+  int count = 0;
+  while (fp && ((max_splits == 0) || (count < max_splits))) {
+    // Read chunk header
+    int chunk[2];
+    if (fread(chunk, sizeof(int), 2, fp) != 2) {
+      fprintf(stderr, "Unable to read chunk of progressive mesh file\n");
+      CloseFile();
+      return -1;
+    }
+
+    // Check chunk header
+    if ((chunk[0] != nloaded_splits) || (chunk[1] <= 0) || (chunk[0] + chunk[1] > nsplits)) {
+      fprintf(stderr, "Invalid chunk in progressive mesh file\n");
+      CloseFile();
+      return -1;
+    }
+
+    // Read splits
+    if (fread(&splits[chunk[0]], sizeof(R3ProgressiveMeshSplit), chunk[1], fp) != (size_t) chunk[1]) {
+      fprintf(stderr, "Unable to read splits of progressive mesh file\n");
+      CloseFile();
+      return -1;
+    }
+
+    // Check splits (parents and neighbors are created by earlier splits)
+    for (int i = chunk[0]; i < chunk[0] + chunk[1]; i++) {
+      const R3ProgressiveMeshSplit& split = splits[i];
+      RNBoolean valid = ((split.parent >= 0) && (split.parent < nbase_vertices + 2*i)) ? TRUE : FALSE;
+      for (int j = 0; j < 4; j++) {
+        if ((split.neighbors[j] < -1) || (split.neighbors[j] >= nbase_faces + 2*i)) valid = FALSE;
+      }
+      if (!valid) {
+        fprintf(stderr, "Invalid split %d in progressive mesh file\n", i);
+        CloseFile();
+        return -1;
+      }
+    }
+
+    // Make splits available
+    for (int i = chunk[0]; i < chunk[0] + chunk[1]; i++) InitializeSplit(i);
+    nloaded_splits += chunk[1];
+    count += chunk[1];
+
+    // Close file at its end
+    if (nloaded_splits == nsplits) CloseFile();
+  }
+
+  // Return number of splits read
+  return count;
+}
+
+
+
+int R3ProgressiveMesh::
+CloseFile(void)
+{
+  // Close file
+  if (!fp) return 0;
+  fclose(fp);
+  fp = NULL;
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3ProgressiveMesh::
+WriteFile(const char *filename) const
+{
+  // Check splits
+  if (!IsLoaded()) {
+    fprintf(stderr, "Unable to write progressive mesh before all splits are loaded\n");
+    return 0;
+  }
+
+  // Open file
+  FILE *out = fopen(filename, "wb");
+  if (!out) {
+    fprintf(stderr, "Unable to open progressive mesh file %s\n", filename);
+    return 0;
+  }
+
+  // Write header
+  int header[5] = { file_version, nbase_vertices, nbase_faces, nsplits, nsplits_per_chunk };
+  float bbox_coords[6] = {
+    (float) bbox.XMin(), (float) bbox.YMin(), (float) bbox.ZMin(),
+    (float) bbox.XMax(), (float) bbox.YMax(), (float) bbox.ZMax() };
+  fwrite(file_magic, sizeof(char), 4, out);
+  fwrite(header, sizeof(int), 5, out);
+  fwrite(bbox_coords, sizeof(float), 6, out);
+
+  // Write base mesh
+  for (int i = 0; i < nbase_vertices; i++) {
+    float coords[3] = { (float) base_positions[i].X(), (float) base_positions[i].Y(), (float) base_positions[i].Z() };
+    fwrite(coords, sizeof(float), 3, out);
+  }
+  fwrite(base_faces, sizeof(int), 3 * nbase_faces, out);
+
+  // Write splits in chunks
+  for (int first = 0; first < nsplits; first += nsplits_per_chunk) {
+    int chunk[2] = { first, nsplits - first };
+    if (chunk[1] > nsplits_per_chunk) chunk[1] = nsplits_per_chunk;
+    fwrite(chunk, sizeof(int), 2, out);
+    fwrite(&splits[first], sizeof(R3ProgressiveMeshSplit), chunk[1], out);
+  }
+
+  // Close file
+  if (ferror(out)) {
+    fprintf(stderr, "Unable to write progressive mesh file %s\n", filename);
+    fclose(out);
+    return 0;
+  }
+  fclose(out);
+
+  // Return success
+  return 1;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Draw functions
+////////////////////////////////////////////////////////////////////////
+
+void R3ProgressiveMesh::
+Draw(void) const
+{
+  // Draw active faces
+  for (int i = 0; i < nactive_faces; i++) {
+    const int *vertex_ids = &face_vertices[3*active_faces[i]];
+    const R3Point& p0 = vertex_positions[vertex_ids[0]];
+    const R3Point& p1 = vertex_positions[vertex_ids[1]];
+    const R3Point& p2 = vertex_positions[vertex_ids[2]];
+    R3Vector normal = (p1 - p0) % (p2 - p0);
+    normal.Normalize();
+    R3BeginPolygon();
+    R3LoadNormal(normal);
+    R3LoadPoint(p0);
+    R3LoadPoint(p1);
+    R3LoadPoint(p2);
+    R3EndPolygon();
+  }
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Internal functions
+////////////////////////////////////////////////////////////////////////
+
+RNBoolean R3ProgressiveMesh::
+IsSplitApplied(int split_index) const
+{
+  // Return whether faces of split are active
+  const R3ProgressiveMeshSplit& split = splits[split_index];
+  int face_id = nbase_faces + 2*split_index;
+  if (split.flags & R3_PROGRESSIVE_MESH_LEFT_FACE) return IsFaceActive(face_id);
+  else return IsFaceActive(face_id + 1);
+}
+
+
+
+RNBoolean R3ProgressiveMesh::
+IsSplitCollapsible(int split_index) const
+{
+  // Check whether split is applied and its children are active
+  const R3ProgressiveMeshSplit& split = splits[split_index];
+  int vertex_id = nbase_vertices + 2*split_index;
+  if (!IsSplitApplied(split_index)) return FALSE;
+  if (!IsVertexActive(vertex_id) || !IsVertexActive(vertex_id + 1)) return FALSE;
+
+  // Check whether faces of split have the neighbors they were created with
+  int face_id = nbase_faces + 2*split_index;
+  if (split.flags & R3_PROGRESSIVE_MESH_LEFT_FACE) {
+    if (face_neighbors[3*face_id+1] != split.neighbors[0]) return FALSE;
+    if (face_neighbors[3*face_id+2] != split.neighbors[1]) return FALSE;
+  }
+  if (split.flags & R3_PROGRESSIVE_MESH_RIGHT_FACE) {
+    if (face_neighbors[3*(face_id+1)+1] != split.neighbors[2]) return FALSE;
+    if (face_neighbors[3*(face_id+1)+2] != split.neighbors[3]) return FALSE;
+  }
+
+  // Split can be collapsed
+  return TRUE;
+}
+
+
+
+RNScalar R3ProgressiveMesh::
+SplitPixelError(int split_index, const R3Point& viewpoint, const R3Halfspace *frustum_halfspaces,
+  int nfrustum_halfspaces, RNScalar pixels_per_unit, RNLength near_distance) const
+{
+  // Get sphere around parent and its descendants
+  const R3ProgressiveMeshSplit& split = splits[split_index];
+  const R3Point& center = vertex_positions[split.parent];
+  RNLength radius = split.radius;
+
+  // Check whether sphere is outside view frustum
+  for (int i = 0; i < nfrustum_halfspaces; i++) {
+    if (R3SignedDistance(frustum_halfspaces[i].Plane(), center) < -radius) return 0;
+  }
+
+  // Return error projected at the closest point of sphere
+  RNLength distance = R3Distance(viewpoint, center) - radius;
+  if (distance < near_distance) distance = near_distance;
+  return split.error * pixels_per_unit / distance;
+}
+
+
+
+int R3ProgressiveMesh::
+ForceSplit(int split_index)
+{
+  // Apply split after the splits creating its parent and neighbors (Hoppe 1997)
+  RNArray<void *> stack;
+  int count = 0;
+  stack.Insert((void *) (long) split_index);
+  while (!stack.IsEmpty()) {
+    // Check stack size
+    if (stack.NEntries() > nloaded_splits + 1) {
+      fprintf(stderr, "Inconsistent dependencies of progressive mesh split %d\n", split_index);
+      break;
+    }
+
+    // Check split on top of stack
+    int top = (int) (long) stack.Tail();
+    const R3ProgressiveMeshSplit& split = splits[top];
+    if (IsSplitApplied(top)) {
+      stack.RemoveTail();
+      continue;
+    }
+
+    // Force split creating parent
+    if (!IsVertexActive(split.parent)) {
+      stack.Insert((void *) (long) ((split.parent - nbase_vertices) / 2));
+      continue;
+    }
+
+    // Force splits creating neighbor faces
+    RNBoolean ready = TRUE;
+    for (int j = 0; j < 4; j++) {
+      int face_id = split.neighbors[j];
+      if ((face_id < 0) || IsFaceActive(face_id)) continue;
+      stack.Insert((void *) (long) ((face_id - nbase_faces) / 2));
+      ready = FALSE;
+      break;
+    }
+
+    // Apply split
+    if (ready) {
+      ApplySplit(top);
+      stack.RemoveTail();
+      count++;
+    }
+  }
+
+  // Return number of splits applied
+  return count;
+}
+
+
+
+void R3ProgressiveMesh::
+ApplySplit(int split_index)
+{
+  // Get vertices and faces of split
+  const R3ProgressiveMeshSplit& split = splits[split_index];
+  const int *fn = split.neighbors;
+  int parent = split.parent;
+  int child0 = nbase_vertices + 2*split_index;
+  int child1 = child0 + 1;
+  int left_face = nbase_faces + 2*split_index;
+  int right_face = left_face + 1;
+  RNBoolean left = (split.flags & R3_PROGRESSIVE_MESH_LEFT_FACE) ? TRUE : FALSE;
+  RNBoolean right = (split.flags & R3_PROGRESSIVE_MESH_RIGHT_FACE) ? TRUE : FALSE;
+
+  // Find vertices across left and right faces (before and after the parent in the neighbors)
+  int left_vertex = -1, right_vertex = -1;
+  for (int i = 0; i < 3; i++) {
+    if ((fn[0] >= 0) && (face_vertices[3*fn[0]+(i+1)%3] == parent)) left_vertex = face_vertices[3*fn[0]+i];
+    if ((fn[1] >= 0) && (face_vertices[3*fn[1]+i] == parent)) left_vertex = face_vertices[3*fn[1]+(i+1)%3];
+    if ((fn[2] >= 0) && (face_vertices[3*fn[2]+(i+1)%3] == parent)) right_vertex = face_vertices[3*fn[2]+i];
+    if ((fn[3] >= 0) && (face_vertices[3*fn[3]+i] == parent)) right_vertex = face_vertices[3*fn[3]+(i+1)%3];
+  }
+
+  // Find faces around parent moving to each child
+  int fan0[max_fan_faces], fan1[max_fan_faces];
+  int nfan0 = FindFan(parent, fn[2], fn[1], fan0, max_fan_faces);
+  int nfan1 = FindFan(parent, fn[0], fn[3], fan1, max_fan_faces);
+  if ((nfan0 < 0) || (nfan1 < 0) || (left && (left_vertex < 0)) || (right && (right_vertex < 0))) {
+    fprintf(stderr, "Unable to apply progressive mesh split %d\n", split_index);
+    return;
+  }
+
+  // Replace parent by children in faces
+  for (int i = 0; i < nfan0; i++) {
+    for (int j = 0; j < 3; j++) if (face_vertices[3*fan0[i]+j] == parent) face_vertices[3*fan0[i]+j] = child0;
+  }
+  for (int i = 0; i < nfan1; i++) {
+    for (int j = 0; j < 3; j++) if (face_vertices[3*fan1[i]+j] == parent) face_vertices[3*fan1[i]+j] = child1;
+  }
+
+  // Create left face (child0, child1, left vertex)
+  if (left) {
+    int *vertex_ids = &face_vertices[3*left_face];
+    int *neighbor_ids = &face_neighbors[3*left_face];
+    vertex_ids[0] = child0; vertex_ids[1] = child1; vertex_ids[2] = left_vertex;
+    neighbor_ids[0] = (right) ? right_face : -1; neighbor_ids[1] = fn[0]; neighbor_ids[2] = fn[1];
+    SetFaceNeighbor(fn[0], left_vertex, child1, left_face);
+    SetFaceNeighbor(fn[1], child0, left_vertex, left_face);
+    InsertFace(left_face);
+  }
+
+  // Create right face (child1, child0, right vertex)
+  if (right) {
+    int *vertex_ids = &face_vertices[3*right_face];
+    int *neighbor_ids = &face_neighbors[3*right_face];
+    vertex_ids[0] = child1; vertex_ids[1] = child0; vertex_ids[2] = right_vertex;
+    neighbor_ids[0] = (left) ? left_face : -1; neighbor_ids[1] = fn[2]; neighbor_ids[2] = fn[3];
+    SetFaceNeighbor(fn[2], right_vertex, child0, right_face);
+    SetFaceNeighbor(fn[3], child1, right_vertex, right_face);
+    InsertFace(right_face);
+  }
+
+  // Replace parent by children in active vertices
+  RemoveVertex(parent);
+  InsertVertex(child0);
+  InsertVertex(child1);
+  napplied_splits++;
+}
+
+
+
+void R3ProgressiveMesh::
+ApplyCollapse(int split_index)
+{
+  // Get vertices and faces of split
+  const R3ProgressiveMeshSplit& split = splits[split_index];
+  const int *fn = split.neighbors;
+  int parent = split.parent;
+  int child0 = nbase_vertices + 2*split_index;
+  int child1 = child0 + 1;
+  int left_face = nbase_faces + 2*split_index;
+  int right_face = left_face + 1;
+  RNBoolean left = (split.flags & R3_PROGRESSIVE_MESH_LEFT_FACE) ? TRUE : FALSE;
+  RNBoolean right = (split.flags & R3_PROGRESSIVE_MESH_RIGHT_FACE) ? TRUE : FALSE;
+  int left_vertex = (left) ? face_vertices[3*left_face+2] : -1;
+  int right_vertex = (right) ? face_vertices[3*right_face+2] : -1;
+
+  // Find faces around children (without the faces of the split)
+  int fan0[max_fan_faces], fan1[max_fan_faces];
+  int nfan0 = FindFan(child0, fn[2], fn[1], fan0, max_fan_faces);
+  int nfan1 = FindFan(child1, fn[0], fn[3], fan1, max_fan_faces);
+  if ((nfan0 < 0) || (nfan1 < 0)) {
+    fprintf(stderr, "Unable to collapse progressive mesh split %d\n", split_index);
+    return;
+  }
+
+  // Replace children by parent in faces
+  for (int i = 0; i < nfan0; i++) {
+    for (int j = 0; j < 3; j++) if (face_vertices[3*fan0[i]+j] == child0) face_vertices[3*fan0[i]+j] = parent;
+  }
+  for (int i = 0; i < nfan1; i++) {
+    for (int j = 0; j < 3; j++) if (face_vertices[3*fan1[i]+j] == child1) face_vertices[3*fan1[i]+j] = parent;
+  }
+
+  // Delete left and right faces, and make their neighbors adjacent
+  if (left) {
+    SetFaceNeighbor(fn[0], left_vertex, parent, fn[1]);
+    SetFaceNeighbor(fn[1], parent, left_vertex, fn[0]);
+    RemoveFace(left_face);
+  }
+  if (right) {
+    SetFaceNeighbor(fn[2], right_vertex, parent, fn[3]);
+    SetFaceNeighbor(fn[3], parent, right_vertex, fn[2]);
+    RemoveFace(right_face);
+  }
+
+  // Replace children by parent in active vertices
+  RemoveVertex(child0);
+  RemoveVertex(child1);
+  InsertVertex(parent);
+  napplied_splits--;
+}
+
+
+
+int R3ProgressiveMesh::
+FindFan(int vertex_id, int first_face_id, int last_face_id, int *fan_face_ids, int max_fan_faces) const
+{
+  // Walk counterclockwise around vertex from first face until last face or a boundary
+  int count = 0;
+  int face_id = first_face_id;
+  while (face_id >= 0) {
+    if (count >= max_fan_faces) return -1;
+    fan_face_ids[count++] = face_id;
+    if (face_id == last_face_id) return count;
+    int k = 0;
+    while ((k < 3) && (face_vertices[3*face_id+k] != vertex_id)) k++;
+    if (k == 3) return -1;
+    face_id = face_neighbors[3*face_id+k];
+    if (face_id == first_face_id) return -1;
+  }
+
+  // Walk clockwise around vertex from last face until a boundary
+  face_id = last_face_id;
+  while (face_id >= 0) {
+    if (count >= max_fan_faces) return -1;
+    fan_face_ids[count++] = face_id;
+    int k = 0;
+    while ((k < 3) && (face_vertices[3*face_id+k] != vertex_id)) k++;
+    if (k == 3) return -1;
+    face_id = face_neighbors[3*face_id+(k+2)%3];
+    if (face_id == last_face_id) return -1;
+  }
+
+  // Return number of faces
+  return count;
+}
+
+
+
+void R3ProgressiveMesh::
+SetFaceNeighbor(int face_id, int vertex_id0, int vertex_id1, int neighbor_face_id)
+{
+  // Set face across edge from vertex0 to vertex1
+  if (face_id < 0) return;
+  for (int i = 0; i < 3; i++) {
+    if (face_vertices[3*face_id+i] != vertex_id0) continue;
+    if (face_vertices[3*face_id+(i+1)%3] != vertex_id1) continue;
+    face_neighbors[3*face_id+i] = neighbor_face_id;
+    return;
+  }
+}
+
+
+
+void R3ProgressiveMesh::
+InsertVertex(int vertex_id)
+{
+  // Add vertex to active vertices
+  vertex_active_indices[vertex_id] = nactive_vertices;
+  active_vertices[nactive_vertices++] = vertex_id;
+}
+
+
+
+void R3ProgressiveMesh::
+RemoveVertex(int vertex_id)
+{
+  // Remove vertex from active vertices (move last one into its place)
+  int index = vertex_active_indices[vertex_id];
+  int last_vertex_id = active_vertices[--nactive_vertices];
+  active_vertices[index] = last_vertex_id;
+  vertex_active_indices[last_vertex_id] = index;
+  vertex_active_indices[vertex_id] = -1;
+}
+
+
+
+void R3ProgressiveMesh::
+InsertFace(int face_id)
+{
+  // Add face to active faces
+  face_active_indices[face_id] = nactive_faces;
+  active_faces[nactive_faces++] = face_id;
+}
+
+
+
+void R3ProgressiveMesh::
+RemoveFace(int face_id)
+{
+  // Remove face from active faces (move last one into its place)
+  int index = face_active_indices[face_id];
+  int last_face_id = active_faces[--nactive_faces];
+  active_faces[index] = last_face_id;
+  face_active_indices[last_face_id] = index;
+  face_active_indices[face_id] = -1;
+}
+
+
+
+void R3ProgressiveMesh::
+InitializeSplit(int split_index)
+{
+  // Make positions of children and split of parent available
+  const R3ProgressiveMeshSplit& split = splits[split_index];
+  for (int j = 0; j < 2; j++) {
+    const float *p = split.positions[j];
+    vertex_positions[nbase_vertices + 2*split_index + j].Reset(p[0], p[1], p[2]);
+  }
+  vertex_splits[split.parent] = split_index;
+}
+
+
+
+void R3ProgressiveMesh::
+InitializeActiveMesh(void)
+{
+  // Allocate arrays with entries for all vertex and face IDs
+  int nvertex_ids = nbase_vertices + 2*nsplits;
+  int nface_ids = nbase_faces + 2*nsplits;
+  vertex_positions = new R3Point [ nvertex_ids ];
+  vertex_splits = new int [ nvertex_ids ];
+  vertex_active_indices = new int [ nvertex_ids ];
+  active_vertices = new int [ nvertex_ids ];
+  face_vertices = new int [ 3 * nface_ids ];
+  face_neighbors = new int [ 3 * nface_ids ];
+  face_active_indices = new int [ nface_ids ];
+  active_faces = new int [ nface_ids ];
+  for (int i = 0; i < nvertex_ids; i++) vertex_splits[i] = -1;
+  for (int i = 0; i < nvertex_ids; i++) vertex_active_indices[i] = -1;
+  for (int i = 0; i < nface_ids; i++) face_active_indices[i] = -1;
+  nactive_vertices = nactive_faces = 0;
+  napplied_splits = 0;
+
+  // Make base vertices and faces active
+  for (int i = 0; i < nbase_vertices; i++) {
+    vertex_positions[i] = base_positions[i];
+    InsertVertex(i);
+  }
+  for (int i = 0; i < nbase_faces; i++) {
+    for (int j = 0; j < 3; j++) face_vertices[3*i+j] = base_faces[3*i+j];
+    InsertFace(i);
+  }
+
+  // Make lists of base faces on base vertices
+  int *vertex_nfaces = new int [ nbase_vertices + 1 ];
+  int *vertex_faces = new int [ 3 * nbase_faces + 1 ];
+  for (int i = 0; i <= nbase_vertices; i++) vertex_nfaces[i] = 0;
+  for (int i = 0; i < 3 * nbase_faces; i++) vertex_nfaces[base_faces[i] + 1]++;
+  for (int i = 0; i < nbase_vertices; i++) vertex_nfaces[i+1] += vertex_nfaces[i];
+  int *vertex_counts = new int [ nbase_vertices ];
+  for (int i = 0; i < nbase_vertices; i++) vertex_counts[i] = 0;
+  for (int i = 0; i < 3 * nbase_faces; i++) {
+    int vertex_id = base_faces[i];
+    vertex_faces[vertex_nfaces[vertex_id] + vertex_counts[vertex_id]++] = i / 3;
+  }
+
+  // Find base faces across edges of base faces (with the edge in the opposite direction)
+  for (int i = 0; i < nbase_faces; i++) {
+    for (int j = 0; j < 3; j++) {
+      int v0 = base_faces[3*i+j];
+      int v1 = base_faces[3*i+(j+1)%3];
+      face_neighbors[3*i+j] = -1;
+      for (int k = vertex_nfaces[v0]; k < vertex_nfaces[v0+1]; k++) {
+        int face_id = vertex_faces[k];
+        if (face_id == i) continue;
+        for (int m = 0; m < 3; m++) {
+          if ((base_faces[3*face_id+m] == v1) && (base_faces[3*face_id+(m+1)%3] == v0)) {
+            face_neighbors[3*i+j] = face_id;
+          }
+        }
+      }
+    }
+  }
+
+  // Delete lists
+  delete [] vertex_nfaces;
+  delete [] vertex_faces;
+  delete [] vertex_counts;
+
+  // Make loaded splits available
+  for (int i = 0; i < nloaded_splits; i++) InitializeSplit(i);
+}
+
+
+
+void R3ProgressiveMesh::
+Reset(void)
+{
+  // Close file
+  CloseFile();
+
+  // Delete hierarchy
+  if (splits) delete [] splits;
+  if (base_positions) delete [] base_positions;
+  if (base_faces) delete [] base_faces;
+  splits = NULL;
+  base_positions = NULL;
+  base_faces = NULL;
+  nbase_vertices = nbase_faces = 0;
+  nsplits = nloaded_splits = 0;
+  bbox = R3null_box;
+
+  // Delete active mesh
+  if (vertex_positions) delete [] vertex_positions;
+  if (vertex_splits) delete [] vertex_splits;
+  if (vertex_active_indices) delete [] vertex_active_indices;
+  if (active_vertices) delete [] active_vertices;
+  if (face_vertices) delete [] face_vertices;
+  if (face_neighbors) delete [] face_neighbors;
+  if (face_active_indices) delete [] face_active_indices;
+  if (active_faces) delete [] active_faces;
+  vertex_positions = NULL;
+  vertex_splits = NULL;
+  vertex_active_indices = NULL;
+  active_vertices = NULL;
+  face_vertices = NULL;
+  face_neighbors = NULL;
+  face_active_indices = NULL;
+  active_faces = NULL;
+  nactive_vertices = nactive_faces = 0;
+  napplied_splits = 0;
+  nsplits_per_chunk = default_nsplits_per_chunk;
+}
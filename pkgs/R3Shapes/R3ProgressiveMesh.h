@@ -0,0 +1,313 @@
+/* Include file for the R3 progressive mesh class */
+
+
+
+/* Vertex split record (as stored in files) */
+
+struct R3ProgressiveMeshSplit {
+  int parent;
+    // Vertex replaced by the two children of the split (vertex IDs nbase_vertices + 2*k and + 2*k + 1)
+  int flags;
+    // Bit 1 if the split creates its left face (IDs nbase_faces + 2*k), bit 2 if its right face (+ 2*k + 1)
+  int neighbors[4];
+    // Faces adjacent to the left and right faces after the split (or -1), as in Hoppe's view-dependent
+    // progressive meshes: across (child1, left vertex), (left vertex, child0), (child0, right vertex),
+    // and (right vertex, child1)
+  float positions[2][3];
+    // Positions of the two children
+  float error;
+    // Distance of the parent from the surface of its children (at least the errors of their splits)
+  float radius;
+    // Radius of the sphere around the parent containing all its descendants
+};
+
+
+
+/* Split flags */
+
+#define R3_PROGRESSIVE_MESH_LEFT_FACE   0x1
+#define R3_PROGRESSIVE_MESH_RIGHT_FACE  0x2
+
+
+
+/* Class definition */
+
+class R3ProgressiveMesh {
+public:
+  // Constructor functions
+  R3ProgressiveMesh(void);
+  ~R3ProgressiveMesh(void);
+
+  // Property functions
+  const R3Box& BBox(void) const;
+  int NBaseVertices(void) const;
+  int NBaseFaces(void) const;
+  int NSplits(void) const;
+  int NLoadedSplits(void) const;
+  RNBoolean IsLoaded(void) const;
+
+  // Active mesh access functions
+  int NVertices(void) const;
+  int NFaces(void) const;
+  int NAppliedSplits(void) const;
+  const R3Point& VertexPosition(int vertex_id) const;
+  int FaceVertex(int k, int i) const;
+    // ID of vertex i of the kth active face
+
+  // Parameter access functions
+  RNScalar MaxPixelError(void) const;
+  int MaxFaces(void) const;
+
+  // Parameter manipulation functions
+  void SetMaxPixelError(RNScalar max_pixel_error);
+    // Refine() splits vertices whose errors would project to more than this many pixels (default 1)
+  void SetMaxFaces(int max_faces);
+    // Refine() does not split vertices when there are this many active faces (default 0 means no limit)
+
+  // Construction functions
+  int Build(const R3Mesh *mesh, int min_faces = 0);
+    // Simplifies a copy of the mesh by edge collapses in order of quadric error until it has min_faces
+    // faces (or no collapse is valid), and records the base mesh and the reversed collapses as vertex
+    // splits.  The active mesh is the base mesh afterwards.  Returns 1 on success and 0 on error
+
+  // Refinement functions
+  int Refine(const R3Point& viewpoint, const R3Halfspace *frustum_halfspaces, int nfrustum_halfspaces,
+    RNScalar pixels_per_unit, RNLength near_distance, int max_operations = 0);
+    // Splits active vertices whose errors project to more than the maximum pixel error inside the
+    // view frustum (forcing the splits they depend on), and collapses splits whose errors project to
+    // less than 80% of it or that are outside the view frustum.  The frustum is the intersection of
+    // the halfspaces, and an error e at distance d from the viewpoint (at least near_distance)
+    // projects to e * pixels_per_unit / d pixels (e.g., half the viewport height divided by the
+    // tangent of half the vertical field of view).  Only loaded splits are applied.
+    // Returns the number of splits and collapses (at most max_operations, 0 means no limit)
+  int RefineCompletely(void);
+    // Applies all loaded splits (in file order), returns the number of splits applied
+
+  // Input/output functions
+  int ReadFile(const char *filename);
+    // Reads the whole file
+  int OpenFile(const char *filename);
+    // Reads the header and the base mesh, the active mesh is the base mesh afterwards
+  int ReadSplits(int max_splits = 0);
+    // Reads splits following the ones already loaded (whole chunks, at least max_splits if there are
+    // that many, 0 means all), returns the number read or -1 on error, and closes the file at its end
+  int CloseFile(void);
+  int WriteFile(const char *filename) const;
+    // Writes the base mesh and all splits (which must all be loaded)
+
+  // Draw functions
+  void Draw(void) const;
+    // Draws the active faces with flat normals
+
+public:
+  // Internal functions
+  RNBoolean IsVertexActive(int vertex_id) const;
+  RNBoolean IsFaceActive(int face_id) const;
+  RNBoolean IsSplitApplied(int split_index) const;
+  RNBoolean IsSplitCollapsible(int split_index) const;
+  RNScalar SplitPixelError(int split_index, const R3Point& viewpoint, const R3Halfspace *frustum_halfspaces,
+    int nfrustum_halfspaces, RNScalar pixels_per_unit, RNLength near_distance) const;
+  int ForceSplit(int split_index);
+  void ApplySplit(int split_index);
+  void ApplyCollapse(int split_index);
+  int FindFan(int vertex_id, int first_face_id, int last_face_id, int *fan_face_ids, int max_fan_faces) const;
+  void SetFaceNeighbor(int face_id, int vertex_id0, int vertex_id1, int neighbor_face_id);
+  void InsertVertex(int vertex_id);
+  void RemoveVertex(int vertex_id);
+  void InsertFace(int face_id);
+  void RemoveFace(int face_id);
+  void InitializeSplit(int split_index);
+  void InitializeActiveMesh(void);
+  void Reset(void);
+
+public:
+  // Hierarchy
+  int nbase_vertices;
+  int nbase_faces;
+  int nsplits;
+  int nloaded_splits;
+  R3ProgressiveMeshSplit *splits;
+  R3Point *base_positions;
+  int *base_faces;
+  R3Box bbox;
+
+  // Active mesh (vertices and faces have one entry per ID, faces list vertices counterclockwise
+  // and the faces across their edges from vertex i to vertex i+1)
+  R3Point *vertex_positions;
+  int *vertex_splits;
+  int *vertex_active_indices;
+  int *face_vertices;
+  int *face_neighbors;
+  int *face_active_indices;
+  int *active_vertices;
+  int nactive_vertices;
+  int *active_faces;
+  int nactive_faces;
+  int napplied_splits;
+
+  // Parameters
+  RNScalar max_pixel_error;
+  int max_faces;
+
+  // Streaming
+  FILE *fp;
+  int nsplits_per_chunk;
+};
+
+
+
+/* Inline functions */
+
+inline const R3Box& R3ProgressiveMesh::
+BBox(void) const
+{
+  // Return bounding box of fully refined mesh
+  return bbox;
+}
+
+
+
+inline int R3ProgressiveMesh::
+NBaseVertices(void) const
+{
+  // Return number of vertices of base mesh
+  return nbase_vertices;
+}
+
+
+
+inline int R3ProgressiveMesh::
+NBaseFaces(void) const
+{
+  // Return number of faces of base mesh
+  return nbase_faces;
+}
+
+
+
+inline int R3ProgressiveMesh::
+NSplits(void) const
+{
+  // Return number of vertex splits (including ones not loaded yet)
+  return nsplits;
+}
+
+
+
+inline int R3ProgressiveMesh::
+NLoadedSplits(void) const
+{
+  // Return number of vertex splits loaded so far
+  return nloaded_splits;
+}
+
+
+
+inline RNBoolean R3ProgressiveMesh::
+IsLoaded(void) const
+{
+  // Return whether all vertex splits are loaded
+  return (nloaded_splits == nsplits) ? TRUE : FALSE;
+}
+
+
+
+inline int R3ProgressiveMesh::
+NVertices(void) const
+{
+  // Return number of active vertices
+  return nactive_vertices;
+}
+
+
+
+inline int R3ProgressiveMesh::
+NFaces(void) const
+{
+  // Return number of active faces
+  return nactive_faces;
+}
+
+
+
+inline int R3ProgressiveMesh::
+NAppliedSplits(void) const
+{
+  // Return number of applied vertex splits
+  return napplied_splits;
+}
+
+
+
+inline const R3Point& R3ProgressiveMesh::
+VertexPosition(int vertex_id) const
+{
+  // Return position of vertex
+  return vertex_positions[vertex_id];
+}
+
+
+
+inline int R3ProgressiveMesh::
+FaceVertex(int k, int i) const
+{
+  // Return ID of vertex i of kth active face
+  return face_vertices[3*active_faces[k] + i];
+}
+
+
+
+inline RNScalar R3ProgressiveMesh::
+MaxPixelError(void) const
+{
+  // Return maximum pixel error
+  return max_pixel_error;
+}
+
+
+
+inline int R3ProgressiveMesh::
+MaxFaces(void) const
+{
+  // Return maximum number of active faces
+  return max_faces;
+}
+
+
+
+inline void R3ProgressiveMesh::
+SetMaxPixelError(RNScalar max_pixel_error)
+{
+  // Set maximum pixel error
+  this->max_pixel_error = max_pixel_error;
+}
+
+
+
+inline void R3ProgressiveMesh::
+SetMaxFaces(int max_faces)
+{
+  // Set maximum number of active faces
+  this->max_faces = max_faces;
+}
+
+
+
+inline RNBoolean R3ProgressiveMesh::
+IsVertexActive(int vertex_id) const
+{
+  // Return whether vertex is in active mesh
+  return (vertex_active_indices[vertex_id] >= 0) ? TRUE : FALSE;
+}
+
+
+
+inline RNBoolean R3ProgressiveMesh::
+IsFaceActive(int face_id) const
+{
+  // Return whether face is in active mesh
+  return (face_active_indices[face_id] >= 0) ? TRUE : FALSE;
+}
+
+
+
@@ -131,8 +131,11 @@ class R3Grid;
 #include "R3Shapes/R3Cont.h"
 #include "R3Shapes/R3Isect.h"
 #include "R3Shapes/R3Relate.h"
+#include "R3Shapes/R3Predicates.h"
 #include "R3Shapes/R3Align.h"
 #include "R3Shapes/R3Kdtree.h"
+#include "R3Shapes/R3Batch.h"
+#include "R3Shapes/R3FaceHierarchy.h"
 
 
 
@@ -141,6 +144,17 @@ class R3Grid;
 #include "R3Shapes/R3MeshSearchTree.h"
 #include "R3Shapes/R3MeshProperty.h"
 #include "R3Shapes/R3MeshPropertySet.h"
+#include "R3Shapes/R3MeshPropertySmoother.h"
+#include "R3Shapes/R3MeshAttributeTransfer.h"
+#include "R3Shapes/R3MeshComparison.h"
+#include "R3Shapes/R3MeshSlicer.h"
+#include "R3Shapes/R3MeshIntersectionAudit.h"
+#include "R3Shapes/R3MeshBoolean.h"
+#include "R3Shapes/R3ICPAligner.h"
+#include "R3Shapes/R3PoissonReconstruction.h"
+#include "R3Shapes/R3NormalEstimator.h"
+#include "R3Shapes/R3MeshRemesher.h"
+#include "R3Shapes/R3ProgressiveMesh.h"
 
 
 
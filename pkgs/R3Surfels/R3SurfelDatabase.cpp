@@ -27,6 +27,22 @@ static unsigned int current_minor_version = 1;
 
 
 
+////////////////////////////////////////////////////////////////////////
+// File layout variables
+////////////////////////////////////////////////////////////////////////
+
+// Number of bytes in header and in each block table record (see WriteHeader and WriteBlocks)
+static const unsigned long long file_header_size = 32 + 4*4 + 8 + 3*4 + 6*8 + 1024;
+static const unsigned long long file_block_record_size = 8 + 4 + 4 + 3*8 + 6*8 + 8 + 4 + 64;
+
+// Contiguous range of unused bytes in the database file
+struct R3SurfelDatabaseExtent {
+  unsigned long long offset;
+  unsigned long long size;
+};
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // CONSTRUCTORS/DESTRUCTORS
 ////////////////////////////////////////////////////////////////////////
@@ -46,7 +62,9 @@ R3SurfelDatabase(void)
     bbox(FLT_MAX,FLT_MAX,FLT_MAX,-FLT_MAX,-FLT_MAX,-FLT_MAX),
     name(NULL),
     tree(NULL),
-    resident_surfels(0)
+    resident_surfels(0),
+    free_extents(),
+    pending_extents()
 {
 }
 
@@ -67,7 +85,9 @@ R3SurfelDatabase(const R3SurfelDatabase& database)
     bbox(FLT_MAX,FLT_MAX,FLT_MAX,-FLT_MAX,-FLT_MAX,-FLT_MAX),
     name(strdup(database.name)),
     tree(NULL),
-    resident_surfels(0)
+    resident_surfels(0),
+    free_extents(),
+    pending_extents()
 {
   RNAbort("Not implemented");
 }
@@ -88,6 +108,9 @@ R3SurfelDatabase::
 
   // Delete name
   if (name) free(name);
+
+  // Delete free extents
+  EmptyFreeExtents();
 }
 
 
@@ -183,6 +206,12 @@ RemoveBlock(R3SurfelBlock *block)
     
   // Update block
   block->UpdateBeforeRemove(this);
+
+  // Release space occupied by surfels in file
+  if (fp && (block->file_surfels_offset > 0)) {
+    ReleaseFileExtent(block->file_surfels_offset, 
+      (unsigned long long) block->file_surfels_count * sizeof(R3Surfel));
+  }
     
   // Find block
   RNArrayEntry *entry = blocks.KthEntry(block->database_index);
@@ -1019,10 +1048,16 @@ InternalSyncBlock(R3SurfelBlock *block)
     RNFileSeek(fp, block->file_surfels_offset, RN_FILE_SEEK_SET);
   }
   else {
-    // Surfels must be put at end of file
-    RNFileSeek(fp, 0, SEEK_END);
-    block->file_surfels_offset = RNFileTell(fp);
+    // Release space at original offset (it can be reused after the next SyncFile)
+    if (block->file_surfels_offset > 0) {
+      ReleaseFileExtent(block->file_surfels_offset, 
+        (unsigned long long) block->file_surfels_count * sizeof(R3Surfel));
+    }
+
+    // Surfels must be put in a hole or at end of file
+    block->file_surfels_offset = AllocateFileExtent((unsigned long long) block->nsurfels * sizeof(R3Surfel));
     block->file_surfels_count = block->nsurfels;
+    RNFileSeek(fp, block->file_surfels_offset, RN_FILE_SEEK_SET);
   }
 
   // Write surfels to file
@@ -1076,6 +1111,30 @@ WriteHeader(FILE *fp, int swap_endian)
 
 
 
+int R3SurfelDatabase::
+WriteBlocks(FILE *fp, int swap_endian)
+{
+  // Write block table at current file position
+  char buffer[128] = { '\0' };
+  for (int i = 0; i < blocks.NEntries(); i++) {
+    R3SurfelBlock *block = blocks.Kth(i);
+    unsigned int block_flags = block->flags; 
+    if (!WriteUnsignedLongLong(fp, &block->file_surfels_offset, 1, swap_endian)) return 0;
+    if (!WriteUnsignedInt(fp, &block->file_surfels_count, 1, swap_endian)) return 0;
+    if (!WriteInt(fp, &block->nsurfels, 1, swap_endian)) return 0;
+    if (!WriteDouble(fp, &block->origin[0], 3, swap_endian)) return 0;
+    if (!WriteDouble(fp, &block->bbox[0][0], 6, swap_endian)) return 0;
+    if (!WriteDouble(fp, &block->resolution, 1, swap_endian)) return 0;
+    if (!WriteUnsignedInt(fp, &block_flags, 1, swap_endian)) return 0;
+    if (!WriteChar(fp, buffer, 64, swap_endian)) return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
 int R3SurfelDatabase::
 OpenFile(const char *filename, const char *rwaccess)
 {
@@ -1157,6 +1216,13 @@ OpenFile(const char *filename, const char *rwaccess)
       block->database_index = blocks.NEntries();
       blocks.Insert(block);
     }
+
+    // Find holes left by relocated and removed blocks
+    if (strcmp(this->rwaccess, "rb") && 
+        (major_version == current_major_version) && 
+        (minor_version == current_minor_version)) {
+      UpdateFreeExtents();
+    }
   }
 
   // Return success
@@ -1180,30 +1246,26 @@ SyncFile(void)
   // Update blocks offset
   unsigned int nblocks = blocks.NEntries();
   if (nblocks  > file_blocks_count) {
-    RNFileSeek(fp, 0, RN_FILE_SEEK_END);
-    file_blocks_offset = RNFileTell(fp);
+    if (file_blocks_offset > 0) ReleaseFileExtent(file_blocks_offset, file_blocks_count * file_block_record_size);
+    file_blocks_offset = AllocateFileExtent(nblocks * file_block_record_size);
     file_blocks_count = nblocks;
   }
 
   // Write blocks
-  char buffer[128] = { '\0' };
   RNFileSeek(fp, file_blocks_offset, RN_FILE_SEEK_SET);
-  for (int i = 0; i < blocks.NEntries(); i++) {
-    R3SurfelBlock *block = blocks.Kth(i);
-    unsigned int block_flags = block->flags; 
-    if (!WriteUnsignedLongLong(fp, &block->file_surfels_offset, 1, swap_endian)) return 0;
-    if (!WriteUnsignedInt(fp, &block->file_surfels_count, 1, swap_endian)) return 0;
-    if (!WriteInt(fp, &block->nsurfels, 1, swap_endian)) return 0;
-    if (!WriteDouble(fp, &block->origin[0], 3, swap_endian)) return 0;
-    if (!WriteDouble(fp, &block->bbox[0][0], 6, swap_endian)) return 0;
-    if (!WriteDouble(fp, &block->resolution, 1, swap_endian)) return 0;
-    if (!WriteUnsignedInt(fp, &block_flags, 1, swap_endian)) return 0;
-    if (!WriteChar(fp, buffer, 64, swap_endian)) return 0;
-  }
+  if (!WriteBlocks(fp, swap_endian)) return 0;
 
   // Write header again (now that the offset values have been filled in)
   if (!WriteHeader(fp, swap_endian)) return 0;
 
+  // Space released since last sync is no longer referenced by the file
+  for (int i = 0; i < pending_extents.NEntries(); i++) {
+    R3SurfelDatabaseExtent *extent = pending_extents.Kth(i);
+    InsertFreeExtent(extent->offset, extent->size);
+    delete extent;
+  }
+  pending_extents.Empty();
+
   // Return success
   return 1;
 }
@@ -1220,6 +1282,9 @@ CloseFile(void)
   fclose(fp);
   fp = NULL;
 
+  // Reset free extents
+  EmptyFreeExtents();
+
   // Reset filename
   if (filename) free(filename);
   filename = NULL;
@@ -1234,6 +1299,405 @@ CloseFile(void)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// FILE SPACE FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+unsigned long long R3SurfelDatabase::
+FreeFileSpace(void) const
+{
+  // Sum sizes of holes (including ones released since last sync)
+  unsigned long long size = 0;
+  for (int i = 0; i < free_extents.NEntries(); i++) size += free_extents.Kth(i)->size;
+  for (int i = 0; i < pending_extents.NEntries(); i++) size += pending_extents.Kth(i)->size;
+  return size;
+}
+
+
+
+unsigned long long R3SurfelDatabase::
+AllocateFileExtent(unsigned long long size)
+{
+  // Caller must write the allocated bytes before allocating again,
+  // since space at the end of the file is found by seeking there
+
+  // Take first hole that is big enough
+  for (int i = 0; i < free_extents.NEntries(); i++) {
+    R3SurfelDatabaseExtent *extent = free_extents.Kth(i);
+    if (extent->size < size) continue;
+    unsigned long long offset = extent->offset;
+    extent->offset += size;
+    extent->size -= size;
+    if (extent->size == 0) { free_extents.RemoveKth(i); delete extent; }
+    return offset;
+  }
+
+  // Get offset of end of file
+  RNFileSeek(fp, 0, RN_FILE_SEEK_END);
+  unsigned long long offset = RNFileTell(fp);
+
+  // Extend last hole if it is at end of file
+  if (!free_extents.IsEmpty()) {
+    R3SurfelDatabaseExtent *extent = free_extents.Tail();
+    if (extent->offset + extent->size == offset) {
+      offset = extent->offset;
+      free_extents.RemoveTail();
+      delete extent;
+    }
+  }
+
+  // Return offset
+  return offset;
+}
+
+
+
+void R3SurfelDatabase::
+ReleaseFileExtent(unsigned long long offset, unsigned long long size)
+{
+  // Check size
+  if (size == 0) return;
+
+  // Remember extent until the block table no longer refers to it (see SyncFile)
+  R3SurfelDatabaseExtent *extent = new R3SurfelDatabaseExtent();
+  extent->offset = offset;
+  extent->size = size;
+  pending_extents.Insert(extent);
+}
+
+
+
+void R3SurfelDatabase::
+InsertFreeExtent(unsigned long long offset, unsigned long long size)
+{
+  // Check size
+  if (size == 0) return;
+
+  // Find first hole after offset (free extents are sorted by offset)
+  int lo = 0, hi = free_extents.NEntries();
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (free_extents.Kth(mid)->offset < offset) lo = mid + 1;
+    else hi = mid;
+  }
+
+  // Merge with previous hole
+  R3SurfelDatabaseExtent *prev = (lo > 0) ? free_extents.Kth(lo-1) : NULL;
+  R3SurfelDatabaseExtent *next = (lo < free_extents.NEntries()) ? free_extents.Kth(lo) : NULL;
+  if (prev && (prev->offset + prev->size == offset)) {
+    prev->size += size;
+    if (next && (prev->offset + prev->size == next->offset)) {
+      prev->size += next->size;
+      free_extents.RemoveKth(lo);
+      delete next;
+    }
+    return;
+  }
+
+  // Merge with next hole
+  if (next && (offset + size == next->offset)) {
+    next->offset = offset;
+    next->size += size;
+    return;
+  }
+
+  // Insert new hole
+  R3SurfelDatabaseExtent *extent = new R3SurfelDatabaseExtent();
+  extent->offset = offset;
+  extent->size = size;
+  if (next) free_extents.InsertBefore(extent, free_extents.KthEntry(lo));
+  else free_extents.Insert(extent);
+}
+
+
+
+static int
+CompareExtents(const void *data1, const void *data2)
+{
+  // Sort by offset
+  const R3SurfelDatabaseExtent *extent1 = (const R3SurfelDatabaseExtent *) data1;
+  const R3SurfelDatabaseExtent *extent2 = (const R3SurfelDatabaseExtent *) data2;
+  if (extent1->offset < extent2->offset) return -1;
+  else if (extent1->offset > extent2->offset) return 1;
+  else return 0;
+}
+
+
+
+void R3SurfelDatabase::
+UpdateFreeExtents(void)
+{
+  // Empty free extents
+  EmptyFreeExtents();
+
+  // Gather extents referenced by header and block table
+  int nused = 0;
+  R3SurfelDatabaseExtent *used = new R3SurfelDatabaseExtent [ blocks.NEntries() + 2 ];
+  used[nused].offset = 0;
+  used[nused].size = file_header_size;
+  nused++;
+  if (file_blocks_offset > 0) {
+    used[nused].offset = file_blocks_offset;
+    used[nused].size = file_blocks_count * file_block_record_size;
+    nused++;
+  }
+  for (int i = 0; i < blocks.NEntries(); i++) {
+    R3SurfelBlock *block = blocks.Kth(i);
+    if ((block->file_surfels_offset == 0) || (block->file_surfels_count == 0)) continue;
+    used[nused].offset = block->file_surfels_offset;
+    used[nused].size = (unsigned long long) block->file_surfels_count * sizeof(R3Surfel);
+    nused++;
+  }
+
+  // Insert gaps between used extents as holes
+  qsort(used, nused, sizeof(R3SurfelDatabaseExtent), CompareExtents);
+  unsigned long long end = 0;
+  for (int i = 0; i < nused; i++) {
+    if (used[i].offset > end) InsertFreeExtent(end, used[i].offset - end);
+    if (used[i].offset + used[i].size > end) end = used[i].offset + used[i].size;
+  }
+
+  // Insert gap at end of file as hole
+  RNFileSeek(fp, 0, RN_FILE_SEEK_END);
+  unsigned long long file_size = RNFileTell(fp);
+  if (file_size > end) InsertFreeExtent(end, file_size - end);
+
+  // Delete temporary memory
+  delete [] used;
+}
+
+
+
+void R3SurfelDatabase::
+EmptyFreeExtents(void)
+{
+  // Delete free extents
+  for (int i = 0; i < free_extents.NEntries(); i++) delete free_extents.Kth(i);
+  free_extents.Empty();
+
+  // Delete pending extents
+  for (int i = 0; i < pending_extents.NEntries(); i++) delete pending_extents.Kth(i);
+  pending_extents.Empty();
+}
+
+
+
+static unsigned long long
+MortonCode(const R3Point& position, const R3Box& bbox)
+{
+  // Interleave bits of 21-bit coordinates within bbox
+  unsigned long long code = 0;
+  for (int dim = 0; dim < 3; dim++) {
+    RNLength length = bbox.AxisLength(dim);
+    RNScalar t = (length > 0) ? (position[dim] - bbox.Min()[dim]) / length : 0;
+    if (t < 0) t = 0; else if (t > 1) t = 1;
+    unsigned long long k = (unsigned long long) (t * 2097151.0);
+    for (int bit = 0; bit < 21; bit++) {
+      if (k & (1ULL << bit)) code |= 1ULL << (3*bit + dim);
+    }
+  }
+
+  // Return code
+  return code;
+}
+
+
+
+static int
+CompareMortonCodes(const void *data1, const void *data2)
+{
+  // Sort by code, then by index
+  const unsigned long long *entry1 = (const unsigned long long *) data1;
+  const unsigned long long *entry2 = (const unsigned long long *) data2;
+  if (entry1[0] < entry2[0]) return -1;
+  else if (entry1[0] > entry2[0]) return 1;
+  else if (entry1[1] < entry2[1]) return -1;
+  else if (entry1[1] > entry2[1]) return 1;
+  else return 0;
+}
+
+
+
+int R3SurfelDatabase::
+CompactFile(int block_order)
+{
+  // Check file
+  if (!fp || !filename) {
+    fprintf(stderr, "Unable to compact database that is not open\n");
+    return 0;
+  }
+
+  // Check file rwaccess
+  if (!strstr(rwaccess, "+")) {
+    fprintf(stderr, "Unable to compact read-only database file %s\n", filename);
+    return 0;
+  }
+
+  // Check database version
+  if ((major_version != current_major_version) || (minor_version != current_minor_version)) {
+    fprintf(stderr, "Unable to compact database file %s with different version\n", filename);
+    return 0;
+  }
+
+  // Write dirty blocks and block table
+  if (!SyncFile()) return 0;
+
+  // Determine order of blocks in file (indices in database are not changed)
+  int nblocks = blocks.NEntries();
+  int norder = 0;
+  int *order = new int [ nblocks ];
+  if ((block_order == R3_SURFEL_DATABASE_TREE_BLOCK_ORDER) && tree && tree->RootNode()) {
+    // Put blocks in depth-first order of tree nodes
+    RNBoolean *ordered = new RNBoolean [ nblocks ];
+    for (int i = 0; i < nblocks; i++) ordered[i] = FALSE;
+    RNArray<R3SurfelNode *> stack;
+    stack.Insert(tree->RootNode());
+    while (!stack.IsEmpty()) {
+      R3SurfelNode *node = stack.Tail();
+      stack.RemoveTail();
+      for (int i = 0; i < node->NBlocks(); i++) {
+        R3SurfelBlock *block = node->Block(i);
+        if (block->database != this) continue;
+        if (ordered[block->database_index]) continue;
+        ordered[block->database_index] = TRUE;
+        order[norder++] = block->database_index;
+      }
+      for (int i = node->NParts()-1; i >= 0; i--) {
+        stack.Insert(node->Part(i));
+      }
+    }
+
+    // Put blocks not in tree at end
+    for (int i = 0; i < nblocks; i++) {
+      if (!ordered[i]) order[norder++] = i;
+    }
+
+    // Delete temporary memory
+    delete [] ordered;
+  }
+  else if (block_order == R3_SURFEL_DATABASE_MORTON_BLOCK_ORDER) {
+    // Put blocks in Morton order of centroids
+    unsigned long long *entries = new unsigned long long [ 2*nblocks ];
+    for (int i = 0; i < nblocks; i++) {
+      entries[2*i+0] = MortonCode(blocks.Kth(i)->BBox().Centroid(), bbox);
+      entries[2*i+1] = i;
+    }
+    qsort(entries, nblocks, 2*sizeof(unsigned long long), CompareMortonCodes);
+    for (int i = 0; i < nblocks; i++) order[norder++] = (int) entries[2*i+1];
+    delete [] entries;
+  }
+  else {
+    // Put blocks in database order
+    for (int i = 0; i < nblocks; i++) order[norder++] = i;
+  }
+
+  // Open temporary file
+  char tmp_filename[4096];
+  sprintf(tmp_filename, "%s.tmp", filename);
+  FILE *tmp_fp = fopen(tmp_filename, "w+b");
+  if (!tmp_fp) {
+    fprintf(stderr, "Unable to open temporary database file %s\n", tmp_filename);
+    delete [] order;
+    return 0;
+  }
+
+  // Copy surfels of blocks to temporary file (bytes are copied as is)
+  int status = 1;
+  unsigned long long *offsets = new unsigned long long [ nblocks ];
+  const unsigned long long buffer_size = 1024 * 1024;
+  char *buffer = new char [ buffer_size ];
+  RNFileSeek(tmp_fp, file_header_size, RN_FILE_SEEK_SET);
+  for (int i = 0; status && (i < nblocks); i++) {
+    R3SurfelBlock *block = blocks.Kth(order[i]);
+    offsets[order[i]] = 0;
+    if ((block->nsurfels == 0) || (block->file_surfels_offset == 0)) continue;
+    offsets[order[i]] = RNFileTell(tmp_fp);
+    RNFileSeek(fp, block->file_surfels_offset, RN_FILE_SEEK_SET);
+    unsigned long long remaining = (unsigned long long) block->nsurfels * sizeof(R3Surfel);
+    while (status && (remaining > 0)) {
+      size_t count = (remaining < buffer_size) ? remaining : buffer_size;
+      if (fread(buffer, 1, count, fp) != count) status = 0;
+      else if (fwrite(buffer, 1, count, tmp_fp) != count) status = 0;
+      else remaining -= count;
+    }
+  }
+
+  // Delete temporary memory
+  delete [] buffer;
+  delete [] order;
+
+  // Check status
+  if (!status) {
+    fprintf(stderr, "Unable to copy surfels to temporary database file %s\n", tmp_filename);
+    delete [] offsets;
+    fclose(tmp_fp);
+    remove(tmp_filename);
+    return 0;
+  }
+
+  // Remember file layout (restored if writing fails)
+  unsigned long long *old_offsets = new unsigned long long [ nblocks ];
+  unsigned int *old_counts = new unsigned int [ nblocks ];
+  unsigned long long old_file_blocks_offset = file_blocks_offset;
+  unsigned int old_file_blocks_count = file_blocks_count;
+  for (int i = 0; i < nblocks; i++) {
+    R3SurfelBlock *block = blocks.Kth(i);
+    old_offsets[i] = block->file_surfels_offset;
+    old_counts[i] = block->file_surfels_count;
+    block->file_surfels_offset = offsets[i];
+    block->file_surfels_count = (offsets[i] > 0) ? block->nsurfels : 0;
+  }
+
+  // Write block table and header to temporary file
+  file_blocks_offset = RNFileTell(tmp_fp);
+  file_blocks_count = nblocks;
+  if (!WriteBlocks(tmp_fp, swap_endian)) status = 0;
+  else if (!WriteHeader(tmp_fp, swap_endian)) status = 0;
+  else if (!RNFileSync(tmp_fp)) status = 0;
+  if (fclose(tmp_fp)) status = 0;
+
+  // Replace database file with temporary file
+  if (status) {
+    fclose(fp);
+    if (!RNFileReplace(tmp_filename, filename)) status = 0;
+    fp = fopen(filename, "r+b");
+    if (!fp) {
+      fprintf(stderr, "Unable to reopen database file %s\n", filename);
+      delete [] old_offsets;
+      delete [] old_counts;
+      delete [] offsets;
+      return 0;
+    }
+  }
+
+  // Restore file layout if failed
+  if (!status) {
+    fprintf(stderr, "Unable to write compacted database file %s\n", filename);
+    for (int i = 0; i < nblocks; i++) {
+      R3SurfelBlock *block = blocks.Kth(i);
+      block->file_surfels_offset = old_offsets[i];
+      block->file_surfels_count = old_counts[i];
+    }
+    file_blocks_offset = old_file_blocks_offset;
+    file_blocks_count = old_file_blocks_count;
+    remove(tmp_filename);
+  }
+  else {
+    // Compacted file has no holes
+    EmptyFreeExtents();
+  }
+
+  // Delete temporary memory
+  delete [] old_offsets;
+  delete [] old_counts;
+  delete [] offsets;
+
+  // Return status
+  return status;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // LP2 I/O FUNCTIONS
 ////////////////////////////////////////////////////////////////////////
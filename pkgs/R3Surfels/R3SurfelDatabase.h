@@ -2,10 +2,24 @@
 
 
 
+////////////////////////////////////////////////////////////////////////
+// CONSTANT DEFINITIONS
+////////////////////////////////////////////////////////////////////////
+
+// Block orders for CompactFile
+
+#define R3_SURFEL_DATABASE_INDEX_BLOCK_ORDER    0
+#define R3_SURFEL_DATABASE_TREE_BLOCK_ORDER     1
+#define R3_SURFEL_DATABASE_MORTON_BLOCK_ORDER   2
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // CLASS DEFINITION
 ////////////////////////////////////////////////////////////////////////
 
+struct R3SurfelDatabaseExtent;
+
 class R3SurfelDatabase {
 public:
   //////////////////////////////////////////
@@ -98,6 +112,12 @@ public:
   virtual int CloseFile(void);
   virtual RNBoolean IsOpen(void) const;
 
+  // File space management functions
+  unsigned long long FreeFileSpace(void) const;
+    // Returns number of bytes in holes left by relocated and removed blocks
+  virtual int CompactFile(int block_order = R3_SURFEL_DATABASE_TREE_BLOCK_ORDER);
+    // Rewrites the file with surfels of blocks adjacent in the given order and without holes
+
   // I/O functions for other file formats
   virtual int ReadFile(const char *filename);
   virtual int WriteFile(const char *filename) const;
@@ -126,6 +146,14 @@ protected:
 
   // Internal functions
   virtual int WriteHeader(FILE *fp, int swap_endian);
+  virtual int WriteBlocks(FILE *fp, int swap_endian);
+
+  // Internal file space functions
+  unsigned long long AllocateFileExtent(unsigned long long size);
+  void ReleaseFileExtent(unsigned long long offset, unsigned long long size);
+  void InsertFreeExtent(unsigned long long offset, unsigned long long size);
+  void UpdateFreeExtents(void);
+  void EmptyFreeExtents(void);
 
 protected:
   FILE *fp;
@@ -143,6 +171,8 @@ protected:
   friend class R3SurfelTree;
   R3SurfelTree *tree;
   unsigned long resident_surfels;
+  RNArray<R3SurfelDatabaseExtent *> free_extents;
+  RNArray<R3SurfelDatabaseExtent *> pending_extents;
 };
 
 
@@ -504,8 +504,11 @@ InsertNode(R3SurfelNode *node)
   // Update node
   node->UpdateAfterInsert(this);
 
-  // Mark scene as dirty
-  if (scene) scene->SetDirty();
+  // Append journal record (or just mark scene as dirty)
+  if (scene) {
+    if ((scene_index >= 0) && (node->TreeIndex() >= 0)) scene->InsertJournalRecord("ON+ %d %d\n", scene_index, node->TreeIndex());
+    else scene->SetDirty();
+  }
 }
 
 
@@ -538,8 +541,11 @@ RemoveNode(R3SurfelNode *node)
     ancestor = ancestor->parent;
   }
 
-  // Mark scene as dirty
-  if (scene) scene->SetDirty();
+  // Append journal record (or just mark scene as dirty)
+  if (scene) {
+    if ((scene_index >= 0) && (node->TreeIndex() >= 0)) scene->InsertJournalRecord("ON- %d %d\n", scene_index, node->TreeIndex());
+    else scene->SetDirty();
+  }
 }
 
 
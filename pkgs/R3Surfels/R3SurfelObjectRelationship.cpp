@@ -125,6 +125,17 @@ Draw(RNFlags flags) const
       glEnd();
       break;
     }
+
+  case R3_SURFEL_OBJECT_COPLANAR_RELATIONSHIP: 
+    // Draw line between objects
+    if (objects.NEntries() == 2) {
+      if (flags[R3_SURFEL_COLOR_DRAW_FLAG]) glColor3d(0, 0, 1);
+      glBegin(GL_LINES);
+      R3LoadPoint(objects[0]->Centroid());
+      R3LoadPoint(objects[1]->Centroid());
+      glEnd();
+      break;
+    }
   }
 }
 
@@ -0,0 +1,519 @@
+/* Source file for the R3 surfel picker class */
+
+
+
+////////////////////////////////////////////////////////////////////////
+// INCLUDE FILES
+////////////////////////////////////////////////////////////////////////
+
+#include "R3Surfels/R3Surfels.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// INDEX STRUCTURES
+////////////////////////////////////////////////////////////////////////
+
+// Maximum number of blocks in a leaf cell
+#define R3_SURFEL_PICKER_MAX_LEAF_ENTRIES 4
+
+struct R3SurfelPickerEntry {
+  R3SurfelBlock *block;
+  int node_index;
+  R3Box bbox;
+};
+
+struct R3SurfelPickerCell {
+  R3Box bbox;
+  int children[2];
+  int first_entry;
+  int nentries;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// CONSTRUCTORS/DESTRUCTORS
+////////////////////////////////////////////////////////////////////////
+
+R3SurfelPicker::
+R3SurfelPicker(void)
+  : nodes(),
+    entries(NULL),
+    nentries(0),
+    cells(NULL),
+    ncells(0),
+    eye(0,0,0),
+    towards(0,0,-1),
+    up(0,1,0),
+    right(1,0,0),
+    xfov_tangent(1),
+    yfov_tangent(1),
+    neardist(0),
+    fardist(FLT_MAX),
+    viewport(0,0,1,1),
+    pick_tolerance(5),
+    aerial_visibility(TRUE),
+    terrestrial_visibility(TRUE),
+    backfacing_visibility(TRUE),
+    viewing_extent(FLT_MAX,FLT_MAX,FLT_MAX,-FLT_MAX,-FLT_MAX,-FLT_MAX)
+{
+}
+
+
+
+R3SurfelPicker::
+~R3SurfelPicker(void)
+{
+  // Delete index
+  Empty();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// MANIPULATION FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+void R3SurfelPicker::
+Empty(void)
+{
+  // Delete index
+  if (entries) delete [] entries;
+  if (cells) delete [] cells;
+  entries = NULL;
+  cells = NULL;
+  nentries = 0;
+  ncells = 0;
+  nodes.Empty();
+}
+
+
+
+void R3SurfelPicker::
+Build(const R3SurfelNodeSet& node_set)
+{
+  // Delete previous index
+  Empty();
+
+  // Count blocks
+  int nblocks = 0;
+  for (int i = 0; i < node_set.NNodes(); i++) {
+    R3SurfelNode *node = node_set.Node(i);
+    nblocks += node->NBlocks();
+  }
+
+  // Create entries for blocks with surfels in memory
+  entries = new R3SurfelPickerEntry [ nblocks + 1 ];
+  for (int i = 0; i < node_set.NNodes(); i++) {
+    R3SurfelNode *node = node_set.Node(i);
+    nodes.Insert(node);
+    for (int j = 0; j < node->NBlocks(); j++) {
+      R3SurfelBlock *block = node->Block(j);
+      if (!block->Surfels() || (block->NSurfels() == 0)) continue;
+      R3SurfelPickerEntry& entry = entries[nentries++];
+      entry.block = block;
+      entry.node_index = i;
+      entry.bbox = block->BBox();
+    }
+  }
+
+  // Create cells (a binary tree has at most 2n-1 nodes)
+  cells = new R3SurfelPickerCell [ 2 * nentries + 1 ];
+  BuildCell(0, nentries);
+}
+
+
+
+int R3SurfelPicker::
+BuildCell(int first_entry, int cell_nentries)
+{
+  // Allocate cell
+  int cell_index = ncells++;
+  R3SurfelPickerCell& cell = cells[cell_index];
+  cell.children[0] = -1;
+  cell.children[1] = -1;
+  cell.first_entry = first_entry;
+  cell.nentries = cell_nentries;
+
+  // Compute bounding boxes of entries and their centers
+  R3Box center_bbox = R3null_box;
+  cell.bbox = R3null_box;
+  for (int i = first_entry; i < first_entry + cell_nentries; i++) {
+    cell.bbox.Union(entries[i].bbox);
+    center_bbox.Union(entries[i].bbox.Centroid());
+  }
+
+  // Check if leaf
+  if (cell_nentries <= R3_SURFEL_PICKER_MAX_LEAF_ENTRIES) return cell_index;
+
+  // Partition entries by center along longest axis
+  int dim = center_bbox.LongestAxis();
+  RNCoord split = center_bbox.Centroid()[dim];
+  int i = first_entry;
+  int j = first_entry + cell_nentries - 1;
+  while (i <= j) {
+    if (entries[i].bbox.Centroid()[dim] < split) i++;
+    else { R3SurfelPickerEntry swap = entries[i]; entries[i] = entries[j]; entries[j] = swap; j--; }
+  }
+
+  // Split in the middle if all centers are on one side
+  int nentries0 = i - first_entry;
+  if ((nentries0 == 0) || (nentries0 == cell_nentries)) nentries0 = cell_nentries / 2;
+
+  // Build children (cell reference may be invalid after recursion, so use index)
+  int child0 = BuildCell(first_entry, nentries0);
+  int child1 = BuildCell(first_entry + nentries0, cell_nentries - nentries0);
+  cells[cell_index].children[0] = child0;
+  cells[cell_index].children[1] = child1;
+
+  // Return cell index
+  return cell_index;
+}
+
+
+
+void R3SurfelPicker::
+SetCamera(const R3Point& eye, const R3Vector& towards, const R3Vector& up,
+  RNAngle xfov, RNAngle yfov, RNLength neardist, RNLength fardist)
+{
+  // Set camera frame
+  this->eye = eye;
+  this->towards = towards;
+  this->towards.Normalize();
+  this->right = towards % up;
+  this->right.Normalize();
+  this->up = this->right % this->towards;
+  this->up.Normalize();
+
+  // Set camera frustum
+  this->xfov_tangent = tan(xfov);
+  this->yfov_tangent = tan(yfov);
+  this->neardist = neardist;
+  this->fardist = fardist;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// PROJECTION FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+RNBoolean R3SurfelPicker::
+ProjectPoint(const R3Point& point, R2Point *projection, RNLength *depth) const
+{
+  // Compute depth along view direction
+  R3Vector v = point - eye;
+  RNLength d = v.Dot(towards);
+  if (depth) *depth = d;
+  if (RNIsNegativeOrZero(d)) return FALSE;
+
+  // Compute 2D point projected onto viewport (as in R3Viewer::ViewportPoint)
+  if (projection) {
+    RNCoord x = viewport.XCenter() + 0.5 * viewport.XLength() * v.Dot(right) / (d * xfov_tangent);
+    RNCoord y = viewport.YCenter() + 0.5 * viewport.YLength() * v.Dot(up) / (d * yfov_tangent);
+    projection->Reset(x, y);
+  }
+
+  // Return success
+  return TRUE;
+}
+
+
+
+RNBoolean R3SurfelPicker::
+ProjectBox(const R3Box& box, R2Box *projection, RNLength *mindepth, RNLength *maxdepth) const
+{
+  // Compute depth range of box corners
+  RNLength dmin = FLT_MAX;
+  RNLength dmax = -FLT_MAX;
+  for (RNOctant octant = RN_NNN_OCTANT; octant <= RN_PPP_OCTANT; octant++) {
+    RNLength d = (box.Corner(octant) - eye).Dot(towards);
+    if (d < dmin) dmin = d;
+    if (d > dmax) dmax = d;
+  }
+
+  // Return depth range
+  if (mindepth) *mindepth = dmin;
+  if (maxdepth) *maxdepth = dmax;
+
+  // Check if box is outside depth range of camera
+  if (dmax < neardist) return FALSE;
+  if (RNIsNegativeOrZero(dmax)) return FALSE;
+  if (dmin > fardist) return FALSE;
+
+  // Compute bounding box of projected corners
+  if (projection) {
+    if (RNIsNegativeOrZero(dmin)) {
+      // Box spans eye plane, so it could cover any pixel
+      *projection = R2infinite_box;
+    }
+    else {
+      // Union projections of corners
+      *projection = R2null_box;
+      for (RNOctant octant = RN_NNN_OCTANT; octant <= RN_PPP_OCTANT; octant++) {
+        R2Point p;
+        ProjectPoint(box.Corner(octant), &p, NULL);
+        projection->Union(p);
+      }
+    }
+  }
+
+  // Return success
+  return TRUE;
+}
+
+
+
+RNBoolean R3SurfelPicker::
+IsSurfelVisible(const R3SurfelBlock *block, const R3Surfel *surfel, R3Point *position) const
+{
+  // Check surfel flags
+  if (!aerial_visibility && surfel->IsAerial()) return FALSE;
+  if (!terrestrial_visibility && surfel->IsTerrestrial()) return FALSE;
+
+  // Check surfel orientation
+  if (!backfacing_visibility) {
+    R3Vector normal(surfel->NX(), surfel->NY(), surfel->NZ());
+    if (normal.Dot(towards) >= 0) return FALSE;
+  }
+
+  // Compute world position
+  const R3Point& origin = block->Origin();
+  R3Point p(origin.X() + surfel->X(), origin.Y() + surfel->Y(), origin.Z() + surfel->Z());
+
+  // Check viewing extent
+  if (!viewing_extent.IsEmpty()) {
+    if (!R3Contains(viewing_extent, p)) return FALSE;
+  }
+
+  // Return world position
+  if (position) *position = p;
+
+  // Return success
+  return TRUE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// PICKING FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+void R3SurfelPicker::
+PickCell(int cell_index, const R2Point& cursor, RNLength *best_depth, RNLength *best_offset,
+  int *best_entry, const R3Surfel **best_surfel, R3Point *best_position) const
+{
+  // Check if cell can contain a closer surfel within tolerance of cursor
+  R2Box projection;
+  RNLength mindepth, maxdepth;
+  const R3SurfelPickerCell& cell = cells[cell_index];
+  if (!ProjectBox(cell.bbox, &projection, &mindepth, &maxdepth)) return;
+  if (mindepth > *best_depth) return;
+  if (cursor.X() < projection.XMin() - pick_tolerance) return;
+  if (cursor.X() > projection.XMax() + pick_tolerance) return;
+  if (cursor.Y() < projection.YMin() - pick_tolerance) return;
+  if (cursor.Y() > projection.YMax() + pick_tolerance) return;
+
+  // Check if interior cell
+  if (cell.children[0] >= 0) {
+    // Visit children front to back
+    RNLength depth0 = FLT_MAX, depth1 = FLT_MAX;
+    ProjectBox(cells[cell.children[0]].bbox, NULL, &depth0, NULL);
+    ProjectBox(cells[cell.children[1]].bbox, NULL, &depth1, NULL);
+    int first = (depth0 <= depth1) ? 0 : 1;
+    PickCell(cell.children[first], cursor, best_depth, best_offset, best_entry, best_surfel, best_position);
+    PickCell(cell.children[1-first], cursor, best_depth, best_offset, best_entry, best_surfel, best_position);
+    return;
+  }
+
+  // Visit surfels in blocks of leaf cell
+  for (int i = cell.first_entry; i < cell.first_entry + cell.nentries; i++) {
+    const R3SurfelPickerEntry& entry = entries[i];
+    const R3SurfelBlock *block = entry.block;
+    for (int j = 0; j < block->NSurfels(); j++) {
+      const R3Surfel *surfel = block->Surfel(j);
+
+      // Check surfel filters
+      R3Point position;
+      if (!IsSurfelVisible(block, surfel, &position)) continue;
+
+      // Check depth
+      R2Point p;
+      RNLength depth;
+      if (!ProjectPoint(position, &p, &depth)) continue;
+      if ((depth < neardist) || (depth > fardist)) continue;
+      if (depth > *best_depth) continue;
+
+      // Check distance to cursor
+      RNLength dx = fabs(p.X() - cursor.X());
+      RNLength dy = fabs(p.Y() - cursor.Y());
+      if ((dx > pick_tolerance) || (dy > pick_tolerance)) continue;
+
+      // Break depth ties by distance to cursor
+      RNLength offset = dx*dx + dy*dy;
+      if ((depth == *best_depth) && (offset >= *best_offset)) continue;
+
+      // Remember closest surfel
+      *best_depth = depth;
+      *best_offset = offset;
+      *best_entry = i;
+      *best_surfel = surfel;
+      *best_position = position;
+    }
+  }
+}
+
+
+
+R3SurfelNode *R3SurfelPicker::
+PickNode(const R2Point& cursor, R3Point *picked_position,
+  R3SurfelBlock **picked_block, const R3Surfel **picked_surfel) const
+{
+  // Check index
+  if (ncells == 0) return NULL;
+
+  // Search hierarchy for closest surfel near cursor
+  RNLength best_depth = FLT_MAX;
+  RNLength best_offset = FLT_MAX;
+  int best_entry = -1;
+  const R3Surfel *best_surfel = NULL;
+  R3Point best_position(0,0,0);
+  PickCell(0, cursor, &best_depth, &best_offset, &best_entry, &best_surfel, &best_position);
+  if (best_entry < 0) return NULL;
+
+  // Return picked position, block, and surfel
+  const R3SurfelPickerEntry& entry = entries[best_entry];
+  if (picked_position) *picked_position = best_position;
+  if (picked_block) *picked_block = entry.block;
+  if (picked_surfel) *picked_surfel = best_surfel;
+
+  // Return picked node
+  return nodes.Kth(entry.node_index);
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// SELECTION FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+static RNBoolean
+LassoContains(const R2Polygon& lasso, const R2Point& point)
+{
+  // Count crossings of horizontal ray from point with lasso edges
+  RNBoolean inside = FALSE;
+  int npoints = lasso.NPoints();
+  for (int i = 0, j = npoints - 1; i < npoints; j = i++) {
+    const R2Point& p1 = lasso.Point(i);
+    const R2Point& p2 = lasso.Point(j);
+    if ((p1.Y() > point.Y()) == (p2.Y() > point.Y())) continue;
+    RNCoord x = p1.X() + (point.Y() - p1.Y()) * (p2.X() - p1.X()) / (p2.Y() - p1.Y());
+    if (point.X() < x) inside = !inside;
+  }
+
+  // Return whether point is inside
+  return inside;
+}
+
+
+
+void R3SurfelPicker::
+SelectCell(int cell_index, const R2Box& rectangle, const R2Polygon *lasso,
+  RNBoolean *node_marks, RNArray<R3SurfelNode *> *selected_nodes, R3SurfelPointSet *points) const
+{
+  // Check if projection of cell overlaps rectangle
+  R2Box projection;
+  const R3SurfelPickerCell& cell = cells[cell_index];
+  if (!ProjectBox(cell.bbox, &projection, NULL, NULL)) return;
+  if (!R2Intersects(projection, rectangle)) return;
+
+  // Visit children of interior cell
+  if (cell.children[0] >= 0) {
+    SelectCell(cell.children[0], rectangle, lasso, node_marks, selected_nodes, points);
+    SelectCell(cell.children[1], rectangle, lasso, node_marks, selected_nodes, points);
+    return;
+  }
+
+  // Visit surfels in blocks of leaf cell
+  for (int i = cell.first_entry; i < cell.first_entry + cell.nentries; i++) {
+    const R3SurfelPickerEntry& entry = entries[i];
+    if (node_marks[entry.node_index] && !points) continue;
+    R3SurfelBlock *block = entry.block;
+    for (int j = 0; j < block->NSurfels(); j++) {
+      const R3Surfel *surfel = block->Surfel(j);
+
+      // Check surfel filters
+      R3Point position;
+      if (!IsSurfelVisible(block, surfel, &position)) continue;
+
+      // Check projection
+      R2Point p;
+      RNLength depth;
+      if (!ProjectPoint(position, &p, &depth)) continue;
+      if ((depth < neardist) || (depth > fardist)) continue;
+      if (!R2Contains(rectangle, p)) continue;
+      if (lasso && !LassoContains(*lasso, p)) continue;
+
+      // Insert node
+      if (!node_marks[entry.node_index]) {
+        node_marks[entry.node_index] = TRUE;
+        if (selected_nodes) selected_nodes->Insert(nodes.Kth(entry.node_index));
+        if (!points) break;
+      }
+
+      // Insert point
+      points->InsertPoint(R3SurfelPoint(block, surfel));
+    }
+  }
+}
+
+
+
+int R3SurfelPicker::
+SelectNodes(const R2Box& rectangle, RNArray<R3SurfelNode *> *selected_nodes, R3SurfelPointSet *points) const
+{
+  // Check index
+  if (ncells == 0) return 0;
+  if (rectangle.IsEmpty()) return 0;
+
+  // Select surfels inside rectangle
+  RNBoolean *node_marks = new RNBoolean [ nodes.NEntries() + 1 ];
+  for (int i = 0; i < nodes.NEntries(); i++) node_marks[i] = FALSE;
+  SelectCell(0, rectangle, NULL, node_marks, selected_nodes, points);
+
+  // Count selected nodes
+  int count = 0;
+  for (int i = 0; i < nodes.NEntries(); i++) if (node_marks[i]) count++;
+
+  // Delete marks
+  delete [] node_marks;
+
+  // Return number of selected nodes
+  return count;
+}
+
+
+
+int R3SurfelPicker::
+SelectNodes(const R2Polygon& lasso, RNArray<R3SurfelNode *> *selected_nodes, R3SurfelPointSet *points) const
+{
+  // Check index
+  if (ncells == 0) return 0;
+  if (lasso.NPoints() < 3) return 0;
+
+  // Select surfels inside lasso (rectangle test first)
+  RNBoolean *node_marks = new RNBoolean [ nodes.NEntries() + 1 ];
+  for (int i = 0; i < nodes.NEntries(); i++) node_marks[i] = FALSE;
+  SelectCell(0, lasso.BBox(), &lasso, node_marks, selected_nodes, points);
+
+  // Count selected nodes
+  int count = 0;
+  for (int i = 0; i < nodes.NEntries(); i++) if (node_marks[i]) count++;
+
+  // Delete marks
+  delete [] node_marks;
+
+  // Return number of selected nodes
+  return count;
+}
@@ -0,0 +1,321 @@
+/* Include file for the R3 surfel picker class */
+
+
+
+////////////////////////////////////////////////////////////////////////
+// CLASS DEFINITION
+////////////////////////////////////////////////////////////////////////
+
+struct R3SurfelPickerEntry;
+struct R3SurfelPickerCell;
+
+class R3SurfelPicker {
+public:
+  //////////////////////////////////////////
+  //// CONSTRUCTOR/DESTRUCTOR FUNCTIONS ////
+  //////////////////////////////////////////
+
+  // Constructor functions
+  R3SurfelPicker(void);
+
+  // Destructor function
+  ~R3SurfelPicker(void);
+
+
+  ////////////////////////////
+  //// PROPERTY FUNCTIONS ////
+  ////////////////////////////
+
+  // Index property functions
+  RNBoolean IsEmpty(void) const;
+  int NNodes(void) const;
+  R3SurfelNode *Node(int k) const;
+  int NBlocks(void) const;
+
+  // Camera property functions
+  const R3Point& Eye(void) const;
+  const R3Vector& Towards(void) const;
+  const R3Vector& Up(void) const;
+  const R3Vector& Right(void) const;
+  const R2Box& Viewport(void) const;
+
+  // Filter property functions
+  RNLength PickTolerance(void) const;
+  RNBoolean AerialVisibility(void) const;
+  RNBoolean TerrestrialVisibility(void) const;
+  RNBoolean BackfacingVisibility(void) const;
+  const R3Box& ViewingExtent(void) const;
+
+
+  ////////////////////////////////
+  //// MANIPULATION FUNCTIONS ////
+  ////////////////////////////////
+
+  // Index manipulation functions
+  void Build(const R3SurfelNodeSet& nodes);
+    // Builds bounding hierarchy over blocks of nodes (blocks should be read)
+  void Empty(void);
+    // Must be called whenever the nodes or their blocks change
+
+  // Camera manipulation functions
+  void SetCamera(const R3Point& eye, const R3Vector& towards, const R3Vector& up,
+    RNAngle xfov, RNAngle yfov, RNLength neardist = 0, RNLength fardist = FLT_MAX);
+    // Perspective camera with half-angle fields of view (as in R3Camera)
+  void SetViewport(const R2Box& viewport);
+    // Viewport in pixels, with y increasing upwards (as in R2Viewport)
+
+  // Filter manipulation functions
+  void SetPickTolerance(RNLength pixels);
+    // Surfels whose projection is within this many pixels of the cursor (in x and y) can be picked
+  void SetAerialVisibility(RNBoolean visibility);
+  void SetTerrestrialVisibility(RNBoolean visibility);
+  void SetBackfacingVisibility(RNBoolean visibility);
+  void SetViewingExtent(const R3Box& extent);
+    // Surfels outside extent are ignored (empty box means no limit)
+
+
+  /////////////////////////
+  //// QUERY FUNCTIONS ////
+  /////////////////////////
+
+  // Picking functions
+  R3SurfelNode *PickNode(const R2Point& cursor, R3Point *position = NULL,
+    R3SurfelBlock **block = NULL, const R3Surfel **surfel = NULL) const;
+    // Returns node with the surfel closest to the eye among the ones within pick tolerance of cursor
+
+  // Selection functions
+  int SelectNodes(const R2Box& rectangle,
+    RNArray<R3SurfelNode *> *nodes, R3SurfelPointSet *points = NULL) const;
+  int SelectNodes(const R2Polygon& lasso,
+    RNArray<R3SurfelNode *> *nodes, R3SurfelPointSet *points = NULL) const;
+    // Insert nodes (and points) with surfels projecting inside region (ignoring occlusion),
+    // and return the number of nodes found
+
+
+public:
+  ////////////////////////////////////////////////////////////////////////
+  // INTERNAL STUFF BELOW HERE
+  ////////////////////////////////////////////////////////////////////////
+
+  // Internal projection functions
+  RNBoolean ProjectPoint(const R3Point& point, R2Point *projection, RNLength *depth) const;
+  RNBoolean ProjectBox(const R3Box& box, R2Box *projection, RNLength *mindepth, RNLength *maxdepth) const;
+  RNBoolean IsSurfelVisible(const R3SurfelBlock *block, const R3Surfel *surfel, R3Point *position) const;
+
+  // Internal index functions
+  int BuildCell(int first_entry, int nentries);
+  void PickCell(int cell_index, const R2Point& cursor, RNLength *best_depth, RNLength *best_offset,
+    int *best_entry, const R3Surfel **best_surfel, R3Point *best_position) const;
+  void SelectCell(int cell_index, const R2Box& rectangle, const R2Polygon *lasso,
+    RNBoolean *node_marks, RNArray<R3SurfelNode *> *nodes, R3SurfelPointSet *points) const;
+
+public:
+  // Index data
+  RNArray<R3SurfelNode *> nodes;
+  R3SurfelPickerEntry *entries;
+  int nentries;
+  R3SurfelPickerCell *cells;
+  int ncells;
+
+  // Camera data
+  R3Point eye;
+  R3Vector towards;
+  R3Vector up;
+  R3Vector right;
+  RNScalar xfov_tangent;
+  RNScalar yfov_tangent;
+  RNLength neardist;
+  RNLength fardist;
+  R2Box viewport;
+
+  // Filter data
+  RNLength pick_tolerance;
+  RNBoolean aerial_visibility;
+  RNBoolean terrestrial_visibility;
+  RNBoolean backfacing_visibility;
+  R3Box viewing_extent;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// INLINE FUNCTION DEFINITIONS
+////////////////////////////////////////////////////////////////////////
+
+inline RNBoolean R3SurfelPicker::
+IsEmpty(void) const
+{
+  // Return whether index has been built
+  return (ncells == 0);
+}
+
+
+
+inline int R3SurfelPicker::
+NNodes(void) const
+{
+  // Return number of indexed nodes
+  return nodes.NEntries();
+}
+
+
+
+inline R3SurfelNode *R3SurfelPicker::
+Node(int k) const
+{
+  // Return kth indexed node
+  return nodes.Kth(k);
+}
+
+
+
+inline int R3SurfelPicker::
+NBlocks(void) const
+{
+  // Return number of indexed blocks
+  return nentries;
+}
+
+
+
+inline const R3Point& R3SurfelPicker::
+Eye(void) const
+{
+  // Return camera position
+  return eye;
+}
+
+
+
+inline const R3Vector& R3SurfelPicker::
+Towards(void) const
+{
+  // Return camera view direction
+  return towards;
+}
+
+
+
+inline const R3Vector& R3SurfelPicker::
+Up(void) const
+{
+  // Return camera up direction
+  return up;
+}
+
+
+
+inline const R3Vector& R3SurfelPicker::
+Right(void) const
+{
+  // Return camera right direction
+  return right;
+}
+
+
+
+inline const R2Box& R3SurfelPicker::
+Viewport(void) const
+{
+  // Return viewport
+  return viewport;
+}
+
+
+
+inline RNLength R3SurfelPicker::
+PickTolerance(void) const
+{
+  // Return pick tolerance (in pixels)
+  return pick_tolerance;
+}
+
+
+
+inline RNBoolean R3SurfelPicker::
+AerialVisibility(void) const
+{
+  // Return whether aerial surfels can be picked
+  return aerial_visibility;
+}
+
+
+
+inline RNBoolean R3SurfelPicker::
+TerrestrialVisibility(void) const
+{
+  // Return whether terrestrial surfels can be picked
+  return terrestrial_visibility;
+}
+
+
+
+inline RNBoolean R3SurfelPicker::
+BackfacingVisibility(void) const
+{
+  // Return whether backfacing surfels can be picked
+  return backfacing_visibility;
+}
+
+
+
+inline const R3Box& R3SurfelPicker::
+ViewingExtent(void) const
+{
+  // Return viewing extent
+  return viewing_extent;
+}
+
+
+
+inline void R3SurfelPicker::
+SetViewport(const R2Box& viewport)
+{
+  // Set viewport
+  this->viewport = viewport;
+}
+
+
+
+inline void R3SurfelPicker::
+SetPickTolerance(RNLength pixels)
+{
+  // Set pick tolerance
+  this->pick_tolerance = pixels;
+}
+
+
+
+inline void R3SurfelPicker::
+SetAerialVisibility(RNBoolean visibility)
+{
+  // Set whether aerial surfels can be picked
+  this->aerial_visibility = visibility;
+}
+
+
+
+inline void R3SurfelPicker::
+SetTerrestrialVisibility(RNBoolean visibility)
+{
+  // Set whether terrestrial surfels can be picked
+  this->terrestrial_visibility = visibility;
+}
+
+
+
+inline void R3SurfelPicker::
+SetBackfacingVisibility(RNBoolean visibility)
+{
+  // Set whether backfacing surfels can be picked
+  this->backfacing_visibility = visibility;
+}
+
+
+
+inline void R3SurfelPicker::
+SetViewingExtent(const R3Box& extent)
+{
+  // Set viewing extent
+  this->viewing_extent = extent;
+}
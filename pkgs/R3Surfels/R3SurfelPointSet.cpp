@@ -931,72 +931,58 @@ WriteXYZFile(const char *filename) const
 void R3SurfelPointSet::
 UpdateNormals(RNScalar max_neighborhood_radius, int max_neighborhood_points) const
 {
-  // Declare variables (fill it only if needed)
-  R3Kdtree<R3SurfelPoint *> *kdtree = NULL;
-  RNArray<R3SurfelPoint *> neighbors;
-  R3Point pointset_centroid = Centroid();
-  R3Point *positions = NULL;
+  // Select points that need a normal
+  int nmissing = 0;
+  RNBoolean *selected = new RNBoolean [ NPoints() ];
+  for (int i = 0; i < NPoints(); i++) {
+    selected[i] = (Point(i)->HasNormal()) ? FALSE : TRUE;
+    if (selected[i]) nmissing++;
+  }
+  if (nmissing == 0) { delete [] selected; return; }
 
-  // Compute normals for all points that don't already have them
+  // Fill arrays of positions and viewpoints
+  R3Point pointset_centroid = Centroid();
+  R3Point *positions = new R3Point [ NPoints() ];
+  R3Point *viewpoints = new R3Point [ NPoints() ];
+  if (!positions || !viewpoints) RNAbort("Unable to allocate positions to update normals");
   for (int i = 0; i < NPoints(); i++) {
     R3SurfelPoint *point = Point(i);
-    if (point->HasNormal()) continue;
-
-    // Allocate kdtree
-    if (!kdtree) {
-      RNArray<R3SurfelPoint *> points;
-      for (int j = 0; j < NPoints(); j++) points.Insert(Point(j));
-      if (!kdtree) kdtree = new R3Kdtree<R3SurfelPoint *>(points, SurfelPointPosition, NULL);
-      if (!kdtree) RNAbort("Unable to allocate kdtree to update normals");
-    }
-
-    // Find neighbors with kdtree
-    neighbors.Truncate(0);
-    kdtree->FindClosest(point, 0, max_neighborhood_radius, max_neighborhood_points, neighbors);
-    if (neighbors.NEntries() < 3) continue;
-
-    // Allocate array of positions
-    if (!positions) {
-      positions = new R3Point [max_neighborhood_points + 1];
-      if (!positions) RNAbort("Unable to allocate positions to update normals");
-    }
-
-    // Create array of positions for neighborhood
-    int npositions = 0;
-    positions[npositions++] = point->Position();
-    for (int j = 0; j < neighbors.NEntries(); j++) {
-      R3SurfelPoint *neighbor = neighbors.Kth(j);
-      positions[npositions++] = neighbor->Position();
-    }
-
-    // Compute normal with PCA of neighborhood
-    R3Point centroid = R3Centroid(npositions, positions);
-    R3Triad triad = R3PrincipleAxes(centroid, npositions, positions);
-    R3Vector normal = triad[2];
-
-    // Flip normal
+    positions[i] = point->Position();
     R3SurfelBlock *block = point->Block();
     R3SurfelNode *node = block->Node();
     R3SurfelScan *scan = (node) ? node->Scan() : NULL;
     if (scan) {
       // Orient normal towards scan viewpoint
-      R3Plane plane(centroid, normal);
-      const R3Point& viewpoint = scan->Viewpoint();
-      if (R3SignedDistance(plane, viewpoint) < 0) normal.Flip();
+      viewpoints[i] = scan->Viewpoint();
     }
     else {
       // Orient normal away from pointset centroid
-      R3Vector v = point->Position() - pointset_centroid;
-      if (v.Dot(normal) < 0) normal.Flip();
+      viewpoints[i] = positions[i] + (positions[i] - pointset_centroid);
     }
+  }
+
+  // Estimate normals of selected points with PCA of neighborhoods among all points (in parallel)
+  R3Vector *normals = new R3Vector [ NPoints() ];
+  if (!normals) RNAbort("Unable to allocate normals to update normals");
+  R3NormalEstimator estimator(NPoints(), positions);
+  estimator.SetMaxNeighbors(max_neighborhood_points + 1);
+  estimator.SetMaxDistance(max_neighborhood_radius);
+  estimator.SetViewpoints(viewpoints);
+  estimator.SetSelection(selected);
+  estimator.Compute(normals);
 
-    // Assign normal
-    point->SetNormal(normal);
+  // Assign normals to points that didn't have them
+  for (int i = 0; i < NPoints(); i++) {
+    if (!selected[i]) continue;
+    if (normals[i].IsZero()) continue;
+    Point(i)->SetNormal(normals[i]);
   }
 
   // Delete data
-  if (positions) delete [] positions;
-  if (kdtree) delete kdtree;
+  delete [] selected;
+  delete [] normals;
+  delete [] viewpoints;
+  delete [] positions;
 }
 
 
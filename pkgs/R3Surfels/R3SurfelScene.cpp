@@ -18,6 +18,14 @@
 
 
 
+////////////////////////////////////////////////////////////////////////
+// JOURNAL CONSTANTS
+////////////////////////////////////////////////////////////////////////
+
+#define R3_SURFEL_SCENE_DEFAULT_MAX_JOURNAL_SIZE    (64 * 1024 * 1024)
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // CONSTRUCTORS/DESTRUCTORS
 ////////////////////////////////////////////////////////////////////////
@@ -37,7 +45,15 @@ R3SurfelScene(const char *name)
     filename(NULL),
     rwaccess(NULL),
     name((name) ? strdup(name) : NULL),
-    flags(R3_SURFEL_SCENE_DIRTY_FLAG)
+    flags(R3_SURFEL_SCENE_DIRTY_FLAG | R3_SURFEL_SCENE_UNJOURNALED_FLAG),
+    journaling(FALSE),
+    max_journal_size(R3_SURFEL_SCENE_DEFAULT_MAX_JOURNAL_SIZE),
+    journal_size(0),
+    journal_buffer(NULL),
+    journal_buffer_size(0),
+    journal_buffer_allocated(0),
+    journal_nrecords(0),
+    journal_depth(0)
 {
   // Create tree
   tree = new R3SurfelTree();
@@ -85,6 +101,9 @@ R3SurfelScene::
 
   // Delete name
   if (name) free(name);
+
+  // Delete journal buffer
+  if (journal_buffer) free(journal_buffer);
 }
 
 
@@ -243,8 +262,8 @@ SetName(const char *name)
   // Set new name
   this->name = (name) ? strdup(name) : NULL;
 
-  // Mark scene as dirty
-  flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
+  // Mark scene as dirty (edit is not journaled)
+  SetDirty();
 }
 
 
@@ -261,6 +280,9 @@ InsertObject(R3SurfelObject *object, R3SurfelObject *parent)
   assert(object->scene == NULL);
   assert(object->scene_index == -1);
 
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Insert object into scene
   object->scene = this;
   object->scene_index = objects.NEntries();
@@ -273,6 +295,18 @@ InsertObject(R3SurfelObject *object, R3SurfelObject *parent)
   // Update object
   object->UpdateAfterInsert(this);
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("O+ %d %d ", (parent) ? parent->SceneIndex() : -1, object->Identifier());
+  InsertJournalName(object->Name());
+  InsertJournalRecord(" %d", object->NNodes());
+  for (int i = 0; i < object->NNodes(); i++) {
+    R3SurfelNode *node = object->Node(i);
+    if (node->TreeIndex() < 0) SetDirty();
+    InsertJournalRecord(" %d", node->TreeIndex());
+  }
+  InsertJournalRecord("\n");
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -289,6 +323,13 @@ MergeObject(R3SurfelObject *object1, R3SurfelObject *object2)
   assert(object2->scene == this);
   assert(object2->scene_index >= 0);
 
+  // Remember indices for journal
+  int journal_index1 = object1->scene_index;
+  int journal_index2 = object2->scene_index;
+
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Move all nodes from object2 into object1
   while (object2->NNodes() > 0) {
     R3SurfelNode *node = object2->Node(object2->NNodes()-1);
@@ -339,6 +380,10 @@ MergeObject(R3SurfelObject *object1, R3SurfelObject *object2)
   // Delete object2
   delete object2;
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("OM %d %d\n", journal_index1, journal_index2);
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -354,6 +399,12 @@ RemoveObject(R3SurfelObject *object)
   assert(object->scene_index >= 0);
   assert(objects.Kth(object->scene_index) == object);
 
+  // Remember index for journal
+  int journal_index = object->scene_index;
+
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Remove object propertys from scene
   while (object->NObjectProperties() > 0) {
     R3SurfelObjectProperty *property = object->ObjectProperty(object->NObjectProperties()-1);
@@ -399,6 +450,10 @@ RemoveObject(R3SurfelObject *object)
   object->scene_index = -1;
   object->scene = NULL;
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("O- %d\n", journal_index);
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -425,8 +480,8 @@ InsertLabel(R3SurfelLabel *label, R3SurfelLabel *parent)
   // Update label
   label->UpdateAfterInsert(this);
 
-  // Mark scene as dirty
-  flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
+  // Mark scene as dirty (edit is not journaled)
+  SetDirty();
 }
 
 
@@ -485,8 +540,8 @@ RemoveLabel(R3SurfelLabel *label)
   label->scene_index = -1;
   label->scene = NULL;
 
-  // Mark scene as dirty
-  flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
+  // Mark scene as dirty (edit is not journaled)
+  SetDirty();
 }
 
 
@@ -499,6 +554,9 @@ InsertObjectProperty(R3SurfelObjectProperty *property)
   assert(property->scene == NULL);
   assert(property->scene_index == -1);
 
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Insert property into scene
   property->scene = this;
   property->scene_index = object_properties.NEntries();
@@ -511,6 +569,12 @@ InsertObjectProperty(R3SurfelObjectProperty *property)
   // Update object property
   property->UpdateAfterInsert(this);
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("OP+ %d %d %d", property->Type(), property->Object()->SceneIndex(), property->NOperands());
+  for (int i = 0; i < property->NOperands(); i++) InsertJournalRecord(" %.17g", property->Operand(i));
+  InsertJournalRecord("\n");
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -526,6 +590,12 @@ RemoveObjectProperty(R3SurfelObjectProperty *property)
   assert(property->scene_index >= 0);
   assert(object_properties.Kth(property->scene_index) == property);
 
+  // Remember index for journal
+  int journal_index = property->scene_index;
+
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Update object property
   property->UpdateBeforeRemove(this);
 
@@ -542,6 +612,10 @@ RemoveObjectProperty(R3SurfelObjectProperty *property)
   property->scene_index = -1;
   property->scene = NULL;
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("OP- %d\n", journal_index);
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -556,6 +630,9 @@ InsertLabelProperty(R3SurfelLabelProperty *property)
   assert(property->scene == this);
   assert(property->scene_index == -1);
 
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Insert property into scene
   property->scene = this;
   property->scene_index = label_properties.NEntries();
@@ -568,6 +645,12 @@ InsertLabelProperty(R3SurfelLabelProperty *property)
   // Update label property
   property->UpdateAfterInsert(this);
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("LP+ %d %d %d", property->Type(), property->Label()->SceneIndex(), property->NOperands());
+  for (int i = 0; i < property->NOperands(); i++) InsertJournalRecord(" %.17g", property->Operand(i));
+  InsertJournalRecord("\n");
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -583,6 +666,12 @@ RemoveLabelProperty(R3SurfelLabelProperty *property)
   assert(property->scene_index >= 0);
   assert(label_properties.Kth(property->scene_index) == property);
 
+  // Remember index for journal
+  int journal_index = property->scene_index;
+
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Update label property
   property->UpdateAfterInsert(this);
 
@@ -599,6 +688,10 @@ RemoveLabelProperty(R3SurfelLabelProperty *property)
   property->scene_index = -1;
   property->scene = NULL;
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("LP- %d\n", journal_index);
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -613,6 +706,9 @@ InsertObjectRelationship(R3SurfelObjectRelationship *relationship)
   assert(relationship->scene == NULL);
   assert(relationship->scene_index == -1);
 
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Insert relationship into scene
   relationship->scene = this;
   relationship->scene_index = object_relationships.NEntries();
@@ -627,12 +723,34 @@ InsertObjectRelationship(R3SurfelObjectRelationship *relationship)
   // Update object relationship
   relationship->UpdateAfterInsert(this);
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("OR+ %d %d", relationship->Type(), relationship->NObjects());
+  for (int i = 0; i < relationship->NObjects(); i++) InsertJournalRecord(" %d", relationship->Object(i)->SceneIndex());
+  InsertJournalRecord(" %d", relationship->NOperands());
+  for (int i = 0; i < relationship->NOperands(); i++) InsertJournalRecord(" %.17g", relationship->Operand(i));
+  InsertJournalRecord("\n");
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
 
 
 
+void R3SurfelScene::
+InsertObjectRelationships(const RNArray<R3SurfelObjectRelationship *>& relationships)
+{
+  // Allocate space for all relationships at once
+  object_relationships.Resize(object_relationships.NEntries() + relationships.NEntries());
+
+  // Insert relationships in order
+  for (int i = 0; i < relationships.NEntries(); i++) {
+    InsertObjectRelationship(relationships.Kth(i));
+  }
+}
+
+
+
 void R3SurfelScene::
 RemoveObjectRelationship(R3SurfelObjectRelationship *relationship)
 {
@@ -642,6 +760,12 @@ RemoveObjectRelationship(R3SurfelObjectRelationship *relationship)
   assert(relationship->scene_index >= 0);
   assert(object_relationships.Kth(relationship->scene_index) == relationship);
 
+  // Remember index for journal
+  int journal_index = relationship->scene_index;
+
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Update object relationship
   relationship->UpdateBeforeRemove(this);
 
@@ -660,6 +784,10 @@ RemoveObjectRelationship(R3SurfelObjectRelationship *relationship)
   relationship->scene_index = -1;
   relationship->scene = NULL;
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("OR- %d\n", journal_index);
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -674,6 +802,9 @@ InsertLabelRelationship(R3SurfelLabelRelationship *relationship)
   assert(relationship->scene == this);
   assert(relationship->scene_index == -1);
 
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Insert relationship into scene
   relationship->scene = this;
   relationship->scene_index = label_relationships.NEntries();
@@ -688,6 +819,14 @@ InsertLabelRelationship(R3SurfelLabelRelationship *relationship)
   // Update label relationship
   relationship->UpdateAfterInsert(this);
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("LR+ %d %d", relationship->Type(), relationship->NLabels());
+  for (int i = 0; i < relationship->NLabels(); i++) InsertJournalRecord(" %d", relationship->Label(i)->SceneIndex());
+  InsertJournalRecord(" %d", relationship->NOperands());
+  for (int i = 0; i < relationship->NOperands(); i++) InsertJournalRecord(" %.17g", relationship->Operand(i));
+  InsertJournalRecord("\n");
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -703,6 +842,12 @@ RemoveLabelRelationship(R3SurfelLabelRelationship *relationship)
   assert(relationship->scene_index >= 0);
   assert(label_relationships.Kth(relationship->scene_index) == relationship);
 
+  // Remember index for journal
+  int journal_index = relationship->scene_index;
+
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Update label relationship
   relationship->UpdateAfterInsert(this);
 
@@ -721,6 +866,10 @@ RemoveLabelRelationship(R3SurfelLabelRelationship *relationship)
   relationship->scene_index = -1;
   relationship->scene = NULL;
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("LR- %d\n", journal_index);
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -739,6 +888,9 @@ InsertLabelAssignment(R3SurfelLabelAssignment *assignment)
   assert(assignment->Label());
   assert(assignment->Label()->Scene() == this);
 
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Insert assignment into scene
   assignment->scene = this;
   assignment->scene_index = assignments.NEntries();
@@ -751,6 +903,11 @@ InsertLabelAssignment(R3SurfelLabelAssignment *assignment)
   // Update assignment
   assignment->UpdateAfterInsert(this);
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("A+ %d %d %.17g %d\n", assignment->Object()->SceneIndex(), 
+    assignment->Label()->SceneIndex(), assignment->Confidence(), assignment->Originator());
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -769,6 +926,12 @@ RemoveLabelAssignment(R3SurfelLabelAssignment *assignment)
   assert(assignment->Label());
   assert(assignment->Label()->Scene() == this);
 
+  // Remember index for journal
+  int journal_index = assignment->scene_index;
+
+  // Suppress journal records of nested edits
+  BeginJournalEdit();
+
   // Update assignment
   assignment->UpdateBeforeRemove(this);
 
@@ -786,6 +949,10 @@ RemoveLabelAssignment(R3SurfelLabelAssignment *assignment)
   assignment->scene_index = -1;
   assignment->scene = NULL;
 
+  // Append journal record
+  EndJournalEdit();
+  InsertJournalRecord("A- %d\n", journal_index);
+
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
 }
@@ -803,8 +970,8 @@ InsertScan(R3SurfelScan *scan)
   scan->scene_index = scans.NEntries();
   scans.Insert(scan);
 
-  // Mark scene as dirty
-  flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
+  // Mark scene as dirty (edit is not journaled)
+  SetDirty();
 }
 
 
@@ -824,8 +991,8 @@ RemoveScan(R3SurfelScan *scan)
   scan->scene_index = -1;
   scan->scene = NULL;
 
-  // Mark scene as dirty
-  flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
+  // Mark scene as dirty (edit is not journaled)
+  SetDirty();
 }
 
 
@@ -850,8 +1017,8 @@ InsertFeature(R3SurfelFeature *feature)
     }
   }
 
-  // Mark scene as dirty
-  flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
+  // Mark scene as dirty (edit is not journaled)
+  SetDirty();
 }
 
 
@@ -884,8 +1051,8 @@ RemoveFeature(R3SurfelFeature *feature)
     }
   }
 
-  // Mark scene as dirty
-  flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
+  // Mark scene as dirty (edit is not journaled)
+  SetDirty();
 }
 
 
@@ -1249,9 +1416,24 @@ SyncFile(const char *output_scene_filename)
     }
   }
   else if (this->filename && (strcmp(this->rwaccess, "r"))) {
-    // Write scene over original file
-    if (!WriteFile(filename)) {
-      return 0;
+    if (journaling && !flags[R3_SURFEL_SCENE_UNJOURNALED_FLAG] &&
+        (journal_size + journal_buffer_size < max_journal_size)) {
+      // Append edits to journal of original file
+      if (!AppendJournalFile(filename)) {
+        return 0;
+      }
+    }
+    else if (journaling || (journal_size > 0)) {
+      // Fold journal and edits into original file
+      if (!CompactFile()) {
+        return 0;
+      }
+    }
+    else {
+      // Write scene over original file
+      if (!WriteFile(filename)) {
+        return 0;
+      }
     }
   }
 
@@ -1261,6 +1443,70 @@ SyncFile(const char *output_scene_filename)
 
 
 
+int R3SurfelScene::
+CompactFile(void)
+{
+  // Check filename
+  if (!filename) {
+    fprintf(stderr, "Unable to compact scene without filename\n");
+    return 0;
+  }
+
+  // Sync surfels
+  if (tree) {
+    R3SurfelDatabase *database = tree->Database();
+    if (database && database->IsOpen()) {
+      if (!database->SyncFile()) return 0;
+    }
+  }
+
+  // Write scene to temporary file with same extension
+  const char *extension = strrchr(filename, '.');
+  if (!extension) {
+    fprintf(stderr, "Filename %s has no extension (e.g., .ssa)\n", filename);
+    return 0;
+  }
+  char tmp_filename[4096];
+  sprintf(tmp_filename, "%s.tmp%s", filename, extension);
+  if (!WriteFile(tmp_filename)) {
+    return 0;
+  }
+
+  // Make sure temporary file is on disk before it replaces original
+  FILE *fp = fopen(tmp_filename, "rb+");
+  if (!fp || !RNFileSync(fp)) {
+    fprintf(stderr, "Unable to sync file %s\n", tmp_filename);
+    if (fp) fclose(fp);
+    return 0;
+  }
+  fclose(fp);
+
+  // Replace original file (journal is stale from here on, since it records the old file's signature)
+  if (!RNFileReplace(tmp_filename, filename)) {
+    fprintf(stderr, "Unable to replace %s with %s\n", filename, tmp_filename);
+    return 0;
+  }
+
+  // Remove journal
+  char journal_filename[4096];
+  sprintf(journal_filename, "%s.jnl", filename);
+  if (RNFileExists(journal_filename)) remove(journal_filename);
+
+  // Reset journal
+  journal_size = 0;
+  journal_buffer_size = 0;
+  journal_nrecords = 0;
+
+  // Mark scene as clean
+  flags.Remove(R3_SURFEL_SCENE_DIRTY_FLAG);
+  flags.Remove(R3_SURFEL_SCENE_UNJOURNALED_FLAG);
+
+  // Return success
+  return 1;
+}
+
+
+
 int R3SurfelScene::
 CloseFile(const char *output_scene_filename)
 {
@@ -1291,20 +1537,34 @@ ReadFile(const char *filename)
     return 0;
   }
 
-  // Read file of appropriate type
+  // Read file of appropriate type (edits made while reading are not journaled)
+  int status = 0;
+  BeginJournalEdit();
   if (!strncmp(extension, ".ssa", 4)) {
-    return ReadAsciiFile(filename);
+    status = ReadAsciiFile(filename);
   }
   else if (!strncmp(extension, ".ssx", 4)) {
-    return ReadBinaryFile(filename);
+    status = ReadBinaryFile(filename);
   }
   else { 
     fprintf(stderr, "Unable to read file %s (unrecognized extension: %s)\n", filename, extension); 
-    return 0; 
   }
+  EndJournalEdit();
+  if (!status) return 0;
 
-  // Should never get here
-  return 0;
+  // Scene now matches file
+  flags.Remove(R3_SURFEL_SCENE_UNJOURNALED_FLAG);
+  journal_size = 0;
+
+  // Replay edits journaled since file was written
+  char journal_filename[4096];
+  sprintf(journal_filename, "%s.jnl", filename);
+  if (RNFileExists(journal_filename)) {
+    if (!ReadJournalFile(filename)) return 0;
+  }
+
+  // Return success
+  return 1;
 }
 
 
@@ -1343,6 +1603,518 @@ WriteFile(const char *filename)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// JOURNAL I/O FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+// The journal (<filename>.jnl) starts with a header line holding the size
+// and hash of the scene file it applies to, followed by batches of edit
+// records, each terminated by a commit line with its record count and
+// checksum.  Only completely written batches are replayed, so a crash
+// during a save loses at most the edits of that save.
+
+static void
+AppendJournalBuffer(char **buffer, int *size, int *allocated, const char *data, int length)
+{
+  // Grow buffer
+  if (*size + length + 1 > *allocated) {
+    int new_allocated = (*allocated > 0) ? 2 * (*allocated) : 4096;
+    while (*size + length + 1 > new_allocated) new_allocated *= 2;
+    *buffer = (char *) realloc(*buffer, new_allocated);
+    *allocated = new_allocated;
+  }
+
+  // Append data
+  memcpy(*buffer + *size, data, length);
+  *size += length;
+  (*buffer)[*size] = '\0';
+}
+
+
+
+static unsigned int
+JournalChecksum(const char *buffer, int size, unsigned int hash = 2166136261U)
+{
+  // Compute FNV-1a hash
+  for (int i = 0; i < size; i++) {
+    hash ^= (unsigned char) buffer[i];
+    hash *= 16777619U;
+  }
+
+  // Return hash
+  return hash;
+}
+
+
+
+static int
+ComputeJournalSignature(const char *filename, unsigned long long *size, unsigned int *hash)
+{
+  // Open file
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    fprintf(stderr, "Unable to open file %s\n", filename);
+    return 0;
+  }
+
+  // Hash contents
+  char buffer[65536];
+  *size = 0;
+  *hash = JournalChecksum(NULL, 0);
+  while (TRUE) {
+    int count = fread(buffer, sizeof(char), sizeof(buffer), fp);
+    if (count <= 0) break;
+    *hash = JournalChecksum(buffer, count, *hash);
+    *size += count;
+  }
+
+  // Close file
+  fclose(fp);
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+ReadJournalLine(FILE *fp, char **line, int *allocated)
+{
+  // Read characters up to and including newline
+  int size = 0;
+  char buffer[4096];
+  while (fgets(buffer, sizeof(buffer), fp)) {
+    int length = strlen(buffer);
+    AppendJournalBuffer(line, &size, allocated, buffer, length);
+    if (buffer[length-1] == '\n') break;
+  }
+
+  // Return number of characters read
+  return size;
+}
+
+
+
+static int
+ParseJournalIntegers(const char **bufferp, int *values, int count)
+{
+  // Parse integers
+  for (int i = 0; i < count; i++) {
+    char *endp = NULL;
+    values[i] = (int) strtol(*bufferp, &endp, 10);
+    if (endp == *bufferp) return 0;
+    *bufferp = endp;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+static int
+ParseJournalScalars(const char **bufferp, RNScalar *values, int count)
+{
+  // Parse scalars
+  for (int i = 0; i < count; i++) {
+    char *endp = NULL;
+    values[i] = strtod(*bufferp, &endp);
+    if (endp == *bufferp) return 0;
+    *bufferp = endp;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+void R3SurfelScene::
+InsertJournalRecord(const char *format, ...)
+{
+  // Ignore edits nested in journaled edits (or made while reading)
+  if (journal_depth > 0) return;
+
+  // Mark scene as dirty
+  flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
+
+  // Check if journaling (otherwise next sync must rewrite the file)
+  if (!journaling) {
+    flags.Add(R3_SURFEL_SCENE_UNJOURNALED_FLAG);
+    return;
+  }
+
+  // Format record
+  char record[1024];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(record, sizeof(record), format, args);
+  va_end(args);
+
+  // Append record to buffer of edits since last sync
+  int length = strlen(record);
+  AppendJournalBuffer(&journal_buffer, &journal_buffer_size, &journal_buffer_allocated, record, length);
+  if ((length > 0) && (record[length-1] == '\n')) journal_nrecords++;
+}
+
+
+
+void R3SurfelScene::
+InsertJournalName(const char *name)
+{
+  // Copy name (replacing whitespace with '+', as in ascii files)
+  char buffer[1024];
+  strncpy(buffer, (name) ? name : "None", 1023);
+  buffer[1023] = '\0';
+  for (char *bufferp = buffer; *bufferp; bufferp++) {
+    if (isspace(*bufferp)) *bufferp = '+';
+  }
+
+  // Insert name into record
+  InsertJournalRecord("%s", buffer);
+}
+
+
+
+int R3SurfelScene::
+ReplayJournalRecord(const char *record)
+{
+  // Parse record type
+  char type[16];
+  int n = 0;
+  if (sscanf(record, "%15s%n", type, &n) != 1) return 0;
+  const char *bufferp = record + n;
+
+  // Replay edit
+  if (!strcmp(type, "A+")) {
+    int indices[2], originator;
+    RNScalar confidence;
+    if (!ParseJournalIntegers(&bufferp, indices, 2)) return 0;
+    if (!ParseJournalScalars(&bufferp, &confidence, 1)) return 0;
+    if (!ParseJournalIntegers(&bufferp, &originator, 1)) return 0;
+    if ((indices[0] < 0) || (indices[0] >= NObjects())) return 0;
+    if ((indices[1] < 0) || (indices[1] >= NLabels())) return 0;
+    R3SurfelObject *object = Object(indices[0]);
+    R3SurfelLabel *label = Label(indices[1]);
+    InsertLabelAssignment(new R3SurfelLabelAssignment(object, label, confidence, originator));
+  }
+  else if (!strcmp(type, "A-")) {
+    int index;
+    if (!ParseJournalIntegers(&bufferp, &index, 1)) return 0;
+    if ((index < 0) || (index >= NLabelAssignments())) return 0;
+    R3SurfelLabelAssignment *assignment = LabelAssignment(index);
+    RemoveLabelAssignment(assignment);
+    delete assignment;
+  }
+  else if (!strcmp(type, "O+")) {
+    int values[2], nnodes;
+    char object_name[1024];
+    if (!ParseJournalIntegers(&bufferp, values, 2)) return 0;
+    if (sscanf(bufferp, "%1023s%n", object_name, &n) != 1) return 0;
+    bufferp += n;
+    if (!ParseJournalIntegers(&bufferp, &nnodes, 1)) return 0;
+    if ((values[0] < -1) || (values[0] >= NObjects())) return 0;
+    for (char *namep = object_name; *namep; namep++) if (*namep == '+') *namep = ' ';
+    R3SurfelObject *object = new R3SurfelObject((strcmp(object_name, "None")) ? object_name : NULL);
+    object->SetIdentifier(values[1]);
+    for (int i = 0; i < nnodes; i++) {
+      int node_index;
+      if (!ParseJournalIntegers(&bufferp, &node_index, 1) ||
+          (node_index < 0) || (node_index >= tree->NNodes()) ||
+          (tree->Node(node_index)->Object())) {
+        delete object;
+        return 0;
+      }
+      object->InsertNode(tree->Node(node_index));
+    }
+    InsertObject(object, (values[0] >= 0) ? Object(values[0]) : NULL);
+  }
+  else if (!strcmp(type, "O-")) {
+    int index;
+    if (!ParseJournalIntegers(&bufferp, &index, 1)) return 0;
+    if ((index <= 0) || (index >= NObjects())) return 0;
+    R3SurfelObject *object = Object(index);
+    RemoveObject(object);
+    delete object;
+  }
+  else if (!strcmp(type, "OM")) {
+    int indices[2];
+    if (!ParseJournalIntegers(&bufferp, indices, 2)) return 0;
+    if ((indices[0] < 0) || (indices[0] >= NObjects())) return 0;
+    if ((indices[1] <= 0) || (indices[1] >= NObjects())) return 0;
+    if (indices[0] == indices[1]) return 0;
+    MergeObject(Object(indices[0]), Object(indices[1]));
+  }
+  else if (!strcmp(type, "ON+") || !strcmp(type, "ON-")) {
+    int indices[2];
+    if (!ParseJournalIntegers(&bufferp, indices, 2)) return 0;
+    if ((indices[0] < 0) || (indices[0] >= NObjects())) return 0;
+    if ((indices[1] < 0) || (indices[1] >= tree->NNodes())) return 0;
+    R3SurfelObject *object = Object(indices[0]);
+    R3SurfelNode *node = tree->Node(indices[1]);
+    if (type[2] == '+') {
+      if (node->Object()) return 0;
+      object->InsertNode(node);
+    }
+    else {
+      if (node->Object() != object) return 0;
+      object->RemoveNode(node);
+    }
+  }
+  else if (!strcmp(type, "OP+") || !strcmp(type, "LP+")) {
+    int values[3];
+    if (!ParseJournalIntegers(&bufferp, values, 3)) return 0;
+    if ((values[2] < 0) || (values[2] > 1024*1024)) return 0;
+    RNScalar *operands = new RNScalar [ values[2] + 1 ];
+    if (!ParseJournalScalars(&bufferp, operands, values[2])) { delete [] operands; return 0; }
+    if (type[0] == 'O') {
+      if ((values[1] < 0) || (values[1] >= NObjects())) { delete [] operands; return 0; }
+      InsertObjectProperty(new R3SurfelObjectProperty(values[0], Object(values[1]), operands, values[2]));
+    }
+    else {
+      if ((values[1] < 0) || (values[1] >= NLabels())) { delete [] operands; return 0; }
+      InsertLabelProperty(new R3SurfelLabelProperty(values[0], Label(values[1]), operands, values[2]));
+    }
+    delete [] operands;
+  }
+  else if (!strcmp(type, "OR+") || !strcmp(type, "LR+")) {
+    int values[2], noperands;
+    if (!ParseJournalIntegers(&bufferp, values, 2)) return 0;
+    if ((values[1] < 0) || (values[1] > 1024*1024)) return 0;
+    int *indices = new int [ values[1] + 1 ];
+    RNBoolean ok = ParseJournalIntegers(&bufferp, indices, values[1]);
+    ok = ok && ParseJournalIntegers(&bufferp, &noperands, 1) && (noperands >= 0) && (noperands <= 1024*1024);
+    RNScalar *operands = (ok) ? new RNScalar [ noperands + 1 ] : NULL;
+    ok = ok && ParseJournalScalars(&bufferp, operands, noperands);
+    if (ok && (type[0] == 'O')) {
+      RNArray<R3SurfelObject *> objs;
+      for (int i = 0; ok && (i < values[1]); i++) {
+        if ((indices[i] < 0) || (indices[i] >= NObjects())) ok = FALSE;
+        else objs.Insert(Object(indices[i]));
+      }
+      if (ok) InsertObjectRelationship(new R3SurfelObjectRelationship(values[0], objs, operands, noperands));
+    }
+    else if (ok) {
+      RNArray<R3SurfelLabel *> labs;
+      for (int i = 0; ok && (i < values[1]); i++) {
+        if ((indices[i] < 0) || (indices[i] >= NLabels())) ok = FALSE;
+        else labs.Insert(Label(indices[i]));
+      }
+      if (ok) InsertLabelRelationship(new R3SurfelLabelRelationship(values[0], labs, operands, noperands));
+    }
+    if (operands) delete [] operands;
+    delete [] indices;
+    if (!ok) return 0;
+  }
+  else if (!strcmp(type, "OP-")) {
+    int index;
+    if (!ParseJournalIntegers(&bufferp, &index, 1)) return 0;
+    if ((index < 0) || (index >= NObjectProperties())) return 0;
+    R3SurfelObjectProperty *property = ObjectProperty(index);
+    RemoveObjectProperty(property);
+    delete property;
+  }
+  else if (!strcmp(type, "LP-")) {
+    int index;
+    if (!ParseJournalIntegers(&bufferp, &index, 1)) return 0;
+    if ((index < 0) || (index >= NLabelProperties())) return 0;
+    R3SurfelLabelProperty *property = LabelProperty(index);
+    RemoveLabelProperty(property);
+    delete property;
+  }
+  else if (!strcmp(type, "OR-")) {
+    int index;
+    if (!ParseJournalIntegers(&bufferp, &index, 1)) return 0;
+    if ((index < 0) || (index >= NObjectRelationships())) return 0;
+    R3SurfelObjectRelationship *relationship = ObjectRelationship(index);
+    RemoveObjectRelationship(relationship);
+    delete relationship;
+  }
+  else if (!strcmp(type, "LR-")) {
+    int index;
+    if (!ParseJournalIntegers(&bufferp, &index, 1)) return 0;
+    if ((index < 0) || (index >= NLabelRelationships())) return 0;
+    R3SurfelLabelRelationship *relationship = LabelRelationship(index);
+    RemoveLabelRelationship(relationship);
+    delete relationship;
+  }
+  else {
+    // Unrecognized record
+    return 0;
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3SurfelScene::
+ReadJournalFile(const char *filename)
+{
+  // Open journal file
+  char journal_filename[4096];
+  sprintf(journal_filename, "%s.jnl", filename);
+  FILE *fp = fopen(journal_filename, "rb");
+  if (!fp) {
+    fprintf(stderr, "Unable to open journal file %s\n", journal_filename);
+    return 0;
+  }
+
+  // Check that journal was started for this version of the scene file
+  char *line = NULL;
+  int line_allocated = 0;
+  unsigned long long journal_base_size = 0, base_size = 0;
+  unsigned int journal_base_hash = 0, base_hash = 0;
+  if (!ReadJournalLine(fp, &line, &line_allocated) ||
+      (sscanf(line, "SSJ 1.0 %llu %u", &journal_base_size, &journal_base_hash) != 2) ||
+      !ComputeJournalSignature(filename, &base_size, &base_hash) ||
+      (journal_base_size != base_size) || (journal_base_hash != base_hash)) {
+    fprintf(stderr, "Ignoring journal file %s, which was not written for %s\n", journal_filename, filename);
+    if (line) free(line);
+    fclose(fp);
+    return 1;
+  }
+
+  // Replay batches of records that were completely written
+  char *batch = NULL;
+  int batch_size = 0, batch_allocated = 0, batch_nrecords = 0;
+  long committed_size = (long) RNFileTell(fp);
+  RNBoolean incomplete = FALSE;
+  int length;
+  while ((length = ReadJournalLine(fp, &line, &line_allocated)) > 0) {
+    // Check for partially written line
+    if (line[length-1] != '\n') { incomplete = TRUE; break; }
+
+    // Check for commit record
+    if (!strncmp(line, "C ", 2)) {
+      // Check batch
+      int nrecords;
+      unsigned int checksum;
+      if ((sscanf(line, "C %d %u", &nrecords, &checksum) != 2) || (nrecords != batch_nrecords) ||
+          (checksum != JournalChecksum(batch, batch_size))) {
+        incomplete = TRUE;
+        break;
+      }
+
+      // Replay records in batch
+      char *recordp = batch;
+      BeginJournalEdit();
+      for (int i = 0; i < nrecords; i++) {
+        char *endp = strchr(recordp, '\n');
+        *endp = '\0';
+        if (!ReplayJournalRecord(recordp)) {
+          fprintf(stderr, "Unable to replay record \"%s\" in %s\n", recordp, journal_filename);
+          EndJournalEdit();
+          free(batch);
+          free(line);
+          fclose(fp);
+          return 0;
+        }
+        recordp = endp + 1;
+      }
+      EndJournalEdit();
+
+      // Start next batch
+      committed_size = (long) RNFileTell(fp);
+      batch_size = 0;
+      batch_nrecords = 0;
+    }
+    else {
+      // Add record to batch
+      AppendJournalBuffer(&batch, &batch_size, &batch_allocated, line, length);
+      batch_nrecords++;
+    }
+  }
+
+  // Close journal file
+  if (batch) free(batch);
+  if (line) free(line);
+  fclose(fp);
+
+  // Remember size of consistent part of journal
+  journal_size = committed_size;
+
+  // Check for edits lost by interrupted save
+  if (incomplete || (batch_size > 0)) {
+    // Make next sync rewrite the scene file (rather than appending after the partial batch)
+    fprintf(stderr, "Ignoring incomplete edits at end of journal file %s\n", journal_filename);
+    flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
+    flags.Add(R3_SURFEL_SCENE_UNJOURNALED_FLAG);
+  }
+  else {
+    // Mark scene as clean
+    flags.Remove(R3_SURFEL_SCENE_DIRTY_FLAG);
+  }
+
+  // Return success
+  return 1;
+}
+
+
+
+int R3SurfelScene::
+AppendJournalFile(const char *filename)
+{
+  // Check if there are edits to append
+  if (journal_buffer_size == 0) {
+    flags.Remove(R3_SURFEL_SCENE_DIRTY_FLAG);
+    return 1;
+  }
+
+  // Open journal file
+  FILE *fp = NULL;
+  char journal_filename[4096];
+  sprintf(journal_filename, "%s.jnl", filename);
+  if (journal_size == 0) {
+    // Start new journal with signature of scene file
+    unsigned long long base_size;
+    unsigned int base_hash;
+    if (!ComputeJournalSignature(filename, &base_size, &base_hash)) return 0;
+    if (!(fp = fopen(journal_filename, "wb"))) {
+      fprintf(stderr, "Unable to open journal file %s\n", journal_filename);
+      return 0;
+    }
+    fprintf(fp, "SSJ 1.0 %llu %u\n", base_size, base_hash);
+  }
+  else {
+    // Append to existing journal
+    if (!(fp = fopen(journal_filename, "ab"))) {
+      fprintf(stderr, "Unable to open journal file %s\n", journal_filename);
+      return 0;
+    }
+  }
+
+  // Write records and commit record, and wait for them to reach the disk
+  unsigned int checksum = JournalChecksum(journal_buffer, journal_buffer_size);
+  if ((fwrite(journal_buffer, sizeof(char), journal_buffer_size, fp) != (unsigned int) journal_buffer_size) ||
+      (fprintf(fp, "C %d %u\n", journal_nrecords, checksum) < 0) || !RNFileSync(fp)) {
+    // Make next sync rewrite the scene file (rather than appending after a partial batch)
+    fprintf(stderr, "Unable to write journal file %s\n", journal_filename);
+    flags.Add(R3_SURFEL_SCENE_UNJOURNALED_FLAG);
+    fclose(fp);
+    return 0;
+  }
+
+  // Remember size of journal
+  journal_size = (long) RNFileTell(fp);
+
+  // Close journal file
+  fclose(fp);
+
+  // Empty buffer of edits
+  journal_buffer_size = 0;
+  journal_nrecords = 0;
+
+  // Mark scene as clean
+  flags.Remove(R3_SURFEL_SCENE_DIRTY_FLAG);
+
+  // Return success
+  return 1;
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Ascii I/O FUNCTIONS
 ////////////////////////////////////////////////////////////////////////
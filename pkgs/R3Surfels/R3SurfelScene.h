@@ -117,6 +117,7 @@ public:
 
   // Object relationship manipulation functions
   virtual void InsertObjectRelationship(R3SurfelObjectRelationship *relationship);
+  virtual void InsertObjectRelationships(const RNArray<R3SurfelObjectRelationship *>& relationships);
   virtual void RemoveObjectRelationship(R3SurfelObjectRelationship *relationship);
 
   // Label relationship manipulation functions
@@ -164,12 +165,23 @@ public:
   virtual int CloseFile(const char *output_scene_filename = NULL);
   void SetDirty(void);
 
+  // Journal functions
+  RNBoolean IsJournaling(void) const;
+  void SetJournaling(RNBoolean journaling);
+    // When journaling, SyncFile appends edits to <filename>.jnl rather than rewriting the scene file
+    // (edits that cannot be journaled, e.g. to the node tree, make the next sync compact the file)
+  void SetMaxJournalSize(long nbytes);
+    // SyncFile compacts the journal into the scene file when it would grow beyond this size
+  int CompactFile(void);
+    // Safely rewrites the scene file with all edits and removes the journal
+
   ////////////////////////////////////////////////////////////////////////
   // INTERNAL STUFF BELOW HERE
   ////////////////////////////////////////////////////////////////////////
 
   // Flag constants
-# define R3_SURFEL_SCENE_DIRTY_FLAG   0x01
+# define R3_SURFEL_SCENE_DIRTY_FLAG        0x01
+# define R3_SURFEL_SCENE_UNJOURNALED_FLAG  0x02
  
 public:
   // File I/O functions
@@ -182,6 +194,15 @@ public:
   virtual int WriteARFFFile(const char *filename);
   virtual int WriteTianqiangFile(const char *filename);
 
+  // Journal I/O functions
+  virtual int ReadJournalFile(const char *filename);
+  virtual int AppendJournalFile(const char *filename);
+  int ReplayJournalRecord(const char *record);
+  void InsertJournalRecord(const char *format, ...);
+  void InsertJournalName(const char *name);
+  void BeginJournalEdit(void);
+  void EndJournalEdit(void);
+
 protected:
   // Structure access stuff
   R3SurfelTree *tree;
@@ -200,6 +221,16 @@ protected:
   char *rwaccess;
   char *name;
   RNFlags flags;
+
+  // Journal stuff
+  RNBoolean journaling;
+  long max_journal_size;
+  long journal_size;
+  char *journal_buffer;
+  int journal_buffer_size;
+  int journal_buffer_allocated;
+  int journal_nrecords;
+  int journal_depth;
 };
 
 
@@ -429,6 +460,54 @@ SetDirty(void)
 {
   // Mark scene as dirty
   flags.Add(R3_SURFEL_SCENE_DIRTY_FLAG);
+
+  // Remember that change was not journaled (unless part of a journaled edit)
+  if (journal_depth == 0) flags.Add(R3_SURFEL_SCENE_UNJOURNALED_FLAG);
+}
+
+
+
+inline RNBoolean R3SurfelScene::
+IsJournaling(void) const
+{
+  // Return whether saves are journaled
+  return journaling;
+}
+
+
+
+inline void R3SurfelScene::
+SetJournaling(RNBoolean journaling)
+{
+  // Set whether saves are journaled
+  this->journaling = journaling;
+}
+
+
+
+inline void R3SurfelScene::
+SetMaxJournalSize(long nbytes)
+{
+  // Set journal size that triggers compaction
+  this->max_journal_size = nbytes;
+}
+
+
+
+inline void R3SurfelScene::
+BeginJournalEdit(void)
+{
+  // Suppress journal records of nested edits
+  journal_depth++;
+}
+
+
+
+inline void R3SurfelScene::
+EndJournalEdit(void)
+{
+  // Resume journal records
+  journal_depth--;
 }
 
 
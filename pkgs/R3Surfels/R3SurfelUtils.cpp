@@ -1277,6 +1277,108 @@ CreateGrid(R3SurfelScene *scene,
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Mesh creation functions
+////////////////////////////////////////////////////////////////////////
+
+static R3Mesh *
+ReconstructPoissonMesh(R3PoissonReconstruction *poisson, RNScalar trim_depth, int nthreads)
+{
+  // Solve for implicit function
+  poisson->SetTrimDepth(trim_depth);
+  poisson->SetNThreads(nthreads);
+  if (!poisson->Solve()) return NULL;
+
+  // Create mesh
+  R3Mesh *mesh = new R3Mesh();
+  if (!mesh) {
+    fprintf(stderr, "Unable to allocate mesh\n");
+    return NULL;
+  }
+
+  // Extract iso surface
+  if (poisson->ExtractSurface(mesh) < 0) {
+    delete mesh;
+    return NULL;
+  }
+
+  // Return mesh
+  return mesh;
+}
+
+
+
+R3Mesh *
+CreatePoissonMesh(R3SurfelPointSet *pointset,
+  int max_depth, RNScalar trim_depth, int nthreads)
+{
+  // Check pointset
+  if (!pointset) return NULL;
+  if (pointset->NPoints() == 0) return NULL;
+
+  // Insert points with normals
+  R3PoissonReconstruction poisson(pointset->BBox(), max_depth);
+  for (int i = 0; i < pointset->NPoints(); i++) {
+    const R3SurfelPoint *point = pointset->Point(i);
+    if (!point->HasNormal()) continue;
+    poisson.InsertPoint(point->Position(), point->Normal());
+  }
+
+  // Reconstruct mesh
+  return ReconstructPoissonMesh(&poisson, trim_depth, nthreads);
+}
+
+
+
+R3Mesh *
+CreatePoissonMesh(R3SurfelScene *scene, const R3Box& bbox,
+  int max_depth, RNScalar trim_depth, int nthreads)
+{
+  // Insert surfels with normals (reading one block at a time, so memory
+  // grows with the number of octree leaves rather than of surfels)
+  R3PoissonReconstruction poisson(bbox, max_depth);
+  R3SurfelTree *tree = scene->Tree();
+  R3SurfelDatabase *database = tree->Database();
+  for (int i = 0; i < tree->NNodes(); i++) {
+    R3SurfelNode *node = tree->Node(i);
+    if (node->NParts() > 0) continue;
+    if (!R3Intersects(bbox, node->BBox())) continue;
+    for (int j = 0; j < node->NBlocks(); j++) {
+      R3SurfelBlock *block = node->Block(j);
+      if (!R3Intersects(bbox, block->BBox())) continue;
+      const R3Point& origin = block->Origin();
+      database->ReadBlock(block);
+      for (int k = 0; k < block->NSurfels(); k++) {
+        const R3Surfel *surfel = block->Surfel(k);
+        if (!surfel->HasNormal()) continue;
+        double px = origin.X() + surfel->X();
+        double py = origin.Y() + surfel->Y();
+        double pz = origin.Z() + surfel->Z();
+        R3Point position(px, py, pz);
+        if (!R3Intersects(bbox, position)) continue;
+        R3Vector normal(surfel->NX(), surfel->NY(), surfel->NZ());
+        poisson.InsertPoint(position, normal);
+      }
+      database->ReleaseBlock(block);
+    }
+  }
+
+  // Reconstruct mesh
+  return ReconstructPoissonMesh(&poisson, trim_depth, nthreads);
+}
+
+
+
+R3Mesh *
+CreatePoissonMesh(R3SurfelScene *scene,
+  int max_depth, RNScalar trim_depth, int nthreads)
+{
+  // Reconstruct mesh from all surfels
+  return CreatePoissonMesh(scene, scene->BBox(), max_depth, trim_depth, nthreads);
+}
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Normal extraction
 ////////////////////////////////////////////////////////////////////////
@@ -1544,21 +1646,11 @@ FitPlane(R3SurfelPointSet *pointset)
 
 
 
-R3Plane
-EstimateSupportPlane(R3SurfelPointSet *pointset,
-  RNLength accuracy, RNScalar *npoints)
+static R3Plane
+VoteSupportPlane(const R3Point *positions, int npositions,
+  RNCoord zmin, RNLength zlength, RNLength accuracy, RNScalar *npoints)
 {
-  // Check point set
-  if (pointset->NPoints() == 0) {
-    if (npoints) *npoints = 0;
-    return R3null_plane;
-  }
-
   // Determine zres
-  const R3Box& bbox = pointset->BBox();
-  RNScalar zmin = bbox.ZMin();
-  RNScalar zlength = bbox.ZLength();
-  if (zlength == 0) return R3Plane(0, 0, 1, -(bbox.ZMin()));
   int zres = (int) (2 * zlength / accuracy) + 4;
 
   // Initialize votes
@@ -1566,10 +1658,9 @@ EstimateSupportPlane(R3SurfelPointSet *pointset,
   for (int i = 0; i < zres; i++) votes[i] = 0;
   
   // Cast votes
-  int step = 10 * pointset->NPoints() / zres + 1;
-  for (int j = 0; j < pointset->NPoints(); j += step) {
-    const R3SurfelPoint *point = pointset->Point(j);
-    R3Point position = point->Position();
+  int step = 10 * npositions / zres + 1;
+  for (int j = 0; j < npositions; j += step) {
+    const R3Point& position = positions[j];
     int iz = (int) (zres * (position.Z() - zmin) / zlength);
     if (iz >= zres) iz = zres - 1;
     for (int k = iz; k >= 0; k--) votes[k] += 0.01;
@@ -1610,6 +1701,66 @@ EstimateSupportPlane(R3SurfelPointSet *pointset,
 
 
 
+R3Plane
+EstimateSupportPlane(R3SurfelPointSet *pointset,
+  RNLength accuracy, RNScalar *npoints)
+{
+  // Check point set
+  if (pointset->NPoints() == 0) {
+    if (npoints) *npoints = 0;
+    return R3null_plane;
+  }
+
+  // Determine z range
+  const R3Box& bbox = pointset->BBox();
+  RNScalar zmin = bbox.ZMin();
+  RNScalar zlength = bbox.ZLength();
+  if (zlength == 0) return R3Plane(0, 0, 1, -(bbox.ZMin()));
+
+  // Copy positions
+  R3Point *positions = new R3Point [ pointset->NPoints() ];
+  for (int i = 0; i < pointset->NPoints(); i++) {
+    positions[i] = pointset->Point(i)->Position();
+  }
+
+  // Vote for support plane
+  R3Plane plane = VoteSupportPlane(positions, pointset->NPoints(), zmin, zlength, accuracy, npoints);
+
+  // Delete positions
+  delete [] positions;
+
+  // Return ground plane
+  return plane;
+}
+
+
+
+R3Plane
+EstimateSupportPlane(const R3Point *positions, int npositions,
+  RNLength accuracy, RNScalar *npoints)
+{
+  // Check positions
+  if (npositions == 0) {
+    if (npoints) *npoints = 0;
+    return R3null_plane;
+  }
+
+  // Determine z range
+  RNCoord zmin = positions[0].Z();
+  RNCoord zmax = positions[0].Z();
+  for (int i = 1; i < npositions; i++) {
+    if (positions[i].Z() < zmin) zmin = positions[i].Z();
+    if (positions[i].Z() > zmax) zmax = positions[i].Z();
+  }
+  RNLength zlength = zmax - zmin;
+  if (zlength == 0) return R3Plane(0, 0, 1, -zmin);
+
+  // Vote for support plane
+  return VoteSupportPlane(positions, npositions, zmin, zlength, accuracy, npoints);
+}
+
+
+
 R3Plane 
 EstimateSupportPlane(R3SurfelScene *scene, 
   R3SurfelNode *source_node, const R3SurfelConstraint *constraint,
@@ -2109,244 +2260,285 @@ CreatePlanarObjects(R3SurfelScene *scene,
 // Hierarchical clustering
 ////////////////////////////////////////////////////////////////////////
 
-struct R3SurfelCluster {
-  R3SurfelCluster *parent;
-  RNArray<R3SurfelPoint *> points; 
-  R3Box bbox; 
-  int id;
+// Clusters are the connected components of the neighbor graph after
+// dropping edges that fail the offplane distance and normal angle tests
+// (merging pairs in order of similarity until no pairs are left always
+// ends with these components).  They are tracked with union-find that
+// links the larger root to the smaller one, so every cluster is rooted
+// at its smallest point index whatever order edges are processed in.
+// Chunks are read one at a time, together with a halo of points from
+// other chunks within the neighbor distance.  Only the edges from points
+// of the chunk to halo points, and the normals of points that can be in
+// the halo of another chunk (which include both ends of those edges), are
+// kept after a chunk is processed.  They are merged after all chunks have
+// been read, and then a second pass over the chunks copies surfels into
+// one node per cluster and chunk.
+
+#define R3_SURFEL_CLUSTER_BATCH_SIZE 1024
+
+struct R3SurfelClusterChunk {
+  R3Box bbox;
+  R3Box halo_bbox;
+  int ix, iy;
+  int offset;
+  int npoints;
+  int nhalo_points;
+  R3Point *positions;
+  R3Surfel *surfels;
+  unsigned long long *keys;
+  R3Vector *normals;
+  int *neighbors;
+  int max_neighbors;
+  RNLength max_neighbor_distance;
+  R3Kdtree<R3Point *> *kdtree;
 };
 
-struct R3SurfelClusterPair {
-  R3SurfelCluster *clusters[2];
-  RNScalar similarity;
+struct R3SurfelClusterSeamPoint {
+  unsigned long long key;
+  int index;
+  R3Vector normal;
 };
 
+struct R3SurfelClusterSeamEdge {
+  unsigned long long key0;
+  unsigned long long key1;
+};
 
+struct R3SurfelClusterEntry {
+  int object_index;
+  int index;
+};
 
-RNArray<R3SurfelObject *> *
-CreateClusterObjects(R3SurfelScene *scene, R3SurfelPointGraph *graph, 
-  R3SurfelObject *parent_object, R3SurfelNode *parent_node, 
-  RNLength max_offplane_distance, RNAngle max_normal_angle,
-  int min_points_per_object)
+
+
+static int
+FindClusterRoot(int *parents, int index)
 {
-  // Get convenient variables
-  R3SurfelTree *tree = scene->Tree();
-  if (!tree) return 0;
-  R3SurfelDatabase *database = tree->Database();
-  if (!database) return 0;
+  // Find root with path halving
+  while (parents[index] != index) {
+    parents[index] = parents[parents[index]];
+    index = parents[index];
+  }
 
-  // Check number of points
-  if (graph->NPoints() < min_points_per_object) return NULL;
+  // Return root
+  return index;
+}
 
-  // Check parent object
-  if (!parent_object) parent_object = scene->RootObject();
 
-  // Check parent node
-  if (!parent_node) parent_node = tree->RootNode();
 
-  // Create normals
-  R3Vector *normals = NULL;
-  if ((max_offplane_distance > 0) || (max_normal_angle > 0)) {
-    normals = CreateNormals(graph, FALSE);
+static void
+MergeClusters(int *parents, int index0, int index1)
+{
+  // Link larger root to smaller one
+  int root0 = FindClusterRoot(parents, index0);
+  int root1 = FindClusterRoot(parents, index1);
+  if (root0 < root1) parents[root1] = root0;
+  else if (root1 < root0) parents[root0] = root1;
+}
+
+
+
+static RNBoolean
+AreClusterNeighborsCompatible(const R3Point& position0, const R3Vector *normal0,
+  const R3Point& position1, const R3Vector *normal1,
+  RNLength max_offplane_distance, RNAngle max_normal_angle)
+{
+  // Check offplane distance
+  if (max_offplane_distance > 0) {
+    R3Plane plane0(position0, (normal0) ? *normal0 : R3zero_vector);
+    if (R3Distance(plane0, position1) > max_offplane_distance) return FALSE;
   }
 
-  // Create cluster for every point
-  RNArray<R3SurfelCluster *> clusters;
-  for (int i = 0; i < graph->NPoints(); i++) {
-    R3SurfelPoint *point = graph->Point(i);
-    R3Point position = point->Position();
-    R3SurfelCluster *cluster = new R3SurfelCluster();
-    cluster->parent = NULL;
-    cluster->points.Insert(point);
-    cluster->bbox.Reset(position, position);
-    cluster->id = i;
-    clusters.Insert(cluster);
-  }
-
-  // Check clusters
-  if (clusters.IsEmpty()) {
-    if (normals) delete [] normals;
-    return NULL;  
-  }
-
-  // Create cluster pairs and add to heap
-  R3SurfelClusterPair tmp;
-  RNHeap<R3SurfelClusterPair *> heap(&tmp, &tmp.similarity, NULL, FALSE);;
-  for (int index0 = 0; index0 < graph->NPoints(); index0++) {
-    R3SurfelPoint *point0 = graph->Point(index0);
-    R3SurfelCluster *cluster0 = clusters.Kth(index0);
-    R3Point position0 = point0->Position();
-    const R3Vector& normal0 = (normals) ? normals[index0] : R3zero_vector;
-    R3Plane plane0(position0, normal0);
-    for (int j = 0; j < graph->NNeighbors(index0); j++) {
-      R3SurfelPoint *point1 = graph->Neighbor(index0, j);
-      int index1 = graph->PointIndex(point1);
-      if (index1 < index0) continue;
-      R3Point position1 = point1->Position();
-
-      // Compute plane similarity
-      RNScalar plane_similarity = 1;
-      if (max_offplane_distance > 0) {
-        RNScalar offplane_distance = R3Distance(plane0, position1);
-        if (offplane_distance > max_offplane_distance) continue;
-        plane_similarity *= 1.0 - 0.9 * offplane_distance / max_offplane_distance;
-      }
+  // Check normal angle
+  if ((max_normal_angle > 0) && normal0 && normal1) {
+    RNScalar dot = fabs(normal0->Dot(*normal1));
+    RNAngle normal_angle = (dot < 1) ? acos(dot) : 0;
+    if (normal_angle > max_normal_angle) return FALSE;
+  }
 
-      // Compute normal similarity
-      RNScalar normal_similarity = 1;
-      if (max_normal_angle > 0) {
-        if (normals) {
-          const R3Vector& normal1 = normals[index1];
-          RNScalar dot = fabs(normal0.Dot(normal1));
-          RNAngle normal_angle = (dot < 1) ? acos(dot) : 0;
-          if (normal_angle > max_normal_angle) continue;
-          normal_similarity *= 1.0 - 0.9 * normal_angle / max_normal_angle;
-        }
-      }
+  // Passed all tests
+  return TRUE;
+}
 
-      // Compute distance similarity
-      RNScalar distance_similarity = 1.0;
-      if (graph->MaxDistance() > 0) {
-        RNScalar distance = R3Distance(position0, position1);
-        distance_similarity = 1.0 - 0.99 * distance / graph->MaxDistance();
-      }
 
-      // Create pair
-      R3SurfelCluster *cluster1 = clusters.Kth(index1);
-      R3SurfelClusterPair *pair = new R3SurfelClusterPair();
-      pair->clusters[0] = cluster0;
-      pair->clusters[1] = cluster1;
-      pair->similarity = distance_similarity * normal_similarity * plane_similarity;
-      heap.Push(pair);
-    }
+
+static R3SurfelNode *
+CreateClusterNode(R3SurfelScene *scene, const R3Point *positions, const R3Surfel *surfels,
+  const int *indices, int nindices, const char *name, R3SurfelNode *parent_node)
+{
+  // Get convenient variables
+  R3SurfelTree *tree = scene->Tree();
+  R3SurfelDatabase *database = tree->Database();
+
+  // Compute origin
+  R3Box bbox = R3null_box;
+  for (int j = 0; j < nindices; j++) bbox.Union(positions[indices[j]]);
+  R3Point origin = bbox.Centroid();
+
+  // Create surfels
+  R3Surfel *cluster_surfels = new R3Surfel [ nindices ];
+  for (int j = 0; j < nindices; j++) {
+    int index = indices[j];
+    const R3Point& position = positions[index];
+    cluster_surfels[j].SetCoords(position.X() - origin.X(), position.Y() - origin.Y(), position.Z() - origin.Z());
+    cluster_surfels[j].SetColor(surfels[index].Color());
+    cluster_surfels[j].SetAerial(surfels[index].IsAerial());
   }
 
-  // Check cluster pairs
-  if (heap.IsEmpty()) {
-    for (int i = 0; i < clusters.NEntries(); i++) delete clusters[i];
-    if (normals) delete [] normals;
+  // Create block
+  R3SurfelBlock *block = new R3SurfelBlock(cluster_surfels, nindices, origin);
+  delete [] cluster_surfels;
+  if (!block) {
+    fprintf(stderr, "Unable to create block\n");
     return NULL;
   }
 
-  // Merge clusters hierarchically
-  int merge_count = 0;
-  while (!heap.IsEmpty()) {
-    // Get pair
-    R3SurfelClusterPair *pair = heap.Pop();
+  // Create node
+  R3SurfelNode *node = new R3SurfelNode(name);
+  if (!node) {
+    fprintf(stderr, "Unable to create node\n");
+    delete block;
+    return NULL;
+  }
+
+  // Insert everything
+  block->UpdateProperties();
+  database->InsertBlock(block);
+  node->InsertBlock(block);
+  tree->InsertNode(node, parent_node);
+
+  // Return node
+  return node;
+}
 
-    // Get clusters
-    R3SurfelCluster *cluster0 = pair->clusters[0];
-    R3SurfelCluster *cluster1 = pair->clusters[1];
-    while (cluster0->parent) cluster0 = cluster0->parent;
-    while (cluster1->parent) cluster1 = cluster1->parent;
-    if (cluster0 == cluster1) continue;
 
-    // Merge clusters
-    cluster0->points.Append(cluster1->points);
-    cluster0->bbox.Union(cluster1->bbox);
-    cluster1->parent = cluster0;
-    cluster1->points.Empty(TRUE);
-    cluster1->bbox = R3null_box;
 
-    // Delete pair
-    delete pair;
+static RNArray<R3SurfelObject *> *
+CreateClusterObjects(R3SurfelScene *scene, int npoints,
+  const R3Point *positions, const R3Surfel *surfels, int *parents,
+  R3SurfelObject *parent_object, R3SurfelNode *parent_node, 
+  int min_points_per_object, const char *name_prefix)
+{
+  // Get convenient variables
+  R3SurfelTree *tree = scene->Tree();
+  if (!tree) return NULL;
+  R3SurfelDatabase *database = tree->Database();
+  if (!database) return NULL;
 
-    // Update count
-    merge_count++;
-  }
+  // Check parent object
+  if (!parent_object) parent_object = scene->RootObject();
+
+  // Check parent node
+  if (!parent_node) parent_node = tree->RootNode();
+
+  // Sort points by cluster (in order of smallest point index)
+  int *counts = new int [ npoints + 1 ];
+  int *order = new int [ npoints ];
+  for (int i = 0; i < npoints; i++) parents[i] = FindClusterRoot(parents, i);
+  for (int i = 0; i <= npoints; i++) counts[i] = 0;
+  for (int i = 0; i < npoints; i++) counts[parents[i] + 1]++;
+  for (int i = 0; i < npoints; i++) counts[i+1] += counts[i];
+  for (int i = 0; i < npoints; i++) order[counts[parents[i]]++] = i;
+  for (int i = npoints; i > 0; i--) counts[i] = counts[i-1];
+  counts[0] = 0;
 
   // Create array of objects
   RNArray<R3SurfelObject *> *objects = new RNArray<R3SurfelObject *>();
   if (!objects) {
     fprintf(stderr, "Unable to create array of objects\n");
-    for (int i = 0; i < clusters.NEntries(); i++) delete clusters[i];
-    if (normals) delete [] normals;
+    delete [] counts;
+    delete [] order;
     return NULL;
   }
 
-  // Create objects with copies of surfels
-  int object_count = 0;
-  for (int i = 0; i < clusters.NEntries(); i++) {
-    R3SurfelCluster *cluster = clusters.Kth(i);
-
+  // Create object with copies of surfels for every cluster
+  for (int root = 0; root < npoints; root++) {
     // Check cluster
-    if (cluster->points.NEntries() < min_points_per_object) { delete cluster; continue; }
-    if (cluster->parent) { delete cluster; continue; }
-
-    // Create surfels
-    R3Point origin = cluster->bbox.Centroid();
-    R3Surfel *surfels = new R3Surfel [ cluster->points.NEntries() ];
-    for (int j = 0; j < cluster->points.NEntries(); j++) {
-      R3SurfelPoint *point = cluster->points.Kth(j);
-      R3SurfelBlock *block = point->Block();
-      const R3Surfel *surfel = point->Surfel();
-      RNCoord x = surfel->X() + block->Origin().X() - origin.X();
-      RNCoord y = surfel->Y() + block->Origin().Y() - origin.Y();
-      RNCoord z = surfel->Z() + block->Origin().Z() - origin.Z();
-      surfels[j].SetCoords(x, y, z);
-      surfels[j].SetColor(surfel->Color());
-      surfels[j].SetAerial(surfel->IsAerial());
-    }
-
-    // Create block
-    R3SurfelBlock *block = new R3SurfelBlock(surfels, cluster->points.NEntries(), origin);
-    if (!block) {
-      fprintf(stderr, "Unable to create node\n");
-      for (int i = 0; i < clusters.NEntries(); i++) delete clusters[i];
-      if (normals) delete [] normals;
-      delete [] surfels;
-      return NULL;
-    }
-
-    // Delete surfels
-    delete [] surfels;
+    int first = counts[root];
+    int ncluster_points = counts[root+1] - first;
+    if (ncluster_points == 0) continue;
+    if (ncluster_points < min_points_per_object) continue;
 
     // Create node
-    char node_name[256];
-    sprintf(node_name, "O%d\n", objects->NEntries());
-    R3SurfelNode *node = new R3SurfelNode(node_name);
-    if (!node) {
-      fprintf(stderr, "Unable to create node\n");
-      for (int i = 0; i < clusters.NEntries(); i++) delete clusters[i];
-      if (normals) delete [] normals;
-      delete block;
-      return NULL;
-    }
+    char name[256];
+    sprintf(name, "%s%d", name_prefix, objects->NEntries());
+    R3SurfelNode *node = CreateClusterNode(scene, positions, surfels,
+      &order[first], ncluster_points, name, parent_node);
+    if (!node) break;
 
     // Create object
-    char object_name[256];
-    sprintf(object_name, "O%d\n", objects->NEntries());
-    R3SurfelObject *object = new R3SurfelObject(object_name);
+    R3SurfelObject *object = new R3SurfelObject(name);
     if (!object) {
       fprintf(stderr, "Unable to create object\n");
-      for (int i = 0; i < clusters.NEntries(); i++) delete clusters[i];
-      if (normals) delete [] normals;
-      delete block;
-      delete node;
-      return NULL;
+      break;
     }
-     
-    // Insert everything
-    block->UpdateProperties();
-    database->InsertBlock(block);
-    node->InsertBlock(block);
-    tree->InsertNode(node, parent_node);
+
+    // Insert object
     object->InsertNode(node);
     scene->InsertObject(object, parent_object);
     objects->Insert(object);
+  }
+
+  // Delete temporary memory
+  delete [] counts;
+  delete [] order;
+
+  // Return objects
+  return objects;
+}
+
+
+
+RNArray<R3SurfelObject *> *
+CreateClusterObjects(R3SurfelScene *scene, R3SurfelPointGraph *graph, 
+  R3SurfelObject *parent_object, R3SurfelNode *parent_node, 
+  RNLength max_offplane_distance, RNAngle max_normal_angle,
+  int min_points_per_object)
+{
+  // Check number of points
+  int npoints = graph->NPoints();
+  if (npoints == 0) return NULL;
+  if (npoints < min_points_per_object) return NULL;
 
-    // Delete cluster
-    delete cluster;
+  // Create normals
+  R3Vector *normals = NULL;
+  if ((max_offplane_distance > 0) || (max_normal_angle > 0)) {
+    normals = CreateNormals(graph, FALSE);
+  }
 
-    // Print debug statement
-    printf("    %d %d\n", i, block->NSurfels());
+  // Copy points
+  R3Point *positions = new R3Point [ npoints ];
+  R3Surfel *surfels = new R3Surfel [ npoints ];
+  for (int i = 0; i < npoints; i++) {
+    R3SurfelPoint *point = graph->Point(i);
+    positions[i] = point->Position();
+    surfels[i] = *(point->Surfel());
+  }
 
-    // Update count
-    object_count++;
+  // Merge clusters of compatible neighbors
+  int *parents = new int [ npoints ];
+  for (int i = 0; i < npoints; i++) parents[i] = i;
+  for (int index0 = 0; index0 < npoints; index0++) {
+    const R3Vector *normal0 = (normals) ? &normals[index0] : NULL;
+    for (int j = 0; j < graph->NNeighbors(index0); j++) {
+      int index1 = graph->PointIndex(graph->Neighbor(index0, j));
+      if (index1 <= index0) continue;
+      const R3Vector *normal1 = (normals) ? &normals[index1] : NULL;
+      if (!AreClusterNeighborsCompatible(positions[index0], normal0, positions[index1], normal1,
+        max_offplane_distance, max_normal_angle)) continue;
+      MergeClusters(parents, index0, index1);
+    }
   }
-  
-  // Delete normals
-  delete [] normals;
+
+  // Create objects
+  RNArray<R3SurfelObject *> *objects = CreateClusterObjects(scene, npoints,
+    positions, surfels, parents, parent_object, parent_node, min_points_per_object, "O");
+
+  // Delete temporary memory
+  if (normals) delete [] normals;
+  delete [] positions;
+  delete [] surfels;
+  delete [] parents;
 
   // Return objects
   return objects;
@@ -2354,6 +2546,250 @@ CreateClusterObjects(R3SurfelScene *scene, R3SurfelPointGraph *graph,
 
 
 
+template <class Type>
+static Type *
+ReserveClusterEntries(Type *entries, int nentries, int *max_entries, int nrequired)
+{
+  // Check capacity
+  if (nrequired <= *max_entries) return entries;
+
+  // Double capacity until entries fit
+  int capacity = (*max_entries > 0) ? *max_entries : 1024;
+  while (capacity < nrequired) capacity *= 2;
+
+  // Copy entries
+  Type *copy = new Type [ capacity ];
+  for (int i = 0; i < nentries; i++) copy[i] = entries[i];
+  if (entries) delete [] entries;
+  *max_entries = capacity;
+
+  // Return copy
+  return copy;
+}
+
+
+
+static int
+CompareClusterSeamPoints(const void *data1, const void *data2)
+{
+  // Compare point keys
+  const R3SurfelClusterSeamPoint *point1 = (const R3SurfelClusterSeamPoint *) data1;
+  const R3SurfelClusterSeamPoint *point2 = (const R3SurfelClusterSeamPoint *) data2;
+  if (point1->key < point2->key) return -1;
+  if (point1->key > point2->key) return 1;
+  return 0;
+}
+
+
+
+static int
+CompareClusterEntries(const void *data1, const void *data2)
+{
+  // Compare object indices (and point indices, so that sorting is deterministic)
+  const R3SurfelClusterEntry *entry1 = (const R3SurfelClusterEntry *) data1;
+  const R3SurfelClusterEntry *entry2 = (const R3SurfelClusterEntry *) data2;
+  if (entry1->object_index != entry2->object_index) return entry1->object_index - entry2->object_index;
+  return entry1->index - entry2->index;
+}
+
+
+
+static void
+InitializeClusterChunk(R3SurfelClusterChunk *chunk, const R3Box& source_bbox,
+  int nxchunks, int nychunks, int ix, int iy, RNLength max_neighbor_distance)
+{
+  // Compute chunk bounding box
+  RNLength xchunk = source_bbox.XLength() / nxchunks;
+  RNLength ychunk = source_bbox.YLength() / nychunks;
+  chunk->bbox = source_bbox;
+  chunk->bbox[0][0] = source_bbox.XMin() + ix     * xchunk;
+  chunk->bbox[1][0] = source_bbox.XMin() + (ix+1) * xchunk;
+  chunk->bbox[0][1] = source_bbox.YMin() + iy     * ychunk;
+  chunk->bbox[1][1] = source_bbox.YMin() + (iy+1) * ychunk;
+
+  // Compute halo bounding box
+  chunk->halo_bbox = chunk->bbox;
+  chunk->halo_bbox[0][0] -= max_neighbor_distance;
+  chunk->halo_bbox[0][1] -= max_neighbor_distance;
+  chunk->halo_bbox[1][0] += max_neighbor_distance;
+  chunk->halo_bbox[1][1] += max_neighbor_distance;
+
+  // Initialize everything else
+  chunk->ix = ix;
+  chunk->iy = iy;
+  chunk->offset = 0;
+  chunk->npoints = 0;
+  chunk->nhalo_points = 0;
+  chunk->positions = NULL;
+  chunk->surfels = NULL;
+  chunk->keys = NULL;
+  chunk->normals = NULL;
+  chunk->neighbors = NULL;
+  chunk->max_neighbors = 0;
+  chunk->max_neighbor_distance = max_neighbor_distance;
+  chunk->kdtree = NULL;
+}
+
+
+
+static void
+EmptyClusterChunk(R3SurfelClusterChunk *chunk)
+{
+  // Delete arrays
+  if (chunk->positions) delete [] chunk->positions;
+  if (chunk->surfels) delete [] chunk->surfels;
+  if (chunk->keys) delete [] chunk->keys;
+  if (chunk->normals) delete [] chunk->normals;
+  if (chunk->neighbors) delete [] chunk->neighbors;
+  chunk->positions = NULL;
+  chunk->surfels = NULL;
+  chunk->keys = NULL;
+  chunk->normals = NULL;
+  chunk->neighbors = NULL;
+}
+
+
+
+static RNBoolean
+IsClusterChunkPoint(const R3SurfelClusterChunk& chunk, int nxchunks, int nychunks, const R3Point& position)
+{
+  // Check whether chunk owns point (points on a shared side belong to the chunk with larger coordinates)
+  if ((chunk.ix > 0) && (position.X() < chunk.bbox.XMin())) return FALSE;
+  if ((chunk.iy > 0) && (position.Y() < chunk.bbox.YMin())) return FALSE;
+  if ((chunk.ix < nxchunks-1) && (position.X() >= chunk.bbox.XMax())) return FALSE;
+  if ((chunk.iy < nychunks-1) && (position.Y() >= chunk.bbox.YMax())) return FALSE;
+  return TRUE;
+}
+
+
+
+static RNBoolean
+IsClusterSeamPoint(const R3SurfelClusterChunk& chunk, const R3Box& source_bbox,
+  int nxchunks, int nychunks, const R3Point& position)
+{
+  // Check whether point is in the halo of another chunk
+  // (with halo boxes slightly larger than the ones used to read those chunks)
+  int xreach = (nxchunks > 1) ? (int) (chunk.max_neighbor_distance * nxchunks / source_bbox.XLength()) + 1 : 0;
+  int yreach = (nychunks > 1) ? (int) (chunk.max_neighbor_distance * nychunks / source_bbox.YLength()) + 1 : 0;
+  for (int iy = chunk.iy - yreach; iy <= chunk.iy + yreach; iy++) {
+    if ((iy < 0) || (iy >= nychunks)) continue;
+    for (int ix = chunk.ix - xreach; ix <= chunk.ix + xreach; ix++) {
+      if ((ix < 0) || (ix >= nxchunks)) continue;
+      if ((ix == chunk.ix) && (iy == chunk.iy)) continue;
+      R3SurfelClusterChunk other_chunk;
+      InitializeClusterChunk(&other_chunk, source_bbox, nxchunks, nychunks, ix, iy, chunk.max_neighbor_distance + RN_EPSILON);
+      if (R3Contains(other_chunk.halo_bbox, position)) return TRUE;
+    }
+  }
+
+  // Point is only in this chunk
+  return FALSE;
+}
+
+
+
+static int
+ReadClusterChunk(R3SurfelScene *scene, R3SurfelNode *source_node, const R3SurfelConstraint *constraint,
+  R3SurfelClusterChunk *chunk, int nxchunks, int nychunks, RNBoolean read_halo)
+{
+  // Create point set for chunk and its halo
+  // (always with the halo box, so that points of the chunk are read in the same order)
+  R3SurfelBoxConstraint box_constraint(chunk->halo_bbox);
+  R3SurfelMultiConstraint multi_constraint;
+  multi_constraint.InsertConstraint(&box_constraint);
+  if (constraint) multi_constraint.InsertConstraint(constraint);
+  R3SurfelPointSet *pointset = CreatePointSet(scene, source_node, &multi_constraint);
+  if (!pointset) return 0;
+
+  // Allocate arrays
+  int n = pointset->NPoints();
+  chunk->positions = new R3Point [ n + 1 ];
+  chunk->surfels = new R3Surfel [ n + 1 ];
+  if (read_halo) chunk->keys = new unsigned long long [ n + 1 ];
+
+  // Copy points owned by chunk, followed by halo points owned by other chunks
+  for (int pass = 0; pass < 2; pass++) {
+    if ((pass == 1) && !read_halo) break;
+    for (int k = 0; k < n; k++) {
+      R3SurfelPoint *point = pointset->Point(k);
+      R3Point position = point->Position();
+      if (!R3Contains(chunk->halo_bbox, position)) continue;
+      RNBoolean owned = IsClusterChunkPoint(*chunk, nxchunks, nychunks, position);
+      if (owned != (pass == 0)) continue;
+      int index = chunk->npoints + chunk->nhalo_points;
+      chunk->positions[index] = position;
+      if (owned) chunk->surfels[index] = *(point->Surfel());
+      if (chunk->keys) {
+        // Identify surfel by its block and its index in block
+        unsigned long long block_index = (unsigned int) point->Block()->DatabaseIndex();
+        chunk->keys[index] = (block_index << 32) | (unsigned int) point->BlockIndex();
+      }
+      if (owned) chunk->npoints++;
+      else chunk->nhalo_points++;
+    }
+  }
+
+  // Delete point set
+  delete pointset;
+
+  // Return success
+  return 1;
+}
+
+
+
+static void
+FindClusterChunkNeighbors(int batch_index, int, void *data)
+{
+  // Get convenient variables
+  R3SurfelClusterChunk *chunk = (R3SurfelClusterChunk *) data;
+  int max_neighbors = chunk->max_neighbors;
+  const R3Point *positions = chunk->positions;
+  int first = batch_index * R3_SURFEL_CLUSTER_BATCH_SIZE;
+  int last = first + R3_SURFEL_CLUSTER_BATCH_SIZE;
+  if (last > chunk->npoints) last = chunk->npoints;
+
+  // Find neighbors of points in batch (list is terminated by -1 if not full)
+  RNArray<R3Point *> found;
+  for (int i = first; i < last; i++) {
+    int *neighbors = &chunk->neighbors[i*max_neighbors];
+    int nneighbors = 0;
+    found.Empty();
+    chunk->kdtree->FindClosest(positions[i], 0, chunk->max_neighbor_distance, max_neighbors + 1, found);
+    for (int j = 0; j < found.NEntries(); j++) {
+      int neighbor_index = found.Kth(j) - positions;
+      if (neighbor_index == i) continue;
+      if (nneighbors == max_neighbors) break;
+      neighbors[nneighbors++] = neighbor_index;
+    }
+    if (nneighbors < max_neighbors) neighbors[nneighbors] = -1;
+  }
+
+  // Compute normals with PCA of neighborhoods
+  if (chunk->normals) {
+    R3Vector *normals = chunk->normals;
+    R3Point *neighborhood = new R3Point [ max_neighbors + 1 ];
+    for (int i = first; i < last; i++) {
+      int *neighbors = &chunk->neighbors[i*max_neighbors];
+      int nneighbors = 0;
+      neighborhood[0] = positions[i];
+      while ((nneighbors < max_neighbors) && (neighbors[nneighbors] >= 0)) {
+        neighborhood[nneighbors+1] = positions[neighbors[nneighbors]];
+        nneighbors++;
+      }
+      if (nneighbors < 2) { normals[i] = R3zero_vector; continue; }
+      R3Point centroid = R3Centroid(nneighbors + 1, neighborhood);
+      R3Triad triad = R3PrincipleAxes(centroid, nneighbors + 1, neighborhood);
+      normals[i] = triad[2];
+      int dim = normals[i].MaxDimension();
+      if (normals[i][dim] < 0) normals[i].Flip();
+    }
+    delete [] neighborhood;
+  }
+}
+
+
+
 RNArray<R3SurfelObject *> *
 CreateClusterObjects(R3SurfelScene *scene, 
   R3SurfelNode *source_node, const R3SurfelConstraint *constraint,
@@ -2367,75 +2803,739 @@ CreateClusterObjects(R3SurfelScene *scene,
   R3SurfelTree *tree = scene->Tree();
   if (!tree) return NULL;
   if (!source_node) source_node = tree->RootNode();
+  if (!parent_object) parent_object = scene->RootObject();
+  if (!parent_node) parent_node = tree->RootNode();
+  if (max_neighbors < 1) max_neighbors = 1;
+  RNBoolean use_normals = (max_offplane_distance > 0) || (max_normal_angle > 0);
+
+  // Check neighbor distance (it bounds the halo read around every chunk)
+  if (max_neighbor_distance <= 0) {
+    fprintf(stderr, "Unable to create cluster objects without a positive neighbor distance\n");
+    return NULL;
+  }
+
+  // Compute number of chunks
   const R3Box& source_bbox = source_node->BBox();
   int nxchunks = 1;
   int nychunks = 1;
-  RNLength xchunk = source_bbox.XLength();
-  RNLength ychunk = source_bbox.YLength();
   if (chunk_size > 0) {
     nxchunks = (int) (source_bbox.XLength() / chunk_size) + 1;
     nychunks = (int) (source_bbox.YLength() / chunk_size) + 1;
-    xchunk = source_bbox.XLength() / nxchunks;
-    ychunk = source_bbox.YLength() / nychunks;
   }
 
+  // Allocate cluster parents and seam data (grown as chunks are read)
+  int npoints = 0, max_points = 0;
+  int nseam_points = 0, max_seam_points = 0;
+  int nseam_edges = 0, max_seam_edges = 0;
+  int *parents = NULL;
+  R3SurfelClusterSeamPoint *seam_points = NULL;
+  R3SurfelClusterSeamEdge *seam_edges = NULL;
+
+  // Merge clusters within every chunk (serially, since reading blocks is not thread-safe)
+  for (int iy = 0; iy < nychunks; iy++) {
+    for (int ix = 0; ix < nxchunks; ix++) {
+      // Read points of chunk and its halo
+      R3SurfelClusterChunk chunk;
+      InitializeClusterChunk(&chunk, source_bbox, nxchunks, nychunks, ix, iy, max_neighbor_distance);
+      if (!ReadClusterChunk(scene, source_node, constraint, &chunk, nxchunks, nychunks, TRUE)) continue;
+      if (chunk.npoints == 0) { EmptyClusterChunk(&chunk); continue; }
+      chunk.offset = npoints;
+
+      // Initialize parents of points in chunk
+      parents = ReserveClusterEntries(parents, npoints, &max_points, npoints + chunk.npoints);
+      for (int i = 0; i < chunk.npoints; i++) parents[chunk.offset + i] = chunk.offset + i;
+      npoints += chunk.npoints;
+
+      // Find neighbors and normals of points in chunk in parallel
+      RNArray<R3Point *> array;
+      for (int i = 0; i < chunk.npoints + chunk.nhalo_points; i++) array.Insert(&chunk.positions[i]);
+      R3Kdtree<R3Point *> kdtree(array);
+      chunk.kdtree = &kdtree;
+      chunk.max_neighbors = max_neighbors;
+      chunk.neighbors = new int [ chunk.npoints * max_neighbors ];
+      if (use_normals) chunk.normals = new R3Vector [ chunk.npoints ];
+      int nbatches = (chunk.npoints + R3_SURFEL_CLUSTER_BATCH_SIZE - 1) / R3_SURFEL_CLUSTER_BATCH_SIZE;
+      RNParallelFor(nbatches, FindClusterChunkNeighbors, &chunk);
+
+      // Merge clusters of compatible neighbors in chunk, and keep edges to halo points
+      // that pass the offplane test (the normal angle test waits for the normal of the halo point)
+      for (int i = 0; i < chunk.npoints; i++) {
+        const int *neighbors = &chunk.neighbors[i*max_neighbors];
+        const R3Vector *normal0 = (chunk.normals) ? &chunk.normals[i] : NULL;
+        for (int j = 0; (j < max_neighbors) && (neighbors[j] >= 0); j++) {
+          int k = neighbors[j];
+          if (k < chunk.npoints) {
+            const R3Vector *normal1 = (chunk.normals) ? &chunk.normals[k] : NULL;
+            if (!AreClusterNeighborsCompatible(chunk.positions[i], normal0, chunk.positions[k], normal1,
+              max_offplane_distance, max_normal_angle)) continue;
+            MergeClusters(parents, chunk.offset + i, chunk.offset + k);
+          }
+          else {
+            if (!AreClusterNeighborsCompatible(chunk.positions[i], normal0, chunk.positions[k], NULL,
+              max_offplane_distance, max_normal_angle)) continue;
+            seam_edges = ReserveClusterEntries(seam_edges, nseam_edges, &max_seam_edges, nseam_edges + 1);
+            seam_edges[nseam_edges].key0 = chunk.keys[i];
+            seam_edges[nseam_edges].key1 = chunk.keys[k];
+            nseam_edges++;
+          }
+        }
+      }
+
+      // Keep normals of points in the halo of other chunks
+      for (int i = 0; i < chunk.npoints; i++) {
+        if (!IsClusterSeamPoint(chunk, source_bbox, nxchunks, nychunks, chunk.positions[i])) continue;
+        seam_points = ReserveClusterEntries(seam_points, nseam_points, &max_seam_points, nseam_points + 1);
+        R3SurfelClusterSeamPoint& seam_point = seam_points[nseam_points++];
+        seam_point.key = chunk.keys[i];
+        seam_point.index = chunk.offset + i;
+        seam_point.normal = (chunk.normals) ? chunk.normals[i] : R3zero_vector;
+      }
+
+      // Delete chunk
+      EmptyClusterChunk(&chunk);
+    }
+  }
+
+  // Check number of points
+  if (npoints == 0) {
+    if (seam_points) delete [] seam_points;
+    if (seam_edges) delete [] seam_edges;
+    return NULL;
+  }
+
+  // Merge clusters of compatible neighbors across chunks
+  // (edges have passed the offplane test already, so only normal angles are checked)
+  qsort(seam_points, nseam_points, sizeof(R3SurfelClusterSeamPoint), CompareClusterSeamPoints);
+  for (int i = 0; i < nseam_edges; i++) {
+    R3SurfelClusterSeamPoint query0, query1;
+    query0.key = seam_edges[i].key0;
+    query1.key = seam_edges[i].key1;
+    R3SurfelClusterSeamPoint *seam_point0 = (R3SurfelClusterSeamPoint *)
+      bsearch(&query0, seam_points, nseam_points, sizeof(R3SurfelClusterSeamPoint), CompareClusterSeamPoints);
+    R3SurfelClusterSeamPoint *seam_point1 = (R3SurfelClusterSeamPoint *)
+      bsearch(&query1, seam_points, nseam_points, sizeof(R3SurfelClusterSeamPoint), CompareClusterSeamPoints);
+    if (!seam_point0 || !seam_point1) continue;
+    if (!AreClusterNeighborsCompatible(R3zero_point, (use_normals) ? &seam_point0->normal : NULL,
+      R3zero_point, (use_normals) ? &seam_point1->normal : NULL,
+      0, max_normal_angle)) continue;
+    MergeClusters(parents, seam_point0->index, seam_point1->index);
+  }
+
+  // Delete seam data
+  if (seam_points) delete [] seam_points;
+  if (seam_edges) delete [] seam_edges;
+
+  // Count points in every cluster
+  int *object_indices = new int [ npoints ];
+  for (int i = 0; i < npoints; i++) parents[i] = FindClusterRoot(parents, i);
+  for (int i = 0; i < npoints; i++) object_indices[i] = 0;
+  for (int i = 0; i < npoints; i++) object_indices[parents[i]]++;
+
   // Create array of objects
   RNArray<R3SurfelObject *> *objects = new RNArray<R3SurfelObject *>();
   if (!objects) {
-    fprintf(stderr, "Unable to allocate array of objects\n");
+    fprintf(stderr, "Unable to create array of objects\n");
+    delete [] object_indices;
+    delete [] parents;
     return NULL;
   }
 
-  // Fill array of objects chunk-by-chunk
-  for (int j = 0; j < nychunks; j++) {
-    for (int i = 0; i < nxchunks; i++) {
-      // Compute chunk bounding box
-      R3Box chunk_bbox = source_bbox;
-      chunk_bbox[0][0] = source_bbox.XMin() + i     * xchunk;
-      chunk_bbox[1][0] = source_bbox.XMin() + (i+1) * xchunk;
-      chunk_bbox[0][1] = source_bbox.YMin() + j     * ychunk;
-      chunk_bbox[1][1] = source_bbox.YMin() + (j+1) * ychunk;
+  // Create object for every cluster with enough points (in order of smallest point index)
+  for (int root = 0; root < npoints; root++) {
+    int ncluster_points = (parents[root] == root) ? object_indices[root] : 0;
+    object_indices[root] = -1;
+    if (ncluster_points == 0) continue;
+    if (ncluster_points < min_points_per_object) continue;
+    char name[256];
+    sprintf(name, "ClusterObject%d", objects->NEntries());
+    R3SurfelObject *object = new R3SurfelObject(name);
+    if (!object) {
+      fprintf(stderr, "Unable to create object\n");
+      break;
+    }
+    scene->InsertObject(object, parent_object);
+    object_indices[root] = objects->NEntries();
+    objects->Insert(object);
+  }
 
-      // Print debug message
-      printf("  %6d/%6d %6d/%6d\n",j, nychunks, i, nxchunks);
+  // Copy surfels of every chunk into one node per object
+  int offset = 0;
+  for (int iy = 0; iy < nychunks; iy++) {
+    for (int ix = 0; ix < nxchunks; ix++) {
+      // Read points of chunk
+      R3SurfelClusterChunk chunk;
+      InitializeClusterChunk(&chunk, source_bbox, nxchunks, nychunks, ix, iy, max_neighbor_distance);
+      if (!ReadClusterChunk(scene, source_node, constraint, &chunk, nxchunks, nychunks, FALSE)) continue;
+      if (offset + chunk.npoints > npoints) chunk.npoints = npoints - offset;
+      chunk.offset = offset;
+      offset += chunk.npoints;
+
+      // Sort points of chunk by object
+      int nentries = 0;
+      R3SurfelClusterEntry *entries = new R3SurfelClusterEntry [ chunk.npoints + 1 ];
+      for (int i = 0; i < chunk.npoints; i++) {
+        int object_index = object_indices[parents[chunk.offset + i]];
+        if (object_index < 0) continue;
+        entries[nentries].object_index = object_index;
+        entries[nentries].index = i;
+        nentries++;
+      }
+      qsort(entries, nentries, sizeof(R3SurfelClusterEntry), CompareClusterEntries);
+
+      // Create node for every object with points in chunk
+      int *indices = new int [ nentries + 1 ];
+      for (int i = 0; i < nentries; i++) indices[i] = entries[i].index;
+      for (int first = 0; first < nentries; ) {
+        int last = first + 1;
+        while ((last < nentries) && (entries[last].object_index == entries[first].object_index)) last++;
+        R3SurfelObject *object = objects->Kth(entries[first].object_index);
+        R3SurfelNode *node = CreateClusterNode(scene, chunk.positions, chunk.surfels,
+          &indices[first], last - first, object->Name(), parent_node);
+        if (node) object->InsertNode(node);
+        first = last;
+      }
 
-      // Create graph
-      R3SurfelBoxConstraint box_constraint(chunk_bbox);
-      R3SurfelMultiConstraint multi_constraint;
-      multi_constraint.InsertConstraint(&box_constraint);
-      if (constraint) multi_constraint.InsertConstraint(constraint);
-      R3SurfelPointGraph *graph = CreatePointGraph(scene, 
-        source_node, &multi_constraint, 
-        max_neighbors, max_neighbor_distance);
-      if (!graph) continue;
+      // Delete chunk
+      delete [] entries;
+      delete [] indices;
+      EmptyClusterChunk(&chunk);
+    }
+  }
 
-      printf("    %9d : %9.3f %9.3f %9.3f  %9.3f %9.3f %9.3f\n",  graph->NPoints(),
-            graph->BBox().XMin(), graph->BBox().YMin(), graph->BBox().ZMin(), 
-            graph->BBox().XMax(), graph->BBox().YMax(), graph->BBox().ZMax());
+  // Delete temporary memory
+  delete [] object_indices;
+  delete [] parents;
 
-      // Create objects
-      RNArray<R3SurfelObject *> *chunk_objects = CreateClusterObjects(scene, graph, parent_object, parent_node, min_points_per_object);
-      if (!chunk_objects) { delete graph; continue; }
+  // Return objects
+  return objects;
+}
 
-      // Insert into result
-      for (int k = 0; k < chunk_objects->NEntries(); k++) {
-        R3SurfelObject *object = chunk_objects->Kth(k);
-        char object_name[256];
-        sprintf(object_name, "ClusterObject%d\n", objects->NEntries());
-        object->SetName(object_name);
-        objects->Insert(object);
+
+
+////////////////////////////////////////////////////////////////////////
+// Object relationship creation
+////////////////////////////////////////////////////////////////////////
+
+// Candidate pairs of objects are found with a bounding volume hierarchy
+// over the bounding boxes of their points, so that only objects within
+// the maximum gap of each other are compared.  The points of every object
+// are sorted into a sparse grid of cells at least as large as the maximum
+// gap, so a point only has to be compared with the points of the other
+// object in the 27 cells around it.  Reading points is serial, while
+// sorting points, finding candidates, and evaluating pairs are parallel.
+
+#define R3_SURFEL_RELATIONSHIP_MAX_LEAF_OBJECTS 4
+#define R3_SURFEL_RELATIONSHIP_MAX_CELL_COORDINATE 0x1FFFFF
+
+struct R3SurfelRelationshipObject {
+  R3SurfelObject *object;
+  R3Box bbox;
+  int first_point;
+  int npoints;
+  RNBoolean has_plane;
+  R3Point centroid;
+  R3Vector normal;
+};
+
+struct R3SurfelRelationshipCell {
+  R3Box bbox;
+  int children[2];
+  int first_entry;
+  int nentries;
+};
+
+struct R3SurfelRelationshipPair {
+  int object_index0;
+  int object_index1;
+  RNScalar overlap;
+  RNLength gap_distance;
+  RNLength plane_offset;
+  RNAngle normal_angle;
+};
+
+struct R3SurfelRelationshipData {
+  R3SurfelRelationshipObject *objects;
+  int nobjects;
+  R3Point *positions;
+  R3Vector *normals;
+  unsigned long long *keys;
+  R3Point grid_origin;
+  RNLength cell_size;
+  int *entries;
+  R3SurfelRelationshipCell *cells;
+  int ncells;
+  int *candidate_counts;
+  int *candidate_offsets;
+  R3SurfelRelationshipPair *pairs;
+  int type;
+  RNLength max_gap_distance;
+  RNLength max_plane_offset;
+  RNAngle max_normal_angle;
+};
+
+struct R3SurfelRelationshipKey {
+  unsigned long long key;
+  int index;
+};
+
+
+
+static unsigned long long
+RelationshipCellKey(int ix, int iy, int iz)
+{
+  // Return key packing 21 bits of every cell coordinate
+  return ((unsigned long long) ix << 42) | ((unsigned long long) iy << 21) | (unsigned long long) iz;
+}
+
+
+
+static int
+RelationshipCellCoordinate(const R3SurfelRelationshipData *data, const R3Point& position, int dim)
+{
+  // Return cell coordinate of position along dimension
+  int i = (int) ((position[dim] - data->grid_origin[dim]) / data->cell_size);
+  if (i < 1) i = 1;
+  if (i > R3_SURFEL_RELATIONSHIP_MAX_CELL_COORDINATE - 1) i = R3_SURFEL_RELATIONSHIP_MAX_CELL_COORDINATE - 1;
+  return i;
+}
+
+
+
+static int
+CompareRelationshipKeys(const void *data1, const void *data2)
+{
+  // Compare cell keys (and point indices, so that sorting is deterministic)
+  const R3SurfelRelationshipKey *key1 = (const R3SurfelRelationshipKey *) data1;
+  const R3SurfelRelationshipKey *key2 = (const R3SurfelRelationshipKey *) data2;
+  if (key1->key < key2->key) return -1;
+  if (key1->key > key2->key) return 1;
+  return key1->index - key2->index;
+}
+
+
+
+static int
+CompareRelationshipCandidates(const void *data1, const void *data2)
+{
+  // Compare object indices
+  return *((const int *) data1) - *((const int *) data2);
+}
+
+
+
+static void
+SortRelationshipPoints(int object_index, int thread_index, void *data_ptr)
+{
+  // Get object
+  R3SurfelRelationshipData *data = (R3SurfelRelationshipData *) data_ptr;
+  R3SurfelRelationshipObject& object = data->objects[object_index];
+  if (object.npoints == 0) return;
+
+  // Compute cell keys of points
+  R3Point *positions = &data->positions[object.first_point];
+  R3Vector *normals = &data->normals[object.first_point];
+  unsigned long long *keys = &data->keys[object.first_point];
+  R3SurfelRelationshipKey *order = new R3SurfelRelationshipKey [ object.npoints ];
+  for (int i = 0; i < object.npoints; i++) {
+    int ix = RelationshipCellCoordinate(data, positions[i], RN_X);
+    int iy = RelationshipCellCoordinate(data, positions[i], RN_Y);
+    int iz = RelationshipCellCoordinate(data, positions[i], RN_Z);
+    order[i].key = RelationshipCellKey(ix, iy, iz);
+    order[i].index = i;
+  }
+
+  // Sort points by cell key
+  qsort(order, object.npoints, sizeof(R3SurfelRelationshipKey), CompareRelationshipKeys);
+  R3Point *sorted_positions = new R3Point [ object.npoints ];
+  R3Vector *sorted_normals = new R3Vector [ object.npoints ];
+  for (int i = 0; i < object.npoints; i++) {
+    sorted_positions[i] = positions[order[i].index];
+    sorted_normals[i] = normals[order[i].index];
+  }
+  for (int i = 0; i < object.npoints; i++) {
+    positions[i] = sorted_positions[i];
+    normals[i] = sorted_normals[i];
+    keys[i] = order[i].key;
+  }
+
+  // Delete temporary memory
+  delete [] sorted_positions;
+  delete [] sorted_normals;
+  delete [] order;
+}
+
+
+
+static int
+BuildRelationshipCell(R3SurfelRelationshipData *data, int first_entry, int cell_nentries)
+{
+  // Allocate cell
+  int cell_index = data->ncells++;
+  R3SurfelRelationshipCell& cell = data->cells[cell_index];
+  cell.children[0] = -1;
+  cell.children[1] = -1;
+  cell.first_entry = first_entry;
+  cell.nentries = cell_nentries;
+
+  // Compute bounding boxes of objects and their centers
+  int *entries = data->entries;
+  R3Box center_bbox = R3null_box;
+  cell.bbox = R3null_box;
+  for (int i = first_entry; i < first_entry + cell_nentries; i++) {
+    cell.bbox.Union(data->objects[entries[i]].bbox);
+    center_bbox.Union(data->objects[entries[i]].bbox.Centroid());
+  }
+
+  // Check if leaf
+  if (cell_nentries <= R3_SURFEL_RELATIONSHIP_MAX_LEAF_OBJECTS) return cell_index;
+
+  // Partition objects by center along longest axis
+  int dim = center_bbox.LongestAxis();
+  RNCoord split = center_bbox.Centroid()[dim];
+  int i = first_entry;
+  int j = first_entry + cell_nentries - 1;
+  while (i <= j) {
+    if (data->objects[entries[i]].bbox.Centroid()[dim] < split) i++;
+    else { int swap = entries[i]; entries[i] = entries[j]; entries[j] = swap; j--; }
+  }
+
+  // Split in the middle if all centers are on one side
+  int nentries0 = i - first_entry;
+  if ((nentries0 == 0) || (nentries0 == cell_nentries)) nentries0 = cell_nentries / 2;
+
+  // Build children (cell reference may be invalid after recursion, so use index)
+  int child0 = BuildRelationshipCell(data, first_entry, nentries0);
+  int child1 = BuildRelationshipCell(data, first_entry + nentries0, cell_nentries - nentries0);
+  data->cells[cell_index].children[0] = child0;
+  data->cells[cell_index].children[1] = child1;
+
+  // Return cell index
+  return cell_index;
+}
+
+
+
+static void
+FindRelationshipCandidates(int object_index0, int thread_index, void *data_ptr)
+{
+  // Get object
+  R3SurfelRelationshipData *data = (R3SurfelRelationshipData *) data_ptr;
+  const R3SurfelRelationshipObject& object0 = data->objects[object_index0];
+  if (object0.npoints == 0) return;
+  if ((data->type == R3_SURFEL_OBJECT_COPLANAR_RELATIONSHIP) && !object0.has_plane) return;
+
+  // Count candidates, or fill them in if they have been counted
+  int ncandidates = 0;
+  R3SurfelRelationshipPair *pairs = (data->pairs) ? &data->pairs[data->candidate_offsets[object_index0]] : NULL;
+
+  // Traverse hierarchy
+  int stack[256];
+  int nstack = 0;
+  if (data->ncells > 0) stack[nstack++] = 0;
+  while (nstack > 0) {
+    const R3SurfelRelationshipCell& cell = data->cells[stack[--nstack]];
+    if (R3Distance(cell.bbox, object0.bbox) > data->max_gap_distance) continue;
+    if ((cell.children[0] >= 0) && (nstack < 254)) {
+      stack[nstack++] = cell.children[0];
+      stack[nstack++] = cell.children[1];
+      continue;
+    }
+
+    // Check objects of leaf cell (or of a cell too deep for the stack)
+    for (int i = cell.first_entry; i < cell.first_entry + cell.nentries; i++) {
+      int object_index1 = data->entries[i];
+      if (object_index1 == object_index0) continue;
+      const R3SurfelRelationshipObject& object1 = data->objects[object_index1];
+      if (data->type == R3_SURFEL_OBJECT_COPLANAR_RELATIONSHIP) {
+        // Coplanar relationships are symmetric, so consider every pair once
+        if (object_index1 < object_index0) continue;
+        if (!object1.has_plane) continue;
       }
+      if (R3Distance(object0.bbox, object1.bbox) > data->max_gap_distance) continue;
+      if (pairs) pairs[ncandidates].object_index1 = object_index1;
+      ncandidates++;
+    }
+  }
+
+  // Sort candidates in order of object index
+  if (pairs) {
+    int *indices = new int [ ncandidates + 1 ];
+    for (int i = 0; i < ncandidates; i++) indices[i] = pairs[i].object_index1;
+    qsort(indices, ncandidates, sizeof(int), CompareRelationshipCandidates);
+    for (int i = 0; i < ncandidates; i++) {
+      pairs[i].object_index0 = object_index0;
+      pairs[i].object_index1 = indices[i];
+      pairs[i].overlap = 0;
+      pairs[i].gap_distance = RN_INFINITY;
+      pairs[i].plane_offset = 0;
+      pairs[i].normal_angle = 0;
+    }
+    delete [] indices;
+  }
 
-      // Delete array of chunk objects
-      delete chunk_objects;
+  // Remember number of candidates
+  data->candidate_counts[object_index0] = ncandidates;
+}
 
-      // Delete graph
-      delete graph;
+
+
+static void
+EvaluateRelationshipPair(int pair_index, int thread_index, void *data_ptr)
+{
+  // Get objects
+  R3SurfelRelationshipData *data = (R3SurfelRelationshipData *) data_ptr;
+  R3SurfelRelationshipPair& pair = data->pairs[pair_index];
+  const R3SurfelRelationshipObject& object0 = data->objects[pair.object_index0];
+  const R3SurfelRelationshipObject& object1 = data->objects[pair.object_index1];
+
+  // Check planes
+  if (object0.has_plane && object1.has_plane) {
+    R3Plane plane0(object0.centroid, object0.normal);
+    R3Plane plane1(object1.centroid, object1.normal);
+    RNLength offset0 = R3Distance(plane0, object1.centroid);
+    RNLength offset1 = R3Distance(plane1, object0.centroid);
+    pair.plane_offset = (offset0 > offset1) ? offset0 : offset1;
+    pair.normal_angle = R3InteriorAngle(object0.normal, object1.normal);
+    if (data->type == R3_SURFEL_OBJECT_COPLANAR_RELATIONSHIP) {
+      if ((data->max_plane_offset > 0) && (pair.plane_offset > data->max_plane_offset)) return;
+      if ((data->max_normal_angle > 0) && (pair.normal_angle > data->max_normal_angle)) return;
     }
   }
 
-  // Return objects
-  return objects;
+  // Get convenient variables
+  const R3Point *positions0 = &data->positions[object0.first_point];
+  const R3Vector *normals0 = &data->normals[object0.first_point];
+  const unsigned long long *keys0 = &data->keys[object0.first_point];
+  const R3Point *positions1 = &data->positions[object1.first_point];
+  const R3Vector *normals1 = &data->normals[object1.first_point];
+  RNLength max_gap_distance = data->max_gap_distance;
+  RNLength max_offplane_distance = 0;
+  RNAngle max_normal_angle = 0;
+  if (data->type == R3_SURFEL_OBJECT_OVERLAP_RELATIONSHIP) {
+    max_offplane_distance = data->max_plane_offset;
+    max_normal_angle = data->max_normal_angle;
+  }
+
+  // Find points of object1 within max gap of compatible points of object0
+  int npoints = 0;
+  RNLength gap_distance = RN_INFINITY;
+  for (int i1 = 0; i1 < object1.npoints; i1++) {
+    const R3Point& position1 = positions1[i1];
+    if (R3Distance(position1, object0.bbox) > max_gap_distance) continue;
+    int ix = RelationshipCellCoordinate(data, position1, RN_X);
+    int iy = RelationshipCellCoordinate(data, position1, RN_Y);
+    int iz = RelationshipCellCoordinate(data, position1, RN_Z);
+    RNBoolean found = FALSE;
+
+    // Check points of object0 in neighbor cells
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dz = -1; dz <= 1; dz++) {
+          // Find first point in cell by binary search
+          unsigned long long key = RelationshipCellKey(ix + dx, iy + dy, iz + dz);
+          int low = 0, high = object0.npoints;
+          while (low < high) {
+            int middle = (low + high) / 2;
+            if (keys0[middle] < key) low = middle + 1;
+            else high = middle;
+          }
+
+          // Check points in cell
+          for (int i0 = low; (i0 < object0.npoints) && (keys0[i0] == key); i0++) {
+            RNLength distance = R3Distance(positions0[i0], position1);
+            if (distance > max_gap_distance) continue;
+            if (distance < gap_distance) gap_distance = distance;
+            if (found) continue;
+            if (!AreClusterNeighborsCompatible(positions0[i0], &normals0[i0], position1, &normals1[i1],
+              max_offplane_distance, max_normal_angle)) continue;
+            found = TRUE;
+          }
+        }
+      }
+    }
+
+    // Count point
+    if (found) npoints++;
+  }
+
+  // Fill in results
+  pair.overlap = (object1.npoints > 0) ? (RNScalar) npoints / (RNScalar) object1.npoints : 0;
+  pair.gap_distance = gap_distance;
+}
+
+
+
+static int
+CreateObjectRelationships(R3SurfelScene *scene, int type,
+  RNLength max_gap_distance, RNLength max_plane_offset, RNAngle max_normal_angle,
+  RNScalar min_overlap, int nthreads)
+{
+  // Check parameters
+  if (max_gap_distance <= 0) return 0;
+
+  // Initialize data
+  R3SurfelRelationshipData data;
+  data.type = type;
+  data.max_gap_distance = max_gap_distance;
+  data.max_plane_offset = max_plane_offset;
+  data.max_normal_angle = max_normal_angle;
+  data.nobjects = scene->NObjects();
+  data.objects = new R3SurfelRelationshipObject [ data.nobjects + 1 ];
+
+  // Create point sets of objects at a resolution suited to the max gap
+  // (serially, since reading blocks is not thread-safe)
+  R3SurfelPointSet **pointsets = new R3SurfelPointSet * [ data.nobjects + 1 ];
+  RNScalar max_resolution = 8.0 / (max_gap_distance * max_gap_distance);
+  int npoints = 0;
+  for (int i = 0; i < data.nobjects; i++) {
+    R3SurfelObject *object = scene->Object(i);
+    R3SurfelNodeSet nodes;
+    pointsets[i] = new R3SurfelPointSet();
+    nodes.InsertNodes(object, max_resolution);
+    for (int j = 0; j < nodes.NNodes(); j++) {
+      R3SurfelNode *node = nodes.Node(j);
+      for (int k = 0; k < node->NBlocks(); k++) {
+        R3SurfelBlock *block = node->Block(k);
+        pointsets[i]->InsertPoints(block);
+      }
+    }
+
+    // Initialize object
+    R3SurfelRelationshipObject& relationship_object = data.objects[i];
+    relationship_object.object = object;
+    relationship_object.bbox = (pointsets[i]->NPoints() > 0) ? pointsets[i]->BBox() : R3null_box;
+    relationship_object.first_point = npoints;
+    relationship_object.npoints = pointsets[i]->NPoints();
+    relationship_object.has_plane = FALSE;
+    npoints += pointsets[i]->NPoints();
+
+    // Get plane from PCA property
+    R3SurfelObjectProperty *property = object->FindObjectProperty(R3_SURFEL_OBJECT_PCA_PROPERTY);
+    if (property && (property->NOperands() == 21)) {
+      relationship_object.centroid = R3Point(property->Operand(0), property->Operand(1), property->Operand(2));
+      relationship_object.normal = R3Vector(property->Operand(9), property->Operand(10), property->Operand(11));
+      if (RNIsPositive(relationship_object.normal.Length())) relationship_object.has_plane = TRUE;
+    }
+  }
+
+  // Copy positions and normals of points into contiguous arrays
+  data.positions = new R3Point [ npoints + 1 ];
+  data.normals = new R3Vector [ npoints + 1 ];
+  data.keys = new unsigned long long [ npoints + 1 ];
+  R3Box scene_bbox = R3null_box;
+  for (int i = 0; i < data.nobjects; i++) {
+    R3SurfelPointSet *pointset = pointsets[i];
+    for (int j = 0; j < pointset->NPoints(); j++) {
+      R3SurfelPoint *point = pointset->Point(j);
+      data.positions[data.objects[i].first_point + j] = point->Position();
+      data.normals[data.objects[i].first_point + j] = point->Normal();
+    }
+    if (pointset->NPoints() > 0) scene_bbox.Union(data.objects[i].bbox);
+    delete pointset;
+  }
+  delete [] pointsets;
+
+  // Choose cells at least as large as the max gap (and with coordinates that fit into keys)
+  data.cell_size = max_gap_distance;
+  if (!scene_bbox.IsEmpty()) {
+    RNLength min_cell_size = scene_bbox.LongestAxisLength() / (R3_SURFEL_RELATIONSHIP_MAX_CELL_COORDINATE - 4);
+    if (data.cell_size < min_cell_size) data.cell_size = min_cell_size;
+    data.grid_origin = scene_bbox.Min() - R3Vector(2 * data.cell_size, 2 * data.cell_size, 2 * data.cell_size);
+  }
+  else {
+    data.grid_origin = R3zero_point;
+  }
+
+  // Sort points of every object by cell
+  RNParallelFor(data.nobjects, SortRelationshipPoints, &data, nthreads);
+
+  // Build bounding volume hierarchy over objects with points
+  data.entries = new int [ data.nobjects + 1 ];
+  int nentries = 0;
+  for (int i = 0; i < data.nobjects; i++) {
+    if (data.objects[i].npoints > 0) data.entries[nentries++] = i;
+  }
+  data.cells = new R3SurfelRelationshipCell [ 2 * nentries + 1 ];
+  data.ncells = 0;
+  if (nentries > 0) BuildRelationshipCell(&data, 0, nentries);
+
+  // Count candidate pairs, and then fill them in
+  data.candidate_counts = new int [ data.nobjects + 1 ];
+  data.candidate_offsets = new int [ data.nobjects + 1 ];
+  for (int i = 0; i < data.nobjects; i++) data.candidate_counts[i] = 0;
+  data.pairs = NULL;
+  RNParallelFor(data.nobjects, FindRelationshipCandidates, &data, nthreads, 64);
+  int npairs = 0;
+  for (int i = 0; i < data.nobjects; i++) {
+    data.candidate_offsets[i] = npairs;
+    npairs += data.candidate_counts[i];
+  }
+  data.pairs = new R3SurfelRelationshipPair [ npairs + 1 ];
+  RNParallelFor(data.nobjects, FindRelationshipCandidates, &data, nthreads, 64);
+
+  // Evaluate candidate pairs
+  RNParallelFor(npairs, EvaluateRelationshipPair, &data, nthreads);
+
+  // Create relationships (in order of object indices)
+  RNArray<R3SurfelObjectRelationship *> relationships;
+  for (int i = 0; i < npairs; i++) {
+    const R3SurfelRelationshipPair& pair = data.pairs[i];
+    if (pair.gap_distance > max_gap_distance) continue;
+    R3SurfelObject *object0 = data.objects[pair.object_index0].object;
+    R3SurfelObject *object1 = data.objects[pair.object_index1].object;
+    if (type == R3_SURFEL_OBJECT_OVERLAP_RELATIONSHIP) {
+      if (pair.overlap <= min_overlap) continue;
+      RNScalar operands[] = { pair.overlap, pair.gap_distance };
+      int noperands = sizeof(operands) / sizeof(RNScalar);
+      relationships.Insert(new R3SurfelObjectRelationship(type, object0, object1, operands, noperands));
+    }
+    else if (type == R3_SURFEL_OBJECT_COPLANAR_RELATIONSHIP) {
+      RNScalar operands[] = { pair.gap_distance, pair.plane_offset, pair.normal_angle };
+      int noperands = sizeof(operands) / sizeof(RNScalar);
+      relationships.Insert(new R3SurfelObjectRelationship(type, object0, object1, operands, noperands));
+    }
+  }
+
+  // Insert relationships into scene
+  scene->InsertObjectRelationships(relationships);
+
+  // Delete temporary memory
+  delete [] data.objects;
+  delete [] data.positions;
+  delete [] data.normals;
+  delete [] data.keys;
+  delete [] data.entries;
+  delete [] data.cells;
+  delete [] data.candidate_counts;
+  delete [] data.candidate_offsets;
+  delete [] data.pairs;
+
+  // Return number of relationships
+  return relationships.NEntries();
+}
+
+
+
+int
+CreateOverlapObjectRelationships(R3SurfelScene *scene,
+  RNLength max_gap_distance, RNLength max_plane_offset, RNAngle max_normal_angle,
+  RNScalar min_overlap, int nthreads)
+{
+  // Create relationships for objects overlapping others by more than min_overlap
+  return CreateObjectRelationships(scene, R3_SURFEL_OBJECT_OVERLAP_RELATIONSHIP,
+    max_gap_distance, max_plane_offset, max_normal_angle, min_overlap, nthreads);
+}
+
+
+
+int
+CreateCoplanarObjectRelationships(R3SurfelScene *scene,
+  RNLength max_gap_distance, RNLength max_plane_offset, RNAngle max_normal_angle,
+  int nthreads)
+{
+  // Create relationships for nearby objects with similar PCA planes
+  return CreateObjectRelationships(scene, R3_SURFEL_OBJECT_COPLANAR_RELATIONSHIP,
+    max_gap_distance, max_plane_offset, max_normal_angle, 0, nthreads);
 }
 
 
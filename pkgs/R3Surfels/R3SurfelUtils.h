@@ -97,6 +97,19 @@ R3Grid *CreateGrid(R3SurfelScene *scene,
 
 
 
+////////////////////////////////////////////////////////////////////////
+// Mesh creation (screened Poisson reconstruction from points with normals)
+////////////////////////////////////////////////////////////////////////
+
+R3Mesh *CreatePoissonMesh(R3SurfelPointSet *pointset,
+  int max_depth = 8, RNScalar trim_depth = 0, int nthreads = 0);
+R3Mesh *CreatePoissonMesh(R3SurfelScene *scene, const R3Box& bbox,
+  int max_depth = 8, RNScalar trim_depth = 0, int nthreads = 0);
+R3Mesh *CreatePoissonMesh(R3SurfelScene *scene,
+  int max_depth = 8, RNScalar trim_depth = 0, int nthreads = 0);
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // Normal computation
 ////////////////////////////////////////////////////////////////////////
@@ -144,6 +157,8 @@ R3Plane FitPlane(R3SurfelPointSet *pointset);
 
 R3Plane EstimateSupportPlane(R3SurfelPointSet *pointset, 
   RNLength accuracy = 0.1, RNScalar *npoints = NULL);
+R3Plane EstimateSupportPlane(const R3Point *positions, int npositions, 
+  RNLength accuracy = 0.1, RNScalar *npoints = NULL);
 R3Plane EstimateSupportPlane(R3SurfelScene *scene, 
   R3SurfelNode *source_node = NULL, const R3SurfelConstraint *constraint = NULL,
   RNLength accuracy = 0.1, RNScalar *npoints = NULL);
@@ -236,6 +251,23 @@ CreateClusterObjects(R3SurfelScene *scene,
   RNLength chunk_size = 0);
 
 
+////////////////////////////////////////////////////////////////////////
+// Object relationship creation
+////////////////////////////////////////////////////////////////////////
+
+int CreateOverlapObjectRelationships(R3SurfelScene *scene,
+  RNLength max_gap_distance = 0.5, RNLength max_plane_offset = 0, RNAngle max_normal_angle = 0,
+  RNScalar min_overlap = 0, int nthreads = 0);
+  // Relates object0 to object1 when more than min_overlap of the points of object1 are within
+  // max_gap_distance of compatible points of object0 (operands are overlap and gap distance)
+int CreateCoplanarObjectRelationships(R3SurfelScene *scene,
+  RNLength max_gap_distance = 0.5, RNLength max_plane_offset = 0.1, RNAngle max_normal_angle = 0.1,
+  int nthreads = 0);
+  // Relates objects within max_gap_distance whose PCA planes pass through each other's centroids
+  // and whose PCA normals are within max_normal_angle (operands are gap distance, plane offset,
+  // and normal angle).  Both return the number of relationships created
+
+
 ////////////////////////////////////////////////////////////////////////
 // Basic geometric funcitons
 ////////////////////////////////////////////////////////////////////////
@@ -55,6 +55,7 @@ class R3SurfelLabelRelationship;
 class R3SurfelLabelAssignment;
 typedef R3SurfelLabelAssignment R3SurfelObjectAssignment;
 class R3SurfelScene;
+class R3SurfelPicker;
 
 
 
@@ -85,6 +86,7 @@ class R3SurfelScene;
 #include "R3Surfels/R3SurfelLabelRelationship.h"
 #include "R3Surfels/R3SurfelLabelAssignment.h"
 #include "R3Surfels/R3SurfelScene.h"
+#include "R3Surfels/R3SurfelPicker.h"
 
 
 
@@ -21,6 +21,7 @@
 class RGBDImage;
 class RGBDSurface;
 class RGBDConfiguration;
+class RGBDTextureBaker;
 
 
 
@@ -59,6 +60,7 @@ class RGBDConfiguration;
 #include "RGBDConfiguration.h"
 #include "RGBDTransform.h"
 #include "RGBDUtil.h"
+#include "RGBDTextureBaker.h"
 
 
 
@@ -107,6 +107,7 @@ public:
 private:
   // Internal variables
   friend class RGBDConfiguration;
+  friend class RGBDTextureBaker;
   RGBDConfiguration *configuration;
   int configuration_index;
   RNArray<R2Grid *> channels;
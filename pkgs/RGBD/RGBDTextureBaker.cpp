@@ -0,0 +1,674 @@
+////////////////////////////////////////////////////////////////////////
+// Source file for RGBDTextureBaker class
+////////////////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Include files
+////////////////////////////////////////////////////////////////////////
+
+#include "RGBD.h"
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Internal types
+////////////////////////////////////////////////////////////////////////
+
+struct RGBDTextureView {
+  // Image and whether its channels are in memory
+  RGBDImage *image;
+  RNBoolean resident;
+
+  // Camera parameters (copied so that texels can be projected without matrix inversions)
+  double world_to_camera[3][4];
+  double fx, fy, cx, cy;
+  int width, height;
+  R3Point viewpoint;
+
+  // Frustum planes (four sides through the viewpoint and far plane at max_depth)
+  R3Plane planes[5];
+};
+
+struct RGBDTextureTile {
+  // Texels covered by tile
+  int surface_index;
+  int ix0, iy0, nx, ny;
+
+  // Views whose frustum intersects the tile (sorted by index)
+  int *views;
+  int nviews;
+
+  // Texel positions and normals (normal is zero if texel is not on surface)
+  float *positions;
+  float *normals;
+
+  // Best views so far (sorted by decreasing weight)
+  float *weights;
+  float *colors;
+};
+
+struct RGBDTextureBakerData {
+  // Baker and surfaces
+  const RGBDTextureBaker *baker;
+  const RNArray<RGBDSurface *> *surfaces;
+
+  // Views and candidate views for each surface
+  RGBDTextureView *views;
+  int **surface_views;
+  int *surface_nviews;
+
+  // Tiles
+  RGBDTextureTile *tiles;
+  int ntiles;
+
+  // Views in current batch
+  int *batch_views;
+  int first_batch_view, last_batch_view;
+
+  // Blended colors and masks for each surface
+  float **surface_colors;
+  unsigned char **surface_masks;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Constructors/destructors
+////////////////////////////////////////////////////////////////////////
+
+RGBDTextureBaker::
+RGBDTextureBaker(RGBDConfiguration *configuration)
+  : configuration(configuration),
+    max_views_per_texel(3),
+    max_viewing_angle(RN_PI * 75.0 / 180.0),
+    depth_tolerance(0.1),
+    max_depth(7.0),
+    image_border_width(16),
+    texel_padding(2),
+    tile_size(32),
+    max_resident_images(16),
+    nthreads(0)
+{
+}
+
+
+
+RGBDTextureBaker::
+~RGBDTextureBaker(void)
+{
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// View functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+InitializeView(RGBDTextureView& view, RGBDImage *image, RNLength max_depth)
+{
+  // Copy camera parameters
+  view.image = image;
+  view.resident = FALSE;
+  view.width = image->NPixels(RN_X);
+  view.height = image->NPixels(RN_Y);
+  view.fx = image->Intrinsics()[0][0];
+  view.fy = image->Intrinsics()[1][1];
+  view.cx = image->Intrinsics()[0][2];
+  view.cy = image->Intrinsics()[1][2];
+  view.viewpoint = image->WorldViewpoint();
+  const R4Matrix& m = image->CameraToWorld().InverseMatrix();
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++) {
+      view.world_to_camera[i][j] = m[i][j];
+    }
+  }
+
+  // Check intrinsics
+  if (RNIsZero(view.fx) || RNIsZero(view.fy)) {
+    for (int i = 0; i < 5; i++) view.planes[i] = R3Plane(0, 0, 0, -1);
+    return;
+  }
+
+  // Compute corners of frustum at max_depth (camera is looking down -Z)
+  R3Point corners[4];
+  const RNScalar u[4] = { 0.0, (RNScalar) view.width, (RNScalar) view.width, 0.0 };
+  const RNScalar v[4] = { 0.0, 0.0, (RNScalar) view.height, (RNScalar) view.height };
+  for (int i = 0; i < 4; i++) {
+    R3Point camera_position((u[i] - view.cx) * max_depth / view.fx, (v[i] - view.cy) * max_depth / view.fy, -max_depth);
+    image->TransformCameraToWorld(camera_position, corners[i]);
+  }
+
+  // Compute frustum planes facing inside
+  R3Point inside = image->WorldViewpoint() + 0.5 * max_depth * image->WorldTowards();
+  for (int i = 0; i < 4; i++) {
+    view.planes[i] = R3Plane(view.viewpoint, corners[i], corners[(i+1)%4]);
+  }
+  view.planes[4] = R3Plane(corners[0], corners[1], corners[2]);
+  for (int i = 0; i < 5; i++) {
+    if (R3SignedDistance(view.planes[i], inside) < 0) view.planes[i].Flip();
+  }
+}
+
+
+
+static RNBoolean
+ViewIntersectsBox(const RGBDTextureView& view, const R3Box& box)
+{
+  // Check if box is completely outside any frustum plane
+  if (box.IsEmpty()) return FALSE;
+  for (int i = 0; i < 5; i++) {
+    const R3Plane& plane = view.planes[i];
+    const R3Vector& normal = plane.Normal();
+    R3Point corner((normal.X() > 0) ? box.XMax() : box.XMin(),
+                   (normal.Y() > 0) ? box.YMax() : box.YMin(),
+                   (normal.Z() > 0) ? box.ZMax() : box.ZMin());
+    if (R3SignedDistance(plane, corner) < 0) return FALSE;
+  }
+
+  // Return success
+  return TRUE;
+}
+
+
+
+static void
+ReadViewChannels(int index, int /* thread_index */, void *data_ptr)
+{
+  // Read depth and color channels of view in batch
+  RGBDTextureBakerData *data = (RGBDTextureBakerData *) data_ptr;
+  RGBDTextureView& view = data->views[data->batch_views[index]];
+  if (!view.image->ReadColorChannels()) return;
+  if (!view.image->ReadDepthChannel()) { view.image->ReleaseColorChannels(); return; }
+  view.resident = TRUE;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Tile functions
+////////////////////////////////////////////////////////////////////////
+
+static void
+InitializeTile(int index, int /* thread_index */, void *data_ptr)
+{
+  // Get convenient variables
+  RGBDTextureBakerData *data = (RGBDTextureBakerData *) data_ptr;
+  RGBDTextureTile& tile = data->tiles[index];
+  RGBDSurface *surface = data->surfaces->Kth(tile.surface_index);
+  int nviews_per_texel = data->baker->MaxViewsPerTexel();
+  int ntexels = tile.nx * tile.ny;
+
+  // Allocate texel arrays
+  tile.positions = new float [ 3 * ntexels ];
+  tile.normals = new float [ 3 * ntexels ];
+  tile.weights = new float [ nviews_per_texel * ntexels ];
+  tile.colors = new float [ 3 * nviews_per_texel * ntexels ];
+  for (int i = 0; i < nviews_per_texel * ntexels; i++) tile.weights[i] = 0;
+
+  // Compute texel positions and normals
+  R3Box bbox = R3null_box;
+  for (int j = 0; j < tile.ny; j++) {
+    for (int i = 0; i < tile.nx; i++) {
+      int t = j * tile.nx + i;
+      R2Point texture_position(tile.ix0 + i + 0.5, tile.iy0 + j + 0.5);
+      R3Point world_position;
+      R3Vector normal = R3zero_vector;
+      if (RGBDTransformTextureToWorld(texture_position, world_position, surface)) {
+        normal = surface->TexelWorldNormal(texture_position);
+        bbox.Union(world_position);
+      }
+      for (int k = 0; k < 3; k++) {
+        tile.positions[3*t+k] = world_position[k];
+        tile.normals[3*t+k] = normal[k];
+      }
+    }
+  }
+
+  // Find views whose frustum intersects tile
+  tile.views = NULL;
+  tile.nviews = 0;
+  if (bbox.IsEmpty()) return;
+  R3Vector margin = surface->WorldTexelSpacing() * R3ones_vector;
+  bbox.Reset(bbox.Min() - margin, bbox.Max() + margin);
+  int surface_nviews = data->surface_nviews[tile.surface_index];
+  const int *surface_views = data->surface_views[tile.surface_index];
+  tile.views = new int [ surface_nviews + 1 ];
+  for (int k = 0; k < surface_nviews; k++) {
+    if (!ViewIntersectsBox(data->views[surface_views[k]], bbox)) continue;
+    tile.views[tile.nviews++] = surface_views[k];
+  }
+}
+
+
+
+static RNScalar
+BorderFalloff(const RGBDTextureView& view, RNScalar u, RNScalar v, int border_width)
+{
+  // Check border width
+  if (border_width <= 0) return 1.0;
+
+  // Fall off near image border
+  RNScalar border_distance = u;
+  if (view.width - u < border_distance) border_distance = view.width - u;
+  if (v < border_distance) border_distance = v;
+  if (view.height - v < border_distance) border_distance = view.height - v;
+  RNScalar falloff = border_distance / border_width;
+  if (falloff > 1) falloff = 1;
+
+  // Return falloff
+  return falloff;
+}
+
+
+
+static RNScalar
+DiscontinuityFalloff(const RGBDTextureView& view, const R2Grid *depth_channel,
+  int iu, int iv, RNScalar image_depth, RNScalar depth_tolerance, int border_width, RNScalar falloff)
+{
+  // Check border width
+  if (border_width <= 0) return falloff;
+
+  // Fall off near depth discontinuities (first one found at increasing radii, none allowed next to pixel)
+  for (int r = 1; r <= border_width; r *= 2) {
+    if (falloff <= (r - 1.0) / border_width) break;
+    const int dx[8] = { -r, r, 0, 0, -r, r, -r, r };
+    const int dy[8] = { 0, 0, -r, r, -r, -r, r, r };
+    for (int k = 0; k < 8; k++) {
+      int nu = iu + dx[k], nv = iv + dy[k];
+      if ((nu < 0) || (nu >= view.width) || (nv < 0) || (nv >= view.height)) continue;
+      RNScalar neighbor_depth = depth_channel->GridValue(nu, nv);
+      if ((neighbor_depth == R2_GRID_UNKNOWN_VALUE) || (neighbor_depth <= 0) ||
+          (fabs(neighbor_depth - image_depth) > depth_tolerance * image_depth)) {
+        falloff = (r - 1.0) / border_width;
+        break;
+      }
+    }
+  }
+
+  // Return falloff
+  return falloff;
+}
+
+
+
+static void
+UpdateTile(int index, int /* thread_index */, void *data_ptr)
+{
+  // Get convenient variables
+  RGBDTextureBakerData *data = (RGBDTextureBakerData *) data_ptr;
+  RGBDTextureTile& tile = data->tiles[index];
+  const RGBDTextureBaker *baker = data->baker;
+  int nviews_per_texel = baker->MaxViewsPerTexel();
+  RNScalar min_cos_angle = cos(baker->MaxViewingAngle());
+  RNScalar depth_tolerance = baker->DepthTolerance();
+  int border_width = baker->ImageBorderWidth();
+  int ntexels = tile.nx * tile.ny;
+
+  // Update texels with every resident view in batch
+  for (int k = 0; k < tile.nviews; k++) {
+    if (tile.views[k] < data->first_batch_view) continue;
+    if (tile.views[k] > data->last_batch_view) break;
+    const RGBDTextureView& view = data->views[tile.views[k]];
+    if (!view.resident) continue;
+    const double (*m)[4] = view.world_to_camera;
+    const R2Grid *depth_channel = view.image->DepthChannel();
+    const R2Grid *red_channel = view.image->RedChannel();
+    const R2Grid *green_channel = view.image->GreenChannel();
+    const R2Grid *blue_channel = view.image->BlueChannel();
+
+    // Update texels
+    for (int t = 0; t < ntexels; t++) {
+      // Check texel
+      const float *p = &tile.positions[3*t];
+      const float *n = &tile.normals[3*t];
+      if ((n[0] == 0) && (n[1] == 0) && (n[2] == 0)) continue;
+
+      // Project texel into image
+      double x = m[0][0]*p[0] + m[0][1]*p[1] + m[0][2]*p[2] + m[0][3];
+      double y = m[1][0]*p[0] + m[1][1]*p[1] + m[1][2]*p[2] + m[1][3];
+      double z = m[2][0]*p[0] + m[2][1]*p[1] + m[2][2]*p[2] + m[2][3];
+      double depth = -z;
+      if (depth <= 0) continue;
+      double u = view.cx + x * view.fx / depth;
+      double v = view.cy + y * view.fy / depth;
+      if ((u < 0) || (u >= view.width) || (v < 0) || (v >= view.height)) continue;
+      int iu = (int) u, iv = (int) v;
+
+      // Check visibility
+      RNScalar image_depth = depth_channel->GridValue(iu, iv);
+      if ((image_depth == R2_GRID_UNKNOWN_VALUE) || (image_depth <= 0)) continue;
+      if (fabs(image_depth - depth) > depth_tolerance * depth) continue;
+
+      // Check viewing angle
+      double vx = view.viewpoint[0] - p[0];
+      double vy = view.viewpoint[1] - p[1];
+      double vz = view.viewpoint[2] - p[2];
+      double vlength = sqrt(vx*vx + vy*vy + vz*vz);
+      double nlength = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+      if ((vlength == 0) || (nlength == 0)) continue;
+      double cos_angle = fabs(vx*n[0] + vy*n[1] + vz*n[2]) / (vlength * nlength);
+      if (cos_angle < min_cos_angle) continue;
+
+      // Compute weight (favors frontal, close views away from image borders)
+      RNScalar falloff = BorderFalloff(view, u, v, border_width);
+      if (falloff <= 0) continue;
+      float weight = falloff * cos_angle * cos_angle / (depth * depth);
+
+      // Check if view can be among best ones
+      float *weights = &tile.weights[nviews_per_texel*t];
+      float *colors = &tile.colors[3*nviews_per_texel*t];
+      if (weight <= weights[nviews_per_texel-1]) continue;
+
+      // Reduce weight near depth discontinuities (checked last since it reads many pixels)
+      RNScalar discontinuity_falloff = DiscontinuityFalloff(view, depth_channel, iu, iv, image_depth, depth_tolerance, border_width, falloff);
+      if (discontinuity_falloff <= 0) continue;
+      if (discontinuity_falloff < falloff) {
+        weight = discontinuity_falloff * cos_angle * cos_angle / (depth * depth);
+        if (weight <= weights[nviews_per_texel-1]) continue;
+      }
+
+      // Insert color in sorted position
+      int slot = nviews_per_texel - 1;
+      while ((slot > 0) && (weight > weights[slot-1])) {
+        weights[slot] = weights[slot-1];
+        colors[3*slot+0] = colors[3*(slot-1)+0];
+        colors[3*slot+1] = colors[3*(slot-1)+1];
+        colors[3*slot+2] = colors[3*(slot-1)+2];
+        slot--;
+      }
+      RNScalar gx = u - 0.5, gy = v - 0.5;
+      if (gx < 0) gx = 0; else if (gx > view.width - 1) gx = view.width - 1;
+      if (gy < 0) gy = 0; else if (gy > view.height - 1) gy = view.height - 1;
+      weights[slot] = weight;
+      colors[3*slot+0] = red_channel->GridValue(gx, gy);
+      colors[3*slot+1] = green_channel->GridValue(gx, gy);
+      colors[3*slot+2] = blue_channel->GridValue(gx, gy);
+    }
+  }
+}
+
+
+
+static void
+BlendTile(int index, int /* thread_index */, void *data_ptr)
+{
+  // Get convenient variables
+  RGBDTextureBakerData *data = (RGBDTextureBakerData *) data_ptr;
+  RGBDTextureTile& tile = data->tiles[index];
+  RGBDSurface *surface = data->surfaces->Kth(tile.surface_index);
+  float *surface_colors = data->surface_colors[tile.surface_index];
+  unsigned char *surface_masks = data->surface_masks[tile.surface_index];
+  int nviews_per_texel = data->baker->MaxViewsPerTexel();
+  int width = surface->NTexels(RN_X);
+
+  // Blend best views at every texel
+  for (int j = 0; j < tile.ny; j++) {
+    for (int i = 0; i < tile.nx; i++) {
+      int t = j * tile.nx + i;
+      const float *weights = &tile.weights[nviews_per_texel*t];
+      const float *colors = &tile.colors[3*nviews_per_texel*t];
+      RNScalar rgb[3] = { 0, 0, 0 };
+      RNScalar total_weight = 0;
+      for (int k = 0; k < nviews_per_texel; k++) {
+        if (weights[k] <= 0) break;
+        rgb[0] += weights[k] * colors[3*k+0];
+        rgb[1] += weights[k] * colors[3*k+1];
+        rgb[2] += weights[k] * colors[3*k+2];
+        total_weight += weights[k];
+      }
+      if (total_weight <= 0) continue;
+      int s = (tile.iy0 + j) * width + tile.ix0 + i;
+      surface_colors[3*s+0] = rgb[0] / total_weight;
+      surface_colors[3*s+1] = rgb[1] / total_weight;
+      surface_colors[3*s+2] = rgb[2] / total_weight;
+      surface_masks[s] = 1;
+    }
+  }
+
+  // Delete texel arrays
+  delete [] tile.positions; tile.positions = NULL;
+  delete [] tile.normals; tile.normals = NULL;
+  delete [] tile.weights; tile.weights = NULL;
+  delete [] tile.colors; tile.colors = NULL;
+  if (tile.views) { delete [] tile.views; tile.views = NULL; }
+}
+
+
+
+static void
+PadSurface(int index, int /* thread_index */, void *data_ptr)
+{
+  // Get convenient variables
+  RGBDTextureBakerData *data = (RGBDTextureBakerData *) data_ptr;
+  RGBDSurface *surface = data->surfaces->Kth(index);
+  float *colors = data->surface_colors[index];
+  unsigned char *masks = data->surface_masks[index];
+  int width = surface->NTexels(RN_X);
+  int height = surface->NTexels(RN_Y);
+  if (!colors || !masks) return;
+
+  // Extend colors into unmapped texels one ring at a time (so that filtering does not bleed across chart seams)
+  unsigned char *previous_masks = new unsigned char [ width * height ];
+  for (int pass = 0; pass < data->baker->TexelPadding(); pass++) {
+    memcpy(previous_masks, masks, width * height);
+    int count = 0;
+    for (int iy = 0; iy < height; iy++) {
+      for (int ix = 0; ix < width; ix++) {
+        int s = iy * width + ix;
+        if (previous_masks[s]) continue;
+        RNScalar rgb[3] = { 0, 0, 0 };
+        int nneighbors = 0;
+        const int dx[4] = { -1, 1, 0, 0 };
+        const int dy[4] = { 0, 0, -1, 1 };
+        for (int k = 0; k < 4; k++) {
+          int nx = ix + dx[k], ny = iy + dy[k];
+          if ((nx < 0) || (nx >= width) || (ny < 0) || (ny >= height)) continue;
+          int ns = ny * width + nx;
+          if (!previous_masks[ns]) continue;
+          rgb[0] += colors[3*ns+0];
+          rgb[1] += colors[3*ns+1];
+          rgb[2] += colors[3*ns+2];
+          nneighbors++;
+        }
+        if (nneighbors == 0) continue;
+        colors[3*s+0] = rgb[0] / nneighbors;
+        colors[3*s+1] = rgb[1] / nneighbors;
+        colors[3*s+2] = rgb[2] / nneighbors;
+        masks[s] = 2;
+        count++;
+      }
+    }
+    if (count == 0) break;
+  }
+
+  // Delete temporary memory
+  delete [] previous_masks;
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Baking functions
+////////////////////////////////////////////////////////////////////////
+
+int RGBDTextureBaker::
+BakeTextures(void)
+{
+  // Bake textures of all surfaces
+  RNArray<RGBDSurface *> surfaces;
+  for (int i = 0; i < configuration->NSurfaces(); i++) {
+    surfaces.Insert(configuration->Surface(i));
+  }
+
+  // Return number of texels with colors
+  return BakeTextures(surfaces);
+}
+
+
+
+int RGBDTextureBaker::
+BakeTextures(const RNArray<RGBDSurface *>& surfaces)
+{
+  // Check configuration
+  if (!configuration) return 0;
+  int nimages = configuration->NImages();
+  int nsurfaces = surfaces.NEntries();
+  if ((nimages == 0) || (nsurfaces == 0)) return 0;
+
+  // Initialize data
+  RGBDTextureBakerData data;
+  data.baker = this;
+  data.surfaces = &surfaces;
+
+  // Compute view frustums (without reading images)
+  data.views = new RGBDTextureView [ nimages ];
+  for (int i = 0; i < nimages; i++) {
+    InitializeView(data.views[i], configuration->Image(i), max_depth);
+  }
+
+  // Find candidate views for every surface and create tiles
+  int ntiles = 0;
+  data.surface_views = new int * [ nsurfaces ];
+  data.surface_nviews = new int [ nsurfaces ];
+  data.surface_colors = new float * [ nsurfaces ];
+  data.surface_masks = new unsigned char * [ nsurfaces ];
+  for (int i = 0; i < nsurfaces; i++) {
+    RGBDSurface *surface = surfaces.Kth(i);
+    int width = surface->NTexels(RN_X);
+    int height = surface->NTexels(RN_Y);
+    data.surface_views[i] = new int [ nimages ];
+    data.surface_nviews[i] = 0;
+    data.surface_colors[i] = NULL;
+    data.surface_masks[i] = NULL;
+    if ((width <= 0) || (height <= 0)) continue;
+    R3Box bbox = surface->WorldBBox();
+    R3Vector margin = surface->WorldTexelSpacing() * R3ones_vector;
+    bbox.Reset(bbox.Min() - margin, bbox.Max() + margin);
+    for (int j = 0; j < nimages; j++) {
+      if (!ViewIntersectsBox(data.views[j], bbox)) continue;
+      data.surface_views[i][data.surface_nviews[i]++] = j;
+    }
+    if (data.surface_nviews[i] == 0) continue;
+    data.surface_colors[i] = new float [ 3 * width * height ];
+    data.surface_masks[i] = new unsigned char [ width * height ];
+    memset(data.surface_masks[i], 0, width * height);
+    if (surface->mesh && !surface->mesh_face_index) surface->UpdateMeshFaceIndex();
+    ntiles += ((width + tile_size - 1) / tile_size) * ((height + tile_size - 1) / tile_size);
+  }
+
+  // Create tiles
+  data.tiles = new RGBDTextureTile [ ntiles ];
+  data.ntiles = 0;
+  for (int i = 0; i < nsurfaces; i++) {
+    if (!data.surface_colors[i]) continue;
+    RGBDSurface *surface = surfaces.Kth(i);
+    int width = surface->NTexels(RN_X);
+    int height = surface->NTexels(RN_Y);
+    for (int iy = 0; iy < height; iy += tile_size) {
+      for (int ix = 0; ix < width; ix += tile_size) {
+        RGBDTextureTile& tile = data.tiles[data.ntiles++];
+        tile.surface_index = i;
+        tile.ix0 = ix;
+        tile.iy0 = iy;
+        tile.nx = (ix + tile_size <= width) ? tile_size : width - ix;
+        tile.ny = (iy + tile_size <= height) ? tile_size : height - iy;
+      }
+    }
+  }
+
+  // Compute texel positions and candidate views of tiles
+  RNParallelFor(data.ntiles, InitializeTile, &data, nthreads);
+
+  // Find views that are candidates for any tile
+  int nbatch_views = 0;
+  data.batch_views = new int [ nimages ];
+  RNBoolean *used = new RNBoolean [ nimages ];
+  for (int i = 0; i < nimages; i++) used[i] = FALSE;
+  for (int i = 0; i < data.ntiles; i++) {
+    for (int k = 0; k < data.tiles[i].nviews; k++) used[data.tiles[i].views[k]] = TRUE;
+  }
+  for (int i = 0; i < nimages; i++) {
+    if (used[i]) data.batch_views[nbatch_views++] = i;
+  }
+  delete [] used;
+
+  // Stream views through memory in batches
+  for (int first = 0; first < nbatch_views; first += max_resident_images) {
+    int count = (first + max_resident_images <= nbatch_views) ? max_resident_images : nbatch_views - first;
+    int *batch_views = data.batch_views;
+    data.batch_views = &batch_views[first];
+    data.first_batch_view = batch_views[first];
+    data.last_batch_view = batch_views[first + count - 1];
+
+    // Read channels of views in batch
+    RNParallelFor(count, ReadViewChannels, &data, nthreads);
+
+    // Update best views of texels
+    RNParallelFor(data.ntiles, UpdateTile, &data, nthreads);
+
+    // Release channels of views in batch
+    for (int k = 0; k < count; k++) {
+      RGBDTextureView& view = data.views[batch_views[first + k]];
+      if (view.resident) view.image->ReleaseChannels();
+      view.resident = FALSE;
+    }
+
+    // Restore batch views
+    data.batch_views = batch_views;
+  }
+
+  // Blend best views and pad charts
+  RNParallelFor(data.ntiles, BlendTile, &data, nthreads);
+  RNParallelFor(nsurfaces, PadSurface, &data, nthreads);
+
+  // Fill color channels of surfaces
+  int ntexels = 0;
+  for (int i = 0; i < nsurfaces; i++) {
+    RGBDSurface *surface = surfaces.Kth(i);
+    const float *colors = data.surface_colors[i];
+    const unsigned char *masks = data.surface_masks[i];
+    if (!colors || !masks) continue;
+
+    // Create image (keeping previous colors of texels seen by no view)
+    int width = surface->NTexels(RN_X);
+    int height = surface->NTexels(RN_Y);
+    RNBoolean resident = (surface->color_resident_count > 0);
+    R2Image image(width, height, 3);
+    for (int iy = 0; iy < height; iy++) {
+      for (int ix = 0; ix < width; ix++) {
+        int s = iy * width + ix;
+        if (masks[s]) image.SetPixelRGB(ix, iy, RNRgb(colors[3*s+0], colors[3*s+1], colors[3*s+2]));
+        else if (resident) image.SetPixelRGB(ix, iy, surface->TexelColor(ix, iy));
+        else image.SetPixelRGB(ix, iy, RNblack_rgb);
+        if (masks[s] == 1) ntexels++;
+      }
+    }
+
+    // Set color channels
+    if (resident) surface->SetColorChannels(image);
+    else surface->CreateColorChannels(image);
+  }
+
+  // Delete temporary memory
+  for (int i = 0; i < nsurfaces; i++) {
+    delete [] data.surface_views[i];
+    if (data.surface_colors[i]) delete [] data.surface_colors[i];
+    if (data.surface_masks[i]) delete [] data.surface_masks[i];
+  }
+  delete [] data.surface_views;
+  delete [] data.surface_nviews;
+  delete [] data.surface_colors;
+  delete [] data.surface_masks;
+  delete [] data.batch_views;
+  delete [] data.tiles;
+  delete [] data.views;
+
+  // Return number of texels with colors
+  return ntexels;
+}
+
+
+
@@ -0,0 +1,248 @@
+////////////////////////////////////////////////////////////////////////
+// Include file for RGBDTextureBaker class
+////////////////////////////////////////////////////////////////////////
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Class definition
+////////////////////////////////////////////////////////////////////////
+
+class RGBDTextureBaker {
+public:
+  // Constructors/destructors
+  RGBDTextureBaker(RGBDConfiguration *configuration);
+  virtual ~RGBDTextureBaker(void);
+
+  // Configuration access functions
+  RGBDConfiguration *Configuration(void) const;
+
+  // Parameter access functions
+  int MaxViewsPerTexel(void) const;
+  RNAngle MaxViewingAngle(void) const;
+  RNScalar DepthTolerance(void) const;
+  RNLength MaxDepth(void) const;
+  int ImageBorderWidth(void) const;
+  int TexelPadding(void) const;
+  int TileSize(void) const;
+  int MaxResidentImages(void) const;
+  int NThreads(void) const;
+
+  // Parameter manipulation functions
+  void SetMaxViewsPerTexel(int nviews);
+    // Each texel blends colors from this many best views (1 copies the best one)
+  void SetMaxViewingAngle(RNAngle angle);
+    // Views more oblique than this angle to the surface normal are ignored
+  void SetDepthTolerance(RNScalar fraction);
+    // Texels whose depth differs from the image depth by more than this fraction of it are occluded
+  void SetMaxDepth(RNLength depth);
+    // Far distance of the image frustums used to find candidate views
+  void SetImageBorderWidth(int npixels);
+    // View weights fall off to zero over this many pixels near image borders and depth discontinuities
+  void SetTexelPadding(int ntexels);
+    // Colors are extended this many texels into unmapped texels around mesh charts
+  void SetTileSize(int ntexels);
+  void SetMaxResidentImages(int nimages);
+    // Number of images whose channels are read into memory at once
+  void SetNThreads(int nthreads);
+
+  // Baking functions
+  int BakeTextures(void);
+  int BakeTextures(const RNArray<RGBDSurface *>& surfaces);
+    // Fill color channels of surfaces from the images of the configuration, returns number of texels with colors
+    // (channels that were not resident are created, so the caller should write and release them)
+
+private:
+  // Internal variables
+  RGBDConfiguration *configuration;
+  int max_views_per_texel;
+  RNAngle max_viewing_angle;
+  RNScalar depth_tolerance;
+  RNLength max_depth;
+  int image_border_width;
+  int texel_padding;
+  int tile_size;
+  int max_resident_images;
+  int nthreads;
+};
+
+
+
+////////////////////////////////////////////////////////////////////////
+// Inline functions
+////////////////////////////////////////////////////////////////////////
+
+inline RGBDConfiguration *RGBDTextureBaker::
+Configuration(void) const
+{
+  // Return configuration with images and surfaces
+  return configuration;
+}
+
+
+
+inline int RGBDTextureBaker::
+MaxViewsPerTexel(void) const
+{
+  // Return number of views blended at each texel
+  return max_views_per_texel;
+}
+
+
+
+inline RNAngle RGBDTextureBaker::
+MaxViewingAngle(void) const
+{
+  // Return maximum angle between view direction and surface normal
+  return max_viewing_angle;
+}
+
+
+
+inline RNScalar RGBDTextureBaker::
+DepthTolerance(void) const
+{
+  // Return maximum depth difference (as fraction of depth) for visible texels
+  return depth_tolerance;
+}
+
+
+
+inline RNLength RGBDTextureBaker::
+MaxDepth(void) const
+{
+  // Return far distance of image frustums
+  return max_depth;
+}
+
+
+
+inline int RGBDTextureBaker::
+ImageBorderWidth(void) const
+{
+  // Return width of weight falloff near image borders
+  return image_border_width;
+}
+
+
+
+inline int RGBDTextureBaker::
+TexelPadding(void) const
+{
+  // Return number of texels colors are extended around charts
+  return texel_padding;
+}
+
+
+
+inline int RGBDTextureBaker::
+TileSize(void) const
+{
+  // Return width and height of texel tiles
+  return tile_size;
+}
+
+
+
+inline int RGBDTextureBaker::
+MaxResidentImages(void) const
+{
+  // Return number of images read into memory at once
+  return max_resident_images;
+}
+
+
+
+inline int RGBDTextureBaker::
+NThreads(void) const
+{
+  // Return number of threads (0 means one per processor)
+  return nthreads;
+}
+
+
+
+inline void RGBDTextureBaker::
+SetMaxViewsPerTexel(int nviews)
+{
+  // Set number of views blended at each texel
+  if (nviews < 1) nviews = 1;
+  this->max_views_per_texel = nviews;
+}
+
+
+
+inline void RGBDTextureBaker::
+SetMaxViewingAngle(RNAngle angle)
+{
+  // Set maximum angle between view direction and surface normal
+  this->max_viewing_angle = angle;
+}
+
+
+
+inline void RGBDTextureBaker::
+SetDepthTolerance(RNScalar fraction)
+{
+  // Set maximum depth difference (as fraction of depth) for visible texels
+  this->depth_tolerance = fraction;
+}
+
+
+
+inline void RGBDTextureBaker::
+SetMaxDepth(RNLength depth)
+{
+  // Set far distance of image frustums
+  this->max_depth = depth;
+}
+
+
+
+inline void RGBDTextureBaker::
+SetImageBorderWidth(int npixels)
+{
+  // Set width of weight falloff near image borders
+  this->image_border_width = npixels;
+}
+
+
+
+inline void RGBDTextureBaker::
+SetTexelPadding(int ntexels)
+{
+  // Set number of texels colors are extended around charts
+  this->texel_padding = ntexels;
+}
+
+
+
+inline void RGBDTextureBaker::
+SetTileSize(int ntexels)
+{
+  // Set width and height of texel tiles
+  if (ntexels < 1) ntexels = 1;
+  this->tile_size = ntexels;
+}
+
+
+
+inline void RGBDTextureBaker::
+SetMaxResidentImages(int nimages)
+{
+  // Set number of images read into memory at once
+  if (nimages < 1) nimages = 1;
+  this->max_resident_images = nimages;
+}
+
+
+
+inline void RGBDTextureBaker::
+SetNThreads(int nthreads)
+{
+  // Set number of threads (0 means one per processor)
+  this->nthreads = nthreads;
+}
+
+
+
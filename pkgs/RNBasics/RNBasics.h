@@ -79,6 +79,7 @@
 /* OS utility include files */
 
 #include "RNBasics/RNTime.h"
+#include "RNBasics/RNThread.h"
 
 
 
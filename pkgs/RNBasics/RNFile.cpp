@@ -3,6 +3,11 @@
 
 // Include files
 #include "RNBasics.h"
+#if (RN_OS == RN_WINDOWS)
+#   include <io.h>
+#else
+#   include <unistd.h>
+#endif
 
 
 
@@ -54,3 +59,39 @@ RNFileTell(FILE *fp)
 
 
 
+////////////////////////////////////////////////////////////////////////
+// FILE DURABILITY FUNCTIONS
+////////////////////////////////////////////////////////////////////////
+
+int
+RNFileSync(FILE *fp)
+{
+  // Flush buffered data to the operating system
+  if (fflush(fp) != 0) return 0;
+
+  // Flush operating system buffers to disk
+#if (RN_OS == RN_WINDOWS)
+  if (_commit(_fileno(fp)) != 0) return 0;
+#else
+  if (fsync(fileno(fp)) != 0) return 0;
+#endif
+
+  // Return success
+  return 1;
+}
+
+
+
+int
+RNFileReplace(const char *src_filename, const char *dst_filename)
+{
+  // Atomically rename src over dst (replacing dst if it exists)
+#if (RN_OS == RN_WINDOWS)
+  if (!MoveFileExA(src_filename, dst_filename, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) return 0;
+#else
+  if (rename(src_filename, dst_filename) != 0) return 0;
+#endif
+
+  // Return success
+  return 1;
+}
@@ -19,6 +19,15 @@ unsigned long long RNFileTell(FILE *fp);
 
 
 
+////////////////////////////////////////////////////////////////////////
+// File durability funcitons
+////////////////////////////////////////////////////////////////////////
+
+int RNFileSync(FILE *fp);
+int RNFileReplace(const char *src_filename, const char *dst_filename);
+
+
+
 ////////////////////////////////////////////////////////////////////////
 // File seek constants
 ////////////////////////////////////////////////////////////////////////
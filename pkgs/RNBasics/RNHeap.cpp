@@ -289,7 +289,7 @@ Update(PtrType entry)
   // Search for entry
   PtrType *entryp = NULL;
   if (entry_offset >= 0) entryp = *((PtrType **) ((unsigned char *) entry + entry_offset));
-  if (entry_callback) entryp = *((PtrType **) (*entry_callback)(entry, callback_data));
+  else if (entry_callback) entryp = *((PtrType **) (*entry_callback)(entry, callback_data));
   else {
     // Find entry in heap
     for (int i = 0; i < nentries; i++) {
@@ -316,7 +316,7 @@ Remove(PtrType entry)
   // Search for entry
   PtrType *entryp = NULL;
   if (entry_offset >= 0) entryp = *((PtrType **) ((unsigned char *) entry + entry_offset));
-  if (entry_callback) entryp = *((PtrType **) (*entry_callback)(entry, callback_data));
+  else if (entry_callback) entryp = *((PtrType **) (*entry_callback)(entry, callback_data));
   else {
     // Find entry in heap
     for (int i = 0; i < nentries; i++) {
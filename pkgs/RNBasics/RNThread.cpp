@@ -0,0 +1,255 @@
+/* Source file for GAPS thread utilities */
+
+
+
+/* Include files */
+
+#include "RNBasics.h"
+#if (RN_OS == RN_WINDOWS)
+#   include <process.h>
+#else
+#   include <pthread.h>
+#   include <unistd.h>
+#endif
+
+
+
+/* Private variables */
+
+static int RNnthreads = 0;
+
+
+
+int RNInitThread()
+{
+    /* Return OK status */
+    return TRUE;
+}
+
+
+
+void RNStopThread()
+{
+}
+
+
+
+/* Mutex functions */
+
+RNMutex::
+RNMutex(void)
+{
+    /* Create mutex */
+#   if (RN_OS == RN_WINDOWS)
+        CRITICAL_SECTION *section = new CRITICAL_SECTION;
+        InitializeCriticalSection(section);
+        handle = section;
+#   else
+        pthread_mutex_t *mutex = new pthread_mutex_t;
+        pthread_mutex_init(mutex, NULL);
+        handle = mutex;
+#   endif
+}
+
+
+
+RNMutex::
+~RNMutex(void)
+{
+    /* Destroy mutex */
+#   if (RN_OS == RN_WINDOWS)
+        CRITICAL_SECTION *section = (CRITICAL_SECTION *) handle;
+        DeleteCriticalSection(section);
+        delete section;
+#   else
+        pthread_mutex_t *mutex = (pthread_mutex_t *) handle;
+        pthread_mutex_destroy(mutex);
+        delete mutex;
+#   endif
+}
+
+
+
+void RNMutex::
+Lock(void)
+{
+    /* Acquire mutex */
+#   if (RN_OS == RN_WINDOWS)
+        EnterCriticalSection((CRITICAL_SECTION *) handle);
+#   else
+        pthread_mutex_lock((pthread_mutex_t *) handle);
+#   endif
+}
+
+
+
+void RNMutex::
+Unlock(void)
+{
+    /* Release mutex */
+#   if (RN_OS == RN_WINDOWS)
+        LeaveCriticalSection((CRITICAL_SECTION *) handle);
+#   else
+        pthread_mutex_unlock((pthread_mutex_t *) handle);
+#   endif
+}
+
+
+
+/* Thread count functions */
+
+int RNNumberOfProcessors(void)
+{
+    /* Return number of processors available */
+#   if (RN_OS == RN_WINDOWS)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        int nprocessors = (int) info.dwNumberOfProcessors;
+#   else
+        int nprocessors = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#   endif
+    return (nprocessors > 0) ? nprocessors : 1;
+}
+
+
+
+int RNNumberOfThreads(void)
+{
+    /* Return number of threads to use in parallel loops */
+    if (RNnthreads > 0) return RNnthreads;
+    return RNNumberOfProcessors();
+}
+
+
+
+void RNSetNumberOfThreads(int nthreads)
+{
+    /* Set number of threads to use in parallel loops */
+    RNnthreads = (nthreads > 0) ? nthreads : 0;
+}
+
+
+
+/* Parallel loop functions */
+
+struct RNParallelForData {
+    void (*function)(int, int, void *);
+    void *data;
+    int n;
+    int chunk_size;
+    int next_index;
+    RNMutex mutex;
+};
+
+struct RNParallelForThread {
+    RNParallelForData *loop;
+    int thread_index;
+};
+
+
+
+static void
+RNRunParallelForThread(RNParallelForThread *thread)
+{
+    /* Process chunks of indices until none remain */
+    RNParallelForData *loop = thread->loop;
+    while (TRUE) {
+        /* Grab next chunk */
+        loop->mutex.Lock();
+        int start = loop->next_index;
+        loop->next_index += loop->chunk_size;
+        loop->mutex.Unlock();
+        if (start >= loop->n) break;
+
+        /* Process chunk */
+        int end = start + loop->chunk_size;
+        if (end > loop->n) end = loop->n;
+        for (int i = start; i < end; i++) {
+            (*loop->function)(i, thread->thread_index, loop->data);
+        }
+    }
+}
+
+
+
+#if (RN_OS == RN_WINDOWS)
+static unsigned __stdcall
+RNParallelForThreadFunction(void *arg)
+{
+    RNRunParallelForThread((RNParallelForThread *) arg);
+    return 0;
+}
+#else
+static void *
+RNParallelForThreadFunction(void *arg)
+{
+    RNRunParallelForThread((RNParallelForThread *) arg);
+    return NULL;
+}
+#endif
+
+
+
+int RNParallelFor(int n, void (*function)(int, int, void *), void *data, int nthreads, int chunk_size)
+{
+    /* Check arguments */
+    if (n <= 0) return 0;
+    if (chunk_size < 1) chunk_size = 1;
+    if (nthreads <= 0) nthreads = RNNumberOfThreads();
+    int nchunks = (n + chunk_size - 1) / chunk_size;
+    if (nthreads > nchunks) nthreads = nchunks;
+
+    /* Run serially if only one thread */
+    if (nthreads <= 1) {
+        for (int i = 0; i < n; i++) (*function)(i, 0, data);
+        return 1;
+    }
+
+    /* Initialize shared loop data */
+    RNParallelForData loop;
+    loop.function = function;
+    loop.data = data;
+    loop.n = n;
+    loop.chunk_size = chunk_size;
+    loop.next_index = 0;
+
+    /* Initialize per-thread data */
+    RNParallelForThread *threads = new RNParallelForThread [ nthreads ];
+    for (int i = 0; i < nthreads; i++) {
+        threads[i].loop = &loop;
+        threads[i].thread_index = i;
+    }
+
+    /* Start worker threads (calling thread acts as thread 0) */
+#   if (RN_OS == RN_WINDOWS)
+        HANDLE *handles = new HANDLE [ nthreads ];
+        for (int i = 1; i < nthreads; i++) {
+            handles[i] = (HANDLE) _beginthreadex(NULL, 0, RNParallelForThreadFunction, &threads[i], 0, NULL);
+            if (!handles[i]) RNAbort("Unable to create thread");
+        }
+        RNRunParallelForThread(&threads[0]);
+        for (int i = 1; i < nthreads; i++) {
+            WaitForSingleObject(handles[i], INFINITE);
+            CloseHandle(handles[i]);
+        }
+        delete [] handles;
+#   else
+        pthread_t *handles = new pthread_t [ nthreads ];
+        for (int i = 1; i < nthreads; i++) {
+            if (pthread_create(&handles[i], NULL, RNParallelForThreadFunction, &threads[i]) != 0) {
+                RNAbort("Unable to create thread");
+            }
+        }
+        RNRunParallelForThread(&threads[0]);
+        for (int i = 1; i < nthreads; i++) {
+            pthread_join(handles[i], NULL);
+        }
+        delete [] handles;
+#   endif
+
+    /* Delete per-thread data */
+    delete [] threads;
+
+    /* Return number of threads used */
+    return nthreads;
+}
@@ -0,0 +1,54 @@
+/* Include file for GAPS thread utilities */
+
+#ifndef __RN__THREAD__H__
+#define __RN__THREAD__H__
+
+
+
+/* Initialization functions */
+
+int RNInitThread();
+void RNStopThread();
+
+
+
+/* Mutex class definition */
+
+class RNMutex {
+    public:
+        // Constructor functions
+        RNMutex(void);
+        ~RNMutex(void);
+
+        // Manipulation functions
+        void Lock(void);
+        void Unlock(void);
+
+    private:
+        // Mutexes cannot be copied
+        RNMutex(const RNMutex& mutex);
+        RNMutex& operator=(const RNMutex& mutex);
+
+    private:
+        void *handle;
+};
+
+
+
+/* Public functions */
+
+int RNNumberOfProcessors(void);
+int RNNumberOfThreads(void);
+void RNSetNumberOfThreads(int nthreads);
+  // Number of threads used by parallel loops (0 means one per processor)
+
+int RNParallelFor(int n, void (*function)(int index, int thread_index, void *data), void *data,
+  int nthreads = 0, int chunk_size = 1);
+  // Calls function(index, thread_index, data) once for every index in [0, n),
+  // distributing chunks of indices dynamically across nthreads worker threads
+  // (0 means RNNumberOfThreads()).  thread_index is in [0, nthreads) and can
+  // be used to select per-thread scratch storage.  Returns number of threads used.
+
+
+
+#endif